@@ -11,6 +11,7 @@
 #import <AssetsLibrary/AssetsLibrary.h>
 #import "NSFileManager+CQ.h"
 #import "AVCaptureDevice+Rate.h"
+#import "CQTimestampSEI.h"
 
 #define kasync_main_safe(block)\
 if ([NSThread isMainThread]) {\
@@ -41,6 +42,7 @@ static const NSString *VideoZoomFactorContext;
 @property (nonatomic, strong) AVCaptureMovieFileOutput *movieFileOutput;  ///< 电影输出
 @property (nonatomic, strong) NSURL *movieFileOutputURL;  ///< 输出URL
 @property (nonatomic, strong) AVCaptureVideoDataOutput *videoDataOutput;  ///< 视频数据输出
+@property (nonatomic, assign) uint64_t videoFrameID;  ///< 视频帧序号，写入采集时间戳
 /*********音频相关**********/
 @property (nonatomic, strong) AVCaptureDeviceInput *audioDeviceInput;  ///< 音频输入设备
 @property (nonatomic, strong) AVCaptureAudioDataOutput *audioDataOutput;  ///< 音频数据输出
@@ -616,6 +618,7 @@ static const NSString *VideoZoomFactorContext;
     // 注意，视频/音频通过AV采集，都会走这里，需要对音频/视频做区分
     // 直接判断output 是videoDataOutput/Audio
     if ([captureOutput isKindOfClass:AVCaptureVideoDataOutput.class]) {
+        [self attachCaptureTimestampToSampleBuffer:sampleBuffer];
         if (self.delegate && [self.delegate respondsToSelector:@selector(captureVideoSampleBuffer:)]) {
             [_delegate captureVideoSampleBuffer:sampleBuffer];
         }
@@ -627,6 +630,21 @@ static const NSString *VideoZoomFactorContext;
     }
 }
 
+/**
+ 附加采集时间戳，编码器写入SEI用于测量端到端延迟
+ PTS是主机时钟，回调时已经过了一段时间，换算成Unix时间时减去这段时间
+ */
+- (void)attachCaptureTimestampToSampleBuffer:(CMSampleBufferRef)sampleBuffer {
+    CMTime now = CMClockGetTime(CMClockGetHostTimeClock());
+    CMTime pts = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+    int64_t elapsedUs = CMTIME_IS_VALID(pts) ? (int64_t)(CMTimeGetSeconds(CMTimeSubtract(now, pts)) * 1000000) : 0;
+    CQCaptureTimestamp timestamp = {
+        .captureTimeUs = CQWallClockMicros() - (uint64_t)MAX(elapsedUs, 0),
+        .frameID = ++self.videoFrameID,
+    };
+    CQCaptureTimestampAttach(sampleBuffer, timestamp);
+}
+
 /**
  每当一个迟到的视频帧被丢弃时调用该方法，通常是因为在didOutputSampleBuffer调用中消耗了太多的处理时间就会调用该方法，应尽量提高处理效率，否则将收不到缓存数据
  */
@@ -7,6 +7,7 @@
 
 #import "CQAudioDecoder.h"
 #import <AudioToolbox/AudioToolbox.h>
+#import "CQMediaExecutor.h"
 
 typedef struct {
     char * data;
@@ -16,8 +17,8 @@ typedef struct {
 } CQAudioUserData;
 
 @interface CQAudioDecoder ()
-@property (nonatomic, strong) dispatch_queue_t decodeQueue;  ///< 解码队列
-@property (nonatomic, strong) dispatch_queue_t callbackQueue;  ///< 回调队列
+@property (nonatomic, strong) CQMediaStrand *strand;  ///< 解码在这个strand上执行
+@property (nonatomic, strong) CQMediaStrand *callbackStrand;  ///< 回调在这个strand上按顺序执行，接收方处理慢时不阻塞解码
 @property (strong, nonatomic) NSCondition *converterCond;
 /// 对音频转换器对象
 @property (nonatomic) AudioConverterRef audioConverter;
@@ -34,8 +35,8 @@ typedef struct {
 - (instancetype)initWithConfig:(CQAudioCoderConfig *)config {
     if (self = [super init]) {
         _config = config;
-        _decodeQueue = dispatch_queue_create("CQAudioDecoder decode queue", DISPATCH_QUEUE_SERIAL);
-        _callbackQueue = dispatch_queue_create("CQAudioDecoder callBack queue", DISPATCH_QUEUE_SERIAL);
+        _strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneAudio label:@"CQAudioDecoder"];
+        _callbackStrand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneAudio label:@"CQAudioDecoder.callback"];
         _audioConverter = NULL;
         _aacBufferSize = 0;
         _aacBuffer = NULL;
@@ -57,7 +58,7 @@ typedef struct {
 #pragma mark - Public Func
 - (void)audioDecodeWithAACData:(NSData *)aacData {
     if (!_audioConverter) { return; }
-    dispatch_async(_decodeQueue, ^{
+    [self.strand async:^{
         // 记录aac 作为参数参入 给到 解码回调函数
         CQAudioUserData userData = {0};
         userData.channelCount = (UInt32)self.config.channelCount;
@@ -94,14 +95,14 @@ typedef struct {
         // 如果获取到数据
         if (outAudioBufferList.mBuffers[0].mDataByteSize > 0) {
             NSData *rawData = [NSData dataWithBytes:outAudioBufferList.mBuffers[0].mData length:outAudioBufferList.mBuffers[0].mDataByteSize];
-            dispatch_async(self.callbackQueue, ^{
+            [self.callbackStrand async:^{
                 if (self.delegate && [self.delegate respondsToSelector:@selector(audioDecoder:didDecodeSuccessWithPCMData:)]) {
                     [self.delegate audioDecoder:self didDecodeSuccessWithPCMData:rawData];
                 }
-            });
+            }];
         }
         free(pcmBuffer);
-    });
+    }];
 }
 
 #pragma mark - 创建解码器
@@ -21,11 +21,20 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)audioEncoder:(CQAudioEncoder *)audioEncoder didEncodeSuccessWithAACData:(NSData *)aacData;
 
+@optional
+/**
+ 当编码完成时(携带时间戳)
+ @discussion 封装器需要每一帧的裸数据和时间戳，在didEncodeSuccessWithAACData:回调之后回调
+ @param rawAACData 不带ADTS头的AAC裸数据
+ @param pts 该帧的显示时间戳(取自输入的PCM sampleBuffer)
+ */
+- (void)audioEncoder:(CQAudioEncoder *)audioEncoder didEncodeRawAACData:(NSData *)rawAACData pts:(CMTime)pts;
+
 @end
 
 /**
  视频编码工具
- @discussion 二次封装AudioToolBox编码 (编码和回调均在异步队列执行)
+ @discussion 二次封装AudioToolBox编码 (编码在CQMediaExecutor的strand上串行执行，回调在另一个strand上按顺序执行，回调慢不阻塞编码)
  */
 @interface CQAudioEncoder : NSObject
 
@@ -48,6 +57,13 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)audioEncodeWithSampleBuffer:(CMSampleBufferRef)sampleBuffer;
 
+/**
+ 运行时修改目标码率(拥塞控制)
+ @discussion 转换器还没创建时在创建时生效，AAC编码器不支持的码率会被取到最接近的档位
+ @param bitrate 码率(bps)
+ */
+- (void)setTargetBitrate:(NSInteger)bitrate;
+
 @end
 
 NS_ASSUME_NONNULL_END
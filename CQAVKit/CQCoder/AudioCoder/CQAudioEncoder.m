@@ -7,10 +7,11 @@
 
 #import "CQAudioEncoder.h"
 #import <AudioToolbox/AudioToolbox.h>
+#import "CQMediaExecutor.h"
 
 @interface CQAudioEncoder ()
-@property (nonatomic, strong) dispatch_queue_t encodeQueue;  ///< 编码队列
-@property (nonatomic, strong) dispatch_queue_t callBackQueue;  ///< 回调队列
+@property (nonatomic, strong) CQMediaStrand *strand;  ///< 编码在这个strand上执行
+@property (nonatomic, strong) CQMediaStrand *callbackStrand;  ///< 回调在这个strand上按顺序执行，接收方处理慢时不阻塞编码
 /// 对音频转换器对象
 @property (nonatomic, unsafe_unretained) AudioConverterRef audioConverter;
 ///PCM缓存区
@@ -19,6 +20,7 @@
 @property (nonatomic) size_t pcmBufferSize;
 
 @property (nonatomic, assign) BOOL isHaveHeader;
+@property (nonatomic, assign) NSInteger bitrate;  ///< 当前目标码率，初始为config.bitrate
 @end
 
 @implementation CQAudioEncoder
@@ -27,13 +29,14 @@
 - (instancetype)initWithConfig:(CQAudioCoderConfig *)config {
     if (self = [super init]) {
         _config = config;
-        _encodeQueue = dispatch_queue_create("CQAudioEncoder encode queue", DISPATCH_QUEUE_SERIAL);
-        _callBackQueue = dispatch_queue_create("CQAudioEncoder callBack queue", DISPATCH_QUEUE_SERIAL);
+        _strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneAudio label:@"CQAudioEncoder"];
+        _callbackStrand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneAudio label:@"CQAudioEncoder.callback"];
         //音频转换器
         _audioConverter = NULL;
         _pcmBufferSize = 0;
         _pcmBuffer = NULL;
         _config = config;
+        _bitrate = config.bitrate;
     }
     return self;
 }
@@ -47,6 +50,14 @@
 }
 
 #pragma mark - Public Func
+- (void)setTargetBitrate:(NSInteger)bitrate {
+    [self.strand async:^{
+        if (bitrate == self.bitrate) return;
+        self.bitrate = bitrate;
+        if (self.audioConverter) [self applyBitrate];
+    }];
+}
+
 // 实时编码
 - (void)audioEncodeWithSampleBuffer:(CMSampleBufferRef)sampleBuffer {
     CFRetain(sampleBuffer);
@@ -55,7 +66,9 @@
         [self setupAudioConverterWithSampleBuffer:sampleBuffer];
     }
     
-    dispatch_async(_encodeQueue, ^{
+    [self.strand async:^{
+        // 该帧的时间戳
+        CMTime pts = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
         // 从sampleBuffer获取CMBlockBuffer, 这里面保存了PCM数据
         CMBlockBufferRef blockBuffer = CMSampleBufferGetDataBuffer(sampleBuffer);
         CFRetain(blockBuffer);
@@ -109,12 +122,15 @@
                 self.isHaveHeader = YES;
             }
             [fullData appendData:rawAAC];
-            // 回调数据
-            dispatch_async(_callBackQueue, ^{
+            // 回调数据，两个回调一起提交到回调strand
+            [self.callbackStrand async:^{
                 if (self.delegate && [self.delegate respondsToSelector:@selector(audioEncoder:didEncodeSuccessWithAACData:)]) {
                     [self.delegate audioEncoder:self didEncodeSuccessWithAACData:fullData];
                 }
-            });
+                if (self.delegate && [self.delegate respondsToSelector:@selector(audioEncoder:didEncodeRawAACData:pts:)]) {
+                    [self.delegate audioEncoder:self didEncodeRawAACData:rawAAC pts:pts];
+                }
+            }];
         } else {
             error = [NSError errorWithDomain:NSOSStatusErrorDomain code:status userInfo:nil];
         }
@@ -123,7 +139,7 @@
         if (error) {
             NSLog(@"CQAudioEncoder - Error: AAC编码失败 %@",error);
         }
-    });
+    }];
 }
 
 /// 将sampleBuffer数据提取出PCM数据（外界可以直接播放PCM数据）
@@ -193,11 +209,16 @@
     AudioConverterSetProperty(_audioConverter, kAudioConverterCodecQuality, sizeof(temp), &temp);
     
     // 设置比特率
-    uint32_t audioBitrate = (uint32_t)self.config.bitrate;
+    [self applyBitrate];
+}
+
+/// 设置比特率，创建转换器和运行时修改码率共用
+- (void)applyBitrate {
+    uint32_t audioBitrate = (uint32_t)self.bitrate;
     uint32_t audioBitrateSize = sizeof(audioBitrate);
-    status = AudioConverterSetProperty(_audioConverter, kAudioConverterEncodeBitRate, audioBitrateSize, &audioBitrate);
+    OSStatus status = AudioConverterSetProperty(_audioConverter, kAudioConverterEncodeBitRate, audioBitrateSize, &audioBitrate);
     if (status != noErr) {
-        NSLog(@"AudioAudioEncoder - Error！：硬编码AAC 设置比特率失败");
+        NSLog(@"AudioAudioEncoder - Error！：硬编码AAC 设置比特率失败 %u", audioBitrate);
     }
 }
 
@@ -6,6 +6,7 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "CQNaluUtil.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -15,6 +16,8 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, assign) NSInteger height; ///< 可选，系统支持的分辨率，采集分辨率的高
 @property (nonatomic, assign) NSInteger bitrate; ///< 自由设置
 @property (nonatomic, assign) NSInteger fps; ///< 自由设置 25
+@property (nonatomic, assign) CQVideoCodec codec; ///< 编码格式，默认H264；HEVC需要设备支持硬件编码(A10及以上)，解码端和封装格式要一致
+@property (nonatomic, assign) NSInteger temporalLayerCount; ///< 时域层数，默认1；为2时分层P编码，每隔一帧是非参考帧，丢掉后帧率减半仍可正常解码
 
 + (instancetype)defaultConifg;
 
@@ -19,6 +19,8 @@
         self.height = 640;
         self.bitrate = 640*1000;
         self.fps = 25;
+        self.codec = CQVideoCodecH264;
+        self.temporalLayerCount = 1;
     }
     return self;
 }
@@ -8,6 +8,8 @@
 #import <Foundation/Foundation.h>
 #import <CoreVideo/CVPixelBuffer.h>
 #import "CQCoderConfig.h"
+#import "CQLatencyHistogram.h"
+#import "CQReferenceTracker.h"
 
 @class CQVideoDecoder;
 
@@ -21,11 +23,33 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)videoDecoder:(CQVideoDecoder *)videoDecoder didDecodeSuccessWithPixelBuffer:(CVPixelBufferRef)pixelBuffer;
 
+@optional
+/**
+ 需要关键帧
+ @discussion 参考帧丢失或解码出错后回调，直到收到IDR前按keyFrameRequestInterval重复，
+ 可以转成RTCP PLI发回发送端，本地回环时直接调用CQVideoEncoder的requestKeyFrame
+ */
+- (void)videoDecoderNeedsKeyFrame:(CQVideoDecoder *)videoDecoder;
+
 @end
 
+/// 解码输入的丢帧策略，只丢非参考帧(见CQFrameClassifier)，不影响其它帧的解码
+typedef NS_ENUM(NSUInteger, CQVideoDecoderDropPolicy) {
+    CQVideoDecoderDropPolicyNone = 0,  ///< 全部解码(默认)
+    CQVideoDecoderDropPolicyWhenBacklogged = 1,  ///< 待解码的输入超过maxPendingCount时丢非参考帧，解码跟不上时自动降帧率
+    CQVideoDecoderDropPolicyNonReference = 2,  ///< 总是丢非参考帧，分层P码流(CQVideoCoderConfig.temporalLayerCount为2)帧率减半
+};
+
+/// 参考帧丢失后的处理，见CQReferenceTracker
+typedef NS_ENUM(NSUInteger, CQVideoDecoderLossPolicy) {
+    CQVideoDecoderLossPolicyDecodeAll = 0,  ///< 照常解码(直到下一个IDR都是花屏)，只请求关键帧
+    CQVideoDecoderLossPolicySkipToKeyFrame = 1,  ///< 跳过依赖丢失参考帧的帧直到下一个IDR，画面停在最后一个正确的帧(默认)
+};
+
 /**
  视频解码工具
- @discussion 二次封装VideoToolBox解码 h264硬解码器 (编码和回调均在异步队列执行)
+ @discussion 二次封装VideoToolBox解码 h264/hevc硬解码器 (解码在CQMediaExecutor的strand上串行执行，回调在另一个strand上按顺序执行，回调慢不阻塞解码)
+ 码流格式由config.codec指定，HEVC需要先送入VPS/SPS/PPS
  */
 @interface CQVideoDecoder : NSObject
 
@@ -44,10 +68,50 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  视频解码
- @param h264Data h264视频数据
+ @param h264Data Annex-B视频数据(H264或HEVC)，可以包含多个NALU(例如编码器回调的VPS + SPS)
  */
 - (void)videoDecodeWithH264Data:(NSData *)h264Data;
 
+/**
+ 视频解码(AVCC格式)
+ @discussion MP4等文件里的sample本身就是4字节大端长度+NALU的AVCC格式，可以直接送入解码会话，不需要转换和拷贝
+ 解码会话需要先通过videoDecodeWithH264Data:送入sps/pps(HEVC还有vps)
+ @param avccData 一帧完整的AVCC数据(4字节长度头)，解码过程中只读
+ */
+- (void)videoDecodeWithAVCCData:(NSData *)avccData;
+
+@property (nonatomic, assign) CQVideoDecoderDropPolicy dropPolicy;  ///< 丢帧策略，默认CQVideoDecoderDropPolicyNone
+@property (nonatomic, assign) NSUInteger maxPendingCount;  ///< 积压阈值，默认4，每次调用videoDecodeWith...算一个输入
+@property (nonatomic, assign, readonly) uint64_t droppedFrameCount;  ///< 按丢帧策略丢掉的帧数
+
+@property (nonatomic, assign) CQVideoDecoderLossPolicy lossPolicy;  ///< 参考帧丢失后的处理，默认CQVideoDecoderLossPolicySkipToKeyFrame
+@property (nonatomic, assign) NSTimeInterval keyFrameRequestInterval;  ///< 两次videoDecoderNeedsKeyFrame:的最小间隔，默认0.5秒
+@property (nonatomic, assign, readonly) CQReferenceTrackerStats lossStats;  ///< 参考帧丢失/解码错误统计，在解码strand上同步取快照，不要在解码回调里读取
+
+/**
+ 上报数据丢失
+ @discussion 传输层发现丢包(例如CQRTPDepacketizer)时调用，解码器不知道丢的是哪一帧，按参考帧失效处理，
+ H264在没有上报时也会按frame_num发现丢失的参考帧，HEVC只能依靠上报
+ */
+- (void)reportDataLoss;
+
+/**
+ 采集->解码完成延迟
+ @discussion 码流带有采集时间戳SEI(CQVideoEncoder.insertsTimestampSEI)时统计，每帧一个样本
+ 解码输出的pixelBuffer上会附加CQCaptureTimestamp，见CQCaptureTimestampFromPixelBuffer
+ */
+@property (nonatomic, strong, readonly) CQLatencyHistogram *captureToDecodeLatency;
+
+/// 采集->显示延迟，由reportPresentedPixelBuffer:统计
+@property (nonatomic, strong, readonly) CQLatencyHistogram *captureToPresentLatency;
+
+/**
+ 上报一帧已经显示，统计采集->显示延迟
+ @discussion 在渲染线程调用，同一帧(多个slice)只统计一次，没有采集时间戳的pixelBuffer忽略
+ @param pixelBuffer 解码回调输出的pixelBuffer
+ */
+- (void)reportPresentedPixelBuffer:(CVPixelBufferRef)pixelBuffer;
+
 @end
 
 NS_ASSUME_NONNULL_END
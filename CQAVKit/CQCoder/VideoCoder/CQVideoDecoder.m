@@ -12,6 +12,11 @@
  3 将解析后的H264 NALU Unit 输入到解码器
  4 在解码完成的回调函数里，输出解码后的数据
  5 解码后的数据回调(可以使用OpenGL ES显示)
+ 6 解析采集时间戳SEI，附加到该帧的输出上，统计端到端延迟
+ 7 输入时计数，解码时按丢帧策略和积压数决定是否丢掉非参考帧(nal_ref_idc为0)，一帧的多个片按第一个片的决定一起丢
+ 8 HEVC的NALU头为2字节，按CQNaluKindOf判断作用后和H264走同样的流程，多保存一个VPS，用三个参数集创建格式描述
+ 9 每帧的第一个片交给CQReferenceTracker检查frame_num连续性，参考帧失效(丢帧、上报丢包、解码出错)后按lossPolicy跳过直到IDR，
+   并通过代理请求关键帧；同步解码，解码回调里的错误记到当前帧上
  
  核心函数:
  1 创建解码会话， VTDecompressionSessionCreate
@@ -43,27 +48,77 @@
 
 #import "CQVideoDecoder.h"
 #import <VideoToolbox/VideoToolbox.h>
+#import "CQMediaExecutor.h"
+#import "CQNaluUtil.h"
+#import "CQTimestampSEI.h"
+#import "CQFrameClassifier.h"
+#import <stdatomic.h>
+#import <time.h>
+
+static inline uint64_t CQVideoDecoderNowMicros(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+/// AVCC一帧里的第一个片
+static const uint8_t *CQAVCCFindFirstSlice(CQVideoCodec codec, const uint8_t *bytes, size_t length, size_t *sliceSize) {
+    size_t offset = 0;
+    while (offset + 4 < length) {
+        uint32_t naluSize = ((uint32_t)bytes[offset] << 24) | ((uint32_t)bytes[offset + 1] << 16) | ((uint32_t)bytes[offset + 2] << 8) | bytes[offset + 3];
+        offset += 4;
+        if (naluSize > length - offset) break;
+        CQNaluKind kind = naluSize >= CQNaluHeaderSize(codec) ? CQNaluKindOf(codec, bytes + offset) : CQNaluKindOther;
+        if (kind == CQNaluKindSlice || kind == CQNaluKindKeyFrame) {
+            *sliceSize = naluSize;
+            return bytes + offset;
+        }
+        offset += naluSize;
+    }
+    return NULL;
+}
 
 @interface CQVideoDecoder ()
-@property (nonatomic, strong) dispatch_queue_t decodeQueue;  ///< 解码队列
-@property (nonatomic, strong) dispatch_queue_t callBackQueue;  ///< 回调队列
+@property (nonatomic, strong) CQMediaStrand *strand;  ///< 解码在这个strand上执行
+@property (nonatomic, strong) CQMediaStrand *callbackStrand;  ///< 回调在这个strand上按顺序执行，接收方处理慢时不阻塞解码
 @property (nonatomic, assign) VTDecompressionSessionRef decodeSession;  ///< 解码会话
 
 @end
 
 @implementation CQVideoDecoder
 {
+    uint8_t *_vps;  ///< HEVC的VPS
+    long _vpsSize;
     uint8_t *_sps;
     long _spsSize;
     uint8_t *_pps;
     long _ppsSize;
     CMVideoFormatDescriptionRef _videoDesc;  ///< 视频格式描述
+    CQCaptureTimestamp _pendingTimestamp;  ///< SEI里解析出的采集时间戳，等待下一帧的第一个slice
+    BOOL _hasPendingTimestamp;
+    CQCaptureTimestamp _decodingTimestamp;  ///< 当前帧的采集时间戳
+    BOOL _hasDecodingTimestamp;
+    uint64_t _lastDecodedFrameID;  ///< 已统计解码延迟的帧序号，多slice只统计一次
+    uint64_t _lastPresentedFrameID;  ///< 已统计显示延迟的帧序号
+    atomic_uint _pendingCount;  ///< 已提交还没开始解码的输入数
+    BOOL _isDroppingFrame;  ///< 当前帧的第一个片被丢掉，后面的片一起丢
+    CQReferenceTracker _referenceTracker;  ///< 参考帧有效性
+    CQFrameClass _decodingFrameClass;  ///< 当前帧的类别，解码出错时判断是否影响后面的帧
+    OSStatus _callbackStatus;  ///< 解码回调的状态
 }
 
 #pragma mark - Init
 - (instancetype)initWithConfig:(CQVideoCoderConfig *)config {
     if (self = [super init]) {
         _config = config;
+        _captureToDecodeLatency = [[CQLatencyHistogram alloc] initWithName:@"captureToDecode"];
+        _captureToPresentLatency = [[CQLatencyHistogram alloc] initWithName:@"captureToPresent"];
+        _maxPendingCount = 4;
+        atomic_init(&_pendingCount, 0);
+        _lossPolicy = CQVideoDecoderLossPolicySkipToKeyFrame;
+        _keyFrameRequestInterval = 0.5;
+        _referenceTracker = CQReferenceTrackerMake(config.codec);
+        // VideoToolbox解码回调线程和调用方线程会同时访问，在init里创建，懒加载有竞争
+        _strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"CQVideoDecoder"];
+        _callbackStrand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"CQVideoDecoder.callback"];
     }
     return self;
 }
@@ -74,80 +129,226 @@
         CFRelease(self.decodeSession);
         self.decodeSession = NULL;
     }
+    free(_vps);
+    free(_sps);
+    free(_pps);
     NSLog(@"CQVideoDecoder - dealloc !!!");
 }
 
 #pragma mark - Public Func
 - (void)videoDecodeWithH264Data:(NSData *)h264Data; {
-    dispatch_async(self.decodeQueue, ^{
-        // 获取帧二进制数据
-        uint8_t *nalu = (uint8_t *)h264Data.bytes;
-        [self decodeNaluData:nalu withSize:(uint32_t)h264Data.length];
-    });
+    atomic_fetch_add(&_pendingCount, 1);
+    [self.strand async:^{
+        atomic_fetch_sub(&self->_pendingCount, 1);
+        // 逐个NALU处理，不拷贝也不改写调用方的数据(例如还在异步写文件)，解码时另外拼4字节长度(block持有h264Data)
+        CQNaluEnumerateAnnexB(h264Data.bytes, h264Data.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            [self decodeNaluData:nalu withSize:(uint32_t)naluSize];
+        });
+    }];
 }
 
+- (void)videoDecodeWithAVCCData:(NSData *)avccData {
+    atomic_fetch_add(&_pendingCount, 1);
+    [self.strand async:^{
+        atomic_fetch_sub(&self->_pendingCount, 1);
+        CQFrameInfo frameInfo = CQFrameClassifyAVCC(self.config.codec, avccData.bytes, avccData.length);
+        if ([self shouldDropFrame:frameInfo]) {
+            self->_droppedFrameCount++;
+            return;
+        }
+        size_t sliceSize = 0;
+        const uint8_t *slice = CQAVCCFindFirstSlice(self.config.codec, avccData.bytes, avccData.length, &sliceSize);
+        if (slice && ![self checkReferenceOfFrame:frameInfo firstSlice:slice size:sliceSize]) return;
+        // AVCC数据已经是解码器需要的格式，直接引用原始内存(block持有avccData，解码完成前不会释放)
+        [self parseTimestampSEIInAVCCData:avccData];
+        if ([self initDecoderSession]) {
+            // 解码结果由回调持有一次，在回调strand上交出后释放，这里不能再释放
+            [self decode:(uint8_t *)avccData.bytes withSize:(uint32_t)avccData.length];
+        }
+    }];
+}
+
+- (void)reportDataLoss {
+    [self.strand async:^{
+        CQReferenceTrackerOnDataLoss(&self->_referenceTracker);
+        [self requestKeyFrameIfNeeded];
+    }];
+}
+
+- (CQReferenceTrackerStats)lossStats {
+    // 参考帧跟踪只在strand上修改，在strand上取快照
+    __block CQReferenceTrackerStats stats;
+    [self.strand sync:^{
+        stats = self->_referenceTracker.stats;
+    }];
+    return stats;
+}
+
+- (void)reportPresentedPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    CQCaptureTimestamp timestamp;
+    if (!CQCaptureTimestampFromPixelBuffer(pixelBuffer, &timestamp) || timestamp.frameID == _lastPresentedFrameID) return;
+    _lastPresentedFrameID = timestamp.frameID;
+    [_captureToPresentLatency addMicros:(int64_t)(CQWallClockMicros() - timestamp.captureTimeUs)];
+}
 
 #pragma mark - Private Func
-/// 解析NALU数据
-- (void)decodeNaluData:(uint8_t *)naluData withSize:(uint32_t)frameSize {
-    // 数据类型:frame，前四个字节为NALU开始码，00 00 00 01
-    // 第五位标识数据类型，转化十进制，7表示sps，8表示pps，5表示I帧
-    int type = (naluData[4] & 0x1F);
-    
-    // 将NALU的开始码转为4字节大端NALU的长度信息
-    uint32_t naluSize = frameSize - 4;
-    uint8_t *pNaluSize = (uint8_t *)(&naluSize);
-    naluData[0] = *(pNaluSize + 3);
-    naluData[1] = *(pNaluSize + 2);
-    naluData[2] = *(pNaluSize + 1);
-    naluData[3] = *(pNaluSize);
+/// 解析NALU数据，nalu不含起始码
+- (void)decodeNaluData:(const uint8_t *)nalu withSize:(uint32_t)naluSize {
+    // NALU头标识数据类型，H264的7表示sps，8表示pps，5表示I帧；HEVC为NALU头第一个字节的第2~7位，按作用统一判断
+    CQVideoCodec codec = self.config.codec;
+    size_t headerSize = CQNaluHeaderSize(codec);
+    if (naluSize <= headerSize) return;
+    CQNaluKind kind = CQNaluKindOf(codec, nalu);
+    BOOL isSlice = kind == CQNaluKindSlice || kind == CQNaluKindKeyFrame;
     CVPixelBufferRef pixelBuffer = NULL;
     
     /**
      第一次解析时: 初始化解码器initDecoder
-     判断数据类型，帧数据调用decode:(uint8_t *)frame
+     判断数据类型，帧数据调用decodeNalu:withSize:
      sps/pps数据，则给成员变量赋值保存
      */
-    switch (type) {
-        case 0x05:
+    // 一帧的第一个slice(H264的first_mb_in_slice为0，HEVC的first_slice_segment_in_pic_flag为1，都是NALU头后的第一位)，取出前面SEI里的采集时间戳
+    if (isSlice && (nalu[headerSize] & 0x80)) {
+        _hasDecodingTimestamp = _hasPendingTimestamp;
+        _decodingTimestamp = _pendingTimestamp;
+        _hasPendingTimestamp = NO;
+        // 丢帧按第一个片决定，同一帧的其它片跟着丢，不会只解码半帧
+        CQFrameInfo frameInfo = CQFrameClassifyNalu(codec, nalu, naluSize);
+        _isDroppingFrame = [self shouldDropFrame:frameInfo];
+        if (_isDroppingFrame) {
+            _droppedFrameCount++;
+        } else {
+            // 依赖丢失参考帧的帧同样整帧跳过
+            _isDroppingFrame = ![self checkReferenceOfFrame:frameInfo firstSlice:nalu size:naluSize];
+        }
+    }
+    if (isSlice && _isDroppingFrame) return;
+    
+    switch (kind) {
+        case CQNaluKindKeyFrame:
             // 关键帧
             if ([self initDecoderSession]) {
-                pixelBuffer = [self decode:naluData withSize:frameSize];
+                pixelBuffer = [self decodeNalu:nalu withSize:naluSize];
             }
             break;
-        case 0x06:
-            // 增强型
-            break;
-        case 0x07:
-            // sps
-            _spsSize = naluSize;
-            _sps = malloc(_spsSize);
-            // 从下标4(也就是第五个元素)开始复制数据
-            memcpy(_sps, &naluData[4], _spsSize);
+        case CQNaluKindSEI:
+            // 增强型，只解析采集时间戳
+            if (CQTimestampSEIParse(codec, nalu, naluSize, &_pendingTimestamp)) {
+                _hasPendingTimestamp = YES;
+            }
             break;
-        case 0x08:
-            // pps
-            _ppsSize = naluSize;
-            _pps = malloc(_ppsSize);
-            // 从下标4(也就是第五个元素)开始复制数据
-            memcpy(_pps, &naluData[4], _ppsSize);
+        case CQNaluKindParameterSet:
+            // vps/sps/pps，复制保存
+            [self saveParameterSet:nalu withSize:naluSize];
             break;
         default:
             // 其他帧（1-5）
             if ([self initDecoderSession]) {
-                pixelBuffer = [self decode:naluData withSize:frameSize];
+                pixelBuffer = [self decodeNalu:nalu withSize:naluSize];
             }
             break;
     }
 }
 
-// 拿到SPS\PPS才能拿到CMVideoFormatDescriptionRef，CMVideoFormatDescriptionRef拿到才能初始化解码会话
-/// 初始化解码会话
-- (BOOL)initDecoderSession {
-    if (self.decodeSession) return YES;
+/// 保存参数集，创建解码会话时使用
+- (void)saveParameterSet:(const uint8_t *)nalu withSize:(uint32_t)size {
+    uint8_t **parameterSet = NULL;
+    long *parameterSetSize = NULL;
+    if (self.config.codec == CQVideoCodecHEVC) {
+        CQHEVCNaluType type = CQHEVCNaluTypeOf(nalu);
+        if (type == CQHEVCNaluTypeVPS) {
+            parameterSet = &_vps;
+            parameterSetSize = &_vpsSize;
+        } else if (type == CQHEVCNaluTypeSPS) {
+            parameterSet = &_sps;
+            parameterSetSize = &_spsSize;
+        } else {
+            parameterSet = &_pps;
+            parameterSetSize = &_ppsSize;
+        }
+    } else {
+        BOOL isSps = CQH264NaluTypeOf(nalu) == CQH264NaluTypeSPS;
+        parameterSet = isSps ? &_sps : &_pps;
+        parameterSetSize = isSps ? &_spsSize : &_ppsSize;
+    }
+    free(*parameterSet);
+    *parameterSetSize = size;
+    *parameterSet = malloc(size);
+    memcpy(*parameterSet, nalu, size);
+    CQReferenceTrackerOnParameterSet(&_referenceTracker, nalu, size);
+}
+
+/// 检查一帧的参考帧是否完整，失效时按lossPolicy决定是否跳过
+- (BOOL)checkReferenceOfFrame:(CQFrameInfo)frameInfo firstSlice:(const uint8_t *)slice size:(size_t)size {
+    BOOL skipsCorrupted = self.lossPolicy == CQVideoDecoderLossPolicySkipToKeyFrame;
+    BOOL shouldDecode = CQReferenceTrackerOnFrame(&_referenceTracker, frameInfo, slice, size, skipsCorrupted);
+    _decodingFrameClass = frameInfo.frameClass;
+    [self requestKeyFrameIfNeeded];
+    return shouldDecode;
+}
+
+/// 参考帧失效时按间隔请求关键帧
+- (void)requestKeyFrameIfNeeded {
+    _referenceTracker.minKeyFrameRequestIntervalUs = (uint64_t)(self.keyFrameRequestInterval * 1000000);
+    if (!CQReferenceTrackerShouldRequestKeyFrame(&_referenceTracker, CQVideoDecoderNowMicros())) return;
+    NSLog(@"CQVideoDecoder-reference frame lost, request key frame");
+    [self.callbackStrand async:^{
+        if (self.delegate && [self.delegate respondsToSelector:@selector(videoDecoderNeedsKeyFrame:)]) {
+            [self.delegate videoDecoderNeedsKeyFrame:self];
+        }
+    }];
+}
+
+/// 按丢帧策略决定是否丢掉这一帧，只有非参考帧可以丢
+- (BOOL)shouldDropFrame:(CQFrameInfo)frameInfo {
+    if (!CQFrameInfoIsDroppable(frameInfo)) return NO;
+    switch (self.dropPolicy) {
+        case CQVideoDecoderDropPolicyNonReference:
+            return YES;
+        case CQVideoDecoderDropPolicyWhenBacklogged:
+            return atomic_load(&_pendingCount) > self.maxPendingCount;
+        default:
+            return NO;
+    }
+}
+
+/// AVCC一帧里查找采集时间戳SEI
+- (void)parseTimestampSEIInAVCCData:(NSData *)avccData {
+    _hasDecodingTimestamp = NO;
+    const uint8_t *bytes = avccData.bytes;
+    size_t offset = 0;
+    while (offset + 4 < avccData.length) {
+        uint32_t naluSize = 0;
+        memcpy(&naluSize, bytes + offset, 4);
+        naluSize = CFSwapInt32BigToHost(naluSize);
+        offset += 4;
+        if (naluSize > avccData.length - offset) break;
+        if (CQTimestampSEIParse(self.config.codec, bytes + offset, naluSize, &_decodingTimestamp)) {
+            _hasDecodingTimestamp = YES;
+            break;
+        }
+        offset += naluSize;
+    }
+}
+
+/// 用参数集创建视频格式描述，H264为sps/pps，HEVC为vps/sps/pps
+- (BOOL)createVideoDesc {
+    int naluHeaderLen = 4;  // 大端模式起始位长度
+    OSStatus status;
+    if (self.config.codec == CQVideoCodecHEVC) {
+        if (!_vps || !_sps || !_pps) return NO;
+        const uint8_t * const parameterSetPointers[3] = {_vps, _sps, _pps};
+        const size_t parameterSetSizes[3] = {_vpsSize, _spsSize, _ppsSize};
+        status = CMVideoFormatDescriptionCreateFromHEVCParameterSets(kCFAllocatorDefault, 3, parameterSetPointers, parameterSetSizes, naluHeaderLen, NULL, &_videoDesc);
+        if (status != noErr) {
+            NSLog(@"CQVideoDecoder-Video Format DecodeSession create HEVCParameterSets(vps, sps, pps) failed status= %d", (int)status);
+            return NO;
+        }
+        return YES;
+    }
+    if (!_sps || !_pps) return NO;
     const uint8_t * const parameterSetPointers[2] = {_sps, _pps};
     const size_t parameterSetSizes[2] = {_spsSize, _ppsSize};
-    int naluHeaderLen = 4;  // 大端模式起始位长度
     
     /**
      根据sps pps设置解码参数
@@ -159,11 +360,20 @@
      param _decodeDesc 解码器描述
      return 状态
      */
-    OSStatus status = CMVideoFormatDescriptionCreateFromH264ParameterSets(kCFAllocatorDefault, 2, parameterSetPointers, parameterSetSizes, naluHeaderLen, &_videoDesc);
+    status = CMVideoFormatDescriptionCreateFromH264ParameterSets(kCFAllocatorDefault, 2, parameterSetPointers, parameterSetSizes, naluHeaderLen, &_videoDesc);
     if (status != noErr) {
         NSLog(@"CQVideoDecoder-Video Format DecodeSession create H264ParameterSets(sps, pps) failed status= %d", (int)status);
         return NO;
     }
+    return YES;
+}
+
+// 拿到SPS\PPS才能拿到CMVideoFormatDescriptionRef，CMVideoFormatDescriptionRef拿到才能初始化解码会话
+/// 初始化解码会话
+- (BOOL)initDecoderSession {
+    if (self.decodeSession) return YES;
+    if (![self createVideoDesc]) return NO;
+    OSStatus status;
     
     /**
      解码参数:
@@ -235,9 +445,6 @@
      解码函数接受的数据类型是CMSampleBufferRef，需要将frame 进行两次包装
      frame->CMBlockBufferRef->CMSampleBufferRef
      */
-    
-    // TODO: - outputPixelBuffer可以剔除
-    CVPixelBufferRef outputPixelBuffer = NULL;
     CMBlockBufferRef blockBuffer = NULL;
     CMBlockBufferFlags flag0 = 0;
     
@@ -257,9 +464,43 @@
     
     if (status != kCMBlockBufferNoErr) {
         NSLog(@"CQVideoDncoder-Video hard decode create blockBuffer error code=%d", (int)status);
-        return outputPixelBuffer;
+        return NULL;
     }
-    
+    CVPixelBufferRef outputPixelBuffer = [self decodeBlockBuffer:blockBuffer withSize:frameSize];
+    CFRelease(blockBuffer);
+    return outputPixelBuffer;
+}
+
+/// 解码单个NALU(不含起始码)，4字节长度单独一块，NALU直接引用调用方的内存，不拷贝
+- (CVPixelBufferRef)decodeNalu:(const uint8_t *)nalu withSize:(uint32_t)naluSize {
+    CMBlockBufferRef blockBuffer = NULL;
+    uint32_t length = CFSwapInt32HostToBig(naluSize);
+    OSStatus status = CMBlockBufferCreateEmpty(kCFAllocatorDefault, 2, 0, &blockBuffer);
+    if (status == kCMBlockBufferNoErr) {
+        // 长度块由CoreMedia分配，写入大端长度
+        status = CMBlockBufferAppendMemoryBlock(blockBuffer, NULL, 4, kCFAllocatorDefault, NULL, 0, 4, kCMBlockBufferAssureMemoryNowFlag);
+    }
+    if (status == kCMBlockBufferNoErr) {
+        status = CMBlockBufferReplaceDataBytes(&length, blockBuffer, 0, 4);
+    }
+    if (status == kCMBlockBufferNoErr) {
+        // kCFAllocatorNull: 不释放调用方的内存，解码是同步的，返回前不再使用
+        status = CMBlockBufferAppendMemoryBlock(blockBuffer, (void *)nalu, naluSize, kCFAllocatorNull, NULL, 0, naluSize, 0);
+    }
+    if (status != kCMBlockBufferNoErr) {
+        NSLog(@"CQVideoDncoder-Video hard decode create blockBuffer error code=%d", (int)status);
+        if (blockBuffer) CFRelease(blockBuffer);
+        return NULL;
+    }
+    CVPixelBufferRef outputPixelBuffer = [self decodeBlockBuffer:blockBuffer withSize:4 + naluSize];
+    CFRelease(blockBuffer);
+    return outputPixelBuffer;
+}
+
+/// 包装成CMSampleBuffer解码，blockBuffer由调用方释放
+- (CVPixelBufferRef)decodeBlockBuffer:(CMBlockBufferRef)blockBuffer withSize:(size_t)frameSize {
+    // TODO: - outputPixelBuffer可以剔除
+    CVPixelBufferRef outputPixelBuffer = NULL;
     CMSampleBufferRef sampleBuffer = NULL;
     const size_t sampleSizeArray[] = {frameSize};
     
@@ -275,11 +516,10 @@
      参数8: sampleSizeArray
      参数9: sampleBuffer对象
      */
-    status = CMSampleBufferCreateReady(kCFAllocatorDefault, blockBuffer, _videoDesc, 1, 0, NULL, 1, sampleSizeArray, &sampleBuffer);
+    OSStatus status = CMSampleBufferCreateReady(kCFAllocatorDefault, blockBuffer, _videoDesc, 1, 0, NULL, 1, sampleSizeArray, &sampleBuffer);
     
     if (status != noErr || !sampleBuffer) {
         NSLog(@"CQVideoDncoder-Video hard decode create sampleBuffer failed status=%d", (int)status);
-        CFRelease(blockBuffer);
         return outputPixelBuffer;
     }
     
@@ -296,6 +536,7 @@
      参数4: 解码后数据outputPixelBuffer
      参数5: 同步/异步解码标识
      */
+    _callbackStatus = noErr;
     status = VTDecompressionSessionDecodeFrame(_decodeSession, sampleBuffer, flag1, &outputPixelBuffer, &infoFlag);
     
     if (status == kVTInvalidSessionErr) {
@@ -305,45 +546,43 @@
     } else if (status != noErr) {
         NSLog(@"CQVideoDncoder-Video hard decode failed status =%d", (int)status);
     }
+    // 同步解码，回调已经执行完，两处的错误只算一次
+    if (status != noErr || _callbackStatus != noErr) {
+        CQReferenceTrackerOnDecodeError(&_referenceTracker, _decodingFrameClass != CQFrameClassNonReference);
+        [self requestKeyFrameIfNeeded];
+    }
     CFRelease(sampleBuffer);
-    CFRelease(blockBuffer);
     return outputPixelBuffer;
 }
 
 #pragma mark - VideoToolBox解码完成回调
 void videoDecoderCallBack(void * CM_NULLABLE decompressionOutputRefCon, void * CM_NULLABLE sourceFrameRefCon, OSStatus status, VTDecodeInfoFlags infoFlags, CM_NULLABLE CVImageBufferRef imageBuffer, CMTime presentationTimeStamp, CMTime presentationDuration ) {
+    // 获取self
+    CQVideoDecoder *decoder = (__bridge CQVideoDecoder *)(decompressionOutputRefCon);
     if (status != noErr) {
         NSLog(@"CQVideoDncoder-Video hard decode callback error status=%d", (int)status);
+        decoder->_callbackStatus = status;
         return;
     }
     // 拿到解码后的数据sourceFrameRefCon -> CVPixelBufferRef
     CVPixelBufferRef *outputPixelBuffer = (CVPixelBufferRef *)sourceFrameRefCon;
     *outputPixelBuffer = CVPixelBufferRetain(imageBuffer);
-    // 获取self
-    CQVideoDecoder *decoder = (__bridge CQVideoDecoder *)(decompressionOutputRefCon);
-    // 回调
-    dispatch_async(decoder.callBackQueue, ^{
+    // 同步解码，回调时当前帧的采集时间戳还有效
+    if (decoder->_hasDecodingTimestamp) {
+        CQCaptureTimestamp timestamp = decoder->_decodingTimestamp;
+        CQCaptureTimestampAttachToPixelBuffer(imageBuffer, timestamp);
+        if (timestamp.frameID != decoder->_lastDecodedFrameID) {
+            decoder->_lastDecodedFrameID = timestamp.frameID;
+            [decoder->_captureToDecodeLatency addMicros:(int64_t)(CQWallClockMicros() - timestamp.captureTimeUs)];
+        }
+    }
+    // 回调，切到回调strand，接收方(渲染、转发)处理慢时不阻塞下一帧解码
+    [decoder.callbackStrand async:^{
         if (decoder.delegate && [decoder.delegate respondsToSelector:@selector(videoDecoder:didDecodeSuccessWithPixelBuffer:)]) {
             [decoder.delegate videoDecoder:decoder didDecodeSuccessWithPixelBuffer:imageBuffer];
         }
         CVPixelBufferRelease(imageBuffer);
-    });
+    }];
 }
 
-#pragma mark - Load
-- (dispatch_queue_t)decodeQueue {
-    if (!_decodeQueue) {
-        _decodeQueue = dispatch_queue_create("CQVideoDncoder decode queue", DISPATCH_QUEUE_SERIAL);
-    }
-    return _decodeQueue;
-}
-
-- (dispatch_queue_t)callBackQueue {
-    if (!_callBackQueue) {
-        _callBackQueue = dispatch_queue_create("CQVideoDncoder callBack queue", DISPATCH_QUEUE_SERIAL);
-    }
-    return _callBackQueue;
-}
-
-
 @end
@@ -10,6 +10,8 @@
 #import "CQCoderConfig.h"
 
 @class CQVideoEncoder;
+@class CQVideoFilterGraph;
+@class CQTemporalDenoiser;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -23,16 +25,28 @@ NS_ASSUME_NONNULL_BEGIN
 
 /**
  当编码工具开始编码时 (该回调只会回调一次)
- @param sps sps数据
+ @param sps sps数据；HEVC时为VPS + SPS两个NALU拼接，都带起始码，按Annex-B转发的消费者(TS等)不需要区分
  @param pps pps数据
  */
 - (void)videoEncoder:(CQVideoEncoder *)videoEncoder didEncodeWithSps:(NSData *)sps pps:(NSData *)pps;
 
+@optional
+/**
+ 当一帧编码完成时 (每帧回调一次，在该帧所有NALU的didEncodeSuccessWithH264Data:回调之后)
+ @discussion 封装器(TS/MP4等)需要按帧处理数据并携带时间戳，实现此方法即可
+ @param nalus 该帧的所有NALU，Annex-B格式(带00 00 00 01起始码)，关键帧不包含sps/pps
+ @param pts 显示时间戳
+ @param dts 解码时间戳，没有B帧时与pts相同
+ @param isKeyFrame 是否为关键帧
+ */
+- (void)videoEncoder:(CQVideoEncoder *)videoEncoder didEncodeFrameWithNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
 @end
 
 /**
  视频编码工具
- @discussion 二次封装VideoToolBox编码 h264硬编码器 (编码和回调均在异步队列执行)
+ @discussion 二次封装VideoToolBox编码 h264/hevc硬编码器 (编码在CQMediaExecutor的strand上串行执行，回调在另一个strand上按顺序执行，回调慢不阻塞编码)
+ config.codec为HEVC而设备不支持时创建会话失败，不会自动退回H264，调用方用+isHEVCSupported提前判断
  */
 @interface CQVideoEncoder : NSObject
 
@@ -47,14 +61,82 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, strong, readonly) CQVideoCoderConfig *config;  ///< 配置信息
 
+/// 设备是否支持HEVC硬件编码
++ (BOOL)isHEVCSupported;
+
 @property (nonatomic, weak) id<CQVideoEncoderDelegate> delegate;  ///< 代理
 
+/**
+ 是否在每帧前插入采集时间戳SEI，默认NO
+ @discussion 时间戳取自sampleBuffer上的CQCaptureTimestamp附件(CQCaptureManager输出的帧都带有)，没有时用当前时间
+ SEI在该帧的第一个NALU之前回调，接收端CQVideoDecoder解析后统计端到端延迟
+ */
+@property (nonatomic, assign) BOOL insertsTimestampSEI;
+
+/**
+ 是否改写H264 SPS的VUI，默认YES
+ @discussion 回调sps前补上timing_info和bitstream_restriction(max_num_reorder_frames = 0)，
+ 接收端(浏览器、硬件解码器)知道没有B帧后解码一帧立即显示，不再按level缓存几帧；HEVC不改写
+ */
+@property (nonatomic, assign) BOOL rewritesSPSForLowLatency;
+
+/**
+ 是否自己把32BGRA/32RGBA输入转换为NV12，默认YES
+ @discussion 转换结果直接写到编码会话的缓冲池里(CQYUVConverter，NEON并按行并行)，输入宽高和编码宽高不同时仍交给VideoToolbox转换缩放
+ */
+@property (nonatomic, assign) BOOL convertsRGBInput;
+
+/**
+ 编码前的滤镜链(裁剪/旋转/镜像/缩放)，默认nil
+ @discussion 处理结果直接写到编码会话的缓冲池里，节点输出的宽高和编码宽高不同时按AspectFit填黑边；
+ 设置后RGB输入也由滤镜链转换，不再走convertsRGBInput；处理失败时把原来的buffer交给VideoToolbox
+ */
+@property (nonatomic, strong, nullable) CQVideoFilterGraph *filterGraph;
+
+/**
+ 编码前的时域降噪，默认nil
+ @discussion 在滤镜链/RGB转换之后处理，暗光下噪声不再占用码率；只处理NV12/I420，其它格式原样编码；
+ 切换摄像头等画面跳变时调用denoiser的reset
+ */
+@property (nonatomic, strong, nullable) CQTemporalDenoiser *denoiser;
+
+/**
+ 输出的帧数和其中的非参考帧数
+ @discussion config.temporalLayerCount为2时非参考帧应约占一半，为0说明编码器不支持分层P(iOS 14.5以下或硬件不支持)，
+ 此时接收端只能整个GOP丢帧；帧分类见CQFrameClassifier
+ */
+@property (nonatomic, assign, readonly) uint64_t encodedFrameCount;
+@property (nonatomic, assign, readonly) uint64_t nonReferenceFrameCount;
+
 /**
  视频编码
  @param sampleBuffer buffer
  */
 - (void)videoEncodeWithSampleBuffer:(CMSampleBufferRef)sampleBuffer;
 
+/**
+ 运行时修改目标码率(拥塞控制)
+ @discussion 只修改编码会话的AverageBitRate/DataRateLimits，不重建会话，下一帧生效
+ @param bitrate 码率(bps)
+ */
+- (void)setTargetBitrate:(NSInteger)bitrate;
+
+/**
+ 运行时修改分辨率和帧率(码率阶梯切换)
+ @discussion 分辨率变化时重建编码会话，输入的pixelBuffer由VideoToolbox缩放，重建后第一帧为关键帧并重新回调sps/pps
+ 帧率低于采集帧率时按时间戳丢帧
+ @param width 宽
+ @param height 高
+ @param fps 帧率
+ */
+- (void)setTargetWidth:(NSInteger)width height:(NSInteger)height fps:(NSInteger)fps;
+
+/**
+ 请求关键帧(接收端PLI/丢包无法恢复时)
+ @discussion 下一帧强制编码为关键帧，并重新回调sps/pps，接收端从这一帧开始可以独立解码
+ */
+- (void)requestKeyFrame;
+
 @end
 
 NS_ASSUME_NONNULL_END
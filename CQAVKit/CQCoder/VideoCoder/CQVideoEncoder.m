@@ -12,6 +12,15 @@
  3 输入到编码器
  4 在编码回调函数里将spspps以及数据回调，外界拿到回调可写入成视频文件
  5 销毁编码会话
+ 6 码率/分辨率/帧率可以运行时修改(拥塞控制)，码率直接设置会话属性，分辨率变化重建会话
+ 7 需要测量端到端延迟时，采集时间戳通过sourceFrameRefCon带到回调，在帧前插入SEI
+ 8 temporalLayerCount为2时开启低延迟码控和分层P(基础层占一半帧率)，增强层的帧是非参考帧，回调里用CQFrameClassifier统计，确认编码器确实输出了可丢弃的帧
+ 9 HEVC和H264只有编码类型、profile和参数集不同: 参数集多一个VPS，回调时和SPS拼在一起，NALU数据的处理完全一样
+ 10 H264的SPS回调前改写VUI(CQH264SPSRewriteVUI)，声明没有B帧，所有消费者(封装、转发、本地解码)拿到的都是改写后的SPS
+ 11 输入是32BGRA/32RGBA时自己转成NV12，写到编码会话的缓冲池(VTCompressionSessionGetPixelBufferPool)里再编码，
+    会话创建时指定源格式为NV12，缓冲池里就是编码器直接能用的格式；宽高和编码宽高不同时还是交给VideoToolbox缩放
+ 12 设置了filterGraph时，采集的帧经过滤镜链(CQVideoFilterGraph)一次变换写到缓冲池里，编码出来的画面和预览的方向、镜像、裁剪一致
+ 13 设置了denoiser时，送入编码器前做时域降噪(CQTemporalDenoiser)，降噪器自己保留上一帧的输出作参考，不占用编码会话的缓冲池
  
  用到的三个核心函数
  创建解码会话  VTCompressionSessionCreate
@@ -21,10 +30,18 @@
 
 #import "CQVideoEncoder.h"
 #import <VideoToolbox/VideoToolbox.h>
+#import <stdatomic.h>
+#import "CQMediaExecutor.h"
+#import "CQTimestampSEI.h"
+#import "CQFrameClassifier.h"
+#import "CQH264ParameterSets.h"
+#import "CQYUVConverter.h"
+#import "CQVideoFilterGraph.h"
+#import "CQTemporalDenoiser.h"
 
 @interface CQVideoEncoder ()
-@property (nonatomic, strong) dispatch_queue_t encodeQueue;  ///< 编码队列
-@property (nonatomic, strong) dispatch_queue_t callBackQueue;  ///< 回调队列
+@property (nonatomic, strong) CQMediaStrand *strand;  ///< 编码在这个strand上执行
+@property (nonatomic, strong) CQMediaStrand *callbackStrand;  ///< 回调在这个strand上按顺序执行，接收方处理慢时不阻塞编码
 @property (nonatomic, assign) VTCompressionSessionRef encodeSession;  ///< 编码会话
 
 @end
@@ -32,47 +49,149 @@
 @implementation CQVideoEncoder
 {
     long _frameID;  ///< 帧的递增标识
-    BOOL _isHasSpsPps;  ///< 标记是否已经获取到sps/pps
+    atomic_bool _needsParameterSets;  ///< 下一个关键帧需要回调sps/pps，strand上请求，编码回调线程取走并清除
+    NSInteger _width;  ///< 当前编码宽，初始为config.width
+    NSInteger _height;  ///< 当前编码高
+    NSInteger _fps;  ///< 当前编码帧率
+    NSInteger _bitrate;  ///< 当前目标码率
+    CMTime _lastEncodedTime;  ///< 上一次送入编码器的时间戳，降帧率时用来丢帧
+    BOOL _isKeyFrameRequested;  ///< 下一帧强制关键帧
+    _Atomic(uint64_t) _encodedFrameCount;  ///< 编码回调线程累加，调用方在任意线程读取
+    _Atomic(uint64_t) _nonReferenceFrameCount;
 }
 
 #pragma mark - Init
 - (instancetype)initWithConfig:(CQVideoCoderConfig *)config {
     if (self = [super init]) {
         _config = config;
+        _width = config.width;
+        _height = config.height;
+        _fps = config.fps;
+        _bitrate = config.bitrate;
+        _lastEncodedTime = kCMTimeInvalid;
+        atomic_init(&_needsParameterSets, true);
+        _rewritesSPSForLowLatency = YES;
+        _convertsRGBInput = YES;
+        // VideoToolbox编码回调线程和调用方线程会同时访问，在init里创建，懒加载有竞争
+        _strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"CQVideoEncoder"];
+        _callbackStrand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"CQVideoEncoder.callback"];
         [self initEncoderSession];
     }
     return self;
 }
 
 - (void)dealloc {
-    if (self.encodeSession) {
-        VTCompressionSessionCompleteFrames(self.encodeSession, kCMTimeInvalid);
-        VTCompressionSessionInvalidate(self.encodeSession);
-        CFRelease(self.encodeSession);
-        self.encodeSession = NULL;
-    }
+    [self destroyEncoderSession];
     NSLog(@"CQVideoEncoder - dealloc !!!");
 }
 
 #pragma mark - Public Func
++ (BOOL)isHEVCSupported {
+    // 没有直接查询硬件编码能力的接口，试着创建一个会话
+    VTCompressionSessionRef session = NULL;
+    OSStatus status = VTCompressionSessionCreate(kCFAllocatorDefault, 640, 480, kCMVideoCodecType_HEVC, NULL, NULL, NULL, NULL, NULL, &session);
+    if (session) {
+        VTCompressionSessionInvalidate(session);
+        CFRelease(session);
+    }
+    return status == noErr;
+}
+
 - (void)videoEncodeWithSampleBuffer:(CMSampleBufferRef)sampleBuffer {
     CFRetain(sampleBuffer);
-    dispatch_async(self.encodeQueue, ^{
+    [self.strand async:^{
         // 帧数据 未编码的数据
         CVImageBufferRef imageBuffer = (CVImageBufferRef)CMSampleBufferGetImageBuffer(sampleBuffer);
-        // 该帧的时间戳
+        // 该帧的时间戳，优先使用采集时间戳，码率控制和封装都依赖真实的时间
+        CMTime timeStamp = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+        if (CMTIME_IS_INVALID(timeStamp)) {
+            timeStamp = CMTimeMake(self->_frameID + 1, (int32_t)self.config.fps);
+        }
+        // 降帧率: 距离上一帧不到目标帧间隔(留半个采集帧间隔的余量)就丢掉
+        if (self->_fps < self.config.fps && CMTIME_IS_VALID(self->_lastEncodedTime)) {
+            double interval = CMTimeGetSeconds(CMTimeSubtract(timeStamp, self->_lastEncodedTime));
+            if (interval >= 0 && interval < 1.0 / self->_fps - 0.5 / self.config.fps) {
+                CFRelease(sampleBuffer);
+                return;
+            }
+        }
+        self->_lastEncodedTime = timeStamp;
         self->_frameID ++;
-        CMTime timeStamp = CMTimeMake(self->_frameID, 1000);
         // 持续时间
         CMTime duration = kCMTimeInvalid;
+        // 采集时间戳，回调里取出后释放
+        CQCaptureTimestamp *captureTimestamp = NULL;
+        if (self.insertsTimestampSEI) {
+            captureTimestamp = malloc(sizeof(CQCaptureTimestamp));
+            if (!CQCaptureTimestampFromSampleBuffer(sampleBuffer, captureTimestamp)) {
+                captureTimestamp->captureTimeUs = CQWallClockMicros();
+                captureTimestamp->frameID = (uint64_t)self->_frameID;
+            }
+        }
+        // 强制关键帧
+        NSDictionary *frameProperties = nil;
+        if (self->_isKeyFrameRequested) {
+            self->_isKeyFrameRequested = NO;
+            frameProperties = @{(__bridge NSString *)kVTEncodeFrameOptionKey_ForceKeyFrame: @YES};
+        }
+        // 滤镜链处理，没有滤镜链时RGB输入转成NV12
+        CVPixelBufferRef yuvBuffer = NULL;
+        if (self.filterGraph) {
+            yuvBuffer = [self createFilteredPixelBufferWithImageBuffer:imageBuffer];
+        } else if (self.convertsRGBInput) {
+            yuvBuffer = [self createYUVPixelBufferWithImageBuffer:imageBuffer];
+        }
+        if (yuvBuffer) imageBuffer = yuvBuffer;
+        // 时域降噪
+        CVPixelBufferRef denoisedBuffer = self.denoiser ? [self.denoiser createDenoisedPixelBuffer:imageBuffer] : NULL;
+        if (denoisedBuffer) imageBuffer = denoisedBuffer;
         // 编码
         VTEncodeInfoFlags flags;
-        OSStatus status = VTCompressionSessionEncodeFrame(self->_encodeSession, imageBuffer, timeStamp, duration, NULL, NULL, &flags);
+        OSStatus status = VTCompressionSessionEncodeFrame(self->_encodeSession, imageBuffer, timeStamp, duration, (__bridge CFDictionaryRef)frameProperties, captureTimestamp, &flags);
         if (status != noErr) {
             NSLog(@"CQVideoEncoder-VTCompressionSessionEncodeFrame failed. status = %d", (int)status);
+            // 失败时不会回调
+            free(captureTimestamp);
         }
+        CVPixelBufferRelease(denoisedBuffer);
+        CVPixelBufferRelease(yuvBuffer);
         CFRelease(sampleBuffer);
-    });
+    }];
+}
+
+- (void)setTargetBitrate:(NSInteger)bitrate {
+    [self.strand async:^{
+        if (bitrate == self->_bitrate) return;
+        self->_bitrate = bitrate;
+        if (self->_encodeSession) [self applyBitrate];
+    }];
+}
+
+- (void)setTargetWidth:(NSInteger)width height:(NSInteger)height fps:(NSInteger)fps {
+    [self.strand async:^{
+        BOOL isSizeChanged = width != self->_width || height != self->_height;
+        self->_fps = MIN(fps, self.config.fps);
+        if (!isSizeChanged) {
+            if (self->_encodeSession) {
+                VTSessionSetProperty(self->_encodeSession, kVTCompressionPropertyKey_ExpectedFrameRate, (__bridge CFNumberRef)@(self->_fps));
+            }
+            return;
+        }
+        self->_width = width;
+        self->_height = height;
+        // 先把旧会话里的帧输出完，再用新分辨率重建，新会话的sps/pps会重新回调
+        [self destroyEncoderSession];
+        atomic_store(&self->_needsParameterSets, true);
+        [self initEncoderSession];
+    }];
+}
+
+- (void)requestKeyFrame {
+    [self.strand async:^{
+        self->_isKeyFrameRequested = YES;
+        // 接收端需要重新拿到sps/pps才能从这个关键帧开始解码
+        atomic_store(&self->_needsParameterSets, true);
+    }];
 }
 
 #pragma mark - 初始化编码会话 设置属性
@@ -84,7 +203,7 @@
      参数1： 分配器，一般NULL 默认也是NULL
      参数2： 分辨率的width，像素为单位，如果此数据非法，编码会改为合理的值
      参数3： 分辨率的height，像素为单位，如果此数据非法，编码会改为合理的值
-     参数4： 编码类型-H264:KCMVideoCodecType_H264
+     参数4： 编码类型-H264:KCMVideoCodecType_H264，HEVC:kCMVideoCodecType_HEVC
      参数5： 编码规范 NULL
      参数6： 原像素缓冲区，NULL，由VideoToolBox默认创建
      参数7： 压缩数据分配器 NULL
@@ -92,7 +211,23 @@
      参数9： self 桥接过去，因为C语言函数如果想要调用OC方法，需要对象，就把self传过去，
      参数10：compressionSession
      */
-    OSStatus status = VTCompressionSessionCreate(kCFAllocatorDefault, (int32_t)_config.width, (int32_t)_config.height, kCMVideoCodecType_H264, NULL, NULL, NULL, videoEncoderCallBack, (__bridge  void *_Nullable)self, &_encodeSession);
+    // 分层P需要低延迟码控模式
+    NSDictionary *encoderSpecification = nil;
+    if (_config.temporalLayerCount > 1) {
+        if (@available(iOS 14.5, *)) {
+            encoderSpecification = @{(__bridge NSString *)kVTVideoEncoderSpecification_EnableLowLatencyRateControl: @YES};
+        }
+    }
+    BOOL isHEVC = _config.codec == CQVideoCodecHEVC;
+    CMVideoCodecType codecType = isHEVC ? kCMVideoCodecType_HEVC : kCMVideoCodecType_H264;
+    // 源格式指定为NV12，缓冲池(VTCompressionSessionGetPixelBufferPool)按这个格式创建，RGB输入转换后写到这里面
+    NSDictionary *sourceImageBufferAttributes = @{
+        (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(kCVPixelFormatType_420YpCbCr8BiPlanarFullRange),
+        (__bridge NSString *)kCVPixelBufferWidthKey: @(_width),
+        (__bridge NSString *)kCVPixelBufferHeightKey: @(_height),
+        (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+    };
+    OSStatus status = VTCompressionSessionCreate(kCFAllocatorDefault, (int32_t)_width, (int32_t)_height, codecType, (__bridge CFDictionaryRef)encoderSpecification, (__bridge CFDictionaryRef)sourceImageBufferAttributes, NULL, videoEncoderCallBack, (__bridge  void *_Nullable)self, &_encodeSession);
     if (status != noErr) {
         NSLog(@"CQVideoEncoder-VTCompressionSessionCreate create failed. status = %d", (int)status);
         return;
@@ -101,25 +236,32 @@
     // 设置实时编码
     status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_RealTime, kCFBooleanTrue);
     NSLog(@"CQVideoEncoder-VTSessionSetProperty set RealTime. return status = %d", (int)status);
-    // 指定编码比特流的配置文件和级别。直播一般使用baseline，抛弃B帧，可减少由B帧带来的延时
-    status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_ProfileLevel, kVTProfileLevel_H264_Baseline_AutoLevel);
+    // 指定编码比特流的配置文件和级别。直播一般使用baseline，抛弃B帧，可减少由B帧带来的延时；HEVC没有baseline，用Main并关闭B帧
+    CFStringRef profileLevel = isHEVC ? kVTProfileLevel_HEVC_Main_AutoLevel : kVTProfileLevel_H264_Baseline_AutoLevel;
+    status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_ProfileLevel, profileLevel);
+    if (isHEVC) {
+        VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_AllowFrameReordering, kCFBooleanFalse);
+    }
     NSLog(@"CQVideoEncoder-VTSessionSetProperty set ProfileLevel. return status = %d", (int)status);
-    // 设置码率均值(比特率可以高于此。默认比特率为0，表示视频编码器。应该确定压缩数据的大小。注意，比特率设置只在定时时有效)
-    CFNumberRef bit = (__bridge CFNumberRef)@(_config.bitrate);
-    status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_AverageBitRate, bit);
-    NSLog(@"CQVideoEncoder-VTSessionSetProperty set AverageBitRate. return status = %d", (int)status);
-    // 码率限制(只在定时时起作用)*待确认
-    CFArrayRef limits = (__bridge CFArrayRef)@[@(_config.bitrate / 4), @(_config.bitrate * 4)];
-    status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_DataRateLimits,limits);
-    NSLog(@"CQVideoEncoder-VTSessionSetProperty set DataRateLimits. return status = %d", (int)status);
+    // 码率
+    [self applyBitrate];
     //设置关键帧间隔(GOPSize)GOP太大图像会模糊
     CFNumberRef maxKeyFrameInterval = (__bridge CFNumberRef)@(_config.fps * 2);
     status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_MaxKeyFrameInterval, maxKeyFrameInterval);
     NSLog(@"CQVideoEncoder-VTSessionSetProperty set MaxKeyFrameInterval. return status = %d", (int)status);
     //设置fps(预期)
-    CFNumberRef expectedFrameRate = (__bridge CFNumberRef)@(_config.fps);
+    CFNumberRef expectedFrameRate = (__bridge CFNumberRef)@(_fps);
     status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_ExpectedFrameRate, expectedFrameRate);
     NSLog(@"CQVideoEncoder-VTSessionSetProperty set ExpectedFrameRate. return status = %d", (int)status);
+    // 分层P: 基础层为一半的帧，增强层的帧不被参考(nal_ref_idc为0)，接收端丢掉增强层帧率减半，不影响解码
+    if (_config.temporalLayerCount > 1) {
+        if (@available(iOS 14.5, *)) {
+            status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_BaseLayerFrameRateFraction, (__bridge CFNumberRef)@0.5);
+            NSLog(@"CQVideoEncoder-VTSessionSetProperty set BaseLayerFrameRateFraction. return status = %d", (int)status);
+        } else {
+            NSLog(@"CQVideoEncoder-temporal layers need iOS 14.5, encode without layers");
+        }
+    }
     
     //准备编码
     status = VTCompressionSessionPrepareToEncodeFrames(_encodeSession);
@@ -130,11 +272,88 @@
 }
 
 
+/// 设置码率属性，创建会话和运行时修改码率共用
+- (void)applyBitrate {
+    // 设置码率均值(比特率可以高于此。默认比特率为0，表示视频编码器。应该确定压缩数据的大小。注意，比特率设置只在定时时有效)
+    CFNumberRef bit = (__bridge CFNumberRef)@(_bitrate);
+    OSStatus status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_AverageBitRate, bit);
+    NSLog(@"CQVideoEncoder-VTSessionSetProperty set AverageBitRate %ld. return status = %d", (long)_bitrate, (int)status);
+    // 码率上限，格式为[字节数, 秒数]: 每秒不超过均值的1.5倍，关键帧不会把链路瞬间打满(拥塞控制依赖这个上限)
+    CFArrayRef limits = (__bridge CFArrayRef)@[@(_bitrate * 3 / 2 / 8), @1];
+    status = VTSessionSetProperty(_encodeSession, kVTCompressionPropertyKey_DataRateLimits, limits);
+    NSLog(@"CQVideoEncoder-VTSessionSetProperty set DataRateLimits. return status = %d", (int)status);
+}
+
+/// 销毁编码会话
+- (void)destroyEncoderSession {
+    if (self.encodeSession) {
+        VTCompressionSessionCompleteFrames(self.encodeSession, kCMTimeInvalid);
+        VTCompressionSessionInvalidate(self.encodeSession);
+        CFRelease(self.encodeSession);
+        self.encodeSession = NULL;
+    }
+}
+
+#pragma mark - RGB转NV12
+/**
+ 32BGRA/32RGBA转换为编码会话缓冲池里的NV12
+ @return 转换后的buffer(需要释放)，不是RGB、宽高和编码宽高不同或缓冲池不可用时返回NULL，直接把原来的buffer交给VideoToolbox
+ */
+- (CVPixelBufferRef)createYUVPixelBufferWithImageBuffer:(CVImageBufferRef)imageBuffer CF_RETURNS_RETAINED {
+    OSType format = CVPixelBufferGetPixelFormatType(imageBuffer);
+    if (format != kCVPixelFormatType_32BGRA && format != kCVPixelFormatType_32RGBA) return NULL;
+    if (CVPixelBufferGetWidth(imageBuffer) != (size_t)_width || CVPixelBufferGetHeight(imageBuffer) != (size_t)_height) return NULL;
+    CVPixelBufferPoolRef pool = _encodeSession ? VTCompressionSessionGetPixelBufferPool(_encodeSession) : NULL;
+    if (!pool) return NULL;
+    CVPixelBufferRef yuvBuffer = NULL;
+    CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pool, &yuvBuffer);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoEncoder-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+        return NULL;
+    }
+    result = CQPixelBufferConvertRGBToYUV(imageBuffer, yuvBuffer, CQYUVMatrixForSize(_width, _height));
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoEncoder-CQPixelBufferConvertRGBToYUV failed. result = %d", (int)result);
+        CVPixelBufferRelease(yuvBuffer);
+        return NULL;
+    }
+    return yuvBuffer;
+}
+
+#pragma mark - 滤镜链
+/**
+ 经过滤镜链处理，写到编码会话缓冲池里
+ @return 处理后的buffer(需要释放)，缓冲池不可用或处理失败时返回NULL
+ */
+- (CVPixelBufferRef)createFilteredPixelBufferWithImageBuffer:(CVImageBufferRef)imageBuffer CF_RETURNS_RETAINED {
+    CVPixelBufferPoolRef pool = _encodeSession ? VTCompressionSessionGetPixelBufferPool(_encodeSession) : NULL;
+    if (!pool) return NULL;
+    CVPixelBufferRef filteredBuffer = NULL;
+    CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pool, &filteredBuffer);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoEncoder-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+        return NULL;
+    }
+    result = [self.filterGraph processPixelBuffer:imageBuffer toPixelBuffer:filteredBuffer];
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoEncoder-CQVideoFilterGraph process failed. result = %d", (int)result);
+        CVPixelBufferRelease(filteredBuffer);
+        return NULL;
+    }
+    return filteredBuffer;
+}
 
 #pragma mark - 编码完成回调
 // startCode 长度 4
 const Byte startCode[] = "\x00\x00\x00\x01";
 void videoEncoderCallBack(void *outputCallbackRefCon, void *sourceFrameRefCon, OSStatus status, VTEncodeInfoFlags infoFlags, CMSampleBufferRef sampleBuffer) {
+    // 采集时间戳，先取出释放，后面的提前return不用再管
+    CQCaptureTimestamp captureTimestamp = {0};
+    BOOL hasCaptureTimestamp = sourceFrameRefCon != NULL;
+    if (hasCaptureTimestamp) {
+        captureTimestamp = *(CQCaptureTimestamp *)sourceFrameRefCon;
+        free(sourceFrameRefCon);
+    }
     if (status != noErr) {
         // 有错误
         NSLog(@"CQVideoEncoder-VideoEncodeCallback: encode error, status = %d", (int)status);
@@ -151,39 +370,63 @@ void videoEncoderCallBack(void *outputCallbackRefCon, void *sourceFrameRefCon, O
     BOOL isKeyFrame = NO;
     CFArrayRef attachArr = CMSampleBufferGetSampleAttachmentsArray(sampleBuffer, true);
     isKeyFrame = !CFDictionaryContainsKey(CFArrayGetValueAtIndex(attachArr, 0), kCMSampleAttachmentKey_NotSync);
+    // 一帧的所有回调(sps/pps、每个NALU、整帧)一次批量提交到回调strand，只排队一次
+    NSMutableArray<dispatch_block_t> *callbacks = [NSMutableArray array];
     // 获取sps pps数据，只需要获取一次，保存在h264文件头即可
-    if (isKeyFrame && !encoder->_isHasSpsPps) {
-        size_t spsSize, spsCount;
-        size_t ppsSize, ppsCount;
-        const uint8_t *spsData, *ppsData;
+    // 回调在VideoToolbox的线程上，和strand上的请求并发，用交换取走请求，获取失败时放回
+    if (isKeyFrame && atomic_exchange(&encoder->_needsParameterSets, false)) {
+        size_t vpsSize = 0, spsSize, ppsSize, parameterSetCount;
+        const uint8_t *vpsData = NULL, *spsData, *ppsData;
+        OSStatus status0 = noErr, status1, status2;
         // 获取图像源像素格式
         CMFormatDescriptionRef formatDesc = CMSampleBufferGetFormatDescription(sampleBuffer);
-        // 获取sps
-        OSStatus status1 = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(formatDesc, 0, &spsData, &spsSize, &spsCount, 0);
-        // 获取pps
-        OSStatus status2 = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(formatDesc, 1, &ppsData, &ppsSize, &ppsCount, 0);
+        if (encoder.config.codec == CQVideoCodecHEVC) {
+            // HEVC参数集依次为VPS、SPS、PPS
+            status0 = CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(formatDesc, 0, &vpsData, &vpsSize, &parameterSetCount, NULL);
+            status1 = CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(formatDesc, 1, &spsData, &spsSize, &parameterSetCount, NULL);
+            status2 = CMVideoFormatDescriptionGetHEVCParameterSetAtIndex(formatDesc, 2, &ppsData, &ppsSize, &parameterSetCount, NULL);
+        } else {
+            // 获取sps
+            status1 = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(formatDesc, 0, &spsData, &spsSize, &parameterSetCount, 0);
+            // 获取pps
+            status2 = CMVideoFormatDescriptionGetH264ParameterSetAtIndex(formatDesc, 1, &ppsData, &ppsSize, &parameterSetCount, 0);
+        }
         // 判断sps/pps获取成功
-        if (status1 == noErr && status2 == noErr) {
-            encoder->_isHasSpsPps = YES;
+        if (status0 == noErr && status1 == noErr && status2 == noErr) {
             NSLog(@"CQVideoEncoder-videoEncoderCallBack：Get sps、pps success");
             
-            // sps 转NSData
-            NSMutableData *sps = [NSMutableData dataWithCapacity:4 + spsSize];
+            // sps 转NSData，HEVC的VPS放在SPS前面
+            NSMutableData *sps = [NSMutableData dataWithCapacity:8 + vpsSize + spsSize];
+            if (vpsData) {
+                [sps appendBytes:startCode length:4];
+                [sps appendBytes:vpsData length:vpsSize];
+            }
             [sps appendBytes:startCode length:4];// 注意加入起始位
-            [sps appendBytes:spsData length:spsSize];
+            uint8_t rewrittenSps[256];
+            size_t rewrittenSize = 0;
+            if (!vpsData && encoder.rewritesSPSForLowLatency) {
+                CQH264VUIOverride vui = CQH264VUIOverrideMake((uint32_t)encoder.config.fps);
+                rewrittenSize = CQH264SPSRewriteVUI(spsData, spsSize, &vui, rewrittenSps, sizeof(rewrittenSps));
+            }
+            if (rewrittenSize > 0) {
+                [sps appendBytes:rewrittenSps length:rewrittenSize];
+            } else {
+                [sps appendBytes:spsData length:spsSize];
+            }
             // pps 转NSData
             NSMutableData *pps = [NSMutableData dataWithCapacity:4 + ppsSize];
             [pps appendBytes:startCode length:4];// 注意加入起始位
             [pps appendBytes:ppsData length:ppsSize];
             
-            dispatch_async(encoder.callBackQueue, ^{
+            [callbacks addObject:^{
                 // 回调
                 if (encoder.delegate && [encoder.delegate respondsToSelector:@selector(videoEncoder:didEncodeWithSps:pps:)]) {
                     [encoder.delegate videoEncoder:encoder didEncodeWithSps:sps pps:pps];
                 }
-            });
+            }];
         } else {
-            NSLog(@"CQVideoEncoder-videoEncodeCallback： Get sps/pps failed spsStatus=%d, ppsStatus=%d", (int)status1, (int)status2);
+            atomic_store(&encoder->_needsParameterSets, true);
+            NSLog(@"CQVideoEncoder-videoEncodeCallback： Get sps/pps failed vpsStatus=%d, spsStatus=%d, ppsStatus=%d", (int)status0, (int)status1, (int)status2);
         }
     }
     
@@ -204,12 +447,25 @@ void videoEncoderCallBack(void *outputCallbackRefCon, void *sourceFrameRefCon, O
     OSStatus error = CMBlockBufferGetDataPointer(blockBuffer, 0, &lengthAtOffset, &totalLength, &dataPoint);
     if (error != kCMBlockBufferNoErr) {
         NSLog(@"CQVideoEncoder-videoEncodeCallback: get datapoint failed, status = %d", (int)error);
+        [encoder.callbackStrand asyncBatch:callbacks];
         return;
     }
     
     size_t offet = 0;
     // 返回的nalu数据前四个字节不是0001的startcode(不是系统端的0001)，而是大端模式的帧长度length
     const int lengthInfoSize = 4;
+    // 按帧回调时使用
+    NSMutableArray<NSData *> *frameNalus = [NSMutableArray array];
+    // 采集时间戳SEI放在该帧第一个NALU之前
+    if (hasCaptureTimestamp) {
+        NSData *sei = CQTimestampSEICreate(encoder.config.codec, captureTimestamp);
+        [callbacks addObject:^{
+            if (encoder.delegate && [encoder.delegate respondsToSelector:@selector(videoEncoder:didEncodeSuccessWithH264Data:)]) {
+                [encoder.delegate videoEncoder:encoder didEncodeSuccessWithH264Data:sei];
+            }
+        }];
+        [frameNalus addObject:sei];
+    }
     // 循环获取nalu数据 (通过移动下标的方式，循环读取数据)
     while (offet < totalLength - lengthInfoSize) {
         uint32_t naluLength = 0;
@@ -223,30 +479,48 @@ void videoEncoderCallBack(void *outputCallbackRefCon, void *sourceFrameRefCon, O
         [data appendBytes:dataPoint + offet + lengthInfoSize length:naluLength];
         
         // 将NALU数据回调到代理中
-        dispatch_async(encoder.callBackQueue, ^{
+        [callbacks addObject:^{
             if (encoder.delegate && [encoder.delegate respondsToSelector:@selector(videoEncoder:didEncodeSuccessWithH264Data:)]) {
                 [encoder.delegate videoEncoder:encoder didEncodeSuccessWithH264Data:data];
             }
-        });
+        }];
+        
+        [frameNalus addObject:data];
         
         // 移动下标，继续读取下一个数据
         offet += lengthInfoSize + naluLength;
     }
+    
+    // 统计非参考帧，开启分层P一个GOP后还没有非参考帧说明编码器不支持
+    uint64_t encodedFrameCount = atomic_fetch_add_explicit(&encoder->_encodedFrameCount, 1, memory_order_relaxed) + 1;
+    if (CQFrameInfoIsDroppable(CQFrameClassifyNalus(encoder.config.codec, frameNalus))) {
+        atomic_fetch_add_explicit(&encoder->_nonReferenceFrameCount, 1, memory_order_relaxed);
+    }
+    if (encoder.config.temporalLayerCount > 1 && encodedFrameCount == (uint64_t)encoder.config.fps * 2
+        && atomic_load_explicit(&encoder->_nonReferenceFrameCount, memory_order_relaxed) == 0) {
+        NSLog(@"CQVideoEncoder-temporal layers requested but encoder outputs no non-reference frame");
+    }
+    
+    // 按帧回调，携带时间戳
+    CMTime pts = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+    CMTime dts = CMSampleBufferGetDecodeTimeStamp(sampleBuffer);
+    if (CMTIME_IS_INVALID(dts)) dts = pts;
+    [callbacks addObject:^{
+        if (encoder.delegate && [encoder.delegate respondsToSelector:@selector(videoEncoder:didEncodeFrameWithNalus:pts:dts:isKeyFrame:)]) {
+            [encoder.delegate videoEncoder:encoder didEncodeFrameWithNalus:frameNalus pts:pts dts:dts isKeyFrame:isKeyFrame];
+        }
+    }];
+    [encoder.callbackStrand asyncBatch:callbacks];
 }
 
-#pragma mark - Lazy Load
-- (dispatch_queue_t)encodeQueue {
-    if (!_encodeQueue) {
-        _encodeQueue = dispatch_queue_create("CQVideoEncoder encode queue", DISPATCH_QUEUE_SERIAL);
-    }
-    return _encodeQueue;
+#pragma mark - Getter
+// 只是统计值，不和其他状态同步，relaxed即可
+- (uint64_t)encodedFrameCount {
+    return atomic_load_explicit(&_encodedFrameCount, memory_order_relaxed);
 }
 
-- (dispatch_queue_t)callBackQueue {
-    if (!_callBackQueue) {
-        _callBackQueue = dispatch_queue_create("CQVideoEncoder callBack queue", DISPATCH_QUEUE_SERIAL);
-    }
-    return _callBackQueue;
+- (uint64_t)nonReferenceFrameCount {
+    return atomic_load_explicit(&_nonReferenceFrameCount, memory_order_relaxed);
 }
 
 @end
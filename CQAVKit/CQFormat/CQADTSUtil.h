@@ -0,0 +1,54 @@
+//
+//  CQADTSUtil.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ AAC ADTS头工具
+ @discussion ADTS头7字节(有CRC时9字节)，写AAC文件、TS封装都需要每一帧带ADTS头
+ See: http://wiki.multimedia.cx/index.php?title=ADTS
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+static const size_t CQADTSHeaderSize = 7;  ///< 不带CRC的ADTS头长度
+
+/**
+ 采样率转ADTS采样率索引
+ @param sampleRate 采样率，例如44100
+ @return 索引，3：48000 Hz、4：44.1KHz、8: 16000 Hz、11: 8000 Hz，不支持的采样率返回-1
+ */
+FOUNDATION_EXPORT int CQADTSSampleRateIndex(NSInteger sampleRate);
+
+/**
+ ADTS采样率索引转采样率
+ @return 采样率，索引非法返回0
+ */
+FOUNDATION_EXPORT NSInteger CQADTSSampleRateForIndex(int index);
+
+/**
+ 写入7字节ADTS头(AAC LC，无CRC)
+ @param header 输出，至少7字节
+ @param sampleRate 采样率
+ @param channelCount 声道数
+ @param rawLength 不含ADTS头的AAC数据长度
+ */
+FOUNDATION_EXPORT void CQADTSWriteHeader(uint8_t *header, NSInteger sampleRate, NSInteger channelCount, size_t rawLength);
+
+/**
+ 判断数据是否以ADTS头开始
+ @return ADTS头长度(7或9)，不是ADTS返回0
+ */
+FOUNDATION_EXPORT size_t CQADTSHeaderLength(const uint8_t *data, size_t size);
+
+/**
+ 读取ADTS帧长度(包含ADTS头)
+ @param data 以ADTS头开始的数据，至少7字节
+ */
+FOUNDATION_EXPORT size_t CQADTSFrameLength(const uint8_t *data);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,48 @@
+//
+//  CQADTSUtil.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQADTSUtil.h"
+
+static const NSInteger kADTSSampleRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350};
+
+int CQADTSSampleRateIndex(NSInteger sampleRate) {
+    for (int i = 0; i < (int)(sizeof(kADTSSampleRates) / sizeof(kADTSSampleRates[0])); i++) {
+        if (kADTSSampleRates[i] == sampleRate) return i;
+    }
+    return -1;
+}
+
+NSInteger CQADTSSampleRateForIndex(int index) {
+    if (index < 0 || index >= (int)(sizeof(kADTSSampleRates) / sizeof(kADTSSampleRates[0]))) return 0;
+    return kADTSSampleRates[index];
+}
+
+void CQADTSWriteHeader(uint8_t *header, NSInteger sampleRate, NSInteger channelCount, size_t rawLength) {
+    int profile = 2;  // AAC LC
+    int freqIdx = CQADTSSampleRateIndex(sampleRate);
+    if (freqIdx < 0) freqIdx = 4;
+    int chanCfg = (int)channelCount;  // MPEG-4 Audio Channel Configuration
+    size_t fullLength = CQADTSHeaderSize + rawLength;
+    header[0] = 0xFF;  // 11111111 = syncword
+    header[1] = 0xF1;  // 1111 0 00 1 = syncword MPEG-4 Layer 无CRC
+    header[2] = (uint8_t)(((profile - 1) << 6) + (freqIdx << 2) + (chanCfg >> 2));
+    header[3] = (uint8_t)(((chanCfg & 3) << 6) + (fullLength >> 11));
+    header[4] = (uint8_t)((fullLength & 0x7FF) >> 3);
+    header[5] = (uint8_t)(((fullLength & 7) << 5) + 0x1F);
+    header[6] = 0xFC;
+}
+
+size_t CQADTSHeaderLength(const uint8_t *data, size_t size) {
+    if (size < CQADTSHeaderSize) return 0;
+    if (data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) return 0;
+    // protection_absent为0时带2字节CRC
+    return (data[1] & 0x01) ? 7 : 9;
+}
+
+size_t CQADTSFrameLength(const uint8_t *data) {
+    return ((size_t)(data[3] & 0x03) << 11) | ((size_t)data[4] << 3) | ((size_t)(data[5] & 0xE0) >> 5);
+}
@@ -0,0 +1,76 @@
+//
+//  CQBitReader.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ RBSP位读取
+ @discussion 片头、SPS等语法按位排列，定长字段用u(n)，变长字段用指数哥伦布编码ue(v)/se(v)
+ 数据应已去掉防竞争字节(CQNaluRemoveEmulationPrevention)，越界后读出的位按0处理并置isOverflow
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t bitOffset;  ///< 下一个要读的位
+    BOOL isOverflow;  ///< 读过了数据末尾，之后的结果都无效
+} CQBitReader;
+
+static inline CQBitReader CQBitReaderMake(const uint8_t *data, size_t size) {
+    return (CQBitReader){data, size, 0, NO};
+}
+
+/// 读1位
+static inline uint32_t CQBitReaderReadBit(CQBitReader *reader) {
+    size_t byte = reader->bitOffset >> 3;
+    if (byte >= reader->size) {
+        reader->isOverflow = YES;
+        return 0;
+    }
+    uint32_t bit = (reader->data[byte] >> (7 - (reader->bitOffset & 7))) & 0x01;
+    reader->bitOffset++;
+    return bit;
+}
+
+/// 读n位(n <= 32)，u(n)
+static inline uint32_t CQBitReaderReadBits(CQBitReader *reader, int n) {
+    uint32_t value = 0;
+    for (int i = 0; i < n; i++) {
+        value = (value << 1) | CQBitReaderReadBit(reader);
+    }
+    return value;
+}
+
+/// 跳过n位
+static inline void CQBitReaderSkipBits(CQBitReader *reader, size_t n) {
+    reader->bitOffset += n;
+    if (reader->bitOffset > reader->size * 8) reader->isOverflow = YES;
+}
+
+/// 无符号指数哥伦布 ue(v): 前导0的个数leadingZeros，值为 2^leadingZeros - 1 + 后面leadingZeros位
+static inline uint32_t CQBitReaderReadUE(CQBitReader *reader) {
+    int leadingZeros = 0;
+    while (CQBitReaderReadBit(reader) == 0) {
+        // 合法的码流里ue(v)不超过32位，超过说明数据错误
+        if (reader->isOverflow || ++leadingZeros > 31) {
+            reader->isOverflow = YES;
+            return 0;
+        }
+    }
+    if (leadingZeros == 0) return 0;
+    return (uint32_t)((1ull << leadingZeros) - 1) + CQBitReaderReadBits(reader, leadingZeros);
+}
+
+/// 有符号指数哥伦布 se(v): ue依次映射为 0, 1, -1, 2, -2 ...
+static inline int32_t CQBitReaderReadSE(CQBitReader *reader) {
+    uint32_t value = CQBitReaderReadUE(reader);
+    return (value & 0x01) ? (int32_t)((value + 1) / 2) : -(int32_t)(value / 2);
+}
+
+NS_ASSUME_NONNULL_END
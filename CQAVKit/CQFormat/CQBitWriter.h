@@ -0,0 +1,91 @@
+//
+//  CQBitWriter.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQBitReader.h"
+
+/**
+ RBSP位写入，CQBitReader的逆过程
+ @discussion 写出的是RBSP，作为NALU输出前要加防竞争字节(CQNaluAddEmulationPrevention)
+ 超出容量后不再写入并置isOverflow
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct {
+    uint8_t *data;
+    size_t capacity;
+    size_t bitOffset;  ///< 下一个要写的位
+    BOOL isOverflow;  ///< 写过了容量末尾，输出无效
+} CQBitWriter;
+
+static inline CQBitWriter CQBitWriterMake(uint8_t *data, size_t capacity) {
+    return (CQBitWriter){data, capacity, 0, NO};
+}
+
+/// 已写入的字节数(不足一个字节的按一个字节算)
+static inline size_t CQBitWriterByteSize(const CQBitWriter *writer) {
+    return (writer->bitOffset + 7) >> 3;
+}
+
+/// 写1位
+static inline void CQBitWriterWriteBit(CQBitWriter *writer, uint32_t bit) {
+    size_t byte = writer->bitOffset >> 3;
+    if (byte >= writer->capacity) {
+        writer->isOverflow = YES;
+        return;
+    }
+    uint8_t mask = (uint8_t)(0x80 >> (writer->bitOffset & 7));
+    writer->data[byte] = bit ? (writer->data[byte] | mask) : (writer->data[byte] & ~mask);
+    writer->bitOffset++;
+}
+
+/// 写n位(n <= 32)，u(n)
+static inline void CQBitWriterWriteBits(CQBitWriter *writer, uint32_t value, int n) {
+    for (int i = n - 1; i >= 0; i--) {
+        CQBitWriterWriteBit(writer, (value >> i) & 0x01);
+    }
+}
+
+/// 无符号指数哥伦布 ue(v): value + 1的位数为n时，先写n - 1个0，再写value + 1
+static inline void CQBitWriterWriteUE(CQBitWriter *writer, uint32_t value) {
+    uint64_t codeNum = (uint64_t)value + 1;
+    int bits = 0;
+    while ((codeNum >> bits) > 1) bits++;
+    CQBitWriterWriteBits(writer, 0, bits);
+    if (bits == 32) {
+        // value为UINT32_MAX时value + 1有33位
+        CQBitWriterWriteBit(writer, 1);
+        CQBitWriterWriteBits(writer, (uint32_t)codeNum, 32);
+    } else {
+        CQBitWriterWriteBits(writer, (uint32_t)codeNum, bits + 1);
+    }
+}
+
+/// 有符号指数哥伦布 se(v): 0, 1, -1, 2, -2 ... 依次映射为ue的0, 1, 2, 3, 4 ...
+static inline void CQBitWriterWriteSE(CQBitWriter *writer, int32_t value) {
+    CQBitWriterWriteUE(writer, value > 0 ? (uint32_t)value * 2 - 1 : (uint32_t)(-(int64_t)value) * 2);
+}
+
+/// 从reader拷贝n位
+static inline void CQBitWriterCopyBits(CQBitWriter *writer, CQBitReader *reader, size_t n) {
+    while (n > 0) {
+        int chunk = (int)MIN(n, (size_t)32);
+        CQBitWriterWriteBits(writer, CQBitReaderReadBits(reader, chunk), chunk);
+        n -= chunk;
+    }
+}
+
+/// rbsp_trailing_bits: 停止位1，再补0到字节对齐
+static inline void CQBitWriterWriteTrailingBits(CQBitWriter *writer) {
+    CQBitWriterWriteBit(writer, 1);
+    while (writer->bitOffset & 7) {
+        CQBitWriterWriteBit(writer, 0);
+    }
+}
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,100 @@
+//
+//  CQFrameClassifier.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQNaluUtil.h"
+
+/**
+ H264/HEVC帧分类
+ @discussion 根据片的nal_unit_type、nal_ref_idc和片头的slice_type判断一帧能不能安全丢弃:
+ 非参考帧(所有片的nal_ref_idc都为0)不会被其它帧引用，丢掉只少显示这一帧，后面的帧照常解码，
+ 参考帧丢掉后直到下一个IDR都会花屏，只能整个GOP一起丢
+ HEVC没有nal_ref_idc，非参考帧是子层非参考类型(TRAIL_N等)，编码器只把最高时域层的帧标成这种类型，关键帧为IRAP
+ 分层P编码(CQVideoCoderConfig.temporalLayerCount为2)时每隔一帧是非参考帧，丢掉时域层1正好帧率减半
+ 转发(CQStreamFanout)、解码输入(CQVideoDecoder)、文件读取(CQRawStreamReader)都用它来决定丢哪些帧
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 帧类别，数值越大越重要
+typedef NS_ENUM(uint8_t, CQFrameClass) {
+    CQFrameClassUnknown = 0,  ///< 没有图像NALU(只有sps/pps/SEI等)
+    CQFrameClassNonReference = 1,  ///< 非参考帧，可以丢弃
+    CQFrameClassReference = 2,  ///< 参考帧(P/I)，丢弃后直到下一个IDR都无法正确解码
+    CQFrameClassIDR = 3,  ///< IDR，从这一帧开始可以独立解码
+};
+
+/// 片类型(H264的slice_type % 5，HEVC的B/P/I映射到同名的值)
+typedef NS_ENUM(uint8_t, CQH264SliceType) {
+    CQH264SliceTypeP = 0,
+    CQH264SliceTypeB = 1,
+    CQH264SliceTypeI = 2,
+    CQH264SliceTypeSP = 3,
+    CQH264SliceTypeSI = 4,
+    CQH264SliceTypeUnknown = 0xFF,  ///< 片头损坏或太短
+};
+
+/// 帧信息
+typedef struct {
+    CQFrameClass frameClass;  ///< 帧类别
+    uint8_t nalRefIdc;  ///< 所有片中最大的nal_ref_idc，HEVC参考帧为1
+    CQH264SliceType sliceType;  ///< 第一个片的类型
+    uint8_t temporalLayer;  ///< 时域层，H264参考帧为0、非参考帧为1，HEVC为最大的TemporalId
+    uint16_t sliceCount;  ///< 图像NALU(片)的个数
+} CQFrameInfo;
+
+/// 是否可以丢弃而不影响其它帧的解码
+static inline BOOL CQFrameInfoIsDroppable(CQFrameInfo info) {
+    return info.frameClass == CQFrameClassNonReference;
+}
+
+/**
+ 解析片头的first_mb_in_slice和slice_type
+ @param nalu 图像NALU(类型1或5，不含起始码，含NALU头)
+ @param size 长度
+ @param firstMbInSlice 输出，可以为NULL，为0时是一帧的第一个片
+ @param sliceType 输出，可以为NULL
+ @return 片头完整返回YES
+ */
+FOUNDATION_EXPORT BOOL CQH264SliceHeaderParse(const uint8_t *nalu, size_t size, uint32_t * _Nullable firstMbInSlice, CQH264SliceType * _Nullable sliceType);
+
+/**
+ 解析HEVC片头的slice_type
+ @discussion 只解析一帧的第一个片，假定PPS的num_extra_slice_header_bits为0(VideoToolbox/x265的默认值)
+ @param nalu 图像NALU(不含起始码，含2字节NALU头)
+ @return 片头完整时返回类型，否则返回CQH264SliceTypeUnknown
+ */
+FOUNDATION_EXPORT CQH264SliceType CQHEVCSliceTypeParse(const uint8_t *nalu, size_t size);
+
+/**
+ 对一帧Annex-B数据分类
+ @param codec 编码格式
+ @param data 一帧的所有NALU(可以带sps/pps/SEI)，或单个NALU
+ @param size 长度
+ */
+FOUNDATION_EXPORT CQFrameInfo CQFrameClassifyAnnexB(CQVideoCodec codec, const uint8_t *data, size_t size);
+
+/**
+ 对一帧AVCC数据分类
+ @param data 4字节大端长度 + NALU，MP4/FLV里的sample格式
+ @param size 长度
+ */
+FOUNDATION_EXPORT CQFrameInfo CQFrameClassifyAVCC(CQVideoCodec codec, const uint8_t *data, size_t size);
+
+/**
+ 对单个NALU分类，Annex-B数据逐个NALU处理时使用，不需要拼起始码或长度
+ @param nalu 不含起始码
+ */
+FOUNDATION_EXPORT CQFrameInfo CQFrameClassifyNalu(CQVideoCodec codec, const uint8_t *nalu, size_t size);
+
+/**
+ 对编码器回调的一帧分类
+ @param nalus CQVideoEncoder的videoEncoder:didEncodeFrameWithNalus:...回调的NALU数组，每个都带起始码
+ */
+FOUNDATION_EXPORT CQFrameInfo CQFrameClassifyNalus(CQVideoCodec codec, NSArray<NSData *> *nalus);
+
+NS_ASSUME_NONNULL_END
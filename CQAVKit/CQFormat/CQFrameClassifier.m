@@ -0,0 +1,131 @@
+//
+//  CQFrameClassifier.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 遍历一帧的NALU，只看图像NALU(类型1和5)，sps/pps/SEI/AUD不影响分类
+ 2 nal_ref_idc取所有片的最大值，有一个片被参考整帧就是参考帧；有IDR片就是IDR
+ 3 slice_type只解析第一个片: 片头开头是first_mb_in_slice ue(v)和slice_type ue(v)，只需要前几个字节，
+   拷贝到栈上去掉防竞争字节后用CQBitReader读取，不需要处理整个NALU
+ 4 HEVC: IRAP为关键帧，子层非参考类型为非参考帧；片头开头是first_slice_segment_in_pic_flag、(IRAP)no_output_of_prior_pics_flag、
+   slice_pic_parameter_set_id ue(v)，第一个片没有dependent_slice_segment_flag，接着是slice_type ue(v)
+ */
+
+#import "CQFrameClassifier.h"
+#import "CQBitReader.h"
+
+#define kSliceHeaderPrefixSize 16  ///< 解析slice_type需要的最多字节数(NALU头 + 两个ue(v)，留出防竞争字节的余量)
+
+BOOL CQH264SliceHeaderParse(const uint8_t *nalu, size_t size, uint32_t *firstMbInSlice, CQH264SliceType *sliceType) {
+    if (size < 2) return NO;
+    uint8_t rbsp[kSliceHeaderPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu + 1, MIN(size - 1, (size_t)kSliceHeaderPrefixSize), rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    uint32_t firstMb = CQBitReaderReadUE(&reader);
+    uint32_t type = CQBitReaderReadUE(&reader);
+    // slice_type为5~9时表示这一帧所有片都是同一类型，取模后一样
+    if (reader.isOverflow || type > 9) return NO;
+    if (firstMbInSlice) *firstMbInSlice = firstMb;
+    if (sliceType) *sliceType = (CQH264SliceType)(type % 5);
+    return YES;
+}
+
+CQH264SliceType CQHEVCSliceTypeParse(const uint8_t *nalu, size_t size) {
+    if (size < 3) return CQH264SliceTypeUnknown;
+    uint8_t rbsp[kSliceHeaderPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu + 2, MIN(size - 2, (size_t)kSliceHeaderPrefixSize), rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    // 只有第一个片可以不知道PPS就解析到slice_type
+    if (!CQBitReaderReadBit(&reader)) return CQH264SliceTypeUnknown;
+    if (CQHEVCNaluTypeIsIRAP(CQHEVCNaluTypeOf(nalu))) CQBitReaderSkipBits(&reader, 1);
+    CQBitReaderReadUE(&reader);  // slice_pic_parameter_set_id
+    uint32_t type = CQBitReaderReadUE(&reader);
+    if (reader.isOverflow) return CQH264SliceTypeUnknown;
+    // HEVC: 0为B，1为P，2为I
+    static const CQH264SliceType kHEVCSliceTypes[] = {CQH264SliceTypeB, CQH264SliceTypeP, CQH264SliceTypeI};
+    return type < 3 ? kHEVCSliceTypes[type] : CQH264SliceTypeUnknown;
+}
+
+static inline CQFrameInfo CQFrameInfoMake(void) {
+    return (CQFrameInfo){CQFrameClassUnknown, 0, CQH264SliceTypeUnknown, 0, 0};
+}
+
+/// 累计一个HEVC NALU
+static void CQFrameInfoAddHEVCNalu(CQFrameInfo *info, const uint8_t *nalu, size_t size) {
+    CQHEVCNaluType type = CQHEVCNaluTypeOf(nalu);
+    if (size < 3 || type > CQHEVCNaluTypeCRA) return;
+    if (info->sliceCount == 0) {
+        info->sliceType = CQHEVCSliceTypeParse(nalu, size);
+    }
+    info->sliceCount++;
+    info->temporalLayer = MAX(info->temporalLayer, CQHEVCTemporalIdOf(nalu));
+    CQFrameClass frameClass = CQFrameClassReference;
+    if (CQHEVCNaluTypeIsIRAP(type)) {
+        frameClass = CQFrameClassIDR;
+    } else if (CQHEVCNaluTypeIsSubLayerNonReference(type)) {
+        frameClass = CQFrameClassNonReference;
+    }
+    if (frameClass != CQFrameClassNonReference) info->nalRefIdc = 1;
+    // 只有所有片都是非参考类型时整帧才是非参考帧
+    info->frameClass = (info->sliceCount == 1) ? frameClass : MAX(info->frameClass, frameClass);
+}
+
+/// 累计一个NALU
+static void CQFrameInfoAddNalu(CQFrameInfo *info, CQVideoCodec codec, const uint8_t *nalu, size_t size) {
+    if (size == 0) return;
+    if (codec == CQVideoCodecHEVC) {
+        CQFrameInfoAddHEVCNalu(info, nalu, size);
+        return;
+    }
+    CQH264NaluType type = CQH264NaluTypeOf(nalu);
+    if (type != CQH264NaluTypeSlice && type != CQH264NaluTypeIDR) return;
+    if (info->sliceCount == 0) {
+        CQH264SliceHeaderParse(nalu, size, NULL, &info->sliceType);
+    }
+    info->sliceCount++;
+    info->nalRefIdc = MAX(info->nalRefIdc, CQH264NalRefIdcOf(nalu));
+    CQFrameClass frameClass = type == CQH264NaluTypeIDR ? CQFrameClassIDR : (info->nalRefIdc ? CQFrameClassReference : CQFrameClassNonReference);
+    info->frameClass = MAX(info->frameClass, frameClass);
+    info->temporalLayer = info->frameClass == CQFrameClassNonReference ? 1 : 0;
+}
+
+CQFrameInfo CQFrameClassifyAnnexB(CQVideoCodec codec, const uint8_t *data, size_t size) {
+    __block CQFrameInfo info = CQFrameInfoMake();
+    CQNaluEnumerateAnnexB(data, size, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        CQFrameInfoAddNalu(&info, codec, nalu, naluSize);
+    });
+    return info;
+}
+
+CQFrameInfo CQFrameClassifyAVCC(CQVideoCodec codec, const uint8_t *data, size_t size) {
+    CQFrameInfo info = CQFrameInfoMake();
+    size_t offset = 0;
+    while (offset + 4 < size) {
+        uint32_t naluSize = ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) | ((uint32_t)data[offset + 2] << 8) | data[offset + 3];
+        offset += 4;
+        if (naluSize > size - offset) break;
+        CQFrameInfoAddNalu(&info, codec, data + offset, naluSize);
+        offset += naluSize;
+    }
+    return info;
+}
+
+CQFrameInfo CQFrameClassifyNalu(CQVideoCodec codec, const uint8_t *nalu, size_t size) {
+    CQFrameInfo info = CQFrameInfoMake();
+    CQFrameInfoAddNalu(&info, codec, nalu, size);
+    return info;
+}
+
+CQFrameInfo CQFrameClassifyNalus(CQVideoCodec codec, NSArray<NSData *> *nalus) {
+    CQFrameInfo info = CQFrameInfoMake();
+    for (NSData *annexB in nalus) {
+        size_t naluSize = 0;
+        const uint8_t *nalu = CQNaluSkipStartCode(annexB.bytes, annexB.length, &naluSize);
+        if (nalu) CQFrameInfoAddNalu(&info, codec, nalu, naluSize);
+    }
+    return info;
+}
@@ -0,0 +1,91 @@
+//
+//  CQH264ParameterSets.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ H264参数集
+ @discussion 片头的frame_num长度由SPS的log2_max_frame_num决定，解码端检查frame_num连续性(CQReferenceTracker)需要先解析SPS
+ VideoToolbox输出的SPS通常没有VUI的bitstream_restriction，接收端(浏览器、硬件解码器)只能按level推算最大的重排序帧数，
+ 会缓存几帧再显示，CQH264SPSRewriteVUI在发出前补上max_num_reorder_frames = 0
+ 纯C实现，不依赖VideoToolbox
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// SPS信息
+typedef struct {
+    uint8_t profileIdc;  ///< 66为Baseline，77为Main，100为High
+    uint8_t constraintFlags;  ///< constraint_set0~5_flag
+    uint8_t levelIdc;  ///< level * 10，例如3.1为31
+    uint32_t spsId;
+    uint32_t chromaFormatIdc;  ///< 1为4:2:0，非High系列profile没有这个字段，为1
+    BOOL separateColourPlaneFlag;
+    uint8_t log2MaxFrameNum;  ///< frame_num的位数，4~16
+    uint32_t picOrderCntType;
+    uint32_t maxNumRefFrames;
+    BOOL gapsInFrameNumAllowedFlag;  ///< 为1时frame_num允许跳跃(编码器主动跳过)，不能据此判断丢帧
+    BOOL frameMbsOnlyFlag;
+    uint32_t width;  ///< 裁剪后的宽
+    uint32_t height;  ///< 裁剪后的高
+    BOOL vuiParametersPresentFlag;  ///< 有VUI，VUI不完整时为NO
+    BOOL timingInfoPresentFlag;
+    uint32_t numUnitsInTick;  ///< 帧率 = timeScale / (2 * numUnitsInTick)
+    uint32_t timeScale;
+    BOOL fixedFrameRateFlag;
+    BOOL bitstreamRestrictionFlag;
+    uint32_t maxNumReorderFrames;  ///< 没有bitstream_restriction时为0
+    uint32_t maxDecFrameBuffering;
+} CQH264SPSInfo;
+
+/// VUI改写参数
+typedef struct {
+    uint32_t numUnitsInTick;  ///< 为0时保留原来的timing_info
+    uint32_t timeScale;
+    BOOL fixedFrameRateFlag;
+    uint32_t maxNumReorderFrames;  ///< 没有B帧时为0，解码器解码一帧立即输出
+} CQH264VUIOverride;
+
+/// 按帧率生成改写参数: 没有B帧，帧率不固定(实时编码会丢帧)
+static inline CQH264VUIOverride CQH264VUIOverrideMake(uint32_t fps) {
+    return (CQH264VUIOverride){1, fps * 2, NO, 0};
+}
+
+/**
+ 解析SPS
+ @param nalu SPS NALU(不含起始码，含NALU头)
+ @param size 长度
+ @param info 输出
+ @return 成功返回YES
+ */
+FOUNDATION_EXPORT BOOL CQH264SPSParse(const uint8_t *nalu, size_t size, CQH264SPSInfo *info);
+
+/**
+ 解析片头的frame_num
+ @param nalu 图像NALU(类型1或5，不含起始码，含NALU头)
+ @param size 长度
+ @param sps 片引用的SPS
+ @param frameNum 输出
+ @return 片头完整返回YES
+ */
+FOUNDATION_EXPORT BOOL CQH264SliceFrameNumParse(const uint8_t *nalu, size_t size, const CQH264SPSInfo *sps, uint32_t *frameNum);
+
+/**
+ 改写SPS的VUI
+ @discussion 原来的VUI字段(宽高比、色彩、HRD等)原样保留，timing_info按vui改写，bitstream_restriction改为
+ max_num_reorder_frames = vui.maxNumReorderFrames，max_dec_frame_buffering取允许的最小值(max_num_ref_frames)，
+ 没有VUI时补一个只有这两部分的VUI，重新加防竞争字节
+ @param nalu SPS NALU(不含起始码，含NALU头)
+ @param size 长度
+ @param vui 改写参数
+ @param output 输出NALU(不含起始码)
+ @param capacity 输出容量，size + 64足够
+ @return 输出长度，解析失败或容量不足返回0(调用方应继续使用原来的SPS)
+ */
+FOUNDATION_EXPORT size_t CQH264SPSRewriteVUI(const uint8_t *nalu, size_t size, const CQH264VUIOverride *vui, uint8_t *output, size_t capacity);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,288 @@
+//
+//  CQH264ParameterSets.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 SPS依次是: profile/level、SPS id、(High系列)色度格式/位深/缩放矩阵、log2_max_frame_num、POC类型、参考帧数、
+   gaps_in_frame_num_value_allowed_flag、宽高、裁剪窗口，之后是VUI
+ 2 缩放矩阵、HRD参数不需要保存，按语法逐项跳过
+ 3 片头开头是first_mb_in_slice、slice_type、pic_parameter_set_id三个ue(v)，(分离色度平面时)colour_plane_id，接着是frame_num
+ 4 改写VUI: 解析时记下timing_info和bitstream_restriction的位置，其余部分按位原样拷贝，只重写这两段，
+   SPS到VUI之前的部分同样按位拷贝，不需要重新编码
+ */
+
+#import "CQH264ParameterSets.h"
+#import "CQNaluUtil.h"
+#import "CQBitReader.h"
+#import "CQBitWriter.h"
+
+#define kSPSPrefixSize 256  ///< 解析需要的最多字节数(带缩放矩阵的SPS也在这个范围内)
+#define kSPSRewriteExtraSize 64  ///< 改写后RBSP最多增加的字节数(timing_info 9字节 + bitstream_restriction最多约30字节)
+#define kSliceHeaderPrefixSize 16  ///< 解析frame_num需要的最多字节数
+
+/// 有chroma_format_idc等字段的profile(High系列)
+static BOOL CQH264ProfileHasChromaInfo(uint8_t profileIdc) {
+    switch (profileIdc) {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+/// 跳过一个缩放列表
+static void CQH264SkipScalingList(CQBitReader *reader, int size) {
+    int32_t lastScale = 8;
+    int32_t nextScale = 8;
+    for (int i = 0; i < size && !reader->isOverflow; i++) {
+        if (nextScale != 0) {
+            nextScale = (lastScale + CQBitReaderReadSE(reader) + 256) % 256;
+        }
+        lastScale = nextScale == 0 ? lastScale : nextScale;
+    }
+}
+
+/// 跳过hrd_parameters()
+static void CQH264SkipHRDParameters(CQBitReader *reader) {
+    uint32_t cpbCount = CQBitReaderReadUE(reader) + 1;
+    CQBitReaderSkipBits(reader, 8);  // bit_rate_scale, cpb_size_scale
+    for (uint32_t i = 0; i < cpbCount && !reader->isOverflow; i++) {
+        CQBitReaderReadUE(reader);  // bit_rate_value_minus1
+        CQBitReaderReadUE(reader);  // cpb_size_value_minus1
+        CQBitReaderSkipBits(reader, 1);  // cbr_flag
+    }
+    // initial_cpb_removal_delay_length_minus1, cpb_removal_delay_length_minus1, dpb_output_delay_length_minus1, time_offset_length
+    CQBitReaderSkipBits(reader, 20);
+}
+
+/// VUI中要改写的两段的位置
+typedef struct {
+    size_t timingInfoOffset;  ///< timing_info_present_flag
+    size_t hrdOffset;  ///< timing_info之后，nal_hrd_parameters_present_flag
+    size_t bitstreamRestrictionOffset;  ///< bitstream_restriction_flag
+} CQH264VUILayout;
+
+/// 解析vui_parameters()
+static BOOL CQH264ParseVUI(CQBitReader *reader, CQH264SPSInfo *info, CQH264VUILayout *layout) {
+    if (CQBitReaderReadBit(reader)) {
+        // aspect_ratio_idc为255(Extended_SAR)时带sar_width、sar_height
+        if (CQBitReaderReadBits(reader, 8) == 255) CQBitReaderSkipBits(reader, 32);
+    }
+    if (CQBitReaderReadBit(reader)) CQBitReaderSkipBits(reader, 1);  // overscan_appropriate_flag
+    if (CQBitReaderReadBit(reader)) {
+        CQBitReaderSkipBits(reader, 4);  // video_format, video_full_range_flag
+        if (CQBitReaderReadBit(reader)) CQBitReaderSkipBits(reader, 24);  // colour_primaries, transfer_characteristics, matrix_coefficients
+    }
+    if (CQBitReaderReadBit(reader)) {
+        CQBitReaderReadUE(reader);  // chroma_sample_loc_type_top_field
+        CQBitReaderReadUE(reader);  // chroma_sample_loc_type_bottom_field
+    }
+    layout->timingInfoOffset = reader->bitOffset;
+    info->timingInfoPresentFlag = CQBitReaderReadBit(reader);
+    if (info->timingInfoPresentFlag) {
+        info->numUnitsInTick = CQBitReaderReadBits(reader, 32);
+        info->timeScale = CQBitReaderReadBits(reader, 32);
+        info->fixedFrameRateFlag = CQBitReaderReadBit(reader);
+    }
+    layout->hrdOffset = reader->bitOffset;
+    BOOL nalHRD = CQBitReaderReadBit(reader);
+    if (nalHRD) CQH264SkipHRDParameters(reader);
+    BOOL vclHRD = CQBitReaderReadBit(reader);
+    if (vclHRD) CQH264SkipHRDParameters(reader);
+    if (nalHRD || vclHRD) CQBitReaderSkipBits(reader, 1);  // low_delay_hrd_flag
+    CQBitReaderSkipBits(reader, 1);  // pic_struct_present_flag
+    layout->bitstreamRestrictionOffset = reader->bitOffset;
+    info->bitstreamRestrictionFlag = CQBitReaderReadBit(reader);
+    if (info->bitstreamRestrictionFlag) {
+        CQBitReaderSkipBits(reader, 1);  // motion_vectors_over_pic_boundaries_flag
+        CQBitReaderReadUE(reader);  // max_bytes_per_pic_denom
+        CQBitReaderReadUE(reader);  // max_bits_per_mb_denom
+        CQBitReaderReadUE(reader);  // log2_max_mv_length_horizontal
+        CQBitReaderReadUE(reader);  // log2_max_mv_length_vertical
+        info->maxNumReorderFrames = CQBitReaderReadUE(reader);
+        info->maxDecFrameBuffering = CQBitReaderReadUE(reader);
+    }
+    return !reader->isOverflow;
+}
+
+/// 解析RBSP(不含NALU头)，返回时reader停在vui_parameters_present_flag
+static BOOL CQH264ParseSPSBeforeVUI(CQBitReader *reader, CQH264SPSInfo *info) {
+    CQH264SPSInfo result = {0};
+    result.profileIdc = CQBitReaderReadBits(reader, 8);
+    result.constraintFlags = CQBitReaderReadBits(reader, 8);
+    result.levelIdc = CQBitReaderReadBits(reader, 8);
+    result.spsId = CQBitReaderReadUE(reader);
+    result.chromaFormatIdc = 1;
+    if (CQH264ProfileHasChromaInfo(result.profileIdc)) {
+        result.chromaFormatIdc = CQBitReaderReadUE(reader);
+        if (result.chromaFormatIdc == 3) result.separateColourPlaneFlag = CQBitReaderReadBit(reader);
+        CQBitReaderReadUE(reader);  // bit_depth_luma_minus8
+        CQBitReaderReadUE(reader);  // bit_depth_chroma_minus8
+        CQBitReaderSkipBits(reader, 1);  // qpprime_y_zero_transform_bypass_flag
+        if (CQBitReaderReadBit(reader)) {
+            // seq_scaling_matrix_present_flag: 6个4x4 + 2个(4:4:4时6个)8x8
+            int listCount = result.chromaFormatIdc != 3 ? 8 : 12;
+            for (int i = 0; i < listCount; i++) {
+                if (CQBitReaderReadBit(reader)) CQH264SkipScalingList(reader, i < 6 ? 16 : 64);
+            }
+        }
+    }
+    uint32_t log2MaxFrameNumMinus4 = CQBitReaderReadUE(reader);
+    result.picOrderCntType = CQBitReaderReadUE(reader);
+    if (result.picOrderCntType == 0) {
+        CQBitReaderReadUE(reader);  // log2_max_pic_order_cnt_lsb_minus4
+    } else if (result.picOrderCntType == 1) {
+        CQBitReaderSkipBits(reader, 1);  // delta_pic_order_always_zero_flag
+        CQBitReaderReadSE(reader);  // offset_for_non_ref_pic
+        CQBitReaderReadSE(reader);  // offset_for_top_to_bottom_field
+        uint32_t cycleCount = CQBitReaderReadUE(reader);
+        for (uint32_t i = 0; i < cycleCount && !reader->isOverflow; i++) {
+            CQBitReaderReadSE(reader);  // offset_for_ref_frame
+        }
+    }
+    result.maxNumRefFrames = CQBitReaderReadUE(reader);
+    result.gapsInFrameNumAllowedFlag = CQBitReaderReadBit(reader);
+    uint32_t widthInMbs = CQBitReaderReadUE(reader) + 1;
+    uint32_t heightInMapUnits = CQBitReaderReadUE(reader) + 1;
+    result.frameMbsOnlyFlag = CQBitReaderReadBit(reader);
+    if (!result.frameMbsOnlyFlag) CQBitReaderSkipBits(reader, 1);  // mb_adaptive_frame_field_flag
+    CQBitReaderSkipBits(reader, 1);  // direct_8x8_inference_flag
+    uint32_t width = widthInMbs * 16;
+    uint32_t height = (2 - result.frameMbsOnlyFlag) * heightInMapUnits * 16;
+    if (CQBitReaderReadBit(reader)) {
+        // 裁剪窗口以色度采样为单位，场编码时纵向再乘2
+        BOOL hasChroma = !result.separateColourPlaneFlag && result.chromaFormatIdc != 0;
+        uint32_t cropUnitX = (hasChroma && result.chromaFormatIdc != 3) ? 2 : 1;
+        uint32_t cropUnitY = ((hasChroma && result.chromaFormatIdc == 1) ? 2 : 1) * (2 - result.frameMbsOnlyFlag);
+        uint32_t left = CQBitReaderReadUE(reader);
+        uint32_t right = CQBitReaderReadUE(reader);
+        uint32_t top = CQBitReaderReadUE(reader);
+        uint32_t bottom = CQBitReaderReadUE(reader);
+        width -= MIN(width, cropUnitX * (left + right));
+        height -= MIN(height, cropUnitY * (top + bottom));
+    }
+    if (reader->isOverflow || result.chromaFormatIdc > 3 || log2MaxFrameNumMinus4 > 12 || result.picOrderCntType > 2 || width == 0 || height == 0) return NO;
+    result.log2MaxFrameNum = (uint8_t)(log2MaxFrameNumMinus4 + 4);
+    result.width = width;
+    result.height = height;
+    *info = result;
+    return YES;
+}
+
+BOOL CQH264SPSParse(const uint8_t *nalu, size_t size, CQH264SPSInfo *info) {
+    if (size < 4 || CQH264NaluTypeOf(nalu) != CQH264NaluTypeSPS) return NO;
+    uint8_t rbsp[kSPSPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu + 1, MIN(size - 1, (size_t)kSPSPrefixSize), rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    CQH264SPSInfo result;
+    if (!CQH264ParseSPSBeforeVUI(&reader, &result)) return NO;
+    if (CQBitReaderReadBit(&reader)) {
+        CQH264VUILayout layout;
+        CQH264SPSInfo vuiResult = result;
+        // VUI不完整时只返回前面的字段
+        if (CQH264ParseVUI(&reader, &vuiResult, &layout)) {
+            result = vuiResult;
+            result.vuiParametersPresentFlag = YES;
+        }
+    }
+    *info = result;
+    return YES;
+}
+
+BOOL CQH264SliceFrameNumParse(const uint8_t *nalu, size_t size, const CQH264SPSInfo *sps, uint32_t *frameNum) {
+    if (size < 2) return NO;
+    uint8_t rbsp[kSliceHeaderPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu + 1, MIN(size - 1, (size_t)kSliceHeaderPrefixSize), rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    CQBitReaderReadUE(&reader);  // first_mb_in_slice
+    CQBitReaderReadUE(&reader);  // slice_type
+    CQBitReaderReadUE(&reader);  // pic_parameter_set_id
+    if (sps->separateColourPlaneFlag) CQBitReaderSkipBits(&reader, 2);  // colour_plane_id
+    uint32_t value = CQBitReaderReadBits(&reader, sps->log2MaxFrameNum);
+    if (reader.isOverflow) return NO;
+    *frameNum = value;
+    return YES;
+}
+
+size_t CQH264SPSRewriteVUI(const uint8_t *nalu, size_t size, const CQH264VUIOverride *vui, uint8_t *output, size_t capacity) {
+    if (size < 4 || size > kSPSPrefixSize || CQH264NaluTypeOf(nalu) != CQH264NaluTypeSPS) return 0;
+    uint8_t rbsp[kSPSPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu + 1, size - 1, rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    CQH264SPSInfo info;
+    if (!CQH264ParseSPSBeforeVUI(&reader, &info)) return 0;
+    size_t vuiFlagOffset = reader.bitOffset;
+    CQH264VUILayout layout = {0};
+    BOOL hasVUI = CQBitReaderReadBit(&reader);
+    if (hasVUI && !CQH264ParseVUI(&reader, &info, &layout)) return 0;
+
+    uint8_t newRbsp[kSPSPrefixSize + kSPSRewriteExtraSize];
+    CQBitWriter writer = CQBitWriterMake(newRbsp, sizeof(newRbsp));
+    CQBitReader source = CQBitReaderMake(rbsp, rbspSize);
+    CQBitWriterCopyBits(&writer, &source, vuiFlagOffset);
+    CQBitWriterWriteBit(&writer, 1);  // vui_parameters_present_flag
+    source.bitOffset++;
+    if (hasVUI) {
+        // 宽高比、overscan、video_signal_type、色度位置原样保留
+        CQBitWriterCopyBits(&writer, &source, layout.timingInfoOffset - source.bitOffset);
+    } else {
+        CQBitWriterWriteBits(&writer, 0, 4);  // aspect_ratio_info_present_flag ... chroma_loc_info_present_flag
+    }
+
+    // timing_info
+    if (vui->numUnitsInTick > 0 && vui->timeScale > 0) {
+        CQBitWriterWriteBit(&writer, 1);
+        CQBitWriterWriteBits(&writer, vui->numUnitsInTick, 32);
+        CQBitWriterWriteBits(&writer, vui->timeScale, 32);
+        CQBitWriterWriteBit(&writer, vui->fixedFrameRateFlag);
+    } else if (hasVUI) {
+        source.bitOffset = layout.timingInfoOffset;
+        CQBitWriterCopyBits(&writer, &source, layout.hrdOffset - layout.timingInfoOffset);
+    } else {
+        CQBitWriterWriteBit(&writer, 0);
+    }
+
+    // HRD、pic_struct_present_flag原样保留
+    if (hasVUI) {
+        source.bitOffset = layout.hrdOffset;
+        CQBitWriterCopyBits(&writer, &source, layout.bitstreamRestrictionOffset - layout.hrdOffset);
+    } else {
+        CQBitWriterWriteBits(&writer, 0, 3);  // nal_hrd_parameters_present_flag, vcl_hrd_parameters_present_flag, pic_struct_present_flag
+    }
+
+    // bitstream_restriction，没有时其它字段用推断值(不限制)
+    CQBitWriterWriteBit(&writer, 1);
+    if (info.bitstreamRestrictionFlag) {
+        source.bitOffset = layout.bitstreamRestrictionOffset + 1;
+        CQBitWriterCopyBits(&writer, &source, 1);  // motion_vectors_over_pic_boundaries_flag
+        for (int i = 0; i < 4; i++) {
+            CQBitWriterWriteUE(&writer, CQBitReaderReadUE(&source));
+        }
+    } else {
+        CQBitWriterWriteBit(&writer, 1);  // motion_vectors_over_pic_boundaries_flag
+        CQBitWriterWriteUE(&writer, 2);  // max_bytes_per_pic_denom
+        CQBitWriterWriteUE(&writer, 1);  // max_bits_per_mb_denom
+        CQBitWriterWriteUE(&writer, 16);  // log2_max_mv_length_horizontal
+        CQBitWriterWriteUE(&writer, 16);  // log2_max_mv_length_vertical
+    }
+    CQBitWriterWriteUE(&writer, vui->maxNumReorderFrames);
+    // max_dec_frame_buffering不能小于max_num_ref_frames和max_num_reorder_frames
+    CQBitWriterWriteUE(&writer, MAX(info.maxNumRefFrames, vui->maxNumReorderFrames));
+    CQBitWriterWriteTrailingBits(&writer);
+    if (writer.isOverflow) return 0;
+
+    // 加防竞争字节，最坏每2字节加1字节
+    size_t newRbspSize = CQBitWriterByteSize(&writer);
+    uint8_t ebsp[(kSPSPrefixSize + kSPSRewriteExtraSize) * 3 / 2 + 1];
+    size_t ebspSize = CQNaluAddEmulationPrevention(newRbsp, newRbspSize, ebsp);
+    // 超过kSPSPrefixSize的SPS再解析时读不到VUI，按失败处理
+    if (1 + ebspSize > MIN(capacity, (size_t)kSPSPrefixSize)) return 0;
+    output[0] = nalu[0];
+    memcpy(output + 1, ebsp, ebspSize);
+    return 1 + ebspSize;
+}
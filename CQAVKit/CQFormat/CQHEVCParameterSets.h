@@ -0,0 +1,67 @@
+//
+//  CQHEVCParameterSets.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ HEVC参数集
+ @discussion MP4(hvcC)、FLV(Enhanced FLV的hvc1序列头)都需要HEVCDecoderConfigurationRecord，
+ 其中的profile/level/色度格式/位深来自SPS，这里解析SPS开头的这些字段并生成配置记录
+ 纯C实现，不依赖VideoToolbox
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// SPS中生成配置记录需要的信息
+typedef struct {
+    uint8_t maxSubLayersMinus1;  ///< 时域层数 - 1
+    BOOL temporalIdNestingFlag;
+    uint8_t generalProfileSpace;
+    uint8_t generalTierFlag;
+    uint8_t generalProfileIdc;  ///< 1为Main，2为Main10
+    uint32_t generalProfileCompatibilityFlags;
+    uint64_t generalConstraintIndicatorFlags;  ///< 低48位有效
+    uint8_t generalLevelIdc;  ///< level * 30，例如4.1为123
+    uint8_t chromaFormatIdc;  ///< 1为4:2:0
+    uint8_t bitDepthLumaMinus8;
+    uint8_t bitDepthChromaMinus8;
+    uint32_t width;  ///< 裁剪后的宽
+    uint32_t height;  ///< 裁剪后的高
+} CQHEVCSPSInfo;
+
+/**
+ 解析SPS
+ @param nalu SPS NALU(不含起始码，含2字节NALU头)
+ @param size 长度
+ @param info 输出
+ @return 成功返回YES
+ */
+FOUNDATION_EXPORT BOOL CQHEVCSPSParse(const uint8_t *nalu, size_t size, CQHEVCSPSInfo *info);
+
+/// HEVCDecoderConfigurationRecord的长度
+FOUNDATION_EXPORT size_t CQHEVCDecoderConfigurationRecordSize(size_t vpsSize, size_t spsSize, size_t ppsSize);
+
+/**
+ 生成HEVCDecoderConfigurationRecord(ISO/IEC 14496-15 8.3.3)，NALU长度头为4字节
+ @param vps VPS NALU(不含起始码)
+ @param sps SPS NALU(不含起始码)
+ @param pps PPS NALU(不含起始码)
+ @param output 输出，长度至少为CQHEVCDecoderConfigurationRecordSize
+ @return 输出长度，SPS解析失败返回0
+ */
+FOUNDATION_EXPORT size_t CQHEVCWriteDecoderConfigurationRecord(const uint8_t *vps, size_t vpsSize, const uint8_t *sps, size_t spsSize, const uint8_t *pps, size_t ppsSize, uint8_t *output);
+
+/**
+ 从HEVCDecoderConfigurationRecord中取出参数集
+ @param record 配置记录(hvcC的内容)
+ @param size 长度
+ @param block 每个VPS/SPS/PPS回调一次，nalu不含起始码
+ @return NALU长度头的字节数，格式错误返回0
+ */
+FOUNDATION_EXPORT size_t CQHEVCEnumerateDecoderConfigurationRecord(const uint8_t *record, size_t size, void (NS_NOESCAPE ^block)(const uint8_t *nalu, size_t naluSize));
+
+NS_ASSUME_NONNULL_END
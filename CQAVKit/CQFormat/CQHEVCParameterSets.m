@@ -0,0 +1,149 @@
+//
+//  CQHEVCParameterSets.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 SPS开头依次是: VPS id、时域层数、profile_tier_level、SPS id、色度格式、宽高、裁剪窗口、位深，
+   配置记录需要的字段都在这里，不需要解析后面的语法(VUI等)
+ 2 profile_tier_level的长度和子层数有关，子层的profile/level按标志跳过
+ 3 配置记录固定23字节头 + VPS/SPS/PPS三个数组，每个数组一个NALU
+ */
+
+#import "CQHEVCParameterSets.h"
+#import "CQNaluUtil.h"
+#import "CQBitReader.h"
+
+#define kSPSPrefixSize 256  ///< 解析需要的最多字节数(7个子层的profile_tier_level也在这个范围内)
+static const size_t kRecordHeaderSize = 23;
+
+BOOL CQHEVCSPSParse(const uint8_t *nalu, size_t size, CQHEVCSPSInfo *info) {
+    if (size < 4 || CQHEVCNaluTypeOf(nalu) != CQHEVCNaluTypeSPS) return NO;
+    uint8_t rbsp[kSPSPrefixSize];
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu, MIN(size, (size_t)kSPSPrefixSize), rbsp);
+    CQBitReader reader = CQBitReaderMake(rbsp, rbspSize);
+    CQBitReaderSkipBits(&reader, 16);  // NALU头
+
+    CQHEVCSPSInfo result = {0};
+    CQBitReaderSkipBits(&reader, 4);  // sps_video_parameter_set_id
+    result.maxSubLayersMinus1 = CQBitReaderReadBits(&reader, 3);
+    result.temporalIdNestingFlag = CQBitReaderReadBit(&reader);
+
+    // profile_tier_level(1, sps_max_sub_layers_minus1)
+    result.generalProfileSpace = CQBitReaderReadBits(&reader, 2);
+    result.generalTierFlag = CQBitReaderReadBit(&reader);
+    result.generalProfileIdc = CQBitReaderReadBits(&reader, 5);
+    result.generalProfileCompatibilityFlags = CQBitReaderReadBits(&reader, 32);
+    result.generalConstraintIndicatorFlags = ((uint64_t)CQBitReaderReadBits(&reader, 16) << 32) | CQBitReaderReadBits(&reader, 32);
+    result.generalLevelIdc = CQBitReaderReadBits(&reader, 8);
+    BOOL subLayerProfilePresent[8] = {0};
+    BOOL subLayerLevelPresent[8] = {0};
+    for (int i = 0; i < result.maxSubLayersMinus1; i++) {
+        subLayerProfilePresent[i] = CQBitReaderReadBit(&reader);
+        subLayerLevelPresent[i] = CQBitReaderReadBit(&reader);
+    }
+    if (result.maxSubLayersMinus1 > 0) {
+        CQBitReaderSkipBits(&reader, 2 * (8 - result.maxSubLayersMinus1));  // reserved_zero_2bits
+    }
+    for (int i = 0; i < result.maxSubLayersMinus1; i++) {
+        if (subLayerProfilePresent[i]) CQBitReaderSkipBits(&reader, 88);
+        if (subLayerLevelPresent[i]) CQBitReaderSkipBits(&reader, 8);
+    }
+
+    CQBitReaderReadUE(&reader);  // sps_seq_parameter_set_id
+    uint32_t chromaFormatIdc = CQBitReaderReadUE(&reader);
+    if (chromaFormatIdc == 3) CQBitReaderSkipBits(&reader, 1);  // separate_colour_plane_flag
+    uint32_t width = CQBitReaderReadUE(&reader);
+    uint32_t height = CQBitReaderReadUE(&reader);
+    if (CQBitReaderReadBit(&reader)) {
+        // 裁剪窗口以色度采样为单位
+        uint32_t subWidth = (chromaFormatIdc == 1 || chromaFormatIdc == 2) ? 2 : 1;
+        uint32_t subHeight = chromaFormatIdc == 1 ? 2 : 1;
+        uint32_t left = CQBitReaderReadUE(&reader);
+        uint32_t right = CQBitReaderReadUE(&reader);
+        uint32_t top = CQBitReaderReadUE(&reader);
+        uint32_t bottom = CQBitReaderReadUE(&reader);
+        width -= MIN(width, subWidth * (left + right));
+        height -= MIN(height, subHeight * (top + bottom));
+    }
+    uint32_t bitDepthLumaMinus8 = CQBitReaderReadUE(&reader);
+    uint32_t bitDepthChromaMinus8 = CQBitReaderReadUE(&reader);
+    if (reader.isOverflow || chromaFormatIdc > 3 || bitDepthLumaMinus8 > 8 || bitDepthChromaMinus8 > 8 || width == 0 || height == 0) return NO;
+    result.chromaFormatIdc = chromaFormatIdc;
+    result.bitDepthLumaMinus8 = bitDepthLumaMinus8;
+    result.bitDepthChromaMinus8 = bitDepthChromaMinus8;
+    result.width = width;
+    result.height = height;
+    *info = result;
+    return YES;
+}
+
+size_t CQHEVCDecoderConfigurationRecordSize(size_t vpsSize, size_t spsSize, size_t ppsSize) {
+    // 每个数组: 类型(1) + NALU个数(2) + 长度(2) + NALU
+    return kRecordHeaderSize + 3 * 5 + vpsSize + spsSize + ppsSize;
+}
+
+/// 写一个只有一个NALU的数组
+static uint8_t *CQHEVCWriteArray(uint8_t *p, CQHEVCNaluType type, const uint8_t *nalu, size_t size) {
+    *p++ = 0x80 | type;  // array_completeness 1，所有参数集都在这里
+    *p++ = 0x00;
+    *p++ = 0x01;
+    *p++ = (uint8_t)(size >> 8);
+    *p++ = (uint8_t)size;
+    memcpy(p, nalu, size);
+    return p + size;
+}
+
+size_t CQHEVCWriteDecoderConfigurationRecord(const uint8_t *vps, size_t vpsSize, const uint8_t *sps, size_t spsSize, const uint8_t *pps, size_t ppsSize, uint8_t *output) {
+    CQHEVCSPSInfo info;
+    if (!CQHEVCSPSParse(sps, spsSize, &info) || vpsSize > 0xFFFF || spsSize > 0xFFFF || ppsSize > 0xFFFF) return 0;
+    uint8_t *p = output;
+    *p++ = 1;  // configurationVersion
+    *p++ = (uint8_t)((info.generalProfileSpace << 6) | (info.generalTierFlag << 5) | info.generalProfileIdc);
+    for (int i = 3; i >= 0; i--) {
+        *p++ = (uint8_t)(info.generalProfileCompatibilityFlags >> (i * 8));
+    }
+    for (int i = 5; i >= 0; i--) {
+        *p++ = (uint8_t)(info.generalConstraintIndicatorFlags >> (i * 8));
+    }
+    *p++ = info.generalLevelIdc;
+    *p++ = 0xF0;  // reserved 1111 + min_spatial_segmentation_idc 0
+    *p++ = 0x00;
+    *p++ = 0xFC;  // reserved 111111 + parallelismType 0(未知)
+    *p++ = 0xFC | info.chromaFormatIdc;
+    *p++ = 0xF8 | info.bitDepthLumaMinus8;
+    *p++ = 0xF8 | info.bitDepthChromaMinus8;
+    *p++ = 0x00;  // avgFrameRate 0(未指定)
+    *p++ = 0x00;
+    // constantFrameRate 0 + numTemporalLayers + temporalIdNested + lengthSizeMinusOne 3
+    *p++ = (uint8_t)(((info.maxSubLayersMinus1 + 1) << 3) | (info.temporalIdNestingFlag << 2) | 0x03);
+    *p++ = 3;  // numOfArrays
+    p = CQHEVCWriteArray(p, CQHEVCNaluTypeVPS, vps, vpsSize);
+    p = CQHEVCWriteArray(p, CQHEVCNaluTypeSPS, sps, spsSize);
+    p = CQHEVCWriteArray(p, CQHEVCNaluTypePPS, pps, ppsSize);
+    return (size_t)(p - output);
+}
+
+size_t CQHEVCEnumerateDecoderConfigurationRecord(const uint8_t *record, size_t size, void (NS_NOESCAPE ^block)(const uint8_t *nalu, size_t naluSize)) {
+    if (size < kRecordHeaderSize || record[0] != 1) return 0;
+    size_t lengthSize = (record[21] & 0x03) + 1;
+    uint8_t arrayCount = record[22];
+    size_t offset = kRecordHeaderSize;
+    for (uint8_t i = 0; i < arrayCount; i++) {
+        if (offset + 3 > size) return 0;
+        uint16_t naluCount = (uint16_t)((record[offset + 1] << 8) | record[offset + 2]);
+        offset += 3;
+        for (uint16_t j = 0; j < naluCount; j++) {
+            if (offset + 2 > size) return 0;
+            size_t naluSize = (size_t)((record[offset] << 8) | record[offset + 1]);
+            offset += 2;
+            if (naluSize > size - offset) return 0;
+            if (naluSize > 0) block(record + offset, naluSize);
+            offset += naluSize;
+        }
+    }
+    return lengthSize == 3 ? 0 : lengthSize;
+}
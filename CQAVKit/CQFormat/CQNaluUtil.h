@@ -0,0 +1,179 @@
+//
+//  CQNaluUtil.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ H264/HEVC NALU 工具
+ @discussion 编码器输出/解码器输入均为Annex-B格式(00 00 00 01 + NALU)，
+ 封装器、分包器等都需要在码流里查找起始码、判断NALU类型，统一放在这里
+ H264的NALU头为1字节，HEVC为2字节，封装器只关心NALU的作用(CQNaluKindOf)，不需要区分两种类型
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 视频编码格式
+typedef NS_ENUM(uint8_t, CQVideoCodec) {
+    CQVideoCodecH264 = 0,  ///< H264/AVC
+    CQVideoCodecHEVC = 1,  ///< H265/HEVC，同样画质码率约低30%~40%
+};
+
+/// H264 NALU类型 (nal_unit_type，NALU头的低5位)
+typedef NS_ENUM(uint8_t, CQH264NaluType) {
+    CQH264NaluTypeSlice = 1,  ///< 非IDR图像的片
+    CQH264NaluTypeIDR = 5,  ///< IDR图像的片(关键帧)
+    CQH264NaluTypeSEI = 6,  ///< 补充增强信息
+    CQH264NaluTypeSPS = 7,  ///< 序列参数集
+    CQH264NaluTypePPS = 8,  ///< 图像参数集
+    CQH264NaluTypeAUD = 9,  ///< 访问单元分隔符
+};
+
+/// 获取NALU类型
+/// @param nalu NALU首地址(不含起始码)
+static inline CQH264NaluType CQH264NaluTypeOf(const uint8_t *nalu) {
+    return (CQH264NaluType)(nalu[0] & 0x1F);
+}
+
+/// 获取nal_ref_idc(NALU头的第2、3位)，图像NALU为0时是非参考帧，不会被其它帧引用
+/// @param nalu NALU首地址(不含起始码)
+static inline uint8_t CQH264NalRefIdcOf(const uint8_t *nalu) {
+    return (nalu[0] >> 5) & 0x03;
+}
+
+/// HEVC NALU类型 (nal_unit_type，NALU头第一个字节的第2~7位)
+typedef NS_ENUM(uint8_t, CQHEVCNaluType) {
+    CQHEVCNaluTypeTrailN = 0,  ///< 普通帧，子层非参考
+    CQHEVCNaluTypeTrailR = 1,  ///< 普通帧，参考帧
+    CQHEVCNaluTypeBLAWLP = 16,  ///< 16~23为IRAP(随机访问点，关键帧)
+    CQHEVCNaluTypeIDRWRADL = 19,  ///< IDR(可以带RADL前置帧)
+    CQHEVCNaluTypeIDRNLP = 20,  ///< IDR(没有前置帧，VideoToolbox输出的关键帧)
+    CQHEVCNaluTypeCRA = 21,  ///< 干净随机访问
+    CQHEVCNaluTypeVPS = 32,  ///< 视频参数集
+    CQHEVCNaluTypeSPS = 33,  ///< 序列参数集
+    CQHEVCNaluTypePPS = 34,  ///< 图像参数集
+    CQHEVCNaluTypeAUD = 35,  ///< 访问单元分隔符
+    CQHEVCNaluTypePrefixSEI = 39,  ///< 前缀补充增强信息
+    CQHEVCNaluTypeSuffixSEI = 40,  ///< 后缀补充增强信息
+    CQHEVCNaluTypeAP = 48,  ///< RTP聚合包(RFC 7798)
+    CQHEVCNaluTypeFU = 49,  ///< RTP分片单元(RFC 7798)
+};
+
+/// 获取HEVC NALU类型
+/// @param nalu NALU首地址(不含起始码)
+static inline CQHEVCNaluType CQHEVCNaluTypeOf(const uint8_t *nalu) {
+    return (CQHEVCNaluType)((nalu[0] >> 1) & 0x3F);
+}
+
+/// 获取HEVC时域层TemporalId(nuh_temporal_id_plus1 - 1)
+/// @param nalu NALU首地址(不含起始码)，至少2字节
+static inline uint8_t CQHEVCTemporalIdOf(const uint8_t *nalu) {
+    return (uint8_t)((nalu[1] & 0x07) - 1);
+}
+
+/// 是否为IRAP(BLA/IDR/CRA)，从这一帧开始可以解码
+static inline BOOL CQHEVCNaluTypeIsIRAP(CQHEVCNaluType type) {
+    return type >= CQHEVCNaluTypeBLAWLP && type <= 23;
+}
+
+/// 是否为子层非参考帧(TRAIL_N/TSA_N/STSA_N/RADL_N/RASL_N等0~14的偶数)，不被同一时域层的后续帧引用
+static inline BOOL CQHEVCNaluTypeIsSubLayerNonReference(CQHEVCNaluType type) {
+    return type <= 14 && (type & 0x01) == 0;
+}
+
+/// NALU在封装时的作用，H264/HEVC共用
+typedef NS_ENUM(uint8_t, CQNaluKind) {
+    CQNaluKindOther = 0,  ///< 其它(保留类型、数据分割等)
+    CQNaluKindSlice = 1,  ///< 非关键帧的片
+    CQNaluKindKeyFrame = 2,  ///< 关键帧的片(H264 IDR，HEVC IRAP)
+    CQNaluKindParameterSet = 3,  ///< VPS/SPS/PPS
+    CQNaluKindSEI = 4,  ///< 补充增强信息
+    CQNaluKindAUD = 5,  ///< 访问单元分隔符
+};
+
+/// NALU头的长度，H264为1，HEVC为2
+static inline size_t CQNaluHeaderSize(CQVideoCodec codec) {
+    return codec == CQVideoCodecHEVC ? 2 : 1;
+}
+
+/// 获取NALU的作用
+/// @param nalu NALU首地址(不含起始码)
+static inline CQNaluKind CQNaluKindOf(CQVideoCodec codec, const uint8_t *nalu) {
+    if (codec == CQVideoCodecHEVC) {
+        CQHEVCNaluType type = CQHEVCNaluTypeOf(nalu);
+        // 22~31为保留类型，不当作图像
+        if (type <= CQHEVCNaluTypeCRA) return CQHEVCNaluTypeIsIRAP(type) ? CQNaluKindKeyFrame : CQNaluKindSlice;
+        if (type >= CQHEVCNaluTypeVPS && type <= CQHEVCNaluTypePPS) return CQNaluKindParameterSet;
+        if (type == CQHEVCNaluTypeAUD) return CQNaluKindAUD;
+        if (type == CQHEVCNaluTypePrefixSEI || type == CQHEVCNaluTypeSuffixSEI) return CQNaluKindSEI;
+        return CQNaluKindOther;
+    }
+    switch (CQH264NaluTypeOf(nalu)) {
+        case CQH264NaluTypeSlice: return CQNaluKindSlice;
+        case CQH264NaluTypeIDR: return CQNaluKindKeyFrame;
+        case CQH264NaluTypeSPS:
+        case CQH264NaluTypePPS: return CQNaluKindParameterSet;
+        case CQH264NaluTypeSEI: return CQNaluKindSEI;
+        case CQH264NaluTypeAUD: return CQNaluKindAUD;
+        default: return CQNaluKindOther;
+    }
+}
+
+/// 是否为SPS(HEVC的VPS/SPS/PPS里只有SPS带分辨率等信息，判断一帧是否带参数集时用)
+static inline BOOL CQNaluIsSPS(CQVideoCodec codec, const uint8_t *nalu) {
+    return codec == CQVideoCodecHEVC ? CQHEVCNaluTypeOf(nalu) == CQHEVCNaluTypeSPS : CQH264NaluTypeOf(nalu) == CQH264NaluTypeSPS;
+}
+
+/**
+ 查找Annex-B起始码(00 00 01)
+ @param data 数据
+ @param size 数据长度
+ @return 起始码 00 00 01 中第一个00的偏移，未找到返回size (4字节起始码前面多出的00会被当作上一个NALU的结尾)
+ */
+FOUNDATION_EXPORT size_t CQNaluFindStartCode(const uint8_t *data, size_t size);
+
+/**
+ 查找Annex-B起始码的标量实现
+ @discussion 结果和CQNaluFindStartCode相同，arm64上CQNaluFindStartCode使用NEON，这个函数用于基准测试对比
+ */
+FOUNDATION_EXPORT size_t CQNaluFindStartCodeScalar(const uint8_t *data, size_t size);
+
+/**
+ 遍历Annex-B码流中的每个NALU
+ @param data Annex-B数据，可以包含多个NALU
+ @param size 数据长度
+ @param block 回调，nalu不含起始码，且已去掉尾部多余的0
+ */
+FOUNDATION_EXPORT void CQNaluEnumerateAnnexB(const uint8_t *data, size_t size, void (NS_NOESCAPE ^block)(const uint8_t *nalu, size_t naluSize, BOOL *stop));
+
+/**
+ 获取单个Annex-B NALU的负载(跳过起始码)
+ @param annexB 以起始码开头的NALU，编码器回调的数据就是这种格式
+ @param naluSize 输出，不含起始码的长度
+ @return NALU首地址，数据不是以起始码开头时返回NULL
+ */
+FOUNDATION_EXPORT const uint8_t * _Nullable CQNaluSkipStartCode(const uint8_t *annexB, size_t size, size_t *naluSize);
+
+/**
+ 去掉防竞争字节(EBSP转RBSP)
+ @discussion NALU里连续两个0后面如果是00~03，编码时会插入一个03，解析SPS/SEI等语法前需要去掉
+ @param data NALU数据(不含起始码)
+ @param size 数据长度
+ @param output 输出，长度至少为size，可以和data相同(原地处理)
+ @return 输出长度
+ */
+FOUNDATION_EXPORT size_t CQNaluRemoveEmulationPrevention(const uint8_t *data, size_t size, uint8_t *output);
+
+/**
+ 插入防竞争字节(RBSP转EBSP)
+ @param data RBSP数据(含NALU头)
+ @param size 数据长度
+ @param output 输出，长度至少为size + size / 2 + 1，不能和data相同
+ @return 输出长度
+ */
+FOUNDATION_EXPORT size_t CQNaluAddEmulationPrevention(const uint8_t *data, size_t size, uint8_t *output);
+
+NS_ASSUME_NONNULL_END
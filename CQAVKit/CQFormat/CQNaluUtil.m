@@ -0,0 +1,125 @@
+//
+//  CQNaluUtil.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQNaluUtil.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+size_t CQNaluFindStartCodeScalar(const uint8_t *data, size_t size) {
+    if (size < 3) return size;
+    // 每次看第三个字节，不是0/1就可以直接跳过3个字节，码流中绝大部分数据都走这个分支
+    size_t i = 2;
+    while (i < size) {
+        if (data[i] > 1) {
+            i += 3;
+        } else if (data[i] == 1) {
+            if (data[i - 1] == 0 && data[i - 2] == 0) return i - 2;
+            i += 3;
+        } else {
+            i++;
+        }
+    }
+    return size;
+}
+
+#if defined(__aarch64__)
+static size_t CQNaluFindStartCodeNEON(const uint8_t *data, size_t size) {
+    if (size < 3) return size;
+    // NEON一次看16个字节，起始码的3个字节都不大于1，块内没有不大于1的字节就不可能有起始码从这里开始
+    // 有候选字节的块逐个位置检查，之后回到NEON继续跳
+    const uint8x16_t one = vdupq_n_u8(1);
+    size_t block = 0;
+    while (block + 16 <= size) {
+        uint8x16_t candidate = vcleq_u8(vld1q_u8(data + block), one);
+        if (vmaxvq_u8(candidate) != 0) {
+            size_t end = MIN(block + 16, size - 2);
+            for (size_t p = block; p < end; p++) {
+                if (data[p] == 0 && data[p + 1] == 0 && data[p + 2] == 1) return p;
+            }
+        }
+        block += 16;
+    }
+    // 剩余不足16字节
+    for (size_t p = block; p + 2 < size; p++) {
+        if (data[p] == 0 && data[p + 1] == 0 && data[p + 2] == 1) return p;
+    }
+    return size;
+}
+#endif
+
+size_t CQNaluFindStartCode(const uint8_t *data, size_t size) {
+#if defined(__aarch64__)
+    return CQNaluFindStartCodeNEON(data, size);
+#else
+    return CQNaluFindStartCodeScalar(data, size);
+#endif
+}
+
+void CQNaluEnumerateAnnexB(const uint8_t *data, size_t size, void (NS_NOESCAPE ^block)(const uint8_t *nalu, size_t naluSize, BOOL *stop)) {
+    size_t start = CQNaluFindStartCode(data, size);
+    BOOL stop = NO;
+    while (start < size && !stop) {
+        size_t naluStart = start + 3;
+        size_t next = naluStart + CQNaluFindStartCode(data + naluStart, size - naluStart);
+        size_t naluEnd = next;
+        // 去掉尾部的0(trailing_zero_8bits或4字节起始码的第一个0)
+        while (naluEnd > naluStart && data[naluEnd - 1] == 0) naluEnd--;
+        if (naluEnd > naluStart) {
+            block(data + naluStart, naluEnd - naluStart, &stop);
+        }
+        start = next;
+    }
+}
+
+const uint8_t *CQNaluSkipStartCode(const uint8_t *annexB, size_t size, size_t *naluSize) {
+    if (size >= 4 && annexB[0] == 0 && annexB[1] == 0 && annexB[2] == 0 && annexB[3] == 1) {
+        *naluSize = size - 4;
+        return annexB + 4;
+    }
+    if (size >= 3 && annexB[0] == 0 && annexB[1] == 0 && annexB[2] == 1) {
+        *naluSize = size - 3;
+        return annexB + 3;
+    }
+    *naluSize = 0;
+    return NULL;
+}
+
+size_t CQNaluRemoveEmulationPrevention(const uint8_t *data, size_t size, uint8_t *output) {
+    size_t outputSize = 0;
+    int zeroCount = 0;
+    for (size_t i = 0; i < size; i++) {
+        uint8_t byte = data[i];
+        if (zeroCount >= 2 && byte == 0x03) {
+            // 跳过防竞争字节，它后面的字节不和前面的0连续计数
+            zeroCount = 0;
+            continue;
+        }
+        output[outputSize++] = byte;
+        zeroCount = (byte == 0) ? zeroCount + 1 : 0;
+    }
+    return outputSize;
+}
+
+size_t CQNaluAddEmulationPrevention(const uint8_t *data, size_t size, uint8_t *output) {
+    size_t outputSize = 0;
+    int zeroCount = 0;
+    for (size_t i = 0; i < size; i++) {
+        uint8_t byte = data[i];
+        if (zeroCount >= 2 && byte <= 0x03) {
+            output[outputSize++] = 0x03;
+            zeroCount = 0;
+        }
+        output[outputSize++] = byte;
+        zeroCount = (byte == 0) ? zeroCount + 1 : 0;
+    }
+    // 以0结尾时也要插入，否则和后面的起始码连在一起
+    if (outputSize > 0 && output[outputSize - 1] == 0) {
+        output[outputSize++] = 0x03;
+    }
+    return outputSize;
+}
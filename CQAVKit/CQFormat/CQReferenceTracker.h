@@ -0,0 +1,84 @@
+//
+//  CQReferenceTracker.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQNaluUtil.h"
+#import "CQFrameClassifier.h"
+#import "CQH264ParameterSets.h"
+
+/**
+ 参考帧有效性跟踪(解码端，纯C，时间由调用方传入)
+ @discussion 参考帧丢失后，直到下一个IDR的所有帧都会直接或间接引用它，送入解码器只会得到花屏的画面
+ H264: 非IDR帧的frame_num等于前一个参考帧的frame_num + 1(模MaxFrameNum)，不连续说明中间丢了参考帧，
+ 丢的是非参考帧时frame_num不受影响，不需要处理
+ HEVC没有frame_num，只能依靠上层上报的数据丢失(CQReferenceTrackerOnDataLoss)和解码错误
+ 参考帧失效后可以跳过之后的帧直到IDR(画面停在最后一个正确的帧)，并按最小间隔请求关键帧
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 统计
+typedef struct {
+    uint64_t frameNumGapCount;  ///< frame_num不连续(丢失参考帧)的次数
+    uint64_t dataLossCount;  ///< 上层上报的数据丢失次数
+    uint64_t decodeErrorCount;  ///< 解码错误次数
+    uint64_t skippedFrameCount;  ///< 参考帧失效后跳过的帧数
+    uint64_t corruptedFrameCount;  ///< 参考帧失效后仍然解码的帧数(不跳过时)
+    uint64_t keyFrameRequestCount;  ///< 请求关键帧的次数
+    uint64_t recoveryCount;  ///< 参考帧失效后被IDR恢复的次数
+} CQReferenceTrackerStats;
+
+/// 参考帧跟踪
+typedef struct {
+    CQVideoCodec codec;
+    uint64_t minKeyFrameRequestIntervalUs;  ///< 两次请求关键帧的最小间隔，默认500ms(请求本身可能丢失，失效期间按这个间隔重复)
+    CQH264SPSInfo sps;  ///< 最近的SPS(H264)
+    BOOL hasSPS;
+    BOOL isReferenceValid;  ///< 参考帧是否完整，开始时等待第一个IDR
+    BOOL hasDecodedKeyFrame;  ///< 是否收到过IDR
+    BOOL hasPrevRefFrameNum;
+    uint32_t prevRefFrameNum;  ///< 前一个参考帧的frame_num
+    BOOL hasRequestedKeyFrame;  ///< 这次失效后是否已经请求过关键帧
+    uint64_t lastKeyFrameRequestUs;
+    CQReferenceTrackerStats stats;
+} CQReferenceTracker;
+
+FOUNDATION_EXPORT CQReferenceTracker CQReferenceTrackerMake(CQVideoCodec codec);
+
+/**
+ 收到参数集
+ @discussion H264的SPS决定frame_num的位数，其它参数集忽略
+ @param nalu 参数集NALU(不含起始码)
+ */
+FOUNDATION_EXPORT void CQReferenceTrackerOnParameterSet(CQReferenceTracker *tracker, const uint8_t *nalu, size_t size);
+
+/**
+ 一帧开始
+ @param info 帧分类
+ @param firstSlice 第一个片(不含起始码)，用来解析frame_num
+ @param size 长度
+ @param skipsCorrupted 参考帧失效时是否跳过
+ @return 需要解码返回YES，应该跳过返回NO
+ */
+FOUNDATION_EXPORT BOOL CQReferenceTrackerOnFrame(CQReferenceTracker *tracker, CQFrameInfo info, const uint8_t *firstSlice, size_t size, BOOL skipsCorrupted);
+
+/// 上层发现数据丢失(例如RTP丢包)，不知道丢的是哪一帧，参考帧按失效处理
+FOUNDATION_EXPORT void CQReferenceTrackerOnDataLoss(CQReferenceTracker *tracker);
+
+/**
+ 解码出错
+ @param isReference 出错的帧是否是参考帧，非参考帧出错不影响后面的帧
+ */
+FOUNDATION_EXPORT void CQReferenceTrackerOnDecodeError(CQReferenceTracker *tracker, BOOL isReference);
+
+/**
+ 现在是否应该请求关键帧
+ @discussion 参考帧失效时返回YES，之后每隔minKeyFrameRequestIntervalUs再返回一次，直到收到IDR
+ */
+FOUNDATION_EXPORT BOOL CQReferenceTrackerShouldRequestKeyFrame(CQReferenceTracker *tracker, uint64_t nowUs);
+
+NS_ASSUME_NONNULL_END
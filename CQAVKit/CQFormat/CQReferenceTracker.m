@@ -0,0 +1,98 @@
+//
+//  CQReferenceTracker.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 状态只有参考帧有效/失效两种: 开始时失效(等待第一个IDR)，frame_num不连续、上报数据丢失、参考帧解码出错时失效，IDR恢复
+ 2 期望的frame_num = (前一个参考帧的frame_num + 1) % MaxFrameNum，非参考帧不更新前一个参考帧，
+   所以连续的非参考帧frame_num相同，丢掉的非参考帧不会造成不连续
+ 3 失效期间跳过时不更新frame_num；不跳过时照常更新，避免每一帧都算一次不连续
+ 4 SPS允许frame_num跳跃(gaps_in_frame_num_value_allowed_flag)或片头解析失败时不检查连续性
+ */
+
+#import "CQReferenceTracker.h"
+
+static const uint64_t kDefaultKeyFrameRequestIntervalUs = 500000;
+
+/// 参考帧失效
+static void CQReferenceTrackerInvalidate(CQReferenceTracker *tracker) {
+    tracker->isReferenceValid = NO;
+    tracker->hasPrevRefFrameNum = NO;
+}
+
+CQReferenceTracker CQReferenceTrackerMake(CQVideoCodec codec) {
+    CQReferenceTracker tracker = {0};
+    tracker.codec = codec;
+    tracker.minKeyFrameRequestIntervalUs = kDefaultKeyFrameRequestIntervalUs;
+    return tracker;
+}
+
+void CQReferenceTrackerOnParameterSet(CQReferenceTracker *tracker, const uint8_t *nalu, size_t size) {
+    if (tracker->codec != CQVideoCodecH264 || !CQNaluIsSPS(tracker->codec, nalu)) return;
+    CQH264SPSInfo sps;
+    if (!CQH264SPSParse(nalu, size, &sps)) return;
+    // frame_num位数变化后之前的frame_num没法比较
+    if (tracker->hasSPS && sps.log2MaxFrameNum != tracker->sps.log2MaxFrameNum) tracker->hasPrevRefFrameNum = NO;
+    tracker->sps = sps;
+    tracker->hasSPS = YES;
+}
+
+BOOL CQReferenceTrackerOnFrame(CQReferenceTracker *tracker, CQFrameInfo info, const uint8_t *firstSlice, size_t size, BOOL skipsCorrupted) {
+    if (info.frameClass == CQFrameClassUnknown) return YES;
+    uint32_t frameNum = 0;
+    BOOL hasFrameNum = tracker->codec == CQVideoCodecH264 && tracker->hasSPS && !tracker->sps.gapsInFrameNumAllowedFlag
+        && CQH264SliceFrameNumParse(firstSlice, size, &tracker->sps, &frameNum);
+
+    if (info.frameClass == CQFrameClassIDR) {
+        if (tracker->hasDecodedKeyFrame && !tracker->isReferenceValid) tracker->stats.recoveryCount++;
+        tracker->isReferenceValid = YES;
+        tracker->hasDecodedKeyFrame = YES;
+        tracker->hasRequestedKeyFrame = NO;
+        tracker->hasPrevRefFrameNum = hasFrameNum;
+        tracker->prevRefFrameNum = frameNum;
+        return YES;
+    }
+
+    if (hasFrameNum && tracker->hasPrevRefFrameNum) {
+        uint32_t expected = (tracker->prevRefFrameNum + 1) & ((1u << tracker->sps.log2MaxFrameNum) - 1);
+        if (frameNum != expected && tracker->isReferenceValid) {
+            tracker->stats.frameNumGapCount++;
+            CQReferenceTrackerInvalidate(tracker);
+        }
+    }
+    if (!tracker->isReferenceValid) {
+        if (skipsCorrupted) {
+            tracker->stats.skippedFrameCount++;
+            return NO;
+        }
+        tracker->stats.corruptedFrameCount++;
+    }
+    if (hasFrameNum && info.frameClass == CQFrameClassReference) {
+        tracker->hasPrevRefFrameNum = YES;
+        tracker->prevRefFrameNum = frameNum;
+    }
+    return YES;
+}
+
+void CQReferenceTrackerOnDataLoss(CQReferenceTracker *tracker) {
+    tracker->stats.dataLossCount++;
+    CQReferenceTrackerInvalidate(tracker);
+}
+
+void CQReferenceTrackerOnDecodeError(CQReferenceTracker *tracker, BOOL isReference) {
+    tracker->stats.decodeErrorCount++;
+    if (isReference) CQReferenceTrackerInvalidate(tracker);
+}
+
+BOOL CQReferenceTrackerShouldRequestKeyFrame(CQReferenceTracker *tracker, uint64_t nowUs) {
+    if (tracker->isReferenceValid) return NO;
+    if (tracker->hasRequestedKeyFrame && nowUs - tracker->lastKeyFrameRequestUs < tracker->minKeyFrameRequestIntervalUs) return NO;
+    tracker->hasRequestedKeyFrame = YES;
+    tracker->lastKeyFrameRequestUs = nowUs;
+    tracker->stats.keyFrameRequestCount++;
+    return YES;
+}
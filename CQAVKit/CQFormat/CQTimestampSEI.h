@@ -0,0 +1,65 @@
+//
+//  CQTimestampSEI.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CoreMedia.h>
+#import "CQNaluUtil.h"
+
+/**
+ 采集时间戳SEI
+ @discussion 编码端在每帧前插入user_data_unregistered SEI(payloadType 5)，携带采集时刻和帧序号，
+ 解码端取出后和本地时钟比较，得到采集->解码、采集->显示的端到端延迟
+ 采集时刻用Unix时间(微秒)，跨设备测量时两端需要对时(NTP)，否则结果包含两端的时钟差
+
+ SEI负载: UUID(16字节) + 采集时刻(8字节大端) + 帧序号(8字节大端)
+ H264和HEVC的SEI语法相同，只是NALU头不同(HEVC为2字节的前缀SEI)
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 采集时间戳
+typedef struct {
+    uint64_t captureTimeUs;  ///< 采集时刻，Unix时间(微秒)
+    uint64_t frameID;  ///< 采集帧序号，从1开始递增
+} CQCaptureTimestamp;
+
+/// 当前Unix时间(微秒)
+FOUNDATION_EXPORT uint64_t CQWallClockMicros(void);
+
+/**
+ 把采集时间戳附加到sampleBuffer上，编码器从这里读取
+ @discussion CQCaptureManager输出的每个视频sampleBuffer都带有采集时间戳
+ */
+FOUNDATION_EXPORT void CQCaptureTimestampAttach(CMSampleBufferRef sampleBuffer, CQCaptureTimestamp timestamp);
+
+/// 读取sampleBuffer上的采集时间戳，没有返回NO
+FOUNDATION_EXPORT BOOL CQCaptureTimestampFromSampleBuffer(CMSampleBufferRef sampleBuffer, CQCaptureTimestamp *timestamp);
+
+/// 把采集时间戳附加到解码输出的pixelBuffer上，渲染后用来计算采集->显示延迟
+FOUNDATION_EXPORT void CQCaptureTimestampAttachToPixelBuffer(CVPixelBufferRef pixelBuffer, CQCaptureTimestamp timestamp);
+
+/// 读取pixelBuffer上的采集时间戳，没有返回NO
+FOUNDATION_EXPORT BOOL CQCaptureTimestampFromPixelBuffer(CVPixelBufferRef pixelBuffer, CQCaptureTimestamp *timestamp);
+
+/**
+ 生成采集时间戳SEI
+ @param codec 编码格式
+ @return Annex-B NALU(4字节起始码)，已插入防竞争字节
+ */
+FOUNDATION_EXPORT NSData *CQTimestampSEICreate(CQVideoCodec codec, CQCaptureTimestamp timestamp);
+
+/**
+ 从SEI NALU中解析采集时间戳
+ @param codec 编码格式
+ @param nalu SEI NALU(不含起始码，含NALU头)，一个SEI NALU里可以有多条消息，只取UUID匹配的那条
+ @param size 长度
+ @param timestamp 输出
+ @return 找到采集时间戳返回YES
+ */
+FOUNDATION_EXPORT BOOL CQTimestampSEIParse(CQVideoCodec codec, const uint8_t *nalu, size_t size, CQCaptureTimestamp *timestamp);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,137 @@
+//
+//  CQTimestampSEI.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQTimestampSEI.h"
+#import <CoreVideo/CoreVideo.h>
+#import <time.h>
+
+/// 区分其他user_data_unregistered SEI
+static const uint8_t kTimestampSEIUUID[16] = {
+    0x43, 0x51, 0x41, 0x56, 0x4B, 0x69, 0x74, 0x2D, 0x9A, 0x1E, 0x4F, 0x27, 0xB8, 0x63, 0x0D, 0xC5,
+};
+static const uint8_t kSEIPayloadTypeUserDataUnregistered = 5;
+static const size_t kTimestampPayloadSize = 16 + 8 + 8;
+
+static CFStringRef const kCaptureTimestampAttachmentKey = CFSTR("CQCaptureTimestamp");
+
+uint64_t CQWallClockMicros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+#pragma mark - Attachment
+void CQCaptureTimestampAttach(CMSampleBufferRef sampleBuffer, CQCaptureTimestamp timestamp) {
+    CFDataRef data = CFDataCreate(kCFAllocatorDefault, (const UInt8 *)&timestamp, sizeof(timestamp));
+    CMSetAttachment(sampleBuffer, kCaptureTimestampAttachmentKey, data, kCMAttachmentMode_ShouldNotPropagate);
+    CFRelease(data);
+}
+
+BOOL CQCaptureTimestampFromSampleBuffer(CMSampleBufferRef sampleBuffer, CQCaptureTimestamp *timestamp) {
+    CFDataRef data = CMGetAttachment(sampleBuffer, kCaptureTimestampAttachmentKey, NULL);
+    if (!data || CFGetTypeID(data) != CFDataGetTypeID() || CFDataGetLength(data) != sizeof(CQCaptureTimestamp)) return NO;
+    memcpy(timestamp, CFDataGetBytePtr(data), sizeof(CQCaptureTimestamp));
+    return YES;
+}
+
+void CQCaptureTimestampAttachToPixelBuffer(CVPixelBufferRef pixelBuffer, CQCaptureTimestamp timestamp) {
+    CFDataRef data = CFDataCreate(kCFAllocatorDefault, (const UInt8 *)&timestamp, sizeof(timestamp));
+    CVBufferSetAttachment(pixelBuffer, kCaptureTimestampAttachmentKey, data, kCVAttachmentMode_ShouldNotPropagate);
+    CFRelease(data);
+}
+
+BOOL CQCaptureTimestampFromPixelBuffer(CVPixelBufferRef pixelBuffer, CQCaptureTimestamp *timestamp) {
+    CFDataRef data = CVBufferGetAttachment(pixelBuffer, kCaptureTimestampAttachmentKey, NULL);
+    if (!data || CFGetTypeID(data) != CFDataGetTypeID() || CFDataGetLength(data) != sizeof(CQCaptureTimestamp)) return NO;
+    memcpy(timestamp, CFDataGetBytePtr(data), sizeof(CQCaptureTimestamp));
+    return YES;
+}
+
+#pragma mark - SEI
+static void CQWriteUInt64BE(uint8_t *p, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+static uint64_t CQReadUInt64BE(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+NSData *CQTimestampSEICreate(CQVideoCodec codec, CQCaptureTimestamp timestamp) {
+    // NALU头 + payloadType + payloadSize + 负载 + rbsp_trailing_bits
+    uint8_t rbsp[2 + 1 + 1 + kTimestampPayloadSize + 1];
+    size_t offset = 0;
+    if (codec == CQVideoCodecHEVC) {
+        rbsp[offset++] = CQHEVCNaluTypePrefixSEI << 1;  // forbidden_zero_bit 0, nuh_layer_id 0
+        rbsp[offset++] = 0x01;  // nuh_temporal_id_plus1 1
+    } else {
+        rbsp[offset++] = CQH264NaluTypeSEI;  // forbidden_zero_bit 0, nal_ref_idc 0
+    }
+    rbsp[offset++] = kSEIPayloadTypeUserDataUnregistered;
+    rbsp[offset++] = (uint8_t)kTimestampPayloadSize;  // 小于255，一个字节
+    memcpy(rbsp + offset, kTimestampSEIUUID, sizeof(kTimestampSEIUUID));
+    offset += sizeof(kTimestampSEIUUID);
+    CQWriteUInt64BE(rbsp + offset, timestamp.captureTimeUs);
+    offset += 8;
+    CQWriteUInt64BE(rbsp + offset, timestamp.frameID);
+    offset += 8;
+    rbsp[offset++] = 0x80;
+
+    NSMutableData *sei = [NSMutableData dataWithLength:4 + offset + offset / 2 + 1];
+    uint8_t *bytes = sei.mutableBytes;
+    bytes[3] = 0x01;
+    size_t eBSPSize = CQNaluAddEmulationPrevention(rbsp, offset, bytes + 4);
+    sei.length = 4 + eBSPSize;
+    return sei;
+}
+
+BOOL CQTimestampSEIParse(CQVideoCodec codec, const uint8_t *nalu, size_t size, CQCaptureTimestamp *timestamp) {
+    size_t headerSize = CQNaluHeaderSize(codec);
+    if (size < headerSize + 1 || CQNaluKindOf(codec, nalu) != CQNaluKindSEI) return NO;
+    uint8_t stackBuffer[256];
+    uint8_t *rbsp = size <= sizeof(stackBuffer) ? stackBuffer : malloc(size);
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(nalu, size, rbsp);
+
+    BOOL found = NO;
+    size_t offset = headerSize;
+    // 每条sei_message: payloadType和payloadSize都是0xFF累加编码，最后是rbsp_trailing_bits(0x80)
+    while (offset + 2 <= rbspSize && rbsp[offset] != 0x80) {
+        size_t payloadType = 0;
+        while (offset < rbspSize && rbsp[offset] == 0xFF) {
+            payloadType += 255;
+            offset++;
+        }
+        if (offset >= rbspSize) break;
+        payloadType += rbsp[offset++];
+        size_t payloadSize = 0;
+        while (offset < rbspSize && rbsp[offset] == 0xFF) {
+            payloadSize += 255;
+            offset++;
+        }
+        if (offset >= rbspSize) break;
+        payloadSize += rbsp[offset++];
+        if (payloadSize > rbspSize - offset) break;
+
+        if (payloadType == kSEIPayloadTypeUserDataUnregistered && payloadSize >= kTimestampPayloadSize &&
+            memcmp(rbsp + offset, kTimestampSEIUUID, sizeof(kTimestampSEIUUID)) == 0) {
+            timestamp->captureTimeUs = CQReadUInt64BE(rbsp + offset + 16);
+            timestamp->frameID = CQReadUInt64BE(rbsp + offset + 24);
+            found = YES;
+            break;
+        }
+        offset += payloadSize;
+    }
+
+    if (rbsp != stackBuffer) free(rbsp);
+    return found;
+}
@@ -0,0 +1,98 @@
+//
+//  CQFrameTransform.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+/**
+ YUV帧几何变换(NV12/I420): 裁剪 + 旋转 + 镜像 + 缩放 + 填黑边，一次遍历完成
+ @discussion 目标上每个像素反算出源上的坐标(每个轴都是线性的，定点Q16)，旋转90/270度时目标的行对应源的列
+ 不旋转: 先把用到的两行源按垂直权重混合成一行(NEON)，再水平取样，不缩放时直接拷贝或反向拷贝(NEON)
+ 旋转90/270度: 按64x64的块处理，块内源的读取集中在少数缓存行里，不缩放时8x8转置(NEON)
+ 双线性插值，亮度和色度各自按平面处理，NV12的UV按2字节一个像素
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 旋转(顺时针)
+typedef NS_ENUM(uint8_t, CQFrameRotation) {
+    CQFrameRotation0 = 0,
+    CQFrameRotation90 = 1,
+    CQFrameRotation180 = 2,
+    CQFrameRotation270 = 3,
+};
+
+/// 缩放方式
+typedef NS_ENUM(uint8_t, CQFrameScaleMode) {
+    CQFrameScaleModeStretch = 0,  ///< 拉伸到目标宽高
+    CQFrameScaleModeAspectFill = 1,  ///< 保持宽高比，裁掉多出的部分
+    CQFrameScaleModeAspectFit = 2,  ///< 保持宽高比，不足的部分填黑边
+};
+
+/**
+ 几何变换
+ @discussion 顺序: 源上裁剪 -> 顺时针旋转 -> 水平镜像 -> 缩放到目标上的content区域，content以外填黑
+ 所有坐标和宽高都必须是偶数(色度是亮度的一半)
+ */
+typedef struct {
+    size_t cropX, cropY, cropWidth, cropHeight;  ///< 源上的裁剪区域
+    CQFrameRotation rotation;
+    BOOL mirrors;  ///< 旋转后水平镜像(前置摄像头)
+    size_t outputWidth, outputHeight;  ///< 目标宽高
+    size_t contentX, contentY, contentWidth, contentHeight;  ///< 画面在目标上的区域
+} CQFrameTransform;
+
+/// YUV平面
+typedef struct {
+    uint8_t *y;
+    size_t yBytesPerRow;
+    uint8_t *u;  ///< NV12时为UV交错的平面
+    size_t uBytesPerRow;
+    uint8_t *_Nullable v;  ///< NV12时为NULL
+    size_t vBytesPerRow;
+    size_t width;
+    size_t height;
+    BOOL isFullRange;  ///< 决定黑边的亮度(0或16)
+} CQYUVPlanes;
+
+/**
+ 生成变换
+ @discussion 不裁剪整个源，旋转后按mode缩放到目标宽高，裁剪/黑边左右上下对称
+ */
+FOUNDATION_EXPORT CQFrameTransform CQFrameTransformMake(size_t sourceWidth, size_t sourceHeight, CQFrameRotation rotation, BOOL mirrors, size_t outputWidth, size_t outputHeight, CQFrameScaleMode mode);
+
+/// 检查变换是否合法(偶数对齐、裁剪区域在源内、content在目标内)
+FOUNDATION_EXPORT BOOL CQFrameTransformIsValid(const CQFrameTransform *transform, size_t sourceWidth, size_t sourceHeight);
+
+/**
+ 变换目标的[rowBegin, rowEnd)行
+ @discussion rowBegin必须为偶数，不同的行区间可以在不同线程同时变换，arm64上使用NEON
+ @param source 源，宽高为裁剪前的宽高
+ @param destination 目标，宽高为transform的输出宽高，和源同为NV12或同为I420
+ */
+FOUNDATION_EXPORT void CQYUVTransformRows(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t rowBegin, size_t rowEnd);
+
+/**
+ CQYUVTransformRows的标量实现
+ @discussion 结果和CQYUVTransformRows相同，用于基准测试对比
+ */
+FOUNDATION_EXPORT void CQYUVTransformRowsScalar(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t rowBegin, size_t rowEnd);
+
+/**
+ 变换一帧
+ @param bandCount 按行分成几段并行变换(dispatch_apply)，0为按CPU核数和高度自动选择，1为在当前线程变换
+ */
+FOUNDATION_EXPORT void CQYUVTransform(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t bandCount);
+
+/**
+ CVPixelBuffer变换
+ @discussion source和destination同为NV12(420v/420f)或同为I420(y420/f420)，destination的宽高为transform的输出宽高
+ @return 格式不支持返回kCVReturnInvalidPixelFormat，变换和宽高不匹配返回kCVReturnInvalidArgument
+ */
+FOUNDATION_EXPORT CVReturn CQPixelBufferTransform(CVPixelBufferRef source, CVPixelBufferRef destination, const CQFrameTransform *transform);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,469 @@
+//
+//  CQFrameTransform.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 目标content里的(i, j)对应旋转镜像后图像的(rx, ry)，只差一个缩放，再按旋转换算到裁剪区域的坐标:
+   0度 (rx, ry)，90度 (ry, H-1-rx)，180度 (W-1-rx, H-1-ry)，270度 (W-1-ry, rx)，镜像是rx取反
+   所以目标的每个轴只对应源的一个轴，位置 = start + d * step(Q16)，反向时start取另一端、step取负
+ 2 采样点按像素中心对齐: 位置 = (d + 0.5) * 源长 / 目标长 - 0.5，超出两端时取端点，双线性插值的权重取小数部分的高8位
+ 3 不旋转(0/180度): 目标的一行对应源的一行(两行插值)，垂直权重不为0时先把两行混合成一行，NEON一次16个字节，
+   再水平取样；水平不缩放时直接拷贝，反向时NEON一次反转16个字节
+ 4 旋转90/270度: 目标的行对应源的列，逐行处理每个像素都在不同的源行上，按目标的64列分块，块内的64个源行反复使用
+   不缩放时每次8x8转置(NEON vtrn)，反向的轴在转置前反转
+ 5 标量实现走同样的流程，只是把NEON的部分换成逐字节的循环，结果完全相同
+ 6 并行: 按亮度16行(色度8行，正好是转置的块高)对齐分段，dispatch_apply
+ */
+
+#import "CQFrameTransform.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+static const size_t kTileSize = 64;
+static const size_t kMinRowsPerBand = 128;
+static const size_t kBandAlignment = 16;
+
+/// 一个轴的映射: 源位置(Q16) = start + d * step，限制在[0, maxPosition]
+typedef struct {
+    int32_t start;
+    int32_t step;
+    int32_t maxPosition;
+} CQAxisMapping;
+
+/// 一个平面的变换任务
+typedef struct {
+    const uint8_t *source;  ///< 指向裁剪区域的左上角
+    size_t sourceBytesPerRow;
+    size_t sourceWidth;  ///< 裁剪区域的宽高(平面的像素)
+    size_t sourceHeight;
+    uint8_t *destination;
+    size_t destinationBytesPerRow;
+    size_t width;  ///< 目标平面的宽
+    size_t contentX, contentY, contentWidth, contentHeight;
+    size_t pixelSize;  ///< 1或2(NV12的UV)
+    BOOL swapsAxes;  ///< 旋转90/270度，目标的x对应源的y
+    CQAxisMapping x;  ///< 目标content的列
+    CQAxisMapping y;  ///< 目标content的行
+    uint8_t fill[2];  ///< 黑边的值
+} CQPlaneJob;
+
+static inline size_t CQEven(size_t value) {
+    return value & ~(size_t)1;
+}
+
+/// numerator / denominator取最近的偶数，限制在[2, limit]
+static inline size_t CQRoundEven(size_t numerator, size_t denominator, size_t limit) {
+    size_t value = (numerator + denominator) / (denominator * 2) * 2;
+    return MIN(MAX(value, (size_t)2), limit);
+}
+
+CQFrameTransform CQFrameTransformMake(size_t sourceWidth, size_t sourceHeight, CQFrameRotation rotation, BOOL mirrors, size_t outputWidth, size_t outputHeight, CQFrameScaleMode mode) {
+    BOOL swapsAxes = rotation == CQFrameRotation90 || rotation == CQFrameRotation270;
+    // 旋转后的宽高
+    size_t rotatedWidth = swapsAxes ? sourceHeight : sourceWidth;
+    size_t rotatedHeight = swapsAxes ? sourceWidth : sourceHeight;
+    BOOL isWider = rotatedWidth * outputHeight > rotatedHeight * outputWidth;
+    CQFrameTransform transform = {0};
+    transform.cropWidth = CQEven(sourceWidth);
+    transform.cropHeight = CQEven(sourceHeight);
+    transform.rotation = rotation;
+    transform.mirrors = mirrors;
+    transform.outputWidth = outputWidth;
+    transform.outputHeight = outputHeight;
+    transform.contentWidth = outputWidth;
+    transform.contentHeight = outputHeight;
+    if (mode == CQFrameScaleModeAspectFill) {
+        // 旋转后的图像比目标宽就裁宽度，否则裁高度
+        size_t cropRotatedWidth = isWider ? CQRoundEven(rotatedHeight * outputWidth, outputHeight, CQEven(rotatedWidth)) : CQEven(rotatedWidth);
+        size_t cropRotatedHeight = isWider ? CQEven(rotatedHeight) : CQRoundEven(rotatedWidth * outputHeight, outputWidth, CQEven(rotatedHeight));
+        transform.cropWidth = swapsAxes ? cropRotatedHeight : cropRotatedWidth;
+        transform.cropHeight = swapsAxes ? cropRotatedWidth : cropRotatedHeight;
+    } else if (mode == CQFrameScaleModeAspectFit) {
+        transform.contentWidth = isWider ? outputWidth : CQRoundEven(rotatedWidth * outputHeight, rotatedHeight, outputWidth);
+        transform.contentHeight = isWider ? CQRoundEven(rotatedHeight * outputWidth, rotatedWidth, outputHeight) : outputHeight;
+    }
+    transform.cropX = CQEven((sourceWidth - transform.cropWidth) / 2);
+    transform.cropY = CQEven((sourceHeight - transform.cropHeight) / 2);
+    transform.contentX = CQEven((outputWidth - transform.contentWidth) / 2);
+    transform.contentY = CQEven((outputHeight - transform.contentHeight) / 2);
+    return transform;
+}
+
+BOOL CQFrameTransformIsValid(const CQFrameTransform *transform, size_t sourceWidth, size_t sourceHeight) {
+    const CQFrameTransform *t = transform;
+    if ((t->cropX | t->cropY | t->cropWidth | t->cropHeight) & 1) return NO;
+    if ((t->outputWidth | t->outputHeight | t->contentX | t->contentY | t->contentWidth | t->contentHeight) & 1) return NO;
+    if (t->cropWidth == 0 || t->cropHeight == 0 || t->contentWidth == 0 || t->contentHeight == 0) return NO;
+    if (t->rotation > CQFrameRotation270) return NO;
+    if (t->cropX + t->cropWidth > sourceWidth || t->cropY + t->cropHeight > sourceHeight) return NO;
+    return t->contentX + t->contentWidth <= t->outputWidth && t->contentY + t->contentHeight <= t->outputHeight;
+}
+
+#pragma mark - 平面
+static CQAxisMapping CQAxisMappingMake(size_t sourceLength, size_t destinationLength, BOOL isReversed) {
+    CQAxisMapping mapping;
+    mapping.step = (int32_t)(((int64_t)sourceLength << 16) / (int64_t)destinationLength);
+    mapping.start = mapping.step / 2 - 0x8000;
+    mapping.maxPosition = (int32_t)(sourceLength - 1) << 16;
+    if (isReversed) {
+        mapping.start = mapping.maxPosition - mapping.start;
+        mapping.step = -mapping.step;
+    }
+    return mapping;
+}
+
+static inline int32_t CQAxisPosition(const CQAxisMapping *mapping, size_t d) {
+    int32_t position = mapping->start + (int32_t)d * mapping->step;
+    return position < 0 ? 0 : (position > mapping->maxPosition ? mapping->maxPosition : position);
+}
+
+static inline BOOL CQAxisIsUnscaled(const CQAxisMapping *mapping) {
+    return mapping->step == 0x10000 || mapping->step == -0x10000;
+}
+
+/// 平面任务，scale为1(亮度)或2(色度)
+static CQPlaneJob CQPlaneJobMake(const CQFrameTransform *t, const uint8_t *source, size_t sourceBytesPerRow, uint8_t *destination, size_t destinationBytesPerRow, size_t scale, size_t pixelSize, uint8_t fill) {
+    CQPlaneJob job;
+    job.pixelSize = pixelSize;
+    job.source = source + t->cropY / scale * sourceBytesPerRow + t->cropX / scale * pixelSize;
+    job.sourceBytesPerRow = sourceBytesPerRow;
+    job.sourceWidth = t->cropWidth / scale;
+    job.sourceHeight = t->cropHeight / scale;
+    job.destination = destination;
+    job.destinationBytesPerRow = destinationBytesPerRow;
+    job.width = t->outputWidth / scale;
+    job.contentX = t->contentX / scale;
+    job.contentY = t->contentY / scale;
+    job.contentWidth = t->contentWidth / scale;
+    job.contentHeight = t->contentHeight / scale;
+    job.swapsAxes = t->rotation == CQFrameRotation90 || t->rotation == CQFrameRotation270;
+    BOOL reversesX = (t->rotation == CQFrameRotation90 || t->rotation == CQFrameRotation180) != (t->mirrors != NO);
+    BOOL reversesY = t->rotation == CQFrameRotation180 || t->rotation == CQFrameRotation270;
+    job.x = CQAxisMappingMake(job.swapsAxes ? job.sourceHeight : job.sourceWidth, job.contentWidth, reversesX);
+    job.y = CQAxisMappingMake(job.swapsAxes ? job.sourceWidth : job.sourceHeight, job.contentHeight, reversesY);
+    job.fill[0] = fill;
+    job.fill[1] = pixelSize == 2 ? 128 : fill;
+    return job;
+}
+
+static void CQFillPixels(uint8_t *destination, size_t count, const CQPlaneJob *job) {
+    if (count == 0) return;
+    if (job->pixelSize == 1 || job->fill[0] == job->fill[1]) {
+        memset(destination, job->fill[0], count * job->pixelSize);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        destination[i * 2] = job->fill[0];
+        destination[i * 2 + 1] = job->fill[1];
+    }
+}
+
+/// output = (a * (256 - weight) + b * weight + 128) >> 8，weight为1~255
+static void CQBlendRows(const uint8_t *a, const uint8_t *b, uint8_t *output, size_t length, uint8_t weight, BOOL usesSIMD) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    if (usesSIMD) {
+        const uint8x8_t weightA = vdup_n_u8((uint8_t)(256 - weight)), weightB = vdup_n_u8(weight);
+        for (; i + 16 <= length; i += 16) {
+            uint8x16_t va = vld1q_u8(a + i), vb = vld1q_u8(b + i);
+            uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(va), weightA), vget_low_u8(vb), weightB);
+            uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(va), weightA), vget_high_u8(vb), weightB);
+            vst1q_u8(output + i, vcombine_u8(vrshrn_n_u16(low, 8), vrshrn_n_u16(high, 8)));
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        output[i] = (uint8_t)((a[i] * (256 - weight) + b[i] * weight + 128) >> 8);
+    }
+}
+
+/// 反向拷贝count个像素: output的第i个像素 = input的第count - 1 - i个像素
+static void CQReverseCopy(const uint8_t *input, uint8_t *output, size_t count, size_t pixelSize, BOOL usesSIMD) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    if (usesSIMD) {
+        size_t pixelsPerVector = 16 / pixelSize;
+        for (; i + pixelsPerVector <= count; i += pixelsPerVector) {
+            uint8x16_t value = vld1q_u8(input + (count - i - pixelsPerVector) * pixelSize);
+            // 先反转两个64位内部，再交换两个64位
+            value = pixelSize == 1 ? vrev64q_u8(value) : vreinterpretq_u8_u16(vrev64q_u16(vreinterpretq_u16_u8(value)));
+            vst1q_u8(output + i * pixelSize, vextq_u8(value, value, 8));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        const uint8_t *pixel = input + (count - 1 - i) * pixelSize;
+        output[i * pixelSize] = pixel[0];
+        if (pixelSize == 2) output[i * pixelSize + 1] = pixel[1];
+    }
+}
+
+/// 水平双线性取样content的一行
+static void CQSampleRow(const uint8_t *row, uint8_t *output, const CQPlaneJob *job, const CQAxisMapping *mapping, size_t sourceLength) {
+    size_t pixelSize = job->pixelSize;
+    for (size_t i = 0; i < job->contentWidth; i++) {
+        int32_t position = CQAxisPosition(mapping, i);
+        size_t index0 = (size_t)(position >> 16);
+        size_t index1 = MIN(index0 + 1, sourceLength - 1);
+        int weight = (position >> 8) & 0xFF;
+        for (size_t c = 0; c < pixelSize; c++) {
+            output[i * pixelSize + c] = (uint8_t)((row[index0 * pixelSize + c] * (256 - weight) + row[index1 * pixelSize + c] * weight + 128) >> 8);
+        }
+    }
+}
+
+/// 不旋转: content的第j行
+static void CQTransformRowDirect(const CQPlaneJob *job, size_t j, uint8_t *output, uint8_t *rowBuffer, BOOL usesSIMD) {
+    int32_t position = CQAxisPosition(&job->y, j);
+    size_t sourceRow = (size_t)(position >> 16);
+    uint8_t weight = (uint8_t)((position >> 8) & 0xFF);
+    const uint8_t *row = job->source + sourceRow * job->sourceBytesPerRow;
+    if (weight) {
+        const uint8_t *nextRow = job->source + MIN(sourceRow + 1, job->sourceHeight - 1) * job->sourceBytesPerRow;
+        CQBlendRows(row, nextRow, rowBuffer, job->sourceWidth * job->pixelSize, weight, usesSIMD);
+        row = rowBuffer;
+    }
+    if (job->x.step == 0x10000) {
+        memcpy(output, row, job->contentWidth * job->pixelSize);
+    } else if (job->x.step == -0x10000) {
+        CQReverseCopy(row, output, job->contentWidth, job->pixelSize, usesSIMD);
+    } else {
+        CQSampleRow(row, output, job, &job->x, job->sourceWidth);
+    }
+}
+
+/// 旋转90/270度: content的(i, j)双线性取样，i对应源的行，j对应源的列
+static inline void CQSampleSwapped(const CQPlaneJob *job, size_t i, size_t j, uint8_t *output) {
+    int32_t rowPosition = CQAxisPosition(&job->x, i);
+    int32_t columnPosition = CQAxisPosition(&job->y, j);
+    size_t row0 = (size_t)(rowPosition >> 16), row1 = MIN(row0 + 1, job->sourceHeight - 1);
+    size_t column0 = (size_t)(columnPosition >> 16), column1 = MIN(column0 + 1, job->sourceWidth - 1);
+    int rowWeight = (rowPosition >> 8) & 0xFF, columnWeight = (columnPosition >> 8) & 0xFF;
+    const uint8_t *top = job->source + row0 * job->sourceBytesPerRow;
+    const uint8_t *bottom = job->source + row1 * job->sourceBytesPerRow;
+    for (size_t c = 0; c < job->pixelSize; c++) {
+        size_t offset0 = column0 * job->pixelSize + c, offset1 = column1 * job->pixelSize + c;
+        int a = (top[offset0] * (256 - rowWeight) + bottom[offset0] * rowWeight + 128) >> 8;
+        int b = (top[offset1] * (256 - rowWeight) + bottom[offset1] * rowWeight + 128) >> 8;
+        output[c] = (uint8_t)((a * (256 - columnWeight) + b * columnWeight + 128) >> 8);
+    }
+}
+
+/**
+ 8x8转置
+ @discussion rows[k]指向第k个源行上8个像素中地址最小的一个，输出第m行第k个像素 = rows[k]的第m个像素(reverses时为第7 - m个)
+ */
+static void CQTranspose8x8(const uint8_t *rows[8], BOOL reverses, size_t pixelSize, uint8_t *output, size_t outputBytesPerRow, BOOL usesSIMD) {
+#if defined(__aarch64__)
+    if (usesSIMD && pixelSize == 1) {
+        uint8x8_t r[8];
+        for (int k = 0; k < 8; k++) {
+            r[k] = vld1_u8(rows[k]);
+            if (reverses) r[k] = vrev64_u8(r[k]);
+        }
+        // 8位、16位、32位三次交换
+        uint8x8x2_t a0 = vtrn_u8(r[0], r[1]), a1 = vtrn_u8(r[2], r[3]), a2 = vtrn_u8(r[4], r[5]), a3 = vtrn_u8(r[6], r[7]);
+        uint16x4x2_t b0 = vtrn_u16(vreinterpret_u16_u8(a0.val[0]), vreinterpret_u16_u8(a1.val[0]));
+        uint16x4x2_t b1 = vtrn_u16(vreinterpret_u16_u8(a0.val[1]), vreinterpret_u16_u8(a1.val[1]));
+        uint16x4x2_t b2 = vtrn_u16(vreinterpret_u16_u8(a2.val[0]), vreinterpret_u16_u8(a3.val[0]));
+        uint16x4x2_t b3 = vtrn_u16(vreinterpret_u16_u8(a2.val[1]), vreinterpret_u16_u8(a3.val[1]));
+        uint32x2x2_t c0 = vtrn_u32(vreinterpret_u32_u16(b0.val[0]), vreinterpret_u32_u16(b2.val[0]));
+        uint32x2x2_t c1 = vtrn_u32(vreinterpret_u32_u16(b1.val[0]), vreinterpret_u32_u16(b3.val[0]));
+        uint32x2x2_t c2 = vtrn_u32(vreinterpret_u32_u16(b0.val[1]), vreinterpret_u32_u16(b2.val[1]));
+        uint32x2x2_t c3 = vtrn_u32(vreinterpret_u32_u16(b1.val[1]), vreinterpret_u32_u16(b3.val[1]));
+        uint32x2_t columns[8] = {c0.val[0], c1.val[0], c2.val[0], c3.val[0], c0.val[1], c1.val[1], c2.val[1], c3.val[1]};
+        for (int m = 0; m < 8; m++) {
+            vst1_u8(output + m * outputBytesPerRow, vreinterpret_u8_u32(columns[m]));
+        }
+        return;
+    }
+    if (usesSIMD && pixelSize == 2) {
+        uint16x8_t r[8];
+        for (int k = 0; k < 8; k++) {
+            r[k] = vreinterpretq_u16_u8(vld1q_u8(rows[k]));
+            if (reverses) {
+                r[k] = vrev64q_u16(r[k]);
+                r[k] = vextq_u16(r[k], r[k], 4);
+            }
+        }
+        // 16位、32位交换，最后按64位拼接
+        uint16x8x2_t a0 = vtrnq_u16(r[0], r[1]), a1 = vtrnq_u16(r[2], r[3]), a2 = vtrnq_u16(r[4], r[5]), a3 = vtrnq_u16(r[6], r[7]);
+        uint32x4x2_t b0 = vtrnq_u32(vreinterpretq_u32_u16(a0.val[0]), vreinterpretq_u32_u16(a1.val[0]));
+        uint32x4x2_t b1 = vtrnq_u32(vreinterpretq_u32_u16(a0.val[1]), vreinterpretq_u32_u16(a1.val[1]));
+        uint32x4x2_t b2 = vtrnq_u32(vreinterpretq_u32_u16(a2.val[0]), vreinterpretq_u32_u16(a3.val[0]));
+        uint32x4x2_t b3 = vtrnq_u32(vreinterpretq_u32_u16(a2.val[1]), vreinterpretq_u32_u16(a3.val[1]));
+        uint32x4_t top[4] = {b0.val[0], b1.val[0], b0.val[1], b1.val[1]};
+        uint32x4_t bottom[4] = {b2.val[0], b3.val[0], b2.val[1], b3.val[1]};
+        for (int m = 0; m < 4; m++) {
+            vst1q_u8(output + m * outputBytesPerRow, vreinterpretq_u8_u32(vcombine_u32(vget_low_u32(top[m]), vget_low_u32(bottom[m]))));
+            vst1q_u8(output + (m + 4) * outputBytesPerRow, vreinterpretq_u8_u32(vcombine_u32(vget_high_u32(top[m]), vget_high_u32(bottom[m]))));
+        }
+        return;
+    }
+#endif
+    for (int m = 0; m < 8; m++) {
+        uint8_t *outputRow = output + m * outputBytesPerRow;
+        int column = reverses ? 7 - m : m;
+        for (int k = 0; k < 8; k++) {
+            for (size_t c = 0; c < pixelSize; c++) {
+                outputRow[k * pixelSize + c] = rows[k][column * pixelSize + c];
+            }
+        }
+    }
+}
+
+/// 旋转90/270度: content的[jBegin, jEnd)行，按kTileSize列分块
+static void CQTransformRowsSwapped(const CQPlaneJob *job, size_t jBegin, size_t jEnd, BOOL usesSIMD) {
+    size_t pixelSize = job->pixelSize;
+    uint8_t *content = job->destination + job->contentY * job->destinationBytesPerRow + job->contentX * pixelSize;
+    BOOL isUnscaled = CQAxisIsUnscaled(&job->x) && CQAxisIsUnscaled(&job->y);
+    // 不缩放时整8行用转置，剩下的行逐像素
+    size_t blockEnd = isUnscaled ? jBegin + (jEnd - jBegin) / 8 * 8 : jBegin;
+    BOOL reversesColumns = job->y.step < 0;
+    for (size_t tileBegin = 0; tileBegin < job->contentWidth; tileBegin += kTileSize) {
+        size_t tileEnd = MIN(tileBegin + kTileSize, job->contentWidth);
+        for (size_t j = jBegin; j < blockEnd; j += 8) {
+            // 目标的8行对应源上连续的8列
+            size_t column = (size_t)(CQAxisPosition(&job->y, reversesColumns ? j + 7 : j) >> 16);
+            size_t i = tileBegin;
+            for (; i + 8 <= tileEnd; i += 8) {
+                const uint8_t *rows[8];
+                for (int k = 0; k < 8; k++) {
+                    size_t sourceRow = (size_t)(CQAxisPosition(&job->x, i + k) >> 16);
+                    rows[k] = job->source + sourceRow * job->sourceBytesPerRow + column * pixelSize;
+                }
+                CQTranspose8x8(rows, reversesColumns, pixelSize, content + j * job->destinationBytesPerRow + i * pixelSize, job->destinationBytesPerRow, usesSIMD);
+            }
+            for (; i < tileEnd; i++) {
+                for (size_t m = 0; m < 8; m++) {
+                    CQSampleSwapped(job, i, j + m, content + (j + m) * job->destinationBytesPerRow + i * pixelSize);
+                }
+            }
+        }
+        for (size_t j = blockEnd; j < jEnd; j++) {
+            uint8_t *output = content + j * job->destinationBytesPerRow;
+            for (size_t i = tileBegin; i < tileEnd; i++) {
+                CQSampleSwapped(job, i, j, output + i * pixelSize);
+            }
+        }
+    }
+}
+
+/// 目标平面的[rowBegin, rowEnd)行
+static void CQPlaneTransformRows(const CQPlaneJob *job, size_t rowBegin, size_t rowEnd, uint8_t *rowBuffer, BOOL usesSIMD) {
+    size_t pixelSize = job->pixelSize;
+    size_t contentEnd = job->contentY + job->contentHeight;
+    size_t rightBegin = job->contentX + job->contentWidth;
+    for (size_t row = rowBegin; row < rowEnd; row++) {
+        uint8_t *output = job->destination + row * job->destinationBytesPerRow;
+        if (row < job->contentY || row >= contentEnd) {
+            CQFillPixels(output, job->width, job);
+            continue;
+        }
+        CQFillPixels(output, job->contentX, job);
+        CQFillPixels(output + rightBegin * pixelSize, job->width - rightBegin, job);
+        if (!job->swapsAxes) {
+            CQTransformRowDirect(job, row - job->contentY, output + job->contentX * pixelSize, rowBuffer, usesSIMD);
+        }
+    }
+    if (job->swapsAxes) {
+        size_t jBegin = MAX(rowBegin, job->contentY), jEnd = MIN(rowEnd, contentEnd);
+        if (jBegin < jEnd) CQTransformRowsSwapped(job, jBegin - job->contentY, jEnd - job->contentY, usesSIMD);
+    }
+}
+
+#pragma mark - 帧
+static void CQYUVTransformRowsInternal(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t rowBegin, size_t rowEnd, BOOL usesSIMD) {
+    rowEnd = MIN(rowEnd, destination->height);
+    if (rowBegin >= rowEnd) return;
+    BOOL isNV12 = destination->v == NULL;
+    // 混合两行的缓冲，亮度和色度的一行字节数相同
+    uint8_t *rowBuffer = malloc(transform->cropWidth);
+    CQPlaneJob luma = CQPlaneJobMake(transform, source->y, source->yBytesPerRow, destination->y, destination->yBytesPerRow, 1, 1, destination->isFullRange ? 0 : 16);
+    CQPlaneTransformRows(&luma, rowBegin, rowEnd, rowBuffer, usesSIMD);
+    size_t chromaBegin = rowBegin / 2, chromaEnd = (rowEnd + 1) / 2;
+    CQPlaneJob u = CQPlaneJobMake(transform, source->u, source->uBytesPerRow, destination->u, destination->uBytesPerRow, 2, isNV12 ? 2 : 1, 128);
+    CQPlaneTransformRows(&u, chromaBegin, chromaEnd, rowBuffer, usesSIMD);
+    if (!isNV12) {
+        CQPlaneJob v = CQPlaneJobMake(transform, source->v, source->vBytesPerRow, destination->v, destination->vBytesPerRow, 2, 1, 128);
+        CQPlaneTransformRows(&v, chromaBegin, chromaEnd, rowBuffer, usesSIMD);
+    }
+    free(rowBuffer);
+}
+
+void CQYUVTransformRows(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t rowBegin, size_t rowEnd) {
+    CQYUVTransformRowsInternal(source, destination, transform, rowBegin, rowEnd, YES);
+}
+
+void CQYUVTransformRowsScalar(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t rowBegin, size_t rowEnd) {
+    CQYUVTransformRowsInternal(source, destination, transform, rowBegin, rowEnd, NO);
+}
+
+void CQYUVTransform(const CQYUVPlanes *source, const CQYUVPlanes *destination, const CQFrameTransform *transform, size_t bandCount) {
+    size_t height = destination->height;
+    if (bandCount == 0) {
+        bandCount = MIN([NSProcessInfo processInfo].activeProcessorCount, height / kMinRowsPerBand);
+    }
+    size_t rowsPerBand = (height + MAX(bandCount, (size_t)1) - 1) / MAX(bandCount, (size_t)1);
+    rowsPerBand = (rowsPerBand + kBandAlignment - 1) / kBandAlignment * kBandAlignment;
+    bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+    if (bandCount <= 1) {
+        CQYUVTransformRows(source, destination, transform, 0, height);
+        return;
+    }
+    dispatch_apply(bandCount, DISPATCH_APPLY_AUTO, ^(size_t band) {
+        CQYUVTransformRows(source, destination, transform, band * rowsPerBand, (band + 1) * rowsPerBand);
+    });
+}
+
+/// 锁定后的CVPixelBuffer平面
+static CQYUVPlanes CQYUVPlanesFromPixelBuffer(CVPixelBufferRef pixelBuffer) {
+    OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    BOOL isI420 = format == kCVPixelFormatType_420YpCbCr8Planar || format == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    CQYUVPlanes planes = {0};
+    planes.y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+    planes.yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    planes.u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+    planes.uBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+    if (isI420) {
+        planes.v = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 2);
+        planes.vBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 2);
+    }
+    planes.width = CVPixelBufferGetWidth(pixelBuffer);
+    planes.height = CVPixelBufferGetHeight(pixelBuffer);
+    planes.isFullRange = format == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange || format == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    return planes;
+}
+
+CVReturn CQPixelBufferTransform(CVPixelBufferRef source, CVPixelBufferRef destination, const CQFrameTransform *transform) {
+    OSType sourceFormat = CVPixelBufferGetPixelFormatType(source);
+    OSType destinationFormat = CVPixelBufferGetPixelFormatType(destination);
+    BOOL isSourceNV12 = sourceFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange || sourceFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+    BOOL isSourceI420 = sourceFormat == kCVPixelFormatType_420YpCbCr8Planar || sourceFormat == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    BOOL isDestinationNV12 = destinationFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange || destinationFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+    BOOL isDestinationI420 = destinationFormat == kCVPixelFormatType_420YpCbCr8Planar || destinationFormat == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    if (!((isSourceNV12 && isDestinationNV12) || (isSourceI420 && isDestinationI420))) return kCVReturnInvalidPixelFormat;
+    if (!CQFrameTransformIsValid(transform, CVPixelBufferGetWidth(source), CVPixelBufferGetHeight(source))) return kCVReturnInvalidArgument;
+    if (CVPixelBufferGetWidth(destination) != transform->outputWidth || CVPixelBufferGetHeight(destination) != transform->outputHeight) return kCVReturnInvalidArgument;
+
+    CVReturn result = CVPixelBufferLockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+    if (result != kCVReturnSuccess) return result;
+    result = CVPixelBufferLockBaseAddress(destination, 0);
+    if (result != kCVReturnSuccess) {
+        CVPixelBufferUnlockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+        return result;
+    }
+    CQYUVPlanes sourcePlanes = CQYUVPlanesFromPixelBuffer(source);
+    CQYUVPlanes destinationPlanes = CQYUVPlanesFromPixelBuffer(destination);
+    CQYUVTransform(&sourcePlanes, &destinationPlanes, transform, 0);
+    CVPixelBufferUnlockBaseAddress(destination, 0);
+    CVPixelBufferUnlockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+    // 色彩信息(矩阵、原色等)跟随源
+    CVBufferPropagateAttachments(source, destination);
+    return kCVReturnSuccess;
+}
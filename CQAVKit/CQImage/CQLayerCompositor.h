@@ -0,0 +1,92 @@
+//
+//  CQLayerCompositor.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQFrameTransform.h"
+#import "CQYUVConverter.h"
+
+/**
+ 多图层合成(NV12画布)
+ @discussion 画中画(前后摄像头)、水印、时间码等图层按位置/大小/叠放顺序/不透明度叠加到一个画布上，输出一帧NV12
+ 图层内容更新时就转换成画布的格式和图层的大小保存下来(YUV源用CQFrameTransform缩放，RGBA源转换成YUV + 透明度)，
+ 合成时只做逐行的拷贝或alpha混合(NEON)；画布按64x64分块记录变化过的区域，只重新合成这些块，
+ 内容和位置都不变的图层下面也不变时完全不用重新混合；不同的块行可以在不同线程同时合成
+ 不是线程安全的，调用方负责串行
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 图层的位置和叠放
+typedef struct {
+    int32_t x, y;  ///< 左上角在画布上的位置(偶数)，可以是负数，超出画布的部分裁掉
+    size_t width, height;  ///< 图层宽高(偶数)
+    int32_t zOrder;  ///< 从小到大依次叠放，相同时先添加的在下面
+    uint8_t opacity;  ///< 整体不透明度，255为不透明，0为隐藏
+} CQLayerGeometry;
+
+typedef struct CQLayerCompositor CQLayerCompositor;
+
+/**
+ 创建合成器
+ @param width 画布宽(偶数)
+ @param height 画布高(偶数)
+ @param isFullRange 决定背景黑色的亮度(0或16)
+ */
+FOUNDATION_EXPORT CQLayerCompositor *CQLayerCompositorCreate(size_t width, size_t height, BOOL isFullRange);
+
+FOUNDATION_EXPORT void CQLayerCompositorDestroy(CQLayerCompositor *compositor);
+
+/**
+ 添加或修改图层
+ @discussion 旧区域和新区域标记为变化，宽高变化时清掉内容(需要重新更新)
+ @return 图层数已满(最多8个)或位置、宽高不合法返回NO
+ */
+FOUNDATION_EXPORT BOOL CQLayerCompositorSetLayer(CQLayerCompositor *compositor, uint32_t layerID, CQLayerGeometry geometry);
+
+FOUNDATION_EXPORT void CQLayerCompositorRemoveLayer(CQLayerCompositor *compositor, uint32_t layerID);
+
+/**
+ 用NV12更新图层内容
+ @discussion 保持宽高比缩放到图层宽高(AspectFill)，不透明
+ @return 图层不存在或源不是NV12返回NO
+ */
+FOUNDATION_EXPORT BOOL CQLayerCompositorUpdateYUV(CQLayerCompositor *compositor, uint32_t layerID, const CQYUVPlanes *source);
+
+/**
+ 用RGBA更新图层内容
+ @discussion 不缩放，宽高必须和图层相同(水印、时间码一般按输出分辨率绘制)；透明度全为255时按不透明图层处理
+ @param isPremultiplied 颜色是否已经乘过透明度(CoreGraphics绘制的位图是)
+ @return 图层不存在或宽高不同返回NO
+ */
+FOUNDATION_EXPORT BOOL CQLayerCompositorUpdateRGBA(CQLayerCompositor *compositor, uint32_t layerID, const uint8_t *rgba, size_t bytesPerRow, size_t width, size_t height, CQRGBOrder order, BOOL isPremultiplied);
+
+/// 整个画布标记为变化
+FOUNDATION_EXPORT void CQLayerCompositorInvalidate(CQLayerCompositor *compositor);
+
+/**
+ 合成一帧
+ @discussion 重新合成变化过的块，再把整个画布拷贝到destination
+ @param destination NV12，宽高和画布相同
+ @param bandCount 按块行分成几段并行合成(dispatch_apply)，0为按CPU核数和高度自动选择，1为在当前线程合成
+ @return 这次重新合成的块数
+ */
+FOUNDATION_EXPORT size_t CQLayerCompositorCompose(CQLayerCompositor *compositor, const CQYUVPlanes *destination, size_t bandCount);
+
+/**
+ alpha混合一行
+ @discussion destination = (source * a + destination * (255 - a)) / 255(四舍五入)，a = alpha * opacity / 255，
+ alpha为NULL时a = opacity；arm64上使用NEON一次16个字节
+ */
+FOUNDATION_EXPORT void CQAlphaBlendRow(uint8_t *destination, const uint8_t *source, const uint8_t *_Nullable alpha, uint8_t opacity, size_t length);
+
+/**
+ CQAlphaBlendRow的标量实现
+ @discussion 结果和CQAlphaBlendRow相同，用于基准测试对比
+ */
+FOUNDATION_EXPORT void CQAlphaBlendRowScalar(uint8_t *destination, const uint8_t *source, const uint8_t *_Nullable alpha, uint8_t opacity, size_t length);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,404 @@
+//
+//  CQLayerCompositor.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 图层按(zOrder, 添加顺序)排好序放在数组里，合成时从下往上画，不用每帧排序
+ 2 图层自己保存一份和图层一样大的NV12(和透明度)，内容更新时转换一次，合成时只按行拷贝或混合，
+   RGBA图层的色度透明度取2x2的平均值，U、V各存一份，和UV交错的平面按字节一一对应，亮度和色度用同一个混合函数
+ 3 变化的记录: 画布按64x64分块，图层的内容更新、移动、改变叠放或透明度时标记它覆盖的块(移动时新旧两个区域)，
+   合成时只重新画这些块，其它块保持上一帧的结果
+ 4 一行中连续的变化块合成一段，先找完全覆盖这一段的最上面的不透明图层，它下面的图层和背景都不用画
+ 5 混合 (s * a + d * (255 - a)) / 255: 乘积不超过65025，除以255用 (x + 128 + ((x + 128) >> 8)) >> 8，
+   结果就是四舍五入，NEON用vaddhn一步算出高8位，和标量完全相同
+ 6 画布保存在内部，合成后整帧拷贝到输出(输出一般取自缓冲池，里面是几帧之前的内容)，拷贝也按块行分段并行
+ */
+
+#import "CQLayerCompositor.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+#define kMaxLayers 8  ///< 图层最多个数
+static const size_t kTileSize = 64;
+static const size_t kMinTileRowsPerBand = 2;
+
+/// 图层
+typedef struct {
+    uint32_t layerID;
+    CQLayerGeometry geometry;
+    uint64_t sequence;  ///< 添加顺序
+    uint8_t *y;  ///< width * height
+    uint8_t *uv;  ///< width * height / 2
+    uint8_t *_Nullable alpha;  ///< 亮度的透明度，不透明时为NULL
+    uint8_t *_Nullable chromaAlpha;  ///< 色度的透明度，和uv一样大
+    BOOL hasContent;  ///< 内容是否已经更新过
+} CQCompositorLayer;
+
+struct CQLayerCompositor {
+    size_t width;
+    size_t height;
+    uint8_t *y;  ///< 画布
+    uint8_t *uv;
+    uint8_t blackLuma;
+    size_t tileColumns;
+    size_t tileRows;
+    uint8_t *dirtyTiles;  ///< 变化的块
+    CQCompositorLayer layers[kMaxLayers];  ///< 按叠放顺序排好
+    size_t layerCount;
+    uint64_t nextSequence;
+};
+
+#pragma mark - 混合
+/// 除以255并四舍五入，x不超过65025
+static inline uint8_t CQDivide255(uint32_t x) {
+    x += 128;
+    return (uint8_t)((x + (x >> 8)) >> 8);
+}
+
+#if defined(__aarch64__)
+static inline uint8x8_t CQDivide255NEON(uint16x8_t x) {
+    uint16x8_t rounded = vaddq_u16(x, vdupq_n_u16(128));
+    return vaddhn_u16(rounded, vshrq_n_u16(rounded, 8));
+}
+#endif
+
+static void CQAlphaBlendRowInternal(uint8_t *destination, const uint8_t *source, const uint8_t *alpha, uint8_t opacity, size_t length, BOOL usesSIMD) {
+    if (!alpha && opacity == 255) {
+        memcpy(destination, source, length);
+        return;
+    }
+    if (!alpha && opacity == 0) return;
+    size_t i = 0;
+#if defined(__aarch64__)
+    if (usesSIMD) {
+        const uint8x16_t opacityVector = vdupq_n_u8(opacity);
+        for (; i + 16 <= length; i += 16) {
+            uint8x16_t a = opacityVector;
+            if (alpha) {
+                a = vld1q_u8(alpha + i);
+                if (opacity != 255) {
+                    a = vcombine_u8(CQDivide255NEON(vmull_u8(vget_low_u8(a), vget_low_u8(opacityVector))), CQDivide255NEON(vmull_u8(vget_high_u8(a), vget_high_u8(opacityVector))));
+                }
+            }
+            uint8x16_t s = vld1q_u8(source + i), d = vld1q_u8(destination + i), inverse = vmvnq_u8(a);
+            uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(s), vget_low_u8(a)), vget_low_u8(d), vget_low_u8(inverse));
+            uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(s), vget_high_u8(a)), vget_high_u8(d), vget_high_u8(inverse));
+            vst1q_u8(destination + i, vcombine_u8(CQDivide255NEON(low), CQDivide255NEON(high)));
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        uint32_t a = opacity;
+        if (alpha) a = opacity == 255 ? alpha[i] : CQDivide255(alpha[i] * opacity);
+        destination[i] = CQDivide255(source[i] * a + destination[i] * (255 - a));
+    }
+}
+
+void CQAlphaBlendRow(uint8_t *destination, const uint8_t *source, const uint8_t *alpha, uint8_t opacity, size_t length) {
+    CQAlphaBlendRowInternal(destination, source, alpha, opacity, length, YES);
+}
+
+void CQAlphaBlendRowScalar(uint8_t *destination, const uint8_t *source, const uint8_t *alpha, uint8_t opacity, size_t length) {
+    CQAlphaBlendRowInternal(destination, source, alpha, opacity, length, NO);
+}
+
+#pragma mark - 图层
+static inline BOOL CQLayerIsVisible(const CQCompositorLayer *layer) {
+    return layer->hasContent && layer->geometry.opacity > 0;
+}
+
+static inline BOOL CQLayerIsOpaque(const CQCompositorLayer *layer) {
+    return CQLayerIsVisible(layer) && !layer->alpha && layer->geometry.opacity == 255;
+}
+
+static void CQLayerFreeContent(CQCompositorLayer *layer) {
+    free(layer->y);
+    free(layer->uv);
+    free(layer->alpha);
+    free(layer->chromaAlpha);
+    layer->y = layer->uv = layer->alpha = layer->chromaAlpha = NULL;
+    layer->hasContent = NO;
+}
+
+static CQCompositorLayer *CQLayerFind(CQLayerCompositor *compositor, uint32_t layerID) {
+    for (size_t i = 0; i < compositor->layerCount; i++) {
+        if (compositor->layers[i].layerID == layerID) return &compositor->layers[i];
+    }
+    return NULL;
+}
+
+/// 按(zOrder, 添加顺序)插入排序，图层很少
+static void CQLayersSort(CQLayerCompositor *compositor) {
+    for (size_t i = 1; i < compositor->layerCount; i++) {
+        CQCompositorLayer layer = compositor->layers[i];
+        size_t j = i;
+        for (; j > 0; j--) {
+            const CQCompositorLayer *previous = &compositor->layers[j - 1];
+            if (previous->geometry.zOrder < layer.geometry.zOrder || (previous->geometry.zOrder == layer.geometry.zOrder && previous->sequence < layer.sequence)) break;
+            compositor->layers[j] = *previous;
+        }
+        compositor->layers[j] = layer;
+    }
+}
+
+/// 标记图层覆盖的块
+static void CQMarkLayer(CQLayerCompositor *compositor, const CQCompositorLayer *layer) {
+    if (!CQLayerIsVisible(layer)) return;
+    const CQLayerGeometry *g = &layer->geometry;
+    int64_t x0 = MAX((int64_t)g->x, 0), y0 = MAX((int64_t)g->y, 0);
+    int64_t x1 = MIN((int64_t)g->x + (int64_t)g->width, (int64_t)compositor->width);
+    int64_t y1 = MIN((int64_t)g->y + (int64_t)g->height, (int64_t)compositor->height);
+    if (x0 >= x1 || y0 >= y1) return;
+    for (size_t row = (size_t)y0 / kTileSize; row <= (size_t)(y1 - 1) / kTileSize; row++) {
+        memset(compositor->dirtyTiles + row * compositor->tileColumns + (size_t)x0 / kTileSize, 1, (size_t)(x1 - 1) / kTileSize - (size_t)x0 / kTileSize + 1);
+    }
+}
+
+#pragma mark - Public Func
+CQLayerCompositor *CQLayerCompositorCreate(size_t width, size_t height, BOOL isFullRange) {
+    CQLayerCompositor *compositor = calloc(1, sizeof(CQLayerCompositor));
+    compositor->width = width & ~(size_t)1;
+    compositor->height = height & ~(size_t)1;
+    compositor->y = malloc(compositor->width * compositor->height);
+    compositor->uv = malloc(compositor->width * compositor->height / 2);
+    compositor->blackLuma = isFullRange ? 0 : 16;
+    compositor->tileColumns = (compositor->width + kTileSize - 1) / kTileSize;
+    compositor->tileRows = (compositor->height + kTileSize - 1) / kTileSize;
+    compositor->dirtyTiles = malloc(compositor->tileColumns * compositor->tileRows);
+    // 第一帧整个画布都要画背景
+    memset(compositor->dirtyTiles, 1, compositor->tileColumns * compositor->tileRows);
+    return compositor;
+}
+
+void CQLayerCompositorDestroy(CQLayerCompositor *compositor) {
+    if (!compositor) return;
+    for (size_t i = 0; i < compositor->layerCount; i++) {
+        CQLayerFreeContent(&compositor->layers[i]);
+    }
+    free(compositor->y);
+    free(compositor->uv);
+    free(compositor->dirtyTiles);
+    free(compositor);
+}
+
+BOOL CQLayerCompositorSetLayer(CQLayerCompositor *compositor, uint32_t layerID, CQLayerGeometry geometry) {
+    if (geometry.width < 2 || geometry.height < 2 || ((geometry.x | geometry.y) & 1) || ((geometry.width | geometry.height) & 1)) return NO;
+    CQCompositorLayer *layer = CQLayerFind(compositor, layerID);
+    if (!layer) {
+        if (compositor->layerCount == kMaxLayers) return NO;
+        layer = &compositor->layers[compositor->layerCount++];
+        memset(layer, 0, sizeof(CQCompositorLayer));
+        layer->layerID = layerID;
+        layer->sequence = compositor->nextSequence++;
+    } else {
+        if (memcmp(&layer->geometry, &geometry, sizeof(CQLayerGeometry)) == 0) return YES;
+        CQMarkLayer(compositor, layer);
+    }
+    if (layer->geometry.width != geometry.width || layer->geometry.height != geometry.height) {
+        CQLayerFreeContent(layer);
+    }
+    layer->geometry = geometry;
+    CQMarkLayer(compositor, layer);
+    CQLayersSort(compositor);
+    return YES;
+}
+
+void CQLayerCompositorRemoveLayer(CQLayerCompositor *compositor, uint32_t layerID) {
+    CQCompositorLayer *layer = CQLayerFind(compositor, layerID);
+    if (!layer) return;
+    CQMarkLayer(compositor, layer);
+    CQLayerFreeContent(layer);
+    size_t index = (size_t)(layer - compositor->layers);
+    memmove(layer, layer + 1, (compositor->layerCount - index - 1) * sizeof(CQCompositorLayer));
+    compositor->layerCount--;
+}
+
+/// 分配内容，宽高不变时复用
+static void CQLayerPrepareContent(CQCompositorLayer *layer) {
+    if (layer->y) return;
+    layer->y = malloc(layer->geometry.width * layer->geometry.height);
+    layer->uv = malloc(layer->geometry.width * layer->geometry.height / 2);
+}
+
+BOOL CQLayerCompositorUpdateYUV(CQLayerCompositor *compositor, uint32_t layerID, const CQYUVPlanes *source) {
+    CQCompositorLayer *layer = CQLayerFind(compositor, layerID);
+    if (!layer || source->v || source->width < 2 || source->height < 2) return NO;
+    size_t width = layer->geometry.width, height = layer->geometry.height;
+    CQLayerPrepareContent(layer);
+    CQYUVPlanes destination = {0};
+    destination.y = layer->y;
+    destination.yBytesPerRow = width;
+    destination.u = layer->uv;
+    destination.uBytesPerRow = width;
+    destination.width = width;
+    destination.height = height;
+    destination.isFullRange = source->isFullRange;
+    CQFrameTransform transform = CQFrameTransformMake(source->width, source->height, CQFrameRotation0, NO, width, height, CQFrameScaleModeAspectFill);
+    CQYUVTransform(source, &destination, &transform, 0);
+    free(layer->alpha);
+    free(layer->chromaAlpha);
+    layer->alpha = layer->chromaAlpha = NULL;
+    layer->hasContent = YES;
+    CQMarkLayer(compositor, layer);
+    return YES;
+}
+
+BOOL CQLayerCompositorUpdateRGBA(CQLayerCompositor *compositor, uint32_t layerID, const uint8_t *rgba, size_t bytesPerRow, size_t width, size_t height, CQRGBOrder order, BOOL isPremultiplied) {
+    CQCompositorLayer *layer = CQLayerFind(compositor, layerID);
+    if (!layer || width != layer->geometry.width || height != layer->geometry.height) return NO;
+    CQLayerPrepareContent(layer);
+    // 透明度，顺便去掉预乘
+    uint8_t *alpha = layer->alpha ?: malloc(width * height);
+    uint8_t *straight = isPremultiplied ? malloc(width * height * 4) : NULL;
+    BOOL isOpaque = YES;
+    for (size_t j = 0; j < height; j++) {
+        const uint8_t *pixel = rgba + j * bytesPerRow;
+        uint8_t *straightPixel = straight ? straight + j * width * 4 : NULL;
+        for (size_t i = 0; i < width; i++, pixel += 4) {
+            uint8_t a = pixel[3];
+            alpha[j * width + i] = a;
+            isOpaque = isOpaque && a == 255;
+            if (!straightPixel) continue;
+            for (int c = 0; c < 3; c++) {
+                straightPixel[i * 4 + c] = a == 0 ? 0 : (uint8_t)MIN((pixel[c] * 255 + a / 2) / a, 255);
+            }
+            straightPixel[i * 4 + 3] = a;
+        }
+    }
+    CQRGBToYUVFrame frame = {0};
+    frame.rgb = straight ?: rgba;
+    frame.rgbBytesPerRow = straight ? width * 4 : bytesPerRow;
+    frame.order = order;
+    frame.y = layer->y;
+    frame.yBytesPerRow = width;
+    frame.u = layer->uv;
+    frame.uBytesPerRow = width;
+    frame.width = width;
+    frame.height = height;
+    frame.coefficients = CQRGBToYUVCoefficientsMake(CQYUVMatrixForSize(compositor->width, compositor->height), compositor->blackLuma == 0);
+    CQRGBToYUVConvert(&frame, 0);
+    free(straight);
+    if (isOpaque) {
+        free(alpha);
+        free(layer->chromaAlpha);
+        layer->alpha = layer->chromaAlpha = NULL;
+    } else {
+        // 色度的透明度取2x2的平均值，U、V各一份
+        uint8_t *chromaAlpha = layer->chromaAlpha ?: malloc(width * height / 2);
+        for (size_t j = 0; j < height / 2; j++) {
+            const uint8_t *row0 = alpha + j * 2 * width, *row1 = row0 + width;
+            for (size_t i = 0; i < width / 2; i++) {
+                uint8_t a = (uint8_t)((row0[i * 2] + row0[i * 2 + 1] + row1[i * 2] + row1[i * 2 + 1] + 2) >> 2);
+                chromaAlpha[j * width + i * 2] = a;
+                chromaAlpha[j * width + i * 2 + 1] = a;
+            }
+        }
+        layer->alpha = alpha;
+        layer->chromaAlpha = chromaAlpha;
+    }
+    layer->hasContent = YES;
+    CQMarkLayer(compositor, layer);
+    return YES;
+}
+
+void CQLayerCompositorInvalidate(CQLayerCompositor *compositor) {
+    memset(compositor->dirtyTiles, 1, compositor->tileColumns * compositor->tileRows);
+}
+
+#pragma mark - 合成
+/// 合成画布上[x0, x1) x [y0, y1)的区域
+static void CQComposeRegion(const CQLayerCompositor *compositor, size_t x0, size_t x1, size_t y0, size_t y1) {
+    size_t width = compositor->width;
+    // 完全覆盖这个区域的最上面的不透明图层
+    size_t first = 0;
+    BOOL isCovered = NO;
+    for (size_t i = compositor->layerCount; i-- > 0;) {
+        const CQCompositorLayer *layer = &compositor->layers[i];
+        const CQLayerGeometry *g = &layer->geometry;
+        if (CQLayerIsOpaque(layer) && g->x <= (int64_t)x0 && g->y <= (int64_t)y0 && g->x + (int64_t)g->width >= (int64_t)x1 && g->y + (int64_t)g->height >= (int64_t)y1) {
+            first = i;
+            isCovered = YES;
+            break;
+        }
+    }
+    if (!isCovered) {
+        for (size_t j = y0; j < y1; j++) {
+            memset(compositor->y + j * width + x0, compositor->blackLuma, x1 - x0);
+        }
+        for (size_t j = y0 / 2; j < y1 / 2; j++) {
+            memset(compositor->uv + j * width + x0, 128, x1 - x0);
+        }
+    }
+    for (size_t i = first; i < compositor->layerCount; i++) {
+        const CQCompositorLayer *layer = &compositor->layers[i];
+        if (!CQLayerIsVisible(layer)) continue;
+        const CQLayerGeometry *g = &layer->geometry;
+        int64_t left = MAX((int64_t)x0, (int64_t)g->x), right = MIN((int64_t)x1, (int64_t)g->x + (int64_t)g->width);
+        int64_t top = MAX((int64_t)y0, (int64_t)g->y), bottom = MIN((int64_t)y1, (int64_t)g->y + (int64_t)g->height);
+        if (left >= right || top >= bottom) continue;
+        // 图层上的起点，都是偶数
+        size_t layerX = (size_t)(left - g->x), length = (size_t)(right - left);
+        for (int64_t j = top; j < bottom; j++) {
+            size_t offset = (size_t)(j - g->y) * g->width + layerX;
+            CQAlphaBlendRow(compositor->y + (size_t)j * width + (size_t)left, layer->y + offset, layer->alpha ? layer->alpha + offset : NULL, g->opacity, length);
+        }
+        for (int64_t j = top / 2; j < bottom / 2; j++) {
+            size_t offset = (size_t)(j - g->y / 2) * g->width + layerX;
+            CQAlphaBlendRow(compositor->uv + (size_t)j * width + (size_t)left, layer->uv + offset, layer->chromaAlpha ? layer->chromaAlpha + offset : NULL, g->opacity, length);
+        }
+    }
+}
+
+/// 合成[tileRowBegin, tileRowEnd)块行里变化的块，再把这些行拷贝到destination
+static void CQComposeTileRows(const CQLayerCompositor *compositor, const CQYUVPlanes *destination, size_t tileRowBegin, size_t tileRowEnd) {
+    size_t width = compositor->width;
+    tileRowEnd = MIN(tileRowEnd, compositor->tileRows);
+    for (size_t row = tileRowBegin; row < tileRowEnd; row++) {
+        const uint8_t *dirty = compositor->dirtyTiles + row * compositor->tileColumns;
+        size_t y0 = row * kTileSize, y1 = MIN(y0 + kTileSize, compositor->height);
+        for (size_t column = 0; column < compositor->tileColumns;) {
+            if (!dirty[column]) {
+                column++;
+                continue;
+            }
+            size_t end = column + 1;
+            while (end < compositor->tileColumns && dirty[end]) end++;
+            CQComposeRegion(compositor, column * kTileSize, MIN(end * kTileSize, width), y0, y1);
+            column = end;
+        }
+        for (size_t j = y0; j < y1; j++) {
+            memcpy(destination->y + j * destination->yBytesPerRow, compositor->y + j * width, width);
+        }
+        for (size_t j = y0 / 2; j < y1 / 2; j++) {
+            memcpy(destination->u + j * destination->uBytesPerRow, compositor->uv + j * width, width);
+        }
+    }
+}
+
+size_t CQLayerCompositorCompose(CQLayerCompositor *compositor, const CQYUVPlanes *destination, size_t bandCount) {
+    if (destination->v || destination->width != compositor->width || destination->height != compositor->height) return 0;
+    size_t tileCount = compositor->tileColumns * compositor->tileRows, dirtyCount = 0;
+    for (size_t i = 0; i < tileCount; i++) {
+        dirtyCount += compositor->dirtyTiles[i];
+    }
+    size_t tileRows = compositor->tileRows;
+    if (bandCount == 0) {
+        bandCount = MIN([NSProcessInfo processInfo].activeProcessorCount, tileRows / kMinTileRowsPerBand);
+    }
+    size_t tileRowsPerBand = (tileRows + MAX(bandCount, (size_t)1) - 1) / MAX(bandCount, (size_t)1);
+    bandCount = (tileRows + tileRowsPerBand - 1) / tileRowsPerBand;
+    if (bandCount <= 1) {
+        CQComposeTileRows(compositor, destination, 0, tileRows);
+    } else {
+        dispatch_apply(bandCount, DISPATCH_APPLY_AUTO, ^(size_t band) {
+            CQComposeTileRows(compositor, destination, band * tileRowsPerBand, (band + 1) * tileRowsPerBand);
+        });
+    }
+    memset(compositor->dirtyTiles, 0, tileCount);
+    return dirtyCount;
+}
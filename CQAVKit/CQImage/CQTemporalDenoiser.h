@@ -0,0 +1,93 @@
+//
+//  CQTemporalDenoiser.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+#import "CQFrameTransform.h"
+
+/**
+ 时域降噪(运动自适应的递归滤波)
+ @discussion 暗光下传感器的噪声每帧都不一样，编码器会把码率花在噪声上，固定码率时表现为块效应
+ 每个像素和上一帧降噪后的结果按权重混合: 差值小(静止，差值主要是噪声)时参考帧权重大，差值越大(运动)权重越小，
+ 约40以上完全取当前帧，运动的物体不会拖影；arm64上使用NEON一次16个字节，按行分段并行
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 降噪强度
+typedef NS_ENUM(uint8_t, CQDenoiseStrength) {
+    CQDenoiseStrengthLow = 0,  ///< 参考帧权重最大1/2，噪声σ3以下
+    CQDenoiseStrengthMedium = 1,  ///< 参考帧权重最大2/3，一般的室内
+    CQDenoiseStrengthHigh = 2,  ///< 参考帧权重最大4/5，适合很暗的场景
+};
+
+/// 一个平面的参数: 参考帧权重 = max(maxWeight - motion * slope, 0) / 255，motion是当前和参考的差值和左右邻居平滑后的绝对值
+typedef struct {
+    uint8_t maxWeight;  ///< 静止时参考帧的权重
+    uint8_t slope;  ///< motion每增加1权重减少多少
+} CQDenoiseLevel;
+
+typedef struct {
+    CQDenoiseLevel luma;
+    CQDenoiseLevel chroma;
+} CQDenoiseParameters;
+
+/// 强度对应的参数
+FOUNDATION_EXPORT CQDenoiseParameters CQDenoiseParametersMake(CQDenoiseStrength strength);
+
+/**
+ 降噪[rowBegin, rowEnd)行
+ @discussion rowBegin必须为偶数，三帧同为NV12或同为I420，宽高相同；output不能和current、reference相同(要用到改写前的邻居)
+ @param current 当前帧
+ @param reference 上一帧降噪后的结果，第一帧传current(结果就是current)
+ @param output 输出，作为下一帧的reference
+ */
+FOUNDATION_EXPORT void CQTemporalDenoiseRows(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t rowBegin, size_t rowEnd);
+
+/**
+ CQTemporalDenoiseRows的标量实现
+ @discussion 结果和CQTemporalDenoiseRows相同，用于基准测试对比
+ */
+FOUNDATION_EXPORT void CQTemporalDenoiseRowsScalar(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t rowBegin, size_t rowEnd);
+
+/**
+ 降噪一帧
+ @param bandCount 按行分成几段并行降噪(dispatch_apply)，0为按CPU核数和高度自动选择，1为在当前线程降噪
+ */
+FOUNDATION_EXPORT void CQTemporalDenoise(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t bandCount);
+
+/**
+ 编码前的时域降噪
+ @discussion 输出取自内部的缓冲池，最后一次的输出留作参考帧(不占用采集的缓冲池)，宽高或格式变化时重新开始
+ 处理在同一个线程上串行调用(例如编码的strand)，strength和reset可以在任意线程调用
+ */
+@interface CQTemporalDenoiser : NSObject
+
+/**
+ 唯一初始化函数
+ @param strength 降噪强度
+ */
+- (instancetype)initWithStrength:(CQDenoiseStrength)strength;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (atomic, assign) CQDenoiseStrength strength;  ///< 降噪强度，修改后下一帧生效
+
+/**
+ 降噪一帧
+ @param pixelBuffer NV12(420v/420f)或I420(y420/f420)
+ @return 输出(需要释放)，格式不支持或缓冲池不可用时返回NULL
+ */
+- (nullable CVPixelBufferRef)createDenoisedPixelBuffer:(CVPixelBufferRef)pixelBuffer CF_RETURNS_RETAINED;
+
+/// 丢掉参考帧，下一帧重新开始(切换摄像头、场景切换)
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
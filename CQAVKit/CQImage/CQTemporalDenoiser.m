@@ -0,0 +1,269 @@
+//
+//  CQTemporalDenoiser.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 递归滤波: 输出 = (参考 * w + 当前 * (255 - w)) / 255，参考是上一帧的输出，静止区域相当于对很多帧做指数平均，
+   w = 2/3时噪声的方差降到1/5(约7dB)，只需要保存一帧
+ 2 运动自适应: w = max(maxWeight - motion * slope, 0)，motion = |前 + 2 * 当前 + 后| / 4，是带符号的差值和左右邻居平滑后的绝对值，
+   噪声的差值正负抵消，运动的差值同号叠加，比逐像素的|当前 - 参考|区分得开；motion大时w降到0，不拖影
+   不需要运动估计，NEON: vsubl求带符号差值，vabs + vrshr求motion，vmul + vqmovn饱和乘，vqsub求w，再和CQLayerCompositor一样混合
+ 3 除以255用 (x + 128 + ((x + 128) >> 8)) >> 8，标量和NEON结果完全相同
+ 4 色度和亮度用同一个函数，邻居的距离NV12的UV为2(交错)，其它为1，参数分开
+   参数用合成的噪声序列(σ 3~9)选的: slope再小运动的边缘开始拖影，再大静止区域降噪变弱
+ 5 参考帧是上一次的输出，从自己的缓冲池里取，编码器释放输出后缓冲池复用；宽高或格式变化、reset时丢掉参考帧，
+   第一帧把当前帧自己当参考，结果就是当前帧
+ */
+
+#import "CQTemporalDenoiser.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+static const size_t kMinRowsPerBand = 128;
+static const size_t kBandAlignment = 2;
+
+CQDenoiseParameters CQDenoiseParametersMake(CQDenoiseStrength strength) {
+    CQDenoiseParameters parameters = {0};
+    switch (strength) {
+        case CQDenoiseStrengthLow:
+            parameters.luma = (CQDenoiseLevel){.maxWeight = 128, .slope = 3};
+            parameters.chroma = (CQDenoiseLevel){.maxWeight = 128, .slope = 3};
+            break;
+        case CQDenoiseStrengthMedium:
+            parameters.luma = (CQDenoiseLevel){.maxWeight = 170, .slope = 4};
+            parameters.chroma = (CQDenoiseLevel){.maxWeight = 170, .slope = 4};
+            break;
+        case CQDenoiseStrengthHigh:
+            parameters.luma = (CQDenoiseLevel){.maxWeight = 204, .slope = 5};
+            parameters.chroma = (CQDenoiseLevel){.maxWeight = 204, .slope = 5};
+            break;
+    }
+    return parameters;
+}
+
+/// 除以255并四舍五入，x不超过65025
+static inline uint8_t CQDivide255(uint32_t x) {
+    x += 128;
+    return (uint8_t)((x + (x >> 8)) >> 8);
+}
+
+#if defined(__aarch64__)
+static inline uint8x8_t CQDivide255NEON(uint16x8_t x) {
+    uint16x8_t rounded = vaddq_u16(x, vdupq_n_u16(128));
+    return vaddhn_u16(rounded, vshrq_n_u16(rounded, 8));
+}
+#endif
+
+/// 第i个字节降噪，运动的判断用左右两个邻居平滑过的差值(一行两端没有邻居时用自己)
+static inline uint8_t CQDenoisePixel(const uint8_t *current, const uint8_t *reference, size_t i, size_t length, size_t pixelSize, CQDenoiseLevel level) {
+    int32_t difference = (int32_t)current[i] - reference[i];
+    int32_t previous = i >= pixelSize ? (int32_t)current[i - pixelSize] - reference[i - pixelSize] : difference;
+    int32_t next = i + pixelSize < length ? (int32_t)current[i + pixelSize] - reference[i + pixelSize] : difference;
+    int32_t sum = previous + 2 * difference + next;
+    uint32_t motion = ((uint32_t)abs(sum) + 2) >> 2;
+    uint32_t penalty = MIN(motion * level.slope, 255);
+    uint32_t w = level.maxWeight > penalty ? level.maxWeight - penalty : 0;
+    return CQDivide255(reference[i] * w + current[i] * (255 - w));
+}
+
+/**
+ 降噪一行的length个字节
+ @param pixelSize 同一个分量相邻两个像素的距离(NV12的UV为2)
+ */
+static void CQDenoiseRow(const uint8_t *current, const uint8_t *reference, uint8_t *output, size_t length, size_t pixelSize, CQDenoiseLevel level, BOOL usesSIMD) {
+    size_t i = 0;
+    // 第一个像素没有左边的邻居
+    for (; i < MIN(pixelSize, length); i++) {
+        output[i] = CQDenoisePixel(current, reference, i, length, pixelSize, level);
+    }
+#if defined(__aarch64__)
+    if (usesSIMD) {
+        const uint8x16_t maxWeight = vdupq_n_u8(level.maxWeight);
+        const uint16x8_t slope = vdupq_n_u16(level.slope);
+        for (; i + 16 + pixelSize <= length; i += 16) {
+            uint8x16_t c = vld1q_u8(current + i), r = vld1q_u8(reference + i);
+            uint8x16_t previousC = vld1q_u8(current + i - pixelSize), previousR = vld1q_u8(reference + i - pixelSize);
+            uint8x16_t nextC = vld1q_u8(current + i + pixelSize), nextR = vld1q_u8(reference + i + pixelSize);
+            // 前 + 2 * 当前 + 后，带符号16位
+            int16x8_t differenceLow = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(c), vget_low_u8(r)));
+            int16x8_t differenceHigh = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(c), vget_high_u8(r)));
+            int16x8_t sumLow = vaddq_s16(vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(previousC), vget_low_u8(previousR))), vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(nextC), vget_low_u8(nextR))));
+            int16x8_t sumHigh = vaddq_s16(vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(previousC), vget_high_u8(previousR))), vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(nextC), vget_high_u8(nextR))));
+            sumLow = vaddq_s16(sumLow, vshlq_n_s16(differenceLow, 1));
+            sumHigh = vaddq_s16(sumHigh, vshlq_n_s16(differenceHigh, 1));
+            uint16x8_t motionLow = vrshrq_n_u16(vreinterpretq_u16_s16(vabsq_s16(sumLow)), 2);
+            uint16x8_t motionHigh = vrshrq_n_u16(vreinterpretq_u16_s16(vabsq_s16(sumHigh)), 2);
+            uint8x16_t penalty = vcombine_u8(vqmovn_u16(vmulq_u16(motionLow, slope)), vqmovn_u16(vmulq_u16(motionHigh, slope)));
+            uint8x16_t w = vqsubq_u8(maxWeight, penalty), inverse = vmvnq_u8(w);
+            uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(r), vget_low_u8(w)), vget_low_u8(c), vget_low_u8(inverse));
+            uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(r), vget_high_u8(w)), vget_high_u8(c), vget_high_u8(inverse));
+            vst1q_u8(output + i, vcombine_u8(CQDivide255NEON(low), CQDivide255NEON(high)));
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        output[i] = CQDenoisePixel(current, reference, i, length, pixelSize, level);
+    }
+}
+
+static void CQDenoisePlaneRows(const uint8_t *current, size_t currentBytesPerRow, const uint8_t *reference, size_t referenceBytesPerRow, uint8_t *output, size_t outputBytesPerRow, size_t length, size_t pixelSize, size_t rowBegin, size_t rowEnd, CQDenoiseLevel level, BOOL usesSIMD) {
+    for (size_t j = rowBegin; j < rowEnd; j++) {
+        CQDenoiseRow(current + j * currentBytesPerRow, reference + j * referenceBytesPerRow, output + j * outputBytesPerRow, length, pixelSize, level, usesSIMD);
+    }
+}
+
+static void CQTemporalDenoiseRowsInternal(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t rowBegin, size_t rowEnd, BOOL usesSIMD) {
+    rowEnd = MIN(rowEnd, current->height);
+    if (rowBegin >= rowEnd) return;
+    size_t width = current->width;
+    BOOL isNV12 = current->v == NULL;
+    CQDenoisePlaneRows(current->y, current->yBytesPerRow, reference->y, reference->yBytesPerRow, output->y, output->yBytesPerRow, width, 1, rowBegin, rowEnd, parameters.luma, usesSIMD);
+    size_t chromaBegin = rowBegin / 2, chromaEnd = (rowEnd + 1) / 2;
+    // NV12的一行UV和亮度一样宽，I420的U、V各一半
+    size_t chromaLength = isNV12 ? (width + 1) / 2 * 2 : (width + 1) / 2;
+    CQDenoisePlaneRows(current->u, current->uBytesPerRow, reference->u, reference->uBytesPerRow, output->u, output->uBytesPerRow, chromaLength, isNV12 ? 2 : 1, chromaBegin, chromaEnd, parameters.chroma, usesSIMD);
+    if (!isNV12) {
+        CQDenoisePlaneRows(current->v, current->vBytesPerRow, reference->v, reference->vBytesPerRow, output->v, output->vBytesPerRow, chromaLength, 1, chromaBegin, chromaEnd, parameters.chroma, usesSIMD);
+    }
+}
+
+void CQTemporalDenoiseRows(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t rowBegin, size_t rowEnd) {
+    CQTemporalDenoiseRowsInternal(current, reference, output, parameters, rowBegin, rowEnd, YES);
+}
+
+void CQTemporalDenoiseRowsScalar(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t rowBegin, size_t rowEnd) {
+    CQTemporalDenoiseRowsInternal(current, reference, output, parameters, rowBegin, rowEnd, NO);
+}
+
+void CQTemporalDenoise(const CQYUVPlanes *current, const CQYUVPlanes *reference, const CQYUVPlanes *output, CQDenoiseParameters parameters, size_t bandCount) {
+    size_t height = current->height;
+    if (bandCount == 0) {
+        bandCount = MIN([NSProcessInfo processInfo].activeProcessorCount, height / kMinRowsPerBand);
+    }
+    size_t rowsPerBand = (height + MAX(bandCount, (size_t)1) - 1) / MAX(bandCount, (size_t)1);
+    rowsPerBand = (rowsPerBand + kBandAlignment - 1) / kBandAlignment * kBandAlignment;
+    bandCount = (height + rowsPerBand - 1) / rowsPerBand;
+    if (bandCount <= 1) {
+        CQTemporalDenoiseRows(current, reference, output, parameters, 0, height);
+        return;
+    }
+    dispatch_apply(bandCount, DISPATCH_APPLY_AUTO, ^(size_t band) {
+        CQTemporalDenoiseRows(current, reference, output, parameters, band * rowsPerBand, (band + 1) * rowsPerBand);
+    });
+}
+
+/// 锁定后的CVPixelBuffer平面
+static CQYUVPlanes CQYUVPlanesFromPixelBuffer(CVPixelBufferRef pixelBuffer) {
+    OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    CQYUVPlanes planes = {0};
+    planes.y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+    planes.yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    planes.u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+    planes.uBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+    if (format == kCVPixelFormatType_420YpCbCr8Planar || format == kCVPixelFormatType_420YpCbCr8PlanarFullRange) {
+        planes.v = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 2);
+        planes.vBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 2);
+    }
+    planes.width = CVPixelBufferGetWidth(pixelBuffer);
+    planes.height = CVPixelBufferGetHeight(pixelBuffer);
+    planes.isFullRange = format == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange || format == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    return planes;
+}
+
+@interface CQTemporalDenoiser ()
+@property (atomic, assign) BOOL isResetRequested;  ///< 下一帧丢掉参考帧
+@end
+
+@implementation CQTemporalDenoiser
+{
+    CVPixelBufferPoolRef _pool;  ///< 输出
+    CVPixelBufferRef _reference;  ///< 上一次的输出
+}
+
+#pragma mark - Init
+- (instancetype)initWithStrength:(CQDenoiseStrength)strength {
+    if (self = [super init]) {
+        _strength = strength;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_pool) CVPixelBufferPoolRelease(_pool);
+    CVPixelBufferRelease(_reference);
+}
+
+#pragma mark - Public Func
+- (CVPixelBufferRef)createDenoisedPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    if (format != kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange && format != kCVPixelFormatType_420YpCbCr8BiPlanarFullRange
+        && format != kCVPixelFormatType_420YpCbCr8Planar && format != kCVPixelFormatType_420YpCbCr8PlanarFullRange) return NULL;
+    size_t width = CVPixelBufferGetWidth(pixelBuffer), height = CVPixelBufferGetHeight(pixelBuffer);
+    if (![self preparePoolWithWidth:width height:height format:format] || self.isResetRequested) {
+        self.isResetRequested = NO;
+        CVPixelBufferRelease(_reference);
+        _reference = NULL;
+    }
+    if (!_pool) return NULL;
+    CVPixelBufferRef output = NULL;
+    CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, _pool, &output);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQTemporalDenoiser-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+        return NULL;
+    }
+    CVPixelBufferRef reference = _reference ?: pixelBuffer;
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    if (reference != pixelBuffer) CVPixelBufferLockBaseAddress(reference, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(output, 0);
+    CQYUVPlanes currentPlanes = CQYUVPlanesFromPixelBuffer(pixelBuffer);
+    CQYUVPlanes referencePlanes = CQYUVPlanesFromPixelBuffer(reference);
+    CQYUVPlanes outputPlanes = CQYUVPlanesFromPixelBuffer(output);
+    CQTemporalDenoise(&currentPlanes, &referencePlanes, &outputPlanes, CQDenoiseParametersMake(self.strength), 0);
+    CVPixelBufferUnlockBaseAddress(output, 0);
+    if (reference != pixelBuffer) CVPixelBufferUnlockBaseAddress(reference, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    // 色彩信息(矩阵、原色等)跟随源
+    CVBufferPropagateAttachments(pixelBuffer, output);
+    CVPixelBufferRelease(_reference);
+    _reference = CVPixelBufferRetain(output);
+    return output;
+}
+
+- (void)reset {
+    self.isResetRequested = YES;
+}
+
+#pragma mark - Private Func
+/**
+ 按宽高和格式准备缓冲池
+ @return 缓冲池没有变化返回YES，重建了返回NO(参考帧不能再用)
+ */
+- (BOOL)preparePoolWithWidth:(size_t)width height:(size_t)height format:(OSType)format {
+    if (_pool) {
+        NSDictionary *attributes = (__bridge NSDictionary *)CVPixelBufferPoolGetPixelBufferAttributes(_pool);
+        if ([attributes[(__bridge NSString *)kCVPixelBufferWidthKey] unsignedLongValue] == width
+            && [attributes[(__bridge NSString *)kCVPixelBufferHeightKey] unsignedLongValue] == height
+            && [attributes[(__bridge NSString *)kCVPixelBufferPixelFormatTypeKey] unsignedIntValue] == format) return YES;
+        CVPixelBufferPoolRelease(_pool);
+        _pool = NULL;
+    }
+    NSDictionary *attributes = @{
+        (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(format),
+        (__bridge NSString *)kCVPixelBufferWidthKey: @(width),
+        (__bridge NSString *)kCVPixelBufferHeightKey: @(height),
+        (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+    };
+    CVReturn result = CVPixelBufferPoolCreate(kCFAllocatorDefault, NULL, (__bridge CFDictionaryRef)attributes, &_pool);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQTemporalDenoiser-CVPixelBufferPoolCreate failed. result = %d", (int)result);
+        _pool = NULL;
+    }
+    return NO;
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+//  CQVideoCompositor.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <CoreMedia/CMSampleBuffer.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 多路视频合成(画中画、水印、时间码)
+ @discussion 每一路(前后摄像头、叠加层)是一个图层，各自在自己的线程上更新内容，编码线程定时取合成后的一帧送入CQVideoEncoder，
+ 只有变化过的区域重新混合(CQLayerCompositor)，静态的水印不更新时几乎没有开销
+ 所有函数都可以在任意线程调用
+ */
+@interface CQVideoCompositor : NSObject
+
+/**
+ 唯一初始化函数
+ @param width 输出宽(偶数)
+ @param height 输出高(偶数)
+ @param isFullRange 输出420f还是420v，和摄像头输出一致时YUV图层不需要转换范围
+ */
+- (instancetype)initWithWidth:(size_t)width height:(size_t)height isFullRange:(BOOL)isFullRange;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) size_t width;  ///< 输出宽
+@property (nonatomic, assign, readonly) size_t height;  ///< 输出高
+
+/**
+ 添加或修改图层
+ @param layerID 图层标识
+ @param frame 在输出上的区域(像素)，取偶数
+ @param zOrder 从小到大依次叠放
+ @param opacity 不透明度 0~1
+ @return 图层数已满(最多8个)或区域不合法返回NO
+ */
+- (BOOL)setLayer:(uint32_t)layerID frame:(CGRect)frame zOrder:(int32_t)zOrder opacity:(CGFloat)opacity;
+
+- (void)removeLayer:(uint32_t)layerID;
+
+/**
+ 更新图层内容
+ @discussion NV12(420v/420f)保持宽高比缩放到图层大小(AspectFill)；32BGRA/32RGBA按预乘透明度处理(CoreGraphics绘制)，宽高必须和图层相同
+ @return 图层不存在、格式不支持或宽高不同返回NO
+ */
+- (BOOL)updateLayer:(uint32_t)layerID withPixelBuffer:(CVPixelBufferRef)pixelBuffer;
+
+/**
+ 合成一帧
+ @return 输出(需要释放)，取自内部的缓冲池，失败返回NULL
+ */
+- (nullable CVPixelBufferRef)createComposedPixelBuffer CF_RETURNS_RETAINED;
+
+/**
+ 合成一帧，包装成sampleBuffer
+ @discussion 可以直接送入videoEncodeWithSampleBuffer:
+ @param presentationTime 显示时间戳
+ @return 输出(需要释放)，失败返回NULL
+ */
+- (nullable CMSampleBufferRef)createComposedSampleBufferWithPresentationTime:(CMTime)presentationTime CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
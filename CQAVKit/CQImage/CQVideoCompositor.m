@@ -0,0 +1,151 @@
+//
+//  CQVideoCompositor.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 CQLayerCompositor不是线程安全的，更新和合成都在锁里调用，各路的更新本身就是串行的(每路一个采集队列)
+ 2 图层内容在更新时就拷贝转换好，不持有CVPixelBuffer，采集的缓冲池不会因为合成被占住
+ 3 输出的缓冲池在初始化时按宽高和格式创建，合成结果整帧写进去
+ */
+
+#import "CQVideoCompositor.h"
+#import "CQLayerCompositor.h"
+#import <os/lock.h>
+
+@implementation CQVideoCompositor
+{
+    os_unfair_lock _lock;
+    CQLayerCompositor *_compositor;  ///< 在锁里访问
+    CVPixelBufferPoolRef _pool;  ///< 输出
+    BOOL _isFullRange;
+}
+
+#pragma mark - Init
+- (instancetype)initWithWidth:(size_t)width height:(size_t)height isFullRange:(BOOL)isFullRange {
+    if (self = [super init]) {
+        _width = width & ~(size_t)1;
+        _height = height & ~(size_t)1;
+        _isFullRange = isFullRange;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _compositor = CQLayerCompositorCreate(_width, _height, isFullRange);
+        NSDictionary *attributes = @{
+            (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(isFullRange ? kCVPixelFormatType_420YpCbCr8BiPlanarFullRange : kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange),
+            (__bridge NSString *)kCVPixelBufferWidthKey: @(_width),
+            (__bridge NSString *)kCVPixelBufferHeightKey: @(_height),
+            (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+        };
+        CVReturn result = CVPixelBufferPoolCreate(kCFAllocatorDefault, NULL, (__bridge CFDictionaryRef)attributes, &_pool);
+        if (result != kCVReturnSuccess) {
+            NSLog(@"CQVideoCompositor-CVPixelBufferPoolCreate failed. result = %d", (int)result);
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CQLayerCompositorDestroy(_compositor);
+    if (_pool) CVPixelBufferPoolRelease(_pool);
+}
+
+#pragma mark - Public Func
+- (BOOL)setLayer:(uint32_t)layerID frame:(CGRect)frame zOrder:(int32_t)zOrder opacity:(CGFloat)opacity {
+    frame = CGRectStandardize(frame);
+    CQLayerGeometry geometry = {0};
+    // 取偶数
+    geometry.x = (int32_t)floor(frame.origin.x / 2) * 2;
+    geometry.y = (int32_t)floor(frame.origin.y / 2) * 2;
+    geometry.width = (size_t)round(frame.size.width / 2) * 2;
+    geometry.height = (size_t)round(frame.size.height / 2) * 2;
+    geometry.zOrder = zOrder;
+    geometry.opacity = (uint8_t)lround(MIN(MAX(opacity, 0), 1) * 255);
+    os_unfair_lock_lock(&_lock);
+    BOOL isSuccess = CQLayerCompositorSetLayer(_compositor, layerID, geometry);
+    os_unfair_lock_unlock(&_lock);
+    return isSuccess;
+}
+
+- (void)removeLayer:(uint32_t)layerID {
+    os_unfair_lock_lock(&_lock);
+    CQLayerCompositorRemoveLayer(_compositor, layerID);
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (BOOL)updateLayer:(uint32_t)layerID withPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    BOOL isNV12 = format == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange || format == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+    BOOL isRGB = format == kCVPixelFormatType_32BGRA || format == kCVPixelFormatType_32RGBA;
+    if (!isNV12 && !isRGB) return NO;
+    if (CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly) != kCVReturnSuccess) return NO;
+    BOOL isSuccess = NO;
+    os_unfair_lock_lock(&_lock);
+    if (isNV12) {
+        CQYUVPlanes planes = {0};
+        planes.y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+        planes.yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+        planes.u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+        planes.uBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+        planes.width = CVPixelBufferGetWidth(pixelBuffer);
+        planes.height = CVPixelBufferGetHeight(pixelBuffer);
+        planes.isFullRange = format == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+        isSuccess = CQLayerCompositorUpdateYUV(_compositor, layerID, &planes);
+    } else {
+        CQRGBOrder order = format == kCVPixelFormatType_32BGRA ? CQRGBOrderBGRA : CQRGBOrderRGBA;
+        isSuccess = CQLayerCompositorUpdateRGBA(_compositor, layerID, CVPixelBufferGetBaseAddress(pixelBuffer), CVPixelBufferGetBytesPerRow(pixelBuffer),
+                                                CVPixelBufferGetWidth(pixelBuffer), CVPixelBufferGetHeight(pixelBuffer), order, YES);
+    }
+    os_unfair_lock_unlock(&_lock);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    return isSuccess;
+}
+
+- (CVPixelBufferRef)createComposedPixelBuffer {
+    if (!_pool) return NULL;
+    CVPixelBufferRef pixelBuffer = NULL;
+    CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, _pool, &pixelBuffer);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoCompositor-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+        return NULL;
+    }
+    CVPixelBufferLockBaseAddress(pixelBuffer, 0);
+    CQYUVPlanes planes = {0};
+    planes.y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0);
+    planes.yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0);
+    planes.u = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+    planes.uBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+    planes.width = _width;
+    planes.height = _height;
+    planes.isFullRange = _isFullRange;
+    os_unfair_lock_lock(&_lock);
+    CQLayerCompositorCompose(_compositor, &planes, 0);
+    os_unfair_lock_unlock(&_lock);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, 0);
+    // RGBA图层按这个矩阵转换(和CQYUVConverter的输出一致)
+    CFStringRef matrix = CQYUVMatrixForSize(_width, _height) == CQYUVMatrixBT709 ? kCVImageBufferYCbCrMatrix_ITU_R_709_2 : kCVImageBufferYCbCrMatrix_ITU_R_601_4;
+    CVBufferSetAttachment(pixelBuffer, kCVImageBufferYCbCrMatrixKey, matrix, kCVAttachmentMode_ShouldPropagate);
+    return pixelBuffer;
+}
+
+- (CMSampleBufferRef)createComposedSampleBufferWithPresentationTime:(CMTime)presentationTime {
+    CVPixelBufferRef pixelBuffer = [self createComposedPixelBuffer];
+    if (!pixelBuffer) return NULL;
+    CMSampleTimingInfo timing = {kCMTimeInvalid, presentationTime, kCMTimeInvalid};
+    CMVideoFormatDescriptionRef formatDescription = NULL;
+    CMSampleBufferRef sampleBuffer = NULL;
+    OSStatus status = CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, pixelBuffer, &formatDescription);
+    if (status == noErr) {
+        status = CMSampleBufferCreateReadyWithImageBuffer(kCFAllocatorDefault, pixelBuffer, formatDescription, &timing, &sampleBuffer);
+    }
+    if (formatDescription) CFRelease(formatDescription);
+    CVPixelBufferRelease(pixelBuffer);
+    if (status != noErr) {
+        NSLog(@"CQVideoCompositor-CMSampleBufferCreateReadyWithImageBuffer failed. status = %d", (int)status);
+        return NULL;
+    }
+    return sampleBuffer;
+}
+
+@end
@@ -0,0 +1,107 @@
+//
+//  CQVideoFilterGraph.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+#import <CoreMedia/CMSampleBuffer.h>
+#import "CQFrameTransform.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 滤镜节点类型
+typedef NS_ENUM(NSUInteger, CQVideoFilterType) {
+    CQVideoFilterTypeCrop = 0,  ///< 裁剪
+    CQVideoFilterTypeRotate = 1,  ///< 顺时针旋转
+    CQVideoFilterTypeMirror = 2,  ///< 水平镜像
+    CQVideoFilterTypeScale = 3,  ///< 缩放(AspectFit时填黑边)
+};
+
+/**
+ 滤镜节点(不可变)
+ @discussion 每个节点作用在前一个节点的输出上，坐标和宽高的单位是像素
+ */
+@interface CQVideoFilter : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+/// 裁剪，超出画面的部分忽略
++ (instancetype)cropFilterWithRect:(CGRect)rect;
+/// 顺时针旋转
++ (instancetype)rotateFilterWithRotation:(CQFrameRotation)rotation;
+/// 水平镜像(前置摄像头)
++ (instancetype)mirrorFilter;
+/**
+ 缩放
+ @discussion AspectFill裁掉多出的部分；AspectFit填黑边，之后不能再接其它节点(会被忽略)
+ */
++ (instancetype)scaleFilterWithSize:(CGSize)size mode:(CQFrameScaleMode)mode;
+
+@property (nonatomic, assign, readonly) CQVideoFilterType type;  ///< 类型
+@property (nonatomic, assign, readonly) CGRect rect;  ///< 裁剪区域
+@property (nonatomic, assign, readonly) CQFrameRotation rotation;  ///< 旋转
+@property (nonatomic, assign, readonly) CGSize size;  ///< 缩放的目标宽高
+@property (nonatomic, assign, readonly) CQFrameScaleMode mode;  ///< 缩放方式
+
+@end
+
+/**
+ 视频滤镜链(采集和编码之间)
+ @discussion 镜像、方向、宽高比裁剪原来靠预览层的transform和AVCaptureConnection设置，编码出来的画面和预览不一致，改方向还要重新配置采集
+ 这里把任意顺序的裁剪/旋转/镜像/缩放节点合成一次CQFrameTransform，对NV12/I420一次遍历完成(NEON、分块、多线程)，
+ 修改节点下一帧生效，不影响采集；32BGRA/32RGBA的源先转成YUV(CQYUVConverter)
+ 处理在同一个线程上串行调用(例如编码的strand)，filters可以在任意线程修改
+ */
+@interface CQVideoFilterGraph : NSObject
+
+/**
+ 唯一初始化函数
+ @param filters 滤镜节点，按顺序执行，空数组时只做格式转换和缩放
+ */
+- (instancetype)initWithFilters:(NSArray<CQVideoFilter *> *)filters;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (atomic, copy) NSArray<CQVideoFilter *> *filters;  ///< 滤镜节点，修改后下一帧生效
+
+/**
+ 把节点合成为一次变换
+ @param width 源宽
+ @param height 源高
+ @param outputWidth 目标宽，和节点输出的宽高不同时最后再按AspectFit放进目标，0为节点输出的宽
+ @param outputHeight 目标高
+ */
+- (CQFrameTransform)transformForSourceWidth:(size_t)width height:(size_t)height outputWidth:(size_t)outputWidth outputHeight:(size_t)outputHeight;
+
+/**
+ 处理一帧，写到目标buffer
+ @discussion 目标一般取自编码器的缓冲池，格式为NV12/I420，宽高和节点输出的宽高不同时再按AspectFit放进目标
+ @param source 源，NV12/I420/32BGRA/32RGBA
+ @param destination 目标
+ @return 成功返回kCVReturnSuccess
+ */
+- (CVReturn)processPixelBuffer:(CVPixelBufferRef)source toPixelBuffer:(CVPixelBufferRef)destination;
+
+/**
+ 处理一帧，输出取自内部的缓冲池
+ @discussion 输出的宽高为节点输出的宽高，格式和源相同(RGB的源输出NV12)
+ @return 输出(需要释放)，失败返回NULL
+ */
+- (nullable CVPixelBufferRef)createProcessedPixelBuffer:(CVPixelBufferRef)source CF_RETURNS_RETAINED;
+
+/**
+ 处理sampleBuffer
+ @discussion 时间戳和附件(CQCaptureTimestamp等)保留，可以直接放在采集回调和videoEncodeWithSampleBuffer:之间
+ @return 输出(需要释放)，失败返回NULL
+ */
+- (nullable CMSampleBufferRef)createProcessedSampleBuffer:(CMSampleBufferRef)sampleBuffer CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,325 @@
+//
+//  CQVideoFilterGraph.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 合成时维护当前画面相对源的状态: 源上的区域(浮点)、旋转r、镜像m(先旋转后镜像)、当前宽高
+ 2 裁剪: 当前画面上的矩形先除以缩放比例，再撤销镜像和旋转，得到源上的矩形
+ 3 旋转q: 没有镜像时r + q，有镜像时 q∘M = M∘(-q)，所以r - q；镜像: m取反
+ 4 缩放: Stretch只改当前宽高，AspectFill先居中裁剪到目标宽高比再缩放，AspectFit记下黑边后结束
+ 5 最后源上的区域取偶数，得到一次CQFrameTransform，每帧重新合成(只是几次浮点运算)，修改节点不需要同步
+ 6 缓冲池按宽高和格式创建，变化时重建
+ */
+
+#import "CQVideoFilterGraph.h"
+#import "CQYUVConverter.h"
+#import "CQTimestampSEI.h"
+
+@interface CQVideoFilter ()
+@property (nonatomic, assign, readwrite) CQVideoFilterType type;
+@property (nonatomic, assign, readwrite) CGRect rect;
+@property (nonatomic, assign, readwrite) CQFrameRotation rotation;
+@property (nonatomic, assign, readwrite) CGSize size;
+@property (nonatomic, assign, readwrite) CQFrameScaleMode mode;
+@end
+
+@implementation CQVideoFilter
+
+#pragma mark - Init
+- (instancetype)initWithType:(CQVideoFilterType)type {
+    if (self = [super init]) {
+        _type = type;
+    }
+    return self;
+}
+
++ (instancetype)cropFilterWithRect:(CGRect)rect {
+    CQVideoFilter *filter = [[self alloc] initWithType:CQVideoFilterTypeCrop];
+    filter.rect = CGRectStandardize(rect);
+    return filter;
+}
+
++ (instancetype)rotateFilterWithRotation:(CQFrameRotation)rotation {
+    CQVideoFilter *filter = [[self alloc] initWithType:CQVideoFilterTypeRotate];
+    filter.rotation = rotation & 0x03;
+    return filter;
+}
+
++ (instancetype)mirrorFilter {
+    return [[self alloc] initWithType:CQVideoFilterTypeMirror];
+}
+
++ (instancetype)scaleFilterWithSize:(CGSize)size mode:(CQFrameScaleMode)mode {
+    CQVideoFilter *filter = [[self alloc] initWithType:CQVideoFilterTypeScale];
+    filter.size = size;
+    filter.mode = mode;
+    return filter;
+}
+
+@end
+
+/// 合成状态
+typedef struct {
+    CGRect sourceRect;  ///< 源上的区域
+    int rotation;  ///< 0~3
+    BOOL mirrors;
+    CGSize size;  ///< 当前画面的宽高
+    BOOL isFitted;  ///< 已经AspectFit
+    CGSize outputSize;  ///< AspectFit的目标宽高
+    CGRect contentRect;  ///< AspectFit时画面在目标上的区域
+} CQFilterState;
+
+/// 当前画面上的矩形对应的源上的矩形
+static CGRect CQFilterStateSourceRect(const CQFilterState *state, CGRect rect) {
+    BOOL swapsAxes = state->rotation & 1;
+    CGFloat sourceWidth = state->sourceRect.size.width, sourceHeight = state->sourceRect.size.height;
+    CGFloat rotatedWidth = swapsAxes ? sourceHeight : sourceWidth, rotatedHeight = swapsAxes ? sourceWidth : sourceHeight;
+    // 撤销缩放
+    CGFloat scaleX = state->size.width / rotatedWidth, scaleY = state->size.height / rotatedHeight;
+    CGFloat x0 = CGRectGetMinX(rect) / scaleX, x1 = CGRectGetMaxX(rect) / scaleX;
+    CGFloat y0 = CGRectGetMinY(rect) / scaleY, y1 = CGRectGetMaxY(rect) / scaleY;
+    // 撤销镜像
+    if (state->mirrors) {
+        CGFloat mirroredX0 = rotatedWidth - x1;
+        x1 = rotatedWidth - x0;
+        x0 = mirroredX0;
+    }
+    // 撤销旋转，两个角分别换算
+    CGPoint corners[2] = {CGPointMake(x0, y0), CGPointMake(x1, y1)};
+    for (int i = 0; i < 2; i++) {
+        CGFloat rx = corners[i].x, ry = corners[i].y;
+        switch (state->rotation) {
+            case CQFrameRotation90: corners[i] = CGPointMake(ry, sourceHeight - rx); break;
+            case CQFrameRotation180: corners[i] = CGPointMake(sourceWidth - rx, sourceHeight - ry); break;
+            case CQFrameRotation270: corners[i] = CGPointMake(sourceWidth - ry, rx); break;
+            default: break;
+        }
+    }
+    return CGRectMake(state->sourceRect.origin.x + MIN(corners[0].x, corners[1].x), state->sourceRect.origin.y + MIN(corners[0].y, corners[1].y),
+                      fabs(corners[1].x - corners[0].x), fabs(corners[1].y - corners[0].y));
+}
+
+static void CQFilterStateCrop(CQFilterState *state, CGRect rect) {
+    rect = CGRectIntersection(rect, CGRectMake(0, 0, state->size.width, state->size.height));
+    if (CGRectIsEmpty(rect)) return;
+    state->sourceRect = CQFilterStateSourceRect(state, rect);
+    state->size = rect.size;
+}
+
+static void CQFilterStateScale(CQFilterState *state, CGSize size, CQFrameScaleMode mode) {
+    if (size.width < 2 || size.height < 2) return;
+    BOOL isWider = state->size.width * size.height > state->size.height * size.width;
+    if (mode == CQFrameScaleModeAspectFill) {
+        CGSize cropSize = isWider ? CGSizeMake(state->size.height * size.width / size.height, state->size.height) : CGSizeMake(state->size.width, state->size.width * size.height / size.width);
+        CQFilterStateCrop(state, CGRectMake((state->size.width - cropSize.width) / 2, (state->size.height - cropSize.height) / 2, cropSize.width, cropSize.height));
+    } else if (mode == CQFrameScaleModeAspectFit) {
+        CGSize contentSize = isWider ? CGSizeMake(size.width, state->size.height * size.width / state->size.width) : CGSizeMake(state->size.width * size.height / state->size.height, size.height);
+        state->isFitted = YES;
+        state->outputSize = size;
+        state->contentRect = CGRectMake((size.width - contentSize.width) / 2, (size.height - contentSize.height) / 2, contentSize.width, contentSize.height);
+    }
+    state->size = size;
+}
+
+/// 取偶数
+static size_t CQEvenFloor(CGFloat value) {
+    return value <= 0 ? 0 : ((size_t)value & ~(size_t)1);
+}
+
+static size_t CQEvenRound(CGFloat value) {
+    return value <= 0 ? 0 : ((size_t)(value / 2 + 0.5) * 2);
+}
+
+@implementation CQVideoFilterGraph
+{
+    CVPixelBufferPoolRef _outputPool;  ///< createProcessedPixelBuffer:的输出
+    CVPixelBufferPoolRef _conversionPool;  ///< RGB源转换成的YUV
+}
+
+#pragma mark - Init
+- (instancetype)initWithFilters:(NSArray<CQVideoFilter *> *)filters {
+    if (self = [super init]) {
+        _filters = [filters copy];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_outputPool) CVPixelBufferPoolRelease(_outputPool);
+    if (_conversionPool) CVPixelBufferPoolRelease(_conversionPool);
+}
+
+#pragma mark - Public Func
+- (CQFrameTransform)transformForSourceWidth:(size_t)width height:(size_t)height outputWidth:(size_t)outputWidth outputHeight:(size_t)outputHeight {
+    CQFilterState state = {0};
+    state.sourceRect = CGRectMake(0, 0, width & ~(size_t)1, height & ~(size_t)1);
+    state.size = state.sourceRect.size;
+    for (CQVideoFilter *filter in self.filters) {
+        if (state.isFitted) {
+            NSLog(@"CQVideoFilterGraph-filters after an aspect fit scale are ignored");
+            break;
+        }
+        switch (filter.type) {
+            case CQVideoFilterTypeCrop:
+                CQFilterStateCrop(&state, filter.rect);
+                break;
+            case CQVideoFilterTypeRotate:
+                state.rotation = (state.mirrors ? state.rotation - filter.rotation + 4 : state.rotation + filter.rotation) & 0x03;
+                if (filter.rotation & 1) state.size = CGSizeMake(state.size.height, state.size.width);
+                break;
+            case CQVideoFilterTypeMirror:
+                state.mirrors = !state.mirrors;
+                break;
+            case CQVideoFilterTypeScale:
+                CQFilterStateScale(&state, filter.size, filter.mode);
+                break;
+        }
+    }
+    // 目标宽高不同时再AspectFit一次
+    if (outputWidth && outputHeight && !state.isFitted) {
+        CQFilterStateScale(&state, CGSizeMake(outputWidth, outputHeight), CQFrameScaleModeAspectFit);
+    }
+    if (!state.isFitted) {
+        state.outputSize = state.size;
+        state.contentRect = CGRectMake(0, 0, state.size.width, state.size.height);
+    }
+    if (outputWidth && outputHeight && (CQEvenRound(state.outputSize.width) != outputWidth || CQEvenRound(state.outputSize.height) != outputHeight)) {
+        // 节点里的AspectFit和目标宽高不同，按比例换算黑边
+        CGFloat scale = MIN(outputWidth / state.outputSize.width, outputHeight / state.outputSize.height);
+        CGSize contentSize = CGSizeMake(state.contentRect.size.width * scale, state.contentRect.size.height * scale);
+        state.contentRect = CGRectMake((outputWidth - contentSize.width) / 2, (outputHeight - contentSize.height) / 2, contentSize.width, contentSize.height);
+        state.outputSize = CGSizeMake(outputWidth, outputHeight);
+    }
+
+    CQFrameTransform transform = {0};
+    transform.cropX = CQEvenFloor(state.sourceRect.origin.x);
+    transform.cropY = CQEvenFloor(state.sourceRect.origin.y);
+    transform.cropWidth = MIN(MAX(CQEvenRound(CGRectGetMaxX(state.sourceRect)), transform.cropX + 2), width & ~(size_t)1) - transform.cropX;
+    transform.cropHeight = MIN(MAX(CQEvenRound(CGRectGetMaxY(state.sourceRect)), transform.cropY + 2), height & ~(size_t)1) - transform.cropY;
+    transform.rotation = (CQFrameRotation)state.rotation;
+    transform.mirrors = state.mirrors;
+    transform.outputWidth = MAX(CQEvenRound(state.outputSize.width), (size_t)2);
+    transform.outputHeight = MAX(CQEvenRound(state.outputSize.height), (size_t)2);
+    transform.contentX = CQEvenFloor(state.contentRect.origin.x);
+    transform.contentY = CQEvenFloor(state.contentRect.origin.y);
+    transform.contentWidth = MIN(MAX(CQEvenRound(state.contentRect.size.width), (size_t)2), transform.outputWidth - transform.contentX);
+    transform.contentHeight = MIN(MAX(CQEvenRound(state.contentRect.size.height), (size_t)2), transform.outputHeight - transform.contentY);
+    return transform;
+}
+
+- (CVReturn)processPixelBuffer:(CVPixelBufferRef)source toPixelBuffer:(CVPixelBufferRef)destination {
+    CVPixelBufferRef yuvSource = [self createYUVPixelBufferWithSource:source format:CVPixelBufferGetPixelFormatType(destination)];
+    if (!yuvSource) return kCVReturnInvalidPixelFormat;
+    CQFrameTransform transform = [self transformForSourceWidth:CVPixelBufferGetWidth(yuvSource) height:CVPixelBufferGetHeight(yuvSource) outputWidth:CVPixelBufferGetWidth(destination) outputHeight:CVPixelBufferGetHeight(destination)];
+    CVReturn result = CQPixelBufferTransform(yuvSource, destination, &transform);
+    CVPixelBufferRelease(yuvSource);
+    return result;
+}
+
+- (CVPixelBufferRef)createProcessedPixelBuffer:(CVPixelBufferRef)source {
+    OSType format = CVPixelBufferGetPixelFormatType(source);
+    if (format == kCVPixelFormatType_32BGRA || format == kCVPixelFormatType_32RGBA) format = kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+    CQFrameTransform transform = [self transformForSourceWidth:CVPixelBufferGetWidth(source) height:CVPixelBufferGetHeight(source) outputWidth:0 outputHeight:0];
+    CVPixelBufferRef output = [self createPixelBufferFromPool:&_outputPool width:transform.outputWidth height:transform.outputHeight format:format];
+    if (!output) return NULL;
+    CVReturn result = [self processPixelBuffer:source toPixelBuffer:output];
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoFilterGraph-process failed. result = %d", (int)result);
+        CVPixelBufferRelease(output);
+        return NULL;
+    }
+    return output;
+}
+
+- (CMSampleBufferRef)createProcessedSampleBuffer:(CMSampleBufferRef)sampleBuffer {
+    CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+    if (!imageBuffer) return NULL;
+    CVPixelBufferRef output = [self createProcessedPixelBuffer:imageBuffer];
+    if (!output) return NULL;
+    CMSampleTimingInfo timing = {0};
+    CMSampleBufferGetSampleTimingInfo(sampleBuffer, 0, &timing);
+    CMVideoFormatDescriptionRef formatDescription = NULL;
+    CMSampleBufferRef outputSampleBuffer = NULL;
+    OSStatus status = CMVideoFormatDescriptionCreateForImageBuffer(kCFAllocatorDefault, output, &formatDescription);
+    if (status == noErr) {
+        status = CMSampleBufferCreateReadyWithImageBuffer(kCFAllocatorDefault, output, formatDescription, &timing, &outputSampleBuffer);
+    }
+    if (formatDescription) CFRelease(formatDescription);
+    CVPixelBufferRelease(output);
+    if (status != noErr) {
+        NSLog(@"CQVideoFilterGraph-CMSampleBufferCreateReadyWithImageBuffer failed. status = %d", (int)status);
+        return NULL;
+    }
+    CMPropagateAttachments(sampleBuffer, outputSampleBuffer);
+    // 采集时间戳不自动传递
+    CQCaptureTimestamp captureTimestamp;
+    if (CQCaptureTimestampFromSampleBuffer(sampleBuffer, &captureTimestamp)) {
+        CQCaptureTimestampAttach(outputSampleBuffer, captureTimestamp);
+    }
+    return outputSampleBuffer;
+}
+
+#pragma mark - Private Func
+/**
+ 源转换为YUV
+ @return YUV的源直接retain返回，RGB的源转换为format(NV12/I420)，失败返回NULL
+ */
+- (CVPixelBufferRef)createYUVPixelBufferWithSource:(CVPixelBufferRef)source format:(OSType)format CF_RETURNS_RETAINED {
+    OSType sourceFormat = CVPixelBufferGetPixelFormatType(source);
+    if (sourceFormat != kCVPixelFormatType_32BGRA && sourceFormat != kCVPixelFormatType_32RGBA) {
+        return CVPixelBufferRetain(source);
+    }
+    size_t width = CVPixelBufferGetWidth(source), height = CVPixelBufferGetHeight(source);
+    if ((width | height) & 1) {
+        NSLog(@"CQVideoFilterGraph-odd RGB source size is not supported");
+        return NULL;
+    }
+    CVPixelBufferRef yuvSource = [self createPixelBufferFromPool:&_conversionPool width:width height:height format:format];
+    if (!yuvSource) return NULL;
+    CVReturn result = CQPixelBufferConvertRGBToYUV(source, yuvSource, CQYUVMatrixForSize(width, height));
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoFilterGraph-CQPixelBufferConvertRGBToYUV failed. result = %d", (int)result);
+        CVPixelBufferRelease(yuvSource);
+        return NULL;
+    }
+    return yuvSource;
+}
+
+/// 从缓冲池取buffer，宽高或格式变化时重建缓冲池
+- (CVPixelBufferRef)createPixelBufferFromPool:(CVPixelBufferPoolRef *)pool width:(size_t)width height:(size_t)height format:(OSType)format CF_RETURNS_RETAINED {
+    if (*pool) {
+        NSDictionary *attributes = (__bridge NSDictionary *)CVPixelBufferPoolGetPixelBufferAttributes(*pool);
+        if ([attributes[(__bridge NSString *)kCVPixelBufferWidthKey] unsignedLongValue] != width
+            || [attributes[(__bridge NSString *)kCVPixelBufferHeightKey] unsignedLongValue] != height
+            || [attributes[(__bridge NSString *)kCVPixelBufferPixelFormatTypeKey] unsignedIntValue] != format) {
+            CVPixelBufferPoolRelease(*pool);
+            *pool = NULL;
+        }
+    }
+    if (!*pool) {
+        NSDictionary *attributes = @{
+            (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(format),
+            (__bridge NSString *)kCVPixelBufferWidthKey: @(width),
+            (__bridge NSString *)kCVPixelBufferHeightKey: @(height),
+            (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+        };
+        CVReturn result = CVPixelBufferPoolCreate(kCFAllocatorDefault, NULL, (__bridge CFDictionaryRef)attributes, pool);
+        if (result != kCVReturnSuccess) {
+            NSLog(@"CQVideoFilterGraph-CVPixelBufferPoolCreate failed. result = %d", (int)result);
+            return NULL;
+        }
+    }
+    CVPixelBufferRef pixelBuffer = NULL;
+    CVReturn result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, *pool, &pixelBuffer);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQVideoFilterGraph-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+        return NULL;
+    }
+    return pixelBuffer;
+}
+
+@end
@@ -0,0 +1,99 @@
+//
+//  CQYUVConverter.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+/**
+ RGB转YUV(BGRA/RGBA -> NV12/I420)
+ @discussion 采集输出kCVPixelFormatType_32BGRA或者在CPU上叠加过图像的帧，送入编码器前要转回YUV，
+ 交给VideoToolbox转换会占用编码的时间，这里直接写到编码器缓冲池的NV12里
+ 定点计算(系数放大256倍)，色度取2x2像素的平均值再转换，arm64上使用NEON一次处理16个像素，结果和标量实现完全相同
+ 按行分段，不同的段可以在不同线程同时转换
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// YUV矩阵
+typedef NS_ENUM(uint8_t, CQYUVMatrix) {
+    CQYUVMatrixBT601 = 0,  ///< 标清
+    CQYUVMatrixBT709 = 1,  ///< 高清
+};
+
+/// RGB像素的字节顺序
+typedef NS_ENUM(uint8_t, CQRGBOrder) {
+    CQRGBOrderBGRA = 0,  ///< kCVPixelFormatType_32BGRA
+    CQRGBOrderRGBA = 1,  ///< kCVPixelFormatType_32RGBA
+};
+
+/// 转换系数(放大256倍)
+typedef struct {
+    int16_t yR, yG, yB;
+    uint8_t yOffset;  ///< 视频范围为16，全范围为0
+    int16_t uR, uG, uB;  ///< 每组的和为0，灰色的色度正好是128
+    int16_t vR, vG, vB;
+} CQRGBToYUVCoefficients;
+
+/// 一帧的源和目标
+typedef struct {
+    const uint8_t *rgb;
+    size_t rgbBytesPerRow;
+    CQRGBOrder order;
+    uint8_t *y;
+    size_t yBytesPerRow;
+    uint8_t *u;  ///< NV12时为UV交错的平面
+    size_t uBytesPerRow;
+    uint8_t *_Nullable v;  ///< NV12时为NULL
+    size_t vBytesPerRow;
+    size_t width;
+    size_t height;
+    CQRGBToYUVCoefficients coefficients;
+} CQRGBToYUVFrame;
+
+/**
+ 生成转换系数
+ @param matrix 矩阵
+ @param isFullRange YES为全范围(0~255)，NO为视频范围(亮度16~235，色度16~240)
+ */
+FOUNDATION_EXPORT CQRGBToYUVCoefficients CQRGBToYUVCoefficientsMake(CQYUVMatrix matrix, BOOL isFullRange);
+
+/// 分辨率对应的默认矩阵: 高度不小于720为BT.709，否则为BT.601
+static inline CQYUVMatrix CQYUVMatrixForSize(size_t width, size_t height) {
+    return height >= 720 ? CQYUVMatrixBT709 : CQYUVMatrixBT601;
+}
+
+/**
+ 转换[rowBegin, rowEnd)行
+ @discussion rowBegin必须为偶数(一行色度对应两行亮度)，rowEnd超过高度时按高度处理，arm64上使用NEON
+ */
+FOUNDATION_EXPORT void CQRGBToYUVConvertRows(const CQRGBToYUVFrame *frame, size_t rowBegin, size_t rowEnd);
+
+/**
+ CQRGBToYUVConvertRows的标量实现
+ @discussion 结果和CQRGBToYUVConvertRows相同，用于基准测试对比
+ */
+FOUNDATION_EXPORT void CQRGBToYUVConvertRowsScalar(const CQRGBToYUVFrame *frame, size_t rowBegin, size_t rowEnd);
+
+/**
+ 转换一帧
+ @param frame 源和目标
+ @param bandCount 按行分成几段并行转换(dispatch_apply)，0为按CPU核数和高度自动选择，1为在当前线程转换
+ */
+FOUNDATION_EXPORT void CQRGBToYUVConvert(const CQRGBToYUVFrame *frame, size_t bandCount);
+
+/**
+ CVPixelBuffer转换
+ @discussion source为32BGRA/32RGBA，destination为NV12(420v/420f)或I420(y420/f420)，宽高相同，
+ 范围由destination的格式决定，并给destination设置对应的YCbCrMatrix附件
+ @param source 源
+ @param destination 目标，一般取自编码器的缓冲池
+ @param matrix 矩阵
+ @return 格式不支持返回kCVReturnInvalidPixelFormat，宽高不同返回kCVReturnInvalidSize
+ */
+FOUNDATION_EXPORT CVReturn CQPixelBufferConvertRGBToYUV(CVPixelBufferRef source, CVPixelBufferRef destination, CQYUVMatrix matrix);
+
+NS_ASSUME_NONNULL_END
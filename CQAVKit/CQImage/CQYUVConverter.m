@@ -0,0 +1,236 @@
+//
+//  CQYUVConverter.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 Y = (yR*R + yG*G + yB*B + 128) >> 8 + yOffset，系数都是正数且和不超过256，NEON用8位乘16位累加不会溢出
+ 2 色度先求2x2的平均值 (s + 2) >> 2，再 U = (uR*R + uG*G + uB*B + 128) >> 8 + 128，
+   系数绝对值的和不超过256，乘积和在int16范围内，NEON用带舍入的移位(vrshr)，不需要先加128
+ 3 每次处理两行(一行色度)，NEON一次16个像素(8个色度)，剩下不足16个的像素和奇数宽高的边缘交给标量，
+   边缘的2x2块缺的像素用最后一行/列补
+ 4 并行: 按两行对齐分段，dispatch_apply，段太小时线程调度的开销比转换还大，每段至少kMinRowPairsPerBand个两行
+ */
+
+#import "CQYUVConverter.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+static const size_t kMinRowPairsPerBand = 64;
+
+CQRGBToYUVCoefficients CQRGBToYUVCoefficientsMake(CQYUVMatrix matrix, BOOL isFullRange) {
+    double kr = matrix == CQYUVMatrixBT709 ? 0.2126 : 0.299;
+    double kb = matrix == CQYUVMatrixBT709 ? 0.0722 : 0.114;
+    // 视频范围亮度占219级，色度占224级
+    double lumaScale = isFullRange ? 256.0 : 256.0 * 219 / 255;
+    double chromaScale = isFullRange ? 128.0 : 128.0 * 224 / 255;
+    CQRGBToYUVCoefficients coefficients;
+    // 亮度系数的和必须正好是lumaScale取整(白色才能到235/255)，各自取整后差的部分补给小数部分最大的系数
+    double luma[3] = {kr * lumaScale, (1 - kr - kb) * lumaScale, kb * lumaScale};
+    int16_t lumaCoefficients[3];
+    long remainder = lround(lumaScale);
+    for (int i = 0; i < 3; i++) {
+        lumaCoefficients[i] = (int16_t)floor(luma[i]);
+        remainder -= lumaCoefficients[i];
+    }
+    for (; remainder > 0; remainder--) {
+        int largest = 0;
+        for (int i = 1; i < 3; i++) {
+            if (luma[i] - lumaCoefficients[i] > luma[largest] - lumaCoefficients[largest]) largest = i;
+        }
+        lumaCoefficients[largest]++;
+    }
+    coefficients.yR = lumaCoefficients[0];
+    coefficients.yG = lumaCoefficients[1];
+    coefficients.yB = lumaCoefficients[2];
+    coefficients.yOffset = isFullRange ? 0 : 16;
+    coefficients.uB = (int16_t)lround(chromaScale);
+    coefficients.uR = -(int16_t)lround(chromaScale * kr / (1 - kb));
+    coefficients.uG = -coefficients.uB - coefficients.uR;
+    coefficients.vR = (int16_t)lround(chromaScale);
+    coefficients.vB = -(int16_t)lround(chromaScale * kb / (1 - kr));
+    coefficients.vG = -coefficients.vR - coefficients.vB;
+    return coefficients;
+}
+
+static inline uint8_t CQClampToByte(int value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+/// 两行从xBegin(偶数)开始到行尾
+static void CQRGBToYUVConvertRowPairScalar(const CQRGBToYUVFrame *frame, size_t row, size_t xBegin) {
+    const CQRGBToYUVCoefficients *c = &frame->coefficients;
+    const int rIndex = frame->order == CQRGBOrderBGRA ? 2 : 0;
+    const int bIndex = 2 - rIndex;
+    BOOL hasRow1 = row + 1 < frame->height;
+    const uint8_t *rgbRows[2] = {frame->rgb + row * frame->rgbBytesPerRow, frame->rgb + (hasRow1 ? row + 1 : row) * frame->rgbBytesPerRow};
+    for (int i = 0; i < (hasRow1 ? 2 : 1); i++) {
+        uint8_t *y = frame->y + (row + i) * frame->yBytesPerRow;
+        for (size_t x = xBegin; x < frame->width; x++) {
+            const uint8_t *p = rgbRows[i] + x * 4;
+            y[x] = (uint8_t)(((c->yR * p[rIndex] + c->yG * p[1] + c->yB * p[bIndex] + 128) >> 8) + c->yOffset);
+        }
+    }
+    uint8_t *u = frame->u + row / 2 * frame->uBytesPerRow;
+    uint8_t *v = frame->v ? frame->v + row / 2 * frame->vBytesPerRow : NULL;
+    for (size_t x = xBegin; x < frame->width; x += 2) {
+        size_t x1 = x + 1 < frame->width ? x + 1 : x;
+        int sum[3] = {0};
+        for (int i = 0; i < 2; i++) {
+            const uint8_t *p0 = rgbRows[i] + x * 4, *p1 = rgbRows[i] + x1 * 4;
+            sum[0] += p0[rIndex] + p1[rIndex];
+            sum[1] += p0[1] + p1[1];
+            sum[2] += p0[bIndex] + p1[bIndex];
+        }
+        int r = (sum[0] + 2) >> 2, g = (sum[1] + 2) >> 2, b = (sum[2] + 2) >> 2;
+        uint8_t uValue = CQClampToByte(((c->uR * r + c->uG * g + c->uB * b + 128) >> 8) + 128);
+        uint8_t vValue = CQClampToByte(((c->vR * r + c->vG * g + c->vB * b + 128) >> 8) + 128);
+        if (v) {
+            u[x / 2] = uValue;
+            v[x / 2] = vValue;
+        } else {
+            u[x] = uValue;
+            u[x + 1] = vValue;
+        }
+    }
+}
+
+#if defined(__aarch64__)
+static inline uint8x16_t CQLumaNEON(uint8x16_t r, uint8x16_t g, uint8x16_t b, uint8x8_t yR, uint8x8_t yG, uint8x8_t yB, uint8x16_t yOffset) {
+    uint16x8_t low = vmull_u8(vget_low_u8(r), yR);
+    low = vmlal_u8(low, vget_low_u8(g), yG);
+    low = vmlal_u8(low, vget_low_u8(b), yB);
+    uint16x8_t high = vmull_u8(vget_high_u8(r), yR);
+    high = vmlal_u8(high, vget_high_u8(g), yG);
+    high = vmlal_u8(high, vget_high_u8(b), yB);
+    return vqaddq_u8(vcombine_u8(vrshrn_n_u16(low, 8), vrshrn_n_u16(high, 8)), yOffset);
+}
+
+/// 两行16个像素的2x2平均值，8个
+static inline int16x8_t CQAverage2x2NEON(uint8x16_t row0, uint8x16_t row1) {
+    uint16x8_t sum = vaddq_u16(vpaddlq_u8(row0), vpaddlq_u8(row1));
+    return vreinterpretq_s16_u16(vrshrq_n_u16(sum, 2));
+}
+
+static inline uint8x8_t CQChromaNEON(int16x8_t r, int16x8_t g, int16x8_t b, int16_t cR, int16_t cG, int16_t cB) {
+    int16x8_t sum = vmulq_n_s16(r, cR);
+    sum = vmlaq_n_s16(sum, g, cG);
+    sum = vmlaq_n_s16(sum, b, cB);
+    return vqmovun_s16(vaddq_s16(vrshrq_n_s16(sum, 8), vdupq_n_s16(128)));
+}
+
+static void CQRGBToYUVConvertRowPairNEON(const CQRGBToYUVFrame *frame, size_t row) {
+    const CQRGBToYUVCoefficients *c = &frame->coefficients;
+    const int rIndex = frame->order == CQRGBOrderBGRA ? 2 : 0;
+    const int bIndex = 2 - rIndex;
+    BOOL hasRow1 = row + 1 < frame->height;
+    const uint8_t *rgb0 = frame->rgb + row * frame->rgbBytesPerRow;
+    const uint8_t *rgb1 = hasRow1 ? rgb0 + frame->rgbBytesPerRow : rgb0;
+    uint8_t *y0 = frame->y + row * frame->yBytesPerRow;
+    uint8_t *y1 = y0 + frame->yBytesPerRow;
+    uint8_t *u = frame->u + row / 2 * frame->uBytesPerRow;
+    uint8_t *v = frame->v ? frame->v + row / 2 * frame->vBytesPerRow : NULL;
+    const uint8x8_t yR = vdup_n_u8((uint8_t)c->yR), yG = vdup_n_u8((uint8_t)c->yG), yB = vdup_n_u8((uint8_t)c->yB);
+    const uint8x16_t yOffset = vdupq_n_u8(c->yOffset);
+    size_t x = 0;
+    for (; x + 16 <= frame->width; x += 16) {
+        uint8x16x4_t p0 = vld4q_u8(rgb0 + x * 4);
+        uint8x16x4_t p1 = vld4q_u8(rgb1 + x * 4);
+        vst1q_u8(y0 + x, CQLumaNEON(p0.val[rIndex], p0.val[1], p0.val[bIndex], yR, yG, yB, yOffset));
+        if (hasRow1) vst1q_u8(y1 + x, CQLumaNEON(p1.val[rIndex], p1.val[1], p1.val[bIndex], yR, yG, yB, yOffset));
+        int16x8_t r = CQAverage2x2NEON(p0.val[rIndex], p1.val[rIndex]);
+        int16x8_t g = CQAverage2x2NEON(p0.val[1], p1.val[1]);
+        int16x8_t b = CQAverage2x2NEON(p0.val[bIndex], p1.val[bIndex]);
+        uint8x8_t uValue = CQChromaNEON(r, g, b, c->uR, c->uG, c->uB);
+        uint8x8_t vValue = CQChromaNEON(r, g, b, c->vR, c->vG, c->vB);
+        if (v) {
+            vst1_u8(u + x / 2, uValue);
+            vst1_u8(v + x / 2, vValue);
+        } else {
+            vst2_u8(u + x, (uint8x8x2_t){{uValue, vValue}});
+        }
+    }
+    if (x < frame->width) CQRGBToYUVConvertRowPairScalar(frame, row, x);
+}
+#endif
+
+void CQRGBToYUVConvertRowsScalar(const CQRGBToYUVFrame *frame, size_t rowBegin, size_t rowEnd) {
+    rowEnd = MIN(rowEnd, frame->height);
+    for (size_t row = rowBegin; row < rowEnd; row += 2) {
+        CQRGBToYUVConvertRowPairScalar(frame, row, 0);
+    }
+}
+
+void CQRGBToYUVConvertRows(const CQRGBToYUVFrame *frame, size_t rowBegin, size_t rowEnd) {
+#if defined(__aarch64__)
+    rowEnd = MIN(rowEnd, frame->height);
+    for (size_t row = rowBegin; row < rowEnd; row += 2) {
+        CQRGBToYUVConvertRowPairNEON(frame, row);
+    }
+#else
+    CQRGBToYUVConvertRowsScalar(frame, rowBegin, rowEnd);
+#endif
+}
+
+void CQRGBToYUVConvert(const CQRGBToYUVFrame *frame, size_t bandCount) {
+    size_t pairCount = (frame->height + 1) / 2;
+    if (bandCount == 0) {
+        bandCount = MIN([NSProcessInfo processInfo].activeProcessorCount, pairCount / kMinRowPairsPerBand);
+    }
+    bandCount = MAX(MIN(bandCount, pairCount), (size_t)1);
+    if (bandCount == 1) {
+        CQRGBToYUVConvertRows(frame, 0, frame->height);
+        return;
+    }
+    size_t pairsPerBand = (pairCount + bandCount - 1) / bandCount;
+    dispatch_apply(bandCount, DISPATCH_APPLY_AUTO, ^(size_t band) {
+        size_t rowBegin = band * pairsPerBand * 2;
+        CQRGBToYUVConvertRows(frame, rowBegin, rowBegin + pairsPerBand * 2);
+    });
+}
+
+CVReturn CQPixelBufferConvertRGBToYUV(CVPixelBufferRef source, CVPixelBufferRef destination, CQYUVMatrix matrix) {
+    OSType sourceFormat = CVPixelBufferGetPixelFormatType(source);
+    OSType destinationFormat = CVPixelBufferGetPixelFormatType(destination);
+    if (sourceFormat != kCVPixelFormatType_32BGRA && sourceFormat != kCVPixelFormatType_32RGBA) return kCVReturnInvalidPixelFormat;
+    BOOL isNV12 = destinationFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange || destinationFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange;
+    BOOL isI420 = destinationFormat == kCVPixelFormatType_420YpCbCr8Planar || destinationFormat == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+    if (!isNV12 && !isI420) return kCVReturnInvalidPixelFormat;
+    size_t width = CVPixelBufferGetWidth(source), height = CVPixelBufferGetHeight(source);
+    if (width != CVPixelBufferGetWidth(destination) || height != CVPixelBufferGetHeight(destination)) return kCVReturnInvalidSize;
+    BOOL isFullRange = destinationFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange || destinationFormat == kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+
+    CVReturn result = CVPixelBufferLockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+    if (result != kCVReturnSuccess) return result;
+    result = CVPixelBufferLockBaseAddress(destination, 0);
+    if (result != kCVReturnSuccess) {
+        CVPixelBufferUnlockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+        return result;
+    }
+    CQRGBToYUVFrame frame = {0};
+    frame.rgb = CVPixelBufferGetBaseAddress(source);
+    frame.rgbBytesPerRow = CVPixelBufferGetBytesPerRow(source);
+    frame.order = sourceFormat == kCVPixelFormatType_32BGRA ? CQRGBOrderBGRA : CQRGBOrderRGBA;
+    frame.y = CVPixelBufferGetBaseAddressOfPlane(destination, 0);
+    frame.yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(destination, 0);
+    frame.u = CVPixelBufferGetBaseAddressOfPlane(destination, 1);
+    frame.uBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(destination, 1);
+    if (isI420) {
+        frame.v = CVPixelBufferGetBaseAddressOfPlane(destination, 2);
+        frame.vBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(destination, 2);
+    }
+    frame.width = width;
+    frame.height = height;
+    frame.coefficients = CQRGBToYUVCoefficientsMake(matrix, isFullRange);
+    CQRGBToYUVConvert(&frame, 0);
+    CVPixelBufferUnlockBaseAddress(destination, 0);
+    CVPixelBufferUnlockBaseAddress(source, kCVPixelBufferLock_ReadOnly);
+
+    CFStringRef matrixKey = matrix == CQYUVMatrixBT709 ? kCVImageBufferYCbCrMatrix_ITU_R_709_2 : kCVImageBufferYCbCrMatrix_ITU_R_601_4;
+    CVBufferSetAttachment(destination, kCVImageBufferYCbCrMatrixKey, matrixKey, kCVAttachmentMode_ShouldPropagate);
+    return kCVReturnSuccess;
+}
@@ -0,0 +1,69 @@
+//
+//  CQFLVMuxer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ FLV封装器
+ @discussion 将CQVideoEncoder输出的H264/HEVC和CQAudioEncoder输出的AAC封装为FLV tag，每次调用返回一个完整的tag(含PreviousTagSize)，
+ 可以直接拼接写文件，或同一份数据发给多个HTTP-FLV客户端
+ 时间戳为毫秒，以第一帧的dts为0点
+ HEVC按Enhanced RTMP(veovera)规范写入: ExHeader + FourCC 'hvc1'，旧的播放器不认识，需要ffmpeg 6.1/flv.js等新版本
+ 非线程安全，应在同一个队列调用
+ */
+@interface CQFLVMuxer : NSObject
+
+/**
+ 唯一初始化函数
+ @param videoConfig 视频配置，为nil时不包含视频
+ @param audioConfig 音频配置，为nil时不包含音频
+ */
+- (instancetype)initWithVideoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly, nullable) CQVideoCoderConfig *videoConfig;  ///< 视频配置信息
+@property (nonatomic, strong, readonly, nullable) CQAudioCoderConfig *audioConfig;  ///< 音频配置信息
+
+/// FLV文件头(9字节 + PreviousTagSize0) + onMetaData
+- (NSData *)headerData;
+
+/**
+ 视频序列头tag，H264为AVCDecoderConfigurationRecord，HEVC为HEVCDecoderConfigurationRecord
+ @param sps sps数据，Annex-B格式(CQVideoEncoder回调的格式)，HEVC为vps + sps
+ @param pps pps数据，Annex-B格式
+ */
+- (nullable NSData *)videoSequenceHeaderTagWithSps:(NSData *)sps pps:(NSData *)pps;
+
+/// AAC序列头tag(AudioSpecificConfig)，没有音频时返回nil
+- (nullable NSData *)audioSequenceHeaderTag;
+
+/**
+ 封装一帧视频
+ @param nalus 该帧的所有NALU，Annex-B格式，参数集/AUD会被去掉(参数集由序列头tag提供)
+ @param pts 显示时间戳
+ @param dts 解码时间戳
+ @param isKeyFrame 是否为关键帧
+ @return 视频tag，没有可写的NALU时返回nil
+ */
+- (nullable NSData *)videoTagWithNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 封装一帧音频
+ @param aacData AAC数据，可以是裸数据，也可以带ADTS头(会去掉)
+ @param pts 显示时间戳
+ */
+- (nullable NSData *)audioTagWithData:(NSData *)aacData pts:(CMTime)pts;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,289 @@
+//
+//  CQFLVMuxer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ FLV结构
+ 文件头: 'FLV' + 版本1 + 音视频标志 + 头长度9，后面跟PreviousTagSize0(4字节0)
+ tag: 11字节tag头(类型 + 数据长度24位 + 时间戳24位 + 扩展时间戳8位 + StreamID 0) + 数据 + PreviousTagSize(11 + 数据长度)
+ 视频数据: 帧类型/编码ID(0x17关键帧 0x27非关键帧) + AVCPacketType(0序列头 1NALU) + CompositionTime(pts-dts，24位有符号) + AVCC格式的NALU
+ HEVC视频数据(Enhanced RTMP): 0x80(IsExHeader) | 帧类型 << 4 | PacketType(0序列头 1带CompositionTime的帧 3CompositionTime为0的帧) + FourCC 'hvc1' + 数据
+ 音频数据: 0xAF(AAC固定写44KHz/16位/立体声，实际参数在AudioSpecificConfig) + AACPacketType(0序列头 1裸数据) + 数据
+
+ 思路
+ 1 每帧先算好总长度，一次分配，tag头、NALU长度和数据直接写进去
+ 2 参数集/AUD不写进帧数据，sps/pps变化时由调用方重新生成序列头tag
+ 3 H264和HEVC的帧数据都是4字节长度的NALU，只有视频数据头不同
+ */
+
+#import "CQFLVMuxer.h"
+#import "CQNaluUtil.h"
+#import "CQADTSUtil.h"
+#import "CQHEVCParameterSets.h"
+
+static const uint8_t kFLVTagTypeAudio = 8;
+static const uint8_t kFLVTagTypeVideo = 9;
+static const uint8_t kFLVTagTypeScript = 18;
+static const size_t kFLVTagHeaderSize = 11;
+static const size_t kFLVPreviousTagSizeLength = 4;
+static const uint8_t kFLVCodecIdAVC = 7;
+static const uint32_t kFLVFourCCHEVC = 0x68766331;  // 'hvc1'
+static const uint8_t kFLVExHeader = 0x80;
+static const uint8_t kFLVPacketTypeSequenceStart = 0;
+static const uint8_t kFLVPacketTypeCodedFrames = 1;
+static const uint8_t kFLVPacketTypeCodedFramesX = 3;
+static const uint8_t kFLVSoundFormatAAC = 10;
+static const uint8_t kFLVAACSoundFlags = 0xAF;  // AAC | 44KHz | 16位 | 立体声
+
+static inline void CQFLVWriteUInt16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static inline void CQFLVWriteUInt24(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 16);
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)value;
+}
+
+static inline void CQFLVWriteUInt32(uint8_t *p, uint32_t value) {
+    CQFLVWriteUInt16(p, (uint16_t)(value >> 16));
+    CQFLVWriteUInt16(p + 2, (uint16_t)value);
+}
+
+/// 分配一个完整的tag，写好tag头和PreviousTagSize，数据部分从kFLVTagHeaderSize开始
+static NSMutableData *CQFLVCreateTag(uint8_t type, size_t dataSize, uint32_t timestamp) {
+    NSMutableData *tag = [NSMutableData dataWithLength:kFLVTagHeaderSize + dataSize + kFLVPreviousTagSizeLength];
+    uint8_t *p = tag.mutableBytes;
+    p[0] = type;
+    CQFLVWriteUInt24(p + 1, (uint32_t)dataSize);
+    CQFLVWriteUInt24(p + 4, timestamp & 0xFFFFFF);
+    p[7] = (uint8_t)(timestamp >> 24);
+    CQFLVWriteUInt24(p + 8, 0);
+    CQFLVWriteUInt32(p + kFLVTagHeaderSize + dataSize, (uint32_t)(kFLVTagHeaderSize + dataSize));
+    return tag;
+}
+
+@implementation CQFLVMuxer
+{
+    int64_t _baseTimestamp;  ///< 时间0点(毫秒)
+    BOOL _hasBaseTimestamp;
+    uint32_t _lastTimestamp;  ///< 最近一个tag的时间戳，序列头使用
+}
+
+#pragma mark - Init
+- (instancetype)initWithVideoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig {
+    if (self = [super init]) {
+        _videoConfig = videoConfig;
+        _audioConfig = audioConfig;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    NSLog(@"CQFLVMuxer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSData *)headerData {
+    NSMutableData *header = [NSMutableData dataWithLength:9 + kFLVPreviousTagSizeLength];
+    uint8_t *p = header.mutableBytes;
+    p[0] = 'F'; p[1] = 'L'; p[2] = 'V';
+    p[3] = 1;
+    p[4] = (self.audioConfig ? 0x04 : 0) | (self.videoConfig ? 0x01 : 0);
+    CQFLVWriteUInt32(p + 5, 9);
+    [header appendData:[self metaDataTag]];
+    return header;
+}
+
+- (NSData *)videoSequenceHeaderTagWithSps:(NSData *)sps pps:(NSData *)pps {
+    if (self.videoConfig.codec == CQVideoCodecHEVC) return [self hevcSequenceHeaderTagWithSps:sps pps:pps];
+    size_t spsSize = 0, ppsSize = 0;
+    const uint8_t *spsBytes = CQNaluSkipStartCode(sps.bytes, sps.length, &spsSize);
+    const uint8_t *ppsBytes = CQNaluSkipStartCode(pps.bytes, pps.length, &ppsSize);
+    if (!spsBytes || spsSize < 4 || !ppsBytes || ppsSize == 0) return nil;
+
+    // AVCDecoderConfigurationRecord
+    size_t dataSize = 5 + 6 + 2 + spsSize + 1 + 2 + ppsSize;
+    NSMutableData *tag = CQFLVCreateTag(kFLVTagTypeVideo, dataSize, _lastTimestamp);
+    uint8_t *p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+    p[0] = 0x10 | kFLVCodecIdAVC;
+    p[1] = 0;  // AVC sequence header
+    CQFLVWriteUInt24(p + 2, 0);
+    p += 5;
+    p[0] = 1;  // configurationVersion
+    p[1] = spsBytes[1];  // AVCProfileIndication
+    p[2] = spsBytes[2];  // profile_compatibility
+    p[3] = spsBytes[3];  // AVCLevelIndication
+    p[4] = 0xFF;  // lengthSizeMinusOne = 3
+    p[5] = 0xE1;  // numOfSequenceParameterSets = 1
+    CQFLVWriteUInt16(p + 6, (uint16_t)spsSize);
+    memcpy(p + 8, spsBytes, spsSize);
+    p += 8 + spsSize;
+    p[0] = 1;  // numOfPictureParameterSets
+    CQFLVWriteUInt16(p + 1, (uint16_t)ppsSize);
+    memcpy(p + 3, ppsBytes, ppsSize);
+    return tag;
+}
+
+- (NSData *)audioSequenceHeaderTag {
+    if (!self.audioConfig) return nil;
+    int freqIdx = CQADTSSampleRateIndex(self.audioConfig.sampleRate);
+    if (freqIdx < 0) freqIdx = 4;
+    // AudioSpecificConfig: audioObjectType(5) samplingFrequencyIndex(4) channelConfiguration(4)
+    uint16_t config = (uint16_t)((2 << 11) | (freqIdx << 7) | ((int)self.audioConfig.channelCount << 3));
+    NSMutableData *tag = CQFLVCreateTag(kFLVTagTypeAudio, 4, _lastTimestamp);
+    uint8_t *p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+    p[0] = kFLVAACSoundFlags;
+    p[1] = 0;  // AAC sequence header
+    CQFLVWriteUInt16(p + 2, config);
+    return tag;
+}
+
+- (NSData *)videoTagWithNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    if (!self.videoConfig) return nil;
+    __block size_t naluTotalSize = 0;
+    for (NSData *naluData in nalus) {
+        CQNaluEnumerateAnnexB(naluData.bytes, naluData.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            if ([self shouldWriteNalu:nalu]) naluTotalSize += 4 + naluSize;
+        });
+    }
+    if (naluTotalSize == 0) return nil;
+
+    if (!CMTIME_IS_VALID(dts)) dts = pts;
+    int64_t dtsMs = [self millisecondsFromTime:dts];
+    int64_t ptsMs = CMTIME_IS_VALID(pts) ? [self millisecondsFromTime:pts] : dtsMs;
+    uint32_t timestamp = [self timestampFromMilliseconds:dtsMs];
+    uint32_t compositionTime = (uint32_t)(ptsMs - dtsMs) & 0xFFFFFF;
+    NSMutableData *tag = nil;
+    uint8_t *p = NULL;
+    size_t videoHeaderSize = 5;
+    if (self.videoConfig.codec == CQVideoCodecHEVC) {
+        // 没有B帧时CompositionTime都是0，用CodedFramesX省掉3字节
+        videoHeaderSize = compositionTime ? 8 : 5;
+        tag = CQFLVCreateTag(kFLVTagTypeVideo, videoHeaderSize + naluTotalSize, timestamp);
+        p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+        p[0] = kFLVExHeader | (isKeyFrame ? 0x10 : 0x20) | (compositionTime ? kFLVPacketTypeCodedFrames : kFLVPacketTypeCodedFramesX);
+        CQFLVWriteUInt32(p + 1, kFLVFourCCHEVC);
+        if (compositionTime) CQFLVWriteUInt24(p + 5, compositionTime);
+    } else {
+        tag = CQFLVCreateTag(kFLVTagTypeVideo, videoHeaderSize + naluTotalSize, timestamp);
+        p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+        p[0] = (isKeyFrame ? 0x10 : 0x20) | kFLVCodecIdAVC;
+        p[1] = 1;  // AVC NALU
+        CQFLVWriteUInt24(p + 2, compositionTime);
+    }
+    __block uint8_t *cursor = p + videoHeaderSize;
+    for (NSData *naluData in nalus) {
+        CQNaluEnumerateAnnexB(naluData.bytes, naluData.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            if (![self shouldWriteNalu:nalu]) return;
+            CQFLVWriteUInt32(cursor, (uint32_t)naluSize);
+            memcpy(cursor + 4, nalu, naluSize);
+            cursor += 4 + naluSize;
+        });
+    }
+    return tag;
+}
+
+- (NSData *)audioTagWithData:(NSData *)aacData pts:(CMTime)pts {
+    if (!self.audioConfig || aacData.length == 0) return nil;
+    size_t headerLength = CQADTSHeaderLength(aacData.bytes, aacData.length);
+    size_t rawLength = aacData.length - headerLength;
+    if (rawLength == 0) return nil;
+    uint32_t timestamp = [self timestampFromMilliseconds:[self millisecondsFromTime:pts]];
+    NSMutableData *tag = CQFLVCreateTag(kFLVTagTypeAudio, 2 + rawLength, timestamp);
+    uint8_t *p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+    p[0] = kFLVAACSoundFlags;
+    p[1] = 1;  // AAC raw
+    memcpy(p + 2, (const uint8_t *)aacData.bytes + headerLength, rawLength);
+    return tag;
+}
+
+#pragma mark - Private Func
+- (BOOL)shouldWriteNalu:(const uint8_t *)nalu {
+    CQNaluKind kind = CQNaluKindOf(self.videoConfig.codec, nalu);
+    return kind != CQNaluKindParameterSet && kind != CQNaluKindAUD;
+}
+
+/// HEVC序列头tag: ExHeader + 'hvc1' + HEVCDecoderConfigurationRecord
+- (NSData *)hevcSequenceHeaderTagWithSps:(NSData *)sps pps:(NSData *)pps {
+    __block const uint8_t *parameterSets[3] = {NULL};  // vps, sps, pps
+    __block size_t parameterSetSizes[3] = {0};
+    for (NSData *data in @[sps, pps]) {
+        CQNaluEnumerateAnnexB(data.bytes, data.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            CQHEVCNaluType type = CQHEVCNaluTypeOf(nalu);
+            if (type < CQHEVCNaluTypeVPS || type > CQHEVCNaluTypePPS) return;
+            parameterSets[type - CQHEVCNaluTypeVPS] = nalu;
+            parameterSetSizes[type - CQHEVCNaluTypeVPS] = naluSize;
+        });
+    }
+    if (!parameterSets[0] || !parameterSets[1] || !parameterSets[2]) return nil;
+
+    size_t recordSize = CQHEVCDecoderConfigurationRecordSize(parameterSetSizes[0], parameterSetSizes[1], parameterSetSizes[2]);
+    NSMutableData *tag = CQFLVCreateTag(kFLVTagTypeVideo, 5 + recordSize, _lastTimestamp);
+    uint8_t *p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+    p[0] = kFLVExHeader | 0x10 | kFLVPacketTypeSequenceStart;
+    CQFLVWriteUInt32(p + 1, kFLVFourCCHEVC);
+    size_t written = CQHEVCWriteDecoderConfigurationRecord(parameterSets[0], parameterSetSizes[0], parameterSets[1], parameterSetSizes[1], parameterSets[2], parameterSetSizes[2], p + 5);
+    return written == recordSize ? tag : nil;
+}
+
+- (int64_t)millisecondsFromTime:(CMTime)time {
+    return CMTimeConvertScale(time, 1000, kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+}
+
+/// 以第一帧为0点
+- (uint32_t)timestampFromMilliseconds:(int64_t)milliseconds {
+    if (!_hasBaseTimestamp) {
+        _baseTimestamp = milliseconds;
+        _hasBaseTimestamp = YES;
+    }
+    _lastTimestamp = (uint32_t)MAX(0, milliseconds - _baseTimestamp);
+    return _lastTimestamp;
+}
+
+/// onMetaData: AMF0字符串"onMetaData" + ECMA数组
+- (NSData *)metaDataTag {
+    NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithObject:@"duration"];
+    NSMutableArray<NSNumber *> *values = [NSMutableArray arrayWithObject:@0];
+    if (self.videoConfig) {
+        [keys addObjectsFromArray:@[@"width", @"height", @"framerate", @"videodatarate", @"videocodecid"]];
+        [values addObjectsFromArray:@[@(self.videoConfig.width), @(self.videoConfig.height), @(self.videoConfig.fps), @(self.videoConfig.bitrate / 1000.0), @(self.videoConfig.codec == CQVideoCodecHEVC ? kFLVFourCCHEVC : kFLVCodecIdAVC)]];
+    }
+    if (self.audioConfig) {
+        [keys addObjectsFromArray:@[@"audiosamplerate", @"audiosamplesize", @"audiodatarate", @"audiocodecid"]];
+        [values addObjectsFromArray:@[@(self.audioConfig.sampleRate), @(self.audioConfig.sampleSize), @(self.audioConfig.bitrate / 1000.0), @(kFLVSoundFormatAAC)]];
+    }
+
+    NSMutableData *script = [NSMutableData data];
+    uint8_t bytes[9];
+    bytes[0] = 0x02;  // string
+    CQFLVWriteUInt16(bytes + 1, 10);
+    [script appendBytes:bytes length:3];
+    [script appendBytes:"onMetaData" length:10];
+    bytes[0] = 0x08;  // ECMA array
+    CQFLVWriteUInt32(bytes + 1, (uint32_t)keys.count);
+    [script appendBytes:bytes length:5];
+    for (NSUInteger i = 0; i < keys.count; i++) {
+        NSData *key = [keys[i] dataUsingEncoding:NSUTF8StringEncoding];
+        CQFLVWriteUInt16(bytes, (uint16_t)key.length);
+        [script appendBytes:bytes length:2];
+        [script appendData:key];
+        bytes[0] = 0x00;  // number
+        CFSwappedFloat64 value = CFConvertDoubleHostToSwapped(values[i].doubleValue);
+        memcpy(bytes + 1, &value, 8);
+        [script appendBytes:bytes length:9];
+    }
+    static const uint8_t objectEnd[] = {0x00, 0x00, 0x09};
+    [script appendBytes:objectEnd length:sizeof(objectEnd)];
+
+    NSMutableData *tag = CQFLVCreateTag(kFLVTagTypeScript, script.length, 0);
+    uint8_t *p = (uint8_t *)tag.mutableBytes + kFLVTagHeaderSize;
+    memcpy(p, script.bytes, script.length);
+    return tag;
+}
+
+@end
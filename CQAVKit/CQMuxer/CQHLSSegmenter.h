@@ -0,0 +1,97 @@
+//
+//  CQHLSSegmenter.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+
+@class CQHLSSegmenter;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol CQHLSSegmenterDelegate <NSObject>
+@optional
+/**
+ 一个切片写完并加入播放列表(在写文件队列回调)
+ @param segmentPath 切片文件路径
+ @param duration 切片时长(秒)
+ */
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didFinishSegmentAtPath:(NSString *)segmentPath duration:(NSTimeInterval)duration;
+
+/**
+ 播放列表已更新(在写文件队列回调)
+ @param playlistPath 播放列表路径
+ */
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didUpdatePlaylistAtPath:(NSString *)playlistPath;
+
+/**
+ 写文件失败
+ @param error 错误信息
+ */
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didFailWithError:(NSError *)error;
+
+@end
+
+/**
+ HLS切片器
+ @discussion 用CQTSMuxer封装CQVideoEncoder/CQAudioEncoder的输出，在视频关键帧(IDR)处切片，写出TS切片和m3u8播放列表
+ 切片只在IDR处切，时长达到targetDuration后的第一个IDR开始新切片，所以实际时长是编码器关键帧间隔(fps*2帧)的整数倍
+ playlistWindow大于0时为滚动直播列表，移出窗口的切片会被删除；为0时为EVENT列表，保留所有切片
+ partTargetDuration大于0时开启LL-HLS，在帧边界切出部分切片，以BYTERANGE引用切片文件，不额外写文件
+ 文件读写在单独的写文件队列进行，下一个切片文件会提前创建并预分配空间，切片时只需要切换文件
+ */
+@interface CQHLSSegmenter : NSObject
+
+/**
+ 唯一初始化函数
+ @param directory 输出目录，不存在会创建
+ @param videoConfig 视频配置，为nil时只有音频
+ @param audioConfig 音频配置，为nil时只有视频
+ */
+- (instancetype)initWithDirectory:(NSString *)directory videoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *directory;  ///< 输出目录
+@property (nonatomic, copy, readonly) NSString *playlistPath;  ///< 播放列表路径
+
+@property (nonatomic, weak) id<CQHLSSegmenterDelegate> delegate;  ///< 代理
+
+// 以下属性需要在输入第一帧前设置
+@property (nonatomic, copy) NSString *playlistName;  ///< 播放列表文件名，默认index.m3u8
+@property (nonatomic, copy) NSString *segmentPrefix;  ///< 切片文件名前缀，默认segment，切片名为segment0.ts segment1.ts...
+@property (nonatomic, assign) NSTimeInterval targetDuration;  ///< 目标切片时长，默认6秒，应为关键帧间隔的整数倍
+@property (nonatomic, assign) NSUInteger playlistWindow;  ///< 播放列表保留的切片个数，默认6，0为保留所有
+@property (nonatomic, assign) NSTimeInterval partTargetDuration;  ///< LL-HLS部分切片时长，默认0不开启，建议0.3~1秒
+
+/**
+ 设置sps/pps
+ @param sps sps数据，Annex-B格式
+ @param pps pps数据，Annex-B格式
+ */
+- (void)setSps:(NSData *)sps pps:(NSData *)pps;
+
+/**
+ 输入一帧视频(CQVideoEncoder的videoEncoder:didEncodeFrameWithNalus:pts:dts:isKeyFrame:)
+ */
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 输入一帧音频(CQAudioEncoder的audioEncoder:didEncodeRawAACData:pts:)
+ */
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts;
+
+/**
+ 结束，写完最后一个切片并在播放列表末尾加上EXT-X-ENDLIST
+ @param completionHandler 所有文件写完后在写文件队列回调
+ */
+- (void)finishWithCompletionHandler:(nullable void (^)(void))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,384 @@
+//
+//  CQHLSSegmenter.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 音视频交给CQTSMuxer封装，实现其帧边界回调，每帧写入前判断是否切片/切部分切片
+ 2 切片状态只在CQTSMuxer的封装队列访问(它的所有回调都在该队列)，不需要加锁
+ 3 文件操作都派发到写文件队列，按顺序执行，切片数据一定先于引用它的播放列表写完
+ 4 当前切片打开时，写文件队列提前创建下一个切片文件并预分配空间
+ 5 播放列表先写临时文件再rename，客户端不会读到写了一半的列表
+ */
+
+#import "CQHLSSegmenter.h"
+#import "CQTSMuxer.h"
+#import <fcntl.h>
+#import <unistd.h>
+
+static const NSUInteger kExpiredSegmentsToKeep = 2;  ///< 移出窗口后暂不删除的切片数，给正在下载的客户端留时间
+static const NSUInteger kPartListSegmentCount = 2;  ///< LL-HLS列出部分切片的已完成切片数
+static const double kPartCutRatio = 0.85;  ///< 部分切片达到目标时长的比例就切，保证加上一帧后不超过PART-TARGET
+
+#pragma mark - Model
+/// 部分切片
+@interface CQHLSPart : NSObject
+@property (nonatomic, assign) double duration;
+@property (nonatomic, assign) uint64_t offset;  ///< 在切片文件中的偏移
+@property (nonatomic, assign) uint64_t length;
+@property (nonatomic, assign) BOOL isIndependent;  ///< 是否以关键帧开始
+@end
+
+@implementation CQHLSPart
+@end
+
+/// 切片
+@interface CQHLSSegment : NSObject
+@property (nonatomic, assign) NSUInteger index;
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, assign) double startTime;
+@property (nonatomic, assign) double duration;
+@property (nonatomic, assign) uint64_t length;  ///< 已写入的字节数
+@property (nonatomic, strong) NSMutableArray<CQHLSPart *> *parts;
+@end
+
+@implementation CQHLSSegment
+@end
+
+#pragma mark - CQHLSSegmenter
+@interface CQHLSSegmenter () <CQTSMuxerDelegate>
+@property (nonatomic, strong) CQTSMuxer *tsMuxer;  ///< TS封装器
+@property (nonatomic, strong, nullable) CQVideoCoderConfig *videoConfig;
+@property (nonatomic, strong, nullable) CQAudioCoderConfig *audioConfig;
+@property (nonatomic, strong) dispatch_queue_t writeQueue;  ///< 写文件队列
+// 以下只在封装队列访问
+@property (nonatomic, strong) NSMutableArray<CQHLSSegment *> *segments;  ///< 播放列表窗口内已完成的切片
+@property (nonatomic, strong) NSMutableArray<CQHLSSegment *> *expiredSegments;  ///< 移出窗口等待删除的切片
+@property (nonatomic, strong, nullable) CQHLSSegment *currentSegment;  ///< 正在写的切片
+@end
+
+@implementation CQHLSSegmenter
+{
+    // 封装队列
+    NSUInteger _nextSegmentIndex;
+    double _partStartTime;
+    uint64_t _partStartOffset;
+    BOOL _partIsIndependent;
+    double _lastFrameTime;
+    double _maxSegmentDuration;
+    BOOL _isFinished;
+    // 写文件队列
+    int _segmentFD;
+    int _preparedFD;
+    NSUInteger _preparedIndex;
+}
+
+#pragma mark - Init
+- (instancetype)initWithDirectory:(NSString *)directory videoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig {
+    if (self = [super init]) {
+        _directory = [directory copy];
+        _videoConfig = videoConfig;
+        _audioConfig = audioConfig;
+        _playlistName = @"index.m3u8";
+        _segmentPrefix = @"segment";
+        _targetDuration = 6;
+        _playlistWindow = 6;
+        _writeQueue = dispatch_queue_create("CQHLSSegmenter write queue", DISPATCH_QUEUE_SERIAL);
+        _segments = [NSMutableArray array];
+        _expiredSegments = [NSMutableArray array];
+        _segmentFD = -1;
+        _preparedFD = -1;
+        _tsMuxer = [[CQTSMuxer alloc] initWithVideoConfig:videoConfig audioConfig:audioConfig];
+        _tsMuxer.delegate = self;
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_segmentFD >= 0) close(_segmentFD);
+    if (_preparedFD >= 0) close(_preparedFD);
+    NSLog(@"CQHLSSegmenter - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSString *)playlistPath {
+    return [self.directory stringByAppendingPathComponent:self.playlistName];
+}
+
+- (void)setSps:(NSData *)sps pps:(NSData *)pps {
+    [self.tsMuxer setSps:sps pps:pps];
+}
+
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    [self.tsMuxer muxVideoNalus:nalus pts:pts dts:dts isKeyFrame:isKeyFrame];
+}
+
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts {
+    [self.tsMuxer muxAudioData:aacData pts:pts];
+}
+
+- (void)finishWithCompletionHandler:(void (^)(void))completionHandler {
+    [self.tsMuxer flushWithCompletionHandler:^{
+        if (self.currentSegment && !self->_isFinished) {
+            // 最后一帧的时长未知，按一帧估算
+            double endTime = self->_lastFrameTime + [self frameInterval];
+            [self finishPartAtTime:endTime isIndependent:NO];
+            [self finishSegmentAtTime:endTime];
+        }
+        self->_isFinished = YES;
+        [self writePlaylist];
+        dispatch_async(self.writeQueue, ^{
+            [self discardPreparedFile];
+            if (completionHandler) completionHandler();
+        });
+    }];
+}
+
+#pragma mark - CQTSMuxerDelegate
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData {
+    CQHLSSegment *segment = self.currentSegment;
+    if (!segment || _isFinished) return;
+    segment.length += tsData.length;
+    dispatch_async(self.writeQueue, ^{
+        [self writeData:tsData];
+    });
+}
+
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer willWriteFrameAtTime:(CMTime)time isVideo:(BOOL)isVideo isKeyFrame:(BOOL)isKeyFrame {
+    if (_isFinished) return;
+    double t = CMTimeGetSeconds(time);
+    _lastFrameTime = MAX(_lastFrameTime, t);
+    // 有视频时只在关键帧切片，纯音频时每帧都可以切
+    BOOL isIndependent = isVideo ? isKeyFrame : (self.videoConfig == nil);
+
+    if (!self.currentSegment) {
+        [self startSegmentAtTime:t isIndependent:isIndependent];
+        return;
+    }
+    if (isIndependent && t - self.currentSegment.startTime >= self.targetDuration - 0.01) {
+        [self finishPartAtTime:t isIndependent:isIndependent];
+        [self finishSegmentAtTime:t];
+        [self startSegmentAtTime:t isIndependent:isIndependent];
+        [self writePlaylist];
+        return;
+    }
+    if (self.partTargetDuration > 0 && t - _partStartTime >= self.partTargetDuration * kPartCutRatio) {
+        [self finishPartAtTime:t isIndependent:isIndependent];
+        [self writePlaylist];
+    }
+}
+
+#pragma mark - Segment
+- (void)startSegmentAtTime:(double)time isIndependent:(BOOL)isIndependent {
+    CQHLSSegment *segment = [[CQHLSSegment alloc] init];
+    segment.index = _nextSegmentIndex++;
+    segment.name = [NSString stringWithFormat:@"%@%lu.ts", self.segmentPrefix, (unsigned long)segment.index];
+    segment.startTime = time;
+    segment.parts = [NSMutableArray array];
+    self.currentSegment = segment;
+    _partStartTime = time;
+    _partStartOffset = 0;
+    _partIsIndependent = isIndependent;
+    // 每个切片都要能单独解码，开头需要PAT/PMT
+    [self.tsMuxer insertPSIBeforeNextFrame];
+
+    NSUInteger index = segment.index;
+    NSString *path = [self.directory stringByAppendingPathComponent:segment.name];
+    dispatch_async(self.writeQueue, ^{
+        [self openSegmentAtIndex:index path:path];
+    });
+}
+
+- (void)finishSegmentAtTime:(double)time {
+    CQHLSSegment *segment = self.currentSegment;
+    segment.duration = MAX(0, time - segment.startTime);
+    _maxSegmentDuration = MAX(_maxSegmentDuration, segment.duration);
+    self.currentSegment = nil;
+    [self.segments addObject:segment];
+
+    // 滚动窗口
+    if (self.playlistWindow > 0) {
+        while (self.segments.count > self.playlistWindow) {
+            [self.expiredSegments addObject:self.segments.firstObject];
+            [self.segments removeObjectAtIndex:0];
+        }
+        while (self.expiredSegments.count > kExpiredSegmentsToKeep) {
+            NSString *path = [self.directory stringByAppendingPathComponent:self.expiredSegments.firstObject.name];
+            [self.expiredSegments removeObjectAtIndex:0];
+            dispatch_async(self.writeQueue, ^{
+                unlink(path.fileSystemRepresentation);
+            });
+        }
+    }
+
+    NSString *path = [self.directory stringByAppendingPathComponent:segment.name];
+    NSTimeInterval duration = segment.duration;
+    dispatch_async(self.writeQueue, ^{
+        [self closeSegment];
+        if (self.delegate && [self.delegate respondsToSelector:@selector(hlsSegmenter:didFinishSegmentAtPath:duration:)]) {
+            [self.delegate hlsSegmenter:self didFinishSegmentAtPath:path duration:duration];
+        }
+    });
+}
+
+/// 结束当前部分切片并开始下一个
+- (void)finishPartAtTime:(double)time isIndependent:(BOOL)nextIsIndependent {
+    CQHLSSegment *segment = self.currentSegment;
+    if (self.partTargetDuration > 0 && segment && segment.length > _partStartOffset) {
+        CQHLSPart *part = [[CQHLSPart alloc] init];
+        part.duration = MAX(0, time - _partStartTime);
+        part.offset = _partStartOffset;
+        part.length = segment.length - _partStartOffset;
+        part.isIndependent = _partIsIndependent;
+        [segment.parts addObject:part];
+    }
+    _partStartTime = time;
+    _partStartOffset = segment.length;
+    _partIsIndependent = nextIsIndependent;
+}
+
+- (double)frameInterval {
+    if (self.videoConfig.fps > 0) return 1.0 / self.videoConfig.fps;
+    if (self.audioConfig.sampleRate > 0) return 1024.0 / self.audioConfig.sampleRate;
+    return 0;
+}
+
+#pragma mark - Playlist
+- (void)writePlaylist {
+    BOOL isLowLatency = self.partTargetDuration > 0;
+    NSInteger targetDuration = (NSInteger)ceil(MAX(self.targetDuration, _maxSegmentDuration));
+    NSMutableString *m3u8 = [NSMutableString stringWithString:@"#EXTM3U\n"];
+    [m3u8 appendFormat:@"#EXT-X-VERSION:%d\n", isLowLatency ? 6 : 3];
+    [m3u8 appendFormat:@"#EXT-X-TARGETDURATION:%ld\n", (long)targetDuration];
+    if (self.playlistWindow == 0) {
+        [m3u8 appendString:@"#EXT-X-PLAYLIST-TYPE:EVENT\n"];
+    }
+    NSUInteger firstIndex = self.segments.firstObject ? self.segments.firstObject.index : self.currentSegment.index;
+    [m3u8 appendFormat:@"#EXT-X-MEDIA-SEQUENCE:%lu\n", (unsigned long)firstIndex];
+    if (self.videoConfig) {
+        [m3u8 appendString:@"#EXT-X-INDEPENDENT-SEGMENTS\n"];
+    }
+    if (isLowLatency) {
+        [m3u8 appendFormat:@"#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%.3f\n", self.partTargetDuration * 3];
+        [m3u8 appendFormat:@"#EXT-X-PART-INF:PART-TARGET=%.3f\n", self.partTargetDuration];
+    }
+
+    NSUInteger count = self.segments.count;
+    for (NSUInteger i = 0; i < count; i++) {
+        CQHLSSegment *segment = self.segments[i];
+        // 只有最近的几个切片需要列出部分切片
+        if (isLowLatency && !_isFinished && i + kPartListSegmentCount >= count) {
+            [self appendParts:segment toPlaylist:m3u8];
+        }
+        [m3u8 appendFormat:@"#EXTINF:%.3f,\n%@\n", segment.duration, segment.name];
+    }
+    if (isLowLatency && !_isFinished && self.currentSegment) {
+        [self appendParts:self.currentSegment toPlaylist:m3u8];
+        [m3u8 appendFormat:@"#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%@\",BYTERANGE-START=%llu\n", self.currentSegment.name, _partStartOffset];
+    }
+    if (_isFinished) {
+        [m3u8 appendString:@"#EXT-X-ENDLIST\n"];
+    }
+
+    NSData *data = [m3u8 dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *path = self.playlistPath;
+    dispatch_async(self.writeQueue, ^{
+        // 先写临时文件再替换，客户端不会读到写了一半的列表
+        NSError *error = nil;
+        if (![data writeToFile:path options:NSDataWritingAtomic error:&error]) {
+            [self reportError:error];
+            return;
+        }
+        if (self.delegate && [self.delegate respondsToSelector:@selector(hlsSegmenter:didUpdatePlaylistAtPath:)]) {
+            [self.delegate hlsSegmenter:self didUpdatePlaylistAtPath:path];
+        }
+    });
+}
+
+- (void)appendParts:(CQHLSSegment *)segment toPlaylist:(NSMutableString *)m3u8 {
+    for (CQHLSPart *part in segment.parts) {
+        [m3u8 appendFormat:@"#EXT-X-PART:DURATION=%.3f,URI=\"%@\",BYTERANGE=\"%llu@%llu\"%@\n", part.duration, segment.name, part.length, part.offset, part.isIndependent ? @",INDEPENDENT=YES" : @""];
+    }
+}
+
+#pragma mark - Write(写文件队列)
+/// 打开切片文件，优先使用提前创建好的文件，然后准备下一个
+- (void)openSegmentAtIndex:(NSUInteger)index path:(NSString *)path {
+    [self closeSegment];
+    if (_preparedFD >= 0 && _preparedIndex == index) {
+        _segmentFD = _preparedFD;
+        _preparedFD = -1;
+    } else {
+        [self discardPreparedFile];
+        _segmentFD = [self createFileAtPath:path];
+    }
+    if (_segmentFD < 0) {
+        [self reportError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+        return;
+    }
+    NSString *nextName = [NSString stringWithFormat:@"%@%lu.ts", self.segmentPrefix, (unsigned long)(index + 1)];
+    _preparedFD = [self createFileAtPath:[self.directory stringByAppendingPathComponent:nextName]];
+    _preparedIndex = index + 1;
+}
+
+/// 创建文件并按预估的切片大小预分配空间
+- (int)createFileAtPath:(NSString *)path {
+    int fd = open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+    NSInteger bitrate = self.videoConfig.bitrate + self.audioConfig.bitrate;
+    // TS封装大约有10%的开销，多预留一些
+    off_t size = (off_t)(bitrate / 8 * MAX(self.targetDuration, 1) * 1.2);
+    if (size > 0) {
+        // F_PREALLOCATE只分配磁盘空间，不改变文件长度，客户端读到的长度始终是已写入的长度
+        fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, size, 0};
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+            store.fst_flags = F_ALLOCATEALL;
+            fcntl(fd, F_PREALLOCATE, &store);
+        }
+    }
+    return fd;
+}
+
+- (void)writeData:(NSData *)data {
+    if (_segmentFD < 0) return;
+    const uint8_t *bytes = data.bytes;
+    size_t remain = data.length;
+    while (remain > 0) {
+        ssize_t written = write(_segmentFD, bytes, remain);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            [self reportError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+            return;
+        }
+        bytes += written;
+        remain -= written;
+    }
+}
+
+- (void)closeSegment {
+    if (_segmentFD < 0) return;
+    close(_segmentFD);
+    _segmentFD = -1;
+}
+
+/// 删除提前创建但没有用到的文件
+- (void)discardPreparedFile {
+    if (_preparedFD < 0) return;
+    close(_preparedFD);
+    _preparedFD = -1;
+    NSString *name = [NSString stringWithFormat:@"%@%lu.ts", self.segmentPrefix, (unsigned long)_preparedIndex];
+    unlink([self.directory stringByAppendingPathComponent:name].fileSystemRepresentation);
+}
+
+- (void)reportError:(NSError *)error {
+    NSLog(@"CQHLSSegmenter write failed error=%@", error);
+    if (self.delegate && [self.delegate respondsToSelector:@selector(hlsSegmenter:didFailWithError:)]) {
+        [self.delegate hlsSegmenter:self didFailWithError:error];
+    }
+}
+
+@end
@@ -0,0 +1,113 @@
+//
+//  CQMP4Demuxer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+FOUNDATION_EXPORT NSErrorDomain const CQMP4DemuxerErrorDomain;
+
+typedef NS_ENUM(NSUInteger, CQMP4TrackType) {
+    CQMP4TrackTypeOther = 0,  ///< 不支持的轨道
+    CQMP4TrackTypeVideo = 1,  ///< 视频(H264)
+    CQMP4TrackTypeAudio = 2,  ///< 音频(AAC)
+};
+
+/// 轨道信息
+@interface CQMP4Track : NSObject
+@property (nonatomic, assign, readonly) uint32_t trackID;  ///< 轨道ID
+@property (nonatomic, assign, readonly) CQMP4TrackType type;  ///< 轨道类型
+@property (nonatomic, assign, readonly) uint32_t codecType;  ///< 编码fourcc，例如'avc1' 'mp4a'
+@property (nonatomic, assign, readonly) uint32_t timescale;  ///< 时间刻度
+@property (nonatomic, assign, readonly) CMTime duration;  ///< 时长
+@property (nonatomic, assign, readonly) uint32_t sampleCount;  ///< sample个数
+
+@property (nonatomic, assign, readonly) NSInteger width;  ///< 视频宽
+@property (nonatomic, assign, readonly) NSInteger height;  ///< 视频高
+@property (nonatomic, strong, readonly, nullable) NSData *sps;  ///< sps，Annex-B格式，可以直接交给CQVideoDecoder
+@property (nonatomic, strong, readonly, nullable) NSData *pps;  ///< pps，Annex-B格式
+@property (nonatomic, assign, readonly) NSUInteger naluLengthSize;  ///< AVCC长度头字节数
+
+@property (nonatomic, assign, readonly) NSInteger sampleRate;  ///< 音频采样率
+@property (nonatomic, assign, readonly) NSInteger channelCount;  ///< 音频声道数
+@property (nonatomic, strong, readonly, nullable) NSData *audioSpecificConfig;  ///< AAC AudioSpecificConfig
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+@end
+
+/// 一个sample
+@interface CQMP4Sample : NSObject
+@property (nonatomic, strong, readonly) CQMP4Track *track;  ///< 所属轨道
+@property (nonatomic, assign, readonly) uint32_t index;  ///< 在轨道中的序号
+/**
+ sample数据，直接引用映射的文件内存，不拷贝
+ 视频为4字节长度头的AVCC格式，可以直接交给CQVideoDecoder的videoDecodeWithAVCCData:
+ (长度头不是4字节的少见文件会转换为4字节，此时会拷贝)
+ 音频为AAC裸数据，可以直接交给CQAudioDecoder
+ */
+@property (nonatomic, strong, readonly) NSData *data;
+@property (nonatomic, assign, readonly) uint64_t fileOffset;  ///< 在文件中的偏移
+@property (nonatomic, assign, readonly) CMTime pts;  ///< 显示时间戳
+@property (nonatomic, assign, readonly) CMTime dts;  ///< 解码时间戳
+@property (nonatomic, assign, readonly) CMTime duration;  ///< 时长
+@property (nonatomic, assign, readonly) BOOL isSync;  ///< 是否同步sample(关键帧)
+
+- (instancetype)init NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+@end
+
+/**
+ MP4解封装器
+ @discussion mmap映射整个文件，打开时只解析moov的box结构，stts/ctts/stsc/stsz/stco/stss等sample表
+ 不展开成数组，而是每个轨道维护一个游标直接在映射内存上顺序读取，内存占用与文件大小和sample个数无关
+ sample数据直接引用映射内存，已经读过的区域会定期通知系统回收页面，适合GB级别的文件
+ 目前支持H264(avc1/avc3)和AAC(mp4a)，不处理编辑列表(elst)和分片MP4(moof)
+ 非线程安全，同一个解封装器应在同一个队列使用
+ */
+@interface CQMP4Demuxer : NSObject
+
+/**
+ 唯一初始化函数
+ @param path 文件路径
+ @param error 错误信息
+ */
+- (nullable instancetype)initWithPath:(NSString *)path error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *path;  ///< 文件路径
+@property (nonatomic, assign, readonly) uint64_t fileSize;  ///< 文件大小
+@property (nonatomic, assign, readonly) CMTime duration;  ///< 文件时长
+@property (nonatomic, copy, readonly) NSArray<CQMP4Track *> *tracks;  ///< 所有轨道
+@property (nonatomic, strong, readonly, nullable) CQMP4Track *videoTrack;  ///< 第一个视频轨道
+@property (nonatomic, strong, readonly, nullable) CQMP4Track *audioTrack;  ///< 第一个音频轨道
+
+/**
+ 读取某个轨道的下一个sample
+ @return 轨道读完返回nil
+ */
+- (nullable CQMP4Sample *)nextSampleForTrack:(CQMP4Track *)track;
+
+/**
+ 按dts交织读取所有支持轨道的下一个sample，用于播放
+ @return 全部读完返回nil
+ */
+- (nullable CQMP4Sample *)nextSample;
+
+/**
+ 跳转，所有轨道定位到time之前(含)最近的同步sample
+ @param time 目标时间
+ @return sample表(stsc/stco)不一致时返回NO，定位失败的轨道不再输出sample
+ */
+- (BOOL)seekToTime:(CMTime)time;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,747 @@
+//
+//  CQMP4Demuxer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 mmap映射整个文件，顺序扫描顶层box找到moov(不读取mdat)
+ 2 解析moov下每个trak的tkhd/mdhd/hdlr/stsd，sample表只记录在映射内存中的位置
+ 3 每个轨道一个游标，读sample时同步推进stts(dts)、ctts(pts偏移)、stsc+stco(所在chunk和偏移)、stsz(大小)、stss(同步)
+ 4 sample数据用NSData直接引用映射内存，NSData持有映射对象，保证映射在数据释放前有效
+ 5 所有轨道的游标都越过的区域，调用madvise通知系统回收页面，常驻内存不随文件增长
+ */
+
+#import "CQMP4Demuxer.h"
+#import "CQADTSUtil.h"
+#import "CQMappedFile.h"
+
+NSErrorDomain const CQMP4DemuxerErrorDomain = @"CQMP4DemuxerErrorDomain";
+
+static const uint64_t kReleaseThreshold = 16 * 1024 * 1024;  ///< 游标越过多少字节后回收一次页面
+
+#pragma mark - Read Util
+static inline uint16_t CQMP4ReadU16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t CQMP4ReadU32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t CQMP4ReadU64(const uint8_t *p) {
+    return ((uint64_t)CQMP4ReadU32(p) << 32) | CQMP4ReadU32(p + 4);
+}
+
+/// box
+typedef struct {
+    uint32_t type;
+    const uint8_t *payload;  ///< 去掉box头的内容
+    uint64_t size;  ///< 内容大小
+} CQMP4Box;
+
+/// 从cursor处读取一个box并移动cursor，越界返回NO
+static BOOL CQMP4NextBox(const uint8_t **cursor, const uint8_t *end, CQMP4Box *box) {
+    const uint8_t *p = *cursor;
+    if (end - p < 8) return NO;
+    uint64_t size = CQMP4ReadU32(p);
+    uint32_t headerSize = 8;
+    if (size == 1) {
+        if (end - p < 16) return NO;
+        size = CQMP4ReadU64(p + 8);
+        headerSize = 16;
+    } else if (size == 0) {
+        // 延伸到文件末尾
+        size = (uint64_t)(end - p);
+    }
+    if (size < headerSize || size > (uint64_t)(end - p)) return NO;
+    box->type = CQMP4ReadU32(p + 4);
+    box->payload = p + headerSize;
+    box->size = size - headerSize;
+    *cursor = p + size;
+    return YES;
+}
+
+/// 在一段内容中查找第一个指定类型的子box
+static BOOL CQMP4FindBox(const uint8_t *data, uint64_t size, uint32_t type, CQMP4Box *box) {
+    const uint8_t *cursor = data;
+    const uint8_t *end = data + size;
+    while (CQMP4NextBox(&cursor, end, box)) {
+        if (box->type == type) return YES;
+    }
+    return NO;
+}
+
+/// 读取MPEG-4描述符的可变长度
+static BOOL CQMP4ReadDescriptorLength(const uint8_t **cursor, const uint8_t *end, uint32_t *length) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        if (*cursor >= end) return NO;
+        uint8_t byte = *(*cursor)++;
+        value = (value << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) break;
+    }
+    *length = value;
+    return YES;
+}
+
+#pragma mark - Sample Table
+/// sample表，指向映射内存
+typedef struct {
+    const uint8_t *stts;  ///< (sample_count, sample_delta)
+    uint32_t sttsCount;
+    const uint8_t *ctts;  ///< (sample_count, sample_offset)
+    uint32_t cttsCount;
+    const uint8_t *stsc;  ///< (first_chunk, samples_per_chunk, sample_description_index)
+    uint32_t stscCount;
+    const uint8_t *stsz;  ///< 每个sample大小，fixedSampleSize不为0时为空
+    uint32_t fixedSampleSize;
+    uint32_t stszFieldSize;  ///< stz2的字段位数，stsz为32
+    uint32_t sampleCount;
+    const uint8_t *chunkOffsets;  ///< stco/co64
+    uint32_t chunkCount;
+    BOOL isChunkOffset64;
+    const uint8_t *stss;  ///< 同步sample序号(从1开始)，为空时所有sample都是同步sample
+    uint32_t stssCount;
+} CQMP4SampleTable;
+
+/// 轨道读取游标
+typedef struct {
+    uint32_t sample;  ///< 下一个sample序号
+    uint32_t sttsIndex;
+    uint32_t sttsRemain;  ///< 当前stts条目剩余sample数
+    int64_t dts;
+    uint32_t cttsIndex;
+    uint32_t cttsRemain;
+    uint32_t stscIndex;
+    uint32_t chunk;  ///< 当前chunk序号(从0开始)
+    uint32_t chunkRemain;  ///< 当前chunk剩余sample数
+    uint64_t offset;  ///< 下一个sample的文件偏移
+    uint32_t stssIndex;
+} CQMP4Cursor;
+
+/// 读出的sample信息
+typedef struct {
+    uint32_t index;
+    uint64_t offset;
+    uint32_t size;
+    int64_t dts;
+    int64_t pts;
+    uint32_t duration;
+    BOOL isSync;
+} CQMP4SampleInfo;
+
+static inline uint32_t CQMP4SampleSize(const CQMP4SampleTable *table, uint32_t index) {
+    if (table->fixedSampleSize) return table->fixedSampleSize;
+    switch (table->stszFieldSize) {
+        case 4: {
+            uint8_t byte = table->stsz[index / 2];
+            return (index & 1) ? (byte & 0x0F) : (byte >> 4);
+        }
+        case 8: return table->stsz[index];
+        case 16: return CQMP4ReadU16(table->stsz + index * 2);
+        default: return CQMP4ReadU32(table->stsz + index * 4);
+    }
+}
+
+static inline uint64_t CQMP4ChunkOffset(const CQMP4SampleTable *table, uint32_t chunk) {
+    return table->isChunkOffset64 ? CQMP4ReadU64(table->chunkOffsets + chunk * 8) : CQMP4ReadU32(table->chunkOffsets + chunk * 4);
+}
+
+/**
+ 游标定位到第index个sample，只在打开和跳转时调用
+ @return stsc和stco不一致(stsc引用了不存在的chunk、没有覆盖到index)时返回NO，游标停在轨道末尾不再输出sample
+ */
+static BOOL CQMP4CursorSeek(const CQMP4SampleTable *table, CQMP4Cursor *cursor, uint32_t index) {
+    memset(cursor, 0, sizeof(CQMP4Cursor));
+    cursor->sample = index;
+
+    // stts
+    uint32_t remaining = index;
+    for (uint32_t i = 0; i < table->sttsCount; i++) {
+        uint32_t count = CQMP4ReadU32(table->stts + i * 8);
+        uint32_t delta = CQMP4ReadU32(table->stts + i * 8 + 4);
+        cursor->sttsIndex = i;
+        if (remaining < count) {
+            cursor->sttsRemain = count - remaining;
+            cursor->dts += (int64_t)remaining * delta;
+            break;
+        }
+        remaining -= count;
+        cursor->dts += (int64_t)count * delta;
+    }
+
+    // ctts
+    remaining = index;
+    for (uint32_t i = 0; i < table->cttsCount; i++) {
+        uint32_t count = CQMP4ReadU32(table->ctts + i * 8);
+        cursor->cttsIndex = i;
+        if (remaining < count) {
+            cursor->cttsRemain = count - remaining;
+            break;
+        }
+        remaining -= count;
+    }
+
+    // stsc，找到sample所在的chunk和在chunk中的位置
+    // first_chunk从1开始，下一个条目的first_chunk截断到chunkCount+1，损坏的文件不会算出stco之外的chunk
+    uint64_t firstSample = 0;
+    for (uint32_t i = 0; i < table->stscCount; i++) {
+        uint32_t firstChunk = CQMP4ReadU32(table->stsc + i * 12);
+        uint32_t nextFirstChunk = i + 1 < table->stscCount ? CQMP4ReadU32(table->stsc + (i + 1) * 12) : table->chunkCount + 1;
+        nextFirstChunk = MIN(nextFirstChunk, table->chunkCount + 1);
+        uint32_t samplesPerChunk = CQMP4ReadU32(table->stsc + i * 12 + 4);
+        if (firstChunk == 0 || firstChunk > table->chunkCount) break;
+        if (samplesPerChunk == 0 || nextFirstChunk < firstChunk) continue;
+        uint64_t runSamples = (uint64_t)(nextFirstChunk - firstChunk) * samplesPerChunk;
+        if (index < firstSample + runSamples) {
+            uint32_t indexInRun = (uint32_t)(index - firstSample);
+            uint32_t indexInChunk = indexInRun % samplesPerChunk;
+            cursor->stscIndex = i;
+            cursor->chunk = firstChunk - 1 + indexInRun / samplesPerChunk;
+            cursor->chunkRemain = samplesPerChunk - indexInChunk;
+            cursor->offset = CQMP4ChunkOffset(table, cursor->chunk);
+            for (uint32_t s = index - indexInChunk; s < index; s++) {
+                cursor->offset += CQMP4SampleSize(table, s);
+            }
+            break;
+        }
+        firstSample += runSamples;
+    }
+    if (cursor->chunkRemain == 0) {
+        if (index < table->sampleCount) {
+            // sample在stsc/stco覆盖的范围之外，表不一致
+            cursor->sample = table->sampleCount;
+            return NO;
+        }
+        // 没有sample或者已经在末尾，读取时从第0个chunk开始
+        cursor->chunk = UINT32_MAX;
+    }
+
+    // stss，第一个不小于index+1的条目
+    uint32_t low = 0, high = table->stssCount;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        if (CQMP4ReadU32(table->stss + mid * 4) < index + 1) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    cursor->stssIndex = low;
+    return YES;
+}
+
+/// 读取游标处的sample信息并推进游标
+static BOOL CQMP4CursorRead(const CQMP4SampleTable *table, CQMP4Cursor *cursor, CQMP4SampleInfo *info) {
+    if (cursor->sample >= table->sampleCount) return NO;
+
+    // 进入下一个chunk
+    while (cursor->chunkRemain == 0) {
+        cursor->chunk = cursor->chunk == UINT32_MAX ? 0 : cursor->chunk + 1;
+        if (cursor->chunk >= table->chunkCount) return NO;
+        while (cursor->stscIndex + 1 < table->stscCount && CQMP4ReadU32(table->stsc + (cursor->stscIndex + 1) * 12) - 1 <= cursor->chunk) {
+            cursor->stscIndex++;
+        }
+        if (table->stscCount == 0) return NO;
+        cursor->chunkRemain = CQMP4ReadU32(table->stsc + cursor->stscIndex * 12 + 4);
+        cursor->offset = CQMP4ChunkOffset(table, cursor->chunk);
+    }
+
+    info->index = cursor->sample;
+    info->offset = cursor->offset;
+    info->size = CQMP4SampleSize(table, cursor->sample);
+    cursor->offset += info->size;
+    cursor->chunkRemain--;
+
+    // dts
+    while (cursor->sttsRemain == 0 && cursor->sttsIndex + 1 < table->sttsCount) {
+        cursor->sttsIndex++;
+        cursor->sttsRemain = CQMP4ReadU32(table->stts + cursor->sttsIndex * 8);
+    }
+    info->duration = table->sttsCount ? CQMP4ReadU32(table->stts + cursor->sttsIndex * 8 + 4) : 0;
+    info->dts = cursor->dts;
+    cursor->dts += info->duration;
+    if (cursor->sttsRemain) cursor->sttsRemain--;
+
+    // pts，version 1的ctts偏移是有符号数，version 0的实际文件里也常按有符号写，统一按有符号处理
+    int32_t compositionOffset = 0;
+    while (cursor->cttsRemain == 0 && cursor->cttsIndex + 1 < table->cttsCount) {
+        cursor->cttsIndex++;
+        cursor->cttsRemain = CQMP4ReadU32(table->ctts + cursor->cttsIndex * 8);
+    }
+    if (table->cttsCount) {
+        compositionOffset = (int32_t)CQMP4ReadU32(table->ctts + cursor->cttsIndex * 8 + 4);
+        if (cursor->cttsRemain) cursor->cttsRemain--;
+    }
+    info->pts = info->dts + compositionOffset;
+
+    // 同步sample
+    if (table->stss) {
+        while (cursor->stssIndex < table->stssCount && CQMP4ReadU32(table->stss + cursor->stssIndex * 4) < cursor->sample + 1) {
+            cursor->stssIndex++;
+        }
+        info->isSync = cursor->stssIndex < table->stssCount && CQMP4ReadU32(table->stss + cursor->stssIndex * 4) == cursor->sample + 1;
+    } else {
+        info->isSync = YES;
+    }
+
+    cursor->sample++;
+    return YES;
+}
+
+#pragma mark - CQMP4Track
+@interface CQMP4Track ()
+{
+    @package
+    CQMP4SampleTable _table;
+    CQMP4Cursor _cursor;
+}
+@property (nonatomic, assign, readwrite) uint32_t trackID;
+@property (nonatomic, assign, readwrite) CQMP4TrackType type;
+@property (nonatomic, assign, readwrite) uint32_t codecType;
+@property (nonatomic, assign, readwrite) uint32_t timescale;
+@property (nonatomic, assign, readwrite) CMTime duration;
+@property (nonatomic, assign, readwrite) uint32_t sampleCount;
+@property (nonatomic, assign, readwrite) NSInteger width;
+@property (nonatomic, assign, readwrite) NSInteger height;
+@property (nonatomic, strong, readwrite, nullable) NSData *sps;
+@property (nonatomic, strong, readwrite, nullable) NSData *pps;
+@property (nonatomic, assign, readwrite) NSUInteger naluLengthSize;
+@property (nonatomic, assign, readwrite) NSInteger sampleRate;
+@property (nonatomic, assign, readwrite) NSInteger channelCount;
+@property (nonatomic, strong, readwrite, nullable) NSData *audioSpecificConfig;
+@property (nonatomic, strong, nullable) CQMP4Sample *pendingSample;  ///< nextSample交织时预读的sample
+@end
+
+@implementation CQMP4Track
+
+- (instancetype)initInternal {
+    return [super init];
+}
+
+@end
+
+#pragma mark - CQMP4Sample
+@interface CQMP4Sample ()
+@property (nonatomic, strong, readwrite) CQMP4Track *track;
+@property (nonatomic, assign, readwrite) uint32_t index;
+@property (nonatomic, strong, readwrite) NSData *data;
+@property (nonatomic, assign, readwrite) uint64_t fileOffset;
+@property (nonatomic, assign, readwrite) CMTime pts;
+@property (nonatomic, assign, readwrite) CMTime dts;
+@property (nonatomic, assign, readwrite) CMTime duration;
+@property (nonatomic, assign, readwrite) BOOL isSync;
+@end
+
+@implementation CQMP4Sample
+
+- (instancetype)initInternal {
+    return [super init];
+}
+
+@end
+
+#pragma mark - CQMP4Demuxer
+@interface CQMP4Demuxer ()
+@property (nonatomic, strong) CQMappedFile *mappedFile;  ///< 映射的文件
+@property (nonatomic, copy, readwrite) NSArray<CQMP4Track *> *tracks;
+@property (nonatomic, strong, readwrite, nullable) CQMP4Track *videoTrack;
+@property (nonatomic, strong, readwrite, nullable) CQMP4Track *audioTrack;
+@end
+
+@implementation CQMP4Demuxer
+{
+    uint64_t _releasedOffset;  ///< 该偏移之前的页面已经回收
+}
+
+#pragma mark - Init
+- (instancetype)initWithPath:(NSString *)path error:(NSError **)error {
+    if (self = [super init]) {
+        _path = [path copy];
+        _mappedFile = [[CQMappedFile alloc] initWithPath:path error:error];
+        if (!_mappedFile) return nil;
+        _fileSize = _mappedFile.size;
+
+        if (![self parseFileWithError:error]) return nil;
+        // moov解析完后基本是顺序读取，让系统积极预读
+        [_mappedFile adviseSequential];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // 预读的sample和轨道互相持有，这里断开
+    for (CQMP4Track *track in _tracks) {
+        track.pendingSample = nil;
+    }
+    NSLog(@"CQMP4Demuxer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (CQMP4Sample *)nextSampleForTrack:(CQMP4Track *)track {
+    if (track.pendingSample) {
+        CQMP4Sample *sample = track.pendingSample;
+        track.pendingSample = nil;
+        return sample;
+    }
+    return [self readSampleForTrack:track];
+}
+
+- (CQMP4Sample *)nextSample {
+    CQMP4Sample *earliest = nil;
+    for (CQMP4Track *track in self.tracks) {
+        if (track.type == CQMP4TrackTypeOther) continue;
+        if (!track.pendingSample) {
+            track.pendingSample = [self readSampleForTrack:track];
+        }
+        CQMP4Sample *sample = track.pendingSample;
+        if (sample && (!earliest || CMTimeCompare(sample.dts, earliest.dts) < 0)) {
+            earliest = sample;
+        }
+    }
+    earliest.track.pendingSample = nil;
+    return earliest;
+}
+
+- (BOOL)seekToTime:(CMTime)time {
+    // 先定位视频到关键帧，其它轨道对齐到该关键帧的时间，保证音视频同时开始
+    BOOL isSuccess = YES;
+    CMTime alignedTime = time;
+    if (self.videoTrack) {
+        isSuccess = [self seekTrack:self.videoTrack toTime:time syncTime:&alignedTime];
+    }
+    for (CQMP4Track *track in self.tracks) {
+        if (track == self.videoTrack || track.type == CQMP4TrackTypeOther) continue;
+        isSuccess = [self seekTrack:track toTime:alignedTime syncTime:NULL] && isSuccess;
+    }
+    _releasedOffset = 0;
+    return isSuccess;
+}
+
+#pragma mark - Private Func
+/// 读取轨道游标处的sample
+- (CQMP4Sample *)readSampleForTrack:(CQMP4Track *)track {
+    CQMP4SampleInfo info;
+    if (!CQMP4CursorRead(&track->_table, &track->_cursor, &info)) return nil;
+    if (info.offset + info.size > self.fileSize) return nil;
+
+    NSData *data = nil;
+    if (track.type == CQMP4TrackTypeVideo && track.naluLengthSize != 4) {
+        data = [self convertAVCCData:self.mappedFile.bytes + info.offset size:info.size lengthSize:track.naluLengthSize];
+    } else {
+        // NSData持有映射对象，sample在外面用完之前映射不会解除
+        data = [self.mappedFile dataWithOffset:info.offset length:info.size];
+    }
+
+    CQMP4Sample *sample = [[CQMP4Sample alloc] initInternal];
+    sample.track = track;
+    sample.index = info.index;
+    sample.data = data;
+    sample.fileOffset = info.offset;
+    sample.dts = CMTimeMake(info.dts, track.timescale);
+    sample.pts = CMTimeMake(info.pts, track.timescale);
+    sample.duration = CMTimeMake(info.duration, track.timescale);
+    sample.isSync = info.isSync;
+    [self releaseConsumedPages];
+    return sample;
+}
+
+/// 长度头不是4字节的AVCC数据转换为4字节长度头
+- (NSData *)convertAVCCData:(const uint8_t *)bytes size:(uint32_t)size lengthSize:(NSUInteger)lengthSize {
+    NSMutableData *data = [NSMutableData dataWithCapacity:size + size / 8];
+    size_t offset = 0;
+    while (offset + lengthSize <= size) {
+        uint32_t naluSize = 0;
+        for (NSUInteger i = 0; i < lengthSize; i++) {
+            naluSize = (naluSize << 8) | bytes[offset + i];
+        }
+        offset += lengthSize;
+        if (naluSize == 0 || offset + naluSize > size) break;
+        uint8_t header[4] = {naluSize >> 24, naluSize >> 16, naluSize >> 8, naluSize};
+        [data appendBytes:header length:4];
+        [data appendBytes:bytes + offset length:naluSize];
+        offset += naluSize;
+    }
+    return data;
+}
+
+/**
+ 定位轨道到time之前最近的同步sample
+ @param syncTime 返回该sample的dts
+ @return sample表不一致时返回NO
+ */
+- (BOOL)seekTrack:(CQMP4Track *)track toTime:(CMTime)time syncTime:(CMTime *)syncTime {
+    const CQMP4SampleTable *table = &track->_table;
+    int64_t target = CMTimeConvertScale(time, track.timescale, kCMTimeRoundingMethod_RoundTowardNegativeInfinity).value;
+
+    // 找到dts不大于target的最后一个sample
+    uint32_t index = 0;
+    int64_t dts = 0;
+    for (uint32_t i = 0; i < table->sttsCount; i++) {
+        uint32_t count = CQMP4ReadU32(table->stts + i * 8);
+        uint32_t delta = CQMP4ReadU32(table->stts + i * 8 + 4);
+        if (delta > 0 && dts + (int64_t)count * delta > target) {
+            uint32_t step = target > dts ? (uint32_t)((target - dts) / delta) : 0;
+            index += step;
+            break;
+        }
+        index += count;
+        dts += (int64_t)count * delta;
+    }
+    if (index >= table->sampleCount) index = table->sampleCount ? table->sampleCount - 1 : 0;
+
+    // 向前找同步sample
+    if (table->stss && table->stssCount) {
+        uint32_t low = 0, high = table->stssCount;
+        while (low < high) {
+            uint32_t mid = (low + high) / 2;
+            if (CQMP4ReadU32(table->stss + mid * 4) <= index + 1) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        index = low > 0 ? CQMP4ReadU32(table->stss + (low - 1) * 4) - 1 : CQMP4ReadU32(table->stss) - 1;
+    }
+    BOOL isSuccess = CQMP4CursorSeek(table, &track->_cursor, index);
+    track.pendingSample = nil;
+    if (syncTime) *syncTime = isSuccess ? CMTimeMake(track->_cursor.dts, track.timescale) : time;
+    return isSuccess;
+}
+
+/// 所有轨道都已经读过的区域通知系统回收
+- (void)releaseConsumedPages {
+    uint64_t lowest = UINT64_MAX;
+    for (CQMP4Track *track in self.tracks) {
+        if (track.type == CQMP4TrackTypeOther || track->_cursor.sample >= track->_table.sampleCount) continue;
+        uint64_t offset = track.pendingSample ? track.pendingSample.fileOffset : track->_cursor.offset;
+        lowest = MIN(lowest, offset);
+    }
+    if (lowest == UINT64_MAX) lowest = self.fileSize;
+    if (lowest < _releasedOffset + kReleaseThreshold) return;
+
+    // 已经交出去的sample数据再访问时会从文件重新读入
+    [self.mappedFile releasePagesFromOffset:_releasedOffset toOffset:lowest];
+    _releasedOffset = lowest;
+}
+
+#pragma mark - Parse
+- (BOOL)parseFileWithError:(NSError **)error {
+    const uint8_t *bytes = self.mappedFile.bytes;
+    const uint8_t *cursor = bytes;
+    const uint8_t *end = bytes + self.fileSize;
+    CQMP4Box box;
+    BOOL hasMoov = NO;
+    // 顶层box只读box头，mdat再大也不会被读入
+    while (CQMP4NextBox(&cursor, end, &box)) {
+        if (box.type == 'moov') {
+            hasMoov = YES;
+            [self parseMoov:&box];
+            break;
+        }
+    }
+    if (!hasMoov) {
+        if (error) *error = [NSError errorWithDomain:CQMP4DemuxerErrorDomain code:-1 userInfo:@{NSLocalizedDescriptionKey: @"moov not found"}];
+        return NO;
+    }
+    if (!self.videoTrack && !self.audioTrack) {
+        if (error) *error = [NSError errorWithDomain:CQMP4DemuxerErrorDomain code:-2 userInfo:@{NSLocalizedDescriptionKey: @"no supported track"}];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)parseMoov:(const CQMP4Box *)moov {
+    CQMP4Box box;
+    if (CQMP4FindBox(moov->payload, moov->size, 'mvhd', &box) && box.size >= 32) {
+        BOOL isVersion1 = box.payload[0] == 1;
+        uint32_t timescale = CQMP4ReadU32(box.payload + (isVersion1 ? 20 : 12));
+        uint64_t duration = isVersion1 ? CQMP4ReadU64(box.payload + 24) : CQMP4ReadU32(box.payload + 16);
+        if (timescale) _duration = CMTimeMake((int64_t)duration, timescale);
+    }
+
+    NSMutableArray<CQMP4Track *> *tracks = [NSMutableArray array];
+    const uint8_t *cursor = moov->payload;
+    const uint8_t *end = moov->payload + moov->size;
+    while (CQMP4NextBox(&cursor, end, &box)) {
+        if (box.type != 'trak') continue;
+        CQMP4Track *track = [self parseTrak:&box];
+        if (!track) continue;
+        [tracks addObject:track];
+        if (track.type == CQMP4TrackTypeVideo && !self.videoTrack) self.videoTrack = track;
+        if (track.type == CQMP4TrackTypeAudio && !self.audioTrack) self.audioTrack = track;
+    }
+    self.tracks = tracks;
+}
+
+- (CQMP4Track *)parseTrak:(const CQMP4Box *)trak {
+    CQMP4Box tkhd, mdia, mdhd, hdlr, minf, stbl;
+    if (!CQMP4FindBox(trak->payload, trak->size, 'mdia', &mdia)) return nil;
+    if (!CQMP4FindBox(mdia.payload, mdia.size, 'mdhd', &mdhd) || mdhd.size < 24) return nil;
+    if (!CQMP4FindBox(mdia.payload, mdia.size, 'hdlr', &hdlr) || hdlr.size < 12) return nil;
+    if (!CQMP4FindBox(mdia.payload, mdia.size, 'minf', &minf)) return nil;
+    if (!CQMP4FindBox(minf.payload, minf.size, 'stbl', &stbl)) return nil;
+
+    CQMP4Track *track = [[CQMP4Track alloc] initInternal];
+    if (CQMP4FindBox(trak->payload, trak->size, 'tkhd', &tkhd) && tkhd.size >= 24) {
+        track.trackID = CQMP4ReadU32(tkhd.payload + (tkhd.payload[0] == 1 ? 20 : 12));
+    }
+    BOOL isVersion1 = mdhd.payload[0] == 1;
+    if (isVersion1 && mdhd.size < 32) return nil;
+    track.timescale = CQMP4ReadU32(mdhd.payload + (isVersion1 ? 20 : 12));
+    uint64_t duration = isVersion1 ? CQMP4ReadU64(mdhd.payload + 24) : CQMP4ReadU32(mdhd.payload + 16);
+    if (track.timescale == 0) return nil;
+    track.duration = CMTimeMake((int64_t)duration, track.timescale);
+
+    if (![self parseSampleTable:&stbl track:track]) return nil;
+    uint32_t handlerType = CQMP4ReadU32(hdlr.payload + 8);
+    CQMP4Box stsd;
+    if (CQMP4FindBox(stbl.payload, stbl.size, 'stsd', &stsd) && stsd.size > 8) {
+        const uint8_t *entryCursor = stsd.payload + 8;
+        CQMP4Box entry;
+        if (CQMP4NextBox(&entryCursor, stsd.payload + stsd.size, &entry)) {
+            track.codecType = entry.type;
+            if (handlerType == 'vide') {
+                [self parseVisualSampleEntry:&entry track:track];
+            } else if (handlerType == 'soun') {
+                [self parseAudioSampleEntry:&entry track:track];
+            }
+        }
+    }
+    if (!CQMP4CursorSeek(&track->_table, &track->_cursor, 0)) return nil;
+    return track;
+}
+
+- (BOOL)parseSampleTable:(const CQMP4Box *)stbl track:(CQMP4Track *)track {
+    CQMP4SampleTable *table = &track->_table;
+    CQMP4Box box;
+    // 每个表的条目数都按box实际大小截断，防止损坏的文件越界读
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'stts', &box) && box.size >= 8) {
+        table->stts = box.payload + 8;
+        table->sttsCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 8);
+    }
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'ctts', &box) && box.size >= 8) {
+        table->ctts = box.payload + 8;
+        table->cttsCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 8);
+    }
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'stsc', &box) && box.size >= 8) {
+        table->stsc = box.payload + 8;
+        table->stscCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 12);
+    }
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'stss', &box) && box.size >= 8) {
+        table->stss = box.payload + 8;
+        table->stssCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 4);
+    }
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'stsz', &box) && box.size >= 12) {
+        table->fixedSampleSize = CQMP4ReadU32(box.payload + 4);
+        table->sampleCount = CQMP4ReadU32(box.payload + 8);
+        table->stszFieldSize = 32;
+        if (!table->fixedSampleSize) {
+            table->stsz = box.payload + 12;
+            table->sampleCount = (uint32_t)MIN((uint64_t)table->sampleCount, (box.size - 12) / 4);
+        }
+    } else if (CQMP4FindBox(stbl->payload, stbl->size, 'stz2', &box) && box.size >= 12) {
+        table->stszFieldSize = box.payload[7];
+        if (table->stszFieldSize != 4 && table->stszFieldSize != 8 && table->stszFieldSize != 16) return NO;
+        table->stsz = box.payload + 12;
+        table->sampleCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 8), (box.size - 12) * 8 / table->stszFieldSize);
+    } else {
+        return NO;
+    }
+    if (CQMP4FindBox(stbl->payload, stbl->size, 'stco', &box) && box.size >= 8) {
+        table->chunkOffsets = box.payload + 8;
+        table->chunkCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 4);
+    } else if (CQMP4FindBox(stbl->payload, stbl->size, 'co64', &box) && box.size >= 8) {
+        table->chunkOffsets = box.payload + 8;
+        table->chunkCount = (uint32_t)MIN((uint64_t)CQMP4ReadU32(box.payload + 4), (box.size - 8) / 8);
+        table->isChunkOffset64 = YES;
+    } else {
+        return NO;
+    }
+    track.sampleCount = table->sampleCount;
+    return table->stscCount > 0 && table->chunkCount > 0;
+}
+
+- (void)parseVisualSampleEntry:(const CQMP4Box *)entry track:(CQMP4Track *)track {
+    // VisualSampleEntry固定部分78字节，之后是子box
+    if (entry->size < 78) return;
+    track.width = CQMP4ReadU16(entry->payload + 24);
+    track.height = CQMP4ReadU16(entry->payload + 26);
+    if (entry->type != 'avc1' && entry->type != 'avc3') return;
+    CQMP4Box avcC;
+    if (!CQMP4FindBox(entry->payload + 78, entry->size - 78, 'avcC', &avcC) || avcC.size < 7) return;
+
+    static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+    const uint8_t *p = avcC.payload;
+    const uint8_t *end = avcC.payload + avcC.size;
+    track.naluLengthSize = (p[4] & 0x03) + 1;
+    // 只取第一个sps和pps，转为Annex-B格式
+    uint8_t spsCount = p[5] & 0x1F;
+    p += 6;
+    for (uint8_t i = 0; i < spsCount && p + 2 <= end; i++) {
+        uint16_t size = CQMP4ReadU16(p);
+        if (p + 2 + size > end) return;
+        if (!track.sps) {
+            NSMutableData *sps = [NSMutableData dataWithBytes:startCode length:4];
+            [sps appendBytes:p + 2 length:size];
+            track.sps = sps;
+        }
+        p += 2 + size;
+    }
+    if (p >= end) return;
+    uint8_t ppsCount = *p++;
+    for (uint8_t i = 0; i < ppsCount && p + 2 <= end; i++) {
+        uint16_t size = CQMP4ReadU16(p);
+        if (p + 2 + size > end) return;
+        if (!track.pps) {
+            NSMutableData *pps = [NSMutableData dataWithBytes:startCode length:4];
+            [pps appendBytes:p + 2 length:size];
+            track.pps = pps;
+        }
+        p += 2 + size;
+    }
+    if (track.sps && track.pps) track.type = CQMP4TrackTypeVideo;
+}
+
+- (void)parseAudioSampleEntry:(const CQMP4Box *)entry track:(CQMP4Track *)track {
+    // AudioSampleEntry固定部分28字节，QuickTime的version 1/2会更长
+    if (entry->size < 28) return;
+    uint16_t version = CQMP4ReadU16(entry->payload + 8);
+    track.channelCount = CQMP4ReadU16(entry->payload + 16);
+    track.sampleRate = CQMP4ReadU32(entry->payload + 24) >> 16;
+    if (entry->type != 'mp4a') return;
+    uint64_t childOffset = 28 + (version == 1 ? 16 : (version == 2 ? 36 : 0));
+    if (entry->size <= childOffset) return;
+    CQMP4Box esds;
+    if (!CQMP4FindBox(entry->payload + childOffset, entry->size - childOffset, 'esds', &esds) || esds.size < 4) return;
+
+    // ES_Descriptor(0x03) -> DecoderConfigDescriptor(0x04) -> DecoderSpecificInfo(0x05)
+    const uint8_t *p = esds.payload + 4;
+    const uint8_t *end = esds.payload + esds.size;
+    uint32_t length = 0;
+    if (p >= end || *p++ != 0x03 || !CQMP4ReadDescriptorLength(&p, end, &length) || p + 3 > end) return;
+    uint8_t flags = p[2];
+    p += 3;
+    if (flags & 0x80) p += 2;
+    if ((flags & 0x40) && p < end) p += 1 + *p;
+    if (flags & 0x20) p += 2;
+    if (p >= end || *p++ != 0x04 || !CQMP4ReadDescriptorLength(&p, end, &length) || p + 13 > end) return;
+    // objectTypeIndication 0x40为MPEG-4 Audio
+    if (p[0] != 0x40) return;
+    p += 13;
+    if (p >= end || *p++ != 0x05 || !CQMP4ReadDescriptorLength(&p, end, &length) || length < 2 || p + length > end) return;
+    track.audioSpecificConfig = [NSData dataWithBytes:p length:length];
+
+    // AudioSpecificConfig: audioObjectType(5) samplingFrequencyIndex(4) channelConfiguration(4)
+    int sampleRateIndex = ((p[0] & 0x07) << 1) | (p[1] >> 7);
+    NSInteger sampleRate = CQADTSSampleRateForIndex(sampleRateIndex);
+    if (sampleRate > 0) track.sampleRate = sampleRate;
+    int channelConfig = (p[1] >> 3) & 0x0F;
+    if (channelConfig > 0) track.channelCount = channelConfig;
+    track.type = CQMP4TrackTypeAudio;
+}
+
+@end
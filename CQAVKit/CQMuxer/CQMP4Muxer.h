@@ -0,0 +1,67 @@
+//
+//  CQMP4Muxer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ MP4封装
+ @discussion 用AVAssetWriter直通写入已编码的H264/HEVC/AAC，不重新编码，HEVC的sample entry为hvc1(参数集在hvcC里)
+ 第一帧视频必须是关键帧，只有视频配置时，在第一个关键帧之前的音频会被丢弃
+ 写入是同步的，AVAssetWriter来不及接收时会等待，不要在编码回调里调用，所有方法需要在同一个队列调用
+ */
+@interface CQMP4Muxer : NSObject
+
+/**
+ 唯一初始化函数，文件已存在会被删除
+ @param path 文件路径
+ @param videoConfig 视频配置，为nil时只有音频
+ @param audioConfig 音频配置，为nil时只有视频
+ @param error 错误信息
+ */
+- (nullable instancetype)initWithPath:(NSString *)path videoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *path;  ///< 文件路径
+@property (nonatomic, strong, readonly, nullable) CQVideoCoderConfig *videoConfig;  ///< 视频配置信息
+@property (nonatomic, strong, readonly, nullable) CQAudioCoderConfig *audioConfig;  ///< 音频配置信息
+
+/**
+ 设置sps/pps，需要在第一个关键帧前设置
+ @param sps sps数据，Annex-B格式，HEVC为vps + sps(CQVideoEncoder回调的格式)
+ @param pps pps数据，Annex-B格式
+ */
+- (void)setSps:(NSData *)sps pps:(NSData *)pps;
+
+/**
+ 封装一帧视频
+ @param nalus 该帧的所有NALU，Annex-B格式，vps/sps/pps/AUD会被忽略
+ @return 写入失败或还没有遇到关键帧时返回NO
+ */
+- (BOOL)muxVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 封装一帧音频
+ @param aacData AAC数据，可以是裸数据，也可以带ADTS头(会去掉)
+ @return 写入失败或还没有开始写入时返回NO
+ */
+- (BOOL)muxAudioData:(NSData *)aacData pts:(CMTime)pts;
+
+/**
+ 结束写入
+ @param completionHandler 文件写完后回调，error为nil表示成功
+ */
+- (void)finishWithCompletionHandler:(void (^)(NSError * _Nullable error))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
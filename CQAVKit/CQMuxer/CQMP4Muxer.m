@@ -0,0 +1,234 @@
+//
+//  CQMP4Muxer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 第一个关键帧(纯音频时为第一帧)到来时，用sps/pps(HEVC为vps/sps/pps)和AudioSpecificConfig创建格式描述，添加直通输入(outputSettings为nil)并开始写入
+ 2 视频帧从Annex-B转为AVCC(4字节长度)，去掉参数集/AUD，非关键帧标记NotSync
+ 3 音频帧去掉ADTS头，带上包描述
+ 4 数据拷贝到CMBlockBuffer自己的内存里，AVAssetWriter异步写入时不依赖调用方的数据
+ */
+
+#import "CQMP4Muxer.h"
+#import <AVFoundation/AVFoundation.h>
+#import "CQNaluUtil.h"
+#import "CQADTSUtil.h"
+
+static const int64_t kAACFrameSamples = 1024;  ///< AAC每帧的采样数
+
+@interface CQMP4Muxer ()
+@property (nonatomic, strong) AVAssetWriter *assetWriter;  ///< 写文件
+@property (nonatomic, strong, nullable) AVAssetWriterInput *videoInput;  ///< 视频输入
+@property (nonatomic, strong, nullable) AVAssetWriterInput *audioInput;  ///< 音频输入
+@property (nonatomic, strong, nullable) NSData *sps;  ///< Annex-B
+@property (nonatomic, strong, nullable) NSData *pps;  ///< Annex-B
+@end
+
+@implementation CQMP4Muxer
+{
+    CMVideoFormatDescriptionRef _videoFormat;
+    CMAudioFormatDescriptionRef _audioFormat;
+    BOOL _isStarted;
+}
+
+#pragma mark - Init
+- (instancetype)initWithPath:(NSString *)path videoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig error:(NSError **)error {
+    if (self = [super init]) {
+        _path = [path copy];
+        _videoConfig = videoConfig;
+        _audioConfig = audioConfig;
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        _assetWriter = [AVAssetWriter assetWriterWithURL:[NSURL fileURLWithPath:path] fileType:AVFileTypeMPEG4 error:error];
+        if (!_assetWriter) return nil;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_videoFormat) CFRelease(_videoFormat);
+    if (_audioFormat) CFRelease(_audioFormat);
+    NSLog(@"CQMP4Muxer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (void)setSps:(NSData *)sps pps:(NSData *)pps {
+    self.sps = sps;
+    self.pps = pps;
+}
+
+- (BOOL)muxVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    if (!self.videoConfig) return NO;
+    if (!_isStarted && (!isKeyFrame || ![self startWritingAtTime:pts])) return NO;
+
+    // 计算AVCC长度，去掉sps/pps/AUD
+    __block size_t totalSize = 0;
+    for (NSData *naluData in nalus) {
+        CQNaluEnumerateAnnexB(naluData.bytes, naluData.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            if ([self shouldWriteNalu:nalu]) totalSize += 4 + naluSize;
+        });
+    }
+    if (totalSize == 0) return NO;
+
+    CMBlockBufferRef blockBuffer = NULL;
+    OSStatus status = CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, totalSize, kCFAllocatorDefault, NULL, 0, totalSize, kCMBlockBufferAssureMemoryNowFlag, &blockBuffer);
+    if (status != noErr) return NO;
+    char *dataPointer = NULL;
+    CMBlockBufferGetDataPointer(blockBuffer, 0, NULL, NULL, &dataPointer);
+    __block uint8_t *cursor = (uint8_t *)dataPointer;
+    for (NSData *naluData in nalus) {
+        CQNaluEnumerateAnnexB(naluData.bytes, naluData.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            if (![self shouldWriteNalu:nalu]) return;
+            uint32_t length = CFSwapInt32HostToBig((uint32_t)naluSize);
+            memcpy(cursor, &length, 4);
+            memcpy(cursor + 4, nalu, naluSize);
+            cursor += 4 + naluSize;
+        });
+    }
+
+    CMSampleTimingInfo timing = {kCMTimeInvalid, pts, dts};
+    CMSampleBufferRef sampleBuffer = NULL;
+    status = CMSampleBufferCreateReady(kCFAllocatorDefault, blockBuffer, _videoFormat, 1, 1, &timing, 1, &totalSize, &sampleBuffer);
+    CFRelease(blockBuffer);
+    if (status != noErr) return NO;
+    if (!isKeyFrame) {
+        CFArrayRef attachments = CMSampleBufferGetSampleAttachmentsArray(sampleBuffer, true);
+        CFMutableDictionaryRef attachment = (CFMutableDictionaryRef)CFArrayGetValueAtIndex(attachments, 0);
+        CFDictionarySetValue(attachment, kCMSampleAttachmentKey_NotSync, kCFBooleanTrue);
+    }
+    BOOL result = [self appendSampleBuffer:sampleBuffer toInput:self.videoInput];
+    CFRelease(sampleBuffer);
+    return result;
+}
+
+- (BOOL)muxAudioData:(NSData *)aacData pts:(CMTime)pts {
+    if (!self.audioConfig || aacData.length == 0) return NO;
+    // 有视频时从第一个关键帧开始写
+    if (!_isStarted && (self.videoConfig || ![self startWritingAtTime:pts])) return NO;
+
+    size_t headerLength = CQADTSHeaderLength(aacData.bytes, aacData.length);
+    size_t rawSize = aacData.length - headerLength;
+    if (rawSize == 0) return NO;
+    CMBlockBufferRef blockBuffer = NULL;
+    OSStatus status = CMBlockBufferCreateWithMemoryBlock(kCFAllocatorDefault, NULL, rawSize, kCFAllocatorDefault, NULL, 0, rawSize, kCMBlockBufferAssureMemoryNowFlag, &blockBuffer);
+    if (status != noErr) return NO;
+    CMBlockBufferReplaceDataBytes((const uint8_t *)aacData.bytes + headerLength, blockBuffer, 0, rawSize);
+
+    AudioStreamPacketDescription packetDesc = {0, 0, (UInt32)rawSize};
+    CMSampleBufferRef sampleBuffer = NULL;
+    status = CMAudioSampleBufferCreateReadyWithPacketDescriptions(kCFAllocatorDefault, blockBuffer, _audioFormat, 1, pts, &packetDesc, &sampleBuffer);
+    CFRelease(blockBuffer);
+    if (status != noErr) return NO;
+    BOOL result = [self appendSampleBuffer:sampleBuffer toInput:self.audioInput];
+    CFRelease(sampleBuffer);
+    return result;
+}
+
+- (void)finishWithCompletionHandler:(void (^)(NSError *))completionHandler {
+    if (!_isStarted) {
+        // 一帧都没写入，AVAssetWriter没有开始，不会生成文件
+        completionHandler([NSError errorWithDomain:AVFoundationErrorDomain code:AVErrorNoDataCaptured userInfo:nil]);
+        return;
+    }
+    [self.videoInput markAsFinished];
+    [self.audioInput markAsFinished];
+    AVAssetWriter *assetWriter = self.assetWriter;
+    [assetWriter finishWritingWithCompletionHandler:^{
+        completionHandler(assetWriter.status == AVAssetWriterStatusCompleted ? nil : assetWriter.error);
+    }];
+}
+
+#pragma mark - Private Func
+- (BOOL)shouldWriteNalu:(const uint8_t *)nalu {
+    // 参数集在格式描述里，AUD在MP4里不需要
+    CQNaluKind kind = CQNaluKindOf(self.videoConfig.codec, nalu);
+    return kind != CQNaluKindParameterSet && kind != CQNaluKindAUD;
+}
+
+/// 用参数集创建视频格式描述，HEVC的vps和sps都在self.sps里
+- (OSStatus)createVideoFormat {
+    __block size_t parameterSetCount = 0;
+    __block const uint8_t *parameterSetPointers[3] = {NULL};
+    __block size_t parameterSetSizes[3] = {0};
+    for (NSData *parameterSets in @[self.sps, self.pps]) {
+        CQNaluEnumerateAnnexB(parameterSets.bytes, parameterSets.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+            if (parameterSetCount == 3) {
+                *stop = YES;
+                return;
+            }
+            parameterSetPointers[parameterSetCount] = nalu;
+            parameterSetSizes[parameterSetCount] = naluSize;
+            parameterSetCount++;
+        });
+    }
+    if (self.videoConfig.codec == CQVideoCodecHEVC) {
+        if (parameterSetCount != 3) return kCMFormatDescriptionError_InvalidParameter;
+        return CMVideoFormatDescriptionCreateFromHEVCParameterSets(kCFAllocatorDefault, 3, parameterSetPointers, parameterSetSizes, 4, NULL, &_videoFormat);
+    }
+    if (parameterSetCount != 2) return kCMFormatDescriptionError_InvalidParameter;
+    return CMVideoFormatDescriptionCreateFromH264ParameterSets(kCFAllocatorDefault, 2, parameterSetPointers, parameterSetSizes, 4, &_videoFormat);
+}
+
+/// 创建输入并开始写入
+- (BOOL)startWritingAtTime:(CMTime)time {
+    if (self.videoConfig) {
+        if (!self.sps || !self.pps) {
+            NSLog(@"CQMP4Muxer start failed: no sps/pps");
+            return NO;
+        }
+        if (_videoFormat) { CFRelease(_videoFormat); _videoFormat = NULL; }
+        OSStatus status = [self createVideoFormat];
+        if (status != noErr) {
+            NSLog(@"CQMP4Muxer create video format failed status=%d", (int)status);
+            return NO;
+        }
+        self.videoInput = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeVideo outputSettings:nil sourceFormatHint:_videoFormat];
+        self.videoInput.expectsMediaDataInRealTime = NO;
+        if (![self.assetWriter canAddInput:self.videoInput]) return NO;
+        [self.assetWriter addInput:self.videoInput];
+    }
+    if (self.audioConfig) {
+        int freqIdx = CQADTSSampleRateIndex(self.audioConfig.sampleRate);
+        if (freqIdx < 0) freqIdx = 4;
+        // AudioSpecificConfig: audioObjectType(5) samplingFrequencyIndex(4) channelConfiguration(4)
+        uint16_t config = (uint16_t)((2 << 11) | (freqIdx << 7) | ((int)self.audioConfig.channelCount << 3));
+        uint8_t audioSpecificConfig[2] = {(uint8_t)(config >> 8), (uint8_t)(config & 0xFF)};
+        if (_audioFormat) { CFRelease(_audioFormat); _audioFormat = NULL; }
+        AudioStreamBasicDescription asbd = {0};
+        asbd.mSampleRate = self.audioConfig.sampleRate;
+        asbd.mFormatID = kAudioFormatMPEG4AAC;
+        asbd.mFormatFlags = kMPEG4Object_AAC_LC;
+        asbd.mFramesPerPacket = (UInt32)kAACFrameSamples;
+        asbd.mChannelsPerFrame = (UInt32)self.audioConfig.channelCount;
+        OSStatus status = CMAudioFormatDescriptionCreate(kCFAllocatorDefault, &asbd, 0, NULL, sizeof(audioSpecificConfig), audioSpecificConfig, NULL, &_audioFormat);
+        if (status != noErr) {
+            NSLog(@"CQMP4Muxer create audio format failed status=%d", (int)status);
+            return NO;
+        }
+        self.audioInput = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeAudio outputSettings:nil sourceFormatHint:_audioFormat];
+        self.audioInput.expectsMediaDataInRealTime = NO;
+        if (![self.assetWriter canAddInput:self.audioInput]) return NO;
+        [self.assetWriter addInput:self.audioInput];
+    }
+    if (![self.assetWriter startWriting]) {
+        NSLog(@"CQMP4Muxer start writing failed error=%@", self.assetWriter.error);
+        return NO;
+    }
+    [self.assetWriter startSessionAtSourceTime:time];
+    _isStarted = YES;
+    return YES;
+}
+
+/// 等待输入可以接收数据后写入
+- (BOOL)appendSampleBuffer:(CMSampleBufferRef)sampleBuffer toInput:(AVAssetWriterInput *)input {
+    while (!input.isReadyForMoreMediaData && self.assetWriter.status == AVAssetWriterStatusWriting) {
+        usleep(1000);
+    }
+    if (self.assetWriter.status != AVAssetWriterStatusWriting) return NO;
+    return [input appendSampleBuffer:sampleBuffer];
+}
+
+@end
@@ -0,0 +1,104 @@
+//
+//  CQRawStreamReader.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQVideoDecoder.h"
+#import "CQAudioDecoder.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+FOUNDATION_EXPORT NSErrorDomain const CQRawStreamReaderErrorDomain;
+
+typedef NS_ENUM(NSUInteger, CQRawStreamType) {
+    CQRawStreamTypeH264 = 0,  ///< Annex-B格式的H264(.h264)
+    CQRawStreamTypeAAC = 1,  ///< ADTS格式的AAC(.aac)
+};
+
+/**
+ 裸码流文件读取
+ @discussion mmap映射.h264/.aac文件，扫描一遍建立帧索引(偏移、大小、是否IDR、是否参考帧)，
+ 索引保存为同目录下的"文件名.cqidx"，再次打开时文件大小和修改时间没变就直接映射索引，不再扫描
+ H264按访问单元(一帧)索引，sps/pps/SEI归入后面的帧；AAC按ADTS帧索引
+ 裸码流没有时间戳，H264按frameRate计算，AAC按每帧1024个采样计算
+ */
+@interface CQRawStreamReader : NSObject
+
+/**
+ 唯一初始化函数
+ @param path 文件路径，扩展名为aac时按AAC读取，否则按H264读取
+ @param frameRate H264的帧率，用于计算时间戳，AAC忽略
+ @param error 错误信息
+ */
+- (nullable instancetype)initWithPath:(NSString *)path frameRate:(NSInteger)frameRate error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *path;  ///< 文件路径
+@property (nonatomic, assign, readonly) CQRawStreamType type;  ///< 码流类型
+@property (nonatomic, assign, readonly) NSUInteger frameCount;  ///< 帧数
+@property (nonatomic, assign, readonly) NSUInteger keyFrameCount;  ///< 关键帧数，AAC每帧都是关键帧
+@property (nonatomic, assign, readonly) CMTime frameDuration;  ///< 每帧时长
+@property (nonatomic, assign, readonly) CMTime duration;  ///< 总时长
+@property (nonatomic, assign, readonly) NSInteger sampleRate;  ///< AAC采样率
+@property (nonatomic, assign, readonly) NSInteger channelCount;  ///< AAC声道数
+@property (nonatomic, assign, readonly) BOOL isIndexLoaded;  ///< 索引是否从索引文件加载(没有重新扫描)
+
+/**
+ 一帧的数据，直接引用映射内存，不拷贝
+ @return H264为该帧的所有NALU(Annex-B)，AAC为去掉ADTS头的裸数据(可以直接交给CQAudioDecoder)
+ */
+- (nullable NSData *)frameDataAtIndex:(NSUInteger)index;
+
+/// 是否为关键帧(IDR)
+- (BOOL)isKeyFrameAtIndex:(NSUInteger)index;
+
+/// 是否为参考帧，非参考帧(nal_ref_idc为0)可以不解码而不影响其它帧
+- (BOOL)isReferenceFrameAtIndex:(NSUInteger)index;
+
+/**
+ 顺序播放时下一个要送入解码器的帧
+ @discussion 快进或解码跟不上时跳过非参考帧，分层P码流(CQVideoCoderConfig.temporalLayerCount为2)跳过后帧率正好减半，画面不受影响
+ @param index 当前帧
+ @param skipNonReferenceFrames 是否跳过非参考帧
+ @return 下一帧序号，没有下一帧时返回frameCount
+ */
+- (NSUInteger)nextFrameIndexAfterIndex:(NSUInteger)index skipNonReferenceFrames:(BOOL)skipNonReferenceFrames;
+
+/// 帧的时间戳
+- (CMTime)timeAtIndex:(NSUInteger)index;
+
+/// time所在的帧
+- (NSUInteger)frameIndexAtTime:(CMTime)time;
+
+/// time之前(含)最近的关键帧
+- (NSUInteger)keyFrameIndexAtOrBeforeIndex:(NSUInteger)index;
+
+/**
+ 把一帧送入视频解码器(只送sps/pps和图像NALU)
+ */
+- (void)feedFrameAtIndex:(NSUInteger)index toVideoDecoder:(CQVideoDecoder *)videoDecoder;
+
+/**
+ 把一帧送入音频解码器
+ */
+- (void)feedFrameAtIndex:(NSUInteger)index toAudioDecoder:(CQAudioDecoder *)audioDecoder;
+
+/**
+ 跳转，从time之前最近的IDR开始把帧送入解码器，直到time所在的帧
+ @discussion IDR没有带sps/pps时，会先送入前面最近的sps/pps
+ @param time 目标时间
+ @param videoDecoder 视频解码器
+ @param skipNonReferenceFrames 是否跳过IDR和目标帧之间的非参考帧，跳过后解码更快，目标帧的画面不受影响
+ @return 目标帧序号，接着播放时从下一帧开始送
+ */
+- (NSUInteger)seekToTime:(CMTime)time videoDecoder:(CQVideoDecoder *)videoDecoder skipNonReferenceFrames:(BOOL)skipNonReferenceFrames;
+
+@end
+
+NS_ASSUME_NONNULL_END
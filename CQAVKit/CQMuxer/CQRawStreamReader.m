@@ -0,0 +1,342 @@
+//
+//  CQRawStreamReader.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 mmap映射码流文件，先尝试映射"文件名.cqidx"索引文件，文件大小、修改时间、类型都一致时直接使用
+ 2 没有可用的索引时扫描一遍文件：H264遇到sps/pps/SEI/AUD或first_mb_in_slice为0的片时开始新的一帧，AAC逐个读取ADTS头
+ 3 扫描结果直接写在一块内存里(索引头+帧表+关键帧表)，原子写入索引文件，下次打开直接映射，两种情况共用同一套读取代码
+ 4 扫描后回收码流文件的页面，之后按帧引用映射内存，不拷贝
+ */
+
+#import "CQRawStreamReader.h"
+#import "CQMappedFile.h"
+#import "CQNaluUtil.h"
+#import "CQADTSUtil.h"
+
+NSErrorDomain const CQRawStreamReaderErrorDomain = @"CQRawStreamReaderErrorDomain";
+
+static const uint32_t kIndexMagic = 'CQRI';
+static const uint32_t kIndexVersion = 1;
+static const int64_t kAACFrameSamples = 1024;  ///< AAC每帧的采样数
+
+/// 帧标记
+typedef NS_OPTIONS(uint32_t, CQRawFrameFlags) {
+    CQRawFrameFlagKeyFrame = 1 << 0,  ///< IDR
+    CQRawFrameFlagReference = 1 << 1,  ///< nal_ref_idc不为0
+    CQRawFrameFlagParameterSets = 1 << 2,  ///< 带sps
+};
+
+/// 索引文件头
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fileSize;  ///< 码流文件大小
+    int64_t modifySec;  ///< 码流文件修改时间
+    int64_t modifyNsec;
+    uint32_t type;  ///< CQRawStreamType
+    uint32_t sampleRate;  ///< AAC采样率
+    uint32_t channelCount;  ///< AAC声道数
+    uint32_t reserved;
+    uint32_t frameCount;
+    uint32_t keyFrameCount;
+} CQRawIndexHeader;
+
+/// 帧表项
+typedef struct {
+    uint64_t offset;  ///< 在码流文件中的偏移
+    uint32_t size;
+    uint32_t flags;  ///< CQRawFrameFlags
+} CQRawFrameEntry;
+
+@interface CQRawStreamReader ()
+@property (nonatomic, strong) CQMappedFile *mappedFile;  ///< 码流文件
+@property (nonatomic, strong) NSData *indexData;  ///< 索引(扫描生成的内存或映射的索引文件)
+@end
+
+@implementation CQRawStreamReader
+{
+    const CQRawFrameEntry *_entries;  ///< 指向indexData
+    const uint32_t *_keyFrames;  ///< 关键帧序号，指向indexData
+    int32_t _timescale;
+    int64_t _frameTicks;  ///< 每帧时长(timescale为单位)
+}
+
+#pragma mark - Init
+- (instancetype)initWithPath:(NSString *)path frameRate:(NSInteger)frameRate error:(NSError **)error {
+    if (self = [super init]) {
+        _path = [path copy];
+        _type = [path.pathExtension.lowercaseString isEqualToString:@"aac"] ? CQRawStreamTypeAAC : CQRawStreamTypeH264;
+        _mappedFile = [[CQMappedFile alloc] initWithPath:path error:error];
+        if (!_mappedFile) return nil;
+
+        NSString *indexPath = [path stringByAppendingPathExtension:@"cqidx"];
+        _indexData = [self loadIndexAtPath:indexPath];
+        _isIndexLoaded = (_indexData != nil);
+        if (!_indexData) {
+            _indexData = self.type == CQRawStreamTypeH264 ? [self buildH264Index] : [self buildAACIndex];
+            if (_indexData && ![_indexData writeToFile:indexPath atomically:YES]) {
+                // 只读目录(例如bundle)写不了索引，不影响使用，下次打开重新扫描
+                NSLog(@"CQRawStreamReader write index failed path=%@", indexPath);
+            }
+        }
+        if (!_indexData) {
+            if (error) *error = [NSError errorWithDomain:CQRawStreamReaderErrorDomain code:-1 userInfo:@{NSLocalizedDescriptionKey: @"no frame found"}];
+            return nil;
+        }
+
+        const CQRawIndexHeader *header = _indexData.bytes;
+        _frameCount = header->frameCount;
+        _keyFrameCount = header->keyFrameCount;
+        _sampleRate = header->sampleRate;
+        _channelCount = header->channelCount;
+        _entries = (const CQRawFrameEntry *)((const uint8_t *)_indexData.bytes + sizeof(CQRawIndexHeader));
+        _keyFrames = (const uint32_t *)(_entries + _frameCount);
+
+        if (self.type == CQRawStreamTypeAAC) {
+            _timescale = (int32_t)MAX(_sampleRate, 1);
+            _frameTicks = kAACFrameSamples;
+        } else {
+            _timescale = (int32_t)MAX(frameRate, 1);
+            _frameTicks = 1;
+        }
+        _frameDuration = CMTimeMake(_frameTicks, _timescale);
+        _duration = CMTimeMake(_frameTicks * (int64_t)_frameCount, _timescale);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    NSLog(@"CQRawStreamReader - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSData *)frameDataAtIndex:(NSUInteger)index {
+    if (index >= self.frameCount) return nil;
+    return [self.mappedFile dataWithOffset:_entries[index].offset length:_entries[index].size];
+}
+
+- (BOOL)isKeyFrameAtIndex:(NSUInteger)index {
+    return index < self.frameCount && (_entries[index].flags & CQRawFrameFlagKeyFrame);
+}
+
+- (BOOL)isReferenceFrameAtIndex:(NSUInteger)index {
+    return index < self.frameCount && (_entries[index].flags & CQRawFrameFlagReference);
+}
+
+- (NSUInteger)nextFrameIndexAfterIndex:(NSUInteger)index skipNonReferenceFrames:(BOOL)skipNonReferenceFrames {
+    NSUInteger next = index + 1;
+    while (skipNonReferenceFrames && next < self.frameCount && !(_entries[next].flags & CQRawFrameFlagReference)) {
+        next++;
+    }
+    return MIN(next, self.frameCount);
+}
+
+- (CMTime)timeAtIndex:(NSUInteger)index {
+    return CMTimeMake(_frameTicks * (int64_t)index, _timescale);
+}
+
+- (NSUInteger)frameIndexAtTime:(CMTime)time {
+    if (self.frameCount == 0 || !CMTIME_IS_NUMERIC(time)) return 0;
+    int64_t ticks = CMTimeConvertScale(time, _timescale, kCMTimeRoundingMethod_RoundTowardZero).value;
+    if (ticks <= 0) return 0;
+    return (NSUInteger)MIN(ticks / _frameTicks, (int64_t)self.frameCount - 1);
+}
+
+- (NSUInteger)keyFrameIndexAtOrBeforeIndex:(NSUInteger)index {
+    // 二分查找最后一个不大于index的关键帧
+    NSUInteger low = 0, high = self.keyFrameCount;
+    while (low < high) {
+        NSUInteger mid = (low + high) / 2;
+        if (_keyFrames[mid] <= index) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // 前面没有关键帧时从第一帧开始
+    return low > 0 ? _keyFrames[low - 1] : 0;
+}
+
+- (void)feedFrameAtIndex:(NSUInteger)index toVideoDecoder:(CQVideoDecoder *)videoDecoder {
+    [self feedFrameAtIndex:index toVideoDecoder:videoDecoder parameterSetsOnly:NO];
+}
+
+- (void)feedFrameAtIndex:(NSUInteger)index toAudioDecoder:(CQAudioDecoder *)audioDecoder {
+    NSData *aacData = [self frameDataAtIndex:index];
+    if (aacData) [audioDecoder audioDecodeWithAACData:aacData];
+}
+
+- (NSUInteger)seekToTime:(CMTime)time videoDecoder:(CQVideoDecoder *)videoDecoder skipNonReferenceFrames:(BOOL)skipNonReferenceFrames {
+    if (self.frameCount == 0 || self.type != CQRawStreamTypeH264) return 0;
+    NSUInteger target = [self frameIndexAtTime:time];
+    NSUInteger keyFrame = [self keyFrameIndexAtOrBeforeIndex:target];
+
+    // IDR没有带sps/pps时，先送入前面最近的sps/pps
+    if (!(_entries[keyFrame].flags & CQRawFrameFlagParameterSets)) {
+        for (NSUInteger i = keyFrame; i > 0; i--) {
+            if (_entries[i - 1].flags & CQRawFrameFlagParameterSets) {
+                [self feedFrameAtIndex:i - 1 toVideoDecoder:videoDecoder parameterSetsOnly:YES];
+                break;
+            }
+        }
+    }
+    for (NSUInteger i = keyFrame; i <= target; i++) {
+        // 非参考帧不会被后面的帧引用，跳过不影响目标帧
+        if (skipNonReferenceFrames && i != keyFrame && i != target && !(_entries[i].flags & CQRawFrameFlagReference)) continue;
+        [self feedFrameAtIndex:i toVideoDecoder:videoDecoder parameterSetsOnly:NO];
+    }
+    return target;
+}
+
+#pragma mark - Private Func
+/// 送入一帧，sps/pps单独送入，图像NALU合成一个AVCC帧送入
+- (void)feedFrameAtIndex:(NSUInteger)index toVideoDecoder:(CQVideoDecoder *)videoDecoder parameterSetsOnly:(BOOL)parameterSetsOnly {
+    if (index >= self.frameCount) return;
+    const uint8_t *frame = self.mappedFile.bytes + _entries[index].offset;
+    NSMutableData *avccData = parameterSetsOnly ? nil : [NSMutableData dataWithCapacity:_entries[index].size + 16];
+    CQNaluEnumerateAnnexB(frame, _entries[index].size, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        CQH264NaluType type = CQH264NaluTypeOf(nalu);
+        if (type == CQH264NaluTypeSPS || type == CQH264NaluTypePPS) {
+            static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+            NSMutableData *naluData = [NSMutableData dataWithCapacity:naluSize + 4];
+            [naluData appendBytes:startCode length:4];
+            [naluData appendBytes:nalu length:naluSize];
+            [videoDecoder videoDecodeWithH264Data:naluData];
+        } else if (avccData && (type == CQH264NaluTypeSlice || type == CQH264NaluTypeIDR)) {
+            uint32_t length = CFSwapInt32HostToBig((uint32_t)naluSize);
+            [avccData appendBytes:&length length:4];
+            [avccData appendBytes:nalu length:naluSize];
+        }
+    }];
+    if (avccData.length > 0) [videoDecoder videoDecodeWithAVCCData:avccData];
+}
+
+/// 映射索引文件，和码流文件不匹配返回nil
+- (NSData *)loadIndexAtPath:(NSString *)indexPath {
+    if (![[NSFileManager defaultManager] fileExistsAtPath:indexPath]) return nil;
+    CQMappedFile *indexFile = [[CQMappedFile alloc] initWithPath:indexPath error:nil];
+    if (!indexFile || indexFile.size < sizeof(CQRawIndexHeader)) return nil;
+    const CQRawIndexHeader *header = (const CQRawIndexHeader *)indexFile.bytes;
+    struct timespec modifyTime = self.mappedFile.modifyTime;
+    if (header->magic != kIndexMagic || header->version != kIndexVersion || header->type != self.type) return nil;
+    if (header->fileSize != self.mappedFile.size || header->modifySec != modifyTime.tv_sec || header->modifyNsec != modifyTime.tv_nsec) return nil;
+    uint64_t expectedSize = sizeof(CQRawIndexHeader) + (uint64_t)header->frameCount * sizeof(CQRawFrameEntry) + (uint64_t)header->keyFrameCount * sizeof(uint32_t);
+    if (header->frameCount == 0 || indexFile.size != expectedSize) return nil;
+    return [indexFile dataWithOffset:0 length:(NSUInteger)indexFile.size];
+}
+
+/// 生成索引头，帧表和关键帧表已经写入indexData
+- (NSData *)finishIndexData:(NSMutableData *)indexData keyFrames:(NSData *)keyFrames sampleRate:(NSInteger)sampleRate channelCount:(NSInteger)channelCount {
+    uint32_t frameCount = (uint32_t)((indexData.length - sizeof(CQRawIndexHeader)) / sizeof(CQRawFrameEntry));
+    if (frameCount == 0) return nil;
+    [indexData appendData:keyFrames];
+    struct timespec modifyTime = self.mappedFile.modifyTime;
+    CQRawIndexHeader *header = indexData.mutableBytes;
+    header->magic = kIndexMagic;
+    header->version = kIndexVersion;
+    header->fileSize = self.mappedFile.size;
+    header->modifySec = modifyTime.tv_sec;
+    header->modifyNsec = modifyTime.tv_nsec;
+    header->type = (uint32_t)self.type;
+    header->sampleRate = (uint32_t)sampleRate;
+    header->channelCount = (uint32_t)channelCount;
+    header->frameCount = frameCount;
+    header->keyFrameCount = (uint32_t)(keyFrames.length / sizeof(uint32_t));
+    // 扫描过的页面不再需要，按帧读取时再换入
+    [self.mappedFile releasePagesFromOffset:0 toOffset:self.mappedFile.size];
+    return indexData;
+}
+
+/// 扫描H264码流，按访问单元建立帧表
+- (NSData *)buildH264Index {
+    const uint8_t *bytes = self.mappedFile.bytes;
+    uint64_t fileSize = self.mappedFile.size;
+    NSMutableData *indexData = [NSMutableData dataWithLength:sizeof(CQRawIndexHeader)];
+    NSMutableData *keyFrames = [NSMutableData data];
+    __block CQRawFrameEntry current = {0};
+    __block BOOL hasFrameStart = NO;  ///< current.offset有效
+    __block BOOL hasSlice = NO;  ///< 当前帧已经有图像NALU
+
+    void (^appendFrame)(uint64_t) = ^(uint64_t endOffset) {
+        current.size = (uint32_t)(endOffset - current.offset);
+        if (current.flags & CQRawFrameFlagKeyFrame) {
+            uint32_t frameIndex = (uint32_t)((indexData.length - sizeof(CQRawIndexHeader)) / sizeof(CQRawFrameEntry));
+            [keyFrames appendBytes:&frameIndex length:sizeof(frameIndex)];
+        }
+        [indexData appendBytes:&current length:sizeof(current)];
+        current.offset = endOffset;
+        current.flags = 0;
+        hasSlice = NO;
+    };
+
+    [self.mappedFile adviseSequential];
+    CQNaluEnumerateAnnexB(bytes, (size_t)fileSize, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        // 起始码的位置，4字节起始码前面多出的00已经被当作上一个NALU的结尾去掉了
+        uint64_t naluStart = (uint64_t)(nalu - bytes) - 3;
+        if (naluStart > 0 && bytes[naluStart - 1] == 0x00) naluStart--;
+        CQH264NaluType type = CQH264NaluTypeOf(nalu);
+        BOOL isSlice = (type == CQH264NaluTypeSlice || type == CQH264NaluTypeIDR);
+        // first_mb_in_slice是ue(v)，为0时第一位为1，表示新的一帧的第一个片
+        BOOL isFirstSlice = isSlice && naluSize > 1 && (nalu[1] & 0x80);
+        BOOL startsAccessUnit = (type == CQH264NaluTypeSPS || type == CQH264NaluTypePPS || type == CQH264NaluTypeSEI || type == CQH264NaluTypeAUD);
+
+        if (hasSlice && (isFirstSlice || startsAccessUnit)) {
+            appendFrame(naluStart);
+        }
+        if (!hasFrameStart) {
+            current.offset = naluStart;
+            hasFrameStart = YES;
+        }
+        if (isSlice) {
+            hasSlice = YES;
+            if (type == CQH264NaluTypeIDR) current.flags |= CQRawFrameFlagKeyFrame;
+            if (CQH264NalRefIdcOf(nalu)) current.flags |= CQRawFrameFlagReference;
+        } else if (type == CQH264NaluTypeSPS) {
+            current.flags |= CQRawFrameFlagParameterSets;
+        }
+    });
+    // 最后一帧，末尾没有图像的sps/pps等丢弃
+    if (hasSlice) appendFrame(fileSize);
+    return [self finishIndexData:indexData keyFrames:keyFrames sampleRate:0 channelCount:0];
+}
+
+/// 扫描ADTS码流，每个ADTS帧一项，数据不含ADTS头
+- (NSData *)buildAACIndex {
+    const uint8_t *bytes = self.mappedFile.bytes;
+    uint64_t fileSize = self.mappedFile.size;
+    NSMutableData *indexData = [NSMutableData dataWithLength:sizeof(CQRawIndexHeader)];
+    NSMutableData *keyFrames = [NSMutableData data];
+    NSInteger sampleRate = 0;
+    NSInteger channelCount = 0;
+
+    [self.mappedFile adviseSequential];
+    uint64_t offset = 0;
+    while (offset + CQADTSHeaderSize <= fileSize) {
+        const uint8_t *p = bytes + offset;
+        size_t headerLength = CQADTSHeaderLength(p, (size_t)(fileSize - offset));
+        size_t frameLength = headerLength ? CQADTSFrameLength(p) : 0;
+        if (headerLength == 0 || frameLength <= headerLength) {
+            // 不是ADTS头，逐字节向后重新同步
+            offset++;
+            continue;
+        }
+        if (offset + frameLength > fileSize) break;  // 最后一帧不完整(例如录制中断)
+        if (sampleRate == 0) {
+            sampleRate = CQADTSSampleRateForIndex((p[2] >> 2) & 0x0F);
+            channelCount = ((p[2] & 0x01) << 2) | (p[3] >> 6);
+        }
+        uint32_t frameIndex = (uint32_t)((indexData.length - sizeof(CQRawIndexHeader)) / sizeof(CQRawFrameEntry));
+        CQRawFrameEntry entry = {offset + headerLength, (uint32_t)(frameLength - headerLength), CQRawFrameFlagKeyFrame | CQRawFrameFlagReference};
+        [indexData appendBytes:&entry length:sizeof(entry)];
+        [keyFrames appendBytes:&frameIndex length:sizeof(frameIndex)];
+        offset += frameLength;
+    }
+    return [self finishIndexData:indexData keyFrames:keyFrames sampleRate:sampleRate channelCount:channelCount];
+}
+
+@end
@@ -0,0 +1,107 @@
+//
+//  CQTSMuxer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+
+@class CQTSMuxer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+static const NSUInteger CQTSPacketSize = 188;  ///< TS包固定长度
+
+@protocol CQTSMuxerDelegate <NSObject>
+@required
+/**
+ 输出TS数据
+ @param tsData 若干个188字节的TS包，按outputBatchSize批量输出，可以直接写入文件或发送
+ */
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData;
+
+@optional
+/**
+ 即将写入一帧(在封装队列同步回调)
+ @discussion 实现该方法后，每帧写入前会先输出已缓存的数据，因此回调之后输出的数据都属于这一帧及以后，
+ 可以在这里按帧边界切分TS流(例如HLS切片)，关键帧前的PAT/PMT也在回调之后输出
+ @param time 该帧的dts，以第一帧为0点
+ @param isVideo 是否为视频帧
+ @param isKeyFrame 是否为关键帧
+ */
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer willWriteFrameAtTime:(CMTime)time isVideo:(BOOL)isVideo isKeyFrame:(BOOL)isKeyFrame;
+
+@end
+
+/**
+ MPEG-TS封装器
+ @discussion 将CQVideoEncoder输出的H264/HEVC(按videoConfig.codec)和CQAudioEncoder输出的AAC封装为MPEG-2 TS (封装和回调均在异步队列执行)
+ PAT/PMT在开头和每个关键帧前写入，PCR随PCR流(有视频时为视频)的每个PES写入，
+ 音视频按dts交织，某一路迟迟没有数据时最多等待maxInterleaveDelta
+ */
+@interface CQTSMuxer : NSObject
+
+/**
+ 唯一初始化函数
+ @param videoConfig 视频配置，为nil时不包含视频流
+ @param audioConfig 音频配置，为nil时不包含音频流
+ */
+- (instancetype)initWithVideoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly, nullable) CQVideoCoderConfig *videoConfig;  ///< 视频配置信息
+@property (nonatomic, strong, readonly, nullable) CQAudioCoderConfig *audioConfig;  ///< 音频配置信息
+
+@property (nonatomic, weak) id<CQTSMuxerDelegate> delegate;  ///< 代理
+
+@property (nonatomic, assign) NSUInteger outputBatchSize;  ///< 批量输出大小，默认348个TS包(约64KB)，会按188字节对齐
+@property (nonatomic, assign) CMTime maxInterleaveDelta;  ///< 音视频交织时最多等待另一路的时长，默认0.5秒
+
+/**
+ 设置sps/pps，关键帧前会自动插入
+ @param sps sps数据，Annex-B格式(CQVideoEncoder回调的格式)
+ @param pps pps数据，Annex-B格式
+ */
+- (void)setSps:(NSData *)sps pps:(NSData *)pps;
+
+/**
+ 封装一帧视频
+ @param nalus 该帧的所有NALU，Annex-B格式
+ @param pts 显示时间戳
+ @param dts 解码时间戳
+ @param isKeyFrame 是否为关键帧
+ */
+- (void)muxVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 封装一帧音频
+ @param aacData AAC数据，可以是裸数据，也可以带ADTS头(没有ADTS头时会根据audioConfig补上)
+ @param pts 显示时间戳
+ */
+- (void)muxAudioData:(NSData *)aacData pts:(CMTime)pts;
+
+/**
+ 输出所有缓存的数据，结束封装时调用
+ */
+- (void)flush;
+
+/**
+ 在下一帧前写入PAT/PMT，新文件/切片的开头需要
+ @discussion 只能在tsMuxer:willWriteFrameAtTime:isVideo:isKeyFrame:回调中调用，作用于即将写入的这一帧
+ */
+- (void)insertPSIBeforeNextFrame;
+
+/**
+ 输出所有缓存的数据
+ @param completionHandler 输出完成后在封装队列回调
+ */
+- (void)flushWithCompletionHandler:(nullable void (^)(void))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,459 @@
+//
+//  CQTSMuxer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ TS结构
+ TS包固定188字节: 4字节包头(0x47同步字节 + PID + 连续计数器) + 可选的调整字段(PCR/填充) + 负载
+ PAT(PID 0) 描述节目 -> PMT(PID 0x1000) 描述节目里的流 -> 音视频PES
+ PES = PES头(pts/dts) + 一帧完整的ES数据(H264/HEVC一个访问单元/AAC一帧带ADTS)，一个PES会被切成多个TS包
+
+ 时间
+ pts/dts为90KHz，PCR为27MHz(这里只写base部分，ext为0)
+ 第一帧的dts作为0点，pts/dts整体延后kTimestampOffset，PCR不延后，给解码端留出缓冲时间
+ */
+
+#import "CQTSMuxer.h"
+#import "CQNaluUtil.h"
+#import "CQADTSUtil.h"
+
+static const uint16_t kPATPid = 0x0000;
+static const uint16_t kPMTPid = 0x1000;
+static const uint16_t kVideoPid = 0x0100;
+static const uint16_t kAudioPid = 0x0101;
+static const uint8_t kStreamTypeH264 = 0x1B;
+static const uint8_t kStreamTypeHEVC = 0x24;
+static const uint8_t kStreamTypeAAC = 0x0F;  // ADTS
+static const int64_t kTimestampOffset = 63000;  // 0.7秒
+static const int64_t kPSIInterval = 9000;  // 纯音频时PAT/PMT间隔 0.1秒
+
+#pragma mark - CRC32
+static uint32_t kCRC32Table[256];
+
+static void CQTSInitCRC32Table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i << 24;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        }
+        kCRC32Table[i] = crc;
+    }
+}
+
+/// MPEG-2 CRC32，PSI表结尾使用
+static uint32_t CQTSCRC32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc = (crc << 8) ^ kCRC32Table[((crc >> 24) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+#pragma mark - CQTSMuxFrame
+/// 待封装的一帧
+@interface CQTSMuxFrame : NSObject
+@property (nonatomic, strong) NSData *payload;  ///< ES数据
+@property (nonatomic, assign) int64_t pts;  ///< 90KHz
+@property (nonatomic, assign) int64_t dts;  ///< 90KHz
+@property (nonatomic, assign) BOOL isKeyFrame;
+@end
+
+@implementation CQTSMuxFrame
+@end
+
+#pragma mark - CQTSMuxer
+@interface CQTSMuxer ()
+@property (nonatomic, strong) dispatch_queue_t muxQueue;  ///< 封装队列
+@property (nonatomic, strong) NSMutableArray<CQTSMuxFrame *> *videoFrames;  ///< 等待交织的视频帧
+@property (nonatomic, strong) NSMutableArray<CQTSMuxFrame *> *audioFrames;  ///< 等待交织的音频帧
+@property (nonatomic, strong) NSMutableData *outputBuffer;  ///< 批量输出缓冲区
+@property (nonatomic, strong) NSData *sps;
+@property (nonatomic, strong) NSData *pps;
+@end
+
+@implementation CQTSMuxer
+{
+    uint8_t _patCC;  ///< 各PID的连续计数器
+    uint8_t _pmtCC;
+    uint8_t _videoCC;
+    uint8_t _audioCC;
+    int64_t _baseDts;  ///< 时间0点(90KHz)
+    BOOL _hasBaseDts;
+    int64_t _lastPSIDts;  ///< 上一次写入PAT/PMT的dts
+    BOOL _hasWrittenPSI;
+    BOOL _needsPSI;  ///< 下一帧前强制写入PAT/PMT
+}
+
+#pragma mark - Init
+- (instancetype)initWithVideoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig {
+    if (self = [super init]) {
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            CQTSInitCRC32Table();
+        });
+        _videoConfig = videoConfig;
+        _audioConfig = audioConfig;
+        _muxQueue = dispatch_queue_create("CQTSMuxer mux queue", DISPATCH_QUEUE_SERIAL);
+        _videoFrames = [NSMutableArray array];
+        _audioFrames = [NSMutableArray array];
+        _outputBatchSize = CQTSPacketSize * 348;
+        _outputBuffer = [NSMutableData dataWithCapacity:_outputBatchSize + CQTSPacketSize];
+        _maxInterleaveDelta = CMTimeMake(500, 1000);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    NSLog(@"CQTSMuxer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (void)setOutputBatchSize:(NSUInteger)outputBatchSize {
+    NSUInteger count = MAX(1, (outputBatchSize + CQTSPacketSize - 1) / CQTSPacketSize);
+    _outputBatchSize = count * CQTSPacketSize;
+}
+
+- (void)setSps:(NSData *)sps pps:(NSData *)pps {
+    dispatch_async(self.muxQueue, ^{
+        self.sps = sps;
+        self.pps = pps;
+    });
+}
+
+- (void)muxVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    if (!self.videoConfig) return;
+    dispatch_async(self.muxQueue, ^{
+        CQTSMuxFrame *frame = [[CQTSMuxFrame alloc] init];
+        frame.payload = [self videoPayloadWithNalus:nalus isKeyFrame:isKeyFrame];
+        frame.dts = [self timestampFromTime:CMTIME_IS_VALID(dts) ? dts : pts];
+        frame.pts = CMTIME_IS_VALID(pts) ? [self timestampFromTime:pts] : frame.dts;
+        frame.isKeyFrame = isKeyFrame;
+        [self.videoFrames addObject:frame];
+        [self interleaveFlushAll:NO];
+    });
+}
+
+- (void)muxAudioData:(NSData *)aacData pts:(CMTime)pts {
+    if (!self.audioConfig || aacData.length == 0) return;
+    dispatch_async(self.muxQueue, ^{
+        CQTSMuxFrame *frame = [[CQTSMuxFrame alloc] init];
+        frame.payload = [self audioPayloadWithData:aacData];
+        frame.pts = frame.dts = [self timestampFromTime:pts];
+        [self.audioFrames addObject:frame];
+        [self interleaveFlushAll:NO];
+    });
+}
+
+- (void)flush {
+    [self flushWithCompletionHandler:nil];
+}
+
+- (void)insertPSIBeforeNextFrame {
+    // 在封装队列的回调中调用，不需要再派发
+    _needsPSI = YES;
+}
+
+- (void)flushWithCompletionHandler:(void (^)(void))completionHandler {
+    dispatch_async(self.muxQueue, ^{
+        [self interleaveFlushAll:YES];
+        [self outputBufferedDataForce:YES];
+        if (completionHandler) completionHandler();
+    });
+}
+
+#pragma mark - ES
+/// 组装视频ES: AUD + (关键帧)sps/pps + NALU，HEVC的sps里已经带有vps
+- (NSData *)videoPayloadWithNalus:(NSArray<NSData *> *)nalus isKeyFrame:(BOOL)isKeyFrame {
+    static const uint8_t h264AUD[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+    static const uint8_t hevcAUD[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50};  // AUD(35)，pic_type 2(I/P/B)
+    CQVideoCodec codec = self.videoConfig.codec;
+    const uint8_t *aud = codec == CQVideoCodecHEVC ? hevcAUD : h264AUD;
+    size_t audSize = codec == CQVideoCodecHEVC ? sizeof(hevcAUD) : sizeof(h264AUD);
+    NSUInteger length = audSize + self.sps.length + self.pps.length;
+    BOOL hasParameterSets = NO;
+    for (NSData *nalu in nalus) {
+        length += nalu.length;
+        size_t size = 0;
+        const uint8_t *p = CQNaluSkipStartCode(nalu.bytes, nalu.length, &size);
+        if (p && size > 0 && CQNaluIsSPS(codec, p)) hasParameterSets = YES;
+    }
+    NSMutableData *payload = [NSMutableData dataWithCapacity:length];
+    [payload appendBytes:aud length:audSize];
+    if (isKeyFrame && !hasParameterSets && self.sps && self.pps) {
+        [payload appendData:self.sps];
+        [payload appendData:self.pps];
+    }
+    for (NSData *nalu in nalus) {
+        size_t size = 0;
+        const uint8_t *p = CQNaluSkipStartCode(nalu.bytes, nalu.length, &size);
+        if (!p || size == 0 || CQNaluKindOf(codec, p) == CQNaluKindAUD) continue;
+        [payload appendData:nalu];
+    }
+    return payload;
+}
+
+/// 组装音频ES: 每一帧都需要ADTS头
+- (NSData *)audioPayloadWithData:(NSData *)aacData {
+    const uint8_t *bytes = aacData.bytes;
+    size_t headerLength = CQADTSHeaderLength(bytes, aacData.length);
+    if (headerLength > 0 && CQADTSFrameLength(bytes) == aacData.length) {
+        return aacData;
+    }
+    // CQAudioEncoder只有第一帧带ADTS头，去掉后统一重新生成
+    const uint8_t *raw = bytes + headerLength;
+    size_t rawLength = aacData.length - headerLength;
+    NSMutableData *payload = [NSMutableData dataWithLength:CQADTSHeaderSize];
+    CQADTSWriteHeader(payload.mutableBytes, self.audioConfig.sampleRate, self.audioConfig.channelCount, rawLength);
+    [payload appendBytes:raw length:rawLength];
+    return payload;
+}
+
+/// CMTime转90KHz，并以第一帧为0点
+- (int64_t)timestampFromTime:(CMTime)time {
+    int64_t ts = CMTimeConvertScale(time, 90000, kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+    if (!_hasBaseDts) {
+        _baseDts = ts;
+        _hasBaseDts = YES;
+    }
+    return MAX(0, ts - _baseDts);
+}
+
+#pragma mark - Interleave
+/**
+ 音视频交织，按dts从小到大输出
+ 两路都有数据时输出dts小的；只有一路有数据时，等待另一路，直到缓存跨度超过maxInterleaveDelta
+ */
+- (void)interleaveFlushAll:(BOOL)flushAll {
+    int64_t maxDelta = CMTimeConvertScale(self.maxInterleaveDelta, 90000, kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+    while (YES) {
+        CQTSMuxFrame *video = self.videoFrames.firstObject;
+        CQTSMuxFrame *audio = self.audioFrames.firstObject;
+        NSMutableArray<CQTSMuxFrame *> *queue = nil;
+        if (video && audio) {
+            queue = video.dts <= audio.dts ? self.videoFrames : self.audioFrames;
+        } else if (video || audio) {
+            NSMutableArray<CQTSMuxFrame *> *pending = video ? self.videoFrames : self.audioFrames;
+            BOOL hasOtherTrack = video ? (self.audioConfig != nil) : (self.videoConfig != nil);
+            if (flushAll || !hasOtherTrack || pending.lastObject.dts - pending.firstObject.dts > maxDelta) {
+                queue = pending;
+            }
+        }
+        if (!queue) break;
+        CQTSMuxFrame *frame = queue.firstObject;
+        [queue removeObjectAtIndex:0];
+        if (queue == self.videoFrames) {
+            [self writeVideoFrame:frame];
+        } else {
+            [self writeAudioFrame:frame];
+        }
+    }
+    [self outputBufferedDataForce:NO];
+}
+
+#pragma mark - Write
+- (void)writeVideoFrame:(CQTSMuxFrame *)frame {
+    [self notifyFrameBoundary:frame isVideo:YES];
+    if (frame.isKeyFrame || !_hasWrittenPSI || _needsPSI) {
+        [self writePSIWithDts:frame.dts];
+    }
+    [self writePESWithPid:kVideoPid streamId:0xE0 frame:frame writePCR:YES];
+}
+
+- (void)writeAudioFrame:(CQTSMuxFrame *)frame {
+    BOOL audioOnly = self.videoConfig == nil;
+    [self notifyFrameBoundary:frame isVideo:NO];
+    if (!_hasWrittenPSI || _needsPSI || (audioOnly && frame.dts - _lastPSIDts >= kPSIInterval)) {
+        [self writePSIWithDts:frame.dts];
+    }
+    [self writePESWithPid:kAudioPid streamId:0xC0 frame:frame writePCR:audioOnly];
+}
+
+/// 帧边界回调，先把缓存的数据输出，保证回调前后的数据分属不同的帧
+- (void)notifyFrameBoundary:(CQTSMuxFrame *)frame isVideo:(BOOL)isVideo {
+    if (!self.delegate || ![self.delegate respondsToSelector:@selector(tsMuxer:willWriteFrameAtTime:isVideo:isKeyFrame:)]) return;
+    [self outputBufferedDataForce:YES];
+    [self.delegate tsMuxer:self willWriteFrameAtTime:CMTimeMake(frame.dts, 90000) isVideo:isVideo isKeyFrame:frame.isKeyFrame];
+}
+
+/// 写入PAT/PMT
+- (void)writePSIWithDts:(int64_t)dts {
+    _hasWrittenPSI = YES;
+    _needsPSI = NO;
+    _lastPSIDts = dts;
+
+    // PAT
+    uint8_t pat[17] = {
+        0x00,  // table_id
+        0xB0, 0x0D,  // section_syntax_indicator=1, section_length=13
+        0x00, 0x01,  // transport_stream_id
+        0xC1,  // version 0, current_next_indicator=1
+        0x00, 0x00,  // section_number, last_section_number
+        0x00, 0x01,  // program_number 1
+        (uint8_t)(0xE0 | (kPMTPid >> 8)), (uint8_t)(kPMTPid & 0xFF),
+    };
+    uint32_t crc = CQTSCRC32(pat, 12);
+    pat[12] = crc >> 24; pat[13] = crc >> 16; pat[14] = crc >> 8; pat[15] = crc;
+    [self writeSection:pat length:16 pid:kPATPid cc:&_patCC];
+
+    // PMT
+    uint16_t pcrPid = self.videoConfig ? kVideoPid : kAudioPid;
+    uint8_t pmt[32];
+    size_t n = 0;
+    pmt[n++] = 0x02;  // table_id
+    n += 2;  // section_length 最后填
+    pmt[n++] = 0x00; pmt[n++] = 0x01;  // program_number
+    pmt[n++] = 0xC1;
+    pmt[n++] = 0x00; pmt[n++] = 0x00;
+    pmt[n++] = 0xE0 | (pcrPid >> 8); pmt[n++] = pcrPid & 0xFF;
+    pmt[n++] = 0xF0; pmt[n++] = 0x00;  // program_info_length 0
+    if (self.videoConfig) {
+        pmt[n++] = self.videoConfig.codec == CQVideoCodecHEVC ? kStreamTypeHEVC : kStreamTypeH264;
+        pmt[n++] = 0xE0 | (kVideoPid >> 8); pmt[n++] = kVideoPid & 0xFF;
+        pmt[n++] = 0xF0; pmt[n++] = 0x00;
+    }
+    if (self.audioConfig) {
+        pmt[n++] = kStreamTypeAAC;
+        pmt[n++] = 0xE0 | (kAudioPid >> 8); pmt[n++] = kAudioPid & 0xFF;
+        pmt[n++] = 0xF0; pmt[n++] = 0x00;
+    }
+    size_t sectionLength = n - 3 + 4;
+    pmt[1] = 0xB0 | ((sectionLength >> 8) & 0x0F);
+    pmt[2] = sectionLength & 0xFF;
+    crc = CQTSCRC32(pmt, n);
+    pmt[n++] = crc >> 24; pmt[n++] = crc >> 16; pmt[n++] = crc >> 8; pmt[n++] = crc;
+    [self writeSection:pmt length:n pid:kPMTPid cc:&_pmtCC];
+}
+
+/// PSI表写入单个TS包
+- (void)writeSection:(const uint8_t *)section length:(size_t)length pid:(uint16_t)pid cc:(uint8_t *)cc {
+    uint8_t *packet = [self appendPacket];
+    packet[0] = 0x47;
+    packet[1] = 0x40 | (pid >> 8);  // payload_unit_start_indicator
+    packet[2] = pid & 0xFF;
+    packet[3] = 0x10 | (*cc & 0x0F);
+    *cc = (*cc + 1) & 0x0F;
+    packet[4] = 0x00;  // pointer_field
+    memcpy(packet + 5, section, length);
+    memset(packet + 5 + length, 0xFF, CQTSPacketSize - 5 - length);
+}
+
+/// 写入时间戳 (pts/dts 5字节)
+static void CQTSWriteTimestamp(uint8_t *p, uint8_t prefix, int64_t ts) {
+    p[0] = (uint8_t)((prefix << 4) | (((ts >> 30) & 0x07) << 1) | 1);
+    p[1] = (uint8_t)(ts >> 22);
+    p[2] = (uint8_t)((((ts >> 15) & 0x7F) << 1) | 1);
+    p[3] = (uint8_t)(ts >> 7);
+    p[4] = (uint8_t)(((ts & 0x7F) << 1) | 1);
+}
+
+/// 将一帧封装为PES并切分为TS包
+- (void)writePESWithPid:(uint16_t)pid streamId:(uint8_t)streamId frame:(CQTSMuxFrame *)frame writePCR:(BOOL)writePCR {
+    int64_t pts = (frame.pts + kTimestampOffset) & 0x1FFFFFFFFLL;
+    int64_t dts = (frame.dts + kTimestampOffset) & 0x1FFFFFFFFLL;
+    BOOL hasDts = pts != dts;
+
+    // PES头
+    uint8_t header[19];
+    size_t headerLength = 0;
+    header[headerLength++] = 0x00;
+    header[headerLength++] = 0x00;
+    header[headerLength++] = 0x01;
+    header[headerLength++] = streamId;
+    size_t pesLength = 3 + (hasDts ? 10 : 5) + frame.payload.length;
+    // 视频PES超过65535时可以写0
+    if (pesLength > 0xFFFF) pesLength = 0;
+    header[headerLength++] = (uint8_t)(pesLength >> 8);
+    header[headerLength++] = (uint8_t)(pesLength & 0xFF);
+    header[headerLength++] = 0x80;  // marker '10'
+    header[headerLength++] = hasDts ? 0xC0 : 0x80;  // PTS_DTS_flags
+    header[headerLength++] = hasDts ? 10 : 5;  // PES_header_data_length
+    CQTSWriteTimestamp(header + headerLength, hasDts ? 0x03 : 0x02, pts);
+    headerLength += 5;
+    if (hasDts) {
+        CQTSWriteTimestamp(header + headerLength, 0x01, dts);
+        headerLength += 5;
+    }
+
+    const uint8_t *payload = frame.payload.bytes;
+    size_t payloadLength = frame.payload.length;
+    size_t total = headerLength + payloadLength;
+    size_t written = 0;
+    uint8_t *cc = pid == kVideoPid ? &_videoCC : &_audioCC;
+    BOOL isFirst = YES;
+    while (written < total) {
+        uint8_t *packet = [self appendPacket];
+        BOOL hasPCR = isFirst && writePCR;
+        BOOL randomAccess = isFirst && frame.isKeyFrame;
+        // 调整字段最小长度: 长度字节 + 标志字节 + PCR
+        size_t minAdaptationLength = (hasPCR || randomAccess) ? (2 + (hasPCR ? 6 : 0)) : 0;
+        size_t copyLength = MIN(total - written, 184 - minAdaptationLength);
+        // 负载不足时，剩余空间都用调整字段填充
+        size_t adaptationLength = 184 - copyLength;
+
+        packet[0] = 0x47;
+        packet[1] = (isFirst ? 0x40 : 0x00) | (pid >> 8);
+        packet[2] = pid & 0xFF;
+        packet[3] = (adaptationLength > 0 ? 0x30 : 0x10) | (*cc & 0x0F);
+        *cc = (*cc + 1) & 0x0F;
+
+        uint8_t *p = packet + 4;
+        if (adaptationLength > 0) {
+            p[0] = (uint8_t)(adaptationLength - 1);
+            if (adaptationLength >= 2) {
+                p[1] = (hasPCR ? 0x10 : 0x00) | (randomAccess ? 0x40 : 0x00);
+                uint8_t *q = p + 2;
+                if (hasPCR) {
+                    int64_t pcr = frame.dts & 0x1FFFFFFFFLL;
+                    q[0] = (uint8_t)(pcr >> 25);
+                    q[1] = (uint8_t)(pcr >> 17);
+                    q[2] = (uint8_t)(pcr >> 9);
+                    q[3] = (uint8_t)(pcr >> 1);
+                    q[4] = (uint8_t)(((pcr & 0x01) << 7) | 0x7E);
+                    q[5] = 0x00;
+                    q += 6;
+                }
+                memset(q, 0xFF, p + adaptationLength - q);
+            }
+            p += adaptationLength;
+        }
+
+        // 先拷贝PES头，再拷贝负载
+        size_t remain = copyLength;
+        if (written < headerLength) {
+            size_t n = MIN(remain, headerLength - written);
+            memcpy(p, header + written, n);
+            p += n;
+            remain -= n;
+            written += n;
+        }
+        if (remain > 0) {
+            memcpy(p, payload + (written - headerLength), remain);
+            written += remain;
+        }
+        isFirst = NO;
+    }
+}
+
+#pragma mark - Output
+/// 在输出缓冲区末尾追加一个TS包
+- (uint8_t *)appendPacket {
+    NSUInteger offset = self.outputBuffer.length;
+    [self.outputBuffer increaseLengthBy:CQTSPacketSize];
+    return (uint8_t *)self.outputBuffer.mutableBytes + offset;
+}
+
+/// 缓冲区达到批量大小时回调
+- (void)outputBufferedDataForce:(BOOL)force {
+    NSUInteger length = self.outputBuffer.length;
+    if (length == 0 || (!force && length < self.outputBatchSize)) return;
+    NSData *data = self.outputBuffer;
+    self.outputBuffer = [NSMutableData dataWithCapacity:self.outputBatchSize + CQTSPacketSize];
+    if (self.delegate && [self.delegate respondsToSelector:@selector(tsMuxer:didOutputTSData:)]) {
+        [self.delegate tsMuxer:self didOutputTSData:data];
+    }
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  CQReplayBuffer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSUInteger, CQReplayFileFormat) {
+    CQReplayFileFormatMP4 = 0,  ///< MP4(AVAssetWriter直通写入)
+    CQReplayFileFormatTS = 1,  ///< MPEG-TS
+};
+
+/**
+ 回放缓存(保存最近N秒)
+ @discussion 在内存里循环缓存编码后的H264帧和AAC帧，随时可以把缓存的内容保存成文件，用于"保存刚才30秒"
+ 数据拷贝到初始化时一次性分配的环形缓冲区，内存上限固定为maxBytes，不随码率变化
+ 空间不够或时长超过maxDuration时，按GOP整组淘汰最旧的数据，缓存总是从带sps/pps的IDR开始
+ 保存在后台队列进行，每次只在锁内拷贝一帧，不阻塞编码回调；保存过程中被淘汰的帧会跳到下一个IDR继续
+ */
+@interface CQReplayBuffer : NSObject
+
+/**
+ 唯一初始化函数
+ @param maxBytes 缓冲区大小(字节)，内存上限
+ @param maxDuration 最多缓存的时长(秒)，按GOP淘汰，实际缓存的时长在maxDuration减一个GOP到maxDuration之间
+ @param videoConfig 视频配置，为nil时只缓存音频
+ @param audioConfig 音频配置，为nil时只缓存视频
+ */
+- (instancetype)initWithMaxBytes:(NSUInteger)maxBytes maxDuration:(NSTimeInterval)maxDuration videoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) NSUInteger maxBytes;  ///< 缓冲区大小
+@property (nonatomic, assign, readonly) NSTimeInterval maxDuration;  ///< 最多缓存的时长
+@property (nonatomic, strong, readonly, nullable) CQVideoCoderConfig *videoConfig;  ///< 视频配置信息
+@property (nonatomic, strong, readonly, nullable) CQAudioCoderConfig *audioConfig;  ///< 音频配置信息
+
+@property (nonatomic, assign, readonly) NSUInteger usedBytes;  ///< 已缓存的数据字节数
+@property (nonatomic, assign, readonly) NSUInteger packetCount;  ///< 已缓存的帧数
+@property (nonatomic, assign, readonly) NSTimeInterval bufferedDuration;  ///< 已缓存的时长
+@property (nonatomic, assign, readonly) NSUInteger droppedCount;  ///< 丢弃的帧数(等待IDR或单帧超过缓冲区大小)
+
+/**
+ 设置sps/pps，之后的每个IDR都会带上
+ @param sps sps数据，Annex-B格式
+ @param pps pps数据，Annex-B格式
+ */
+- (void)setSps:(NSData *)sps pps:(NSData *)pps;
+
+/**
+ 缓存一帧视频(CQVideoEncoder的videoEncoder:didEncodeFrameWithNalus:pts:dts:isKeyFrame:)，线程安全
+ */
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 缓存一帧音频(CQAudioEncoder的audioEncoder:didEncodeRawAACData:pts:)，线程安全
+ */
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts;
+
+/**
+ 把当前缓存的内容保存成文件，缓存继续接收新数据
+ @discussion 只保存调用时已缓存的帧，多次保存依次进行
+ @param path 文件路径，已存在会被覆盖
+ @param format 文件格式
+ @param completionHandler 保存完成后在保存队列回调，error为nil表示成功
+ */
+- (void)saveToPath:(NSString *)path format:(CQReplayFileFormat)format completionHandler:(nullable void (^)(NSError * _Nullable error))completionHandler;
+
+/**
+ 清空缓存，下一帧视频从IDR开始
+ */
+- (void)clear;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,448 @@
+//
+//  CQReplayBuffer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 初始化时分配maxBytes的环形缓冲区和固定个数的帧表，之后不再分配内存，帧数据拷贝进缓冲区，一帧总是连续存放，放不下尾部时回到开头
+ 2 IDR前面拼上当前的sps/pps，每个GOP都可以单独解码
+ 3 空间或帧表不够、时长超过maxDuration时淘汰最旧的整个GOP(到下一个IDR为止，音频一起淘汰)，缓存为空时只接收IDR
+ 4 保存时记下当前的帧序号范围，在保存队列逐帧加锁拷贝出来写入，保存得比淘汰慢时跳到最旧的IDR继续
+ */
+
+#import "CQReplayBuffer.h"
+#import <os/lock.h>
+#import "CQNaluUtil.h"
+#import "CQTSMuxer.h"
+#import "CQMP4Muxer.h"
+#import "CQStreamFileWriter.h"
+
+static const size_t kSaveBatchBytes = 1024 * 1024;  ///< 保存TS时每写入多少数据等待一次封装和写文件，限制保存过程中额外占用的内存
+
+/// 一帧
+typedef struct {
+    uint64_t sequence;  ///< 帧序号，连续递增
+    size_t offset;  ///< 在缓冲区中的位置
+    uint32_t size;
+    uint32_t parameterSetsSize;  ///< IDR开头拼上的sps/pps长度
+    CMTime pts;
+    CMTime dts;
+    BOOL isVideo;
+    BOOL isKeyFrame;
+} CQReplayPacket;
+
+@interface CQReplayBuffer ()<CQTSMuxerDelegate, CQStreamFileWriterDelegate>
+@property (nonatomic, strong) dispatch_queue_t saveQueue;  ///< 保存队列
+@property (nonatomic, strong, nullable) CQStreamFileWriter *saveFileWriter;  ///< 保存TS时的写文件
+@property (nonatomic, strong, nullable) NSError *saveError;  ///< 保存TS时写文件的错误
+@end
+
+@implementation CQReplayBuffer
+{
+    os_unfair_lock _lock;
+    // 以下在锁内访问
+    uint8_t *_buffer;
+    size_t _tail;  ///< 下一帧写入的位置
+    size_t _usedBytes;
+    CQReplayPacket *_packets;  ///< 帧表(环形)
+    NSUInteger _packetCapacity;
+    NSUInteger _first;  ///< 最旧的一帧
+    NSUInteger _count;
+    NSUInteger _gopCount;  ///< 缓存中GOP的个数
+    uint64_t _nextSequence;
+    NSUInteger _droppedCount;
+    NSData *_sps;
+    NSData *_pps;
+}
+
+#pragma mark - Init
+- (instancetype)initWithMaxBytes:(NSUInteger)maxBytes maxDuration:(NSTimeInterval)maxDuration videoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig {
+    if (self = [super init]) {
+        _maxBytes = maxBytes;
+        _maxDuration = maxDuration;
+        _videoConfig = videoConfig;
+        _audioConfig = audioConfig;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _buffer = malloc(MAX(maxBytes, 1));
+        // 帧表按两倍帧率估算，AAC约每秒47帧(48000/1024)，不够时同样按GOP淘汰
+        NSInteger packetsPerSecond = (videoConfig ? MAX(videoConfig.fps, 30) * 2 : 0) + (audioConfig ? 50 : 0);
+        _packetCapacity = (NSUInteger)(MAX(maxDuration, 1) * packetsPerSecond) + 64;
+        _packets = calloc(_packetCapacity, sizeof(CQReplayPacket));
+        _saveQueue = dispatch_queue_create("CQReplayBuffer save queue", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_buffer);
+    free(_packets);
+    NSLog(@"CQReplayBuffer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSUInteger)usedBytes {
+    os_unfair_lock_lock(&_lock);
+    NSUInteger usedBytes = _usedBytes;
+    os_unfair_lock_unlock(&_lock);
+    return usedBytes;
+}
+
+- (NSUInteger)packetCount {
+    os_unfair_lock_lock(&_lock);
+    NSUInteger count = _count;
+    os_unfair_lock_unlock(&_lock);
+    return count;
+}
+
+- (NSTimeInterval)bufferedDuration {
+    os_unfair_lock_lock(&_lock);
+    NSTimeInterval duration = _count > 0 ? [self durationFromFrontToPacket:&_packets[(_first + _count - 1) % _packetCapacity]] : 0;
+    os_unfair_lock_unlock(&_lock);
+    return duration;
+}
+
+- (NSUInteger)droppedCount {
+    os_unfair_lock_lock(&_lock);
+    NSUInteger droppedCount = _droppedCount;
+    os_unfair_lock_unlock(&_lock);
+    return droppedCount;
+}
+
+- (void)setSps:(NSData *)sps pps:(NSData *)pps {
+    os_unfair_lock_lock(&_lock);
+    _sps = [sps copy];
+    _pps = [pps copy];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    if (!self.videoConfig) return;
+    size_t size = 0;
+    BOOL hasSps = NO;
+    for (NSData *naluData in nalus) {
+        size += naluData.length;
+        size_t naluSize = 0;
+        const uint8_t *nalu = CQNaluSkipStartCode(naluData.bytes, naluData.length, &naluSize);
+        if (nalu && naluSize > 0 && CQNaluIsSPS(self.videoConfig.codec, nalu)) hasSps = YES;
+    }
+
+    os_unfair_lock_lock(&_lock);
+    // IDR自己没带sps/pps时拼上当前的sps/pps
+    NSData *sps = (isKeyFrame && !hasSps) ? _sps : nil;
+    NSData *pps = (isKeyFrame && !hasSps) ? _pps : nil;
+    uint32_t parameterSetsSize = (uint32_t)(sps.length + pps.length);
+    CQReplayPacket *packet = [self reservePacketWithSize:size + parameterSetsSize isVideo:YES isKeyFrame:isKeyFrame pts:pts];
+    if (packet) {
+        packet->dts = CMTIME_IS_VALID(dts) ? dts : pts;
+        packet->parameterSetsSize = parameterSetsSize;
+        uint8_t *cursor = _buffer + packet->offset;
+        if (parameterSetsSize > 0) {
+            memcpy(cursor, sps.bytes, sps.length);
+            memcpy(cursor + sps.length, pps.bytes, pps.length);
+            cursor += parameterSetsSize;
+        }
+        for (NSData *naluData in nalus) {
+            memcpy(cursor, naluData.bytes, naluData.length);
+            cursor += naluData.length;
+        }
+        [self trimToMaxDurationWithNewestPacket:packet];
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts {
+    if (!self.audioConfig) return;
+    os_unfair_lock_lock(&_lock);
+    CQReplayPacket *packet = [self reservePacketWithSize:aacData.length isVideo:NO isKeyFrame:YES pts:pts];
+    if (packet) {
+        packet->dts = pts;
+        memcpy(_buffer + packet->offset, aacData.bytes, aacData.length);
+        [self trimToMaxDurationWithNewestPacket:packet];
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)clear {
+    os_unfair_lock_lock(&_lock);
+    while (_count > 0) [self removeFrontPacket];
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)saveToPath:(NSString *)path format:(CQReplayFileFormat)format completionHandler:(void (^)(NSError *))completionHandler {
+    // 只保存调用时已缓存的帧
+    os_unfair_lock_lock(&_lock);
+    uint64_t startSequence = _count > 0 ? _packets[_first].sequence : _nextSequence;
+    uint64_t endSequence = _nextSequence;
+    os_unfair_lock_unlock(&_lock);
+
+    dispatch_async(self.saveQueue, ^{
+        void (^completion)(NSError *) = ^(NSError *error) {
+            if (error) NSLog(@"CQReplayBuffer save failed path=%@ error=%@", path, error);
+            if (completionHandler) completionHandler(error);
+        };
+        if (format == CQReplayFileFormatTS) {
+            [self saveTSToPath:path fromSequence:startSequence toSequence:endSequence completion:completion];
+        } else {
+            [self saveMP4ToPath:path fromSequence:startSequence toSequence:endSequence completion:completion];
+        }
+    });
+}
+
+#pragma mark - Private Func(锁内调用)
+/// 有视频时以IDR为GOP的开始，只有音频时每一帧都可以作为开始
+- (BOOL)isGOPStart:(const CQReplayPacket *)packet {
+    return self.videoConfig ? (packet->isVideo && packet->isKeyFrame) : YES;
+}
+
+- (NSTimeInterval)durationFromFrontToPacket:(const CQReplayPacket *)packet {
+    return CMTimeGetSeconds(CMTimeSubtract(packet->pts, _packets[_first].pts));
+}
+
+/**
+ 在缓冲区中找一段连续的空间
+ @return 放不下返回NO
+ */
+- (BOOL)findSpaceWithSize:(size_t)size offset:(size_t *)offset {
+    if (_count == 0) {
+        *offset = 0;
+        return size <= self.maxBytes;
+    }
+    size_t head = _packets[_first].offset;
+    if (_tail > head) {
+        // 数据在[head, tail)，先看尾部，尾部不够再看开头
+        if (self.maxBytes - _tail >= size) {
+            *offset = _tail;
+            return YES;
+        }
+        if (head >= size) {
+            *offset = 0;
+            return YES;
+        }
+        return NO;
+    }
+    // 已经绕回开头，数据在[head, 末尾)和[0, tail)
+    if (head - _tail >= size) {
+        *offset = _tail;
+        return YES;
+    }
+    return NO;
+}
+
+/**
+ 分配一帧的空间和帧表项，空间不够时按GOP淘汰
+ @return 需要丢弃这一帧时返回NULL
+ */
+- (CQReplayPacket *)reservePacketWithSize:(size_t)size isVideo:(BOOL)isVideo isKeyFrame:(BOOL)isKeyFrame pts:(CMTime)pts {
+    BOOL isGOPStart = self.videoConfig ? (isVideo && isKeyFrame) : YES;
+    if (size == 0 || size > self.maxBytes) {
+        // 单帧比缓冲区还大，这个GOP已经不完整，清空后等下一个IDR
+        _droppedCount++;
+        if (isVideo) {
+            while (_count > 0) [self removeFrontPacket];
+        }
+        return NULL;
+    }
+
+    size_t offset = 0;
+    while (_count > 0 && (_count == _packetCapacity || ![self findSpaceWithSize:size offset:&offset])) {
+        [self removeOldestGOP];
+    }
+    // 缓存为空时(包括刚把当前GOP淘汰掉)只能从IDR开始
+    if (_count == 0) {
+        if (!isGOPStart) {
+            _droppedCount++;
+            return NULL;
+        }
+        [self findSpaceWithSize:size offset:&offset];
+    }
+
+    CQReplayPacket *packet = &_packets[(_first + _count) % _packetCapacity];
+    memset(packet, 0, sizeof(CQReplayPacket));
+    packet->sequence = _nextSequence++;
+    packet->offset = offset;
+    packet->size = (uint32_t)size;
+    packet->pts = pts;
+    packet->isVideo = isVideo;
+    packet->isKeyFrame = isKeyFrame;
+    _count++;
+    _tail = offset + size;
+    _usedBytes += size;
+    if (isGOPStart) _gopCount++;
+    return packet;
+}
+
+/// 超过maxDuration时淘汰最旧的GOP，至少保留一个GOP
+- (void)trimToMaxDurationWithNewestPacket:(const CQReplayPacket *)packet {
+    CQReplayPacket newest = *packet;  // 淘汰不会覆盖最新的帧，拷贝一份只是为了不依赖帧表的位置
+    while (_gopCount > 1 && [self durationFromFrontToPacket:&newest] > self.maxDuration) {
+        [self removeOldestGOP];
+    }
+}
+
+/// 淘汰最旧的一帧，以及到下一个GOP开始之前的所有帧
+- (void)removeOldestGOP {
+    do {
+        [self removeFrontPacket];
+    } while (_count > 0 && ![self isGOPStart:&_packets[_first]]);
+}
+
+- (void)removeFrontPacket {
+    CQReplayPacket *packet = &_packets[_first];
+    _usedBytes -= packet->size;
+    if ([self isGOPStart:packet]) _gopCount--;
+    _first = (_first + 1) % _packetCapacity;
+    _count--;
+    if (_count == 0) {
+        _first = 0;
+        _tail = 0;
+    }
+}
+
+#pragma mark - Private Func(保存队列)
+/**
+ 逐帧拷贝[sequence, endSequence)范围内的帧，每帧只在拷贝时加锁
+ @param block data为帧数据的拷贝
+ */
+- (void)enumeratePacketsFromSequence:(uint64_t)sequence toSequence:(uint64_t)endSequence usingBlock:(void (NS_NOESCAPE ^)(CQReplayPacket packet, NSData *data))block {
+    BOOL needsKeyFrame = NO;
+    while (sequence < endSequence) {
+        CQReplayPacket packet;
+        NSData *data = nil;
+        os_unfair_lock_lock(&_lock);
+        if (_count == 0) {
+            os_unfair_lock_unlock(&_lock);
+            break;
+        }
+        uint64_t frontSequence = _packets[_first].sequence;
+        if (sequence < frontSequence) {
+            // 保存期间被淘汰了，从缓存中最旧的帧(总是IDR)继续
+            sequence = frontSequence;
+            needsKeyFrame = YES;
+        }
+        if (sequence >= endSequence) {
+            os_unfair_lock_unlock(&_lock);
+            break;
+        }
+        packet = _packets[(_first + (NSUInteger)(sequence - frontSequence)) % _packetCapacity];
+        if (!needsKeyFrame || [self isGOPStart:&packet]) {
+            data = [NSData dataWithBytes:_buffer + packet.offset length:packet.size];
+            needsKeyFrame = NO;
+        }
+        os_unfair_lock_unlock(&_lock);
+        sequence++;
+        if (data) block(packet, data);
+    }
+}
+
+/// 拆出IDR开头的sps/pps，HEVC的vps和sps拼在一起(和CQVideoEncoder回调的格式相同)
+- (NSData *)parseParameterSetsOfPacket:(CQReplayPacket)packet data:(NSData *)data sps:(NSData **)sps pps:(NSData **)pps {
+    if (packet.parameterSetsSize == 0) return data;
+    CQVideoCodec codec = self.videoConfig.codec;
+    NSMutableData *spsData = [NSMutableData data];
+    __block NSData *ppsData = nil;
+    CQNaluEnumerateAnnexB(data.bytes, packet.parameterSetsSize, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+        if (CQNaluKindOf(codec, nalu) != CQNaluKindParameterSet) return;
+        BOOL isPps = codec == CQVideoCodecHEVC ? CQHEVCNaluTypeOf(nalu) == CQHEVCNaluTypePPS : CQH264NaluTypeOf(nalu) == CQH264NaluTypePPS;
+        NSMutableData *naluData = isPps ? [NSMutableData dataWithCapacity:naluSize + 4] : spsData;
+        [naluData appendBytes:startCode length:4];
+        [naluData appendBytes:nalu length:naluSize];
+        if (isPps) ppsData = naluData;
+    });
+    *sps = spsData.length > 0 ? spsData : nil;
+    *pps = ppsData;
+    return [data subdataWithRange:NSMakeRange(packet.parameterSetsSize, data.length - packet.parameterSetsSize)];
+}
+
+- (void)saveMP4ToPath:(NSString *)path fromSequence:(uint64_t)startSequence toSequence:(uint64_t)endSequence completion:(void (^)(NSError *))completion {
+    NSError *error = nil;
+    CQMP4Muxer *muxer = [[CQMP4Muxer alloc] initWithPath:path videoConfig:self.videoConfig audioConfig:self.audioConfig error:&error];
+    if (!muxer) {
+        completion(error);
+        return;
+    }
+    __block BOOL hasParameterSets = NO;
+    [self enumeratePacketsFromSequence:startSequence toSequence:endSequence usingBlock:^(CQReplayPacket packet, NSData *data) {
+        if (!packet.isVideo) {
+            [muxer muxAudioData:data pts:packet.pts];
+            return;
+        }
+        NSData *sps = nil, *pps = nil;
+        NSData *frameData = [self parseParameterSetsOfPacket:packet data:data sps:&sps pps:&pps];
+        // MP4只有一个视频格式描述，用第一个IDR的sps/pps
+        if (!hasParameterSets && sps && pps) {
+            [muxer setSps:sps pps:pps];
+            hasParameterSets = YES;
+        }
+        [muxer muxVideoNalus:@[frameData] pts:packet.pts dts:packet.dts isKeyFrame:packet.isKeyFrame];
+    }];
+    [muxer finishWithCompletionHandler:completion];
+}
+
+- (void)saveTSToPath:(NSString *)path fromSequence:(uint64_t)startSequence toSequence:(uint64_t)endSequence completion:(void (^)(NSError *))completion {
+    NSError *error = nil;
+    CQStreamFileWriter *fileWriter = [[CQStreamFileWriter alloc] initWithPath:path error:&error];
+    if (!fileWriter) {
+        completion(error);
+        return;
+    }
+    fileWriter.delegate = self;
+    self.saveFileWriter = fileWriter;
+    self.saveError = nil;
+    CQTSMuxer *muxer = [[CQTSMuxer alloc] initWithVideoConfig:self.videoConfig audioConfig:self.audioConfig];
+    muxer.delegate = self;
+
+    // 封装和写文件都是异步的，每写入一批等它们跟上，保存过程中额外占用的内存不超过几MB
+    void (^waitForWriting)(void) = ^{
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+        [muxer flushWithCompletionHandler:^{
+            dispatch_semaphore_signal(semaphore);
+        }];
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+        while (fileWriter.queuedBytes > kSaveBatchBytes) {
+            usleep(1000);
+        }
+    };
+    __block size_t batchBytes = 0;
+    [self enumeratePacketsFromSequence:startSequence toSequence:endSequence usingBlock:^(CQReplayPacket packet, NSData *data) {
+        if (packet.isVideo) {
+            NSData *sps = nil, *pps = nil;
+            NSData *frameData = [self parseParameterSetsOfPacket:packet data:data sps:&sps pps:&pps];
+            if (sps && pps) [muxer setSps:sps pps:pps];
+            [muxer muxVideoNalus:@[frameData] pts:packet.pts dts:packet.dts isKeyFrame:packet.isKeyFrame];
+        } else {
+            [muxer muxAudioData:data pts:packet.pts];
+        }
+        batchBytes += data.length;
+        if (batchBytes >= kSaveBatchBytes) {
+            waitForWriting();
+            batchBytes = 0;
+        }
+    }];
+    waitForWriting();
+    // 等文件关闭后再开始下一次保存
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [fileWriter closeWithCompletionHandler:^{
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    NSError *saveError = self.saveError;
+    self.saveFileWriter = nil;
+    self.saveError = nil;
+    completion(saveError);
+}
+
+#pragma mark - CQTSMuxerDelegate
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData {
+    [self.saveFileWriter appendData:tsData];
+}
+
+#pragma mark - CQStreamFileWriterDelegate
+- (void)streamFileWriter:(CQStreamFileWriter *)writer didFailWithError:(NSError *)error {
+    self.saveError = error;
+}
+
+@end
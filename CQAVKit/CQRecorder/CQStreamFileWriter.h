@@ -0,0 +1,85 @@
+//
+//  CQStreamFileWriter.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CQStreamFileWriter;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSUInteger, CQStreamFileSyncPolicy) {
+    CQStreamFileSyncPolicyNone = 0,  ///< 不主动同步，由系统决定何时落盘，关闭时同步
+    CQStreamFileSyncPolicyInterval = 1,  ///< 每隔syncInterval同步一次
+    CQStreamFileSyncPolicyEveryBatch = 2,  ///< 每次批量写入后同步，最安全也最慢
+};
+
+@protocol CQStreamFileWriterDelegate <NSObject>
+@optional
+/**
+ 积压状态变化(在写文件队列回调)
+ @discussion 积压超过maxQueuedBytes的3/4时进入积压状态，降到1/4以下时解除，可以据此降低码率或丢弃非关键帧
+ @param isBackpressured 是否积压
+ */
+- (void)streamFileWriter:(CQStreamFileWriter *)writer didChangeBackpressure:(BOOL)isBackpressured;
+
+/**
+ 写文件失败(在写文件队列回调)，之后的数据都会被丢弃
+ @param error 错误信息
+ */
+- (void)streamFileWriter:(CQStreamFileWriter *)writer didFailWithError:(NSError *)error;
+
+@end
+
+/**
+ 异步批量写文件
+ @discussion 编码回调里直接appendData:，只把数据放入无锁MPSC队列(CQMPSCQueue)，不接触文件系统
+ 写文件队列被唤醒后批量取走队列里的所有数据，用writev批量写入，多次唤醒会被合并
+ 数据不拷贝，写入完成前持有NSData
+ */
+@interface CQStreamFileWriter : NSObject
+
+/**
+ 唯一初始化函数，文件已存在会被清空
+ @param path 文件路径
+ @param error 错误信息
+ */
+- (nullable instancetype)initWithPath:(NSString *)path error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *path;  ///< 文件路径
+@property (nonatomic, weak) id<CQStreamFileWriterDelegate> delegate;  ///< 代理
+
+@property (nonatomic, assign) CQStreamFileSyncPolicy syncPolicy;  ///< 同步策略，默认CQStreamFileSyncPolicyNone
+@property (nonatomic, assign) NSTimeInterval syncInterval;  ///< CQStreamFileSyncPolicyInterval的同步间隔，默认1秒
+@property (nonatomic, assign) NSUInteger preallocateSize;  ///< 每次预分配的磁盘空间，默认8MB，0为不预分配
+@property (nonatomic, assign) NSUInteger maxQueuedBytes;  ///< 最多积压的字节数，超过后appendData:丢弃数据，默认32MB
+
+@property (nonatomic, assign, readonly) NSUInteger queuedBytes;  ///< 当前积压的字节数
+@property (nonatomic, assign, readonly) uint64_t writtenBytes;  ///< 已写入的字节数
+@property (nonatomic, assign, readonly) NSUInteger droppedCount;  ///< 因积压或出错丢弃的数据个数
+@property (nonatomic, assign, readonly) BOOL isBackpressured;  ///< 是否积压
+@property (nonatomic, assign, readonly) uint64_t writevCount;  ///< writev调用次数，和追加的数据个数对比可以看出合并的效果
+@property (nonatomic, assign, readonly) uint64_t syncCount;  ///< 同步落盘的次数，包括关闭时的同步
+
+/**
+ 追加数据，线程安全，可以在任意线程调用，不会阻塞
+ @param data 数据，写入完成前不能修改
+ @return 积压超过maxQueuedBytes或8192个、已关闭或已出错时丢弃数据并返回NO
+ */
+- (BOOL)appendData:(NSData *)data;
+
+/**
+ 写完所有数据后关闭文件，之后的appendData:都会被丢弃
+ @param completionHandler 关闭后在写文件队列回调
+ */
+- (void)closeWithCompletionHandler:(nullable void (^)(void))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,302 @@
+//
+//  CQStreamFileWriter.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 生产者(编码回调)把数据放入有界无锁MPSC队列，积压字节数原子累加，然后merge一次GCD DATA_ADD事件源
+ 2 DATA_ADD事件源会合并多次唤醒，写文件队列每次被唤醒按kMaxIOVecCount个一组批量取出，直到队列为空
+ 3 每组调用一次writev，处理部分写入
+ 4 写入前按preallocateSize分块预分配磁盘空间，减少文件扩展时的元数据更新
+ */
+
+#import "CQStreamFileWriter.h"
+#import "CQPacketQueue.h"
+#import <QuartzCore/QuartzCore.h>
+#import <stdatomic.h>
+#import <sys/uio.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+static const int kMaxIOVecCount = 256;  ///< 一次writev最多的数据块数
+static const NSUInteger kQueueCapacity = 8192;  ///< 最多积压的数据个数
+
+@interface CQStreamFileWriter ()
+@property (nonatomic, strong) dispatch_queue_t writeQueue;  ///< 写文件队列
+@property (nonatomic, strong) CQMPSCQueue<NSData *> *queue;  ///< 待写入的数据
+@property (nonatomic, strong) NSMutableArray<NSData *> *writingBatch;  ///< 正在写入的一组数据，writev完成前持有
+@property (nonatomic, strong) dispatch_source_t wakeupSource;  ///< 唤醒事件源，多次唤醒会合并
+@property (nonatomic, strong, nullable) dispatch_source_t syncTimer;  ///< 定时同步
+@end
+
+@implementation CQStreamFileWriter
+{
+    atomic_size_t _queuedBytes;
+    atomic_size_t _droppedCount;
+    atomic_bool _isBackpressured;
+    atomic_bool _isClosed;
+    _Atomic(uint64_t) _writtenBytes;  ///< 只在写文件队列修改
+    _Atomic(uint64_t) _writevCount;  ///< 只在写文件队列修改
+    _Atomic(uint64_t) _syncCount;  ///< 只在写文件队列修改
+    // 以下只在写文件队列访问
+    int _fd;
+    uint64_t _allocatedBytes;  ///< 已预分配到的文件长度
+    BOOL _isDirty;  ///< 有未同步的数据
+    BOOL _hasFailed;
+    CFTimeInterval _lastSyncTime;
+}
+
+#pragma mark - Init
+- (instancetype)initWithPath:(NSString *)path error:(NSError **)error {
+    if (self = [super init]) {
+        _path = [path copy];
+        _fd = open(path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (_fd < 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            return nil;
+        }
+        _syncInterval = 1;
+        _preallocateSize = 8 * 1024 * 1024;
+        _maxQueuedBytes = 32 * 1024 * 1024;
+        _queue = [[CQMPSCQueue alloc] initWithCapacity:kQueueCapacity];
+        if (!_queue) {
+            close(_fd);
+            _fd = -1;
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+            return nil;
+        }
+        _writingBatch = [NSMutableArray arrayWithCapacity:kMaxIOVecCount];
+        atomic_init(&_queuedBytes, 0);
+        atomic_init(&_droppedCount, 0);
+        atomic_init(&_isBackpressured, false);
+        atomic_init(&_isClosed, false);
+        atomic_init(&_writtenBytes, 0);
+        atomic_init(&_writevCount, 0);
+        atomic_init(&_syncCount, 0);
+        _lastSyncTime = CACurrentMediaTime();
+
+        _writeQueue = dispatch_queue_create("CQStreamFileWriter write queue", DISPATCH_QUEUE_SERIAL);
+        _wakeupSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, _writeQueue);
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(_wakeupSource, ^{
+            [weakSelf drainQueue];
+        });
+        dispatch_resume(_wakeupSource);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // 初始化失败时还没有创建
+    if (_wakeupSource) dispatch_source_cancel(_wakeupSource);
+    if (_syncTimer) dispatch_source_cancel(_syncTimer);
+    // 没有关闭就释放时，丢弃还没写的数据(随队列一起释放)
+    if (_fd >= 0) close(_fd);
+    NSLog(@"CQStreamFileWriter - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSUInteger)queuedBytes {
+    return atomic_load(&_queuedBytes);
+}
+
+- (uint64_t)writtenBytes {
+    return atomic_load(&_writtenBytes);
+}
+
+- (NSUInteger)droppedCount {
+    return atomic_load(&_droppedCount);
+}
+
+- (BOOL)isBackpressured {
+    return atomic_load(&_isBackpressured);
+}
+
+- (uint64_t)writevCount {
+    return atomic_load(&_writevCount);
+}
+
+- (uint64_t)syncCount {
+    return atomic_load(&_syncCount);
+}
+
+- (BOOL)appendData:(NSData *)data {
+    if (data.length == 0) return YES;
+    if (atomic_load(&_isClosed)) {
+        atomic_fetch_add(&_droppedCount, 1);
+        return NO;
+    }
+    size_t queued = atomic_fetch_add(&_queuedBytes, data.length) + data.length;
+    if (queued > self.maxQueuedBytes) {
+        atomic_fetch_sub(&_queuedBytes, data.length);
+        atomic_fetch_add(&_droppedCount, 1);
+        return NO;
+    }
+
+    if (![self.queue push:data]) {
+        atomic_fetch_sub(&_queuedBytes, data.length);
+        atomic_fetch_add(&_droppedCount, 1);
+        return NO;
+    }
+    dispatch_source_merge_data(self.wakeupSource, 1);
+
+    // 只在状态变化时派发回调
+    if (queued > self.maxQueuedBytes / 4 * 3 && !atomic_exchange(&_isBackpressured, true)) {
+        [self notifyBackpressure:YES];
+    }
+    return YES;
+}
+
+- (void)closeWithCompletionHandler:(void (^)(void))completionHandler {
+    atomic_store(&_isClosed, true);
+    dispatch_async(self.writeQueue, ^{
+        [self drainQueue];
+        if (self->_fd >= 0) {
+            // 关闭时总是同步，F_FULLFSYNC要求磁盘也把缓存写入介质
+            if (fcntl(self->_fd, F_FULLFSYNC) == -1) fsync(self->_fd);
+            atomic_fetch_add(&self->_syncCount, 1);
+            close(self->_fd);
+            self->_fd = -1;
+        }
+        if (self.syncTimer) {
+            dispatch_source_cancel(self.syncTimer);
+            self.syncTimer = nil;
+        }
+        if (completionHandler) completionHandler();
+    });
+}
+
+#pragma mark - Private Func(写文件队列)
+/// 取走队列里的所有数据批量写入
+- (void)drainQueue {
+    struct iovec iov[kMaxIOVecCount];
+    struct iovec *iovPointer = iov;
+    NSMutableArray<NSData *> *batch = self.writingBatch;
+    while (YES) {
+        __block int count = 0;
+        __block size_t batchBytes = 0;
+        [self.queue popBatchWithMaxCount:kMaxIOVecCount usingBlock:^(NSData *data) {
+            iovPointer[count].iov_base = (void *)data.bytes;
+            iovPointer[count].iov_len = data.length;
+            batchBytes += data.length;
+            count++;
+            [batch addObject:data];
+        }];
+        if (count == 0) break;
+        if (!_hasFailed && _fd >= 0) {
+            [self preallocateForBytes:batchBytes];
+            [self writeIOVec:iov count:count];
+        } else {
+            atomic_fetch_add(&_droppedCount, count);
+        }
+        // 写完释放这一组数据
+        [batch removeAllObjects];
+        atomic_fetch_sub(&_queuedBytes, batchBytes);
+    }
+
+    [self syncIfNeeded];
+    if (atomic_load(&_queuedBytes) < self.maxQueuedBytes / 4 && atomic_exchange(&_isBackpressured, false)) {
+        [self notifyBackpressure:NO];
+    }
+}
+
+/// writev写入，处理部分写入
+- (void)writeIOVec:(struct iovec *)iov count:(int)count {
+    while (count > 0) {
+        ssize_t written = writev(_fd, iov, count);
+        atomic_fetch_add(&_writevCount, 1);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            [self failWithError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+            return;
+        }
+        atomic_fetch_add(&_writtenBytes, written);
+        _isDirty = YES;
+        // 跳过已经写完的块，调整写了一部分的块
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+/// 剩余的预分配空间不够时再分配一块
+- (void)preallocateForBytes:(size_t)bytes {
+    uint64_t writtenBytes = atomic_load(&_writtenBytes);
+    if (self.preallocateSize == 0 || writtenBytes + bytes <= _allocatedBytes) return;
+    off_t length = (off_t)MAX(self.preallocateSize, bytes);
+    // F_PREALLOCATE只分配磁盘空间，不改变文件长度
+    fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, length, 0};
+    if (fcntl(_fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(_fd, F_PREALLOCATE, &store) == -1) return;
+    }
+    _allocatedBytes = MAX(_allocatedBytes, writtenBytes) + store.fst_bytesalloc;
+}
+
+- (void)syncIfNeeded {
+    if (!_isDirty || _fd < 0) return;
+    switch (self.syncPolicy) {
+        case CQStreamFileSyncPolicyEveryBatch:
+            [self syncFile];
+            break;
+        case CQStreamFileSyncPolicyInterval:
+            if (CACurrentMediaTime() - _lastSyncTime >= self.syncInterval) {
+                [self syncFile];
+            } else {
+                [self startSyncTimerIfNeeded];
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/// 之后没有新数据时，由定时器保证最后一批数据也按间隔同步
+- (void)startSyncTimerIfNeeded {
+    if (self.syncTimer) return;
+    self.syncTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.writeQueue);
+    uint64_t interval = (uint64_t)(MAX(self.syncInterval, 0.01) * NSEC_PER_SEC);
+    dispatch_source_set_timer(self.syncTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(self.syncTimer, ^{
+        [weakSelf syncFile];
+    });
+    dispatch_resume(self.syncTimer);
+}
+
+- (void)syncFile {
+    if (!_isDirty || _fd < 0) return;
+    fsync(_fd);
+    atomic_fetch_add(&_syncCount, 1);
+    _isDirty = NO;
+    _lastSyncTime = CACurrentMediaTime();
+}
+
+- (void)failWithError:(NSError *)error {
+    _hasFailed = YES;
+    NSLog(@"CQStreamFileWriter write failed error=%@", error);
+    if (self.delegate && [self.delegate respondsToSelector:@selector(streamFileWriter:didFailWithError:)]) {
+        [self.delegate streamFileWriter:self didFailWithError:error];
+    }
+}
+
+- (void)notifyBackpressure:(BOOL)isBackpressured {
+    __weak typeof(self) weakSelf = self;
+    dispatch_async(self.writeQueue, ^{
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        if (strongSelf.delegate && [strongSelf.delegate respondsToSelector:@selector(streamFileWriter:didChangeBackpressure:)]) {
+            [strongSelf.delegate streamFileWriter:strongSelf didChangeBackpressure:isBackpressured];
+        }
+    });
+}
+
+@end
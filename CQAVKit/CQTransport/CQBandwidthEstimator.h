@@ -0,0 +1,64 @@
+//
+//  CQBandwidthEstimator.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ 带宽估计(纯C，时间由调用方传入)
+ @discussion 基于延迟的估计，思路同WebRTC GCC:
+ 1 发送时间5ms以内的包合成一组，相邻两组的(到达间隔 - 发送间隔)是排队时延的变化
+ 2 累计时延指数平滑后，对最近20组做线性回归，斜率>0说明瓶颈队列在变长
+ 3 斜率乘增益和自适应阈值比较，得到过载/正常/欠载
+ 4 AIMD: 过载时降到接收速率的0.85倍；正常时乘性增加(每秒8%)，接近上次过载时的速率后改为加性增加
+ 另外按丢包率限制: 丢包>10%时按丢包率降低，<2%时不限制
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 链路状态
+typedef NS_ENUM(NSUInteger, CQBandwidthUsage) {
+    CQBandwidthUsageNormal = 0,  ///< 正常
+    CQBandwidthUsageUnderusing = 1,  ///< 欠载，队列在变短
+    CQBandwidthUsageOverusing = 2,  ///< 过载，队列在变长
+};
+
+/// 一个包的反馈
+typedef struct {
+    uint64_t sendTimeUs;  ///< 发送时间(发送端时钟)
+    uint64_t arrivalTimeUs;  ///< 到达时间(接收端时钟)，0为丢失
+    uint32_t size;  ///< 字节数
+} CQPacketFeedback;
+
+typedef struct CQBandwidthEstimator CQBandwidthEstimator;
+
+/**
+ 创建
+ @param startBitrate 初始码率(bps)
+ @param minBitrate 最小码率
+ @param maxBitrate 最大码率
+ */
+FOUNDATION_EXPORT CQBandwidthEstimator *CQBandwidthEstimatorCreate(uint64_t startBitrate, uint64_t minBitrate, uint64_t maxBitrate);
+FOUNDATION_EXPORT void CQBandwidthEstimatorDestroy(CQBandwidthEstimator *estimator);
+
+/**
+ 输入一批反馈
+ @param packets 反馈，按发送顺序排列
+ @param count 个数
+ @param nowUs 当前时间(发送端时钟)
+ */
+FOUNDATION_EXPORT void CQBandwidthEstimatorOnFeedback(CQBandwidthEstimator *estimator, const CQPacketFeedback *packets, size_t count, uint64_t nowUs);
+
+/// 目标码率(bps)
+FOUNDATION_EXPORT uint64_t CQBandwidthEstimatorTargetBitrate(const CQBandwidthEstimator *estimator);
+/// 接收端实际收到的码率(bps)，还没有估计出来时为0
+FOUNDATION_EXPORT uint64_t CQBandwidthEstimatorAckedBitrate(const CQBandwidthEstimator *estimator);
+/// 当前链路状态
+FOUNDATION_EXPORT CQBandwidthUsage CQBandwidthEstimatorUsage(const CQBandwidthEstimator *estimator);
+/// 平滑后的丢包率 0~1
+FOUNDATION_EXPORT double CQBandwidthEstimatorLossRate(const CQBandwidthEstimator *estimator);
+
+NS_ASSUME_NONNULL_END
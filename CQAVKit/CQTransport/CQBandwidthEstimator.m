@@ -0,0 +1,304 @@
+//
+//  CQBandwidthEstimator.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 包组: 发送时间跨度5ms以内的包算一组(编码器一帧的包经过平滑发送后基本在一组)，组的时间取最后一个包
+ 2 趋势线: 每完成一组，时延变化累加后平滑，窗口满20组后做最小二乘得到斜率
+ 3 检测: 斜率 x min(组数,60) x 4 和阈值比较，连续过载超过10ms才判定过载，阈值随信号自适应(6~600)，
+   避免和TCP等其他流竞争时一直判定过载被饿死
+ 4 码率: 过载降到接收速率x0.85(每200ms最多降一次)，并记下链路容量；正常时增加，离容量远乘性，近了加性；
+   不超过接收速率x1.5，防止没有真实吞吐支撑的虚高
+ 5 丢包: 平滑丢包率>10%时按 (1 - 0.5 x 丢包率) 降低，2%~10%之间不增加
+ */
+
+#import "CQBandwidthEstimator.h"
+#import <math.h>
+#import <stdlib.h>
+
+static const uint64_t kBurstIntervalUs = 5000;  ///< 包组的发送时间跨度
+#define kTrendlineWindowSize 20  ///< 线性回归的组数
+static const double kTrendlineSmoothing = 0.9;  ///< 累计时延的平滑系数
+static const double kTrendlineGain = 4.0;  ///< 斜率增益
+static const double kOverusingTimeThresholdMs = 10;  ///< 持续过载时长
+static const double kThresholdUp = 0.0087;  ///< 阈值上调速度
+static const double kThresholdDown = 0.039;  ///< 阈值下调速度
+static const uint64_t kResponseTimeUs = 200000;  ///< 两次降码率的最小间隔(约一个RTT+处理时间)
+static const double kBeta = 0.85;  ///< 过载时降到接收速率的倍数
+static const double kMultiplicativeIncrease = 1.08;  ///< 每秒乘性增加
+static const double kAdditiveIncreaseBps = 50000;  ///< 接近容量时每秒加性增加
+static const uint64_t kAckedWindowUs = 500000;  ///< 接收速率统计窗口
+
+/// 码率控制状态
+typedef NS_ENUM(NSUInteger, CQRateControlState) {
+    CQRateControlStateHold = 0,
+    CQRateControlStateIncrease = 1,
+    CQRateControlStateDecrease = 2,
+};
+
+/// 包组
+typedef struct {
+    uint64_t firstSendUs;
+    uint64_t lastSendUs;
+    uint64_t lastArrivalUs;
+} CQPacketGroup;
+
+struct CQBandwidthEstimator {
+    double minBitrate;
+    double maxBitrate;
+    double targetBitrate;
+    // 包组
+    CQPacketGroup currentGroup;
+    CQPacketGroup previousGroup;
+    BOOL hasCurrentGroup;
+    BOOL hasPreviousGroup;
+    // 趋势线
+    double accumulatedDelayMs;
+    double smoothedDelayMs;
+    double windowX[kTrendlineWindowSize];
+    double windowY[kTrendlineWindowSize];
+    size_t windowCount;
+    size_t windowIndex;
+    uint64_t firstArrivalUs;
+    size_t deltaCount;
+    double previousTrend;
+    // 检测
+    double threshold;
+    uint64_t lastThresholdUpdateUs;
+    double timeOverUsingMs;
+    int overuseCount;
+    CQBandwidthUsage usage;
+    // 码率控制
+    CQRateControlState state;
+    uint64_t lastRateUpdateUs;
+    uint64_t lastDecreaseUs;
+    double linkCapacity;  ///< 过载时的接收速率，0为未知
+    // 接收速率
+    uint64_t ackedWindowStartUs;
+    uint64_t ackedWindowBytes;
+    double ackedBitrate;
+    // 丢包
+    double lossRate;
+    uint64_t lastLossDecreaseUs;
+};
+
+#pragma mark - Private Func
+static double CQTrendlineSlope(const CQBandwidthEstimator *estimator) {
+    double sumX = 0, sumY = 0;
+    for (size_t i = 0; i < kTrendlineWindowSize; i++) {
+        sumX += estimator->windowX[i];
+        sumY += estimator->windowY[i];
+    }
+    double meanX = sumX / kTrendlineWindowSize, meanY = sumY / kTrendlineWindowSize;
+    double numerator = 0, denominator = 0;
+    for (size_t i = 0; i < kTrendlineWindowSize; i++) {
+        double dx = estimator->windowX[i] - meanX;
+        numerator += dx * (estimator->windowY[i] - meanY);
+        denominator += dx * dx;
+    }
+    return denominator > 0 ? numerator / denominator : estimator->previousTrend;
+}
+
+static void CQBandwidthEstimatorUpdateThreshold(CQBandwidthEstimator *estimator, double modifiedTrend, uint64_t nowUs) {
+    if (estimator->lastThresholdUpdateUs == 0) estimator->lastThresholdUpdateUs = nowUs;
+    double absTrend = fabs(modifiedTrend);
+    // 突变(例如路由切换)不参与阈值调整
+    if (absTrend > estimator->threshold + 15) {
+        estimator->lastThresholdUpdateUs = nowUs;
+        return;
+    }
+    double k = absTrend < estimator->threshold ? kThresholdDown : kThresholdUp;
+    double dtMs = fmin((double)(nowUs - estimator->lastThresholdUpdateUs) / 1000.0, 100);
+    estimator->threshold += k * (absTrend - estimator->threshold) * dtMs;
+    estimator->threshold = fmin(fmax(estimator->threshold, 6), 600);
+    estimator->lastThresholdUpdateUs = nowUs;
+}
+
+static void CQBandwidthEstimatorDetect(CQBandwidthEstimator *estimator, double trend, double sendDeltaMs, uint64_t nowUs) {
+    double modifiedTrend = (double)MIN(estimator->deltaCount, (size_t)60) * trend * kTrendlineGain;
+    if (modifiedTrend > estimator->threshold) {
+        if (estimator->timeOverUsingMs < 0) {
+            estimator->timeOverUsingMs = sendDeltaMs / 2;
+        } else {
+            estimator->timeOverUsingMs += sendDeltaMs;
+        }
+        estimator->overuseCount++;
+        if (estimator->timeOverUsingMs > kOverusingTimeThresholdMs && estimator->overuseCount > 1 && trend >= estimator->previousTrend) {
+            estimator->timeOverUsingMs = 0;
+            estimator->overuseCount = 0;
+            estimator->usage = CQBandwidthUsageOverusing;
+        }
+    } else if (modifiedTrend < -estimator->threshold) {
+        estimator->timeOverUsingMs = -1;
+        estimator->overuseCount = 0;
+        estimator->usage = CQBandwidthUsageUnderusing;
+    } else {
+        estimator->timeOverUsingMs = -1;
+        estimator->overuseCount = 0;
+        estimator->usage = CQBandwidthUsageNormal;
+    }
+    estimator->previousTrend = trend;
+    CQBandwidthEstimatorUpdateThreshold(estimator, modifiedTrend, nowUs);
+}
+
+/// 一组完成，和上一组比较
+static void CQBandwidthEstimatorOnGroupComplete(CQBandwidthEstimator *estimator, uint64_t nowUs) {
+    CQPacketGroup current = estimator->currentGroup;
+    if (!estimator->hasPreviousGroup) {
+        estimator->previousGroup = current;
+        estimator->hasPreviousGroup = YES;
+        estimator->firstArrivalUs = current.lastArrivalUs;
+        return;
+    }
+    CQPacketGroup previous = estimator->previousGroup;
+    estimator->previousGroup = current;
+    double sendDeltaMs = ((double)current.lastSendUs - (double)previous.lastSendUs) / 1000.0;
+    double arrivalDeltaMs = ((double)current.lastArrivalUs - (double)previous.lastArrivalUs) / 1000.0;
+    double delayDeltaMs = arrivalDeltaMs - sendDeltaMs;
+
+    estimator->deltaCount = MIN(estimator->deltaCount + 1, (size_t)1000);
+    estimator->accumulatedDelayMs += delayDeltaMs;
+    estimator->smoothedDelayMs = kTrendlineSmoothing * estimator->smoothedDelayMs + (1 - kTrendlineSmoothing) * estimator->accumulatedDelayMs;
+    estimator->windowX[estimator->windowIndex] = ((double)current.lastArrivalUs - (double)estimator->firstArrivalUs) / 1000.0;
+    estimator->windowY[estimator->windowIndex] = estimator->smoothedDelayMs;
+    estimator->windowIndex = (estimator->windowIndex + 1) % kTrendlineWindowSize;
+    estimator->windowCount = MIN(estimator->windowCount + 1, (size_t)kTrendlineWindowSize);
+
+    double trend = estimator->previousTrend;
+    if (estimator->windowCount == kTrendlineWindowSize) {
+        trend = CQTrendlineSlope(estimator);
+    }
+    CQBandwidthEstimatorDetect(estimator, trend, sendDeltaMs, nowUs);
+}
+
+static void CQBandwidthEstimatorOnReceivedPacket(CQBandwidthEstimator *estimator, const CQPacketFeedback *packet, uint64_t nowUs) {
+    // 接收速率
+    if (estimator->ackedWindowStartUs == 0) estimator->ackedWindowStartUs = packet->arrivalTimeUs;
+    estimator->ackedWindowBytes += packet->size;
+    if (packet->arrivalTimeUs > estimator->ackedWindowStartUs + kAckedWindowUs) {
+        double sample = (double)estimator->ackedWindowBytes * 8 * 1000000 / (double)(packet->arrivalTimeUs - estimator->ackedWindowStartUs);
+        estimator->ackedBitrate = estimator->ackedBitrate > 0 ? 0.5 * estimator->ackedBitrate + 0.5 * sample : sample;
+        estimator->ackedWindowStartUs = packet->arrivalTimeUs;
+        estimator->ackedWindowBytes = 0;
+    }
+
+    // 包组
+    if (!estimator->hasCurrentGroup) {
+        estimator->currentGroup = (CQPacketGroup){packet->sendTimeUs, packet->sendTimeUs, packet->arrivalTimeUs};
+        estimator->hasCurrentGroup = YES;
+        return;
+    }
+    // 比当前组还早发送的(重排序)忽略
+    if (packet->sendTimeUs < estimator->currentGroup.firstSendUs) return;
+    if (packet->sendTimeUs - estimator->currentGroup.firstSendUs > kBurstIntervalUs) {
+        CQBandwidthEstimatorOnGroupComplete(estimator, nowUs);
+        estimator->currentGroup = (CQPacketGroup){packet->sendTimeUs, packet->sendTimeUs, packet->arrivalTimeUs};
+        return;
+    }
+    estimator->currentGroup.lastSendUs = MAX(estimator->currentGroup.lastSendUs, packet->sendTimeUs);
+    estimator->currentGroup.lastArrivalUs = MAX(estimator->currentGroup.lastArrivalUs, packet->arrivalTimeUs);
+}
+
+static void CQBandwidthEstimatorUpdateRate(CQBandwidthEstimator *estimator, uint64_t nowUs) {
+    switch (estimator->usage) {
+        case CQBandwidthUsageOverusing:
+            estimator->state = CQRateControlStateDecrease;
+            break;
+        case CQBandwidthUsageUnderusing:
+            estimator->state = CQRateControlStateHold;
+            break;
+        case CQBandwidthUsageNormal:
+            estimator->state = CQRateControlStateIncrease;
+            break;
+    }
+    if (estimator->lastRateUpdateUs == 0) estimator->lastRateUpdateUs = nowUs;
+    double dtSec = fmin((double)(nowUs - estimator->lastRateUpdateUs) / 1000000.0, 1.0);
+    estimator->lastRateUpdateUs = nowUs;
+    double acked = estimator->ackedBitrate;
+
+    switch (estimator->state) {
+        case CQRateControlStateIncrease: {
+            if (estimator->lossRate > 0.02) break;
+            // 超过上次过载时的速率很多，说明链路变好了，容量重新未知
+            if (estimator->linkCapacity > 0 && acked > estimator->linkCapacity * 1.5) estimator->linkCapacity = 0;
+            BOOL isNearCapacity = estimator->linkCapacity > 0 && estimator->targetBitrate > estimator->linkCapacity * 0.9;
+            if (isNearCapacity) {
+                estimator->targetBitrate += kAdditiveIncreaseBps * dtSec;
+            } else {
+                estimator->targetBitrate *= pow(kMultiplicativeIncrease, dtSec);
+            }
+            if (acked > 0) estimator->targetBitrate = fmin(estimator->targetBitrate, acked * 1.5 + 10000);
+            break;
+        }
+        case CQRateControlStateDecrease: {
+            if (nowUs - estimator->lastDecreaseUs < kResponseTimeUs && estimator->lastDecreaseUs != 0) break;
+            double decreased = (acked > 0 ? acked : estimator->targetBitrate) * kBeta;
+            if (decreased < estimator->targetBitrate) estimator->targetBitrate = decreased;
+            if (acked > 0) estimator->linkCapacity = estimator->linkCapacity > 0 ? 0.95 * estimator->linkCapacity + 0.05 * acked : acked;
+            estimator->lastDecreaseUs = nowUs;
+            estimator->state = CQRateControlStateHold;
+            break;
+        }
+        case CQRateControlStateHold:
+            break;
+    }
+
+    // 丢包
+    if (estimator->lossRate > 0.1 && nowUs - estimator->lastLossDecreaseUs >= kResponseTimeUs + 100000) {
+        estimator->targetBitrate *= 1 - 0.5 * estimator->lossRate;
+        estimator->lastLossDecreaseUs = nowUs;
+    }
+    estimator->targetBitrate = fmin(fmax(estimator->targetBitrate, estimator->minBitrate), estimator->maxBitrate);
+}
+
+#pragma mark - Public Func
+CQBandwidthEstimator *CQBandwidthEstimatorCreate(uint64_t startBitrate, uint64_t minBitrate, uint64_t maxBitrate) {
+    CQBandwidthEstimator *estimator = calloc(1, sizeof(CQBandwidthEstimator));
+    estimator->minBitrate = (double)minBitrate;
+    estimator->maxBitrate = (double)maxBitrate;
+    estimator->targetBitrate = fmin(fmax((double)startBitrate, estimator->minBitrate), estimator->maxBitrate);
+    estimator->threshold = 12.5;
+    estimator->timeOverUsingMs = -1;
+    estimator->usage = CQBandwidthUsageNormal;
+    estimator->state = CQRateControlStateIncrease;
+    return estimator;
+}
+
+void CQBandwidthEstimatorDestroy(CQBandwidthEstimator *estimator) {
+    free(estimator);
+}
+
+void CQBandwidthEstimatorOnFeedback(CQBandwidthEstimator *estimator, const CQPacketFeedback *packets, size_t count, uint64_t nowUs) {
+    if (count == 0) return;
+    size_t lostCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (packets[i].arrivalTimeUs == 0) {
+            lostCount++;
+            continue;
+        }
+        CQBandwidthEstimatorOnReceivedPacket(estimator, &packets[i], nowUs);
+    }
+    double batchLoss = (double)lostCount / (double)count;
+    estimator->lossRate = 0.7 * estimator->lossRate + 0.3 * batchLoss;
+    CQBandwidthEstimatorUpdateRate(estimator, nowUs);
+}
+
+uint64_t CQBandwidthEstimatorTargetBitrate(const CQBandwidthEstimator *estimator) {
+    return (uint64_t)estimator->targetBitrate;
+}
+
+uint64_t CQBandwidthEstimatorAckedBitrate(const CQBandwidthEstimator *estimator) {
+    return (uint64_t)estimator->ackedBitrate;
+}
+
+CQBandwidthUsage CQBandwidthEstimatorUsage(const CQBandwidthEstimator *estimator) {
+    return estimator->usage;
+}
+
+double CQBandwidthEstimatorLossRate(const CQBandwidthEstimator *estimator) {
+    return estimator->lossRate;
+}
@@ -0,0 +1,80 @@
+//
+//  CQCongestionController.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQCoderConfig.h"
+#import "CQRTPPacketizer.h"
+
+@class CQCongestionController, CQVideoEncoder, CQAudioEncoder, CQPacketPacer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 码率阶梯的一级
+typedef struct {
+    NSInteger width;  ///< 宽
+    NSInteger height;  ///< 高
+    NSInteger fps;  ///< 帧率
+    NSInteger minBitrate;  ///< 视频码率不低于该值时可以使用这一级
+} CQVideoLadderStep;
+
+@protocol CQCongestionControllerDelegate <NSObject>
+@optional
+/**
+ 目标码率变化(在收到反馈的线程回调)
+ @param targetBitrate 总码率
+ @param videoBitrate 分配给视频的码率
+ @param audioBitrate 分配给音频的码率
+ */
+- (void)congestionController:(CQCongestionController *)controller didUpdateTargetBitrate:(NSUInteger)targetBitrate videoBitrate:(NSUInteger)videoBitrate audioBitrate:(NSUInteger)audioBitrate;
+
+/// 切换了码率阶梯
+- (void)congestionController:(CQCongestionController *)controller didSwitchLadderStep:(CQVideoLadderStep)step;
+
+@end
+
+/**
+ 拥塞控制(发送端)
+ @discussion 记录每个视频RTP包的发送时间，收到接收端的反馈(CQTransportFeedbackGenerator)后交给CQBandwidthEstimator，
+ 反馈只有视频包，估计出的是视频码率，音频码率按视频码率选择后另外加上，总码率设置到平滑发送器，并按码率阶梯切换分辨率/帧率
+ 码率阶梯由视频配置按比例生成: 原始分辨率 / 0.75 / 0.5 / 0.5且半帧率，降级立即切换，升级需要码率超过上一级25%并持续5秒
+ 线程安全
+ */
+@interface CQCongestionController : NSObject
+
+/**
+ 唯一初始化函数
+ @param videoConfig 视频配置，码率为视频上限(也是带宽估计的上限)，分辨率和帧率为阶梯最高一级
+ @param audioConfig 音频配置，码率为音频上限
+ @param videoSSRC 视频RTP的SSRC，反馈只针对视频
+ */
+- (instancetype)initWithVideoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig videoSSRC:(uint32_t)videoSSRC;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, weak) id<CQCongestionControllerDelegate> delegate;  ///< 代理
+@property (nonatomic, weak, nullable) CQVideoEncoder *videoEncoder;  ///< 设置后自动调整码率和分辨率
+@property (nonatomic, weak, nullable) CQAudioEncoder *audioEncoder;  ///< 设置后自动调整码率
+@property (nonatomic, weak, nullable) CQPacketPacer *pacer;  ///< 设置后自动调整发送速率
+
+@property (nonatomic, assign, readonly) uint32_t videoSSRC;  ///< 视频SSRC
+@property (nonatomic, assign, readonly) NSUInteger targetBitrate;  ///< 目标总码率(视频 + 音频)
+@property (nonatomic, assign, readonly) NSUInteger videoBitrate;  ///< 视频码率
+@property (nonatomic, assign, readonly) NSUInteger audioBitrate;  ///< 音频码率
+@property (nonatomic, assign, readonly) NSUInteger ackedBitrate;  ///< 接收端实际收到的视频码率
+@property (nonatomic, assign, readonly) double lossRate;  ///< 丢包率
+@property (nonatomic, assign, readonly) CQVideoLadderStep ladderStep;  ///< 当前码率阶梯
+
+/// 包已经发出(在CQPacketPacer的sendPacket回调里调用)，只记录视频(H264)包
+- (void)onPacketSent:(CQRTPPacket *)packet;
+
+/// 收到接收端反馈
+- (void)onFeedbackData:(NSData *)feedbackData;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,210 @@
+//
+//  CQCongestionController.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 发送记录: 视频包按序列号放进环形数组(发送时间+大小)，反馈回来按序列号查找
+ 2 反馈转换成CQPacketFeedback交给CQBandwidthEstimator，发送时间和到达时间分别是两端的时钟，估计器只用差值
+ 3 反馈只有视频包，接收速率和估计器的上限都只针对视频，估计出的是视频码率；
+   音频码率按视频码率选择(低码率时降到32k/64k)另外加上，两者之和为总码率(平滑发送器的速率)
+ 4 码率阶梯: 视频码率低于当前级的下限立即降级；高于上一级下限的1.25倍持续5秒才升级，避免来回切换重建编码会话
+ */
+
+#import "CQCongestionController.h"
+#import "CQBandwidthEstimator.h"
+#import "CQTransportFeedback.h"
+#import "CQVideoEncoder.h"
+#import "CQAudioEncoder.h"
+#import "CQPacketPacer.h"
+#import <os/lock.h>
+#import <time.h>
+
+#define kSentHistorySize 4096
+#define kLadderStepCount 4
+static const NSUInteger kMinVideoBitrate = 120000;
+static const uint64_t kLadderUpSwitchDelayUs = 5000000;
+static const double kLadderUpSwitchMargin = 1.25;
+
+/// 码率阶梯相对视频配置的比例
+static const struct {
+    double scale;  ///< 分辨率缩放
+    double fpsScale;  ///< 帧率缩放
+    double minBitrateScale;  ///< 最低码率占配置码率的比例
+} kLadderScales[kLadderStepCount] = {
+    {1.0, 1.0, 0.6},
+    {0.75, 1.0, 0.35},
+    {0.5, 1.0, 0.18},
+    {0.5, 0.5, 0},
+};
+
+/// 发送记录
+typedef struct {
+    uint16_t sequenceNumber;
+    BOOL isValid;
+    uint32_t size;
+    uint64_t sendTimeUs;
+} CQSentPacket;
+
+@implementation CQCongestionController
+{
+    os_unfair_lock _lock;
+    CQBandwidthEstimator *_estimator;
+    CQSentPacket _sentPackets[kSentHistorySize];
+    CQVideoLadderStep _ladder[kLadderStepCount];
+    NSUInteger _ladderIndex;
+    uint64_t _upSwitchCandidateSinceUs;  ///< 满足升级条件的开始时间，0为不满足
+    NSUInteger _maxAudioBitrate;
+}
+
+static inline uint64_t CQCongestionNowMicros(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+#pragma mark - Init
+- (instancetype)initWithVideoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig videoSSRC:(uint32_t)videoSSRC {
+    if (self = [super init]) {
+        _videoSSRC = videoSSRC;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _maxAudioBitrate = audioConfig.bitrate;
+        for (NSUInteger i = 0; i < kLadderStepCount; i++) {
+            _ladder[i] = (CQVideoLadderStep){
+                .width = (NSInteger)(videoConfig.width * kLadderScales[i].scale) / 2 * 2,
+                .height = (NSInteger)(videoConfig.height * kLadderScales[i].scale) / 2 * 2,
+                .fps = MAX((NSInteger)(videoConfig.fps * kLadderScales[i].fpsScale), 1),
+                .minBitrate = (NSInteger)(videoConfig.bitrate * kLadderScales[i].minBitrateScale),
+            };
+        }
+        // 估计器只看到视频包，上下限都是视频码率；从最高码率的一半开始，一开始就打满未知的链路容易造成排队
+        uint64_t maxVideoBitrate = MAX((uint64_t)videoConfig.bitrate, (uint64_t)kMinVideoBitrate);
+        uint64_t startBitrate = MAX(maxVideoBitrate / 2, (uint64_t)kMinVideoBitrate);
+        _estimator = CQBandwidthEstimatorCreate(startBitrate, kMinVideoBitrate, maxVideoBitrate);
+        _videoBitrate = (NSUInteger)CQBandwidthEstimatorTargetBitrate(_estimator);
+        _audioBitrate = [self audioBitrateForVideoBitrate:_videoBitrate];
+        _targetBitrate = _videoBitrate + _audioBitrate;
+        _ladderIndex = [self lowerLadderIndexForVideoBitrate:_videoBitrate fromIndex:0];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CQBandwidthEstimatorDestroy(_estimator);
+    NSLog(@"CQCongestionController - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (CQVideoLadderStep)ladderStep {
+    os_unfair_lock_lock(&_lock);
+    CQVideoLadderStep step = _ladder[_ladderIndex];
+    os_unfair_lock_unlock(&_lock);
+    return step;
+}
+
+- (void)onPacketSent:(CQRTPPacket *)packet {
+    if (packet.payloadFormat != CQRTPPayloadFormatH264 && packet.payloadFormat != CQRTPPayloadFormatH265) return;
+    uint64_t now = CQCongestionNowMicros();
+    os_unfair_lock_lock(&_lock);
+    _sentPackets[packet.sequenceNumber % kSentHistorySize] = (CQSentPacket){
+        .sequenceNumber = packet.sequenceNumber,
+        .isValid = YES,
+        .size = (uint32_t)packet.length,
+        .sendTimeUs = now,
+    };
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (void)onFeedbackData:(NSData *)feedbackData {
+    uint64_t now = CQCongestionNowMicros();
+    NSMutableData *feedbackBuffer = [NSMutableData data];
+    uint32_t mediaSSRC = 0;
+
+    os_unfair_lock_lock(&_lock);
+    BOOL isValid = CQTransportFeedbackEnumerate(feedbackData.bytes, feedbackData.length, &mediaSSRC, ^(CQTransportFeedbackPacket packet) {
+        CQSentPacket *sent = &self->_sentPackets[packet.sequenceNumber % kSentHistorySize];
+        if (!sent->isValid || sent->sequenceNumber != packet.sequenceNumber) return;
+        CQPacketFeedback feedback = {.sendTimeUs = sent->sendTimeUs, .arrivalTimeUs = packet.arrivalTimeUs, .size = sent->size};
+        [feedbackBuffer appendBytes:&feedback length:sizeof(feedback)];
+        // 每个包只反馈一次
+        sent->isValid = NO;
+    });
+    if (!isValid || mediaSSRC != _videoSSRC || feedbackBuffer.length == 0) {
+        os_unfair_lock_unlock(&_lock);
+        return;
+    }
+    CQBandwidthEstimatorOnFeedback(_estimator, feedbackBuffer.bytes, feedbackBuffer.length / sizeof(CQPacketFeedback), now);
+    _ackedBitrate = (NSUInteger)CQBandwidthEstimatorAckedBitrate(_estimator);
+    _lossRate = CQBandwidthEstimatorLossRate(_estimator);
+
+    // 估计值已经按视频的接收速率限制过，不能再从里面扣音频
+    NSUInteger videoBitrate = (NSUInteger)CQBandwidthEstimatorTargetBitrate(_estimator);
+    NSUInteger audioBitrate = [self audioBitrateForVideoBitrate:videoBitrate];
+    NSUInteger targetBitrate = videoBitrate + audioBitrate;
+    // 变化小于5%不更新编码器
+    BOOL isBitrateChanged = targetBitrate > _targetBitrate * 21 / 20 || targetBitrate < _targetBitrate * 19 / 20 || audioBitrate != _audioBitrate;
+    NSUInteger previousLadderIndex = _ladderIndex;
+    [self updateLadderWithVideoBitrate:videoBitrate now:now];
+    BOOL isLadderChanged = _ladderIndex != previousLadderIndex;
+    CQVideoLadderStep step = _ladder[_ladderIndex];
+    if (isBitrateChanged) {
+        _targetBitrate = targetBitrate;
+        _videoBitrate = videoBitrate;
+        _audioBitrate = audioBitrate;
+    }
+    os_unfair_lock_unlock(&_lock);
+
+    if (isBitrateChanged) {
+        [self.videoEncoder setTargetBitrate:(NSInteger)videoBitrate];
+        [self.audioEncoder setTargetBitrate:(NSInteger)audioBitrate];
+        self.pacer.targetBitrate = targetBitrate;
+        if (self.delegate && [self.delegate respondsToSelector:@selector(congestionController:didUpdateTargetBitrate:videoBitrate:audioBitrate:)]) {
+            [self.delegate congestionController:self didUpdateTargetBitrate:targetBitrate videoBitrate:videoBitrate audioBitrate:audioBitrate];
+        }
+    }
+    if (isLadderChanged) {
+        [self.videoEncoder setTargetWidth:step.width height:step.height fps:step.fps];
+        if (self.delegate && [self.delegate respondsToSelector:@selector(congestionController:didSwitchLadderStep:)]) {
+            [self.delegate congestionController:self didSwitchLadderStep:step];
+        }
+    }
+}
+
+#pragma mark - Private Func
+/// 低码率时音频让出带宽，阈值相当于总码率300k/600k
+- (NSUInteger)audioBitrateForVideoBitrate:(NSUInteger)videoBitrate {
+    if (videoBitrate < 268000) return MIN(_maxAudioBitrate, (NSUInteger)32000);
+    if (videoBitrate < 536000) return MIN(_maxAudioBitrate, (NSUInteger)64000);
+    return _maxAudioBitrate;
+}
+
+/// 从某一级往下找第一个满足码率的级别
+- (NSUInteger)lowerLadderIndexForVideoBitrate:(NSUInteger)videoBitrate fromIndex:(NSUInteger)index {
+    while (index < kLadderStepCount - 1 && (NSInteger)videoBitrate < _ladder[index].minBitrate) {
+        index++;
+    }
+    return index;
+}
+
+/// 更新码率阶梯(加锁调用)
+- (void)updateLadderWithVideoBitrate:(NSUInteger)videoBitrate now:(uint64_t)now {
+    NSUInteger lowerIndex = [self lowerLadderIndexForVideoBitrate:videoBitrate fromIndex:_ladderIndex];
+    if (lowerIndex != _ladderIndex) {
+        _ladderIndex = lowerIndex;
+        _upSwitchCandidateSinceUs = 0;
+        return;
+    }
+    if (_ladderIndex == 0 || (double)videoBitrate < (double)_ladder[_ladderIndex - 1].minBitrate * kLadderUpSwitchMargin) {
+        _upSwitchCandidateSinceUs = 0;
+        return;
+    }
+    if (_upSwitchCandidateSinceUs == 0) {
+        _upSwitchCandidateSinceUs = now;
+    } else if (now - _upSwitchCandidateSinceUs >= kLadderUpSwitchDelayUs) {
+        _ladderIndex--;
+        _upSwitchCandidateSinceUs = 0;
+    }
+}
+
+@end
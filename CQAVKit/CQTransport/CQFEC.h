@@ -0,0 +1,104 @@
+//
+//  CQFEC.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQRTPPacketizer.h"
+#import "CQRTPDepacketizer.h"
+#import "CQFECCodec.h"
+
+@class CQFECDecoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ FEC修复包
+ @discussion 修复包是独立的RTP流(单独的负载类型、SSRC和序列号，类似FlexFEC)，不占用媒体流的序列号，接收端不支持FEC时直接忽略
+ RTP头(时间戳同被保护的帧) + FEC头(12字节) + 修复符号
+ 0       方案(0 XOR, 1 RS)  修复序号  媒体包个数  本块修复包个数
+ 4       起始媒体序列号(16位)  符号长度(16位)
+ 8       媒体SSRC
+ 媒体符号 = 2字节包长 + 完整RTP包，补0到符号长度(块内最长的包 + 2)
+ */
+
+#pragma mark - CQFECEncoder
+/**
+ FEC编码器(发送端)
+ @discussion 每帧的RTP包分成若干块，每块生成修复包，关键帧比普通帧保护更多
+ XOR: 每protection分之一个包一组，每组一个修复包，每组最多恢复1个丢包
+ Reed-Solomon: 每块最多maxBlockSize个包，生成 包数 x protection 个修复包(向上取整)，丢包数不超过修复包数就能恢复
+ 非线程安全，应和分包器在同一个队列使用
+ */
+@interface CQFECEncoder : NSObject
+
+/**
+ 唯一初始化函数
+ @param payloadType 修复包的RTP负载类型
+ @param ssrc 修复包的SSRC
+ */
+- (instancetype)initWithPayloadType:(uint8_t)payloadType ssrc:(uint32_t)ssrc;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) uint8_t payloadType;  ///< 修复包负载类型
+@property (nonatomic, assign, readonly) uint32_t ssrc;  ///< 修复包SSRC
+@property (nonatomic, assign) CQFECScheme scheme;  ///< 方案，默认Reed-Solomon
+@property (nonatomic, assign) double keyFrameProtection;  ///< 关键帧保护比例(修复包数 / 媒体包数)，默认0.5，0为不保护
+@property (nonatomic, assign) double deltaFrameProtection;  ///< 非关键帧保护比例，默认0.1，0为不保护
+@property (nonatomic, assign) NSUInteger maxBlockSize;  ///< 每块最多的媒体包数，默认48，不超过CQFECMaxMediaCount
+
+/**
+ 为一帧生成修复包
+ @param packets 同一帧的RTP包(CQRTPPacketizer的一次输出)
+ @return 修复包，应在媒体包之后发送
+ */
+- (NSArray<CQRTPPacket *> *)protectFramePackets:(NSArray<CQRTPPacket *> *)packets;
+
+@end
+
+#pragma mark - CQFECDecoder
+@protocol CQFECDecoderDelegate <NSObject>
+@optional
+/// 恢复出一个媒体包
+- (void)fecDecoder:(CQFECDecoder *)decoder didRecoverPacketData:(NSData *)packetData;
+@end
+
+/**
+ FEC解码器(接收端)
+ @discussion 放在CQRTPDepacketizer之前: 媒体包直接转给解包器，同时缓存最近的媒体包，
+ 收到修复包或媒体包后检查所在的块，丢失数不超过修复包数时恢复，恢复的包也转给解包器(解包器的重排窗口会等待它)
+ 一个解码器对应一个媒体流，非线程安全，应在接收队列使用
+ */
+@interface CQFECDecoder : NSObject
+
+/**
+ 唯一初始化函数
+ @param payloadType 修复包的RTP负载类型，其它负载类型的包当作媒体包
+ */
+- (instancetype)initWithFECPayloadType:(uint8_t)payloadType;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) uint8_t payloadType;  ///< 修复包负载类型
+@property (nonatomic, weak) id<CQFECDecoderDelegate> delegate;  ///< 代理
+@property (nonatomic, weak, nullable) CQRTPDepacketizer *depacketizer;  ///< 媒体包和恢复的包都交给解包器
+
+@property (nonatomic, assign, readonly) NSUInteger receivedMediaCount;  ///< 收到的媒体包数
+@property (nonatomic, assign, readonly) NSUInteger receivedRepairCount;  ///< 收到的修复包数
+@property (nonatomic, assign, readonly) NSUInteger recoveredCount;  ///< 恢复的媒体包数
+@property (nonatomic, assign, readonly) NSUInteger unrecoveredCount;  ///< 块内丢失且没能恢复的媒体包数
+
+/**
+ 输入一个RTP包(媒体包或修复包)
+ @param packetData 完整的RTP包
+ */
+- (void)receivePacketData:(NSData *)packetData;
+
+@end
+
+NS_ASSUME_NONNULL_END
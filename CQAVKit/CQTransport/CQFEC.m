@@ -0,0 +1,316 @@
+//
+//  CQFEC.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 发送端
+ 1 一帧的包按块大小平均分成若干块(XOR按保护比例分组，RS按maxBlockSize分块)
+ 2 媒体符号 = 2字节包长 + 完整RTP包，补0到块内最长的包 + 2，修复符号由CQFECCodec生成
+ 3 修复包走独立的SSRC和序列号，时间戳和被保护的帧相同，平滑发送时和帧一起排队
+ 接收端
+ 1 媒体包缓存在环形数组里(按序列号)并直接交给解包器
+ 2 修复包按(媒体SSRC, 起始序列号, 包数, 方案)归到块里，块内丢失数不超过修复包数时恢复
+ 3 块恢复完或没有丢失后标记完成，之后的修复包忽略；落后最大序列号太多的块删除，没恢复的计入unrecoveredCount
+ */
+
+#import "CQFEC.h"
+
+static const size_t kFECHeaderSize = 12;
+static const NSUInteger kMediaHistorySize = 1024;  ///< 缓存的媒体包数
+static const int kMaxBlockAge = 512;  ///< 块的最后一个包落后最大序列号超过这个数时删除
+
+static inline uint16_t CQFECReadUInt16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t CQFECReadUInt32(const uint8_t *p) {
+    return ((uint32_t)CQFECReadUInt16(p) << 16) | CQFECReadUInt16(p + 2);
+}
+
+/// CQRTPPacket的私有方法(在CQRTPPacketizer.m中实现)
+@interface CQRTPPacket (CQFEC)
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat payloadType:(uint8_t)payloadType sequenceNumber:(uint16_t)sequenceNumber timestamp:(uint32_t)timestamp ssrc:(uint32_t)ssrc marker:(BOOL)marker isKeyFrame:(BOOL)isKeyFrame;
+- (void)appendBytes:(const void *)bytes length:(size_t)length;
+- (void)appendData:(NSData *)data offset:(size_t)offset length:(size_t)length;
+@end
+
+#pragma mark - CQFECEncoder
+@implementation CQFECEncoder
+{
+    uint16_t _sequenceNumber;
+}
+
+#pragma mark - Init
+- (instancetype)initWithPayloadType:(uint8_t)payloadType ssrc:(uint32_t)ssrc {
+    if (self = [super init]) {
+        _payloadType = payloadType;
+        _ssrc = ssrc;
+        _scheme = CQFECSchemeReedSolomon;
+        _keyFrameProtection = 0.5;
+        _deltaFrameProtection = 0.1;
+        _maxBlockSize = 48;
+        _sequenceNumber = (uint16_t)arc4random_uniform(0x10000);
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (NSArray<CQRTPPacket *> *)protectFramePackets:(NSArray<CQRTPPacket *> *)packets {
+    CQRTPPacket *firstPacket = packets.firstObject;
+    double protection = firstPacket.isKeyFrame ? self.keyFrameProtection : self.deltaFrameProtection;
+    if (!firstPacket || protection <= 0) return @[];
+
+    NSMutableArray<NSData *> *packetDatas = [NSMutableArray arrayWithCapacity:packets.count];
+    for (CQRTPPacket *packet in packets) {
+        [packetDatas addObject:[packet serializedData]];
+    }
+    uint32_t mediaSSRC = CQFECReadUInt32((const uint8_t *)packetDatas.firstObject.bytes + 8);
+
+    NSUInteger maxBlockSize = MAX(MIN(self.maxBlockSize, (NSUInteger)CQFECMaxMediaCount), (NSUInteger)1);
+    NSUInteger blockSize = maxBlockSize;
+    if (self.scheme == CQFECSchemeXOR) {
+        blockSize = MIN(MAX((NSUInteger)lround(1.0 / protection), (NSUInteger)1), maxBlockSize);
+    }
+    // 平均分块，避免最后一块只有一两个包
+    NSUInteger total = packets.count;
+    NSUInteger blockCount = (total + blockSize - 1) / blockSize;
+    NSMutableArray<CQRTPPacket *> *repairPackets = [NSMutableArray array];
+    for (NSUInteger b = 0; b < blockCount; b++) {
+        NSUInteger start = total * b / blockCount;
+        NSUInteger end = total * (b + 1) / blockCount;
+        NSUInteger repairCount = 1;
+        if (self.scheme == CQFECSchemeReedSolomon) {
+            repairCount = MIN((NSUInteger)ceil((end - start) * protection), (NSUInteger)CQFECMaxRepairCount);
+        }
+        [repairPackets addObjectsFromArray:[self repairPacketsOfDatas:[packetDatas subarrayWithRange:NSMakeRange(start, end - start)] firstPacket:packets[start] mediaSSRC:mediaSSRC repairCount:repairCount]];
+    }
+    return repairPackets;
+}
+
+#pragma mark - Private Func
+/// 为一块生成修复包
+- (NSArray<CQRTPPacket *> *)repairPacketsOfDatas:(NSArray<NSData *> *)datas firstPacket:(CQRTPPacket *)firstPacket mediaSSRC:(uint32_t)mediaSSRC repairCount:(NSUInteger)repairCount {
+    size_t mediaCount = datas.count;
+    size_t symbolLength = 0;
+    for (NSData *data in datas) {
+        symbolLength = MAX(symbolLength, data.length + 2);
+    }
+    NSMutableData *symbols = [NSMutableData dataWithLength:mediaCount * symbolLength];
+    const uint8_t *media[CQFECMaxMediaCount];
+    for (size_t i = 0; i < mediaCount; i++) {
+        uint8_t *symbol = (uint8_t *)symbols.mutableBytes + i * symbolLength;
+        symbol[0] = (uint8_t)(datas[i].length >> 8);
+        symbol[1] = (uint8_t)datas[i].length;
+        memcpy(symbol + 2, datas[i].bytes, datas[i].length);
+        media[i] = symbol;
+    }
+
+    NSMutableArray<CQRTPPacket *> *repairPackets = [NSMutableArray arrayWithCapacity:repairCount];
+    for (NSUInteger r = 0; r < repairCount; r++) {
+        NSMutableData *repair = [NSMutableData dataWithLength:symbolLength];
+        CQFECEncodeRepair(self.scheme, media, mediaCount, symbolLength, r, repair.mutableBytes);
+        uint8_t header[kFECHeaderSize] = {
+            self.scheme, (uint8_t)r, (uint8_t)mediaCount, (uint8_t)repairCount,
+            (uint8_t)(firstPacket.sequenceNumber >> 8), (uint8_t)firstPacket.sequenceNumber,
+            (uint8_t)(symbolLength >> 8), (uint8_t)symbolLength,
+            (uint8_t)(mediaSSRC >> 24), (uint8_t)(mediaSSRC >> 16), (uint8_t)(mediaSSRC >> 8), (uint8_t)mediaSSRC,
+        };
+        CQRTPPacket *packet = [[CQRTPPacket alloc] initWithPayloadFormat:CQRTPPayloadFormatFEC payloadType:self.payloadType sequenceNumber:_sequenceNumber++ timestamp:firstPacket.timestamp ssrc:self.ssrc marker:NO isKeyFrame:firstPacket.isKeyFrame];
+        [packet appendBytes:header length:kFECHeaderSize];
+        [packet appendData:repair offset:0 length:symbolLength];
+        [repairPackets addObject:packet];
+    }
+    return repairPackets;
+}
+
+@end
+
+#pragma mark - CQFECBlock
+/// 接收端的一个FEC块
+@interface CQFECBlock : NSObject
+@property (nonatomic, assign) CQFECScheme scheme;
+@property (nonatomic, assign) uint32_t mediaSSRC;
+@property (nonatomic, assign) uint16_t baseSequence;
+@property (nonatomic, assign) NSUInteger mediaCount;
+@property (nonatomic, assign) size_t symbolLength;
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, NSData *> *repairs;  ///< 修复序号 -> 修复符号
+@property (nonatomic, assign) BOOL isFinished;  ///< 已恢复或没有丢失
+@end
+
+@implementation CQFECBlock
+@end
+
+#pragma mark - CQFECDecoder
+@interface CQFECDecoder ()
+@property (nonatomic, strong) NSMutableArray *history;  ///< 最近的媒体包(NSData或NSNull)，按序列号取模
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, CQFECBlock *> *blocks;
+@end
+
+@implementation CQFECDecoder
+{
+    BOOL _hasHighestSequence;
+    uint16_t _highestSequence;  ///< 收到的最大媒体序列号
+}
+
+#pragma mark - Init
+- (instancetype)initWithFECPayloadType:(uint8_t)payloadType {
+    if (self = [super init]) {
+        _payloadType = payloadType;
+        _history = [NSMutableArray arrayWithCapacity:kMediaHistorySize];
+        for (NSUInteger i = 0; i < kMediaHistorySize; i++) {
+            [_history addObject:[NSNull null]];
+        }
+        _blocks = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (void)receivePacketData:(NSData *)packetData {
+    const uint8_t *bytes = packetData.bytes;
+    if (packetData.length < CQRTPHeaderSize || (bytes[0] >> 6) != 2) return;
+    if ((bytes[1] & 0x7F) == self.payloadType) {
+        [self receiveRepairData:packetData];
+        return;
+    }
+    _receivedMediaCount++;
+    uint16_t sequence = CQFECReadUInt16(bytes + 2);
+    [self storePacketData:packetData sequence:sequence];
+    [self.depacketizer receivePacketData:packetData];
+
+    uint32_t ssrc = CQFECReadUInt32(bytes + 8);
+    for (CQFECBlock *block in self.blocks.allValues) {
+        if (!block.isFinished && block.mediaSSRC == ssrc && (uint16_t)(sequence - block.baseSequence) < block.mediaCount) {
+            [self recoverBlock:block];
+        }
+    }
+    [self pruneBlocks];
+}
+
+#pragma mark - Private Func
+- (void)receiveRepairData:(NSData *)packetData {
+    const uint8_t *bytes = packetData.bytes;
+    size_t headerSize = CQRTPHeaderSize + (bytes[0] & 0x0F) * 4;
+    if (packetData.length < headerSize + kFECHeaderSize) return;
+    const uint8_t *p = bytes + headerSize;
+    CQFECScheme scheme = p[0];
+    size_t repairIndex = p[1];
+    NSUInteger mediaCount = p[2];
+    size_t symbolLength = CQFECReadUInt16(p + 6);
+    if (scheme > CQFECSchemeReedSolomon || mediaCount == 0 || mediaCount > CQFECMaxMediaCount || symbolLength <= 2 ||
+        repairIndex >= (scheme == CQFECSchemeXOR ? 1 : CQFECMaxRepairCount) ||
+        packetData.length < headerSize + kFECHeaderSize + symbolLength) return;
+    _receivedRepairCount++;
+
+    uint16_t baseSequence = CQFECReadUInt16(p + 4);
+    uint32_t mediaSSRC = CQFECReadUInt32(p + 8);
+    // 太旧的块(已经删除)不再恢复
+    if (_hasHighestSequence && (int16_t)(_highestSequence - (uint16_t)(baseSequence + mediaCount)) > kMaxBlockAge) return;
+
+    NSNumber *key = @(((uint64_t)mediaSSRC << 32) | ((uint64_t)baseSequence << 16) | ((uint64_t)mediaCount << 8) | scheme);
+    CQFECBlock *block = self.blocks[key];
+    if (!block) {
+        block = [[CQFECBlock alloc] init];
+        block.scheme = scheme;
+        block.mediaSSRC = mediaSSRC;
+        block.baseSequence = baseSequence;
+        block.mediaCount = mediaCount;
+        block.symbolLength = symbolLength;
+        block.repairs = [NSMutableDictionary dictionary];
+        self.blocks[key] = block;
+    }
+    if (block.isFinished || block.symbolLength != symbolLength) return;
+    block.repairs[@(repairIndex)] = [packetData subdataWithRange:NSMakeRange(headerSize + kFECHeaderSize, symbolLength)];
+    [self recoverBlock:block];
+}
+
+/// 丢失数不超过修复包数时恢复
+- (void)recoverBlock:(CQFECBlock *)block {
+    NSUInteger mediaCount = block.mediaCount;
+    size_t symbolLength = block.symbolLength;
+    NSData *received[CQFECMaxMediaCount];
+    NSUInteger missingCount = 0;
+    for (NSUInteger i = 0; i < mediaCount; i++) {
+        received[i] = [self packetDataOfSequence:(uint16_t)(block.baseSequence + i) ssrc:block.mediaSSRC];
+        if (!received[i]) missingCount++;
+    }
+    if (missingCount == 0) {
+        block.isFinished = YES;
+        return;
+    }
+    if (missingCount > block.repairs.count) return;
+
+    NSMutableData *symbols = [NSMutableData dataWithLength:mediaCount * symbolLength];
+    uint8_t *media[CQFECMaxMediaCount];
+    BOOL isReceived[CQFECMaxMediaCount];
+    for (NSUInteger i = 0; i < mediaCount; i++) {
+        media[i] = (uint8_t *)symbols.mutableBytes + i * symbolLength;
+        isReceived[i] = received[i] != nil;
+        if (!received[i]) continue;
+        // 和修复包不是同一次编码(例如序列号回绕后撞上)
+        if (received[i].length + 2 > symbolLength) return;
+        media[i][0] = (uint8_t)(received[i].length >> 8);
+        media[i][1] = (uint8_t)received[i].length;
+        memcpy(media[i] + 2, received[i].bytes, received[i].length);
+    }
+    const uint8_t *repairs[CQFECMaxRepairCount];
+    size_t repairIndices[CQFECMaxRepairCount];
+    size_t repairCount = 0;
+    for (NSNumber *index in block.repairs) {
+        repairs[repairCount] = block.repairs[index].bytes;
+        repairIndices[repairCount] = index.unsignedIntegerValue;
+        repairCount++;
+    }
+    if (!CQFECDecodeBlock(block.scheme, media, isReceived, mediaCount, symbolLength, repairs, repairIndices, repairCount)) return;
+    block.isFinished = YES;
+
+    for (NSUInteger i = 0; i < mediaCount; i++) {
+        if (isReceived[i]) continue;
+        size_t length = CQFECReadUInt16(media[i]);
+        uint16_t sequence = (uint16_t)(block.baseSequence + i);
+        if (length < CQRTPHeaderSize || length + 2 > symbolLength || CQFECReadUInt16(media[i] + 4) != sequence) continue;
+        NSData *packetData = [NSData dataWithBytes:media[i] + 2 length:length];
+        _recoveredCount++;
+        [self storePacketData:packetData sequence:sequence];
+        if (self.delegate && [self.delegate respondsToSelector:@selector(fecDecoder:didRecoverPacketData:)]) {
+            [self.delegate fecDecoder:self didRecoverPacketData:packetData];
+        }
+        [self.depacketizer receivePacketData:packetData];
+    }
+}
+
+- (void)storePacketData:(NSData *)packetData sequence:(uint16_t)sequence {
+    self.history[sequence % kMediaHistorySize] = packetData;
+    if (!_hasHighestSequence || (int16_t)(sequence - _highestSequence) > 0) {
+        _hasHighestSequence = YES;
+        _highestSequence = sequence;
+    }
+}
+
+- (nullable NSData *)packetDataOfSequence:(uint16_t)sequence ssrc:(uint32_t)ssrc {
+    id item = self.history[sequence % kMediaHistorySize];
+    if (![item isKindOfClass:[NSData class]]) return nil;
+    const uint8_t *bytes = ((NSData *)item).bytes;
+    if (CQFECReadUInt16(bytes + 2) != sequence || CQFECReadUInt32(bytes + 8) != ssrc) return nil;
+    return item;
+}
+
+/// 删除太旧的块
+- (void)pruneBlocks {
+    NSMutableArray<NSNumber *> *expiredKeys = [NSMutableArray array];
+    [self.blocks enumerateKeysAndObjectsUsingBlock:^(NSNumber *key, CQFECBlock *block, BOOL *stop) {
+        if ((int16_t)(self->_highestSequence - (uint16_t)(block.baseSequence + block.mediaCount)) <= kMaxBlockAge) return;
+        [expiredKeys addObject:key];
+        if (block.isFinished) return;
+        for (NSUInteger i = 0; i < block.mediaCount; i++) {
+            if (![self packetDataOfSequence:(uint16_t)(block.baseSequence + i) ssrc:block.mediaSSRC]) self->_unrecoveredCount++;
+        }
+    }];
+    [self.blocks removeObjectsForKeys:expiredKeys];
+}
+
+@end
@@ -0,0 +1,74 @@
+//
+//  CQFECCodec.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ FEC块编解码(纯C，与RTP无关)
+ @discussion 一个块由mediaCount个等长的媒体符号和若干修复符号组成，修复符号 = Σ 系数 x 媒体符号(GF(2^8)，本原多项式0x11D)
+ XOR: 只有一个修复符号，系数全为1，能恢复1个丢失
+ Reed-Solomon: 系数取Cauchy矩阵 1/(x_r + y_i)，x_r = 128 + r，y_i = i，任意k个修复符号能恢复任意k个丢失(MDS)
+ */
+
+/// FEC方案
+typedef NS_ENUM(uint8_t, CQFECScheme) {
+    CQFECSchemeXOR = 0,  ///< 异或奇偶校验(ULPFEC风格)，每组一个修复包
+    CQFECSchemeReedSolomon = 1,  ///< Reed-Solomon，每块多个修复包
+};
+
+#define CQFECMaxMediaCount 128  ///< 一个块最多的媒体符号数
+#define CQFECMaxRepairCount 128  ///< 一个块最多的修复符号数
+
+/// GF(2^8)乘法
+FOUNDATION_EXPORT uint8_t CQGFMultiply(uint8_t a, uint8_t b);
+
+/// GF(2^8)求逆，a不能为0
+FOUNDATION_EXPORT uint8_t CQGFInverse(uint8_t a);
+
+/**
+ dst ^= coefficient x src (GF(2^8)逐字节)
+ @discussion arm64上使用NEON查表(高低4位各一张16字节表)，系数为1时退化为异或
+ */
+FOUNDATION_EXPORT void CQGFMultiplyAdd(uint8_t *dst, const uint8_t *src, uint8_t coefficient, size_t length);
+
+/**
+ CQGFMultiplyAdd的标量实现
+ @discussion 结果和CQGFMultiplyAdd相同，用于基准测试对比
+ */
+FOUNDATION_EXPORT void CQGFMultiplyAddScalar(uint8_t *dst, const uint8_t *src, uint8_t coefficient, size_t length);
+
+/// 第repairIndex个修复符号中第mediaIndex个媒体符号的系数
+FOUNDATION_EXPORT uint8_t CQFECCoefficient(CQFECScheme scheme, size_t repairIndex, size_t mediaIndex);
+
+/**
+ 生成一个修复符号
+ @param scheme 方案
+ @param media 媒体符号，每个长度为symbolLength
+ @param mediaCount 媒体符号个数，不超过CQFECMaxMediaCount
+ @param symbolLength 符号长度
+ @param repairIndex 修复符号序号，XOR只能为0，RS不超过CQFECMaxRepairCount - 1
+ @param repair 输出，长度为symbolLength
+ */
+FOUNDATION_EXPORT void CQFECEncodeRepair(CQFECScheme scheme, const uint8_t *const _Nonnull * _Nonnull media, size_t mediaCount, size_t symbolLength, size_t repairIndex, uint8_t *repair);
+
+/**
+ 恢复丢失的媒体符号
+ @param scheme 方案
+ @param media 媒体符号，丢失的位置指向输出缓冲区(长度为symbolLength)
+ @param isReceived 每个媒体符号是否收到
+ @param mediaCount 媒体符号个数
+ @param symbolLength 符号长度
+ @param repairs 收到的修复符号
+ @param repairIndices 修复符号序号
+ @param repairCount 收到的修复符号个数
+ @return 丢失数超过修复符号数或修复符号无效时返回NO，输出缓冲区内容未定义
+ */
+FOUNDATION_EXPORT BOOL CQFECDecodeBlock(CQFECScheme scheme, uint8_t *const _Nonnull * _Nonnull media, const BOOL *isReceived, size_t mediaCount, size_t symbolLength, const uint8_t *const _Nonnull * _Nonnull repairs, const size_t *repairIndices, size_t repairCount);
+
+NS_ASSUME_NONNULL_END
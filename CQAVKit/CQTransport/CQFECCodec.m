@@ -0,0 +1,201 @@
+//
+//  CQFECCodec.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 GF(2^8)乘法用log/exp表，乘加按系数生成两张16字节表(低4位、高4位的乘积)，a x b = low[b & 15] ^ high[b >> 4]
+   NEON的tbl指令一次查16个字节，标量逐字节查表
+ 2 编码: 修复符号 = Σ 系数 x 媒体符号
+ 3 解码: 丢失e个时取e个修复符号，先减去收到的媒体符号得到校正子 S = A x 丢失符号，
+   A是e x e的系数子矩阵(Cauchy矩阵的子矩阵一定可逆)，求逆后 丢失符号 = A^-1 x S
+ */
+
+#import "CQFECCodec.h"
+#if defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+static uint8_t kGFExp[512];
+static uint8_t kGFLog[256];
+
+static void CQGFInitTables(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        unsigned x = 1;
+        for (int i = 0; i < 255; i++) {
+            kGFExp[i] = (uint8_t)x;
+            kGFLog[x] = (uint8_t)i;
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11D;
+        }
+        // exp表重复一遍，乘法时log相加不用取模
+        for (int i = 255; i < 512; i++) kGFExp[i] = kGFExp[i - 255];
+    });
+}
+
+uint8_t CQGFMultiply(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) return 0;
+    CQGFInitTables();
+    return kGFExp[kGFLog[a] + kGFLog[b]];
+}
+
+uint8_t CQGFInverse(uint8_t a) {
+    CQGFInitTables();
+    return kGFExp[255 - kGFLog[a]];
+}
+
+/// 系数的高低4位乘积表
+static inline void CQGFSplitTables(uint8_t coefficient, uint8_t low[16], uint8_t high[16]) {
+    for (unsigned i = 0; i < 16; i++) {
+        low[i] = CQGFMultiply(coefficient, (uint8_t)i);
+        high[i] = CQGFMultiply(coefficient, (uint8_t)(i << 4));
+    }
+}
+
+static inline void CQGFXorScalar(uint8_t *dst, const uint8_t *src, size_t length) {
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < length; i++) dst[i] ^= src[i];
+}
+
+void CQGFMultiplyAddScalar(uint8_t *dst, const uint8_t *src, uint8_t coefficient, size_t length) {
+    if (coefficient == 0) return;
+    if (coefficient == 1) {
+        CQGFXorScalar(dst, src, length);
+        return;
+    }
+    uint8_t low[16], high[16];
+    CQGFSplitTables(coefficient, low, high);
+    for (size_t i = 0; i < length; i++) {
+        dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+    }
+}
+
+#if defined(__aarch64__)
+static void CQGFMultiplyAddNEON(uint8_t *dst, const uint8_t *src, uint8_t coefficient, size_t length) {
+    if (coefficient == 0) return;
+    size_t i = 0;
+    if (coefficient == 1) {
+        for (; i + 16 <= length; i += 16) {
+            vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+        }
+        for (; i < length; i++) dst[i] ^= src[i];
+        return;
+    }
+    uint8_t low[16], high[16];
+    CQGFSplitTables(coefficient, low, high);
+    const uint8x16_t lowTable = vld1q_u8(low);
+    const uint8x16_t highTable = vld1q_u8(high);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t product = veorq_u8(vqtbl1q_u8(lowTable, vandq_u8(s, mask)), vqtbl1q_u8(highTable, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), product));
+    }
+    for (; i < length; i++) {
+        dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+    }
+}
+#endif
+
+void CQGFMultiplyAdd(uint8_t *dst, const uint8_t *src, uint8_t coefficient, size_t length) {
+#if defined(__aarch64__)
+    CQGFMultiplyAddNEON(dst, src, coefficient, length);
+#else
+    CQGFMultiplyAddScalar(dst, src, coefficient, length);
+#endif
+}
+
+uint8_t CQFECCoefficient(CQFECScheme scheme, size_t repairIndex, size_t mediaIndex) {
+    if (scheme == CQFECSchemeXOR) return 1;
+    return CQGFInverse((uint8_t)((CQFECMaxMediaCount + repairIndex) ^ mediaIndex));
+}
+
+void CQFECEncodeRepair(CQFECScheme scheme, const uint8_t *const *media, size_t mediaCount, size_t symbolLength, size_t repairIndex, uint8_t *repair) {
+    memset(repair, 0, symbolLength);
+    for (size_t i = 0; i < mediaCount; i++) {
+        CQGFMultiplyAdd(repair, media[i], CQFECCoefficient(scheme, repairIndex, i), symbolLength);
+    }
+}
+
+/// e x e矩阵求逆(Gauss-Jordan)，不可逆返回NO
+static BOOL CQGFInvertMatrix(uint8_t *matrix, uint8_t *inverse, size_t n) {
+    memset(inverse, 0, n * n);
+    for (size_t i = 0; i < n; i++) inverse[i * n + i] = 1;
+    for (size_t col = 0; col < n; col++) {
+        size_t pivot = col;
+        while (pivot < n && matrix[pivot * n + col] == 0) pivot++;
+        if (pivot == n) return NO;
+        if (pivot != col) {
+            for (size_t k = 0; k < n; k++) {
+                uint8_t t = matrix[col * n + k]; matrix[col * n + k] = matrix[pivot * n + k]; matrix[pivot * n + k] = t;
+                t = inverse[col * n + k]; inverse[col * n + k] = inverse[pivot * n + k]; inverse[pivot * n + k] = t;
+            }
+        }
+        uint8_t scale = CQGFInverse(matrix[col * n + col]);
+        for (size_t k = 0; k < n; k++) {
+            matrix[col * n + k] = CQGFMultiply(matrix[col * n + k], scale);
+            inverse[col * n + k] = CQGFMultiply(inverse[col * n + k], scale);
+        }
+        for (size_t row = 0; row < n; row++) {
+            uint8_t factor = matrix[row * n + col];
+            if (row == col || factor == 0) continue;
+            for (size_t k = 0; k < n; k++) {
+                matrix[row * n + k] ^= CQGFMultiply(factor, matrix[col * n + k]);
+                inverse[row * n + k] ^= CQGFMultiply(factor, inverse[col * n + k]);
+            }
+        }
+    }
+    return YES;
+}
+
+BOOL CQFECDecodeBlock(CQFECScheme scheme, uint8_t *const *media, const BOOL *isReceived, size_t mediaCount, size_t symbolLength, const uint8_t *const *repairs, const size_t *repairIndices, size_t repairCount) {
+    size_t missing[CQFECMaxMediaCount];
+    size_t missingCount = 0;
+    for (size_t i = 0; i < mediaCount; i++) {
+        if (!isReceived[i]) missing[missingCount++] = i;
+    }
+    if (missingCount == 0) return YES;
+    if (missingCount > repairCount) return NO;
+
+    uint8_t *matrix = malloc(missingCount * missingCount * 2);
+    uint8_t *inverse = matrix + missingCount * missingCount;
+    for (size_t j = 0; j < missingCount; j++) {
+        for (size_t k = 0; k < missingCount; k++) {
+            matrix[j * missingCount + k] = CQFECCoefficient(scheme, repairIndices[j], missing[k]);
+        }
+    }
+    if (!CQGFInvertMatrix(matrix, inverse, missingCount)) {
+        free(matrix);
+        return NO;
+    }
+    // 校正子: 修复符号减去收到的媒体符号的贡献
+    uint8_t *syndromes = malloc(missingCount * symbolLength);
+    for (size_t j = 0; j < missingCount; j++) {
+        uint8_t *syndrome = syndromes + j * symbolLength;
+        memcpy(syndrome, repairs[j], symbolLength);
+        for (size_t i = 0; i < mediaCount; i++) {
+            if (isReceived[i]) CQGFMultiplyAdd(syndrome, media[i], CQFECCoefficient(scheme, repairIndices[j], i), symbolLength);
+        }
+    }
+    for (size_t k = 0; k < missingCount; k++) {
+        uint8_t *output = media[missing[k]];
+        memset(output, 0, symbolLength);
+        for (size_t j = 0; j < missingCount; j++) {
+            CQGFMultiplyAdd(output, syndromes + j * symbolLength, inverse[k * missingCount + j], symbolLength);
+        }
+    }
+    free(syndromes);
+    free(matrix);
+    return YES;
+}
@@ -0,0 +1,88 @@
+//
+//  CQHTTPFLVServer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import "CQCoderConfig.h"
+#import "CQStreamFanout.h"
+
+@class CQHTTPFLVServer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol CQHTTPFLVServerDelegate <NSObject>
+@optional
+/**
+ 客户端开始播放(在服务队列回调)
+ @param address 客户端地址，例如@"192.168.1.2:52011"
+ */
+- (void)httpFLVServer:(CQHTTPFLVServer *)server didConnectClientWithAddress:(NSString *)address;
+
+/// 客户端断开，包括主动关闭和太慢被断开(在服务队列回调)
+- (void)httpFLVServer:(CQHTTPFLVServer *)server didDisconnectClientWithAddress:(NSString *)address;
+@end
+
+/**
+ HTTP-FLV直播服务
+ @discussion 把CQVideoEncoder/CQAudioEncoder的输出用CQFLVMuxer封装，每帧只生成一个tag，由CQStreamFanout用writev零拷贝发给所有客户端
+ 客户端GET path后收到FLV头、onMetaData、序列头和GOP缓存，从最近的关键帧立即开始播放
+ 积压的客户端先丢非参考帧(CQFrameClassifier)，仍然追不上再跳过整个GOP追上直播，长时间写不出去的断开，不影响其他客户端
+ 监听、读写和封装都在一个串行的服务队列，输入接口可以在任意线程调用
+ */
+@interface CQHTTPFLVServer : NSObject
+
+/**
+ 唯一初始化函数
+ @param videoConfig 视频配置，为nil时只有音频
+ @param audioConfig 音频配置，为nil时只有视频
+ */
+- (instancetype)initWithVideoConfig:(nullable CQVideoCoderConfig *)videoConfig audioConfig:(nullable CQAudioCoderConfig *)audioConfig;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, weak) id<CQHTTPFLVServerDelegate> delegate;  ///< 代理
+@property (nonatomic, assign, readonly) uint16_t localPort;  ///< 实际监听的端口
+
+// 以下属性需要在start前设置
+@property (nonatomic, copy) NSString *path;  ///< 播放路径，默认@"/live.flv"，其它路径返回404
+@property (nonatomic, assign) NSUInteger maxClientCount;  ///< 最多客户端数，默认512，超过返回503
+@property (nonatomic, assign) CQStreamFanoutConfig fanoutConfig;  ///< 分发配置，默认CQStreamFanoutDefaultConfig()
+
+/// 分发统计，可以在任意线程读取
+@property (nonatomic, assign, readonly) CQStreamFanoutStats stats;
+
+/**
+ 开始监听
+ @param port 端口，0为系统分配
+ @param error 错误信息
+ */
+- (BOOL)startOnPort:(uint16_t)port error:(NSError * _Nullable *)error;
+
+/// 停止监听并断开所有客户端，GOP缓存保留
+- (void)stop;
+
+/**
+ 设置sps/pps，变化时会发给已连接的客户端
+ @param sps sps数据，Annex-B格式(CQVideoEncoder回调的格式)
+ @param pps pps数据，Annex-B格式
+ */
+- (void)setSps:(NSData *)sps pps:(NSData *)pps;
+
+/**
+ 输入一帧视频(CQVideoEncoder的videoEncoder:didEncodeFrameWithNalus:pts:dts:isKeyFrame:)
+ */
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame;
+
+/**
+ 输入一帧音频(CQAudioEncoder的audioEncoder:didEncodeRawAACData:pts:)
+ */
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,398 @@
+//
+//  CQHTTPFLVServer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 监听socket和每个客户端socket都用GCD读事件源，全部在服务队列处理
+ 2 客户端发来完整的请求头后，直接send响应头(此时发送缓冲为空，一次就能发完)，再加入CQStreamFanout
+ 3 每个客户端一个写事件源，平时挂起，分发回调WantsWrite时恢复、Drained时挂起，Closed时关闭
+ 4 编码器输出在服务队列封装成tag，NSData包装成CQFanoutBuffer(持有NSData，引用计数为0时释放)，所有客户端共用
+ 5 头部 = FLV头 + onMetaData + 视频序列头 + 音频序列头，sps/pps变化时重新设置头部并以头部tag发给已连接的客户端
+ */
+
+#import "CQHTTPFLVServer.h"
+#import "CQFLVMuxer.h"
+#import "CQFrameClassifier.h"
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <arpa/inet.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <os/lock.h>
+#import <time.h>
+
+static const size_t kMaxRequestHeaderSize = 4096;
+static const int kClientSendBufferSize = 256 * 1024;  ///< 发送缓冲不宜太大，否则排队都在内核里，慢客户端策略看不到
+static const int kListenBacklog = 128;
+
+static inline uint64_t CQHTTPFLVNowMicros(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+static void CQHTTPFLVReleaseData(void *context) {
+    CFRelease(context);
+}
+
+/// NSData包装为分发数据块，不拷贝
+static CQFanoutBuffer *CQHTTPFLVCreateBuffer(NSData *data) {
+    return CQFanoutBufferCreate(data.bytes, data.length, (void *)CFBridgingRetain(data), CQHTTPFLVReleaseData);
+}
+
+#pragma mark - CQHTTPFLVClient
+/// 一个客户端连接
+@interface CQHTTPFLVClient : NSObject
+@property (nonatomic, assign) int fd;
+@property (nonatomic, copy) NSString *address;  ///< ip:port
+@property (nonatomic, strong) dispatch_source_t readSource;
+@property (nonatomic, strong) dispatch_source_t writeSource;  ///< 分发回调WantsWrite时恢复
+@property (nonatomic, assign) BOOL isWriteSourceResumed;
+@property (nonatomic, strong) NSMutableData *request;  ///< 未收完的请求头
+@property (nonatomic, assign) CQFanoutClient *fanoutClient;  ///< 在分发中时不为NULL
+@property (nonatomic, assign) BOOL isPlaying;  ///< 已回复200开始播放
+@end
+
+@implementation CQHTTPFLVClient
+@end
+
+#pragma mark - CQHTTPFLVServer
+@interface CQHTTPFLVServer ()
+@property (nonatomic, strong) dispatch_queue_t serverQueue;  ///< 服务队列
+@property (nonatomic, strong) dispatch_source_t acceptSource;  ///< 监听事件源
+@property (nonatomic, strong) NSMutableArray<CQHTTPFLVClient *> *clients;  ///< 所有连接，包括还没收完请求头的
+@property (nonatomic, strong) CQFLVMuxer *muxer;
+@property (nonatomic, strong) NSData *headerData;  ///< FLV头 + onMetaData
+@property (nonatomic, strong) NSData *videoSequenceHeader;
+@property (nonatomic, strong) NSData *audioSequenceHeader;
+@property (nonatomic, strong) NSData *sps;
+@property (nonatomic, strong) NSData *pps;
+@end
+
+@implementation CQHTTPFLVServer
+{
+    CQStreamFanout *_fanout;
+    os_unfair_lock _statsLock;
+    CQStreamFanoutStats _stats;
+}
+
+static void CQHTTPFLVServerFanoutEvent(void *context, int fd, void *clientContext, CQFanoutClientEvent event) {
+    CQHTTPFLVServer *server = (__bridge CQHTTPFLVServer *)context;
+    [server handleFanoutEvent:event client:(__bridge CQHTTPFLVClient *)clientContext];
+}
+
+#pragma mark - Init
+- (instancetype)initWithVideoConfig:(CQVideoCoderConfig *)videoConfig audioConfig:(CQAudioCoderConfig *)audioConfig {
+    if (self = [super init]) {
+        _serverQueue = dispatch_queue_create("CQHTTPFLVServer server queue", DISPATCH_QUEUE_SERIAL);
+        _clients = [NSMutableArray array];
+        _muxer = [[CQFLVMuxer alloc] initWithVideoConfig:videoConfig audioConfig:audioConfig];
+        _headerData = [_muxer headerData];
+        _audioSequenceHeader = [_muxer audioSequenceHeaderTag];
+        _path = @"/live.flv";
+        _maxClientCount = 512;
+        _fanoutConfig = CQStreamFanoutDefaultConfig();
+        _statsLock = OS_UNFAIR_LOCK_INIT;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // 还在队列里的block都持有self，走到这里时服务队列上已经没有任务
+    self.delegate = nil;
+    [self closeAllClients];
+    if (self.acceptSource) dispatch_source_cancel(self.acceptSource);
+    if (_fanout) CQStreamFanoutDestroy(_fanout);
+    NSLog(@"CQHTTPFLVServer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (CQStreamFanoutStats)stats {
+    os_unfair_lock_lock(&_statsLock);
+    CQStreamFanoutStats stats = _stats;
+    os_unfair_lock_unlock(&_statsLock);
+    return stats;
+}
+
+- (BOOL)startOnPort:(uint16_t)port error:(NSError **)error {
+    if (self.acceptSource) return YES;
+    int listenFD = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenFD < 0) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        return NO;
+    }
+    int reuse = 1;
+    setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    fcntl(listenFD, F_SETFL, fcntl(listenFD, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr = {0};
+    addr.sin_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listenFD, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFD, kListenBacklog) != 0) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        close(listenFD);
+        return NO;
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(listenFD, (struct sockaddr *)&addr, &length);
+    _localPort = ntohs(addr.sin_port);
+
+    dispatch_sync(self.serverQueue, ^{
+        if (!self->_fanout) {
+            self->_fanout = CQStreamFanoutCreate(self.fanoutConfig, CQHTTPFLVServerFanoutEvent, (__bridge void *)self);
+            [self updateFanoutHeader];
+        }
+    });
+    self.acceptSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, listenFD, 0, self.serverQueue);
+    __weak typeof(self) weakSelf = self;
+    dispatch_source_set_event_handler(self.acceptSource, ^{
+        [weakSelf acceptClientsFromFD:listenFD];
+    });
+    dispatch_source_set_cancel_handler(self.acceptSource, ^{
+        close(listenFD);
+    });
+    dispatch_resume(self.acceptSource);
+    return YES;
+}
+
+- (void)stop {
+    dispatch_async(self.serverQueue, ^{
+        if (self.acceptSource) {
+            dispatch_source_cancel(self.acceptSource);
+            self.acceptSource = nil;
+        }
+        [self closeAllClients];
+        [self updateStats];
+    });
+}
+
+- (void)setSps:(NSData *)sps pps:(NSData *)pps {
+    dispatch_async(self.serverQueue, ^{
+        if ([self.sps isEqualToData:sps] && [self.pps isEqualToData:pps]) return;
+        NSData *sequenceHeader = [self.muxer videoSequenceHeaderTagWithSps:sps pps:pps];
+        if (!sequenceHeader) return;
+        self.sps = sps;
+        self.pps = pps;
+        self.videoSequenceHeader = sequenceHeader;
+        if (!self->_fanout) return;
+        [self updateFanoutHeader];
+        [self publishTag:sequenceHeader kind:CQFanoutTagKindHeader];
+    });
+}
+
+- (void)appendVideoNalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts dts:(CMTime)dts isKeyFrame:(BOOL)isKeyFrame {
+    if (!self.muxer.videoConfig) return;
+    dispatch_async(self.serverQueue, ^{
+        NSData *tag = [self.muxer videoTagWithNalus:nalus pts:pts dts:dts isKeyFrame:isKeyFrame];
+        if (!tag || !self->_fanout) return;
+        // 非参考帧在客户端积压时可以单独丢掉，分层P编码时积压客户端的帧率减半而不用跳GOP
+        CQFanoutTagKind kind = CQFanoutTagKindFrame;
+        if (isKeyFrame) {
+            kind = CQFanoutTagKindKeyFrame;
+        } else if (CQFrameInfoIsDroppable(CQFrameClassifyNalus(self.muxer.videoConfig.codec, nalus))) {
+            kind = CQFanoutTagKindDroppable;
+        }
+        [self publishTag:tag kind:kind];
+    });
+}
+
+- (void)appendAudioData:(NSData *)aacData pts:(CMTime)pts {
+    if (!self.muxer.audioConfig) return;
+    dispatch_async(self.serverQueue, ^{
+        NSData *tag = [self.muxer audioTagWithData:aacData pts:pts];
+        if (!tag || !self->_fanout) return;
+        // 纯音频时每一帧都可以作为起点
+        [self publishTag:tag kind:self.muxer.videoConfig ? CQFanoutTagKindFrame : CQFanoutTagKindKeyFrame];
+    });
+}
+
+#pragma mark - Private Func
+- (void)publishTag:(NSData *)tag kind:(CQFanoutTagKind)kind {
+    CQFanoutBuffer *buffer = CQHTTPFLVCreateBuffer(tag);
+    CQStreamFanoutPublish(_fanout, buffer, kind, CQHTTPFLVNowMicros());
+    CQFanoutBufferRelease(buffer);
+    [self updateStats];
+}
+
+/// 新客户端最先收到的数据
+- (void)updateFanoutHeader {
+    NSMutableArray<NSData *> *datas = [NSMutableArray arrayWithObject:self.headerData];
+    if (self.videoSequenceHeader) [datas addObject:self.videoSequenceHeader];
+    if (self.audioSequenceHeader) [datas addObject:self.audioSequenceHeader];
+    CQFanoutBuffer *buffers[3];
+    for (NSUInteger i = 0; i < datas.count; i++) {
+        buffers[i] = CQHTTPFLVCreateBuffer(datas[i]);
+    }
+    CQStreamFanoutSetHeader(_fanout, buffers, datas.count);
+    for (NSUInteger i = 0; i < datas.count; i++) {
+        CQFanoutBufferRelease(buffers[i]);
+    }
+}
+
+- (void)updateStats {
+    if (!_fanout) return;
+    CQStreamFanoutStats stats = CQStreamFanoutGetStats(_fanout);
+    os_unfair_lock_lock(&_statsLock);
+    _stats = stats;
+    os_unfair_lock_unlock(&_statsLock);
+}
+
+#pragma mark - Connection
+- (void)acceptClientsFromFD:(int)listenFD {
+    while (YES) {
+        struct sockaddr_in addr = {0};
+        socklen_t length = sizeof(addr);
+        int fd = accept(listenFD, (struct sockaddr *)&addr, &length);
+        if (fd < 0) break;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        int bufferSize = kClientSendBufferSize;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+        char ip[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        CQHTTPFLVClient *client = [[CQHTTPFLVClient alloc] init];
+        client.fd = fd;
+        client.address = [NSString stringWithFormat:@"%s:%d", ip, ntohs(addr.sin_port)];
+        client.request = [NSMutableData data];
+        [self startSourcesOfClient:client];
+        [self.clients addObject:client];
+    }
+}
+
+/// 两个事件源都取消后再关闭fd
+- (void)startSourcesOfClient:(CQHTTPFLVClient *)client {
+    int fd = client.fd;
+    __block int remainingSourceCount = 2;
+    dispatch_block_t cancelHandler = ^{
+        if (--remainingSourceCount == 0) close(fd);
+    };
+    __weak typeof(self) weakSelf = self;
+    __weak typeof(client) weakClient = client;
+    client.readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, self.serverQueue);
+    dispatch_source_set_event_handler(client.readSource, ^{
+        [weakSelf readFromClient:weakClient];
+    });
+    dispatch_source_set_cancel_handler(client.readSource, cancelHandler);
+    client.writeSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, fd, 0, self.serverQueue);
+    dispatch_source_set_event_handler(client.writeSource, ^{
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        CQHTTPFLVClient *strongClient = weakClient;
+        if (!strongSelf || !strongClient.fanoutClient) return;
+        CQStreamFanoutClientWritable(strongSelf->_fanout, strongClient.fanoutClient, CQHTTPFLVNowMicros());
+        [strongSelf updateStats];
+    });
+    dispatch_source_set_cancel_handler(client.writeSource, cancelHandler);
+    dispatch_resume(client.readSource);
+}
+
+- (void)readFromClient:(CQHTTPFLVClient *)client {
+    if (!client) return;
+    uint8_t buffer[kMaxRequestHeaderSize];
+    ssize_t length = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (length == 0 || (length < 0 && errno != EAGAIN && errno != EINTR)) {
+        [self closeClient:client];
+        return;
+    }
+    // 播放后客户端发来的数据忽略，只用来发现断开
+    if (length < 0 || client.isPlaying) return;
+    [client.request appendBytes:buffer length:length];
+    NSRange end = [client.request rangeOfData:[@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding] options:0 range:NSMakeRange(0, client.request.length)];
+    if (end.location == NSNotFound) {
+        if (client.request.length > kMaxRequestHeaderSize) [self closeClient:client];
+        return;
+    }
+    [self handleRequestOfClient:client];
+}
+
+- (void)handleRequestOfClient:(CQHTTPFLVClient *)client {
+    NSString *request = [[NSString alloc] initWithData:client.request encoding:NSASCIIStringEncoding];
+    NSArray<NSString *> *requestLine = [[request componentsSeparatedByString:@"\r\n"].firstObject componentsSeparatedByString:@" "];
+    NSString *path = requestLine.count >= 2 ? [requestLine[1] componentsSeparatedByString:@"?"].firstObject : nil;
+    client.request = nil;
+    if (requestLine.count < 3 || ![requestLine[0] isEqualToString:@"GET"] || ![path isEqualToString:self.path]) {
+        [self sendResponse:@"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n" toClient:client];
+        [self closeClient:client];
+        return;
+    }
+    if (CQStreamFanoutGetStats(_fanout).clientCount >= self.maxClientCount) {
+        [self sendResponse:@"HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n" toClient:client];
+        [self closeClient:client];
+        return;
+    }
+    NSString *response = @"HTTP/1.1 200 OK\r\n"
+                         @"Content-Type: video/x-flv\r\n"
+                         @"Cache-Control: no-cache\r\n"
+                         @"Access-Control-Allow-Origin: *\r\n"
+                         @"Connection: close\r\n\r\n";
+    if (![self sendResponse:response toClient:client]) {
+        [self closeClient:client];
+        return;
+    }
+    client.isPlaying = YES;
+    client.fanoutClient = CQStreamFanoutAddClient(_fanout, client.fd, (__bridge void *)client, CQHTTPFLVNowMicros());
+    [self updateStats];
+    if (self.delegate && [self.delegate respondsToSelector:@selector(httpFLVServer:didConnectClientWithAddress:)]) {
+        [self.delegate httpFLVServer:self didConnectClientWithAddress:client.address];
+    }
+}
+
+- (BOOL)sendResponse:(NSString *)response toClient:(CQHTTPFLVClient *)client {
+    NSData *data = [response dataUsingEncoding:NSASCIIStringEncoding];
+    return send(client.fd, data.bytes, data.length, 0) == (ssize_t)data.length;
+}
+
+- (void)handleFanoutEvent:(CQFanoutClientEvent)event client:(CQHTTPFLVClient *)client {
+    switch (event) {
+        case CQFanoutClientEventWantsWrite:
+            if (!client.isWriteSourceResumed) {
+                client.isWriteSourceResumed = YES;
+                dispatch_resume(client.writeSource);
+            }
+            break;
+        case CQFanoutClientEventDrained:
+            if (client.isWriteSourceResumed) {
+                client.isWriteSourceResumed = NO;
+                dispatch_suspend(client.writeSource);
+            }
+            break;
+        case CQFanoutClientEventClosed:
+            // 分发已经释放了这个客户端
+            client.fanoutClient = NULL;
+            [self closeClient:client];
+            break;
+    }
+}
+
+- (void)closeClient:(CQHTTPFLVClient *)client {
+    if (![self.clients containsObject:client]) return;
+    if (client.fanoutClient) {
+        CQStreamFanoutRemoveClient(_fanout, client.fanoutClient);
+        client.fanoutClient = NULL;
+    }
+    dispatch_source_cancel(client.readSource);
+    // 挂起的事件源要恢复后才会执行取消回调
+    if (!client.isWriteSourceResumed) dispatch_resume(client.writeSource);
+    dispatch_source_cancel(client.writeSource);
+    client.isWriteSourceResumed = YES;
+    if (client.isPlaying && self.delegate && [self.delegate respondsToSelector:@selector(httpFLVServer:didDisconnectClientWithAddress:)]) {
+        [self.delegate httpFLVServer:self didDisconnectClientWithAddress:client.address];
+    }
+    // 最后移除，分发回调里传进来的client没有被其它地方持有
+    [self.clients removeObject:client];
+}
+
+- (void)closeAllClients {
+    for (CQHTTPFLVClient *client in [self.clients copy]) {
+        [self closeClient:client];
+    }
+}
+
+@end
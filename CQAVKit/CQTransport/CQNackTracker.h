@@ -0,0 +1,97 @@
+//
+//  CQNackTracker.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ NACK(纯C，时间由调用方传入)
+ @discussion RTCP格式:
+ Generic NACK (RFC 4585, PT=205, FMT=1): RTCP头 + 发送端SSRC + 媒体SSRC + N x [PID(16位) + BLP(16位)]
+   PID为丢失的序列号，BLP第i位表示PID+i+1也丢失
+ PLI (RFC 4585, PT=206, FMT=1): RTCP头 + 发送端SSRC + 媒体SSRC，请求关键帧
+ */
+
+#define CQRTCPPLISize 12  ///< PLI包长度
+
+/**
+ 写Generic NACK
+ @param buffer 输出
+ @param capacity 输出容量
+ @param senderSSRC 发送端(接收媒体的一端)SSRC
+ @param mediaSSRC 丢包的媒体SSRC
+ @param sequenceNumbers 丢失的序列号，按顺序排列
+ @param count 个数
+ @return 写入的字节数，容量不足时只写能放下的部分，count为0返回0
+ */
+FOUNDATION_EXPORT size_t CQRTCPWriteNack(uint8_t *buffer, size_t capacity, uint32_t senderSSRC, uint32_t mediaSSRC, const uint16_t *sequenceNumbers, size_t count);
+
+/**
+ 解析Generic NACK
+ @param sequenceNumbers 输出丢失的序列号
+ @param maxCount 输出容量
+ @return 序列号个数，不是NACK返回0
+ */
+FOUNDATION_EXPORT size_t CQRTCPParseNack(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC, uint16_t *sequenceNumbers, size_t maxCount);
+
+/// 写PLI，返回CQRTCPPLISize
+FOUNDATION_EXPORT size_t CQRTCPWritePLI(uint8_t *buffer, uint32_t senderSSRC, uint32_t mediaSSRC);
+
+/// 是否是PLI
+FOUNDATION_EXPORT BOOL CQRTCPIsPLI(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC);
+
+/// NACK跟踪配置
+typedef struct {
+    uint64_t reorderDelayUs;  ///< 发现缺口后等待乱序包的时间
+    uint64_t playoutDeadlineUs;  ///< 包从应该到达起最晚可以使用的时间(接收端缓冲时长)
+    uint32_t maxRetries;  ///< 每个包最多请求次数
+    uint64_t initialRttUs;  ///< 还没有测到RTT时使用的值
+    uint64_t minKeyFrameRequestIntervalUs;  ///< 两次请求关键帧的最小间隔(至少2个RTT)
+} CQNackTrackerConfig;
+
+/// 默认配置: 乱序等待10ms，播放截止200ms，最多5次，初始RTT 100ms，关键帧请求间隔500ms
+FOUNDATION_EXPORT CQNackTrackerConfig CQNackTrackerDefaultConfig(void);
+
+/// 最多同时跟踪的丢失包数，超过时放弃重传直接请求关键帧
+#define CQNackTrackerMaxMissing 1024
+
+/// NACK跟踪(接收端)
+typedef struct CQNackTracker CQNackTracker;
+
+FOUNDATION_EXPORT CQNackTracker *CQNackTrackerCreate(CQNackTrackerConfig config);
+FOUNDATION_EXPORT void CQNackTrackerDestroy(CQNackTracker *tracker);
+
+/**
+ 收到一个包
+ @param sequenceNumber 序列号
+ @param nowUs 当前时间
+ @param isRecovered 是否是FEC恢复的包(不用来测RTT)
+ */
+FOUNDATION_EXPORT void CQNackTrackerOnPacket(CQNackTracker *tracker, uint16_t sequenceNumber, uint64_t nowUs, BOOL isRecovered);
+
+/**
+ 取出现在应该请求重传的序列号
+ @discussion 第一次请求在发现缺口后等待乱序时间(按观察到的乱序程度自适应，不小于reorderDelayUs)，之后每1.25个RTT重复一次；
+ 新的请求和已发出的请求都赶不上播放截止时间(或次数用完)时放弃该包，并请求关键帧(按最小间隔限频，请求后之前的丢包全部放弃)
+ @param sequenceNumbers 输出
+ @param maxCount 输出容量
+ @param needsKeyFrame 输出是否需要请求关键帧
+ @return 序列号个数
+ */
+FOUNDATION_EXPORT size_t CQNackTrackerCollect(CQNackTracker *tracker, uint64_t nowUs, uint16_t *sequenceNumbers, size_t maxCount, BOOL *needsKeyFrame);
+
+/// RTT估计(微秒)，由第一次请求到重传包到达的时间平滑得到
+FOUNDATION_EXPORT uint64_t CQNackTrackerRtt(const CQNackTracker *tracker);
+
+/// 正在跟踪的丢失包数
+FOUNDATION_EXPORT size_t CQNackTrackerMissingCount(const CQNackTracker *tracker);
+
+/// 放弃重传的包数
+FOUNDATION_EXPORT uint64_t CQNackTrackerAbandonedCount(const CQNackTracker *tracker);
+
+NS_ASSUME_NONNULL_END
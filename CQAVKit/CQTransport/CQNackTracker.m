@@ -0,0 +1,282 @@
+//
+//  CQNackTracker.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 16位序列号扩展为64位，比最大序列号大时中间的序列号都加入丢失列表(按序列号有序)
+ 2 收到列表中的包就删掉: 没请求过的是乱序包，乱序等待取最近1~2秒里最大的迟到时间；只请求过一次的是重传包，用来测RTT
+   (Karn算法，多次请求的分不清是哪次的应答)
+ 3 Collect时逐个检查: 截止时间 = 发现时间 + 播放截止时长，现在 + RTT 超过截止时间时再请求已经没用，
+   如果之前的请求也赶不上就放弃该包；否则等过乱序时间后请求，之后每1.25个RTT重复
+ 4 放弃的包留在列表里直到截止时间后2个RTT，晚到的重传仍然可以测RTT(RTT比截止时长还大时否则永远测不到)
+ 5 有包放弃就需要关键帧，限频发出后列表中的包全部视为放弃，之前的丢包都由关键帧恢复
+ */
+
+#import "CQNackTracker.h"
+
+static const uint8_t kRTCPFeedbackFirstByte = 0x80 | 1;  ///< V=2, FMT=1
+static const uint8_t kRTCPTypeRTPFB = 205;
+static const uint8_t kRTCPTypePSFB = 206;
+static const size_t kNackHeaderSize = 12;
+static const uint64_t kMinRttUs = 1000;
+static const uint64_t kReorderWindowUs = 1000000;
+
+static inline void CQNackWriteUInt16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static inline void CQNackWriteUInt32(uint8_t *p, uint32_t value) {
+    CQNackWriteUInt16(p, (uint16_t)(value >> 16));
+    CQNackWriteUInt16(p + 2, (uint16_t)value);
+}
+
+static inline uint16_t CQNackReadUInt16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t CQNackReadUInt32(const uint8_t *p) {
+    return ((uint32_t)CQNackReadUInt16(p) << 16) | CQNackReadUInt16(p + 2);
+}
+
+#pragma mark - RTCP
+size_t CQRTCPWriteNack(uint8_t *buffer, size_t capacity, uint32_t senderSSRC, uint32_t mediaSSRC, const uint16_t *sequenceNumbers, size_t count) {
+    if (count == 0 || capacity < kNackHeaderSize + 4) return 0;
+    size_t length = kNackHeaderSize;
+    size_t i = 0;
+    while (i < count && length + 4 <= capacity) {
+        uint16_t pid = sequenceNumbers[i++];
+        uint16_t blp = 0;
+        while (i < count) {
+            uint16_t distance = (uint16_t)(sequenceNumbers[i] - pid);
+            if (distance == 0 || distance > 16) break;
+            blp |= (uint16_t)(1 << (distance - 1));
+            i++;
+        }
+        CQNackWriteUInt16(buffer + length, pid);
+        CQNackWriteUInt16(buffer + length + 2, blp);
+        length += 4;
+    }
+    buffer[0] = kRTCPFeedbackFirstByte;
+    buffer[1] = kRTCPTypeRTPFB;
+    CQNackWriteUInt16(buffer + 2, (uint16_t)(length / 4 - 1));
+    CQNackWriteUInt32(buffer + 4, senderSSRC);
+    CQNackWriteUInt32(buffer + 8, mediaSSRC);
+    return length;
+}
+
+size_t CQRTCPParseNack(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC, uint16_t *sequenceNumbers, size_t maxCount) {
+    if (length < kNackHeaderSize + 4 || bytes[0] != kRTCPFeedbackFirstByte || bytes[1] != kRTCPTypeRTPFB) return 0;
+    size_t packetLength = MIN(((size_t)CQNackReadUInt16(bytes + 2) + 1) * 4, length);
+    *mediaSSRC = CQNackReadUInt32(bytes + 8);
+    size_t count = 0;
+    for (size_t offset = kNackHeaderSize; offset + 4 <= packetLength; offset += 4) {
+        uint16_t pid = CQNackReadUInt16(bytes + offset);
+        uint16_t blp = CQNackReadUInt16(bytes + offset + 2);
+        if (count < maxCount) sequenceNumbers[count++] = pid;
+        for (int bit = 0; bit < 16; bit++) {
+            if ((blp & (1 << bit)) && count < maxCount) sequenceNumbers[count++] = (uint16_t)(pid + bit + 1);
+        }
+    }
+    return count;
+}
+
+size_t CQRTCPWritePLI(uint8_t *buffer, uint32_t senderSSRC, uint32_t mediaSSRC) {
+    buffer[0] = kRTCPFeedbackFirstByte;
+    buffer[1] = kRTCPTypePSFB;
+    CQNackWriteUInt16(buffer + 2, CQRTCPPLISize / 4 - 1);
+    CQNackWriteUInt32(buffer + 4, senderSSRC);
+    CQNackWriteUInt32(buffer + 8, mediaSSRC);
+    return CQRTCPPLISize;
+}
+
+BOOL CQRTCPIsPLI(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC) {
+    if (length < CQRTCPPLISize || bytes[0] != kRTCPFeedbackFirstByte || bytes[1] != kRTCPTypePSFB) return NO;
+    *mediaSSRC = CQNackReadUInt32(bytes + 8);
+    return YES;
+}
+
+#pragma mark - CQNackTracker
+/// 丢失的包
+typedef struct {
+    int64_t sequence;  ///< 扩展序列号
+    uint64_t detectedUs;  ///< 发现丢失的时间
+    uint64_t lastNackUs;  ///< 上次请求的时间
+    uint32_t retries;  ///< 已请求次数
+    BOOL isAbandoned;  ///< 已放弃，不再请求
+} CQMissingPacket;
+
+struct CQNackTracker {
+    CQNackTrackerConfig config;
+    BOOL hasHighest;
+    int64_t highestSequence;
+    CQMissingPacket missing[CQNackTrackerMaxMissing];  ///< 按序列号有序
+    size_t missingCount;
+    uint64_t rttUs;
+    uint64_t reorderWindowStartUs;  ///< 当前乱序统计窗口的开始时间
+    uint64_t reorderMaxUs;  ///< 当前窗口内最大的迟到时间
+    uint64_t previousReorderMaxUs;  ///< 上一个窗口内最大的迟到时间
+    BOOL isKeyFrameNeeded;
+    BOOL hasRequestedKeyFrame;
+    uint64_t lastKeyFrameRequestUs;
+    uint64_t abandonedCount;
+};
+
+CQNackTrackerConfig CQNackTrackerDefaultConfig(void) {
+    return (CQNackTrackerConfig){
+        .reorderDelayUs = 10000,
+        .playoutDeadlineUs = 200000,
+        .maxRetries = 5,
+        .initialRttUs = 100000,
+        .minKeyFrameRequestIntervalUs = 500000,
+    };
+}
+
+CQNackTracker *CQNackTrackerCreate(CQNackTrackerConfig config) {
+    CQNackTracker *tracker = calloc(1, sizeof(CQNackTracker));
+    tracker->config = config;
+    tracker->rttUs = MAX(config.initialRttUs, kMinRttUs);
+    return tracker;
+}
+
+void CQNackTrackerDestroy(CQNackTracker *tracker) {
+    free(tracker);
+}
+
+static int64_t CQNackTrackerExtend(const CQNackTracker *tracker, uint16_t sequence) {
+    if (!tracker->hasHighest) return sequence;
+    int64_t reference = tracker->highestSequence;
+    int64_t candidate = (reference & ~0xFFFFLL) | sequence;
+    if (candidate - reference > 0x8000) {
+        candidate -= 0x10000;
+    } else if (reference - candidate > 0x8000) {
+        candidate += 0x10000;
+    }
+    return candidate;
+}
+
+/// 二分查找，没找到返回SIZE_MAX
+static size_t CQNackTrackerFind(const CQNackTracker *tracker, int64_t sequence) {
+    size_t low = 0, high = tracker->missingCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (tracker->missing[middle].sequence < sequence) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < tracker->missingCount && tracker->missing[low].sequence == sequence ? low : SIZE_MAX;
+}
+
+void CQNackTrackerOnPacket(CQNackTracker *tracker, uint16_t sequenceNumber, uint64_t nowUs, BOOL isRecovered) {
+    int64_t sequence = CQNackTrackerExtend(tracker, sequenceNumber);
+    if (!tracker->hasHighest) {
+        tracker->hasHighest = YES;
+        tracker->highestSequence = sequence;
+        return;
+    }
+    if (sequence > tracker->highestSequence) {
+        int64_t gap = sequence - tracker->highestSequence - 1;
+        if ((size_t)gap + tracker->missingCount > CQNackTrackerMaxMissing) {
+            // 丢得太多，重传没有意义
+            for (size_t i = 0; i < tracker->missingCount; i++) {
+                if (!tracker->missing[i].isAbandoned) tracker->abandonedCount++;
+            }
+            tracker->abandonedCount += (uint64_t)gap;
+            tracker->missingCount = 0;
+            tracker->isKeyFrameNeeded = YES;
+        } else {
+            for (int64_t s = tracker->highestSequence + 1; s < sequence; s++) {
+                tracker->missing[tracker->missingCount++] = (CQMissingPacket){s, nowUs, 0, 0, NO};
+            }
+        }
+        tracker->highestSequence = sequence;
+        return;
+    }
+    size_t index = CQNackTrackerFind(tracker, sequence);
+    if (index == SIZE_MAX) return;
+    CQMissingPacket packet = tracker->missing[index];
+    if (!isRecovered && packet.retries == 1) {
+        uint64_t sample = MAX(nowUs - packet.lastNackUs, kMinRttUs);
+        tracker->rttUs = (tracker->rttUs * 7 + sample) / 8;
+    } else if (!isRecovered && packet.retries == 0) {
+        // 乱序: 记录1秒窗口内最大的迟到时间
+        if (nowUs - tracker->reorderWindowStartUs >= kReorderWindowUs) {
+            tracker->previousReorderMaxUs = tracker->reorderMaxUs;
+            tracker->reorderMaxUs = 0;
+            tracker->reorderWindowStartUs = nowUs;
+        }
+        tracker->reorderMaxUs = MAX(tracker->reorderMaxUs, nowUs - packet.detectedUs);
+    }
+    memmove(&tracker->missing[index], &tracker->missing[index + 1], (tracker->missingCount - index - 1) * sizeof(CQMissingPacket));
+    tracker->missingCount--;
+}
+
+size_t CQNackTrackerCollect(CQNackTracker *tracker, uint64_t nowUs, uint16_t *sequenceNumbers, size_t maxCount, BOOL *needsKeyFrame) {
+    const CQNackTrackerConfig *config = &tracker->config;
+    uint64_t rttUs = tracker->rttUs;
+    uint64_t resendIntervalUs = rttUs + rttUs / 4;
+    // 乱序等待取最近两个窗口里最大的迟到时间，不超过截止时长的一半
+    uint64_t reorderDelayUs = MAX(config->reorderDelayUs, MIN(MAX(tracker->reorderMaxUs, tracker->previousReorderMaxUs), config->playoutDeadlineUs / 2));
+    size_t count = 0, kept = 0;
+    for (size_t i = 0; i < tracker->missingCount; i++) {
+        CQMissingPacket packet = tracker->missing[i];
+        uint64_t deadlineUs = packet.detectedUs + config->playoutDeadlineUs;
+        if (nowUs > deadlineUs + 2 * rttUs) {
+            if (!packet.isAbandoned) {
+                tracker->abandonedCount++;
+                tracker->isKeyFrameNeeded = YES;
+            }
+            continue;
+        }
+        BOOL isNackUseful = nowUs + rttUs <= deadlineUs && packet.retries < config->maxRetries;
+        BOOL isInFlightUseful = packet.retries > 0 && packet.lastNackUs + rttUs <= deadlineUs && nowUs <= deadlineUs;
+        if (!packet.isAbandoned && !isNackUseful && !isInFlightUseful) {
+            packet.isAbandoned = YES;
+            tracker->abandonedCount++;
+            tracker->isKeyFrameNeeded = YES;
+        }
+        if (!packet.isAbandoned && isNackUseful && count < maxCount) {
+            BOOL isDue = packet.retries == 0 ? nowUs - packet.detectedUs >= reorderDelayUs : nowUs - packet.lastNackUs >= resendIntervalUs;
+            if (isDue) {
+                sequenceNumbers[count++] = (uint16_t)packet.sequence;
+                packet.retries++;
+                packet.lastNackUs = nowUs;
+            }
+        }
+        tracker->missing[kept++] = packet;
+    }
+    tracker->missingCount = kept;
+
+    *needsKeyFrame = NO;
+    uint64_t keyFrameIntervalUs = MAX(config->minKeyFrameRequestIntervalUs, rttUs * 2);
+    if (tracker->isKeyFrameNeeded && (!tracker->hasRequestedKeyFrame || nowUs - tracker->lastKeyFrameRequestUs >= keyFrameIntervalUs)) {
+        *needsKeyFrame = YES;
+        tracker->isKeyFrameNeeded = NO;
+        tracker->hasRequestedKeyFrame = YES;
+        tracker->lastKeyFrameRequestUs = nowUs;
+        for (size_t i = 0; i < tracker->missingCount; i++) {
+            if (tracker->missing[i].isAbandoned) continue;
+            tracker->missing[i].isAbandoned = YES;
+            tracker->abandonedCount++;
+        }
+    }
+    return count;
+}
+
+uint64_t CQNackTrackerRtt(const CQNackTracker *tracker) {
+    return tracker->rttUs;
+}
+
+size_t CQNackTrackerMissingCount(const CQNackTracker *tracker) {
+    return tracker->missingCount;
+}
+
+uint64_t CQNackTrackerAbandonedCount(const CQNackTracker *tracker) {
+    return tracker->abandonedCount;
+}
@@ -0,0 +1,139 @@
+//
+//  CQPacketPacer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQRTPPacketizer.h"
+#import "CQLatencyHistogram.h"
+
+@class CQPacketPacer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 发送优先级，数值越小越优先
+typedef NS_ENUM(NSUInteger, CQPacerPriority) {
+    CQPacerPriorityAudio = 0,  ///< 音频，不受令牌桶限制(但消耗令牌)，不会排在视频后面
+    CQPacerPriorityKeyFrame = 1,  ///< 关键帧(含sps/pps)
+    CQPacerPriorityRetransmission = 2,  ///< 重传
+    CQPacerPriorityVideo = 3,  ///< 普通视频帧
+};
+#define CQPacerPriorityCount (CQPacerPriorityVideo + 1)  ///< 优先级个数
+
+#pragma mark - CQPacerCore
+/**
+ 平滑发送核心(纯C，不依赖系统时钟，时间由调用方传入，便于在模拟链路上测试)
+ @discussion 令牌桶: 速率 = 目标码率 x pacingFactor，桶容量为burstInterval内的字节数(至少一个MTU)
+ 允许欠账一个包: 令牌大于0就可以发送，发完可以为负，之后按速率补回
+ 每个优先级一个FIFO，出队时取最高优先级的队首；同一帧的包在队列里是连续的
+ 队首超过截止时间时整帧丢弃(该帧已经开始发送的除外，发一半的帧在接收端没有意义)
+ */
+typedef struct CQPacerCore CQPacerCore;
+
+/// 排队的包
+typedef struct {
+    uint32_t size;  ///< 字节数
+    CQPacerPriority priority;  ///< 优先级
+    uint64_t frameID;  ///< 帧标识，同一帧的包相同(RTP时间戳)
+    uint64_t enqueueTimeUs;  ///< 入队时间，出队时由核心填写
+    uint64_t deadlineUs;  ///< 截止时间，0为不过期
+    void * _Nullable context;  ///< 调用方数据(例如CQRTPPacket)
+} CQPacerPacket;
+
+/// 丢弃回调，丢弃的包不会再出队，调用方在这里释放context
+typedef void (*CQPacerDropCallback)(void * _Nullable opaque, const CQPacerPacket *packet);
+
+/**
+ 创建
+ @param targetBitrate 目标码率(bps)
+ @param pacingFactor 发送速率倍数，一般2.5，关键帧能在几个帧间隔内发完
+ */
+FOUNDATION_EXPORT CQPacerCore *CQPacerCoreCreate(uint64_t targetBitrate, double pacingFactor);
+/// 销毁，队列里剩下的包通过丢弃回调交还
+FOUNDATION_EXPORT void CQPacerCoreDestroy(CQPacerCore *core);
+/// 设置丢弃回调
+FOUNDATION_EXPORT void CQPacerCoreSetDropCallback(CQPacerCore *core, CQPacerDropCallback _Nullable callback, void * _Nullable opaque);
+/// 修改目标码率(带宽估计变化时)，已有的令牌不变
+FOUNDATION_EXPORT void CQPacerCoreSetTargetBitrate(CQPacerCore *core, uint64_t targetBitrate);
+/// 修改突发时长(微秒)，默认5000
+FOUNDATION_EXPORT void CQPacerCoreSetBurstInterval(CQPacerCore *core, uint64_t burstIntervalUs);
+/// 入队
+FOUNDATION_EXPORT void CQPacerCoreEnqueue(CQPacerCore *core, CQPacerPacket packet, uint64_t nowUs);
+/**
+ 出队一个可以发送的包
+ @param nowUs 当前时间
+ @param packet 输出，enqueueTimeUs可以用来计算排队时延
+ @return 有可以发送的包返回YES；令牌不足或队列为空返回NO，过期的包在这里丢弃
+ */
+FOUNDATION_EXPORT BOOL CQPacerCorePop(CQPacerCore *core, uint64_t nowUs, CQPacerPacket *packet);
+/// 下一次可以发送的时间，队列为空返回UINT64_MAX
+FOUNDATION_EXPORT uint64_t CQPacerCoreNextSendTime(CQPacerCore *core, uint64_t nowUs);
+/// 排队的字节数
+FOUNDATION_EXPORT uint64_t CQPacerCoreQueuedBytes(const CQPacerCore *core);
+/// 排队的包数
+FOUNDATION_EXPORT size_t CQPacerCoreQueuedPackets(const CQPacerCore *core);
+
+#pragma mark - CQPacketPacer
+@protocol CQPacketPacerDelegate <NSObject>
+@required
+/**
+ 发送一个包(在平滑发送队列回调)
+ @param packet RTP包，直接交给CQUDPSocket sendRTPPacket:
+ */
+- (void)packetPacer:(CQPacketPacer *)packetPacer sendPacket:(CQRTPPacket *)packet;
+
+@optional
+/**
+ 丢弃了一帧(排队超过截止时间)
+ @discussion 丢的是参考帧时，后续视频帧在接收端无法解码，可以请求编码器插入关键帧
+ @param timestamp 该帧的RTP时间戳
+ @param priority 所在队列
+ */
+- (void)packetPacer:(CQPacketPacer *)packetPacer didDropFrameWithTimestamp:(uint32_t)timestamp priority:(CQPacerPriority)priority;
+
+@end
+
+/**
+ 平滑发送器
+ @discussion 放在编码器/分包器和CQUDPSocket之间，按目标码率的倍数匀速发送，避免关键帧一次性突发造成排队和丢包
+ 内部在一个串行队列上用定时器驱动CQPacerCore，入队和修改码率是线程安全的
+ */
+@interface CQPacketPacer : NSObject
+
+/**
+ 唯一初始化函数
+ @param targetBitrate 目标码率(bps)，音视频合计
+ */
+- (instancetype)initWithTargetBitrate:(NSUInteger)targetBitrate;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, weak) id<CQPacketPacerDelegate> delegate;  ///< 代理
+@property (nonatomic, assign) NSUInteger targetBitrate;  ///< 目标码率(bps)
+@property (nonatomic, assign, readonly) double pacingFactor;  ///< 发送速率倍数，2.5
+@property (nonatomic, assign) NSTimeInterval audioMaxQueueDelay;  ///< 音频最长排队时间，默认0.2秒
+@property (nonatomic, assign) NSTimeInterval videoMaxQueueDelay;  ///< 视频(含关键帧)最长排队时间，默认0.5秒
+@property (nonatomic, assign) NSTimeInterval retransmissionMaxQueueDelay;  ///< 重传最长排队时间，默认0.1秒，再晚接收端已经不需要了
+
+@property (nonatomic, strong, readonly) CQLatencyHistogram *queueDelay;  ///< 排队时延(入队->发送)
+@property (nonatomic, assign, readonly) uint64_t sentBytes;  ///< 已发送字节数
+@property (nonatomic, assign, readonly) uint64_t droppedPacketCount;  ///< 丢弃的包数
+@property (nonatomic, assign, readonly) uint64_t droppedFrameCount;  ///< 丢弃的帧数
+@property (nonatomic, assign, readonly) uint64_t queuedBytes;  ///< 当前排队的字节数
+
+/**
+ 入队一帧的包
+ @param packets 同一帧的RTP包(CQRTPPacketizer的输出)
+ @param priority 优先级，视频帧一般为isKeyFrame ? CQPacerPriorityKeyFrame : CQPacerPriorityVideo
+ */
+- (void)enqueuePackets:(NSArray<CQRTPPacket *> *)packets priority:(CQPacerPriority)priority;
+
+/// 停止，丢弃还在排队的包
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,337 @@
+//
+//  CQPacketPacer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 核心是纯C的CQPacerCore: 四个优先级FIFO(环形数组) + 令牌桶，时间全部由调用方传入，可以在模拟时钟下确定性地测试
+ 2 出队时先按经过的时间补充令牌，再从高到低找第一个非空队列；音频不看令牌，其余队列令牌<=0时都不能发
+ 3 队首过期时整帧丢弃(同一帧的包连续)，已经发出第一个包的帧不丢
+ 4 CQPacketPacer在串行队列上驱动核心: 每次入队或定时器到期就把能发的包发完，再把一次性定时器设到下一个可发送时间，
+   队列为空时定时器不触发，没有空转
+ 5 RTP包CFBridgingRetain后作为context放进核心，发送或丢弃时转移回ARC
+ */
+
+#import "CQPacketPacer.h"
+#import <stdlib.h>
+#import <time.h>
+
+static const uint64_t kDefaultBurstIntervalUs = 5000;
+static const double kMinBurstBytes = 1500;  ///< 桶容量至少一个MTU，否则低码率下大包永远发不出去
+
+#pragma mark - CQPacerCore
+typedef struct {
+    CQPacerPacket *packets;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    uint64_t sendingFrameID;  ///< 最后发出的包所在的帧，该帧剩下的包不因过期丢弃
+    BOOL isSending;
+} CQPacerFIFO;
+
+struct CQPacerCore {
+    CQPacerFIFO fifos[CQPacerPriorityCount];
+    double pacingFactor;
+    double bytesPerUs;  ///< 发送速率
+    uint64_t burstIntervalUs;
+    double budget;  ///< 令牌(字节)，可以为负
+    uint64_t lastUpdateUs;
+    BOOL hasUpdated;
+    uint64_t queuedBytes;
+    size_t queuedPackets;
+    CQPacerDropCallback dropCallback;
+    void *dropOpaque;
+};
+
+static inline CQPacerPacket *CQPacerFIFOHead(CQPacerFIFO *fifo) {
+    return &fifo->packets[fifo->head];
+}
+
+static void CQPacerFIFOPush(CQPacerFIFO *fifo, CQPacerPacket packet) {
+    if (fifo->count == fifo->capacity) {
+        size_t capacity = fifo->capacity ? fifo->capacity * 2 : 64;
+        CQPacerPacket *packets = malloc(capacity * sizeof(CQPacerPacket));
+        // 环形数组展开成从0开始
+        for (size_t i = 0; i < fifo->count; i++) {
+            packets[i] = fifo->packets[(fifo->head + i) % fifo->capacity];
+        }
+        free(fifo->packets);
+        fifo->packets = packets;
+        fifo->capacity = capacity;
+        fifo->head = 0;
+    }
+    fifo->packets[(fifo->head + fifo->count) % fifo->capacity] = packet;
+    fifo->count++;
+}
+
+static CQPacerPacket CQPacerCoreRemoveHead(CQPacerCore *core, CQPacerFIFO *fifo) {
+    CQPacerPacket packet = *CQPacerFIFOHead(fifo);
+    fifo->head = (fifo->head + 1) % fifo->capacity;
+    fifo->count--;
+    core->queuedBytes -= packet.size;
+    core->queuedPackets--;
+    return packet;
+}
+
+static inline double CQPacerCoreMaxBudget(const CQPacerCore *core) {
+    double burst = core->bytesPerUs * (double)core->burstIntervalUs;
+    return burst > kMinBurstBytes ? burst : kMinBurstBytes;
+}
+
+static void CQPacerCoreUpdateBudget(CQPacerCore *core, uint64_t nowUs) {
+    if (!core->hasUpdated) {
+        core->hasUpdated = YES;
+        core->lastUpdateUs = nowUs;
+        core->budget = CQPacerCoreMaxBudget(core);
+        return;
+    }
+    if (nowUs <= core->lastUpdateUs) return;
+    core->budget += (double)(nowUs - core->lastUpdateUs) * core->bytesPerUs;
+    core->lastUpdateUs = nowUs;
+    double maxBudget = CQPacerCoreMaxBudget(core);
+    if (core->budget > maxBudget) core->budget = maxBudget;
+}
+
+/// 丢弃队首过期的帧
+static void CQPacerCoreDropExpired(CQPacerCore *core, CQPacerFIFO *fifo, uint64_t nowUs) {
+    while (fifo->count > 0) {
+        CQPacerPacket *head = CQPacerFIFOHead(fifo);
+        if (head->deadlineUs == 0 || nowUs <= head->deadlineUs) return;
+        if (fifo->isSending && head->frameID == fifo->sendingFrameID) return;
+        uint64_t frameID = head->frameID;
+        while (fifo->count > 0 && CQPacerFIFOHead(fifo)->frameID == frameID) {
+            CQPacerPacket packet = CQPacerCoreRemoveHead(core, fifo);
+            if (core->dropCallback) core->dropCallback(core->dropOpaque, &packet);
+        }
+    }
+}
+
+CQPacerCore *CQPacerCoreCreate(uint64_t targetBitrate, double pacingFactor) {
+    CQPacerCore *core = calloc(1, sizeof(CQPacerCore));
+    core->pacingFactor = pacingFactor;
+    core->burstIntervalUs = kDefaultBurstIntervalUs;
+    CQPacerCoreSetTargetBitrate(core, targetBitrate);
+    return core;
+}
+
+void CQPacerCoreDestroy(CQPacerCore *core) {
+    for (NSUInteger p = 0; p < CQPacerPriorityCount; p++) {
+        CQPacerFIFO *fifo = &core->fifos[p];
+        while (fifo->count > 0) {
+            CQPacerPacket packet = CQPacerCoreRemoveHead(core, fifo);
+            if (core->dropCallback) core->dropCallback(core->dropOpaque, &packet);
+        }
+        free(fifo->packets);
+    }
+    free(core);
+}
+
+void CQPacerCoreSetDropCallback(CQPacerCore *core, CQPacerDropCallback callback, void *opaque) {
+    core->dropCallback = callback;
+    core->dropOpaque = opaque;
+}
+
+void CQPacerCoreSetTargetBitrate(CQPacerCore *core, uint64_t targetBitrate) {
+    core->bytesPerUs = (double)targetBitrate * core->pacingFactor / 8.0 / 1000000.0;
+}
+
+void CQPacerCoreSetBurstInterval(CQPacerCore *core, uint64_t burstIntervalUs) {
+    core->burstIntervalUs = burstIntervalUs;
+}
+
+void CQPacerCoreEnqueue(CQPacerCore *core, CQPacerPacket packet, uint64_t nowUs) {
+    if (packet.priority >= CQPacerPriorityCount) packet.priority = CQPacerPriorityVideo;
+    packet.enqueueTimeUs = nowUs;
+    CQPacerFIFOPush(&core->fifos[packet.priority], packet);
+    core->queuedBytes += packet.size;
+    core->queuedPackets++;
+}
+
+BOOL CQPacerCorePop(CQPacerCore *core, uint64_t nowUs, CQPacerPacket *packet) {
+    CQPacerCoreUpdateBudget(core, nowUs);
+    for (NSUInteger p = 0; p < CQPacerPriorityCount; p++) {
+        CQPacerFIFO *fifo = &core->fifos[p];
+        CQPacerCoreDropExpired(core, fifo, nowUs);
+        if (fifo->count == 0) continue;
+        // 高优先级的队列在等令牌时，低优先级的也不能发
+        if (p != CQPacerPriorityAudio && core->budget <= 0) return NO;
+        *packet = CQPacerCoreRemoveHead(core, fifo);
+        core->budget -= packet->size;
+        fifo->sendingFrameID = packet->frameID;
+        fifo->isSending = YES;
+        return YES;
+    }
+    return NO;
+}
+
+uint64_t CQPacerCoreNextSendTime(CQPacerCore *core, uint64_t nowUs) {
+    if (core->queuedPackets == 0) return UINT64_MAX;
+    if (core->fifos[CQPacerPriorityAudio].count > 0) return nowUs;
+    CQPacerCoreUpdateBudget(core, nowUs);
+    if (core->budget > 0) return nowUs;
+    if (core->bytesPerUs <= 0) return UINT64_MAX;
+    // 令牌恰好补到正数的时刻
+    return nowUs + (uint64_t)(-core->budget / core->bytesPerUs) + 1;
+}
+
+uint64_t CQPacerCoreQueuedBytes(const CQPacerCore *core) {
+    return core->queuedBytes;
+}
+
+size_t CQPacerCoreQueuedPackets(const CQPacerCore *core) {
+    return core->queuedPackets;
+}
+
+#pragma mark - CQPacketPacer
+@interface CQPacketPacer ()
+@property (nonatomic, strong) dispatch_queue_t pacerQueue;  ///< 平滑发送队列
+@property (nonatomic, strong) dispatch_source_t sendTimer;  ///< 一次性定时器，设到下一个可发送时间
+@end
+
+@implementation CQPacketPacer
+{
+    CQPacerCore *_core;
+    uint64_t _lastDroppedFrameID;
+    CQPacerPriority _lastDroppedPriority;
+    BOOL _hasDropped;
+}
+
+static inline uint64_t CQPacerNowMicros(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+/// 只释放RTP包，停止和销毁时使用
+static void CQPacketPacerReleasePacket(void *opaque, const CQPacerPacket *packet) {
+    if (packet->context) CFRelease(packet->context);
+}
+
+static void CQPacketPacerDidDropPacket(void *opaque, const CQPacerPacket *packet) {
+    CQPacketPacer *pacer = (__bridge CQPacketPacer *)opaque;
+    CQPacketPacerReleasePacket(opaque, packet);
+    pacer->_droppedPacketCount++;
+    // 同一帧的包连续回调，只通知一次
+    if (pacer->_hasDropped && pacer->_lastDroppedFrameID == packet->frameID && pacer->_lastDroppedPriority == packet->priority) return;
+    pacer->_hasDropped = YES;
+    pacer->_lastDroppedFrameID = packet->frameID;
+    pacer->_lastDroppedPriority = packet->priority;
+    pacer->_droppedFrameCount++;
+    if (pacer.delegate && [pacer.delegate respondsToSelector:@selector(packetPacer:didDropFrameWithTimestamp:priority:)]) {
+        [pacer.delegate packetPacer:pacer didDropFrameWithTimestamp:(uint32_t)packet->frameID priority:packet->priority];
+    }
+}
+
+#pragma mark - Init
+- (instancetype)initWithTargetBitrate:(NSUInteger)targetBitrate {
+    if (self = [super init]) {
+        _targetBitrate = targetBitrate;
+        _pacingFactor = 2.5;
+        _audioMaxQueueDelay = 0.2;
+        _videoMaxQueueDelay = 0.5;
+        _retransmissionMaxQueueDelay = 0.1;
+        _queueDelay = [[CQLatencyHistogram alloc] initWithName:@"pacerQueueDelay"];
+        _core = CQPacerCoreCreate(targetBitrate, _pacingFactor);
+        CQPacerCoreSetDropCallback(_core, CQPacketPacerDidDropPacket, (__bridge void *)self);
+        _pacerQueue = dispatch_queue_create("CQPacketPacer queue", DISPATCH_QUEUE_SERIAL);
+        _sendTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _pacerQueue);
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(_sendTimer, ^{
+            [weakSelf sendPackets];
+        });
+        dispatch_source_set_timer(_sendTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        dispatch_resume(_sendTimer);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_sendTimer) dispatch_source_cancel(_sendTimer);
+    if (_core) {
+        CQPacerCoreSetDropCallback(_core, CQPacketPacerReleasePacket, NULL);
+        CQPacerCoreDestroy(_core);
+    }
+    NSLog(@"CQPacketPacer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (void)setTargetBitrate:(NSUInteger)targetBitrate {
+    _targetBitrate = targetBitrate;
+    dispatch_async(self.pacerQueue, ^{
+        if (!self->_core) return;
+        CQPacerCoreSetTargetBitrate(self->_core, targetBitrate);
+        [self sendPackets];
+    });
+}
+
+- (uint64_t)queuedBytes {
+    __block uint64_t queuedBytes = 0;
+    dispatch_sync(self.pacerQueue, ^{
+        if (self->_core) queuedBytes = CQPacerCoreQueuedBytes(self->_core);
+    });
+    return queuedBytes;
+}
+
+- (void)enqueuePackets:(NSArray<CQRTPPacket *> *)packets priority:(CQPacerPriority)priority {
+    NSTimeInterval maxQueueDelay = [self maxQueueDelayOfPriority:priority];
+    dispatch_async(self.pacerQueue, ^{
+        if (!self->_core) return;
+        uint64_t now = CQPacerNowMicros();
+        for (CQRTPPacket *packet in packets) {
+            CQPacerPacket pacerPacket = {
+                .size = (uint32_t)packet.length,
+                .priority = priority,
+                .frameID = packet.timestamp,
+                .deadlineUs = now + (uint64_t)(maxQueueDelay * 1000000),
+                .context = (void *)CFBridgingRetain(packet),
+            };
+            CQPacerCoreEnqueue(self->_core, pacerPacket, now);
+        }
+        [self sendPackets];
+    });
+}
+
+- (void)stop {
+    dispatch_async(self.pacerQueue, ^{
+        if (!self->_core) return;
+        dispatch_source_set_timer(self.sendTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+        CQPacerCoreSetDropCallback(self->_core, CQPacketPacerReleasePacket, NULL);
+        CQPacerCoreDestroy(self->_core);
+        self->_core = NULL;
+    });
+}
+
+#pragma mark - Private Func
+- (NSTimeInterval)maxQueueDelayOfPriority:(CQPacerPriority)priority {
+    switch (priority) {
+        case CQPacerPriorityAudio:
+            return self.audioMaxQueueDelay;
+        case CQPacerPriorityRetransmission:
+            return self.retransmissionMaxQueueDelay;
+        default:
+            return self.videoMaxQueueDelay;
+    }
+}
+
+/// 把当前能发的包发完，再把定时器设到下一个可发送时间(在平滑发送队列调用)
+- (void)sendPackets {
+    if (!_core) return;
+    uint64_t now = CQPacerNowMicros();
+    CQPacerPacket packet;
+    while (CQPacerCorePop(_core, now, &packet)) {
+        CQRTPPacket *rtpPacket = CFBridgingRelease(packet.context);
+        [_queueDelay addMicros:(int64_t)(now - packet.enqueueTimeUs)];
+        _sentBytes += packet.size;
+        [self.delegate packetPacer:self sendPacket:rtpPacket];
+    }
+    uint64_t nextSendTime = CQPacerCoreNextSendTime(_core, now);
+    if (nextSendTime == UINT64_MAX) {
+        dispatch_source_set_timer(self.sendTimer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    } else {
+        int64_t delay = (int64_t)(nextSendTime - now) * NSEC_PER_USEC;
+        dispatch_source_set_timer(self.sendTimer, dispatch_time(DISPATCH_TIME_NOW, delay), DISPATCH_TIME_FOREVER, 100 * NSEC_PER_USEC);
+    }
+}
+
+@end
@@ -0,0 +1,94 @@
+//
+//  CQRTPDepacketizer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQRTPPacketizer.h"
+#import "CQVideoDecoder.h"
+#import "CQAudioDecoder.h"
+#import "CQMediaExecutor.h"
+
+@class CQRTPDepacketizer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol CQRTPDepacketizerDelegate <NSObject>
+@optional
+/**
+ 收到完整的一帧H264(payloadFormat为H265时为HEVC)
+ @param nalus 该帧的所有NALU，Annex-B格式(00 00 00 01起始码)，可以直接交给CQVideoDecoder
+ @param timestamp RTP时间戳
+ */
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didOutputH264Nalus:(NSArray<NSData *> *)nalus timestamp:(uint32_t)timestamp;
+
+/**
+ 收到完整的一帧AAC
+ @param aacData AAC裸数据，可以直接交给CQAudioDecoder
+ @param timestamp RTP时间戳
+ */
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didOutputAACData:(NSData *)aacData timestamp:(uint32_t)timestamp;
+
+/**
+ 检测到丢包
+ @param firstSequenceNumber 丢失的第一个序列号
+ @param count 连续丢失的个数
+ */
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didLosePacketsFromSequenceNumber:(uint16_t)firstSequenceNumber count:(NSUInteger)count;
+
+@end
+
+/**
+ RTP解包器
+ @discussion CQRTPPacketizer的逆过程，按序列号重排乱序包，等待超过重排窗口后判定丢包，
+ 重组出完整的一帧后回调，并直接交给videoDecoder/audioDecoder(如果设置了)
+ 丢包时丢弃不完整的FU-A/FU/AAC分片，其它NALU照常输出
+ 非线程安全，同一个解包器应在同一个队列使用(例如socket的接收队列)，设置了strand时需要在该strand上使用
+ */
+@interface CQRTPDepacketizer : NSObject
+
+/**
+ 唯一初始化函数
+ @param payloadFormat 负载格式
+ */
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) CQRTPPayloadFormat payloadFormat;  ///< 负载格式
+
+@property (nonatomic, weak) id<CQRTPDepacketizerDelegate> delegate;  ///< 代理
+@property (nonatomic, weak, nullable) CQVideoDecoder *videoDecoder;  ///< 设置后H264/HEVC帧直接送入解码器，解码器的config.codec要和负载格式一致，丢包时调用它的reportDataLoss
+@property (nonatomic, weak, nullable) CQAudioDecoder *audioDecoder;  ///< 设置后AAC帧直接送入解码器
+
+@property (nonatomic, assign) NSUInteger reorderWindow;  ///< 重排窗口(包个数)，默认64
+@property (nonatomic, assign) NSTimeInterval maxReorderDelay;  ///< 等待乱序包的最长时间，默认0.05秒
+/**
+ 接收所在的strand
+ @discussion 设置后重排缓存里有包在等待时，在strand上定时检查等待超时，流暂停(没有新包到达)时缓存的包也会按时判定丢包并输出，
+ receivePacketData:和flush需要在该strand上调用；为nil时只在收到新包时检查超时
+ */
+@property (nonatomic, strong, nullable) CQMediaStrand *strand;
+
+@property (nonatomic, assign, readonly) NSUInteger receivedCount;  ///< 收到的包数
+@property (nonatomic, assign, readonly) NSUInteger lostCount;  ///< 判定丢失的包数
+@property (nonatomic, assign, readonly) NSUInteger reorderedCount;  ///< 乱序到达的包数
+@property (nonatomic, assign, readonly) NSUInteger duplicateCount;  ///< 重复或迟到被丢弃的包数
+
+/**
+ 输入一个RTP包
+ @param packetData 完整的RTP包(含RTP头)
+ */
+- (void)receivePacketData:(NSData *)packetData;
+
+/**
+ 不再等待乱序包，处理所有缓存的包并输出当前帧
+ */
+- (void)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,344 @@
+//
+//  CQRTPDepacketizer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 解析RTP头，16位序列号扩展为64位(处理回绕)
+ 2 比期望序列号小的包为重复/迟到包，直接丢弃；其它包放入重排缓存
+ 3 从缓存中按序取出期望序列号的包处理
+ 4 缓存超过重排窗口或最老的包等待超时，判定中间的包丢失，跳到缓存中最小的序列号继续，
+   设置了strand时缓存非空就在strand上按最老的包的超时时间定时检查，不依赖新包到达
+ 5 按负载格式重组NALU/AAC帧，marker或时间戳变化时输出一帧
+ 6 HEVC的AP/FU和H264的STAP-A/FU-A结构相同，只是负载头为2字节
+ */
+
+#import "CQRTPDepacketizer.h"
+#import "CQNaluUtil.h"
+#import <QuartzCore/QuartzCore.h>
+
+/// 缓存中的包
+@interface CQRTPReceivedPacket : NSObject
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic, assign) CFTimeInterval arrivalTime;
+@end
+
+@implementation CQRTPReceivedPacket
+@end
+
+@interface CQRTPDepacketizer ()
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, CQRTPReceivedPacket *> *pendingPackets;  ///< 重排缓存，key为扩展序列号
+@property (nonatomic, strong) NSMutableArray<NSData *> *currentNalus;  ///< 当前帧已收到的NALU
+@property (nonatomic, strong, nullable) NSMutableData *fragmentBuffer;  ///< FU-A/FU/AAC分片缓存
+@end
+
+@implementation CQRTPDepacketizer
+{
+    BOOL _hasExpectedSequence;
+    int64_t _expectedSequence;  ///< 期望的扩展序列号
+    int64_t _highestSequence;  ///< 收到的最大扩展序列号
+    BOOL _hasCurrentTimestamp;
+    uint32_t _currentTimestamp;  ///< 当前帧的时间戳
+    size_t _fragmentExpectedSize;  ///< AAC分片的完整AU长度
+    BOOL _isReorderTimerScheduled;  ///< 重排超时检查已经在strand上排队
+}
+
+#pragma mark - Init
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat {
+    if (self = [super init]) {
+        _payloadFormat = payloadFormat;
+        _reorderWindow = 64;
+        _maxReorderDelay = 0.05;
+        _pendingPackets = [NSMutableDictionary dictionary];
+        _currentNalus = [NSMutableArray array];
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (void)receivePacketData:(NSData *)packetData {
+    const uint8_t *bytes = packetData.bytes;
+    if (packetData.length < CQRTPHeaderSize || (bytes[0] >> 6) != 2) return;
+    _receivedCount++;
+    uint16_t sequence = (uint16_t)((bytes[2] << 8) | bytes[3]);
+    int64_t extendedSequence = [self extendSequence:sequence];
+
+    if (!_hasExpectedSequence) {
+        _hasExpectedSequence = YES;
+        _expectedSequence = extendedSequence;
+        _highestSequence = extendedSequence;
+    }
+    if (extendedSequence < _expectedSequence || self.pendingPackets[@(extendedSequence)]) {
+        _duplicateCount++;
+        return;
+    }
+    if (extendedSequence < _highestSequence) {
+        _reorderedCount++;
+    }
+    _highestSequence = MAX(_highestSequence, extendedSequence);
+
+    CQRTPReceivedPacket *packet = [[CQRTPReceivedPacket alloc] init];
+    packet.data = packetData;
+    packet.arrivalTime = CACurrentMediaTime();
+    self.pendingPackets[@(extendedSequence)] = packet;
+    [self drainPendingPacketsForce:NO];
+    [self scheduleReorderTimerIfNeeded];
+}
+
+- (void)flush {
+    [self drainPendingPacketsForce:YES];
+    [self outputCurrentFrame];
+}
+
+#pragma mark - Private Func
+/// 缓存里还有包在等待时，在strand上到最老的包超时的时刻再检查一次
+- (void)scheduleReorderTimerIfNeeded {
+    if (!self.strand || _isReorderTimerScheduled || self.pendingPackets.count == 0) return;
+    CFTimeInterval oldestArrival = DBL_MAX;
+    for (CQRTPReceivedPacket *packet in self.pendingPackets.objectEnumerator) {
+        oldestArrival = MIN(oldestArrival, packet.arrivalTime);
+    }
+    _isReorderTimerScheduled = YES;
+    // 多等1毫秒，保证到期时已经超过maxReorderDelay
+    NSTimeInterval delay = oldestArrival + self.maxReorderDelay - CACurrentMediaTime() + 0.001;
+    __weak typeof(self) weakSelf = self;
+    [self.strand asyncAfter:delay block:^{
+        __strong typeof(weakSelf) strongSelf = weakSelf;
+        if (!strongSelf) return;
+        strongSelf->_isReorderTimerScheduled = NO;
+        [strongSelf drainPendingPacketsForce:NO];
+        [strongSelf scheduleReorderTimerIfNeeded];
+    }];
+}
+
+#pragma mark - Reorder
+/// 16位序列号扩展为64位，选择离当前期望值最近的一个
+- (int64_t)extendSequence:(uint16_t)sequence {
+    if (!_hasExpectedSequence) return sequence;
+    int64_t reference = _highestSequence;
+    int64_t candidate = (reference & ~0xFFFFLL) | sequence;
+    if (candidate - reference > 0x8000) {
+        candidate -= 0x10000;
+    } else if (reference - candidate > 0x8000) {
+        candidate += 0x10000;
+    }
+    return candidate;
+}
+
+/// 按序处理缓存中的包，必要时判定丢包
+- (void)drainPendingPacketsForce:(BOOL)force {
+    while (self.pendingPackets.count > 0) {
+        CQRTPReceivedPacket *packet = self.pendingPackets[@(_expectedSequence)];
+        if (packet) {
+            [self.pendingPackets removeObjectForKey:@(_expectedSequence)];
+            _expectedSequence++;
+            [self processPacketData:packet.data];
+            continue;
+        }
+        // 期望的包还没到，判断是否继续等待
+        CFTimeInterval oldestArrival = DBL_MAX;
+        int64_t minSequence = INT64_MAX;
+        for (NSNumber *key in self.pendingPackets) {
+            minSequence = MIN(minSequence, key.longLongValue);
+            oldestArrival = MIN(oldestArrival, self.pendingPackets[key].arrivalTime);
+        }
+        BOOL isTimeout = CACurrentMediaTime() - oldestArrival > self.maxReorderDelay;
+        if (!force && !isTimeout && self.pendingPackets.count <= self.reorderWindow) break;
+
+        NSUInteger lost = (NSUInteger)(minSequence - _expectedSequence);
+        _lostCount += lost;
+        // 丢包后不完整的分片已经无法恢复
+        self.fragmentBuffer = nil;
+        if (self.delegate && [self.delegate respondsToSelector:@selector(rtpDepacketizer:didLosePacketsFromSequenceNumber:count:)]) {
+            [self.delegate rtpDepacketizer:self didLosePacketsFromSequenceNumber:(uint16_t)_expectedSequence count:lost];
+        }
+        // 解码器跳过依赖丢失数据的帧直到IDR，并请求关键帧
+        [self.videoDecoder reportDataLoss];
+        _expectedSequence = minSequence;
+    }
+}
+
+#pragma mark - Depacketize
+- (void)processPacketData:(NSData *)packetData {
+    const uint8_t *bytes = packetData.bytes;
+    size_t length = packetData.length;
+    BOOL hasPadding = (bytes[0] & 0x20) != 0;
+    BOOL hasExtension = (bytes[0] & 0x10) != 0;
+    uint8_t csrcCount = bytes[0] & 0x0F;
+    BOOL marker = (bytes[1] & 0x80) != 0;
+    uint32_t timestamp = ((uint32_t)bytes[4] << 24) | ((uint32_t)bytes[5] << 16) | ((uint32_t)bytes[6] << 8) | bytes[7];
+
+    size_t offset = CQRTPHeaderSize + csrcCount * 4;
+    if (hasExtension) {
+        if (offset + 4 > length) return;
+        size_t extensionLength = ((bytes[offset + 2] << 8) | bytes[offset + 3]) * 4;
+        offset += 4 + extensionLength;
+    }
+    if (offset > length) return;
+    if (hasPadding) {
+        // 填充长度包含最后这个字节，不能为0，也不能超过头之后的部分
+        uint8_t padding = bytes[length - 1];
+        if (padding == 0 || padding > length - offset) return;
+        length -= padding;
+    }
+    if (offset >= length) return;
+
+    // 时间戳变化说明上一帧的最后一个包(marker)丢了，直接输出已收到的部分
+    if (_hasCurrentTimestamp && timestamp != _currentTimestamp) {
+        [self outputCurrentFrame];
+    }
+    _hasCurrentTimestamp = YES;
+    _currentTimestamp = timestamp;
+
+    if (self.payloadFormat == CQRTPPayloadFormatH264) {
+        [self processH264Payload:bytes + offset length:length - offset];
+    } else if (self.payloadFormat == CQRTPPayloadFormatH265) {
+        [self processH265Payload:bytes + offset length:length - offset];
+    } else {
+        [self processAACPayload:bytes + offset length:length - offset];
+    }
+    if (marker) {
+        [self outputCurrentFrame];
+    }
+}
+
+- (void)processH264Payload:(const uint8_t *)payload length:(size_t)length {
+    uint8_t type = payload[0] & 0x1F;
+    if (type >= 1 && type <= 23) {
+        // Single NAL
+        [self appendNalu:payload length:length];
+    } else if (type == 24) {
+        // STAP-A
+        size_t offset = 1;
+        while (offset + 2 <= length) {
+            size_t size = (payload[offset] << 8) | payload[offset + 1];
+            offset += 2;
+            if (size == 0 || offset + size > length) break;
+            [self appendNalu:payload + offset length:size];
+            offset += size;
+        }
+    } else if (type == 28 && length > 2) {
+        // FU-A
+        BOOL isStart = (payload[1] & 0x80) != 0;
+        BOOL isEnd = (payload[1] & 0x40) != 0;
+        if (isStart) {
+            static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+            uint8_t naluHeader = (payload[0] & 0xE0) | (payload[1] & 0x1F);
+            self.fragmentBuffer = [NSMutableData dataWithCapacity:length * 8];
+            [self.fragmentBuffer appendBytes:startCode length:4];
+            [self.fragmentBuffer appendBytes:&naluHeader length:1];
+        }
+        // 没有收到起始分片(丢包)时忽略
+        if (!self.fragmentBuffer) return;
+        [self.fragmentBuffer appendBytes:payload + 2 length:length - 2];
+        if (isEnd) {
+            [self.currentNalus addObject:self.fragmentBuffer];
+            self.fragmentBuffer = nil;
+        }
+    }
+}
+
+- (void)processH265Payload:(const uint8_t *)payload length:(size_t)length {
+    if (length < 3) return;
+    CQHEVCNaluType type = CQHEVCNaluTypeOf(payload);
+    if (type == CQHEVCNaluTypeAP) {
+        // AP，不带DONL(sprop-max-don-diff为0)
+        size_t offset = 2;
+        while (offset + 2 <= length) {
+            size_t size = (payload[offset] << 8) | payload[offset + 1];
+            offset += 2;
+            if (size < 2 || offset + size > length) break;
+            [self appendNalu:payload + offset length:size];
+            offset += size;
+        }
+    } else if (type == CQHEVCNaluTypeFU) {
+        BOOL isStart = (payload[2] & 0x80) != 0;
+        BOOL isEnd = (payload[2] & 0x40) != 0;
+        if (isStart) {
+            // NALU头: 负载头的F/LayerId/TID + FU header里的类型
+            static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+            uint8_t naluHeader[2] = {(uint8_t)((payload[0] & 0x81) | ((payload[2] & 0x3F) << 1)), payload[1]};
+            self.fragmentBuffer = [NSMutableData dataWithCapacity:length * 8];
+            [self.fragmentBuffer appendBytes:startCode length:4];
+            [self.fragmentBuffer appendBytes:naluHeader length:2];
+        }
+        if (!self.fragmentBuffer) return;
+        [self.fragmentBuffer appendBytes:payload + 3 length:length - 3];
+        if (isEnd) {
+            [self.currentNalus addObject:self.fragmentBuffer];
+            self.fragmentBuffer = nil;
+        }
+    } else if (type < CQHEVCNaluTypeAP) {
+        // Single NAL
+        [self appendNalu:payload length:length];
+    }
+}
+
+- (void)appendNalu:(const uint8_t *)nalu length:(size_t)length {
+    static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+    NSMutableData *data = [NSMutableData dataWithCapacity:4 + length];
+    [data appendBytes:startCode length:4];
+    [data appendBytes:nalu length:length];
+    [self.currentNalus addObject:data];
+}
+
+- (void)processAACPayload:(const uint8_t *)payload length:(size_t)length {
+    if (length < 2) return;
+    size_t headersBits = (payload[0] << 8) | payload[1];
+    size_t headerCount = headersBits / 16;
+    size_t dataOffset = 2 + (headersBits + 7) / 8;
+    if (headerCount == 0 || dataOffset > length) return;
+
+    const uint8_t *headers = payload + 2;
+    size_t firstSize = ((headers[0] << 8) | headers[1]) >> 3;
+    size_t available = length - dataOffset;
+    // 单个AU大于负载说明是分片，后续分片的AU-header仍是完整AU的长度
+    BOOL continuesFragment = self.fragmentBuffer && _fragmentExpectedSize == firstSize;
+    if (headerCount == 1 && (firstSize > available || continuesFragment)) {
+        if (!continuesFragment) {
+            self.fragmentBuffer = [NSMutableData dataWithCapacity:firstSize];
+            _fragmentExpectedSize = firstSize;
+        }
+        [self.fragmentBuffer appendBytes:payload + dataOffset length:MIN(available, firstSize - self.fragmentBuffer.length)];
+        if (self.fragmentBuffer.length >= firstSize) {
+            [self.currentNalus addObject:self.fragmentBuffer];
+            self.fragmentBuffer = nil;
+        }
+        return;
+    }
+    size_t offset = dataOffset;
+    for (size_t i = 0; i < headerCount; i++) {
+        size_t size = ((headers[i * 2] << 8) | headers[i * 2 + 1]) >> 3;
+        if (offset + size > length) break;
+        [self.currentNalus addObject:[NSData dataWithBytes:payload + offset length:size]];
+        offset += size;
+    }
+}
+
+#pragma mark - Output
+- (void)outputCurrentFrame {
+    if (self.currentNalus.count == 0) return;
+    NSArray<NSData *> *frame = [self.currentNalus copy];
+    [self.currentNalus removeAllObjects];
+    uint32_t timestamp = _currentTimestamp;
+    if (self.payloadFormat == CQRTPPayloadFormatH264 || self.payloadFormat == CQRTPPayloadFormatH265) {
+        if (self.delegate && [self.delegate respondsToSelector:@selector(rtpDepacketizer:didOutputH264Nalus:timestamp:)]) {
+            [self.delegate rtpDepacketizer:self didOutputH264Nalus:frame timestamp:timestamp];
+        }
+        for (NSData *nalu in frame) {
+            [self.videoDecoder videoDecodeWithH264Data:nalu];
+        }
+    } else {
+        for (NSData *aacData in frame) {
+            if (self.delegate && [self.delegate respondsToSelector:@selector(rtpDepacketizer:didOutputAACData:timestamp:)]) {
+                [self.delegate rtpDepacketizer:self didOutputAACData:aacData timestamp:timestamp];
+            }
+            [self.audioDecoder audioDecodeWithAACData:aacData];
+        }
+    }
+}
+
+@end
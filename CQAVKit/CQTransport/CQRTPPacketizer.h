@@ -0,0 +1,99 @@
+//
+//  CQRTPPacketizer.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreMedia/CMTime.h>
+#import <sys/uio.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+static const NSUInteger CQRTPHeaderSize = 12;  ///< RTP固定头长度(无CSRC/扩展)
+
+/// RTP负载格式
+typedef NS_ENUM(NSUInteger, CQRTPPayloadFormat) {
+    CQRTPPayloadFormatH264 = 0,  ///< H264，RFC 6184 (Single NAL / STAP-A / FU-A)
+    CQRTPPayloadFormatAAC = 1,  ///< AAC，RFC 3640 AAC-hbr
+    CQRTPPayloadFormatFEC = 2,  ///< FEC修复包，由CQFECEncoder生成
+    CQRTPPayloadFormatH265 = 3,  ///< HEVC，RFC 7798 (Single NAL / AP / FU)
+};
+
+#pragma mark - CQRTPPacket
+/**
+ RTP包
+ @discussion 包由若干片段组成: RTP头、FU/STAP等少量头字节保存在包内，NALU数据只引用编码器输出的NSData，不拷贝
+ 发送时用fillIOVec:maxCount:填充iovec，直接交给sendmsg
+ */
+@interface CQRTPPacket : NSObject
+
+@property (nonatomic, assign, readonly) CQRTPPayloadFormat payloadFormat;  ///< 负载格式
+@property (nonatomic, assign, readonly) uint16_t sequenceNumber;  ///< 序列号
+@property (nonatomic, assign, readonly) uint32_t timestamp;  ///< RTP时间戳
+@property (nonatomic, assign, readonly) BOOL marker;  ///< 标记位，视频为一帧的最后一个包
+@property (nonatomic, assign, readonly) BOOL isKeyFrame;  ///< 是否属于关键帧(含参数集/IDR/IRAP)
+@property (nonatomic, assign, readonly) NSUInteger length;  ///< 包总长度(含RTP头)
+@property (nonatomic, assign, readonly) int iovecCount;  ///< 片段个数
+
+/**
+ 填充iovec
+ @param iov iovec数组
+ @param maxCount 数组容量，至少为iovecCount
+ @return 填充的个数，容量不足返回0
+ */
+- (int)fillIOVec:(struct iovec *)iov maxCount:(int)maxCount;
+
+/// 拷贝成连续内存(重传、FEC等需要保存完整包时使用)
+- (NSData *)serializedData;
+
+@end
+
+#pragma mark - CQRTPPacketizer
+/**
+ RTP分包器
+ @discussion 按MTU将CQVideoEncoder/CQAudioEncoder的输出切分为RTP包
+ H264: 小于MTU的NALU单包发送，连续的sps/pps/SEI用STAP-A聚合，大于MTU的NALU用FU-A分片，每帧最后一个包打marker
+ HEVC: 和H264相同，聚合包为AP(类型48)，分片为FU(类型49)，负载头都是2字节
+ AAC: AAC-hbr，每包一个AU(13位长度+3位索引)，超过MTU时分片
+ 非线程安全，同一个分包器应在同一个队列使用(例如编码器的回调队列)
+ */
+@interface CQRTPPacketizer : NSObject
+
+/**
+ 唯一初始化函数
+ @param payloadFormat 负载格式
+ @param payloadType RTP负载类型，动态类型96-127
+ @param clockRate 时钟频率，H264/HEVC为90000，AAC为采样率
+ @param ssrc 同步源标识
+ */
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat payloadType:(uint8_t)payloadType clockRate:(uint32_t)clockRate ssrc:(uint32_t)ssrc;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) CQRTPPayloadFormat payloadFormat;  ///< 负载格式
+@property (nonatomic, assign, readonly) uint8_t payloadType;  ///< RTP负载类型
+@property (nonatomic, assign, readonly) uint32_t clockRate;  ///< 时钟频率
+@property (nonatomic, assign, readonly) uint32_t ssrc;  ///< 同步源标识
+@property (nonatomic, assign) NSUInteger mtu;  ///< RTP包最大长度(不含IP/UDP头)，默认1200
+
+/**
+ 打包一帧H264(payloadFormat为H265时按HEVC打包)
+ @param nalus 该帧的所有NALU，Annex-B格式(CQVideoEncoder的回调格式)，sps/pps(HEVC还有vps)也可以放在这里一起发送
+ @param pts 显示时间戳
+ @return RTP包，最后一个包marker为YES
+ */
+- (NSArray<CQRTPPacket *> *)packetizeH264Nalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts;
+
+/**
+ 打包一帧AAC
+ @param aacData AAC裸数据，带ADTS头时会去掉ADTS头
+ @param pts 显示时间戳
+ */
+- (NSArray<CQRTPPacket *> *)packetizeAACData:(NSData *)aacData pts:(CMTime)pts;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,305 @@
+//
+//  CQRTPPacketizer.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ RTP头 (12字节)
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ |V=2|P|X|  CC   |M|     PT      |       sequence number         |
+ |                           timestamp                           |
+ |                             SSRC                              |
+
+ H264 (RFC 6184)
+ Single NAL: RTP头 + NALU
+ STAP-A:     RTP头 + STAP-A头(F|NRI|24) + [2字节长度 + NALU] * N
+ FU-A:       RTP头 + FU indicator(F|NRI|28) + FU header(S|E|R|Type) + NALU分片(不含NALU头)
+
+ HEVC (RFC 7798)，负载头和NALU头一样是2字节(F|Type|LayerId|TID)
+ Single NAL: RTP头 + NALU
+ AP:         RTP头 + 负载头(Type 48) + [2字节长度 + NALU] * N
+ FU:         RTP头 + 负载头(Type 49) + FU header(S|E|Type) + NALU分片(不含NALU头)
+
+ AAC (RFC 3640 AAC-hbr)
+ RTP头 + AU-headers-length(16位，单位bit) + AU-header(13位AU长度 + 3位索引) + AU
+ */
+
+#import "CQRTPPacketizer.h"
+#import "CQNaluUtil.h"
+#import "CQADTSUtil.h"
+
+static const int kMaxSegmentCount = 32;  ///< 单个包最多片段数
+static const size_t kMaxHeaderBytes = 64;  ///< 单个包内自有字节数(RTP头 + STAP/AP/FU头)
+static const NSUInteger kMaxAggregationCount = 8;  ///< STAP-A/AP最多聚合的NALU数
+static const uint8_t kH264NaluTypeSTAPA = 24;
+static const uint8_t kH264NaluTypeFUA = 28;
+
+typedef struct {
+    __unsafe_unretained NSData *owner;  ///< 引用的数据，nil表示包内的头字节
+    size_t offset;
+    size_t length;
+} CQRTPPacketSegment;
+
+#pragma mark - CQRTPPacket
+@interface CQRTPPacket ()
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat payloadType:(uint8_t)payloadType sequenceNumber:(uint16_t)sequenceNumber timestamp:(uint32_t)timestamp ssrc:(uint32_t)ssrc marker:(BOOL)marker isKeyFrame:(BOOL)isKeyFrame;
+- (void)appendBytes:(const void *)bytes length:(size_t)length;
+- (void)appendData:(NSData *)data offset:(size_t)offset length:(size_t)length;
+@end
+
+@implementation CQRTPPacket
+{
+    uint8_t _headerBytes[kMaxHeaderBytes];  ///< 包内自有字节
+    size_t _headerLength;
+    CQRTPPacketSegment _segments[kMaxSegmentCount];
+    NSMutableArray<NSData *> *_owners;  ///< 持有被引用的数据
+}
+
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat payloadType:(uint8_t)payloadType sequenceNumber:(uint16_t)sequenceNumber timestamp:(uint32_t)timestamp ssrc:(uint32_t)ssrc marker:(BOOL)marker isKeyFrame:(BOOL)isKeyFrame {
+    if (self = [super init]) {
+        _payloadFormat = payloadFormat;
+        _sequenceNumber = sequenceNumber;
+        _timestamp = timestamp;
+        _marker = marker;
+        _isKeyFrame = isKeyFrame;
+        _owners = [NSMutableArray arrayWithCapacity:2];
+        uint8_t header[CQRTPHeaderSize];
+        header[0] = 0x80;  // V=2
+        header[1] = (marker ? 0x80 : 0x00) | (payloadType & 0x7F);
+        header[2] = sequenceNumber >> 8;
+        header[3] = sequenceNumber & 0xFF;
+        header[4] = timestamp >> 24;
+        header[5] = timestamp >> 16;
+        header[6] = timestamp >> 8;
+        header[7] = timestamp & 0xFF;
+        header[8] = ssrc >> 24;
+        header[9] = ssrc >> 16;
+        header[10] = ssrc >> 8;
+        header[11] = ssrc & 0xFF;
+        [self appendBytes:header length:CQRTPHeaderSize];
+    }
+    return self;
+}
+
+- (void)appendBytes:(const void *)bytes length:(size_t)length {
+    NSAssert(_headerLength + length <= kMaxHeaderBytes, @"CQRTPPacket header bytes overflow");
+    memcpy(_headerBytes + _headerLength, bytes, length);
+    // 与上一个头字节片段相邻时直接合并，减少iovec个数
+    CQRTPPacketSegment *last = _iovecCount > 0 ? &_segments[_iovecCount - 1] : NULL;
+    if (last && last->owner == nil && last->offset + last->length == _headerLength) {
+        last->length += length;
+    } else {
+        NSAssert(_iovecCount < kMaxSegmentCount, @"CQRTPPacket segment overflow");
+        _segments[_iovecCount++] = (CQRTPPacketSegment){nil, _headerLength, length};
+    }
+    _headerLength += length;
+    _length += length;
+}
+
+- (void)appendData:(NSData *)data offset:(size_t)offset length:(size_t)length {
+    NSAssert(_iovecCount < kMaxSegmentCount, @"CQRTPPacket segment overflow");
+    if (_owners.lastObject != data) [_owners addObject:data];
+    _segments[_iovecCount++] = (CQRTPPacketSegment){data, offset, length};
+    _length += length;
+}
+
+- (int)fillIOVec:(struct iovec *)iov maxCount:(int)maxCount {
+    if (maxCount < _iovecCount) return 0;
+    for (int i = 0; i < _iovecCount; i++) {
+        CQRTPPacketSegment segment = _segments[i];
+        const uint8_t *base = segment.owner ? (const uint8_t *)segment.owner.bytes : _headerBytes;
+        iov[i].iov_base = (void *)(base + segment.offset);
+        iov[i].iov_len = segment.length;
+    }
+    return _iovecCount;
+}
+
+- (NSData *)serializedData {
+    NSMutableData *data = [NSMutableData dataWithLength:_length];
+    uint8_t *p = data.mutableBytes;
+    for (int i = 0; i < _iovecCount; i++) {
+        CQRTPPacketSegment segment = _segments[i];
+        const uint8_t *base = segment.owner ? (const uint8_t *)segment.owner.bytes : _headerBytes;
+        memcpy(p, base + segment.offset, segment.length);
+        p += segment.length;
+    }
+    return data;
+}
+
+@end
+
+#pragma mark - CQRTPPacketizer
+/// NALU在编码数据中的位置
+typedef struct {
+    __unsafe_unretained NSData *data;
+    size_t offset;  ///< 跳过起始码后的偏移
+    size_t length;
+} CQRTPNaluRange;
+
+@implementation CQRTPPacketizer
+{
+    uint16_t _sequenceNumber;
+    uint32_t _initialTimestamp;  ///< 随机的初始时间戳
+    uint32_t _lastTimestamp;
+}
+
+#pragma mark - Init
+- (instancetype)initWithPayloadFormat:(CQRTPPayloadFormat)payloadFormat payloadType:(uint8_t)payloadType clockRate:(uint32_t)clockRate ssrc:(uint32_t)ssrc {
+    if (self = [super init]) {
+        _payloadFormat = payloadFormat;
+        _payloadType = payloadType;
+        _clockRate = clockRate;
+        _ssrc = ssrc;
+        _mtu = 1200;
+        _sequenceNumber = (uint16_t)arc4random_uniform(0x10000);
+        _initialTimestamp = arc4random();
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (NSArray<CQRTPPacket *> *)packetizeH264Nalus:(NSArray<NSData *> *)nalus pts:(CMTime)pts {
+    uint32_t timestamp = [self rtpTimestampFromTime:pts defaultDuration:self.clockRate / 25];
+    size_t maxPayload = self.mtu - CQRTPHeaderSize;
+    BOOL isHEVC = self.payloadFormat == CQRTPPayloadFormatH265;
+    CQVideoCodec codec = isHEVC ? CQVideoCodecHEVC : CQVideoCodecH264;
+    size_t headerSize = CQNaluHeaderSize(codec);
+
+    // 去掉起始码，记录每个NALU的位置
+    NSUInteger count = 0;
+    CQRTPNaluRange ranges[nalus.count > 0 ? nalus.count : 1];
+    BOOL isKeyFrame = NO;
+    for (NSData *nalu in nalus) {
+        size_t size = 0;
+        const uint8_t *p = CQNaluSkipStartCode(nalu.bytes, nalu.length, &size);
+        if (!p || size < headerSize) continue;
+        CQNaluKind kind = CQNaluKindOf(codec, p);
+        if (kind == CQNaluKindAUD) continue;
+        if (kind == CQNaluKindKeyFrame || kind == CQNaluKindParameterSet) isKeyFrame = YES;
+        ranges[count++] = (CQRTPNaluRange){nalu, (size_t)(p - (const uint8_t *)nalu.bytes), size};
+    }
+
+    NSMutableArray<CQRTPPacket *> *packets = [NSMutableArray array];
+    NSUInteger i = 0;
+    while (i < count) {
+        CQRTPNaluRange range = ranges[i];
+        const uint8_t *nalu = (const uint8_t *)range.data.bytes + range.offset;
+        if (range.length <= maxPayload) {
+            // 尝试STAP-A/AP聚合连续的参数集/SEI
+            NSUInteger aggregateEnd = i;
+            size_t aggregateSize = headerSize;
+            while (aggregateEnd < count && aggregateEnd - i < kMaxAggregationCount) {
+                CQRTPNaluRange next = ranges[aggregateEnd];
+                CQNaluKind kind = CQNaluKindOf(codec, (const uint8_t *)next.data.bytes + next.offset);
+                BOOL canAggregate = kind == CQNaluKindParameterSet || kind == CQNaluKindSEI;
+                if (!canAggregate || aggregateSize + 2 + next.length > maxPayload) break;
+                aggregateSize += 2 + next.length;
+                aggregateEnd++;
+            }
+            if (aggregateEnd - i >= 2) {
+                CQRTPPacket *packet = [self packetWithTimestamp:timestamp marker:(aggregateEnd == count) isKeyFrame:isKeyFrame];
+                if (isHEVC) {
+                    // AP负载头: LayerId取第一个NALU的，TID取所有NALU中最小的
+                    uint8_t tidPlus1 = 7;
+                    for (NSUInteger j = i; j < aggregateEnd; j++) {
+                        tidPlus1 = MIN(tidPlus1, ((const uint8_t *)ranges[j].data.bytes)[ranges[j].offset + 1] & 0x07);
+                    }
+                    uint8_t apHeader[2] = {(uint8_t)((nalu[0] & 0x81) | (CQHEVCNaluTypeAP << 1)), (uint8_t)((nalu[1] & 0xF8) | tidPlus1)};
+                    [packet appendBytes:apHeader length:2];
+                } else {
+                    uint8_t nri = 0;
+                    for (NSUInteger j = i; j < aggregateEnd; j++) {
+                        nri = MAX(nri, ((const uint8_t *)ranges[j].data.bytes)[ranges[j].offset] & 0x60);
+                    }
+                    uint8_t stapHeader = nri | kH264NaluTypeSTAPA;
+                    [packet appendBytes:&stapHeader length:1];
+                }
+                for (NSUInteger j = i; j < aggregateEnd; j++) {
+                    uint8_t size[2] = {(uint8_t)(ranges[j].length >> 8), (uint8_t)(ranges[j].length & 0xFF)};
+                    [packet appendBytes:size length:2];
+                    [packet appendData:ranges[j].data offset:ranges[j].offset length:ranges[j].length];
+                }
+                [packets addObject:packet];
+                i = aggregateEnd;
+                continue;
+            }
+            // Single NAL
+            CQRTPPacket *packet = [self packetWithTimestamp:timestamp marker:(i == count - 1) isKeyFrame:isKeyFrame];
+            [packet appendData:range.data offset:range.offset length:range.length];
+            [packets addObject:packet];
+            i++;
+            continue;
+        }
+
+        // FU-A/FU，NALU头拆到FU indicator(HEVC为2字节负载头)和FU header中，分片数据从NALU头之后开始
+        uint8_t fuHeader[3];
+        uint8_t naluType;
+        if (isHEVC) {
+            fuHeader[0] = (nalu[0] & 0x81) | (CQHEVCNaluTypeFU << 1);
+            fuHeader[1] = nalu[1];
+            naluType = CQHEVCNaluTypeOf(nalu);
+        } else {
+            fuHeader[0] = (nalu[0] & 0xE0) | kH264NaluTypeFUA;
+            naluType = nalu[0] & 0x1F;
+        }
+        size_t offset = headerSize;
+        size_t fragmentSize = maxPayload - headerSize - 1;
+        while (offset < range.length) {
+            size_t length = MIN(fragmentSize, range.length - offset);
+            BOOL isStart = offset == headerSize;
+            BOOL isEnd = offset + length == range.length;
+            CQRTPPacket *packet = [self packetWithTimestamp:timestamp marker:(isEnd && i == count - 1) isKeyFrame:isKeyFrame];
+            fuHeader[headerSize] = (uint8_t)((isStart ? 0x80 : 0x00) | (isEnd ? 0x40 : 0x00) | naluType);
+            [packet appendBytes:fuHeader length:headerSize + 1];
+            [packet appendData:range.data offset:range.offset + offset length:length];
+            [packets addObject:packet];
+            offset += length;
+        }
+        i++;
+    }
+    return packets;
+}
+
+- (NSArray<CQRTPPacket *> *)packetizeAACData:(NSData *)aacData pts:(CMTime)pts {
+    uint32_t timestamp = [self rtpTimestampFromTime:pts defaultDuration:1024];
+    size_t headerLength = CQADTSHeaderLength(aacData.bytes, aacData.length);
+    size_t auSize = aacData.length - headerLength;
+    if (auSize == 0) return @[];
+
+    // AU-headers-length固定16位(一个AU-header)，AU-header: 13位长度 + 3位索引，分片时长度仍为完整AU的长度
+    uint8_t auHeader[4] = {0x00, 0x10, (uint8_t)((auSize >> 5) & 0xFF), (uint8_t)((auSize & 0x1F) << 3)};
+    size_t maxAUPayload = self.mtu - CQRTPHeaderSize - sizeof(auHeader);
+    NSMutableArray<CQRTPPacket *> *packets = [NSMutableArray array];
+    size_t offset = 0;
+    while (offset < auSize) {
+        size_t length = MIN(maxAUPayload, auSize - offset);
+        BOOL isLast = offset + length == auSize;
+        CQRTPPacket *packet = [self packetWithTimestamp:timestamp marker:isLast isKeyFrame:NO];
+        [packet appendBytes:auHeader length:sizeof(auHeader)];
+        [packet appendData:aacData offset:headerLength + offset length:length];
+        [packets addObject:packet];
+        offset += length;
+    }
+    return packets;
+}
+
+#pragma mark - Private Func
+- (CQRTPPacket *)packetWithTimestamp:(uint32_t)timestamp marker:(BOOL)marker isKeyFrame:(BOOL)isKeyFrame {
+    return [[CQRTPPacket alloc] initWithPayloadFormat:self.payloadFormat payloadType:self.payloadType sequenceNumber:_sequenceNumber++ timestamp:timestamp ssrc:self.ssrc marker:marker isKeyFrame:isKeyFrame];
+}
+
+/// CMTime转RTP时间戳，时间无效时按默认时长递增
+- (uint32_t)rtpTimestampFromTime:(CMTime)time defaultDuration:(uint32_t)duration {
+    if (CMTIME_IS_VALID(time)) {
+        int64_t ticks = CMTimeConvertScale(time, (int32_t)self.clockRate, kCMTimeRoundingMethod_RoundHalfAwayFromZero).value;
+        _lastTimestamp = _initialTimestamp + (uint32_t)ticks;
+    } else {
+        _lastTimestamp += duration;
+    }
+    return _lastTimestamp;
+}
+
+@end
@@ -0,0 +1,114 @@
+//
+//  CQRetransmission.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQRTPPacketizer.h"
+#import "CQNackTracker.h"
+
+@class CQRetransmissionBuffer, CQPacketPacer, CQVideoEncoder;
+
+NS_ASSUME_NONNULL_BEGIN
+
+#pragma mark - CQNackGenerator
+/**
+ NACK生成器(接收端)
+ @discussion 按序列号发现丢包，定时调用buildRTCPAtTime:生成NACK/PLI发回发送端(建议10~20ms一次)
+ 重传等待时间和重复间隔按RTT调整，赶不上播放截止时间时改为请求关键帧
+ 和CQFECDecoder一起使用时，收到的媒体包和FEC恢复的包都要输入，恢复的包不再请求重传
+ 非线程安全，应在接收队列使用
+ */
+@interface CQNackGenerator : NSObject
+
+/**
+ 唯一初始化函数
+ @param mediaSSRC 媒体SSRC，其他SSRC的包忽略
+ @param config 配置，一般用CQNackTrackerDefaultConfig()，playoutDeadlineUs应和接收端缓冲时长一致
+ */
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC config:(CQNackTrackerConfig)config;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) uint32_t mediaSSRC;  ///< 媒体SSRC
+@property (nonatomic, assign) uint32_t ssrc;  ///< 本端SSRC(写在RTCP的发送端SSRC)，默认0
+@property (nonatomic, assign, readonly) NSTimeInterval rtt;  ///< RTT估计
+@property (nonatomic, assign, readonly) NSUInteger nackedCount;  ///< 请求重传的次数(按包)
+@property (nonatomic, assign, readonly) NSUInteger abandonedCount;  ///< 放弃重传的包数
+@property (nonatomic, assign, readonly) NSUInteger keyFrameRequestCount;  ///< 请求关键帧的次数
+
+/**
+ 收到RTP包
+ @param rtpData RTP数据报
+ @param arrivalTimeUs 到达时间(单调时钟微秒)
+ */
+- (void)onRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs;
+
+/// FEC恢复出的包(不用来测RTT)
+- (void)onRecoveredRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs;
+
+/**
+ 生成现在要发送的RTCP
+ @param nowUs 当前时间(和到达时间同一个时钟)
+ @return NACK和/或PLI，没有要发送的返回空数组
+ */
+- (NSArray<NSData *> *)buildRTCPAtTime:(uint64_t)nowUs;
+
+@end
+
+#pragma mark - CQRetransmissionBuffer
+@protocol CQRetransmissionBufferDelegate <NSObject>
+@optional
+/// 需要重传的包(没有设置pacer时回调，由外部发送)
+- (void)retransmissionBuffer:(CQRetransmissionBuffer *)buffer retransmitPackets:(NSArray<CQRTPPacket *> *)packets;
+
+/// 收到关键帧请求
+- (void)retransmissionBufferDidReceiveKeyFrameRequest:(CQRetransmissionBuffer *)buffer;
+@end
+
+/**
+ 重传缓存(发送端)
+ @discussion 按序列号保存最近maxHistoryDuration内发出的CQRTPPacket，包只引用编码器输出的数据，不拷贝
+ 收到NACK后找出仍在缓存里、重传次数没超过上限、距上次重传超过最小间隔的包，以重传优先级交给pacer(或回调)
+ 收到PLI时让videoEncoder出关键帧
+ 线程安全
+ */
+@interface CQRetransmissionBuffer : NSObject
+
+/**
+ 唯一初始化函数
+ @param mediaSSRC 媒体SSRC，其它SSRC的NACK忽略
+ */
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) uint32_t mediaSSRC;  ///< 媒体SSRC
+@property (nonatomic, weak) id<CQRetransmissionBufferDelegate> delegate;  ///< 代理
+@property (nonatomic, weak, nullable) CQPacketPacer *pacer;  ///< 设置后重传包直接以重传优先级进入平滑发送
+@property (nonatomic, weak, nullable) CQVideoEncoder *videoEncoder;  ///< 设置后收到PLI直接请求关键帧
+
+@property (nonatomic, assign) NSTimeInterval maxHistoryDuration;  ///< 保存时长，默认1秒
+@property (nonatomic, assign) NSUInteger maxRetransmissions;  ///< 每个包最多重传次数，默认3
+@property (nonatomic, assign) NSTimeInterval minRetransmissionInterval;  ///< 同一个包两次重传的最小间隔，默认0.01秒
+
+@property (nonatomic, assign, readonly) NSUInteger retransmittedCount;  ///< 重传的包数
+@property (nonatomic, assign, readonly) NSUInteger missedCount;  ///< 请求时已经不在缓存或超过次数的包数
+@property (nonatomic, assign, readonly) NSUInteger keyFrameRequestCount;  ///< 收到的关键帧请求数
+
+/// 保存发出的包(分包后或平滑发送器发出时调用)
+- (void)addPackets:(NSArray<CQRTPPacket *> *)packets;
+
+/**
+ 收到RTCP
+ @return 是NACK或PLI时返回YES
+ */
+- (BOOL)onRTCPData:(NSData *)rtcpData;
+
+@end
+
+NS_ASSUME_NONNULL_END
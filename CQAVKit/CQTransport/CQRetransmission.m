@@ -0,0 +1,219 @@
+//
+//  CQRetransmission.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 接收端
+ 1 丢包跟踪和定时都在CQNackTracker里(纯C)，这里只解析RTP头、生成RTCP
+ 发送端
+ 1 发出的包按序列号放进环形数组(持有CQRTPPacket，不拷贝数据)，记录保存时间
+ 2 每次保存时从最老的包开始删除超过保存时长的包，缓存大小只和码率、时长有关
+ 3 NACK里的序列号逐个查找，满足次数和间隔限制的包以重传优先级进入pacer，pacer的重传优先级排在关键帧之后、普通视频之前
+ */
+
+#import "CQRetransmission.h"
+#import "CQPacketPacer.h"
+#import "CQVideoEncoder.h"
+#import <os/lock.h>
+#import <time.h>
+
+#define kRetransmissionHistorySize 4096
+static const size_t kMaxNackSequenceCount = 512;  ///< 一次NACK最多处理的序列号个数
+
+static inline uint64_t CQRetransmissionNowMicros(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000;
+}
+
+#pragma mark - CQNackGenerator
+@implementation CQNackGenerator
+{
+    CQNackTracker *_tracker;
+}
+
+#pragma mark - Init
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC config:(CQNackTrackerConfig)config {
+    if (self = [super init]) {
+        _mediaSSRC = mediaSSRC;
+        _tracker = CQNackTrackerCreate(config);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CQNackTrackerDestroy(_tracker);
+    NSLog(@"CQNackGenerator - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (NSTimeInterval)rtt {
+    return CQNackTrackerRtt(_tracker) / 1000000.0;
+}
+
+- (NSUInteger)abandonedCount {
+    return (NSUInteger)CQNackTrackerAbandonedCount(_tracker);
+}
+
+- (void)onRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs {
+    [self receiveRTPData:rtpData arrivalTime:arrivalTimeUs isRecovered:NO];
+}
+
+- (void)onRecoveredRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs {
+    [self receiveRTPData:rtpData arrivalTime:arrivalTimeUs isRecovered:YES];
+}
+
+- (NSArray<NSData *> *)buildRTCPAtTime:(uint64_t)nowUs {
+    uint16_t sequenceNumbers[kMaxNackSequenceCount];
+    BOOL needsKeyFrame = NO;
+    size_t count = CQNackTrackerCollect(_tracker, nowUs, sequenceNumbers, kMaxNackSequenceCount, &needsKeyFrame);
+    NSMutableArray<NSData *> *packets = [NSMutableArray array];
+    if (count > 0) {
+        NSMutableData *nack = [NSMutableData dataWithLength:12 + count * 4];
+        nack.length = CQRTCPWriteNack(nack.mutableBytes, nack.length, self.ssrc, self.mediaSSRC, sequenceNumbers, count);
+        [packets addObject:nack];
+        _nackedCount += count;
+    }
+    if (needsKeyFrame) {
+        NSMutableData *pli = [NSMutableData dataWithLength:CQRTCPPLISize];
+        CQRTCPWritePLI(pli.mutableBytes, self.ssrc, self.mediaSSRC);
+        [packets addObject:pli];
+        _keyFrameRequestCount++;
+    }
+    return packets;
+}
+
+#pragma mark - Private Func
+- (void)receiveRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs isRecovered:(BOOL)isRecovered {
+    const uint8_t *bytes = rtpData.bytes;
+    if (rtpData.length < CQRTPHeaderSize || (bytes[0] >> 6) != 2) return;
+    uint32_t ssrc = ((uint32_t)bytes[8] << 24) | ((uint32_t)bytes[9] << 16) | ((uint32_t)bytes[10] << 8) | bytes[11];
+    if (ssrc != self.mediaSSRC) return;
+    CQNackTrackerOnPacket(_tracker, (uint16_t)((bytes[2] << 8) | bytes[3]), arrivalTimeUs, isRecovered);
+}
+
+@end
+
+#pragma mark - CQRetransmissionBuffer
+/// 缓存的包
+typedef struct {
+    CFTypeRef packet;  ///< CQRTPPacket，NULL为空
+    uint16_t sequenceNumber;
+    uint32_t retransmissions;  ///< 已重传次数
+    uint64_t storedUs;  ///< 保存时间
+    uint64_t lastRetransmitUs;  ///< 上次重传时间
+} CQStoredPacket;
+
+@implementation CQRetransmissionBuffer
+{
+    os_unfair_lock _lock;
+    CQStoredPacket _history[kRetransmissionHistorySize];
+    BOOL _hasPackets;
+    uint16_t _oldestSequence;
+    uint16_t _newestSequence;
+}
+
+#pragma mark - Init
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC {
+    if (self = [super init]) {
+        _mediaSSRC = mediaSSRC;
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _maxHistoryDuration = 1.0;
+        _maxRetransmissions = 3;
+        _minRetransmissionInterval = 0.01;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    for (size_t i = 0; i < kRetransmissionHistorySize; i++) {
+        if (_history[i].packet) CFRelease(_history[i].packet);
+    }
+    NSLog(@"CQRetransmissionBuffer - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (void)addPackets:(NSArray<CQRTPPacket *> *)packets {
+    if (packets.count == 0) return;
+    uint64_t now = CQRetransmissionNowMicros();
+    uint64_t maxAgeUs = (uint64_t)(self.maxHistoryDuration * 1000000);
+    os_unfair_lock_lock(&_lock);
+    for (CQRTPPacket *packet in packets) {
+        CQStoredPacket *stored = &_history[packet.sequenceNumber % kRetransmissionHistorySize];
+        if (stored->packet) CFRelease(stored->packet);
+        *stored = (CQStoredPacket){
+            .packet = CFBridgingRetain(packet),
+            .sequenceNumber = packet.sequenceNumber,
+            .storedUs = now,
+        };
+        if (!_hasPackets) {
+            _hasPackets = YES;
+            _oldestSequence = packet.sequenceNumber;
+        }
+        _newestSequence = packet.sequenceNumber;
+    }
+    // 从最老的包开始删除过期的
+    if ((uint16_t)(_newestSequence - _oldestSequence) >= kRetransmissionHistorySize) {
+        _oldestSequence = (uint16_t)(_newestSequence - kRetransmissionHistorySize + 1);
+    }
+    while (_oldestSequence != _newestSequence) {
+        CQStoredPacket *stored = &_history[_oldestSequence % kRetransmissionHistorySize];
+        if (stored->packet && stored->sequenceNumber == _oldestSequence) {
+            if (now - stored->storedUs <= maxAgeUs) break;
+            CFRelease(stored->packet);
+            stored->packet = NULL;
+        }
+        _oldestSequence++;
+    }
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (BOOL)onRTCPData:(NSData *)rtcpData {
+    uint32_t mediaSSRC = 0;
+    if (CQRTCPIsPLI(rtcpData.bytes, rtcpData.length, &mediaSSRC)) {
+        if (mediaSSRC != self.mediaSSRC) return NO;
+        os_unfair_lock_lock(&_lock);
+        _keyFrameRequestCount++;
+        os_unfair_lock_unlock(&_lock);
+        [self.videoEncoder requestKeyFrame];
+        if (self.delegate && [self.delegate respondsToSelector:@selector(retransmissionBufferDidReceiveKeyFrameRequest:)]) {
+            [self.delegate retransmissionBufferDidReceiveKeyFrameRequest:self];
+        }
+        return YES;
+    }
+    uint16_t sequenceNumbers[kMaxNackSequenceCount];
+    size_t count = CQRTCPParseNack(rtcpData.bytes, rtcpData.length, &mediaSSRC, sequenceNumbers, kMaxNackSequenceCount);
+    if (count == 0 || mediaSSRC != self.mediaSSRC) return NO;
+
+    uint64_t now = CQRetransmissionNowMicros();
+    uint64_t maxAgeUs = (uint64_t)(self.maxHistoryDuration * 1000000);
+    uint64_t minIntervalUs = (uint64_t)(self.minRetransmissionInterval * 1000000);
+    NSMutableArray<CQRTPPacket *> *packets = [NSMutableArray arrayWithCapacity:count];
+    os_unfair_lock_lock(&_lock);
+    for (size_t i = 0; i < count; i++) {
+        CQStoredPacket *stored = &_history[sequenceNumbers[i] % kRetransmissionHistorySize];
+        if (!stored->packet || stored->sequenceNumber != sequenceNumbers[i] || now - stored->storedUs > maxAgeUs || stored->retransmissions >= self.maxRetransmissions) {
+            _missedCount++;
+            continue;
+        }
+        // 上一次的重传可能还在路上
+        if (stored->retransmissions > 0 && now - stored->lastRetransmitUs < minIntervalUs) continue;
+        stored->retransmissions++;
+        stored->lastRetransmitUs = now;
+        [packets addObject:(__bridge CQRTPPacket *)stored->packet];
+    }
+    _retransmittedCount += packets.count;
+    os_unfair_lock_unlock(&_lock);
+
+    if (packets.count == 0) return YES;
+    if (self.pacer) {
+        [self.pacer enqueuePackets:packets priority:CQPacerPriorityRetransmission];
+    } else if (self.delegate && [self.delegate respondsToSelector:@selector(retransmissionBuffer:retransmitPackets:)]) {
+        [self.delegate retransmissionBuffer:self retransmitPackets:packets];
+    }
+    return YES;
+}
+
+@end
@@ -0,0 +1,119 @@
+//
+//  CQStreamFanout.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 流分发(纯C，非线程安全，所有函数应在同一个队列调用)
+ @discussion 每个tag只生成一份CQFanoutBuffer，所有客户端的发送队列引用同一份数据，用writev直接发送，不拷贝
+ GOP缓存保存最近一个关键帧起的所有tag，新客户端连上后先发头部再发GOP缓存，从关键帧开始播放
+ 客户端队列超过上限的一半时先丢非参考帧(CQFanoutTagKindDroppable)，帧率降低但画面连续；
+ 超过maxQueuedBytes或队首等待超过maxQueueDelayUs时不再入队，等到下一个关键帧丢掉队列里未开始发送的tag(头部tag保留)，从新的GOP继续；
+ 有数据待发却超过maxStallUs没有写出任何字节的客户端断开
+ */
+
+/// 引用计数的数据块
+typedef struct CQFanoutBuffer CQFanoutBuffer;
+
+/**
+ 创建数据块(引用计数为1)
+ @param bytes 数据，不拷贝，在释放回调前必须有效
+ @param length 长度
+ @param context 回调参数
+ @param releaseCallback 引用计数为0时调用，用来释放数据的持有者，可以为NULL
+ */
+FOUNDATION_EXPORT CQFanoutBuffer *CQFanoutBufferCreate(const void *bytes, size_t length, void * _Nullable context, void (* _Nullable releaseCallback)(void * _Nullable context));
+FOUNDATION_EXPORT CQFanoutBuffer *CQFanoutBufferRetain(CQFanoutBuffer *buffer);
+FOUNDATION_EXPORT void CQFanoutBufferRelease(CQFanoutBuffer *buffer);
+FOUNDATION_EXPORT size_t CQFanoutBufferLength(const CQFanoutBuffer *buffer);
+
+/// tag类型
+typedef NS_ENUM(uint8_t, CQFanoutTagKind) {
+    CQFanoutTagKindHeader = 0,  ///< 序列头等配置，从不丢弃，会使GOP缓存失效
+    CQFanoutTagKindKeyFrame = 1,  ///< 关键帧，开始新的GOP(纯音频时每一帧都是)
+    CQFanoutTagKindFrame = 2,  ///< 其它帧
+    CQFanoutTagKindDroppable = 3,  ///< 非参考帧(见CQFrameClassifier)，丢掉不影响其它帧，客户端积压时最先丢
+};
+
+/// 客户端事件
+typedef NS_ENUM(uint8_t, CQFanoutClientEvent) {
+    CQFanoutClientEventWantsWrite = 0,  ///< 有数据没写完，需要监听可写
+    CQFanoutClientEventDrained = 1,  ///< 队列已写完，停止监听可写
+    CQFanoutClientEventClosed = 2,  ///< 出错或太慢被断开，回调后客户端被释放，fd由调用方关闭
+};
+
+typedef struct CQFanoutClient CQFanoutClient;
+
+/**
+ 客户端事件回调
+ @param context CQStreamFanoutCreate传入的参数
+ @param fd 客户端fd
+ @param clientContext CQStreamFanoutAddClient传入的参数
+ */
+typedef void (*CQStreamFanoutEventCallback)(void * _Nullable context, int fd, void * _Nullable clientContext, CQFanoutClientEvent event);
+
+/// 分发配置
+typedef struct {
+    size_t maxQueuedBytes;  ///< 客户端队列字节数上限，超过后跳到下一个GOP
+    uint64_t maxQueueDelayUs;  ///< 客户端队首tag的最长等待时间，超过后跳到下一个GOP(限制慢客户端的延迟)
+    uint64_t maxStallUs;  ///< 有数据待发但一直写不出去的最长时间，超过后断开
+    size_t maxGOPCacheBytes;  ///< GOP缓存上限，超过后缓存失效直到下一个关键帧
+} CQStreamFanoutConfig;
+
+/// 默认配置: 队列4MB或等待2秒，5秒写不出去断开，GOP缓存2MB
+FOUNDATION_EXPORT CQStreamFanoutConfig CQStreamFanoutDefaultConfig(void);
+
+/// 分发统计
+typedef struct {
+    size_t clientCount;  ///< 当前客户端数
+    uint64_t bytesSent;  ///< 发出的字节数(所有客户端)
+    uint64_t skippedGOPCount;  ///< 客户端跳到新GOP的次数
+    uint64_t droppedTagCount;  ///< 没有发给慢客户端的tag数
+    uint64_t droppedNonReferenceCount;  ///< 其中积压时单独丢掉的非参考帧数(没有跳GOP)
+    uint64_t disconnectedCount;  ///< 因为太慢或出错断开的客户端数
+} CQStreamFanoutStats;
+
+typedef struct CQStreamFanout CQStreamFanout;
+
+FOUNDATION_EXPORT CQStreamFanout *CQStreamFanoutCreate(CQStreamFanoutConfig config, CQStreamFanoutEventCallback callback, void * _Nullable context);
+
+/// 释放所有客户端和缓存，不回调，不关闭fd
+FOUNDATION_EXPORT void CQStreamFanoutDestroy(CQStreamFanout *fanout);
+
+/**
+ 设置新客户端最先收到的数据(例如FLV头 + 序列头)
+ @discussion 会retain新的数据块；已连接的客户端不受影响，序列头变化时还需要以CQFanoutTagKindHeader发布
+ */
+FOUNDATION_EXPORT void CQStreamFanoutSetHeader(CQStreamFanout *fanout, CQFanoutBuffer * const _Nonnull * _Nullable buffers, size_t count);
+
+/**
+ 发布一个tag
+ @discussion 加入每个客户端的队列，之前队列为空的客户端立即尝试写，没写完的回调WantsWrite
+ */
+FOUNDATION_EXPORT void CQStreamFanoutPublish(CQStreamFanout *fanout, CQFanoutBuffer *buffer, CQFanoutTagKind kind, uint64_t nowUs);
+
+/**
+ 添加客户端
+ @discussion fd应为非阻塞的流套接字；入队头部和GOP缓存后回调WantsWrite，没有GOP缓存时等到下一个关键帧才开始发帧
+ @param clientContext 回调参数
+ */
+FOUNDATION_EXPORT CQFanoutClient *CQStreamFanoutAddClient(CQStreamFanout *fanout, int fd, void * _Nullable clientContext, uint64_t nowUs);
+
+/// 客户端可写时调用，写完回调Drained，出错回调Closed
+FOUNDATION_EXPORT void CQStreamFanoutClientWritable(CQStreamFanout *fanout, CQFanoutClient *client, uint64_t nowUs);
+
+/// 移除客户端(对端关闭等)，不回调，不关闭fd
+FOUNDATION_EXPORT void CQStreamFanoutRemoveClient(CQStreamFanout *fanout, CQFanoutClient *client);
+
+/// 客户端队列中待发的字节数
+FOUNDATION_EXPORT size_t CQFanoutClientQueuedBytes(const CQFanoutClient *client);
+
+FOUNDATION_EXPORT CQStreamFanoutStats CQStreamFanoutGetStats(const CQStreamFanout *fanout);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,407 @@
+//
+//  CQStreamFanout.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 tag数据用引用计数的CQFanoutBuffer表示，GOP缓存和每个客户端的队列都只保存指针，发送时把队列前面若干个tag组成iovec一次writev
+ 2 队首tag可能只写出一部分，用headOffset记录，丢弃时队首tag保留，保证客户端收到的tag是完整的
+ 3 发布时队列本来为空的客户端直接写(大部分客户端一次就写完，不需要等可写事件)；写不完的等可写事件，这段时间新的tag只入队
+ 4 慢客户端: 队列超过上限(字节数或队首等待时间)后停止入队并等待关键帧，关键帧到来时丢掉队列里没开始发送的非头部tag，从这个关键帧继续，
+   不会因为一个客户端慢而占用更多内存或阻塞其他客户端；长时间一个字节都写不出去的直接断开
+ 5 在此之前先降帧率: 超过上限的一半时丢掉队列里和新来的非参考帧，分层P编码时正好帧率减半，带宽稍差的客户端不用跳GOP
+ */
+
+#import "CQStreamFanout.h"
+#import <sys/uio.h>
+#import <errno.h>
+
+#define kFanoutMaxIOVecCount 64
+static const size_t kFanoutInitialQueueCapacity = 64;
+
+#pragma mark - CQFanoutBuffer
+struct CQFanoutBuffer {
+    const uint8_t *bytes;
+    size_t length;
+    size_t refCount;
+    void *context;
+    void (*releaseCallback)(void *context);
+};
+
+CQFanoutBuffer *CQFanoutBufferCreate(const void *bytes, size_t length, void *context, void (*releaseCallback)(void *context)) {
+    CQFanoutBuffer *buffer = calloc(1, sizeof(CQFanoutBuffer));
+    buffer->bytes = bytes;
+    buffer->length = length;
+    buffer->refCount = 1;
+    buffer->context = context;
+    buffer->releaseCallback = releaseCallback;
+    return buffer;
+}
+
+CQFanoutBuffer *CQFanoutBufferRetain(CQFanoutBuffer *buffer) {
+    buffer->refCount++;
+    return buffer;
+}
+
+void CQFanoutBufferRelease(CQFanoutBuffer *buffer) {
+    if (--buffer->refCount > 0) return;
+    if (buffer->releaseCallback) buffer->releaseCallback(buffer->context);
+    free(buffer);
+}
+
+size_t CQFanoutBufferLength(const CQFanoutBuffer *buffer) {
+    return buffer->length;
+}
+
+#pragma mark - Queue
+typedef struct {
+    CQFanoutBuffer *buffer;
+    CQFanoutTagKind kind;
+    uint64_t enqueuedUs;  ///< 入队时间
+} CQFanoutEntry;
+
+/// tag环形队列，容量为2的幂
+typedef struct {
+    CQFanoutEntry *entries;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    size_t bytes;  ///< 队列中tag的总长度(不扣除队首已发送的部分)
+} CQFanoutQueue;
+
+static inline CQFanoutEntry *CQFanoutQueueAt(CQFanoutQueue *queue, size_t i) {
+    return &queue->entries[(queue->head + i) & (queue->capacity - 1)];
+}
+
+static void CQFanoutQueuePush(CQFanoutQueue *queue, CQFanoutBuffer *buffer, CQFanoutTagKind kind, uint64_t nowUs) {
+    if (queue->count == queue->capacity) {
+        size_t capacity = queue->capacity ? queue->capacity * 2 : kFanoutInitialQueueCapacity;
+        CQFanoutEntry *entries = malloc(capacity * sizeof(CQFanoutEntry));
+        for (size_t i = 0; i < queue->count; i++) {
+            entries[i] = *CQFanoutQueueAt(queue, i);
+        }
+        free(queue->entries);
+        queue->entries = entries;
+        queue->capacity = capacity;
+        queue->head = 0;
+    }
+    queue->count++;
+    *CQFanoutQueueAt(queue, queue->count - 1) = (CQFanoutEntry){CQFanoutBufferRetain(buffer), kind, nowUs};
+    queue->bytes += buffer->length;
+}
+
+static void CQFanoutQueuePop(CQFanoutQueue *queue) {
+    CQFanoutEntry *entry = CQFanoutQueueAt(queue, 0);
+    queue->bytes -= entry->buffer->length;
+    CQFanoutBufferRelease(entry->buffer);
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->count--;
+}
+
+static void CQFanoutQueueClear(CQFanoutQueue *queue) {
+    while (queue->count > 0) {
+        CQFanoutQueuePop(queue);
+    }
+}
+
+static void CQFanoutQueueFree(CQFanoutQueue *queue) {
+    CQFanoutQueueClear(queue);
+    free(queue->entries);
+    queue->entries = NULL;
+    queue->capacity = 0;
+}
+
+#pragma mark - CQStreamFanout
+struct CQFanoutClient {
+    int fd;
+    void *context;
+    size_t index;  ///< 在clients中的位置
+    CQFanoutQueue queue;
+    size_t headOffset;  ///< 队首tag已发送的字节数
+    BOOL isWaitingKeyFrame;  ///< 等待关键帧，期间非关键帧不入队
+    BOOL isWaitingWritable;  ///< 已回调WantsWrite
+    BOOL isDroppingNonReference;  ///< 积压超过上限的一半，非参考帧不入队
+    uint64_t lastProgressUs;  ///< 上次写出数据(或队列由空变为非空)的时间
+};
+
+struct CQStreamFanout {
+    CQStreamFanoutConfig config;
+    CQStreamFanoutEventCallback callback;
+    void *context;
+    CQFanoutBuffer **header;
+    size_t headerCount;
+    CQFanoutQueue gopCache;
+    BOOL isGOPCacheValid;
+    CQFanoutClient **clients;
+    size_t clientCount;
+    size_t clientCapacity;
+    CQStreamFanoutStats stats;
+};
+
+CQStreamFanoutConfig CQStreamFanoutDefaultConfig(void) {
+    return (CQStreamFanoutConfig){
+        .maxQueuedBytes = 4 * 1024 * 1024,
+        .maxQueueDelayUs = 2000000,
+        .maxStallUs = 5000000,
+        .maxGOPCacheBytes = 2 * 1024 * 1024,
+    };
+}
+
+CQStreamFanout *CQStreamFanoutCreate(CQStreamFanoutConfig config, CQStreamFanoutEventCallback callback, void *context) {
+    CQStreamFanout *fanout = calloc(1, sizeof(CQStreamFanout));
+    fanout->config = config;
+    fanout->callback = callback;
+    fanout->context = context;
+    return fanout;
+}
+
+static void CQFanoutClientFree(CQFanoutClient *client) {
+    CQFanoutQueueFree(&client->queue);
+    free(client);
+}
+
+void CQStreamFanoutDestroy(CQStreamFanout *fanout) {
+    CQStreamFanoutSetHeader(fanout, NULL, 0);
+    CQFanoutQueueFree(&fanout->gopCache);
+    for (size_t i = 0; i < fanout->clientCount; i++) {
+        CQFanoutClientFree(fanout->clients[i]);
+    }
+    free(fanout->clients);
+    free(fanout);
+}
+
+void CQStreamFanoutSetHeader(CQStreamFanout *fanout, CQFanoutBuffer * const *buffers, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        CQFanoutBufferRetain(buffers[i]);
+    }
+    for (size_t i = 0; i < fanout->headerCount; i++) {
+        CQFanoutBufferRelease(fanout->header[i]);
+    }
+    free(fanout->header);
+    fanout->header = count > 0 ? malloc(count * sizeof(CQFanoutBuffer *)) : NULL;
+    if (count > 0) memcpy(fanout->header, buffers, count * sizeof(CQFanoutBuffer *));
+    fanout->headerCount = count;
+}
+
+#pragma mark - Client
+static void CQStreamFanoutDetachClient(CQStreamFanout *fanout, CQFanoutClient *client) {
+    CQFanoutClient *last = fanout->clients[fanout->clientCount - 1];
+    fanout->clients[client->index] = last;
+    last->index = client->index;
+    fanout->clientCount--;
+}
+
+/// 断开客户端并回调Closed
+static void CQStreamFanoutCloseClient(CQStreamFanout *fanout, CQFanoutClient *client) {
+    int fd = client->fd;
+    void *clientContext = client->context;
+    CQStreamFanoutDetachClient(fanout, client);
+    CQFanoutClientFree(client);
+    fanout->stats.disconnectedCount++;
+    fanout->callback(fanout->context, fd, clientContext, CQFanoutClientEventClosed);
+}
+
+/// 尽量写出队列，内核缓冲满时返回YES，出错返回NO
+static BOOL CQStreamFanoutFlushClient(CQStreamFanout *fanout, CQFanoutClient *client, uint64_t nowUs) {
+    while (client->queue.count > 0) {
+        struct iovec iov[kFanoutMaxIOVecCount];
+        int iovCount = 0;
+        size_t total = 0;
+        for (; iovCount < kFanoutMaxIOVecCount && (size_t)iovCount < client->queue.count; iovCount++) {
+            CQFanoutBuffer *buffer = CQFanoutQueueAt(&client->queue, iovCount)->buffer;
+            size_t offset = iovCount == 0 ? client->headOffset : 0;
+            iov[iovCount].iov_base = (void *)(buffer->bytes + offset);
+            iov[iovCount].iov_len = buffer->length - offset;
+            total += iov[iovCount].iov_len;
+        }
+        ssize_t written = writev(client->fd, iov, iovCount);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        fanout->stats.bytesSent += written;
+        if (written > 0) client->lastProgressUs = nowUs;
+        size_t remaining = (size_t)written;
+        while (remaining > 0) {
+            size_t left = CQFanoutQueueAt(&client->queue, 0)->buffer->length - client->headOffset;
+            if (remaining < left) {
+                client->headOffset += remaining;
+                break;
+            }
+            remaining -= left;
+            client->headOffset = 0;
+            CQFanoutQueuePop(&client->queue);
+        }
+        if ((size_t)written < total) return YES;
+    }
+    return YES;
+}
+
+/// 写出后根据队列状态回调
+static void CQStreamFanoutWriteClient(CQStreamFanout *fanout, CQFanoutClient *client, uint64_t nowUs) {
+    if (!CQStreamFanoutFlushClient(fanout, client, nowUs)) {
+        CQStreamFanoutCloseClient(fanout, client);
+        return;
+    }
+    if (client->queue.count > 0 && !client->isWaitingWritable) {
+        client->isWaitingWritable = YES;
+        fanout->callback(fanout->context, client->fd, client->context, CQFanoutClientEventWantsWrite);
+    } else if (client->queue.count == 0 && client->isWaitingWritable) {
+        client->isWaitingWritable = NO;
+        fanout->callback(fanout->context, client->fd, client->context, CQFanoutClientEventDrained);
+    }
+}
+
+/// 丢掉队列里没开始发送的非头部tag
+static void CQStreamFanoutDropQueued(CQStreamFanout *fanout, CQFanoutClient *client) {
+    CQFanoutQueue *queue = &client->queue;
+    size_t kept = 0;
+    for (size_t i = 0; i < queue->count; i++) {
+        CQFanoutEntry entry = *CQFanoutQueueAt(queue, i);
+        if ((i == 0 && client->headOffset > 0) || entry.kind == CQFanoutTagKindHeader) {
+            *CQFanoutQueueAt(queue, kept++) = entry;
+        } else {
+            queue->bytes -= entry.buffer->length;
+            CQFanoutBufferRelease(entry.buffer);
+            fanout->stats.droppedTagCount++;
+        }
+    }
+    queue->count = kept;
+}
+
+/// 丢掉队列里没开始发送的非参考帧
+static void CQStreamFanoutDropQueuedNonReference(CQStreamFanout *fanout, CQFanoutClient *client) {
+    CQFanoutQueue *queue = &client->queue;
+    size_t kept = 0;
+    for (size_t i = 0; i < queue->count; i++) {
+        CQFanoutEntry entry = *CQFanoutQueueAt(queue, i);
+        if ((i == 0 && client->headOffset > 0) || entry.kind != CQFanoutTagKindDroppable) {
+            *CQFanoutQueueAt(queue, kept++) = entry;
+        } else {
+            queue->bytes -= entry.buffer->length;
+            CQFanoutBufferRelease(entry.buffer);
+            fanout->stats.droppedTagCount++;
+            fanout->stats.droppedNonReferenceCount++;
+        }
+    }
+    queue->count = kept;
+}
+
+/// 按慢客户端策略入队，返回是否入队
+static BOOL CQStreamFanoutEnqueue(CQStreamFanout *fanout, CQFanoutClient *client, CQFanoutBuffer *buffer, CQFanoutTagKind kind, uint64_t nowUs) {
+    size_t queuedBytes = client->queue.bytes - client->headOffset;
+    uint64_t queueDelayUs = client->queue.count > 0 ? nowUs - CQFanoutQueueAt(&client->queue, 0)->enqueuedUs : 0;
+    BOOL isOverLimit = queuedBytes + buffer->length > fanout->config.maxQueuedBytes || queueDelayUs > fanout->config.maxQueueDelayUs;
+    BOOL isOverHalfLimit = queuedBytes + buffer->length > fanout->config.maxQueuedBytes / 2 || queueDelayUs > fanout->config.maxQueueDelayUs / 2;
+    if (kind == CQFanoutTagKindKeyFrame) {
+        if (isOverLimit && !client->isWaitingKeyFrame) fanout->stats.skippedGOPCount++;
+        if (isOverLimit || client->isWaitingKeyFrame) CQStreamFanoutDropQueued(fanout, client);
+        client->isWaitingKeyFrame = NO;
+        client->isDroppingNonReference = NO;
+    } else if (kind == CQFanoutTagKindFrame || kind == CQFanoutTagKindDroppable) {
+        // 参考帧超过上限才跳GOP，非参考帧自己丢掉就行，不需要等关键帧
+        if (!client->isWaitingKeyFrame && isOverLimit && kind == CQFanoutTagKindFrame) {
+            client->isWaitingKeyFrame = YES;
+            fanout->stats.skippedGOPCount++;
+        }
+        if (client->isWaitingKeyFrame) {
+            fanout->stats.droppedTagCount++;
+            return NO;
+        }
+        // 积压到上限的一半时先把已经排队的非参考帧丢掉，之后新来的也不入队，直到积压回落
+        if (isOverHalfLimit && !client->isDroppingNonReference) {
+            client->isDroppingNonReference = YES;
+            CQStreamFanoutDropQueuedNonReference(fanout, client);
+        } else if (!isOverHalfLimit) {
+            client->isDroppingNonReference = NO;
+        }
+        if (kind == CQFanoutTagKindDroppable && client->isDroppingNonReference) {
+            fanout->stats.droppedTagCount++;
+            fanout->stats.droppedNonReferenceCount++;
+            return NO;
+        }
+    }
+    CQFanoutQueuePush(&client->queue, buffer, kind, nowUs);
+    return YES;
+}
+
+#pragma mark - Public
+void CQStreamFanoutPublish(CQStreamFanout *fanout, CQFanoutBuffer *buffer, CQFanoutTagKind kind, uint64_t nowUs) {
+    // GOP缓存
+    CQFanoutQueue *gopCache = &fanout->gopCache;
+    if (kind == CQFanoutTagKindKeyFrame) {
+        CQFanoutQueueClear(gopCache);
+        CQFanoutQueuePush(gopCache, buffer, kind, nowUs);
+        fanout->isGOPCacheValid = YES;
+    } else if ((kind == CQFanoutTagKindFrame || kind == CQFanoutTagKindDroppable) && fanout->isGOPCacheValid && gopCache->bytes + buffer->length <= fanout->config.maxGOPCacheBytes) {
+        CQFanoutQueuePush(gopCache, buffer, kind, nowUs);
+    } else {
+        CQFanoutQueueClear(gopCache);
+        fanout->isGOPCacheValid = NO;
+    }
+
+    // 倒序遍历，断开时最后一个客户端会移到当前位置，它已经处理过
+    for (size_t i = fanout->clientCount; i > 0; i--) {
+        CQFanoutClient *client = fanout->clients[i - 1];
+        if (client->isWaitingWritable && nowUs - client->lastProgressUs > fanout->config.maxStallUs) {
+            CQStreamFanoutCloseClient(fanout, client);
+            continue;
+        }
+        if (!CQStreamFanoutEnqueue(fanout, client, buffer, kind, nowUs) || client->isWaitingWritable) continue;
+        client->lastProgressUs = nowUs;
+        CQStreamFanoutWriteClient(fanout, client, nowUs);
+    }
+}
+
+CQFanoutClient *CQStreamFanoutAddClient(CQStreamFanout *fanout, int fd, void *clientContext, uint64_t nowUs) {
+    CQFanoutClient *client = calloc(1, sizeof(CQFanoutClient));
+    client->fd = fd;
+    client->context = clientContext;
+    client->lastProgressUs = nowUs;
+    for (size_t i = 0; i < fanout->headerCount; i++) {
+        CQFanoutQueuePush(&client->queue, fanout->header[i], CQFanoutTagKindHeader, nowUs);
+    }
+    if (fanout->isGOPCacheValid) {
+        for (size_t i = 0; i < fanout->gopCache.count; i++) {
+            CQFanoutEntry *entry = CQFanoutQueueAt(&fanout->gopCache, i);
+            CQFanoutQueuePush(&client->queue, entry->buffer, entry->kind, nowUs);
+        }
+    } else {
+        client->isWaitingKeyFrame = YES;
+    }
+
+    if (fanout->clientCount == fanout->clientCapacity) {
+        fanout->clientCapacity = fanout->clientCapacity ? fanout->clientCapacity * 2 : 16;
+        fanout->clients = realloc(fanout->clients, fanout->clientCapacity * sizeof(CQFanoutClient *));
+    }
+    client->index = fanout->clientCount;
+    fanout->clients[fanout->clientCount++] = client;
+
+    if (client->queue.count > 0) {
+        client->isWaitingWritable = YES;
+        fanout->callback(fanout->context, fd, clientContext, CQFanoutClientEventWantsWrite);
+    }
+    return client;
+}
+
+void CQStreamFanoutClientWritable(CQStreamFanout *fanout, CQFanoutClient *client, uint64_t nowUs) {
+    CQStreamFanoutWriteClient(fanout, client, nowUs);
+}
+
+void CQStreamFanoutRemoveClient(CQStreamFanout *fanout, CQFanoutClient *client) {
+    CQStreamFanoutDetachClient(fanout, client);
+    CQFanoutClientFree(client);
+}
+
+size_t CQFanoutClientQueuedBytes(const CQFanoutClient *client) {
+    return client->queue.bytes - client->headOffset;
+}
+
+CQStreamFanoutStats CQStreamFanoutGetStats(const CQStreamFanout *fanout) {
+    CQStreamFanoutStats stats = fanout->stats;
+    stats.clientCount = fanout->clientCount;
+    return stats;
+}
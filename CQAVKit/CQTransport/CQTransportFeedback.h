@@ -0,0 +1,73 @@
+//
+//  CQTransportFeedback.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 接收端反馈
+ @discussion RTCP RTPFB(PT=205, FMT=15)，布局参考transport-cc但简化了包状态编码，只在本库两端之间使用:
+ 0       RTCP头(V=2 FMT=15, PT=205, 长度)
+ 4       发送端SSRC(0)
+ 8       媒体SSRC
+ 12      起始序列号(16位)  包个数(16位)
+ 16      参考时间(64位，接收端时钟微秒，第一个收到的包的到达时间)
+ 24      每个包一个16位有符号到达时间差(单位250微秒，相对上一个收到的包)，0x8000表示没收到
+         末尾补齐到4字节
+ */
+
+/// 反馈里的一个包
+typedef struct {
+    uint16_t sequenceNumber;  ///< 序列号
+    uint64_t arrivalTimeUs;  ///< 到达时间(接收端时钟)，0为没收到
+} CQTransportFeedbackPacket;
+
+/**
+ 解析反馈
+ @param bytes 反馈数据
+ @param length 长度
+ @param mediaSSRC 输出媒体SSRC，在回调之前填写
+ @param block 按序列号顺序回调每个包
+ @return 格式不对返回NO，不回调
+ */
+FOUNDATION_EXPORT BOOL CQTransportFeedbackEnumerate(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC, void (NS_NOESCAPE ^block)(CQTransportFeedbackPacket packet));
+
+/// 是否是RTCP包(和RTP包走同一个端口时按RFC 5761区分，第二个字节在192~223之间)
+FOUNDATION_EXPORT BOOL CQTransportFeedbackIsRTCP(const uint8_t *bytes, size_t length);
+
+/**
+ 反馈生成器(接收端)
+ @discussion 记录一个SSRC的RTP包到达时间，每隔一段时间(一般50ms)调用buildFeedback生成反馈发回发送端
+ 非线程安全，应在接收队列使用
+ */
+@interface CQTransportFeedbackGenerator : NSObject
+
+/**
+ 唯一初始化函数
+ @param mediaSSRC 要反馈的媒体SSRC，其他SSRC的包忽略
+ */
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) uint32_t mediaSSRC;  ///< 媒体SSRC
+
+/**
+ 收到RTP包
+ @param rtpData RTP数据报
+ @param arrivalTimeUs 到达时间(单调时钟微秒)
+ */
+- (void)onRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs;
+
+/// 生成上次反馈之后的反馈，没有新包返回nil
+- (nullable NSData *)buildFeedback;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,163 @@
+//
+//  CQTransportFeedback.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 接收端按扩展序列号把到达时间记在环形数组里(槽位同时记下序列号，旧数据不用清)
+ 2 buildFeedback从上次反馈的下一个序列号报到收到的最大序列号，中间没收到的记为丢失，之后迟到的包不再反馈
+ 3 到达时间差用250微秒为单位的16位有符号数，范围约±8秒
+ */
+
+#import "CQTransportFeedback.h"
+
+static const uint8_t kFeedbackFirstByte = 0x80 | 15;  ///< V=2, FMT=15
+static const uint8_t kFeedbackPayloadType = 205;  ///< RTPFB
+static const size_t kFeedbackHeaderSize = 24;
+static const int16_t kFeedbackNotReceived = INT16_MIN;
+static const uint64_t kFeedbackDeltaUnitUs = 250;
+#define kFeedbackHistorySize 4096  ///< 一次反馈最多的包数
+
+static inline void CQFeedbackWriteUInt16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static inline void CQFeedbackWriteUInt32(uint8_t *p, uint32_t value) {
+    CQFeedbackWriteUInt16(p, (uint16_t)(value >> 16));
+    CQFeedbackWriteUInt16(p + 2, (uint16_t)value);
+}
+
+static inline uint16_t CQFeedbackReadUInt16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t CQFeedbackReadUInt32(const uint8_t *p) {
+    return ((uint32_t)CQFeedbackReadUInt16(p) << 16) | CQFeedbackReadUInt16(p + 2);
+}
+
+#pragma mark - Parse
+BOOL CQTransportFeedbackIsRTCP(const uint8_t *bytes, size_t length) {
+    return length >= 4 && (bytes[0] >> 6) == 2 && bytes[1] >= 192 && bytes[1] <= 223;
+}
+
+BOOL CQTransportFeedbackEnumerate(const uint8_t *bytes, size_t length, uint32_t *mediaSSRC, void (NS_NOESCAPE ^block)(CQTransportFeedbackPacket packet)) {
+    if (length < kFeedbackHeaderSize || bytes[0] != kFeedbackFirstByte || bytes[1] != kFeedbackPayloadType) return NO;
+    size_t packetLength = ((size_t)CQFeedbackReadUInt16(bytes + 2) + 1) * 4;
+    uint16_t baseSequence = CQFeedbackReadUInt16(bytes + 12);
+    uint16_t count = CQFeedbackReadUInt16(bytes + 14);
+    if (packetLength > length || kFeedbackHeaderSize + (size_t)count * 2 > packetLength) return NO;
+    *mediaSSRC = CQFeedbackReadUInt32(bytes + 8);
+    uint64_t arrivalTimeUs = ((uint64_t)CQFeedbackReadUInt32(bytes + 16) << 32) | CQFeedbackReadUInt32(bytes + 20);
+    const uint8_t *deltas = bytes + kFeedbackHeaderSize;
+    for (uint16_t i = 0; i < count; i++) {
+        int16_t delta = (int16_t)CQFeedbackReadUInt16(deltas + i * 2);
+        CQTransportFeedbackPacket packet = {.sequenceNumber = (uint16_t)(baseSequence + i), .arrivalTimeUs = 0};
+        if (delta != kFeedbackNotReceived) {
+            arrivalTimeUs += (int64_t)delta * (int64_t)kFeedbackDeltaUnitUs;
+            packet.arrivalTimeUs = arrivalTimeUs;
+        }
+        block(packet);
+    }
+    return YES;
+}
+
+#pragma mark - CQTransportFeedbackGenerator
+@implementation CQTransportFeedbackGenerator
+{
+    uint64_t _arrivalTimes[kFeedbackHistorySize];
+    int64_t _sequences[kFeedbackHistorySize];  ///< 槽位对应的扩展序列号
+    BOOL _hasBaseSequence;
+    int64_t _baseSequence;  ///< 下一次反馈的起始扩展序列号
+    int64_t _highestSequence;  ///< 收到的最大扩展序列号
+}
+
+#pragma mark - Init
+- (instancetype)initWithMediaSSRC:(uint32_t)mediaSSRC {
+    if (self = [super init]) {
+        _mediaSSRC = mediaSSRC;
+        memset(_sequences, 0xFF, sizeof(_sequences));
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (void)onRTPData:(NSData *)rtpData arrivalTime:(uint64_t)arrivalTimeUs {
+    const uint8_t *bytes = rtpData.bytes;
+    if (rtpData.length < 12 || (bytes[0] >> 6) != 2 || CQFeedbackReadUInt32(bytes + 8) != _mediaSSRC) return;
+    int64_t sequence = [self extendSequence:CQFeedbackReadUInt16(bytes + 2)];
+    if (!_hasBaseSequence) {
+        _hasBaseSequence = YES;
+        _baseSequence = sequence;
+        _highestSequence = sequence;
+    }
+    // 已经反馈过(按丢失)的迟到包
+    if (sequence < _baseSequence) return;
+    _highestSequence = MAX(_highestSequence, sequence);
+    // 太久没有反馈，丢掉最老的
+    if (_highestSequence - _baseSequence >= kFeedbackHistorySize) {
+        _baseSequence = _highestSequence - kFeedbackHistorySize + 1;
+    }
+    size_t slot = (size_t)(sequence % kFeedbackHistorySize);
+    _sequences[slot] = sequence;
+    _arrivalTimes[slot] = arrivalTimeUs;
+}
+
+- (NSData *)buildFeedback {
+    if (!_hasBaseSequence || _highestSequence < _baseSequence) return nil;
+    uint16_t count = (uint16_t)(_highestSequence - _baseSequence + 1);
+    size_t length = (kFeedbackHeaderSize + (size_t)count * 2 + 3) / 4 * 4;
+    NSMutableData *feedback = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = feedback.mutableBytes;
+    bytes[0] = kFeedbackFirstByte;
+    bytes[1] = kFeedbackPayloadType;
+    CQFeedbackWriteUInt16(bytes + 2, (uint16_t)(length / 4 - 1));
+    CQFeedbackWriteUInt32(bytes + 8, _mediaSSRC);
+    CQFeedbackWriteUInt16(bytes + 12, (uint16_t)_baseSequence);
+    CQFeedbackWriteUInt16(bytes + 14, count);
+
+    BOOL hasReference = NO;
+    uint64_t previousArrival = 0;
+    uint8_t *deltas = bytes + kFeedbackHeaderSize;
+    for (uint16_t i = 0; i < count; i++) {
+        int64_t sequence = _baseSequence + i;
+        size_t slot = (size_t)(sequence % kFeedbackHistorySize);
+        if (_sequences[slot] != sequence) {
+            CQFeedbackWriteUInt16(deltas + i * 2, (uint16_t)kFeedbackNotReceived);
+            continue;
+        }
+        uint64_t arrival = _arrivalTimes[slot];
+        if (!hasReference) {
+            hasReference = YES;
+            previousArrival = arrival;
+            CQFeedbackWriteUInt32(bytes + 16, (uint32_t)(arrival >> 32));
+            CQFeedbackWriteUInt32(bytes + 20, (uint32_t)arrival);
+        }
+        // 按量化后的时间累加，解析端不会累积误差
+        int64_t delta = ((int64_t)arrival - (int64_t)previousArrival) / (int64_t)kFeedbackDeltaUnitUs;
+        delta = MIN(MAX(delta, (int64_t)INT16_MIN + 1), (int64_t)INT16_MAX);
+        previousArrival += delta * (int64_t)kFeedbackDeltaUnitUs;
+        CQFeedbackWriteUInt16(deltas + i * 2, (uint16_t)(int16_t)delta);
+    }
+    _baseSequence = _highestSequence + 1;
+    return feedback;
+}
+
+#pragma mark - Private Func
+/// 16位序列号扩展为64位
+- (int64_t)extendSequence:(uint16_t)sequence {
+    if (!_hasBaseSequence) return sequence;
+    int64_t reference = _highestSequence;
+    int64_t candidate = (reference & ~0xFFFFLL) | sequence;
+    if (candidate - reference > 0x8000) {
+        candidate -= 0x10000;
+    } else if (reference - candidate > 0x8000) {
+        candidate += 0x10000;
+    }
+    return candidate;
+}
+
+@end
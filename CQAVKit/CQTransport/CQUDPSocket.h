@@ -0,0 +1,65 @@
+//
+//  CQUDPSocket.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQRTPPacketizer.h"
+
+@class CQUDPSocket;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol CQUDPSocketDelegate <NSObject>
+@required
+/**
+ 收到数据(在接收队列回调)
+ @param data 一个完整的UDP数据报
+ */
+- (void)udpSocket:(CQUDPSocket *)udpSocket didReceiveData:(NSData *)data;
+
+@end
+
+/**
+ UDP套接字
+ @discussion 基于BSD socket + GCD读事件源，发送RTP包时用sendmsg直接发送iovec，不拼接数据
+ */
+@interface CQUDPSocket : NSObject
+
+/**
+ 唯一初始化函数
+ @param port 本地端口，0为系统分配
+ @param error 错误信息
+ */
+- (nullable instancetype)initWithLocalPort:(uint16_t)port error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, weak) id<CQUDPSocketDelegate> delegate;  ///< 代理
+@property (nonatomic, assign, readonly) uint16_t localPort;  ///< 实际绑定的本地端口
+
+/**
+ 设置对端地址，之后send系列函数都发往该地址
+ @param host IPv4地址，例如@"127.0.0.1"
+ @param port 端口
+ */
+- (BOOL)connectToHost:(NSString *)host port:(uint16_t)port error:(NSError * _Nullable *)error;
+
+/// 开始接收，收到数据回调代理
+- (void)startReceiving;
+
+/// 发送RTP包(零拷贝)
+- (BOOL)sendRTPPacket:(CQRTPPacket *)packet;
+
+/// 发送数据
+- (BOOL)sendData:(NSData *)data;
+
+/// 关闭，可以和其它线程的发送并发调用，等正在进行的发送结束后才关闭fd
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
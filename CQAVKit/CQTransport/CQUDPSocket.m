@@ -0,0 +1,175 @@
+//
+//  CQUDPSocket.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQUDPSocket.h"
+#import <sys/socket.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <sched.h>
+#import <stdatomic.h>
+
+static const int kMaxIOVecCount = 32;
+static const size_t kMaxDatagramSize = 65536;
+
+@interface CQUDPSocket ()
+@property (nonatomic, strong) dispatch_queue_t receiveQueue;  ///< 接收队列
+@property (nonatomic, strong) dispatch_source_t readSource;  ///< 读事件源
+@end
+
+@implementation CQUDPSocket
+{
+    // 发送在任意线程，close后fd号可能被复用，发送期间计数，close等正在进行的发送结束后再关闭fd
+    atomic_int _socketFD;
+    atomic_bool _isConnected;
+    atomic_int _sendingCount;
+}
+
+#pragma mark - Init
+- (instancetype)initWithLocalPort:(uint16_t)port error:(NSError **)error {
+    if (self = [super init]) {
+        _receiveQueue = dispatch_queue_create("CQUDPSocket receive queue", DISPATCH_QUEUE_SERIAL);
+        atomic_init(&_isConnected, false);
+        atomic_init(&_sendingCount, 0);
+        int socketFD = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        atomic_init(&_socketFD, socketFD);
+        if (socketFD < 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            return nil;
+        }
+        int flags = fcntl(socketFD, F_GETFL, 0);
+        fcntl(socketFD, F_SETFL, flags | O_NONBLOCK);
+        int noSigPipe = 1;
+        setsockopt(socketFD, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+        // 加大收发缓冲，关键帧的一串包不至于被内核丢弃
+        int bufferSize = 1024 * 1024;
+        setsockopt(socketFD, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        setsockopt(socketFD, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+        struct sockaddr_in addr = {0};
+        addr.sin_len = sizeof(addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(socketFD, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            close(socketFD);
+            atomic_store(&_socketFD, -1);
+            return nil;
+        }
+        socklen_t length = sizeof(addr);
+        getsockname(socketFD, (struct sockaddr *)&addr, &length);
+        _localPort = ntohs(addr.sin_port);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self close];
+    NSLog(@"CQUDPSocket - dealloc !!!");
+}
+
+#pragma mark - Public Func
+- (BOOL)connectToHost:(NSString *)host port:(uint16_t)port error:(NSError **)error {
+    struct sockaddr_in addr = {0};
+    addr.sin_len = sizeof(addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.UTF8String, &addr.sin_addr) != 1) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+        return NO;
+    }
+    int socketFD = [self beginSending];
+    int result = socketFD >= 0 ? connect(socketFD, (struct sockaddr *)&addr, sizeof(addr)) : -1;
+    int connectErrno = socketFD >= 0 ? errno : EBADF;
+    if (result == 0) atomic_store(&_isConnected, true);
+    [self endSending];
+    if (result != 0) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:connectErrno userInfo:nil];
+        return NO;
+    }
+    return YES;
+}
+
+- (void)startReceiving {
+    int socketFD = atomic_load(&_socketFD);
+    if (self.readSource || socketFD < 0) return;
+    self.readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, socketFD, 0, self.receiveQueue);
+    __weak typeof(self) weakSelf = self;
+    // 读事件和取消回调都在接收队列，读的时候fd还没有关闭，用这里取到的fd，不读可能已被复用的_socketFD
+    dispatch_source_set_event_handler(self.readSource, ^{
+        [weakSelf readAvailableDatagramsFromSocket:socketFD];
+    });
+    // 事件源取消后再关闭fd
+    dispatch_source_set_cancel_handler(self.readSource, ^{
+        close(socketFD);
+    });
+    dispatch_resume(self.readSource);
+}
+
+- (BOOL)sendRTPPacket:(CQRTPPacket *)packet {
+    struct iovec iov[kMaxIOVecCount];
+    int count = [packet fillIOVec:iov maxCount:kMaxIOVecCount];
+    if (count == 0) return NO;
+    struct msghdr message = {0};
+    message.msg_iov = iov;
+    message.msg_iovlen = count;
+    int socketFD = [self beginSending];
+    ssize_t sent = (socketFD >= 0 && atomic_load(&_isConnected)) ? sendmsg(socketFD, &message, 0) : -1;
+    [self endSending];
+    return sent == (ssize_t)packet.length;
+}
+
+- (BOOL)sendData:(NSData *)data {
+    int socketFD = [self beginSending];
+    ssize_t sent = (socketFD >= 0 && atomic_load(&_isConnected)) ? send(socketFD, data.bytes, data.length, 0) : -1;
+    [self endSending];
+    return sent == (ssize_t)data.length;
+}
+
+- (void)close {
+    int socketFD = atomic_exchange(&_socketFD, -1);
+    atomic_store(&_isConnected, false);
+    if (socketFD < 0) return;
+    // 之后开始的发送取到-1，等已经取到fd的发送结束，fd号不会在发送期间被复用
+    while (atomic_load(&_sendingCount) > 0) {
+        sched_yield();
+    }
+    if (self.readSource) {
+        dispatch_source_cancel(self.readSource);
+        self.readSource = nil;
+    } else {
+        close(socketFD);
+    }
+}
+
+#pragma mark - Private Func
+/// 开始发送，返回当前的fd(已关闭时为-1)，必须和endSending配对
+- (int)beginSending {
+    atomic_fetch_add(&_sendingCount, 1);
+    return atomic_load(&_socketFD);
+}
+
+- (void)endSending {
+    atomic_fetch_sub(&_sendingCount, 1);
+}
+
+/// 一次读完所有可读的数据报
+- (void)readAvailableDatagramsFromSocket:(int)socketFD {
+    uint8_t buffer[kMaxDatagramSize];
+    while (YES) {
+        ssize_t length = recv(socketFD, buffer, sizeof(buffer), 0);
+        if (length <= 0) break;
+        NSData *data = [NSData dataWithBytes:buffer length:length];
+        if (self.delegate && [self.delegate respondsToSelector:@selector(udpSocket:didReceiveData:)]) {
+            [self.delegate udpSocket:self didReceiveData:data];
+        }
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  CQBenchmarkStreamGenerator.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 生成合成的参考码流
+ @discussion 码流结构和CQVideoEncoder/CQAudioEncoder的输出一致(4字节起始码、每2秒一个带sps/pps的IDR、每帧带ADTS头)，
+ 负载是随机数据，不能解码，只用于测试解析、分帧、封装、分包等不依赖内容的环节
+ 同样的参数和种子总是生成同样的文件，不同设备上的结果可以对比
+ */
+@interface CQBenchmarkStreamGenerator : NSObject
+
+/**
+ 生成H264码流(.h264)
+ @param path 文件路径，已存在会被覆盖
+ @param duration 时长(秒)
+ @param fps 帧率，关键帧间隔为fps*2
+ @param bitrate 码率(bps)，IDR约为P帧的5倍，每帧大小随机浮动20%
+ @param seed 随机种子
+ */
++ (BOOL)writeH264StreamToPath:(NSString *)path duration:(NSTimeInterval)duration fps:(NSInteger)fps bitrate:(NSInteger)bitrate seed:(uint32_t)seed error:(NSError * _Nullable *)error;
+
+/**
+ 生成只有H264视频轨道的MP4(.mp4)
+ @discussion 帧结构同writeH264StreamToPath，sample为4字节长度头的AVCC(sps/pps在avcC里)，
+ 每chunkDuration秒一个chunk，moov在mdat之后(和AVAssetWriter不做快速启动时一致)，打开时需要越过整个mdat
+ @param path 文件路径，已存在会被覆盖
+ @param duration 时长(秒)
+ @param fps 帧率，关键帧间隔为fps*2，时间刻度为90000
+ @param bitrate 码率(bps)
+ @param chunkDuration 每个chunk的时长(秒)
+ @param seed 随机种子
+ */
++ (BOOL)writeMP4StreamToPath:(NSString *)path duration:(NSTimeInterval)duration fps:(NSInteger)fps bitrate:(NSInteger)bitrate chunkDuration:(NSTimeInterval)chunkDuration seed:(uint32_t)seed error:(NSError * _Nullable *)error;
+
+/**
+ 生成一帧H264(Annex-B，4字节起始码)
+ @param size 图像数据的总大小(不含起始码)
+ @param sliceCount 分成几个片
+ @param isKeyFrame 是否为IDR，IDR前面带sps/pps
+ @param seed 随机种子
+ */
++ (NSData *)h264FrameWithSize:(NSUInteger)size sliceCount:(NSUInteger)sliceCount isKeyFrame:(BOOL)isKeyFrame seed:(uint32_t)seed;
+
+/**
+ 生成若干个ADTS帧
+ @param frameCount 帧数
+ @param frameSize 每帧AAC裸数据的大小
+ @param seed 随机种子
+ */
++ (NSData *)aacDataWithFrameCount:(NSUInteger)frameCount frameSize:(NSUInteger)frameSize sampleRate:(NSInteger)sampleRate channelCount:(NSInteger)channelCount seed:(uint32_t)seed;
+
+/**
+ 生成AAC码流(.aac，ADTS)
+ @param path 文件路径，已存在会被覆盖
+ @param duration 时长(秒)
+ @param sampleRate 采样率
+ @param channelCount 声道数
+ @param bitrate 码率(bps)
+ @param seed 随机种子
+ */
++ (BOOL)writeAACStreamToPath:(NSString *)path duration:(NSTimeInterval)duration sampleRate:(NSInteger)sampleRate channelCount:(NSInteger)channelCount bitrate:(NSInteger)bitrate seed:(uint32_t)seed error:(NSError * _Nullable *)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
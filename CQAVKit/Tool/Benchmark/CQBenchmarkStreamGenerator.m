@@ -0,0 +1,378 @@
+//
+//  CQBenchmarkStreamGenerator.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQBenchmarkStreamGenerator.h"
+#import "CQADTSUtil.h"
+
+static const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+/// 1280x720 Baseline的sps/pps
+static const uint8_t kSps[] = {0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16, 0xE8, 0x06, 0xD0, 0xA1, 0x35};
+static const uint8_t kPps[] = {0x68, 0xCE, 0x06, 0xE2};
+
+/// xorshift32，可复现的随机数
+static inline uint32_t CQBenchmarkRandom(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/// 随机负载，不包含0，保证不会出现起始码和防竞争字节
+static void CQBenchmarkFillPayload(uint8_t *payload, size_t size, uint32_t *state) {
+    for (size_t i = 0; i < size; i++) {
+        uint8_t value = (uint8_t)CQBenchmarkRandom(state);
+        payload[i] = value ? value : 0x55;
+    }
+}
+
+/// 在base附近随机浮动20%
+static size_t CQBenchmarkJitterSize(size_t base, uint32_t *state) {
+    double factor = 0.8 + (CQBenchmarkRandom(state) % 4001) / 10000.0;
+    return MAX((size_t)(base * factor), 16);
+}
+
+#pragma mark - MP4 Box
+static void CQBenchmarkAppendU8(NSMutableData *data, uint8_t value) {
+    [data appendBytes:&value length:1];
+}
+
+static void CQBenchmarkAppendU16(NSMutableData *data, uint16_t value) {
+    uint8_t bytes[2] = {value >> 8, value};
+    [data appendBytes:bytes length:2];
+}
+
+static void CQBenchmarkAppendU32(NSMutableData *data, uint32_t value) {
+    uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    [data appendBytes:bytes length:4];
+}
+
+static void CQBenchmarkAppendZero(NSMutableData *data, NSUInteger length) {
+    [data increaseLengthBy:length];
+}
+
+/// 开始一个box，返回box的起始位置，内容写完后调用CQBenchmarkEndBox回填大小
+static NSUInteger CQBenchmarkBeginBox(NSMutableData *data, uint32_t type) {
+    NSUInteger offset = data.length;
+    CQBenchmarkAppendU32(data, 0);
+    CQBenchmarkAppendU32(data, type);
+    return offset;
+}
+
+static void CQBenchmarkEndBox(NSMutableData *data, NSUInteger offset) {
+    uint32_t size = (uint32_t)(data.length - offset);
+    uint8_t bytes[4] = {size >> 24, size >> 16, size >> 8, size};
+    [data replaceBytesInRange:NSMakeRange(offset, 4) withBytes:bytes];
+}
+
+/// version + flags
+static void CQBenchmarkAppendFullBoxHeader(NSMutableData *data, uint8_t version, uint32_t flags) {
+    CQBenchmarkAppendU32(data, ((uint32_t)version << 24) | (flags & 0xFFFFFF));
+}
+
+/// 单位矩阵
+static void CQBenchmarkAppendMatrix(NSMutableData *data) {
+    static const uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (int i = 0; i < 9; i++) CQBenchmarkAppendU32(data, matrix[i]);
+}
+
+@implementation CQBenchmarkStreamGenerator
+
++ (BOOL)writeH264StreamToPath:(NSString *)path duration:(NSTimeInterval)duration fps:(NSInteger)fps bitrate:(NSInteger)bitrate seed:(uint32_t)seed error:(NSError **)error {
+    FILE *file = fopen(path.fileSystemRepresentation, "wb");
+    if (!file) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        return NO;
+    }
+    uint32_t state = seed ?: 1;
+    NSInteger gop = MAX(fps * 2, 1);
+    NSInteger frameCount = (NSInteger)(duration * fps);
+    // 一个GOP的字节数 = IDR(5份) + P帧(gop-1份)
+    size_t pFrameSize = (size_t)(bitrate / 8 * 2) / (size_t)(gop - 1 + 5);
+    size_t idrFrameSize = pFrameSize * 5;
+    uint8_t *payload = malloc(MAX(idrFrameSize * 2, 64));
+    BOOL result = YES;
+    for (NSInteger i = 0; i < frameCount && result; i++) {
+        BOOL isKeyFrame = (i % gop == 0);
+        size_t size = CQBenchmarkJitterSize(isKeyFrame ? idrFrameSize : pFrameSize, &state);
+        CQBenchmarkFillPayload(payload, size, &state);
+        // NALU头: IDR为0x65，P帧参考帧0x41，每隔一个P帧为非参考帧0x01
+        payload[0] = isKeyFrame ? 0x65 : ((i % 2) ? 0x01 : 0x41);
+        // first_mb_in_slice=0(ue第一位为1)，slice_type IDR为7(I)、其它为5(P)
+        payload[1] = isKeyFrame ? 0x88 : 0x9A;
+        if (isKeyFrame) {
+            fwrite(kStartCode, 1, sizeof(kStartCode), file);
+            fwrite(kSps, 1, sizeof(kSps), file);
+            fwrite(kStartCode, 1, sizeof(kStartCode), file);
+            fwrite(kPps, 1, sizeof(kPps), file);
+        }
+        fwrite(kStartCode, 1, sizeof(kStartCode), file);
+        result = (fwrite(payload, 1, size, file) == size);
+    }
+    free(payload);
+    if (fclose(file) != 0) result = NO;
+    if (!result && error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    return result;
+}
+
++ (BOOL)writeMP4StreamToPath:(NSString *)path duration:(NSTimeInterval)duration fps:(NSInteger)fps bitrate:(NSInteger)bitrate chunkDuration:(NSTimeInterval)chunkDuration seed:(uint32_t)seed error:(NSError **)error {
+    static const uint32_t timescale = 90000;
+    static const uint16_t width = 1280, height = 720;
+    uint32_t state = seed ?: 1;
+    fps = MAX(fps, 1);
+    NSInteger gop = fps * 2;
+    uint32_t frameCount = (uint32_t)MAX(llround(duration * fps), 1);
+    uint32_t sampleDelta = timescale / (uint32_t)fps;
+    uint32_t samplesPerChunk = (uint32_t)MAX(chunkDuration * fps, 1);
+    uint32_t chunkCount = (frameCount + samplesPerChunk - 1) / samplesPerChunk;
+    size_t pFrameSize = (size_t)(bitrate / 8 * 2) / (size_t)(gop - 1 + 5);
+    size_t idrFrameSize = pFrameSize * 5;
+
+    // ftyp + mdat，sample按顺序写，记录大小和chunk偏移
+    NSMutableData *file = [NSMutableData dataWithCapacity:(NSUInteger)(bitrate / 8 * duration * 1.25) + 4096];
+    NSUInteger box = CQBenchmarkBeginBox(file, 'ftyp');
+    CQBenchmarkAppendU32(file, 'isom');
+    CQBenchmarkAppendU32(file, 512);
+    CQBenchmarkAppendU32(file, 'isom');
+    CQBenchmarkAppendU32(file, 'avc1');
+    CQBenchmarkAppendU32(file, 'mp41');
+    CQBenchmarkEndBox(file, box);
+
+    uint32_t *sampleSizes = malloc(frameCount * sizeof(uint32_t));
+    uint32_t *chunkOffsets = malloc(chunkCount * sizeof(uint32_t));
+    NSUInteger mdat = CQBenchmarkBeginBox(file, 'mdat');
+    for (uint32_t i = 0; i < frameCount; i++) {
+        if (i % samplesPerChunk == 0) chunkOffsets[i / samplesPerChunk] = (uint32_t)file.length;
+        BOOL isKeyFrame = (i % gop == 0);
+        size_t size = CQBenchmarkJitterSize(isKeyFrame ? idrFrameSize : pFrameSize, &state);
+        CQBenchmarkAppendU32(file, (uint32_t)size);
+        NSUInteger offset = file.length;
+        [file increaseLengthBy:size];
+        uint8_t *payload = (uint8_t *)file.mutableBytes + offset;
+        CQBenchmarkFillPayload(payload, size, &state);
+        payload[0] = isKeyFrame ? 0x65 : ((i % 2) ? 0x01 : 0x41);
+        payload[1] = isKeyFrame ? 0x88 : 0x9A;
+        sampleSizes[i] = (uint32_t)(size + 4);
+    }
+    CQBenchmarkEndBox(file, mdat);
+
+    // moov
+    uint32_t mediaDuration = frameCount * sampleDelta;
+    NSUInteger moov = CQBenchmarkBeginBox(file, 'moov');
+    box = CQBenchmarkBeginBox(file, 'mvhd');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendZero(file, 8);
+    CQBenchmarkAppendU32(file, timescale);
+    CQBenchmarkAppendU32(file, mediaDuration);
+    CQBenchmarkAppendU32(file, 0x00010000);
+    CQBenchmarkAppendU16(file, 0x0100);
+    CQBenchmarkAppendZero(file, 10);
+    CQBenchmarkAppendMatrix(file);
+    CQBenchmarkAppendZero(file, 24);
+    CQBenchmarkAppendU32(file, 2);
+    CQBenchmarkEndBox(file, box);
+
+    NSUInteger trak = CQBenchmarkBeginBox(file, 'trak');
+    box = CQBenchmarkBeginBox(file, 'tkhd');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 3);
+    CQBenchmarkAppendZero(file, 8);
+    CQBenchmarkAppendU32(file, 1);
+    CQBenchmarkAppendZero(file, 4);
+    CQBenchmarkAppendU32(file, mediaDuration);
+    CQBenchmarkAppendZero(file, 16);
+    CQBenchmarkAppendMatrix(file);
+    CQBenchmarkAppendU32(file, (uint32_t)width << 16);
+    CQBenchmarkAppendU32(file, (uint32_t)height << 16);
+    CQBenchmarkEndBox(file, box);
+
+    NSUInteger mdia = CQBenchmarkBeginBox(file, 'mdia');
+    box = CQBenchmarkBeginBox(file, 'mdhd');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendZero(file, 8);
+    CQBenchmarkAppendU32(file, timescale);
+    CQBenchmarkAppendU32(file, mediaDuration);
+    CQBenchmarkAppendU16(file, 0x55C4);
+    CQBenchmarkAppendU16(file, 0);
+    CQBenchmarkEndBox(file, box);
+    box = CQBenchmarkBeginBox(file, 'hdlr');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, 0);
+    CQBenchmarkAppendU32(file, 'vide');
+    CQBenchmarkAppendZero(file, 12);
+    [file appendBytes:"VideoHandler" length:13];
+    CQBenchmarkEndBox(file, box);
+
+    NSUInteger minf = CQBenchmarkBeginBox(file, 'minf');
+    box = CQBenchmarkBeginBox(file, 'vmhd');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 1);
+    CQBenchmarkAppendZero(file, 8);
+    CQBenchmarkEndBox(file, box);
+    NSUInteger dinf = CQBenchmarkBeginBox(file, 'dinf');
+    NSUInteger dref = CQBenchmarkBeginBox(file, 'dref');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, 1);
+    box = CQBenchmarkBeginBox(file, 'url ');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 1);
+    CQBenchmarkEndBox(file, box);
+    CQBenchmarkEndBox(file, dref);
+    CQBenchmarkEndBox(file, dinf);
+
+    NSUInteger stbl = CQBenchmarkBeginBox(file, 'stbl');
+    NSUInteger stsd = CQBenchmarkBeginBox(file, 'stsd');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, 1);
+    NSUInteger avc1 = CQBenchmarkBeginBox(file, 'avc1');
+    CQBenchmarkAppendZero(file, 6);
+    CQBenchmarkAppendU16(file, 1);
+    CQBenchmarkAppendZero(file, 16);
+    CQBenchmarkAppendU16(file, width);
+    CQBenchmarkAppendU16(file, height);
+    CQBenchmarkAppendU32(file, 0x00480000);
+    CQBenchmarkAppendU32(file, 0x00480000);
+    CQBenchmarkAppendU32(file, 0);
+    CQBenchmarkAppendU16(file, 1);
+    CQBenchmarkAppendZero(file, 32);
+    CQBenchmarkAppendU16(file, 0x0018);
+    CQBenchmarkAppendU16(file, 0xFFFF);
+    box = CQBenchmarkBeginBox(file, 'avcC');
+    CQBenchmarkAppendU8(file, 1);
+    CQBenchmarkAppendU8(file, kSps[1]);
+    CQBenchmarkAppendU8(file, kSps[2]);
+    CQBenchmarkAppendU8(file, kSps[3]);
+    CQBenchmarkAppendU8(file, 0xFF);
+    CQBenchmarkAppendU8(file, 0xE1);
+    CQBenchmarkAppendU16(file, sizeof(kSps));
+    [file appendBytes:kSps length:sizeof(kSps)];
+    CQBenchmarkAppendU8(file, 1);
+    CQBenchmarkAppendU16(file, sizeof(kPps));
+    [file appendBytes:kPps length:sizeof(kPps)];
+    CQBenchmarkEndBox(file, box);
+    CQBenchmarkEndBox(file, avc1);
+    CQBenchmarkEndBox(file, stsd);
+
+    box = CQBenchmarkBeginBox(file, 'stts');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, 1);
+    CQBenchmarkAppendU32(file, frameCount);
+    CQBenchmarkAppendU32(file, sampleDelta);
+    CQBenchmarkEndBox(file, box);
+
+    box = CQBenchmarkBeginBox(file, 'stss');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, (uint32_t)((frameCount + gop - 1) / gop));
+    for (uint32_t i = 0; i < frameCount; i += gop) {
+        CQBenchmarkAppendU32(file, i + 1);
+    }
+    CQBenchmarkEndBox(file, box);
+
+    // 最后一个chunk不满时单独一个条目
+    uint32_t lastChunkSamples = frameCount - (chunkCount - 1) * samplesPerChunk;
+    BOOL hasPartialChunk = lastChunkSamples != samplesPerChunk;
+    box = CQBenchmarkBeginBox(file, 'stsc');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, hasPartialChunk ? 2 : 1);
+    CQBenchmarkAppendU32(file, 1);
+    CQBenchmarkAppendU32(file, samplesPerChunk);
+    CQBenchmarkAppendU32(file, 1);
+    if (hasPartialChunk) {
+        CQBenchmarkAppendU32(file, chunkCount);
+        CQBenchmarkAppendU32(file, lastChunkSamples);
+        CQBenchmarkAppendU32(file, 1);
+    }
+    CQBenchmarkEndBox(file, box);
+
+    box = CQBenchmarkBeginBox(file, 'stsz');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, 0);
+    CQBenchmarkAppendU32(file, frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        CQBenchmarkAppendU32(file, sampleSizes[i]);
+    }
+    CQBenchmarkEndBox(file, box);
+
+    box = CQBenchmarkBeginBox(file, 'stco');
+    CQBenchmarkAppendFullBoxHeader(file, 0, 0);
+    CQBenchmarkAppendU32(file, chunkCount);
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        CQBenchmarkAppendU32(file, chunkOffsets[i]);
+    }
+    CQBenchmarkEndBox(file, box);
+    CQBenchmarkEndBox(file, stbl);
+    CQBenchmarkEndBox(file, minf);
+    CQBenchmarkEndBox(file, mdia);
+    CQBenchmarkEndBox(file, trak);
+    CQBenchmarkEndBox(file, moov);
+    free(sampleSizes);
+    free(chunkOffsets);
+
+    return [file writeToFile:path options:NSDataWritingAtomic error:error];
+}
+
++ (BOOL)writeAACStreamToPath:(NSString *)path duration:(NSTimeInterval)duration sampleRate:(NSInteger)sampleRate channelCount:(NSInteger)channelCount bitrate:(NSInteger)bitrate seed:(uint32_t)seed error:(NSError **)error {
+    FILE *file = fopen(path.fileSystemRepresentation, "wb");
+    if (!file) {
+        if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        return NO;
+    }
+    uint32_t state = seed ?: 1;
+    // 每帧1024个采样
+    NSInteger frameCount = (NSInteger)(duration * sampleRate / 1024);
+    size_t frameSize = (size_t)(bitrate / 8 * 1024 / MAX(sampleRate, 1));
+    uint8_t frame[CQADTSHeaderSize + 2048];
+    BOOL result = YES;
+    for (NSInteger i = 0; i < frameCount && result; i++) {
+        // ADTS帧长度最多13位，这里限制在2048以内
+        size_t rawSize = MIN(CQBenchmarkJitterSize(frameSize, &state), (size_t)2048);
+        CQADTSWriteHeader(frame, sampleRate, channelCount, rawSize);
+        CQBenchmarkFillPayload(frame + CQADTSHeaderSize, rawSize, &state);
+        size_t size = CQADTSHeaderSize + rawSize;
+        result = (fwrite(frame, 1, size, file) == size);
+    }
+    if (fclose(file) != 0) result = NO;
+    if (!result && error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    return result;
+}
+
++ (NSData *)h264FrameWithSize:(NSUInteger)size sliceCount:(NSUInteger)sliceCount isKeyFrame:(BOOL)isKeyFrame seed:(uint32_t)seed {
+    uint32_t state = seed ?: 1;
+    sliceCount = MAX(sliceCount, 1);
+    size_t sliceSize = MAX(size / sliceCount, 16);
+    NSMutableData *frame = [NSMutableData dataWithCapacity:sliceSize * sliceCount + sizeof(kSps) + sizeof(kPps) + 4 * (sliceCount + 2)];
+    if (isKeyFrame) {
+        [frame appendBytes:kStartCode length:sizeof(kStartCode)];
+        [frame appendBytes:kSps length:sizeof(kSps)];
+        [frame appendBytes:kStartCode length:sizeof(kStartCode)];
+        [frame appendBytes:kPps length:sizeof(kPps)];
+    }
+    for (NSUInteger i = 0; i < sliceCount; i++) {
+        [frame appendBytes:kStartCode length:sizeof(kStartCode)];
+        NSUInteger offset = frame.length;
+        [frame increaseLengthBy:sliceSize];
+        uint8_t *slice = (uint8_t *)frame.mutableBytes + offset;
+        CQBenchmarkFillPayload(slice, sliceSize, &state);
+        slice[0] = isKeyFrame ? 0x65 : 0x41;
+        // 只有第一个片的first_mb_in_slice为0，slice_type同上
+        slice[1] = (i == 0) ? (isKeyFrame ? 0x88 : 0x9A) : 0x7F;
+    }
+    return frame;
+}
+
++ (NSData *)aacDataWithFrameCount:(NSUInteger)frameCount frameSize:(NSUInteger)frameSize sampleRate:(NSInteger)sampleRate channelCount:(NSInteger)channelCount seed:(uint32_t)seed {
+    uint32_t state = seed ?: 1;
+    frameSize = MIN(frameSize, (NSUInteger)2048);
+    NSMutableData *data = [NSMutableData dataWithLength:frameCount * (CQADTSHeaderSize + frameSize)];
+    uint8_t *frame = data.mutableBytes;
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        CQADTSWriteHeader(frame, sampleRate, channelCount, frameSize);
+        CQBenchmarkFillPayload(frame + CQADTSHeaderSize, frameSize, &state);
+        frame += CQADTSHeaderSize + frameSize;
+    }
+    return data;
+}
+
+@end
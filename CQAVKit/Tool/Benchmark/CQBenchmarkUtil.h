@@ -0,0 +1,80 @@
+//
+//  CQBenchmarkUtil.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ 基准测试工具
+ @discussion 计时、延迟分位数统计、内存和malloc统计，输出的报告都是可以直接转JSON的NSDictionary
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 当前时间(纳秒)，单调递增
+FOUNDATION_EXPORT uint64_t CQBenchmarkNowNanos(void);
+
+/// 当前内存占用(phys_footprint，和Xcode内存仪表、系统内存限制用的是同一个值)
+FOUNDATION_EXPORT uint64_t CQBenchmarkMemoryFootprint(void);
+
+/// 进程驻留内存的峰值
+FOUNDATION_EXPORT uint64_t CQBenchmarkPeakResidentSize(void);
+
+/// malloc统计(所有zone)
+typedef struct {
+    uint64_t blocksInUse;  ///< 未释放的内存块个数
+    uint64_t bytesInUse;  ///< 未释放的字节数
+} CQBenchmarkMallocStats;
+
+FOUNDATION_EXPORT CQBenchmarkMallocStats CQBenchmarkMallocStatistics(void);
+
+/**
+ 两个8位平面的PSNR(dB)
+ @discussion 峰值255，完全相同时返回INFINITY
+ */
+FOUNDATION_EXPORT double CQBenchmarkPSNR(const uint8_t *a, size_t aBytesPerRow, const uint8_t *b, size_t bBytesPerRow, size_t width, size_t height);
+
+/**
+ 延迟统计
+ @discussion 记录每次的耗时，报告时排序计算分位数，非线程安全
+ */
+@interface CQLatencyRecorder : NSObject
+
+/**
+ 唯一初始化函数
+ @param name 名称(报告中的key)
+ */
+- (instancetype)initWithName:(NSString *)name;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *name;  ///< 名称
+@property (nonatomic, assign, readonly) NSUInteger count;  ///< 记录的次数
+@property (nonatomic, assign, readonly) uint64_t totalNanos;  ///< 总耗时
+
+/// 记录一次耗时
+- (void)addNanos:(uint64_t)nanos;
+
+/// 记录从startNanos(CQBenchmarkNowNanos)到现在的耗时
+- (void)addSinceNanos:(uint64_t)startNanos;
+
+/**
+ 分位数
+ @param percentile 0~100
+ @return 纳秒
+ */
+- (uint64_t)nanosAtPercentile:(double)percentile;
+
+/**
+ 报告，时间单位为微秒
+ @return count/totalMs/meanUs/p50Us/p90Us/p99Us/maxUs
+ */
+- (NSDictionary<NSString *, NSNumber *> *)report;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,130 @@
+//
+//  CQBenchmarkUtil.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQBenchmarkUtil.h"
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+
+uint64_t CQBenchmarkNowNanos(void) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+static BOOL CQBenchmarkVMInfo(task_vm_info_data_t *info) {
+    mach_msg_type_number_t count = TASK_VM_INFO_COUNT;
+    return task_info(mach_task_self(), TASK_VM_INFO, (task_info_t)info, &count) == KERN_SUCCESS;
+}
+
+uint64_t CQBenchmarkMemoryFootprint(void) {
+    task_vm_info_data_t info;
+    return CQBenchmarkVMInfo(&info) ? info.phys_footprint : 0;
+}
+
+uint64_t CQBenchmarkPeakResidentSize(void) {
+    task_vm_info_data_t info;
+    return CQBenchmarkVMInfo(&info) ? info.resident_size_peak : 0;
+}
+
+CQBenchmarkMallocStats CQBenchmarkMallocStatistics(void) {
+    malloc_statistics_t statistics = {0};
+    // zone为NULL时统计所有zone
+    malloc_zone_statistics(NULL, &statistics);
+    CQBenchmarkMallocStats stats = {statistics.blocks_in_use, statistics.size_in_use};
+    return stats;
+}
+
+double CQBenchmarkPSNR(const uint8_t *a, size_t aBytesPerRow, const uint8_t *b, size_t bBytesPerRow, size_t width, size_t height) {
+    uint64_t squaredError = 0;
+    for (size_t j = 0; j < height; j++) {
+        const uint8_t *aRow = a + j * aBytesPerRow, *bRow = b + j * bBytesPerRow;
+        for (size_t i = 0; i < width; i++) {
+            int32_t difference = (int32_t)aRow[i] - bRow[i];
+            squaredError += (uint64_t)(difference * difference);
+        }
+    }
+    if (squaredError == 0 || width == 0 || height == 0) return INFINITY;
+    double meanSquaredError = (double)squaredError / (width * height);
+    return 10 * log10(255.0 * 255.0 / meanSquaredError);
+}
+
+@interface CQLatencyRecorder ()
+@property (nonatomic, strong) NSMutableData *samples;  ///< uint64_t纳秒
+@end
+
+@implementation CQLatencyRecorder
+
+#pragma mark - Init
+- (instancetype)initWithName:(NSString *)name {
+    if (self = [super init]) {
+        _name = [name copy];
+        _samples = [NSMutableData dataWithCapacity:4096 * sizeof(uint64_t)];
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (NSUInteger)count {
+    return self.samples.length / sizeof(uint64_t);
+}
+
+- (void)addNanos:(uint64_t)nanos {
+    [self.samples appendBytes:&nanos length:sizeof(nanos)];
+    _totalNanos += nanos;
+}
+
+- (void)addSinceNanos:(uint64_t)startNanos {
+    [self addNanos:CQBenchmarkNowNanos() - startNanos];
+}
+
+- (uint64_t)nanosAtPercentile:(double)percentile {
+    NSData *sorted = [self sortedSamples];
+    return [self nanosAtPercentile:percentile inSortedSamples:sorted];
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)report {
+    NSUInteger count = self.count;
+    if (count == 0) return @{@"count": @0};
+    NSData *sorted = [self sortedSamples];
+    return @{
+        @"count": @(count),
+        @"totalMs": @(self.totalNanos / 1e6),
+        @"meanUs": @(self.totalNanos / 1e3 / count),
+        @"p50Us": @([self nanosAtPercentile:50 inSortedSamples:sorted] / 1e3),
+        @"p90Us": @([self nanosAtPercentile:90 inSortedSamples:sorted] / 1e3),
+        @"p99Us": @([self nanosAtPercentile:99 inSortedSamples:sorted] / 1e3),
+        @"maxUs": @([self nanosAtPercentile:100 inSortedSamples:sorted] / 1e3),
+    };
+}
+
+#pragma mark - Private Func
+static int CQCompareUInt64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+- (NSData *)sortedSamples {
+    NSMutableData *sorted = [self.samples mutableCopy];
+    qsort(sorted.mutableBytes, self.count, sizeof(uint64_t), CQCompareUInt64);
+    return sorted;
+}
+
+/// 最近秩法
+- (uint64_t)nanosAtPercentile:(double)percentile inSortedSamples:(NSData *)sorted {
+    NSUInteger count = sorted.length / sizeof(uint64_t);
+    if (count == 0) return 0;
+    double rank = ceil(MIN(MAX(percentile, 0), 100) / 100.0 * count);
+    NSUInteger index = rank < 1 ? 0 : (NSUInteger)rank - 1;
+    return ((const uint64_t *)sorted.bytes)[MIN(index, count - 1)];
+}
+
+@end
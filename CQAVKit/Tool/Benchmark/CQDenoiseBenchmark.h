@@ -0,0 +1,31 @@
+//
+//  CQDenoiseBenchmark.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 时域降噪的效果基准测试
+ @discussion 合成带高斯噪声的720p片段(渐变 + 纹理 + 移动的方块，已知干净的画面)，分别不降噪和用每个强度降噪后，
+ 以固定质量(kVTCompressionPropertyKey_Quality，不限码率)编码，对比:
+ 降噪耗时(每帧分位数、fps)、亮度PSNR(和干净画面比)、编码后的字节数和码率，以及相对不降噪的PSNR提升和码率节省
+ 同一个片段的噪声每次都相同，不同版本/设备的结果可以直接对比
+ */
+@interface CQDenoiseBenchmark : NSObject
+
+/**
+ 运行所有片段
+ @discussion 报告写入directory/denoise_benchmark.json，编码器不支持固定质量时qualityApplied为NO(码率由编码器默认码控决定，只有参考意义)
+ @param directory 报告的目录
+ @param completionHandler 完成后在后台队列回调
+ */
++ (void)runSuiteInDirectory:(NSString *)directory completionHandler:(nullable void (^)(NSArray<NSDictionary *> *reports, NSString * _Nullable reportPath))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,211 @@
+//
+//  CQDenoiseBenchmark.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 画面是按帧号算出来的，干净的亮度留一份用于算PSNR，噪声用固定种子的xorshift生成，每个强度看到的输入完全相同
+ 2 噪声用4个均匀分布的字节求和近似高斯分布，色度的噪声取亮度的一半(和传感器的表现接近)
+ 3 每个强度一个编码会话，不设码率只设质量，降噪去掉的噪声直接体现为码率下降；和直播一样不重排，整段一个GOP
+ 4 降噪耗时只统计createDenoisedPixelBuffer，PSNR统计的是送进编码器的画面(不含编码损失)
+ */
+
+#import "CQDenoiseBenchmark.h"
+#import <VideoToolbox/VideoToolbox.h>
+#import "CQBenchmarkUtil.h"
+#import "CQPipelineBenchmark.h"
+#import "CQTemporalDenoiser.h"
+
+static const size_t kClipWidth = 1280;
+static const size_t kClipHeight = 720;
+static const NSUInteger kClipFrameCount = 90;
+static const int32_t kClipFrameRate = 30;
+static const size_t kSquareSize = 200;  ///< 移动方块的边长
+static const size_t kSquareStep = 6;  ///< 方块每帧移动的像素
+static const float kEncodeQuality = 0.6;  ///< 固定质量 0~1
+
+static inline uint32_t CQDenoiseBenchmarkRandom(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/// 加上标准差为sigma的近似高斯噪声: 4个字节的和均值510，标准差约147.8
+static inline uint8_t CQDenoiseBenchmarkAddNoise(uint8_t value, double sigma, uint32_t *state) {
+    uint32_t random = CQDenoiseBenchmarkRandom(state);
+    int32_t sum = (int32_t)(random & 0xFF) + ((random >> 8) & 0xFF) + ((random >> 16) & 0xFF) + (random >> 24);
+    int32_t noisy = value + (int32_t)lround((sum - 510) * sigma / 147.8);
+    return (uint8_t)MIN(MAX(noisy, 0), 255);
+}
+
+/**
+ 画第frameIndex帧: 横向渐变 + 8x8棋盘纹理 + 向右移动的竖条纹方块，色度为竖直渐变
+ @param clean 干净的亮度，紧密排列
+ */
+static void CQDenoiseBenchmarkDrawFrame(uint8_t *clean, CVPixelBufferRef pixelBuffer, NSUInteger frameIndex, double sigma) {
+    uint8_t *y = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0), *uv = CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1);
+    size_t yBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0), uvBytesPerRow = CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1);
+    uint32_t state = (uint32_t)(frameIndex * 2654435761u) ^ (uint32_t)lround(sigma * 1000) ^ 0x9E3779B9;
+    size_t squareX = (60 + frameIndex * kSquareStep) % (kClipWidth - kSquareSize), squareY = (kClipHeight - kSquareSize) / 2;
+    for (size_t j = 0; j < kClipHeight; j++) {
+        for (size_t i = 0; i < kClipWidth; i++) {
+            int32_t value = 40 + (int32_t)(i * 120 / kClipWidth) + (int32_t)(j * 40 / kClipHeight) + (((i / 8) + (j / 8)) % 2 ? 12 : 0);
+            if (i >= squareX && i < squareX + kSquareSize && j >= squareY && j < squareY + kSquareSize) {
+                value = (i / 4) % 2 ? 170 : 200;
+            }
+            clean[j * kClipWidth + i] = (uint8_t)value;
+            y[j * yBytesPerRow + i] = CQDenoiseBenchmarkAddNoise((uint8_t)value, sigma, &state);
+        }
+    }
+    for (size_t j = 0; j < kClipHeight / 2; j++) {
+        uint8_t u = (uint8_t)(112 + j * 32 / (kClipHeight / 2)), v = (uint8_t)(144 - j * 32 / (kClipHeight / 2));
+        for (size_t i = 0; i < kClipWidth / 2; i++) {
+            uv[j * uvBytesPerRow + i * 2] = CQDenoiseBenchmarkAddNoise(u, sigma / 2, &state);
+            uv[j * uvBytesPerRow + i * 2 + 1] = CQDenoiseBenchmarkAddNoise(v, sigma / 2, &state);
+        }
+    }
+}
+
+@implementation CQDenoiseBenchmark
+
+#pragma mark - Public Func
++ (void)runSuiteInDirectory:(NSString *)directory completionHandler:(void (^)(NSArray<NSDictionary *> *, NSString *))completionHandler {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        // 名称 噪声标准差: 明亮的室内、昏暗的室内、夜间
+        NSArray<NSArray *> *clips = @[@[@"720p30_sigma3", @3.0], @[@"720p30_sigma6", @6.0], @[@"720p30_sigma9", @9.0]];
+        NSMutableArray<NSDictionary *> *reports = [NSMutableArray array];
+        for (NSArray *clip in clips) {
+            NSDictionary *report = [self runClipWithName:clip[0] sigma:[clip[1] doubleValue]];
+            if (report) [reports addObject:report];
+        }
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        NSString *reportPath = [directory stringByAppendingPathComponent:@"denoise_benchmark.json"];
+        if (![[CQPipelineBenchmark JSONDataWithReport:reports] writeToFile:reportPath atomically:YES]) reportPath = nil;
+        if (completionHandler) completionHandler(reports, reportPath);
+    });
+}
+
+#pragma mark - Private Func
+/// 一个片段依次不降噪和每个强度降噪
++ (NSDictionary *)runClipWithName:(NSString *)name sigma:(double)sigma {
+    NSDictionary *attributes = @{
+        (__bridge NSString *)kCVPixelBufferPixelFormatTypeKey: @(kCVPixelFormatType_420YpCbCr8BiPlanarFullRange),
+        (__bridge NSString *)kCVPixelBufferWidthKey: @(kClipWidth),
+        (__bridge NSString *)kCVPixelBufferHeightKey: @(kClipHeight),
+        (__bridge NSString *)kCVPixelBufferIOSurfacePropertiesKey: @{},
+    };
+    CVPixelBufferPoolRef pool = NULL;
+    CVReturn result = CVPixelBufferPoolCreate(kCFAllocatorDefault, NULL, (__bridge CFDictionaryRef)attributes, &pool);
+    if (result != kCVReturnSuccess) {
+        NSLog(@"CQDenoiseBenchmark-CVPixelBufferPoolCreate failed. result = %d", (int)result);
+        return nil;
+    }
+    NSMutableData *clean = [NSMutableData dataWithLength:kClipWidth * kClipHeight];
+    NSArray<NSString *> *variantNames = @[@"none", @"low", @"medium", @"high"];
+    NSMutableArray<NSMutableDictionary *> *variants = [NSMutableArray array];
+    BOOL isQualityApplied = YES;
+    for (NSUInteger v = 0; v < variantNames.count; v++) {
+        // 第0个不降噪
+        CQTemporalDenoiser *denoiser = v > 0 ? [[CQTemporalDenoiser alloc] initWithStrength:(CQDenoiseStrength)(v - 1)] : nil;
+        CQLatencyRecorder *recorder = [[CQLatencyRecorder alloc] initWithName:@"denoise"];
+        BOOL isQualityAppliedToSession = NO;
+        VTCompressionSessionRef session = [self createSessionWithQualityApplied:&isQualityAppliedToSession];
+        if (!session) break;
+        isQualityApplied = isQualityApplied && isQualityAppliedToSession;
+        __block uint64_t encodedBytes = 0;
+        double psnrSum = 0;
+        for (NSUInteger frameIndex = 0; frameIndex < kClipFrameCount; frameIndex++) {
+            CVPixelBufferRef source = NULL;
+            result = CVPixelBufferPoolCreatePixelBuffer(kCFAllocatorDefault, pool, &source);
+            if (result != kCVReturnSuccess) {
+                NSLog(@"CQDenoiseBenchmark-CVPixelBufferPoolCreatePixelBuffer failed. result = %d", (int)result);
+                break;
+            }
+            CVPixelBufferLockBaseAddress(source, 0);
+            CQDenoiseBenchmarkDrawFrame(clean.mutableBytes, source, frameIndex, sigma);
+            CVPixelBufferUnlockBaseAddress(source, 0);
+            CVPixelBufferRef denoised = NULL;
+            if (denoiser) {
+                uint64_t start = CQBenchmarkNowNanos();
+                denoised = [denoiser createDenoisedPixelBuffer:source];
+                [recorder addSinceNanos:start];
+            }
+            CVPixelBufferRef input = denoised ?: source;
+            CVPixelBufferLockBaseAddress(input, kCVPixelBufferLock_ReadOnly);
+            psnrSum += CQBenchmarkPSNR(clean.bytes, kClipWidth, CVPixelBufferGetBaseAddressOfPlane(input, 0), CVPixelBufferGetBytesPerRowOfPlane(input, 0), kClipWidth, kClipHeight);
+            CVPixelBufferUnlockBaseAddress(input, kCVPixelBufferLock_ReadOnly);
+            OSStatus status = VTCompressionSessionEncodeFrameWithOutputHandler(session, input, CMTimeMake(frameIndex, kClipFrameRate), CMTimeMake(1, kClipFrameRate), NULL, NULL, ^(OSStatus outputStatus, VTEncodeInfoFlags infoFlags, CMSampleBufferRef sampleBuffer) {
+                // 同一个会话的回调是串行的
+                if (outputStatus == noErr && sampleBuffer) encodedBytes += CMSampleBufferGetTotalSampleSize(sampleBuffer);
+            });
+            if (status != noErr) NSLog(@"CQDenoiseBenchmark-VTCompressionSessionEncodeFrame failed. status = %d", (int)status);
+            CVPixelBufferRelease(denoised);
+            CVPixelBufferRelease(source);
+        }
+        VTCompressionSessionCompleteFrames(session, kCMTimeInvalid);
+        VTCompressionSessionInvalidate(session);
+        CFRelease(session);
+
+        double duration = (double)kClipFrameCount / kClipFrameRate;
+        NSMutableDictionary *variant = [NSMutableDictionary dictionary];
+        variant[@"strength"] = variantNames[v];
+        variant[@"psnrY"] = @(psnrSum / kClipFrameCount);
+        variant[@"encodedBytes"] = @(encodedBytes);
+        variant[@"kbps"] = @(encodedBytes * 8 / duration / 1000);
+        if (denoiser && recorder.count > 0) {
+            variant[@"denoise"] = [recorder report];
+            variant[@"denoiseFps"] = @(recorder.count * (double)NSEC_PER_SEC / MAX(recorder.totalNanos, (uint64_t)1));
+        }
+        [variants addObject:variant];
+    }
+    CVPixelBufferPoolRelease(pool);
+    if (variants.count == 0) return nil;
+
+    // 相对不降噪
+    double basePSNR = [variants[0][@"psnrY"] doubleValue], baseKbps = [variants[0][@"kbps"] doubleValue];
+    for (NSUInteger v = 1; v < variants.count; v++) {
+        variants[v][@"psnrGainDb"] = @([variants[v][@"psnrY"] doubleValue] - basePSNR);
+        if (baseKbps > 0) variants[v][@"bitrateSavingPercent"] = @((1 - [variants[v][@"kbps"] doubleValue] / baseKbps) * 100);
+    }
+    return @{
+        @"name": name,
+        @"width": @(kClipWidth),
+        @"height": @(kClipHeight),
+        @"frameCount": @(kClipFrameCount),
+        @"frameRate": @(kClipFrameRate),
+        @"noiseSigma": @(sigma),
+        @"quality": @(kEncodeQuality),
+        @"qualityApplied": @(isQualityApplied),
+        @"variants": variants,
+    };
+}
+
+/**
+ 固定质量的H264编码会话
+ @param isQualityApplied 编码器是否接受了kVTCompressionPropertyKey_Quality
+ @return 会话(需要释放)，失败返回NULL
+ */
++ (VTCompressionSessionRef)createSessionWithQualityApplied:(BOOL *)isQualityApplied CF_RETURNS_RETAINED {
+    VTCompressionSessionRef session = NULL;
+    OSStatus status = VTCompressionSessionCreate(kCFAllocatorDefault, (int32_t)kClipWidth, (int32_t)kClipHeight, kCMVideoCodecType_H264, NULL, NULL, NULL, NULL, NULL, &session);
+    if (status != noErr) {
+        NSLog(@"CQDenoiseBenchmark-VTCompressionSessionCreate failed. status = %d", (int)status);
+        return NULL;
+    }
+    VTSessionSetProperty(session, kVTCompressionPropertyKey_ProfileLevel, kVTProfileLevel_H264_High_AutoLevel);
+    VTSessionSetProperty(session, kVTCompressionPropertyKey_AllowFrameReordering, kCFBooleanFalse);
+    VTSessionSetProperty(session, kVTCompressionPropertyKey_MaxKeyFrameInterval, (__bridge CFNumberRef)@(kClipFrameCount));
+    VTSessionSetProperty(session, kVTCompressionPropertyKey_ExpectedFrameRate, (__bridge CFNumberRef)@(kClipFrameRate));
+    status = VTSessionSetProperty(session, kVTCompressionPropertyKey_Quality, (__bridge CFNumberRef)@(kEncodeQuality));
+    *isQualityApplied = status == noErr;
+    VTCompressionSessionPrepareToEncodeFrames(session);
+    return session;
+}
+
+@end
@@ -0,0 +1,25 @@
+//
+//  CQMediaKernelBenchmarks.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 媒体内核的微基准测试用例
+ @discussion 起始码查找、Annex-B/AVCC转换、ADTS解析、环形缓存、RTP分包/解包、TS封装、裸码流索引、编解码任务调度、阶段间数据包队列，
+ 数据规模按720p/4K的IDR大小和48kHz立体声AAC设置，有SIMD实现的内核标量和SIMD并列
+ 新增热点内核时在这里注册对应的用例
+ */
+@interface CQMediaKernelBenchmarks : NSObject
+
+/// 注册所有用例到CQMicroBenchmark
++ (void)registerBenchmarks;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,1199 @@
+//
+//  CQMediaKernelBenchmarks.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQMediaKernelBenchmarks.h"
+#import "CQMicroBenchmark.h"
+#import "CQBenchmarkStreamGenerator.h"
+#import "CQNaluUtil.h"
+#import "CQTimestampSEI.h"
+#import "CQADTSUtil.h"
+#import "CQRawStreamReader.h"
+#import "CQMP4Demuxer.h"
+#import "CQReplayBuffer.h"
+#import "CQRTPPacketizer.h"
+#import "CQRTPDepacketizer.h"
+#import "CQTSMuxer.h"
+#import "CQMediaExecutor.h"
+#import "CQPacketQueue.h"
+#import "CQPacketPacer.h"
+#import "CQNetworkSimulator.h"
+#import "CQFEC.h"
+#import "CQFLVMuxer.h"
+#import "CQStreamFanout.h"
+#import "CQFrameClassifier.h"
+#import "CQBitWriter.h"
+#import "CQH264ParameterSets.h"
+#import "CQYUVConverter.h"
+#import "CQFrameTransform.h"
+#import "CQLayerCompositor.h"
+#import "CQTemporalDenoiser.h"
+#import <os/lock.h>
+#import <sched.h>
+#import <sys/socket.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+/// 编码后一帧的典型大小
+typedef struct {
+    const char *name;
+    NSUInteger idrSize;  ///< IDR大小
+    NSUInteger sliceCount;  ///< 每帧的片数
+} CQKernelFrameSize;
+
+static const CQKernelFrameSize kFrameSizes[] = {
+    {"720p", 64 * 1024, 4},
+    {"1080p", 160 * 1024, 8},
+    {"4K", 640 * 1024, 16},
+};
+
+/// TS封装输出，只统计字节数
+@interface CQKernelBenchmarkTSSink : NSObject<CQTSMuxerDelegate>
+@property (nonatomic, assign) uint64_t outputBytes;
+@end
+
+@implementation CQKernelBenchmarkTSSink
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData {
+    self.outputBytes += tsData.length;
+}
+@end
+
+/// 分发基准每次迭代都对所有客户端调用可写，不需要处理事件
+static void CQKernelBenchmarkFanoutEvent(void *context, int fd, void *clientContext, CQFanoutClientEvent event) {
+}
+
+@implementation CQMediaKernelBenchmarks
+
+#pragma mark - Public Func
++ (void)registerBenchmarks {
+    [self registerStartCodeBenchmarks];
+    [self registerAnnexBBenchmarks];
+    [self registerADTSBenchmarks];
+    [self registerRawStreamIndexBenchmarks];
+    [self registerMP4DemuxBenchmarks];
+    [self registerReplayBufferBenchmarks];
+    [self registerRTPBenchmarks];
+    [self registerTSMuxBenchmarks];
+    [self registerExecutorBenchmarks];
+    [self registerPacketQueueBenchmarks];
+    [self registerTimestampSEIBenchmarks];
+    [self registerPacerBenchmarks];
+    [self registerCongestionBenchmarks];
+    [self registerFECBenchmarks];
+    [self registerNackBenchmarks];
+    [self registerFLVBenchmarks];
+    [self registerFrameClassifyBenchmarks];
+    [self registerParameterSetBenchmarks];
+    [self registerColorConvertBenchmarks];
+    [self registerFrameTransformBenchmarks];
+    [self registerCompositorBenchmarks];
+    [self registerDenoiseBenchmarks];
+}
+
+#pragma mark - Private Func
+/// 拆成NALU数组，每个NALU带起始码(和编码器回调的格式一致)
++ (NSArray<NSData *> *)nalusOfFrame:(NSData *)frame {
+    NSMutableArray<NSData *> *nalus = [NSMutableArray array];
+    const uint8_t *bytes = frame.bytes;
+    CQNaluEnumerateAnnexB(bytes, frame.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        size_t start = (size_t)(nalu - bytes) - 4;
+        [nalus addObject:[frame subdataWithRange:NSMakeRange(start, naluSize + 4)]];
+    }];
+    return nalus;
+}
+
+/// 起始码查找: 整块数据里只有末尾一个起始码，测的是扫描速度
++ (void)registerStartCodeBenchmarks {
+    NSArray<NSArray *> *sizes = @[@[@"720p", @(64 * 1024)], @[@"4K", @(640 * 1024)], @[@"4MB", @(4 * 1024 * 1024)]];
+    for (NSArray *size in sizes) {
+        NSUInteger length = [size[1] unsignedIntegerValue];
+        NSData *(^makeData)(void) = ^NSData *{
+            NSMutableData *data = [[CQBenchmarkStreamGenerator h264FrameWithSize:length sliceCount:1 isKeyFrame:NO seed:1] mutableCopy];
+            // 去掉开头的起始码，只在末尾放一个
+            [data replaceBytesInRange:NSMakeRange(0, 4) withBytes:NULL length:0];
+            static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+            [data appendBytes:startCode length:sizeof(startCode)];
+            return data;
+        };
+        [CQMicroBenchmark registerBenchmarkWithName:[NSString stringWithFormat:@"StartCodeScan/scalar/%@", size[0]] bytesPerIteration:length itemsPerIteration:0 setup:^CQMicroBenchmarkRunBlock{
+            NSData *data = makeData();
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQMicroBenchmarkDoNotOptimize(CQNaluFindStartCodeScalar(data.bytes, data.length));
+                }
+            };
+        }];
+        // 非arm64上CQNaluFindStartCode就是标量实现，结果和scalar相同
+        [CQMicroBenchmark registerBenchmarkWithName:[NSString stringWithFormat:@"StartCodeScan/simd/%@", size[0]] bytesPerIteration:length itemsPerIteration:0 setup:^CQMicroBenchmarkRunBlock{
+            NSData *data = makeData();
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQMicroBenchmarkDoNotOptimize(CQNaluFindStartCode(data.bytes, data.length));
+                }
+            };
+        }];
+    }
+}
+
+/// Annex-B遍历、Annex-B转AVCC(CQMP4Muxer)、解码器输入拷贝改写(CQVideoDecoder)
++ (void)registerAnnexBBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSString *sizeName = @(frameSize.name);
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"AnnexBEnumerate/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSData *frame = [CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:2];
+            return ^(NSUInteger iterations) {
+                __block uint64_t total = 0;
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQNaluEnumerateAnnexB(frame.bytes, frame.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+                        total += naluSize;
+                    });
+                }
+                CQMicroBenchmarkDoNotOptimize(total);
+            };
+        }];
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"AnnexBToAVCC/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSData *frame = [CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:2];
+            NSMutableData *output = [NSMutableData dataWithLength:frame.length];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    __block uint8_t *cursor = output.mutableBytes;
+                    CQNaluEnumerateAnnexB(frame.bytes, frame.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+                        uint32_t length = CFSwapInt32HostToBig((uint32_t)naluSize);
+                        memcpy(cursor, &length, 4);
+                        memcpy(cursor + 4, nalu, naluSize);
+                        cursor += 4 + naluSize;
+                    });
+                    CQMicroBenchmarkDoNotOptimize(cursor - (uint8_t *)output.mutableBytes);
+                }
+            };
+        }];
+
+        // CQVideoDecoder videoDecodeWithH264Data: 拷贝一份再把起始码改写为长度
+        [CQMicroBenchmark registerBenchmarkWithName:[@"DecoderInputRewrite/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSData *nalu = [CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:1 isKeyFrame:NO seed:3];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    @autoreleasepool {
+                        NSMutableData *naluData = [nalu mutableCopy];
+                        uint32_t length = CFSwapInt32HostToBig((uint32_t)(naluData.length - 4));
+                        memcpy(naluData.mutableBytes, &length, 4);
+                        CQMicroBenchmarkDoNotOptimize(((const uint8_t *)naluData.bytes)[naluData.length - 1]);
+                    }
+                }
+            };
+        }];
+    }
+}
+
+/// 采集时间戳SEI: 编码端每帧生成一次，解码端每帧解析一次；防竞争字节去除按整帧计
++ (void)registerTimestampSEIBenchmarks {
+    [CQMicroBenchmark registerBenchmarkWithName:@"TimestampSEICreate/scalar/1frame" bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                @autoreleasepool {
+                    CQCaptureTimestamp timestamp = {.captureTimeUs = 1760000000000000 + i * 33333, .frameID = i};
+                    CQMicroBenchmarkDoNotOptimize(CQTimestampSEICreate(CQVideoCodecH264, timestamp).length);
+                }
+            }
+        };
+    }];
+    [CQMicroBenchmark registerBenchmarkWithName:@"TimestampSEIParse/scalar/1frame" bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+        NSData *sei = CQTimestampSEICreate(CQVideoCodecH264, (CQCaptureTimestamp){.captureTimeUs = 1760000000000000, .frameID = 1});
+        return ^(NSUInteger iterations) {
+            CQCaptureTimestamp timestamp;
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQMicroBenchmarkDoNotOptimize(CQTimestampSEIParse(CQVideoCodecH264, (const uint8_t *)sei.bytes + 4, sei.length - 4, &timestamp));
+            }
+        };
+    }];
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        [CQMicroBenchmark registerBenchmarkWithName:[@"EmulationPreventionRemove/scalar/" stringByAppendingString:@(frameSize.name)] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSData *nalu = [CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:1 isKeyFrame:NO seed:9];
+            NSMutableData *output = [NSMutableData dataWithLength:nalu.length];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQMicroBenchmarkDoNotOptimize(CQNaluRemoveEmulationPrevention((const uint8_t *)nalu.bytes + 4, nalu.length - 4, output.mutableBytes));
+                }
+            };
+        }];
+    }
+}
+
+/// 帧分类: 解码输入/文件读取按整帧Annex-B分类(需要找起始码)，转发按编码器回调的NALU数组分类(只看NALU头和片头)
++ (void)registerFrameClassifyBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSString *sizeName = @(frameSize.name);
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FrameClassifyAnnexB/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize / 8 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSData *frame = [CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize / 8 sliceCount:frameSize.sliceCount isKeyFrame:NO seed:9];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQMicroBenchmarkDoNotOptimize(CQFrameClassifyAnnexB(CQVideoCodecH264, frame.bytes, frame.length).frameClass);
+                }
+            };
+        }];
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FrameClassifyNalus/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize / 8 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize / 8 sliceCount:frameSize.sliceCount isKeyFrame:NO seed:9]];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQMicroBenchmarkDoNotOptimize(CQFrameClassifyNalus(CQVideoCodecH264, nalus).frameClass);
+                }
+            };
+        }];
+    }
+}
+
+/// 指数哥伦布读写(片头/SPS的基本操作)，值按片头里常见的小数值分布；SPS改写每个关键帧一次
++ (void)registerParameterSetBenchmarks {
+    static const NSUInteger valueCount = 4096;
+    NSMutableData *values = [NSMutableData dataWithLength:valueCount * sizeof(uint32_t)];
+    uint32_t *valueBytes = values.mutableBytes;
+    uint32_t state = 10;
+    for (NSUInteger i = 0; i < valueCount; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        // 大部分是0~15，少量是大值(帧号、QP差等)
+        valueBytes[i] = (state & 0x07) ? (state >> 8) & 0x0F : (state >> 8) & 0xFFFF;
+    }
+    NSMutableData *encoded = [NSMutableData dataWithLength:valueCount * 8];
+    CQBitWriter encodedWriter = CQBitWriterMake(encoded.mutableBytes, encoded.length);
+    for (NSUInteger i = 0; i < valueCount; i++) {
+        CQBitWriterWriteUE(&encodedWriter, valueBytes[i]);
+    }
+    size_t encodedSize = CQBitWriterByteSize(&encodedWriter);
+
+    [CQMicroBenchmark registerBenchmarkWithName:@"ExpGolombWrite/scalar/4096" bytesPerIteration:encodedSize itemsPerIteration:valueCount setup:^CQMicroBenchmarkRunBlock{
+        NSMutableData *output = [NSMutableData dataWithLength:encoded.length];
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQBitWriter writer = CQBitWriterMake(output.mutableBytes, output.length);
+                for (NSUInteger j = 0; j < valueCount; j++) {
+                    CQBitWriterWriteUE(&writer, valueBytes[j]);
+                }
+                CQMicroBenchmarkDoNotOptimize(writer.bitOffset);
+            }
+        };
+    }];
+    [CQMicroBenchmark registerBenchmarkWithName:@"ExpGolombRead/scalar/4096" bytesPerIteration:encodedSize itemsPerIteration:valueCount setup:^CQMicroBenchmarkRunBlock{
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQBitReader reader = CQBitReaderMake(encoded.bytes, encodedSize);
+                uint32_t sum = 0;
+                for (NSUInteger j = 0; j < valueCount; j++) {
+                    sum += CQBitReaderReadUE(&reader);
+                }
+                CQMicroBenchmarkDoNotOptimize(sum);
+            }
+        };
+    }];
+    [CQMicroBenchmark registerBenchmarkWithName:@"SPSRewriteVUI/scalar/720p" bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+        // 1280x720 Baseline，带VUI
+        static const uint8_t sps[] = {0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40, 0x16, 0xE8, 0x06, 0xD0, 0xA1, 0x35};
+        CQH264VUIOverride vui = CQH264VUIOverrideMake(30);
+        return ^(NSUInteger iterations) {
+            uint8_t output[256];
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQMicroBenchmarkDoNotOptimize(CQH264SPSRewriteVUI(sps, sizeof(sps), &vui, output, sizeof(output)));
+            }
+        };
+    }];
+}
+
+/// BGRA转NV12/I420: 标量、NEON单线程、NEON按行并行，每次迭代转换一帧
++ (void)registerColorConvertBenchmarks {
+    NSArray<NSArray *> *sizes = @[@[@"1080p", @1920, @1080], @[@"4K", @3840, @2160]];
+    for (NSArray *size in sizes) {
+        NSString *sizeName = size[0];
+        size_t width = [size[1] unsignedIntegerValue], height = [size[2] unsignedIntegerValue];
+        // 采集输出的BGRA每行按64字节对齐
+        size_t rgbBytesPerRow = (width * 4 + 63) & ~(size_t)63;
+        NSMutableData *(^makeRGB)(void) = ^NSMutableData *{
+            NSMutableData *rgb = [NSMutableData dataWithLength:rgbBytesPerRow * height];
+            uint8_t *bytes = rgb.mutableBytes;
+            uint32_t seed = 7;
+            for (size_t i = 0; i < rgb.length; i++) {
+                seed = seed * 1664525 + 1013904223;
+                bytes[i] = (uint8_t)(seed >> 24);
+            }
+            return rgb;
+        };
+        CQRGBToYUVFrame (^makeFrame)(NSData *, NSMutableData *, BOOL) = ^CQRGBToYUVFrame(NSData *rgb, NSMutableData *yuv, BOOL isI420) {
+            uint8_t *yuvBytes = yuv.mutableBytes;
+            CQRGBToYUVFrame frame = {0};
+            frame.rgb = rgb.bytes;
+            frame.rgbBytesPerRow = rgbBytesPerRow;
+            frame.order = CQRGBOrderBGRA;
+            frame.y = yuvBytes;
+            frame.yBytesPerRow = width;
+            frame.u = yuvBytes + width * height;
+            frame.uBytesPerRow = isI420 ? width / 2 : width;
+            frame.v = isI420 ? frame.u + width * height / 4 : NULL;
+            frame.vBytesPerRow = width / 2;
+            frame.width = width;
+            frame.height = height;
+            frame.coefficients = CQRGBToYUVCoefficientsMake(CQYUVMatrixBT709, NO);
+            return frame;
+        };
+        NSUInteger frameBytes = width * height * 4;
+        NSUInteger yuvLength = width * height * 3 / 2;
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RGBToNV12/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *rgb = makeRGB(), *yuv = [NSMutableData dataWithLength:yuvLength];
+            return ^(NSUInteger iterations) {
+                CQRGBToYUVFrame frame = makeFrame(rgb, yuv, NO);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQRGBToYUVConvertRowsScalar(&frame, 0, frame.height);
+                }
+                CQMicroBenchmarkDoNotOptimize(frame.y[0]);
+            };
+        }];
+        // 非arm64上CQRGBToYUVConvertRows就是标量实现
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RGBToNV12/simd/" stringByAppendingString:sizeName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *rgb = makeRGB(), *yuv = [NSMutableData dataWithLength:yuvLength];
+            return ^(NSUInteger iterations) {
+                CQRGBToYUVFrame frame = makeFrame(rgb, yuv, NO);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQRGBToYUVConvertRows(&frame, 0, frame.height);
+                }
+                CQMicroBenchmarkDoNotOptimize(frame.y[0]);
+            };
+        }];
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RGBToNV12/simdParallel/" stringByAppendingString:sizeName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *rgb = makeRGB(), *yuv = [NSMutableData dataWithLength:yuvLength];
+            return ^(NSUInteger iterations) {
+                CQRGBToYUVFrame frame = makeFrame(rgb, yuv, NO);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQRGBToYUVConvert(&frame, 0);
+                }
+                CQMicroBenchmarkDoNotOptimize(frame.y[0]);
+            };
+        }];
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RGBToI420/simd/" stringByAppendingString:sizeName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *rgb = makeRGB(), *yuv = [NSMutableData dataWithLength:yuvLength];
+            return ^(NSUInteger iterations) {
+                CQRGBToYUVFrame frame = makeFrame(rgb, yuv, YES);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQRGBToYUVConvertRows(&frame, 0, frame.height);
+                }
+                CQMicroBenchmarkDoNotOptimize(frame.y[0]);
+            };
+        }];
+    }
+}
+
+/// NV12几何变换: 标量、NEON单线程、NEON按行并行，每次迭代变换一帧
++ (void)registerFrameTransformBenchmarks {
+    // 名称、源宽高、旋转、镜像、目标宽高、缩放方式
+    NSArray<NSArray *> *cases = @[
+        @[@"Mirror/1080p", @1920, @1080, @(CQFrameRotation0), @YES, @1920, @1080, @(CQFrameScaleModeStretch)],
+        @[@"Rotate90/1080p", @1920, @1080, @(CQFrameRotation90), @NO, @1080, @1920, @(CQFrameScaleModeStretch)],
+        @[@"Rotate90Scale/1080pTo720p", @1920, @1080, @(CQFrameRotation90), @YES, @720, @1280, @(CQFrameScaleModeStretch)],
+        @[@"AspectFill/4KTo1080p", @3840, @2160, @(CQFrameRotation0), @NO, @1440, @1080, @(CQFrameScaleModeAspectFill)],
+    ];
+    for (NSArray *item in cases) {
+        NSString *caseName = item[0];
+        size_t width = [item[1] unsignedIntegerValue], height = [item[2] unsignedIntegerValue];
+        size_t outputWidth = [item[5] unsignedIntegerValue], outputHeight = [item[6] unsignedIntegerValue];
+        CQFrameTransform transform = CQFrameTransformMake(width, height, [item[3] unsignedCharValue], [item[4] boolValue], outputWidth, outputHeight, [item[7] unsignedCharValue]);
+        NSMutableData *(^makeSource)(void) = ^NSMutableData *{
+            NSMutableData *yuv = [NSMutableData dataWithLength:width * height * 3 / 2];
+            uint8_t *bytes = yuv.mutableBytes;
+            uint32_t seed = 11;
+            for (size_t i = 0; i < yuv.length; i++) {
+                seed = seed * 1664525 + 1013904223;
+                bytes[i] = (uint8_t)(seed >> 24);
+            }
+            return yuv;
+        };
+        CQYUVPlanes (^makePlanes)(NSMutableData *, size_t, size_t) = ^CQYUVPlanes(NSMutableData *yuv, size_t planeWidth, size_t planeHeight) {
+            uint8_t *bytes = yuv.mutableBytes;
+            CQYUVPlanes planes = {0};
+            planes.y = bytes;
+            planes.yBytesPerRow = planeWidth;
+            planes.u = bytes + planeWidth * planeHeight;
+            planes.uBytesPerRow = planeWidth;
+            planes.width = planeWidth;
+            planes.height = planeHeight;
+            planes.isFullRange = YES;
+            return planes;
+        };
+        NSUInteger frameBytes = outputWidth * outputHeight * 3 / 2;
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FrameTransform/scalar/" stringByAppendingString:caseName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *source = makeSource(), *output = [NSMutableData dataWithLength:frameBytes];
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes sourcePlanes = makePlanes(source, width, height), outputPlanes = makePlanes(output, outputWidth, outputHeight);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQYUVTransformRowsScalar(&sourcePlanes, &outputPlanes, &transform, 0, outputHeight);
+                }
+                CQMicroBenchmarkDoNotOptimize(outputPlanes.y[0]);
+            };
+        }];
+        // 非arm64上CQYUVTransformRows就是标量实现
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FrameTransform/simd/" stringByAppendingString:caseName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *source = makeSource(), *output = [NSMutableData dataWithLength:frameBytes];
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes sourcePlanes = makePlanes(source, width, height), outputPlanes = makePlanes(output, outputWidth, outputHeight);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQYUVTransformRows(&sourcePlanes, &outputPlanes, &transform, 0, outputHeight);
+                }
+                CQMicroBenchmarkDoNotOptimize(outputPlanes.y[0]);
+            };
+        }];
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FrameTransform/simdParallel/" stringByAppendingString:caseName] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *source = makeSource(), *output = [NSMutableData dataWithLength:frameBytes];
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes sourcePlanes = makePlanes(source, width, height), outputPlanes = makePlanes(output, outputWidth, outputHeight);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQYUVTransform(&sourcePlanes, &outputPlanes, &transform, 0);
+                }
+                CQMicroBenchmarkDoNotOptimize(outputPlanes.y[0]);
+            };
+        }];
+    }
+}
+
+/// 多图层合成: alpha混合一个1080p亮度平面(标量、NEON)，以及典型布局下每帧的更新加合成
++ (void)registerCompositorBenchmarks {
+    static const size_t width = 1920, height = 1080;
+    NSMutableData *(^makeRandom)(size_t, uint32_t) = ^NSMutableData *(size_t length, uint32_t seed) {
+        NSMutableData *data = [NSMutableData dataWithLength:length];
+        uint8_t *bytes = data.mutableBytes;
+        for (size_t i = 0; i < length; i++) {
+            seed = seed * 1664525 + 1013904223;
+            bytes[i] = (uint8_t)(seed >> 24);
+        }
+        return data;
+    };
+    for (NSNumber *usesSIMD in @[@NO, @YES]) {
+        NSString *name = usesSIMD.boolValue ? @"AlphaBlend/simd/1080p" : @"AlphaBlend/scalar/1080p";
+        [CQMicroBenchmark registerBenchmarkWithName:name bytesPerIteration:width * height itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *source = makeRandom(width * height, 3), *alpha = makeRandom(width * height, 5), *destination = makeRandom(width * height, 7);
+            return ^(NSUInteger iterations) {
+                uint8_t *destinationBytes = destination.mutableBytes;
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    for (size_t j = 0; j < height; j++) {
+                        size_t offset = j * width;
+                        if (usesSIMD.boolValue) {
+                            CQAlphaBlendRow(destinationBytes + offset, (const uint8_t *)source.bytes + offset, (const uint8_t *)alpha.bytes + offset, 200, width);
+                        } else {
+                            CQAlphaBlendRowScalar(destinationBytes + offset, (const uint8_t *)source.bytes + offset, (const uint8_t *)alpha.bytes + offset, 200, width);
+                        }
+                    }
+                }
+                CQMicroBenchmarkDoNotOptimize(destinationBytes[0]);
+            };
+        }];
+    }
+
+    // 布局: 全屏的后摄像头(0) + 右下角480x272的前摄像头画中画(1) + 左上角320x96的半透明水印(2)
+    CQLayerCompositor *(^makeCompositor)(NSData *) = ^CQLayerCompositor *(NSData *watermark) {
+        CQLayerCompositor *compositor = CQLayerCompositorCreate(width, height, YES);
+        CQLayerCompositorSetLayer(compositor, 0, (CQLayerGeometry){.x = 0, .y = 0, .width = width, .height = height, .zOrder = 0, .opacity = 255});
+        CQLayerCompositorSetLayer(compositor, 1, (CQLayerGeometry){.x = 1392, .y = 760, .width = 480, .height = 272, .zOrder = 1, .opacity = 255});
+        CQLayerCompositorSetLayer(compositor, 2, (CQLayerGeometry){.x = 48, .y = 48, .width = 320, .height = 96, .zOrder = 2, .opacity = 255});
+        CQLayerCompositorUpdateRGBA(compositor, 2, watermark.bytes, 320 * 4, 320, 96, CQRGBOrderBGRA, NO);
+        return compositor;
+    };
+    CQYUVPlanes (^makePlanes)(NSMutableData *) = ^CQYUVPlanes(NSMutableData *yuv) {
+        uint8_t *bytes = yuv.mutableBytes;
+        CQYUVPlanes planes = {0};
+        planes.y = bytes;
+        planes.yBytesPerRow = width;
+        planes.u = bytes + width * height;
+        planes.uBytesPerRow = width;
+        planes.width = width;
+        planes.height = height;
+        planes.isFullRange = YES;
+        return planes;
+    };
+    NSUInteger frameBytes = width * height * 3 / 2;
+    // 两路摄像头每帧都更新，整个画面都要重新合成
+    NSArray<NSArray *> *cameraCases = @[@[@"Composite/simd/CameraPiPWatermark_1080p", @1], @[@"Composite/simdParallel/CameraPiPWatermark_1080p", @0]];
+    for (NSArray *item in cameraCases) {
+        size_t bandCount = [item[1] unsignedIntegerValue];
+        [CQMicroBenchmark registerBenchmarkWithName:item[0] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *back = makeRandom(frameBytes, 11), *front = makeRandom(frameBytes, 13), *output = [NSMutableData dataWithLength:frameBytes];
+            CQLayerCompositor *compositor = makeCompositor(makeRandom(320 * 96 * 4, 17));
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes backPlanes = makePlanes(back), frontPlanes = makePlanes(front), outputPlanes = makePlanes(output);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQLayerCompositorUpdateYUV(compositor, 0, &backPlanes);
+                    CQLayerCompositorUpdateYUV(compositor, 1, &frontPlanes);
+                    CQLayerCompositorCompose(compositor, &outputPlanes, bandCount);
+                }
+                CQMicroBenchmarkDoNotOptimize(outputPlanes.y[0]);
+            };
+        }];
+    }
+    // 背景和水印不变，只有画中画更新: 只合成变化的块和每次都整帧重新合成的对比
+    for (NSNumber *redrawsAll in @[@NO, @YES]) {
+        NSString *name = redrawsAll.boolValue ? @"Composite/fullRedraw/StaticBackgroundPiP_1080p" : @"Composite/dirtyOnly/StaticBackgroundPiP_1080p";
+        [CQMicroBenchmark registerBenchmarkWithName:name bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSMutableData *back = makeRandom(frameBytes, 11), *front = makeRandom(frameBytes, 13), *output = [NSMutableData dataWithLength:frameBytes];
+            CQLayerCompositor *compositor = makeCompositor(makeRandom(320 * 96 * 4, 17));
+            CQYUVPlanes backPlanes = makePlanes(back);
+            CQLayerCompositorUpdateYUV(compositor, 0, &backPlanes);
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes frontPlanes = makePlanes(front), outputPlanes = makePlanes(output);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    CQLayerCompositorUpdateYUV(compositor, 1, &frontPlanes);
+                    if (redrawsAll.boolValue) CQLayerCompositorInvalidate(compositor);
+                    CQLayerCompositorCompose(compositor, &outputPlanes, 0);
+                }
+                CQMicroBenchmarkDoNotOptimize(outputPlanes.y[0]);
+            };
+        }];
+    }
+}
+
+/// 时域降噪一帧1080p NV12: 标量、NEON单线程、NEON按行并行，当前帧是参考帧加上小幅噪声(静止的暗光画面)
++ (void)registerDenoiseBenchmarks {
+    static const size_t width = 1920, height = 1080;
+    NSUInteger frameBytes = width * height * 3 / 2;
+    NSArray<NSMutableData *> *(^makeFrames)(void) = ^NSArray<NSMutableData *> *{
+        NSMutableData *reference = [NSMutableData dataWithLength:frameBytes], *current = [NSMutableData dataWithLength:frameBytes];
+        uint8_t *referenceBytes = reference.mutableBytes, *currentBytes = current.mutableBytes;
+        uint32_t seed = 19;
+        for (size_t i = 0; i < frameBytes; i++) {
+            seed = seed * 1664525 + 1013904223;
+            referenceBytes[i] = (uint8_t)(16 + (i % width) * 200 / width);
+            currentBytes[i] = (uint8_t)(referenceBytes[i] + (int)(seed >> 29) - 4);
+        }
+        return @[current, reference, [NSMutableData dataWithLength:frameBytes]];
+    };
+    CQYUVPlanes (^makePlanes)(NSMutableData *) = ^CQYUVPlanes(NSMutableData *yuv) {
+        uint8_t *bytes = yuv.mutableBytes;
+        CQYUVPlanes planes = {0};
+        planes.y = bytes;
+        planes.yBytesPerRow = width;
+        planes.u = bytes + width * height;
+        planes.uBytesPerRow = width;
+        planes.width = width;
+        planes.height = height;
+        return planes;
+    };
+    CQDenoiseParameters parameters = CQDenoiseParametersMake(CQDenoiseStrengthMedium);
+    // 非arm64上CQTemporalDenoiseRows就是标量实现
+    NSArray<NSString *> *variants = @[@"scalar", @"simd", @"simdParallel"];
+    for (NSUInteger v = 0; v < variants.count; v++) {
+        [CQMicroBenchmark registerBenchmarkWithName:[NSString stringWithFormat:@"TemporalDenoise/%@/1080p", variants[v]] bytesPerIteration:frameBytes itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            NSArray<NSMutableData *> *frames = makeFrames();
+            return ^(NSUInteger iterations) {
+                CQYUVPlanes current = makePlanes(frames[0]), reference = makePlanes(frames[1]), output = makePlanes(frames[2]);
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    if (v == 0) {
+                        CQTemporalDenoiseRowsScalar(&current, &reference, &output, parameters, 0, height);
+                    } else if (v == 1) {
+                        CQTemporalDenoiseRows(&current, &reference, &output, parameters, 0, height);
+                    } else {
+                        CQTemporalDenoise(&current, &reference, &output, parameters, 0);
+                    }
+                }
+                CQMicroBenchmarkDoNotOptimize(output.y[0]);
+            };
+        }];
+    }
+}
+
+/// 平滑发送核心在模拟时钟下跑1秒2Mbps的直播: 开头一个200KB关键帧，之后30fps视频 + 每20ms一个音频包
++ (void)registerPacerBenchmarks {
+    static const NSUInteger mtu = 1200;
+    static const uint64_t durationUs = 1000000;
+    NSUInteger packetCount = 200 * 1024 / mtu + 30 * 7 + 50;
+    [CQMicroBenchmark registerBenchmarkWithName:@"PacerSimulatedLink/scalar/2Mbps_1s" bytesPerIteration:0 itemsPerIteration:packetCount setup:^CQMicroBenchmarkRunBlock{
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQPacerCore *core = CQPacerCoreCreate(2000000, 2.5);
+                uint64_t now = 0, nextVideo = 0, nextAudio = 0, frameID = 0, sentBytes = 0;
+                for (NSUInteger k = 0; k < 200 * 1024 / mtu; k++) {
+                    CQPacerCoreEnqueue(core, (CQPacerPacket){.size = mtu, .priority = CQPacerPriorityKeyFrame, .frameID = frameID}, now);
+                }
+                nextVideo = 33333;
+                while (now < durationUs) {
+                    if (now >= nextAudio) {
+                        CQPacerCoreEnqueue(core, (CQPacerPacket){.size = 200, .priority = CQPacerPriorityAudio, .frameID = now, .deadlineUs = now + 200000}, now);
+                        nextAudio += 20000;
+                    }
+                    if (now >= nextVideo) {
+                        frameID++;
+                        for (NSUInteger k = 0; k < 7; k++) {
+                            CQPacerCoreEnqueue(core, (CQPacerPacket){.size = mtu, .priority = CQPacerPriorityVideo, .frameID = frameID, .deadlineUs = now + 500000}, now);
+                        }
+                        nextVideo += 33333;
+                    }
+                    CQPacerPacket packet;
+                    while (CQPacerCorePop(core, now, &packet)) {
+                        sentBytes += packet.size;
+                    }
+                    // 跳到下一个事件: 可发送、音频、视频三者最早的
+                    uint64_t next = MIN(CQPacerCoreNextSendTime(core, now), MIN(nextAudio, nextVideo));
+                    now = MAX(next, now + 1);
+                }
+                CQPacerCoreDestroy(core);
+                CQMicroBenchmarkDoNotOptimize(sentBytes);
+            }
+        };
+    }];
+}
+
+/// 带宽估计在模拟链路上跑30秒: 容量3Mbps -> 1Mbps -> 3Mbps各10秒，传播时延40ms，setup里打印一次收敛时间/利用率/排队时延
++ (void)registerCongestionBenchmarks {
+    static const CQLinkTraceStep trace[] = {{10000000, 3000000}, {10000000, 1000000}, {10000000, 3000000}};
+    CQCongestionSimulationConfig config = {
+        .trace = trace,
+        .stepCount = sizeof(trace) / sizeof(trace[0]),
+        .propagationDelayUs = 40000,
+        .queueLimitBytes = 64 * 1024,
+        .lossRate = 0,
+        .seed = 1,
+        .durationUs = 30000000,
+        .startBitrate = 500000,
+        .minBitrate = 150000,
+        .maxBitrate = 5000000,
+    };
+    [CQMicroBenchmark registerBenchmarkWithName:@"BandwidthEstimatorTrace/scalar/3-1-3Mbps_30s" bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+        CQCongestionSimulationResult result = CQCongestionSimulationRun(&config);
+        NSMutableString *convergence = [NSMutableString string];
+        for (size_t i = 0; i < result.convergenceCount; i++) {
+            [convergence appendFormat:@" %.1fs", result.convergenceTimeUs[i] == UINT64_MAX ? -1.0 : result.convergenceTimeUs[i] / 1000000.0];
+        }
+        NSLog(@"BandwidthEstimatorTrace - convergence:%@ utilisation: %.2f queueDelay p50: %.1fms p95: %.1fms loss: %.3f", convergence, result.utilisation, result.p50QueueDelayMs, result.p95QueueDelayMs, result.lossRate);
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQCongestionSimulationResult iterationResult = CQCongestionSimulationRun(&config);
+                CQMicroBenchmarkDoNotOptimize(iterationResult.finalTargetBitrate);
+            }
+        };
+    }];
+}
+
+/// FEC: GF(2^8)乘加内核，关键帧生成修复包，以及模拟丢包下的恢复(setup里打印各丢包率下的恢复率)
++ (void)registerFECBenchmarks {
+    static const size_t length = 64 * 1024;
+    NSMutableData *(^makeData)(uint32_t) = ^NSMutableData *(uint32_t seed) {
+        NSMutableData *data = [NSMutableData dataWithLength:length];
+        uint8_t *bytes = data.mutableBytes;
+        for (size_t i = 0; i < length; i++) {
+            seed = seed * 1664525 + 1013904223;
+            bytes[i] = (uint8_t)(seed >> 24);
+        }
+        return data;
+    };
+    [CQMicroBenchmark registerBenchmarkWithName:@"GFMultiplyAdd/scalar/64KB" bytesPerIteration:length itemsPerIteration:0 setup:^CQMicroBenchmarkRunBlock{
+        NSMutableData *dst = makeData(1), *src = makeData(2);
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQGFMultiplyAddScalar(dst.mutableBytes, src.bytes, (uint8_t)(i | 2), length);
+            }
+            CQMicroBenchmarkDoNotOptimize(((const uint8_t *)dst.bytes)[0]);
+        };
+    }];
+    // 非arm64上CQGFMultiplyAdd就是标量实现
+    [CQMicroBenchmark registerBenchmarkWithName:@"GFMultiplyAdd/simd/64KB" bytesPerIteration:length itemsPerIteration:0 setup:^CQMicroBenchmarkRunBlock{
+        NSMutableData *dst = makeData(1), *src = makeData(2);
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQGFMultiplyAdd(dst.mutableBytes, src.bytes, (uint8_t)(i | 2), length);
+            }
+            CQMicroBenchmarkDoNotOptimize(((const uint8_t *)dst.bytes)[0]);
+        };
+    }];
+
+    for (size_t s = 0; s < 2; s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSString *sizeName = @(frameSize.name);
+        for (NSNumber *schemeNumber in @[@(CQFECSchemeXOR), @(CQFECSchemeReedSolomon)]) {
+            CQFECScheme scheme = (CQFECScheme)schemeNumber.unsignedIntegerValue;
+            NSString *schemeName = scheme == CQFECSchemeXOR ? @"XOR" : @"RS";
+            [CQMicroBenchmark registerBenchmarkWithName:[NSString stringWithFormat:@"FECProtect%@/simd/%@", schemeName, sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+                CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+                NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+                NSArray<CQRTPPacket *> *packets = [packetizer packetizeH264Nalus:nalus pts:kCMTimeZero];
+                CQFECEncoder *encoder = [[CQFECEncoder alloc] initWithPayloadType:97 ssrc:2];
+                encoder.scheme = scheme;
+                return ^(NSUInteger iterations) {
+                    for (NSUInteger i = 0; i < iterations; i++) {
+                        @autoreleasepool {
+                            CQMicroBenchmarkDoNotOptimize([encoder protectFramePackets:packets].count);
+                        }
+                    }
+                };
+            }];
+            [CQMicroBenchmark registerBenchmarkWithName:[NSString stringWithFormat:@"FECRecover%@/simd/%@_10%%loss", schemeName, sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+                for (NSNumber *lossRate in @[@0.01, @0.05, @0.1, @0.2]) {
+                    [self logFECRecoveryWithScheme:scheme frameSize:frameSize lossRate:lossRate.doubleValue];
+                }
+                CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+                NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+                NSArray<CQRTPPacket *> *packets = [packetizer packetizeH264Nalus:nalus pts:kCMTimeZero];
+                CQFECEncoder *encoder = [[CQFECEncoder alloc] initWithPayloadType:97 ssrc:2];
+                encoder.scheme = scheme;
+                // 固定丢掉每10个媒体包中的一个
+                NSMutableArray<NSData *> *receivedDatas = [NSMutableArray array];
+                for (NSUInteger i = 0; i < packets.count; i++) {
+                    if (i % 10 != 3) [receivedDatas addObject:packets[i].serializedData];
+                }
+                for (CQRTPPacket *packet in [encoder protectFramePackets:packets]) {
+                    [receivedDatas addObject:packet.serializedData];
+                }
+                return ^(NSUInteger iterations) {
+                    for (NSUInteger i = 0; i < iterations; i++) {
+                        @autoreleasepool {
+                            CQFECDecoder *decoder = [[CQFECDecoder alloc] initWithFECPayloadType:97];
+                            for (NSData *packetData in receivedDatas) {
+                                [decoder receivePacketData:packetData];
+                            }
+                            CQMicroBenchmarkDoNotOptimize(decoder.recoveredCount);
+                        }
+                    }
+                };
+            }];
+        }
+    }
+}
+
+/// NACK重传在模拟链路上跑30秒(30fps，每帧8个包)，setup里打印各时延下不重传/重传后按时完整的帧比例
++ (void)registerNackBenchmarks {
+    CQNackSimulationConfig config = {
+        .delayUs = 40000,
+        .jitterUs = 10000,
+        .lossRate = 0.05,
+        .seed = 1,
+        .durationUs = 30000000,
+        .fps = 30,
+        .packetsPerFrame = 8,
+        .maxRetransmissions = 3,
+        .trackerConfig = CQNackTrackerDefaultConfig(),
+    };
+    [CQMicroBenchmark registerBenchmarkWithName:@"NackLoop/scalar/40ms_5%loss_30s" bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+        for (NSNumber *delayMs in @[@20, @40, @80, @150]) {
+            CQNackSimulationConfig logConfig = config;
+            logConfig.delayUs = delayMs.unsignedLongLongValue * 1000;
+            CQNackSimulationResult result = CQNackSimulationRun(&logConfig);
+            NSLog(@"NackLoop - delay: %@ms complete without nack: %.3f with nack: %.3f lost: %llu retransmitted: %llu keyFrameRequests: %llu rtt: %.1fms", delayMs, result.completeWithoutNack, result.completeWithNack, result.lostPacketCount, result.retransmittedCount, result.keyFrameRequestCount, result.rttEstimateUs / 1000.0);
+        }
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQNackSimulationResult result = CQNackSimulationRun(&config);
+                CQMicroBenchmarkDoNotOptimize(result.retransmittedCount);
+            }
+        };
+    }];
+}
+
+/// 随机丢包下连续发送关键帧 + 非关键帧(1:29)，打印恢复率和完整帧比例
++ (void)logFECRecoveryWithScheme:(CQFECScheme)scheme frameSize:(CQKernelFrameSize)frameSize lossRate:(double)lossRate {
+    CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+    CQFECEncoder *encoder = [[CQFECEncoder alloc] initWithPayloadType:97 ssrc:2];
+    encoder.scheme = scheme;
+    CQFECDecoder *decoder = [[CQFECDecoder alloc] initWithFECPayloadType:97];
+    NSArray<NSData *> *keyNalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+    NSArray<NSData *> *deltaNalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize / 8 sliceCount:frameSize.sliceCount isKeyFrame:NO seed:9]];
+    uint32_t random = 1;
+    NSUInteger frameCount = 300, completeCount = 0, lostCount = 0;
+    for (NSUInteger f = 0; f < frameCount; f++) {
+        @autoreleasepool {
+            NSArray<CQRTPPacket *> *packets = [packetizer packetizeH264Nalus:(f % 30 == 0 ? keyNalus : deltaNalus) pts:CMTimeMake((int64_t)f, 30)];
+            NSUInteger recoveredBefore = decoder.recoveredCount, frameLost = 0;
+            for (CQRTPPacket *packet in [packets arrayByAddingObjectsFromArray:[encoder protectFramePackets:packets]]) {
+                random = random * 1664525 + 1013904223;
+                if ((double)(random >> 8) / (double)(1 << 24) < lossRate) {
+                    if (packet.payloadFormat != CQRTPPayloadFormatFEC) frameLost++;
+                    continue;
+                }
+                [decoder receivePacketData:packet.serializedData];
+            }
+            lostCount += frameLost;
+            if (decoder.recoveredCount - recoveredBefore == frameLost) completeCount++;
+        }
+    }
+    NSLog(@"FECRecovery - %@ %s loss: %.0f%% lost packets: %lu recovered: %lu complete frames: %.1f%%", scheme == CQFECSchemeXOR ? @"XOR" : @"RS", frameSize.name, lossRate * 100, (unsigned long)lostCount, (unsigned long)decoder.recoveredCount, completeCount * 100.0 / frameCount);
+}
+
+/// ADTS: 48kHz立体声128kbps，每帧约341字节，1000帧约21秒
++ (void)registerADTSBenchmarks {
+    static const NSUInteger frameCount = 1000;
+    static const NSUInteger frameSize = 341;
+    [CQMicroBenchmark registerBenchmarkWithName:@"ADTSParse/scalar/48k_stereo" bytesPerIteration:frameCount * (frameSize + CQADTSHeaderSize) itemsPerIteration:frameCount setup:^CQMicroBenchmarkRunBlock{
+        NSData *data = [CQBenchmarkStreamGenerator aacDataWithFrameCount:frameCount frameSize:frameSize sampleRate:48000 channelCount:2 seed:4];
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                const uint8_t *bytes = data.bytes;
+                size_t offset = 0, count = 0;
+                while (offset + CQADTSHeaderSize <= data.length) {
+                    if (CQADTSHeaderLength(bytes + offset, data.length - offset) == 0) break;
+                    offset += CQADTSFrameLength(bytes + offset);
+                    count++;
+                }
+                CQMicroBenchmarkDoNotOptimize(count);
+            }
+        };
+    }];
+    [CQMicroBenchmark registerBenchmarkWithName:@"ADTSWriteHeader/scalar/48k_stereo" bytesPerIteration:0 itemsPerIteration:frameCount setup:^CQMicroBenchmarkRunBlock{
+        NSMutableData *headers = [NSMutableData dataWithLength:frameCount * CQADTSHeaderSize];
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                uint8_t *header = headers.mutableBytes;
+                for (NSUInteger f = 0; f < frameCount; f++) {
+                    CQADTSWriteHeader(header + f * CQADTSHeaderSize, 48000, 2, frameSize + (f & 7));
+                }
+                CQMicroBenchmarkDoNotOptimize(header[frameCount * CQADTSHeaderSize - 1]);
+            }
+        };
+    }];
+}
+
+/// 裸码流首次打开: 扫描建立帧索引并写索引文件
++ (void)registerRawStreamIndexBenchmarks {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"kernel_benchmark_720p30.h264"];
+    static const NSTimeInterval duration = 10;
+    static const NSInteger bitrate = 2 * 1000 * 1000;
+    [CQMicroBenchmark registerBenchmarkWithName:@"RawStreamIndex/scalar/720p30_10s" bytesPerIteration:(NSUInteger)(bitrate / 8 * duration) itemsPerIteration:0 setup:^CQMicroBenchmarkRunBlock{
+        [CQBenchmarkStreamGenerator writeH264StreamToPath:path duration:duration fps:30 bitrate:bitrate seed:5 error:nil];
+        NSString *indexPath = [path stringByAppendingPathExtension:@"cqidx"];
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                @autoreleasepool {
+                    [[NSFileManager defaultManager] removeItemAtPath:indexPath error:nil];
+                    CQRawStreamReader *reader = [[CQRawStreamReader alloc] initWithPath:path frameRate:30 error:nil];
+                    CQMicroBenchmarkDoNotOptimize(reader.frameCount);
+                }
+            }
+        };
+    }];
+}
+
+/// MP4首帧耗时: 打开文件(越过mdat找到moov、解析sample表)到读出第一个sample，以及打开后跳转到中间再读出第一个sample
++ (void)registerMP4DemuxBenchmarks {
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"kernel_benchmark_720p30_60s.mp4"];
+    static const NSTimeInterval duration = 60;
+    static const NSInteger bitrate = 2 * 1000 * 1000;
+    NSArray<NSString *> *modes = @[@"open", @"openSeek"];
+    for (NSString *mode in modes) {
+        BOOL needsSeek = [mode isEqualToString:@"openSeek"];
+        NSString *name = [NSString stringWithFormat:@"MP4TimeToFirstSample/%@/720p30_60s", mode];
+        [CQMicroBenchmark registerBenchmarkWithName:name bytesPerIteration:0 itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            [CQBenchmarkStreamGenerator writeMP4StreamToPath:path duration:duration fps:30 bitrate:bitrate chunkDuration:0.5 seed:8 error:nil];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    @autoreleasepool {
+                        CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:path error:nil];
+                        if (needsSeek) [demuxer seekToTime:CMTimeMake((int64_t)(duration / 2 * 1000), 1000)];
+                        CQMicroBenchmarkDoNotOptimize([demuxer nextSample].data.length);
+                    }
+                }
+            };
+        }];
+    }
+}
+
+/// 回放缓存写入: 缓存已满，每帧都伴随按GOP淘汰
++ (void)registerReplayBufferBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSUInteger pFrameSize = frameSize.idrSize / 5;
+        [CQMicroBenchmark registerBenchmarkWithName:[@"ReplayBufferAppend/scalar/" stringByAppendingString:@(frameSize.name)] bytesPerIteration:pFrameSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            CQVideoCoderConfig *videoConfig = [CQVideoCoderConfig defaultConifg];
+            videoConfig.fps = 30;
+            CQReplayBuffer *replayBuffer = [[CQReplayBuffer alloc] initWithMaxBytes:16 * 1024 * 1024 maxDuration:30 videoConfig:videoConfig audioConfig:nil];
+            NSArray<NSData *> *idrNalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:6]];
+            NSArray<NSData *> *pNalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:pFrameSize sliceCount:frameSize.sliceCount isKeyFrame:NO seed:7]];
+            __block int64_t frameIndex = 0;
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++, frameIndex++) {
+                    BOOL isKeyFrame = (frameIndex % 60 == 0);
+                    CMTime pts = CMTimeMake(frameIndex, 30);
+                    [replayBuffer appendVideoNalus:isKeyFrame ? idrNalus : pNalus pts:pts dts:pts isKeyFrame:isKeyFrame];
+                }
+            };
+        }];
+    }
+}
+
+/// RTP分包和解包(含重排缓存)
++ (void)registerRTPBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSString *sizeName = @(frameSize.name);
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RTPPacketizeH264/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+            NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+            __block int64_t frameIndex = 0;
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++, frameIndex++) {
+                    @autoreleasepool {
+                        NSArray<CQRTPPacket *> *packets = [packetizer packetizeH264Nalus:nalus pts:CMTimeMake(frameIndex, 30)];
+                        CQMicroBenchmarkDoNotOptimize(packets.count);
+                    }
+                }
+            };
+        }];
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"RTPDepacketizeH264/scalar/" stringByAppendingString:sizeName] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+            NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+            NSMutableArray<NSMutableData *> *packets = [NSMutableArray array];
+            for (CQRTPPacket *packet in [packetizer packetizeH264Nalus:nalus pts:kCMTimeZero]) {
+                [packets addObject:[packet.serializedData mutableCopy]];
+            }
+            CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+            __block uint16_t sequenceNumber = 0;
+            __block uint32_t timestamp = 0;
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    @autoreleasepool {
+                        // 每帧改写序列号和时间戳，模拟连续的新帧
+                        for (NSMutableData *packetData in packets) {
+                            uint8_t *header = packetData.mutableBytes;
+                            header[2] = (uint8_t)(sequenceNumber >> 8);
+                            header[3] = (uint8_t)sequenceNumber;
+                            uint32_t bigTimestamp = CFSwapInt32HostToBig(timestamp);
+                            memcpy(header + 4, &bigTimestamp, 4);
+                            sequenceNumber++;
+                            [depacketizer receivePacketData:packetData];
+                        }
+                        timestamp += 3000;
+                    }
+                }
+                CQMicroBenchmarkDoNotOptimize(depacketizer.receivedCount);
+            };
+        }];
+    }
+}
+
+/// TS封装: 每次迭代封装一帧，最后等封装队列处理完
++ (void)registerTSMuxBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        NSUInteger pFrameSize = frameSize.idrSize / 5;
+        [CQMicroBenchmark registerBenchmarkWithName:[@"TSMuxVideo/scalar/" stringByAppendingString:@(frameSize.name)] bytesPerIteration:pFrameSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            CQVideoCoderConfig *videoConfig = [CQVideoCoderConfig defaultConifg];
+            CQTSMuxer *muxer = [[CQTSMuxer alloc] initWithVideoConfig:videoConfig audioConfig:nil];
+            CQKernelBenchmarkTSSink *sink = [[CQKernelBenchmarkTSSink alloc] init];
+            muxer.delegate = sink;
+            NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:pFrameSize sliceCount:frameSize.sliceCount isKeyFrame:NO seed:9]];
+            __block int64_t frameIndex = 0;
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++, frameIndex++) {
+                    CMTime pts = CMTimeMake(frameIndex, 30);
+                    [muxer muxVideoNalus:nalus pts:pts dts:pts isKeyFrame:(frameIndex % 60 == 0)];
+                }
+                dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+                [muxer flushWithCompletionHandler:^{
+                    dispatch_semaphore_signal(semaphore);
+                }];
+                dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+                CQMicroBenchmarkDoNotOptimize(sink.outputBytes);
+            };
+        }];
+    }
+}
+
+/// FLV: 每帧封装一个tag；一个tag发给256个本地socket客户端(socketpair，每次迭代读空)
++ (void)registerFLVBenchmarks {
+    for (size_t s = 0; s < sizeof(kFrameSizes) / sizeof(kFrameSizes[0]); s++) {
+        CQKernelFrameSize frameSize = kFrameSizes[s];
+        [CQMicroBenchmark registerBenchmarkWithName:[@"FLVMuxVideo/scalar/" stringByAppendingString:@(frameSize.name)] bytesPerIteration:frameSize.idrSize itemsPerIteration:1 setup:^CQMicroBenchmarkRunBlock{
+            CQFLVMuxer *muxer = [[CQFLVMuxer alloc] initWithVideoConfig:[CQVideoCoderConfig defaultConifg] audioConfig:nil];
+            NSArray<NSData *> *nalus = [self nalusOfFrame:[CQBenchmarkStreamGenerator h264FrameWithSize:frameSize.idrSize sliceCount:frameSize.sliceCount isKeyFrame:YES seed:8]];
+            __block int64_t frameIndex = 0;
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++, frameIndex++) {
+                    CMTime pts = CMTimeMake(frameIndex, 30);
+                    CQMicroBenchmarkDoNotOptimize([muxer videoTagWithNalus:nalus pts:pts dts:pts isKeyFrame:YES].length);
+                }
+            };
+        }];
+    }
+
+    static const int clientCount = 256;
+    static const size_t tagSize = 16 * 1024;
+    [CQMicroBenchmark registerBenchmarkWithName:@"StreamFanout/scalar/256clients_16KB" bytesPerIteration:tagSize * clientCount itemsPerIteration:clientCount setup:^CQMicroBenchmarkRunBlock{
+        CQStreamFanout *fanout = CQStreamFanoutCreate(CQStreamFanoutDefaultConfig(), CQKernelBenchmarkFanoutEvent, NULL);
+        int *readFDs = calloc(clientCount, sizeof(int));
+        CQFanoutClient **clients = calloc(clientCount, sizeof(CQFanoutClient *));
+        for (int i = 0; i < clientCount; i++) {
+            int fds[2];
+            socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+            int bufferSize = 256 * 1024;
+            setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+            setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+            fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL, 0) | O_NONBLOCK);
+            readFDs[i] = fds[0];
+            clients[i] = CQStreamFanoutAddClient(fanout, fds[1], NULL, 0);
+        }
+        NSMutableData *tag = [NSMutableData dataWithLength:tagSize];
+        CQFanoutBuffer *buffer = CQFanoutBufferCreate(tag.bytes, tag.length, NULL, NULL);
+        // 第一个关键帧让客户端开始接收
+        CQStreamFanoutPublish(fanout, buffer, CQFanoutTagKindKeyFrame, 0);
+        uint8_t *readBuffer = malloc(tagSize * 2);
+        return ^(NSUInteger iterations) {
+            for (NSUInteger i = 0; i < iterations; i++) {
+                CQStreamFanoutPublish(fanout, buffer, CQFanoutTagKindFrame, 0);
+                // 读空后让没写完的客户端继续写(相当于可写事件)
+                for (int c = 0; c < clientCount; c++) {
+                    while (read(readFDs[c], readBuffer, tagSize * 2) > 0) {}
+                    CQStreamFanoutClientWritable(fanout, clients[c], 0);
+                }
+            }
+            CQMicroBenchmarkDoNotOptimize(CQStreamFanoutGetStats(fanout).bytesSent);
+            (void)tag;
+        };
+    }];
+}
+
+/// 编解码器的任务调度: 原来的编码队列+回调队列两跳，和共享执行器strand上一跳的对比
++ (void)registerExecutorBenchmarks {
+    static const NSUInteger frameCount = 256;
+    [CQMicroBenchmark registerBenchmarkWithName:@"CoderDispatch/twoQueues/256frames" bytesPerIteration:0 itemsPerIteration:frameCount setup:^CQMicroBenchmarkRunBlock{
+        dispatch_queue_t encodeQueue = dispatch_queue_create("benchmark encode queue", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_t callBackQueue = dispatch_queue_create("benchmark callBack queue", DISPATCH_QUEUE_SERIAL);
+        return ^(NSUInteger iterations) {
+            __block uint64_t count = 0;
+            for (NSUInteger i = 0; i < iterations; i++) {
+                for (NSUInteger f = 0; f < frameCount; f++) {
+                    dispatch_async(encodeQueue, ^{
+                        dispatch_async(callBackQueue, ^{
+                            count++;
+                        });
+                    });
+                }
+                dispatch_sync(encodeQueue, ^{});
+                dispatch_sync(callBackQueue, ^{});
+            }
+            CQMicroBenchmarkDoNotOptimize(count);
+        };
+    }];
+    // 编码strand + 回调strand，回调strand由同一个工作线程放进自己的队列，积压时才唤醒其它线程来偷
+    [CQMicroBenchmark registerBenchmarkWithName:@"CoderDispatch/strands/256frames" bytesPerIteration:0 itemsPerIteration:frameCount setup:^CQMicroBenchmarkRunBlock{
+        CQMediaStrand *strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"benchmark"];
+        CQMediaStrand *callbackStrand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"benchmark.callback"];
+        return ^(NSUInteger iterations) {
+            __block uint64_t count = 0;
+            for (NSUInteger i = 0; i < iterations; i++) {
+                for (NSUInteger f = 0; f < frameCount; f++) {
+                    [strand async:^{
+                        [callbackStrand async:^{
+                            count++;
+                        }];
+                    }];
+                }
+                [strand sync:^{}];
+                [callbackStrand sync:^{}];
+            }
+            CQMicroBenchmarkDoNotOptimize(count);
+        };
+    }];
+}
+
+/// 阶段间传递数据包: 无锁队列和加锁数组、每包一次dispatch_async的对比
++ (void)registerPacketQueueBenchmarks {
+    static const NSUInteger packetCount = 4096;
+    static const NSUInteger capacity = 1024;
+    NSArray<NSNumber *> *producerCounts = @[@1, @4];
+    for (NSNumber *producerCountNumber in producerCounts) {
+        NSUInteger producerCount = producerCountNumber.unsignedIntegerValue;
+        NSString *suffix = [NSString stringWithFormat:@"%luproducer", (unsigned long)producerCount];
+
+        if (producerCount == 1) {
+            [CQMicroBenchmark registerBenchmarkWithName:[@"PacketQueue/spsc/" stringByAppendingString:suffix] bytesPerIteration:0 itemsPerIteration:packetCount setup:^CQMicroBenchmarkRunBlock{
+                CQSPSCQueue<NSData *> *queue = [[CQSPSCQueue alloc] initWithCapacity:capacity];
+                return [self queueRunBlockWithPacketCount:packetCount producerCount:producerCount push:^BOOL(NSData *packet) {
+                    return [queue push:packet];
+                } drain:^NSUInteger{
+                    return [queue popBatchWithMaxCount:64 usingBlock:^(NSData *packet) {
+                        CQMicroBenchmarkDoNotOptimize(packet.length);
+                    }];
+                }];
+            }];
+        }
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"PacketQueue/mpsc/" stringByAppendingString:suffix] bytesPerIteration:0 itemsPerIteration:packetCount setup:^CQMicroBenchmarkRunBlock{
+            CQMPSCQueue<NSData *> *queue = [[CQMPSCQueue alloc] initWithCapacity:capacity];
+            return [self queueRunBlockWithPacketCount:packetCount producerCount:producerCount push:^BOOL(NSData *packet) {
+                return [queue push:packet];
+            } drain:^NSUInteger{
+                return [queue popBatchWithMaxCount:64 usingBlock:^(NSData *packet) {
+                    CQMicroBenchmarkDoNotOptimize(packet.length);
+                }];
+            }];
+        }];
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"PacketQueue/mutex/" stringByAppendingString:suffix] bytesPerIteration:0 itemsPerIteration:packetCount setup:^CQMicroBenchmarkRunBlock{
+            __block os_unfair_lock lock = OS_UNFAIR_LOCK_INIT;
+            NSMutableArray<NSData *> *items = [NSMutableArray arrayWithCapacity:capacity];
+            return [self queueRunBlockWithPacketCount:packetCount producerCount:producerCount push:^BOOL(NSData *packet) {
+                os_unfair_lock_lock(&lock);
+                BOOL isFull = items.count >= capacity;
+                if (!isFull) [items addObject:packet];
+                os_unfair_lock_unlock(&lock);
+                return !isFull;
+            } drain:^NSUInteger{
+                os_unfair_lock_lock(&lock);
+                NSUInteger count = MIN(items.count, (NSUInteger)64);
+                for (NSUInteger i = 0; i < count; i++) {
+                    CQMicroBenchmarkDoNotOptimize(items[i].length);
+                }
+                [items removeObjectsInRange:NSMakeRange(0, count)];
+                os_unfair_lock_unlock(&lock);
+                return count;
+            }];
+        }];
+
+        [CQMicroBenchmark registerBenchmarkWithName:[@"PacketQueue/dispatch/" stringByAppendingString:suffix] bytesPerIteration:0 itemsPerIteration:packetCount setup:^CQMicroBenchmarkRunBlock{
+            dispatch_queue_t consumerQueue = dispatch_queue_create("benchmark consumer queue", DISPATCH_QUEUE_SERIAL);
+            NSData *packet = [NSMutableData dataWithLength:1200];
+            return ^(NSUInteger iterations) {
+                for (NSUInteger i = 0; i < iterations; i++) {
+                    dispatch_group_t group = dispatch_group_create();
+                    for (NSUInteger p = 0; p < producerCount; p++) {
+                        dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                            for (NSUInteger n = 0; n < packetCount / producerCount; n++) {
+                                dispatch_async(consumerQueue, ^{
+                                    CQMicroBenchmarkDoNotOptimize(packet.length);
+                                });
+                            }
+                        });
+                    }
+                    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+                    dispatch_sync(consumerQueue, ^{});
+                }
+            };
+        }];
+    }
+}
+
+/// 生产者在全局队列放入packetCount个包，当前线程作为消费者取出，队列满或空时让出CPU
++ (CQMicroBenchmarkRunBlock)queueRunBlockWithPacketCount:(NSUInteger)packetCount producerCount:(NSUInteger)producerCount push:(BOOL (^)(NSData *packet))push drain:(NSUInteger (^)(void))drain {
+    NSData *packet = [NSMutableData dataWithLength:1200];
+    return ^(NSUInteger iterations) {
+        for (NSUInteger i = 0; i < iterations; i++) {
+            for (NSUInteger p = 0; p < producerCount; p++) {
+                dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+                    for (NSUInteger n = 0; n < packetCount / producerCount; n++) {
+                        while (!push(packet)) sched_yield();
+                    }
+                });
+            }
+            NSUInteger received = 0;
+            while (received < packetCount) {
+                NSUInteger count = drain();
+                if (count == 0) sched_yield();
+                received += count;
+            }
+        }
+    };
+}
+
+@end
@@ -0,0 +1,53 @@
+//
+//  CQMicroBenchmark.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 执行iterations次被测代码
+typedef void (^CQMicroBenchmarkRunBlock)(NSUInteger iterations);
+
+/// 防止被测代码的结果被编译器优化掉
+FOUNDATION_EXPORT void CQMicroBenchmarkDoNotOptimize(uint64_t value);
+
+/**
+ 微基准测试
+ @discussion 参考Google Benchmark: 每个用例先准备数据(不计时)，再自动调整迭代次数直到单次运行超过minTime，重复多次取中位数
+ 报告使用Google Benchmark的JSON格式(context + benchmarks)，可以直接用它的compare.py对比两次结果
+ 名称约定为"内核/实现/规模"，例如StartCodeScan/simd/512KB，标量和SIMD实现并列
+ */
+@interface CQMicroBenchmark : NSObject
+
+/**
+ 注册一个用例
+ @param name 名称
+ @param bytesPerIteration 每次迭代处理的字节数，用于计算bytes_per_second，0为不统计
+ @param itemsPerIteration 每次迭代处理的个数(帧、包)，用于计算items_per_second，0为不统计
+ @param setup 准备数据并返回被测代码，运行前调用，不计时
+ */
++ (void)registerBenchmarkWithName:(NSString *)name bytesPerIteration:(NSUInteger)bytesPerIteration itemsPerIteration:(NSUInteger)itemsPerIteration setup:(CQMicroBenchmarkRunBlock (^)(void))setup;
+
+/**
+ 运行已注册的用例(同步)
+ @param filter 名称包含filter的用例才运行，nil为全部
+ @param minTime 单次运行的最短时间(秒)
+ @param repetitions 重复次数
+ @return Google Benchmark格式的报告
+ */
++ (NSDictionary<NSString *, id> *)runBenchmarksMatchingFilter:(nullable NSString *)filter minTime:(NSTimeInterval)minTime repetitions:(NSUInteger)repetitions;
+
+/**
+ 注册媒体内核用例并全部运行
+ @param directory 报告写入directory/micro_benchmark.json
+ @param completionHandler 完成后在后台队列回调
+ */
++ (void)runMediaKernelBenchmarksInDirectory:(NSString *)directory completionHandler:(nullable void (^)(NSDictionary<NSString *, id> *report, NSString * _Nullable reportPath))completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
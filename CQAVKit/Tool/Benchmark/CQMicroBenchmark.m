@@ -0,0 +1,177 @@
+//
+//  CQMicroBenchmark.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 用例注册时只保存准备block，运行时才准备数据，没运行的用例不占内存
+ 2 迭代次数从1开始，按上一次的耗时估算达到minTime需要的次数(至少放大到1.4倍，最多10倍)，和Google Benchmark一致
+ 3 确定迭代次数后重复运行repetitions次，报告中位数，同时给出最小值和变异系数，判断结果是否稳定
+ */
+
+#import "CQMicroBenchmark.h"
+#import <UIKit/UIKit.h>
+#import <sys/utsname.h>
+#import "CQBenchmarkUtil.h"
+#import "CQPipelineBenchmark.h"
+#import "CQMediaKernelBenchmarks.h"
+
+static volatile uint64_t CQMicroBenchmarkSink;
+
+void CQMicroBenchmarkDoNotOptimize(uint64_t value) {
+    CQMicroBenchmarkSink += value;
+}
+
+/// 用例
+@interface CQMicroBenchmarkCase : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, assign) NSUInteger bytesPerIteration;
+@property (nonatomic, assign) NSUInteger itemsPerIteration;
+@property (nonatomic, copy) CQMicroBenchmarkRunBlock (^setup)(void);
+@end
+
+@implementation CQMicroBenchmarkCase
+@end
+
+@implementation CQMicroBenchmark
+
+#pragma mark - Public Func
++ (NSMutableArray<CQMicroBenchmarkCase *> *)registeredCases {
+    static NSMutableArray<CQMicroBenchmarkCase *> *cases;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cases = [NSMutableArray array];
+    });
+    return cases;
+}
+
++ (void)registerBenchmarkWithName:(NSString *)name bytesPerIteration:(NSUInteger)bytesPerIteration itemsPerIteration:(NSUInteger)itemsPerIteration setup:(CQMicroBenchmarkRunBlock (^)(void))setup {
+    CQMicroBenchmarkCase *benchmarkCase = [[CQMicroBenchmarkCase alloc] init];
+    benchmarkCase.name = name;
+    benchmarkCase.bytesPerIteration = bytesPerIteration;
+    benchmarkCase.itemsPerIteration = itemsPerIteration;
+    benchmarkCase.setup = setup;
+    @synchronized (self) {
+        [[self registeredCases] addObject:benchmarkCase];
+    }
+}
+
++ (NSDictionary<NSString *, id> *)runBenchmarksMatchingFilter:(NSString *)filter minTime:(NSTimeInterval)minTime repetitions:(NSUInteger)repetitions {
+    NSArray<CQMicroBenchmarkCase *> *cases;
+    @synchronized (self) {
+        cases = [[self registeredCases] copy];
+    }
+    NSMutableArray<NSDictionary *> *results = [NSMutableArray array];
+    for (CQMicroBenchmarkCase *benchmarkCase in cases) {
+        if (filter.length > 0 && ![benchmarkCase.name containsString:filter]) continue;
+        @autoreleasepool {
+            [results addObject:[self runCase:benchmarkCase minTime:minTime repetitions:MAX(repetitions, 1)]];
+        }
+    }
+    return @{@"context": [self context], @"benchmarks": results};
+}
+
++ (void)runMediaKernelBenchmarksInDirectory:(NSString *)directory completionHandler:(void (^)(NSDictionary<NSString *, id> *, NSString *))completionHandler {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        static dispatch_once_t onceToken;
+        dispatch_once(&onceToken, ^{
+            [CQMediaKernelBenchmarks registerBenchmarks];
+        });
+        NSDictionary *report = [self runBenchmarksMatchingFilter:nil minTime:0.2 repetitions:3];
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        NSString *reportPath = [directory stringByAppendingPathComponent:@"micro_benchmark.json"];
+        if (![[CQPipelineBenchmark JSONDataWithReport:report] writeToFile:reportPath atomically:YES]) reportPath = nil;
+        if (completionHandler) completionHandler(report, reportPath);
+    });
+}
+
+#pragma mark - Private Func
++ (NSDictionary *)runCase:(CQMicroBenchmarkCase *)benchmarkCase minTime:(NSTimeInterval)minTime repetitions:(NSUInteger)repetitions {
+    CQMicroBenchmarkRunBlock run = benchmarkCase.setup();
+    uint64_t minNanos = (uint64_t)(minTime * NSEC_PER_SEC);
+
+    // 调整迭代次数
+    NSUInteger iterations = 1;
+    while (YES) {
+        uint64_t start = CQBenchmarkNowNanos();
+        run(iterations);
+        uint64_t elapsed = CQBenchmarkNowNanos() - start;
+        if (elapsed >= minNanos || iterations >= 1000000000) break;
+        double multiplier = elapsed > 0 ? MIN(MAX(minNanos * 1.4 / elapsed, 1.4), 10.0) : 10.0;
+        iterations = (NSUInteger)ceil(iterations * multiplier);
+    }
+
+    // 重复运行，每次的单次迭代耗时
+    double *nanosPerIteration = malloc(repetitions * sizeof(double));
+    for (NSUInteger i = 0; i < repetitions; i++) {
+        uint64_t start = CQBenchmarkNowNanos();
+        run(iterations);
+        nanosPerIteration[i] = (double)(CQBenchmarkNowNanos() - start) / iterations;
+    }
+    double mean = 0;
+    for (NSUInteger i = 0; i < repetitions; i++) mean += nanosPerIteration[i];
+    mean /= repetitions;
+    double variance = 0;
+    for (NSUInteger i = 0; i < repetitions; i++) variance += (nanosPerIteration[i] - mean) * (nanosPerIteration[i] - mean);
+    double stddev = sqrt(variance / repetitions);
+    qsort_b(nanosPerIteration, repetitions, sizeof(double), ^int(const void *a, const void *b) {
+        double x = *(const double *)a, y = *(const double *)b;
+        return x < y ? -1 : (x > y ? 1 : 0);
+    });
+    double median = nanosPerIteration[repetitions / 2];
+    double minimum = nanosPerIteration[0];
+    free(nanosPerIteration);
+
+    NSMutableDictionary *result = [@{
+        @"name": benchmarkCase.name,
+        @"run_type": @"aggregate",
+        @"aggregate_name": @"median",
+        @"repetitions": @(repetitions),
+        @"iterations": @(iterations),
+        @"real_time": @(median),
+        @"cpu_time": @(median),
+        @"time_unit": @"ns",
+        @"min_time": @(minimum),
+        @"cv": @(mean > 0 ? stddev / mean : 0),
+    } mutableCopy];
+    if (benchmarkCase.bytesPerIteration > 0) {
+        result[@"bytes_per_second"] = @(benchmarkCase.bytesPerIteration * 1e9 / median);
+    }
+    if (benchmarkCase.itemsPerIteration > 0) {
+        result[@"items_per_second"] = @(benchmarkCase.itemsPerIteration * 1e9 / median);
+    }
+    return result;
+}
+
+/// 运行环境，对比不同提交的结果时需要确认是同一台设备、同一个编译配置
++ (NSDictionary *)context {
+    struct utsname systemInfo;
+    uname(&systemInfo);
+    NSDictionary *infoDictionary = [NSBundle mainBundle].infoDictionary;
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    formatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    formatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ssZZZZZ";
+#ifdef DEBUG
+    NSString *buildType = @"debug";
+#else
+    NSString *buildType = @"release";
+#endif
+    return @{
+        @"date": [formatter stringFromDate:[NSDate date]],
+        @"host_name": @(systemInfo.machine),
+        @"os_version": [UIDevice currentDevice].systemVersion,
+        @"num_cpus": @([NSProcessInfo processInfo].activeProcessorCount),
+        @"library_build_type": buildType,
+        @"app_version": [NSString stringWithFormat:@"%@(%@)", infoDictionary[@"CFBundleShortVersionString"], infoDictionary[@"CFBundleVersion"]],
+#if defined(__aarch64__)
+        @"simd": @"neon",
+#else
+        @"simd": @"none",
+#endif
+    };
+}
+
+@end
@@ -0,0 +1,122 @@
+//
+//  CQNetworkSimulator.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQNackTracker.h"
+
+/**
+ 网络模拟(纯C，确定性)
+ @discussion 链路为单个瓶颈FIFO: 容量按轨迹随时间变化，队列满时尾部丢弃，另有固定传播时延和随机丢包(固定种子)
+ 拥塞控制模拟: 编码器按目标码率出帧 -> CQPacerCore平滑发送 -> 链路 -> 接收端每50ms反馈 -> CQBandwidthEstimator
+ 全部在模拟时钟下运行，同样的配置每次结果相同，用来验证收敛时间、链路利用率和排队时延
+ 丢包/抖动信道: 固定时延 + 均匀抖动(会乱序) + 随机丢包，NACK模拟的双向都走这样的信道
+ NACK模拟: 固定帧率出帧 -> 信道 -> CQNackTracker每10ms收集NACK -> 反向信道 -> 发送端限次重传，统计按时到达的完整帧比例
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 链路轨迹的一段
+typedef struct {
+    uint64_t durationUs;  ///< 时长
+    uint64_t capacityBps;  ///< 容量
+} CQLinkTraceStep;
+
+typedef struct CQNetworkLink CQNetworkLink;
+
+/**
+ 创建链路
+ @param trace 容量轨迹，播放完后保持最后一段
+ @param stepCount 段数
+ @param propagationDelayUs 单向传播时延
+ @param queueLimitBytes 瓶颈队列长度(字节)
+ @param lossRate 随机丢包率
+ @param seed 随机种子
+ */
+FOUNDATION_EXPORT CQNetworkLink *CQNetworkLinkCreate(const CQLinkTraceStep *trace, size_t stepCount, uint64_t propagationDelayUs, uint64_t queueLimitBytes, double lossRate, uint32_t seed);
+FOUNDATION_EXPORT void CQNetworkLinkDestroy(CQNetworkLink *link);
+/// 某个时刻的容量
+FOUNDATION_EXPORT uint64_t CQNetworkLinkCapacityAt(const CQNetworkLink *link, uint64_t timeUs);
+/**
+ 发送一个包，发送时间需要单调递增
+ @return 到达时间，丢失返回0
+ */
+FOUNDATION_EXPORT uint64_t CQNetworkLinkSend(CQNetworkLink *link, uint64_t sendTimeUs, uint32_t size);
+
+/// 拥塞控制模拟配置
+typedef struct {
+    const CQLinkTraceStep *trace;  ///< 容量轨迹
+    size_t stepCount;  ///< 段数
+    uint64_t propagationDelayUs;  ///< 单向传播时延，反馈走同样的时延
+    uint64_t queueLimitBytes;  ///< 瓶颈队列长度
+    double lossRate;  ///< 随机丢包率
+    uint32_t seed;  ///< 随机种子
+    uint64_t durationUs;  ///< 模拟时长
+    uint64_t startBitrate;  ///< 初始码率
+    uint64_t minBitrate;  ///< 最小码率
+    uint64_t maxBitrate;  ///< 最大码率
+} CQCongestionSimulationConfig;
+
+#define CQCongestionSimulationMaxSteps 8
+
+/// 拥塞控制模拟结果
+typedef struct {
+    uint64_t convergenceTimeUs[CQCongestionSimulationMaxSteps];  ///< 每段开始后目标码率进入容量的[0.6, 1.1]倍所用时间，UINT64_MAX为未收敛
+    size_t convergenceCount;  ///< 有效段数
+    double utilisation;  ///< 收到的字节 / 链路容量
+    double p50QueueDelayMs;  ///< 瓶颈排队时延中位数
+    double p95QueueDelayMs;  ///< 瓶颈排队时延95分位
+    double lossRate;  ///< 实际丢包率(含随机丢包和队列溢出)
+    uint64_t finalTargetBitrate;  ///< 结束时的目标码率
+} CQCongestionSimulationResult;
+
+/// 运行拥塞控制模拟
+FOUNDATION_EXPORT CQCongestionSimulationResult CQCongestionSimulationRun(const CQCongestionSimulationConfig *config);
+
+typedef struct CQImpairedChannel CQImpairedChannel;
+
+/**
+ 创建丢包/抖动信道
+ @param delayUs 固定单向时延
+ @param jitterUs 抖动，每个包额外延迟[0, jitterUs]均匀分布，大于包间隔时会乱序
+ @param lossRate 随机丢包率
+ @param seed 随机种子
+ */
+FOUNDATION_EXPORT CQImpairedChannel *CQImpairedChannelCreate(uint64_t delayUs, uint64_t jitterUs, double lossRate, uint32_t seed);
+FOUNDATION_EXPORT void CQImpairedChannelDestroy(CQImpairedChannel *channel);
+
+/// 发送一个包，返回到达时间，丢失返回0
+FOUNDATION_EXPORT uint64_t CQImpairedChannelSend(CQImpairedChannel *channel, uint64_t sendTimeUs);
+
+/// NACK模拟配置
+typedef struct {
+    uint64_t delayUs;  ///< 单向时延
+    uint64_t jitterUs;  ///< 抖动
+    double lossRate;  ///< 双向的随机丢包率
+    uint32_t seed;  ///< 随机种子
+    uint64_t durationUs;  ///< 模拟时长
+    uint32_t fps;  ///< 帧率
+    uint32_t packetsPerFrame;  ///< 每帧包数
+    uint32_t maxRetransmissions;  ///< 发送端每个包最多重传次数
+    CQNackTrackerConfig trackerConfig;  ///< 接收端配置
+} CQNackSimulationConfig;
+
+/// NACK模拟结果
+typedef struct {
+    uint64_t frameCount;  ///< 帧数
+    double completeWithoutNack;  ///< 不重传时按时完整的帧比例
+    double completeWithNack;  ///< 重传后按时完整的帧比例
+    uint64_t lostPacketCount;  ///< 第一次发送丢失的包数
+    uint64_t retransmittedCount;  ///< 重传次数
+    uint64_t keyFrameRequestCount;  ///< 关键帧请求次数
+    uint64_t abandonedCount;  ///< 接收端放弃的包数
+    uint64_t rttEstimateUs;  ///< 接收端最终的RTT估计
+} CQNackSimulationResult;
+
+/// 运行NACK模拟
+FOUNDATION_EXPORT CQNackSimulationResult CQNackSimulationRun(const CQNackSimulationConfig *config);
+
+NS_ASSUME_NONNULL_END
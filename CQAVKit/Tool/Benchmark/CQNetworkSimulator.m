@@ -0,0 +1,423 @@
+//
+//  CQNetworkSimulator.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 链路只记录瓶颈空闲的时刻: 包到达时排在它后面，排队字节 = 等待时间 x 容量，超过队列长度尾部丢弃
+ 2 模拟按事件推进时钟(出帧、平滑发送、反馈、反馈到达、采样)，没有真实等待
+ 3 接收端每50ms把已经确定的包(已到达的，以及排在已到达的包前面的丢失包)打成一次反馈，经过传播时延后交给估计器
+ 4 NACK模拟有抖动会乱序，到达事件放在最小堆里按时间取出
+ */
+
+#import "CQNetworkSimulator.h"
+#import "CQBandwidthEstimator.h"
+#import "CQPacketPacer.h"
+#import <stdlib.h>
+
+static const uint64_t kFrameIntervalUs = 33333;  ///< 30fps
+static const uint32_t kPacketSize = 1200;
+static const uint64_t kFeedbackIntervalUs = 50000;
+static const uint64_t kSampleIntervalUs = 100000;
+
+#pragma mark - CQNetworkLink
+struct CQNetworkLink {
+    CQLinkTraceStep *trace;
+    size_t stepCount;
+    uint64_t propagationDelayUs;
+    uint64_t queueLimitBytes;
+    double lossRate;
+    uint32_t randomState;
+    uint64_t linkFreeUs;  ///< 瓶颈发送完当前队列的时刻
+};
+
+static double CQSimulatorRandom(uint32_t *state) {
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (double)x / 4294967296.0;
+}
+
+static double CQNetworkLinkRandom(CQNetworkLink *link) {
+    return CQSimulatorRandom(&link->randomState);
+}
+
+CQNetworkLink *CQNetworkLinkCreate(const CQLinkTraceStep *trace, size_t stepCount, uint64_t propagationDelayUs, uint64_t queueLimitBytes, double lossRate, uint32_t seed) {
+    CQNetworkLink *link = calloc(1, sizeof(CQNetworkLink));
+    link->trace = malloc(stepCount * sizeof(CQLinkTraceStep));
+    memcpy(link->trace, trace, stepCount * sizeof(CQLinkTraceStep));
+    link->stepCount = stepCount;
+    link->propagationDelayUs = propagationDelayUs;
+    link->queueLimitBytes = queueLimitBytes;
+    link->lossRate = lossRate;
+    link->randomState = seed ? seed : 1;
+    return link;
+}
+
+void CQNetworkLinkDestroy(CQNetworkLink *link) {
+    free(link->trace);
+    free(link);
+}
+
+uint64_t CQNetworkLinkCapacityAt(const CQNetworkLink *link, uint64_t timeUs) {
+    uint64_t stepEnd = 0;
+    for (size_t i = 0; i < link->stepCount; i++) {
+        stepEnd += link->trace[i].durationUs;
+        if (timeUs < stepEnd) return link->trace[i].capacityBps;
+    }
+    return link->trace[link->stepCount - 1].capacityBps;
+}
+
+uint64_t CQNetworkLinkSend(CQNetworkLink *link, uint64_t sendTimeUs, uint32_t size) {
+    double capacity = (double)CQNetworkLinkCapacityAt(link, sendTimeUs);
+    uint64_t startUs = MAX(link->linkFreeUs, sendTimeUs);
+    double queuedBytes = (double)(startUs - sendTimeUs) * capacity / 8 / 1000000;
+    if (queuedBytes + size > link->queueLimitBytes) return 0;
+    link->linkFreeUs = startUs + (uint64_t)((double)size * 8 * 1000000 / capacity);
+    if (CQNetworkLinkRandom(link) < link->lossRate) return 0;
+    return link->linkFreeUs + link->propagationDelayUs;
+}
+
+#pragma mark - Simulation
+/// 发出的包
+typedef struct {
+    uint64_t sendTimeUs;
+    uint64_t arrivalTimeUs;
+    uint32_t size;
+} CQSimulatedPacket;
+
+/// 在途的反馈
+typedef struct {
+    uint64_t deliverTimeUs;
+    size_t startIndex;
+    size_t endIndex;
+} CQSimulatedFeedback;
+
+static int CQCompareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+CQCongestionSimulationResult CQCongestionSimulationRun(const CQCongestionSimulationConfig *config) {
+    CQCongestionSimulationResult result = {0};
+    CQNetworkLink *link = CQNetworkLinkCreate(config->trace, config->stepCount, config->propagationDelayUs, config->queueLimitBytes, config->lossRate, config->seed);
+    CQBandwidthEstimator *estimator = CQBandwidthEstimatorCreate(config->startBitrate, config->minBitrate, config->maxBitrate);
+    CQPacerCore *pacer = CQPacerCoreCreate(CQBandwidthEstimatorTargetBitrate(estimator), 2.5);
+
+    size_t packetCapacity = 4096, packetCount = 0, feedbackStart = 0;
+    CQSimulatedPacket *packets = malloc(packetCapacity * sizeof(CQSimulatedPacket));
+    size_t delayCapacity = 4096, delayCount = 0;
+    double *queueDelays = malloc(delayCapacity * sizeof(double));
+    size_t inFlightCapacity = 64, inFlightHead = 0, inFlightCount = 0;
+    CQSimulatedFeedback *inFlight = malloc(inFlightCapacity * sizeof(CQSimulatedFeedback));
+    size_t feedbackCapacity = 1024;
+    CQPacketFeedback *feedback = malloc(feedbackCapacity * sizeof(CQPacketFeedback));
+
+    result.convergenceCount = MIN(config->stepCount, (size_t)CQCongestionSimulationMaxSteps);
+    for (size_t i = 0; i < CQCongestionSimulationMaxSteps; i++) result.convergenceTimeUs[i] = UINT64_MAX;
+
+    uint64_t now = 0, nextFrame = 0, nextFeedback = kFeedbackIntervalUs, nextSample = 0, frameID = 0;
+    uint64_t deliveredBytes = 0, lostCount = 0;
+    while (now < config->durationUs) {
+        // 编码器按目标码率出帧
+        if (now >= nextFrame) {
+            uint64_t frameBytes = MAX(CQBandwidthEstimatorTargetBitrate(estimator) / 8 * kFrameIntervalUs / 1000000, (uint64_t)kPacketSize);
+            frameID++;
+            for (uint64_t offset = 0; offset < frameBytes; offset += kPacketSize) {
+                CQPacerPacket packet = {.size = (uint32_t)MIN((uint64_t)kPacketSize, frameBytes - offset), .priority = CQPacerPriorityVideo, .frameID = frameID};
+                CQPacerCoreEnqueue(pacer, packet, now);
+            }
+            nextFrame += kFrameIntervalUs;
+        }
+        // 平滑发送
+        CQPacerPacket pacerPacket;
+        while (CQPacerCorePop(pacer, now, &pacerPacket)) {
+            uint64_t arrival = CQNetworkLinkSend(link, now, pacerPacket.size);
+            if (packetCount == packetCapacity) {
+                packetCapacity *= 2;
+                packets = realloc(packets, packetCapacity * sizeof(CQSimulatedPacket));
+            }
+            packets[packetCount++] = (CQSimulatedPacket){now, arrival, pacerPacket.size};
+            if (arrival == 0) {
+                lostCount++;
+                continue;
+            }
+            deliveredBytes += pacerPacket.size;
+            // 排队时延 = 到达 - 发送 - 传播 - 自身的发送时长
+            double serializationUs = (double)pacerPacket.size * 8 * 1000000 / (double)CQNetworkLinkCapacityAt(link, now);
+            if (delayCount == delayCapacity) {
+                delayCapacity *= 2;
+                queueDelays = realloc(queueDelays, delayCapacity * sizeof(double));
+            }
+            queueDelays[delayCount++] = fmax(((double)(arrival - now - config->propagationDelayUs) - serializationUs) / 1000.0, 0);
+        }
+        // 接收端生成反馈
+        if (now >= nextFeedback) {
+            size_t endIndex = feedbackStart;
+            for (size_t i = feedbackStart; i < packetCount; i++) {
+                if (packets[i].arrivalTimeUs == 0) continue;
+                if (packets[i].arrivalTimeUs > now) break;
+                endIndex = i + 1;
+            }
+            if (endIndex > feedbackStart) {
+                if (inFlightCount == inFlightCapacity) {
+                    CQSimulatedFeedback *expanded = malloc(inFlightCapacity * 2 * sizeof(CQSimulatedFeedback));
+                    for (size_t i = 0; i < inFlightCount; i++) expanded[i] = inFlight[(inFlightHead + i) % inFlightCapacity];
+                    free(inFlight);
+                    inFlight = expanded;
+                    inFlightHead = 0;
+                    inFlightCapacity *= 2;
+                }
+                inFlight[(inFlightHead + inFlightCount) % inFlightCapacity] = (CQSimulatedFeedback){now + config->propagationDelayUs, feedbackStart, endIndex};
+                inFlightCount++;
+                feedbackStart = endIndex;
+            }
+            nextFeedback += kFeedbackIntervalUs;
+        }
+        // 反馈到达发送端
+        while (inFlightCount > 0 && inFlight[inFlightHead].deliverTimeUs <= now) {
+            CQSimulatedFeedback batch = inFlight[inFlightHead];
+            inFlightHead = (inFlightHead + 1) % inFlightCapacity;
+            inFlightCount--;
+            size_t count = batch.endIndex - batch.startIndex;
+            if (count > feedbackCapacity) {
+                feedbackCapacity = count;
+                feedback = realloc(feedback, feedbackCapacity * sizeof(CQPacketFeedback));
+            }
+            for (size_t i = 0; i < count; i++) {
+                CQSimulatedPacket packet = packets[batch.startIndex + i];
+                feedback[i] = (CQPacketFeedback){packet.sendTimeUs, packet.arrivalTimeUs, packet.size};
+            }
+            CQBandwidthEstimatorOnFeedback(estimator, feedback, count, now);
+            CQPacerCoreSetTargetBitrate(pacer, CQBandwidthEstimatorTargetBitrate(estimator));
+        }
+        // 采样收敛
+        if (now >= nextSample) {
+            uint64_t stepStart = 0;
+            for (size_t s = 0; s < result.convergenceCount; s++) {
+                uint64_t stepEnd = stepStart + config->trace[s].durationUs;
+                if (now >= stepStart && now < stepEnd && result.convergenceTimeUs[s] == UINT64_MAX) {
+                    double ratio = (double)CQBandwidthEstimatorTargetBitrate(estimator) / (double)config->trace[s].capacityBps;
+                    if (ratio >= 0.6 && ratio <= 1.1) result.convergenceTimeUs[s] = now - stepStart;
+                }
+                stepStart = stepEnd;
+            }
+            nextSample += kSampleIntervalUs;
+        }
+        // 推进到下一个事件
+        uint64_t next = MIN(MIN(nextFrame, nextFeedback), MIN(nextSample, CQPacerCoreNextSendTime(pacer, now)));
+        if (inFlightCount > 0) next = MIN(next, inFlight[inFlightHead].deliverTimeUs);
+        now = MAX(next, now + 1);
+    }
+
+    // 统计
+    double capacityBits = 0;
+    for (uint64_t t = 0; t < config->durationUs; t += 1000) {
+        capacityBits += (double)CQNetworkLinkCapacityAt(link, t) / 1000;
+    }
+    result.utilisation = capacityBits > 0 ? (double)deliveredBytes * 8 / capacityBits : 0;
+    result.lossRate = packetCount > 0 ? (double)lostCount / (double)packetCount : 0;
+    if (delayCount > 0) {
+        qsort(queueDelays, delayCount, sizeof(double), CQCompareDouble);
+        result.p50QueueDelayMs = queueDelays[delayCount / 2];
+        result.p95QueueDelayMs = queueDelays[MIN(delayCount * 95 / 100, delayCount - 1)];
+    }
+    result.finalTargetBitrate = CQBandwidthEstimatorTargetBitrate(estimator);
+
+    free(packets);
+    free(queueDelays);
+    free(inFlight);
+    free(feedback);
+    CQPacerCoreDestroy(pacer);
+    CQBandwidthEstimatorDestroy(estimator);
+    CQNetworkLinkDestroy(link);
+    return result;
+}
+
+#pragma mark - CQImpairedChannel
+struct CQImpairedChannel {
+    uint64_t delayUs;
+    uint64_t jitterUs;
+    double lossRate;
+    uint32_t randomState;
+};
+
+CQImpairedChannel *CQImpairedChannelCreate(uint64_t delayUs, uint64_t jitterUs, double lossRate, uint32_t seed) {
+    CQImpairedChannel *channel = calloc(1, sizeof(CQImpairedChannel));
+    channel->delayUs = delayUs;
+    channel->jitterUs = jitterUs;
+    channel->lossRate = lossRate;
+    channel->randomState = seed ? seed : 1;
+    return channel;
+}
+
+void CQImpairedChannelDestroy(CQImpairedChannel *channel) {
+    free(channel);
+}
+
+uint64_t CQImpairedChannelSend(CQImpairedChannel *channel, uint64_t sendTimeUs) {
+    if (CQSimulatorRandom(&channel->randomState) < channel->lossRate) return 0;
+    uint64_t jitter = (uint64_t)(CQSimulatorRandom(&channel->randomState) * (double)(channel->jitterUs + 1));
+    return sendTimeUs + channel->delayUs + jitter;
+}
+
+#pragma mark - NACK Simulation
+/// 模拟事件
+typedef struct {
+    uint64_t timeUs;
+    BOOL isNack;  ///< NO为媒体包到达，YES为NACK到达发送端
+    uint32_t index;  ///< 媒体包序号，或NACK序列号在池中的偏移
+    uint32_t count;  ///< NACK序列号个数
+} CQNackSimulationEvent;
+
+/// 按时间的最小堆
+typedef struct {
+    CQNackSimulationEvent *events;
+    size_t count;
+    size_t capacity;
+} CQNackSimulationHeap;
+
+static void CQNackSimulationHeapPush(CQNackSimulationHeap *heap, CQNackSimulationEvent event) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = MAX(heap->capacity * 2, (size_t)256);
+        heap->events = realloc(heap->events, heap->capacity * sizeof(CQNackSimulationEvent));
+    }
+    size_t i = heap->count++;
+    while (i > 0 && heap->events[(i - 1) / 2].timeUs > event.timeUs) {
+        heap->events[i] = heap->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->events[i] = event;
+}
+
+static CQNackSimulationEvent CQNackSimulationHeapPop(CQNackSimulationHeap *heap) {
+    CQNackSimulationEvent top = heap->events[0];
+    CQNackSimulationEvent last = heap->events[--heap->count];
+    size_t i = 0;
+    while (2 * i + 1 < heap->count) {
+        size_t child = 2 * i + 1;
+        if (child + 1 < heap->count && heap->events[child + 1].timeUs < heap->events[child].timeUs) child++;
+        if (heap->events[child].timeUs >= last.timeUs) break;
+        heap->events[i] = heap->events[child];
+        i = child;
+    }
+    if (heap->count > 0) heap->events[i] = last;
+    return top;
+}
+
+CQNackSimulationResult CQNackSimulationRun(const CQNackSimulationConfig *config) {
+    static const uint64_t kCollectIntervalUs = 10000;
+    static const uint64_t kPacketSpacingUs = 200;
+    static const uint64_t kMinRetransmissionIntervalUs = 10000;
+    CQNackSimulationResult result = {0};
+    uint64_t frameIntervalUs = 1000000 / MAX(config->fps, 1u);
+    // 媒体包序号直接当序列号，不超过16位
+    uint64_t frameCount = MIN(config->durationUs / frameIntervalUs, (uint64_t)(0xFFFF / MAX(config->packetsPerFrame, 1u)));
+    size_t packetCount = (size_t)(frameCount * config->packetsPerFrame);
+    result.frameCount = frameCount;
+    if (packetCount == 0) return result;
+
+    CQImpairedChannel *forward = CQImpairedChannelCreate(config->delayUs, config->jitterUs, config->lossRate, config->seed);
+    CQImpairedChannel *backward = CQImpairedChannelCreate(config->delayUs, config->jitterUs, config->lossRate, config->seed * 7 + 3);
+    CQNackTracker *tracker = CQNackTrackerCreate(config->trackerConfig);
+    uint64_t *originalArrival = calloc(packetCount, sizeof(uint64_t));
+    uint64_t *firstArrival = calloc(packetCount, sizeof(uint64_t));
+    uint32_t *retransmissions = calloc(packetCount, sizeof(uint32_t));
+    uint64_t *lastRetransmitUs = calloc(packetCount, sizeof(uint64_t));
+    size_t poolCapacity = 4096, poolCount = 0;
+    uint16_t *pool = malloc(poolCapacity * sizeof(uint16_t));
+    CQNackSimulationHeap heap = {0};
+    uint16_t nacks[512];
+
+    uint64_t now = 0, nextFrame = 0, nextCollect = kCollectIntervalUs, frameIndex = 0;
+    uint64_t endUs = frameCount * frameIntervalUs + config->delayUs + config->jitterUs + config->trackerConfig.playoutDeadlineUs;
+    while (now < endUs) {
+        if (frameIndex < frameCount && now >= nextFrame) {
+            for (uint32_t k = 0; k < config->packetsPerFrame; k++) {
+                uint32_t index = (uint32_t)(frameIndex * config->packetsPerFrame + k);
+                uint64_t arrival = CQImpairedChannelSend(forward, now + k * kPacketSpacingUs);
+                originalArrival[index] = arrival;
+                if (arrival == 0) {
+                    result.lostPacketCount++;
+                } else {
+                    CQNackSimulationHeapPush(&heap, (CQNackSimulationEvent){arrival, NO, index, 0});
+                }
+            }
+            frameIndex++;
+            nextFrame += frameIntervalUs;
+        }
+        if (now >= nextCollect) {
+            BOOL needsKeyFrame = NO;
+            size_t count = CQNackTrackerCollect(tracker, now, nacks, sizeof(nacks) / sizeof(nacks[0]), &needsKeyFrame);
+            if (needsKeyFrame) result.keyFrameRequestCount++;
+            uint64_t arrival = count > 0 ? CQImpairedChannelSend(backward, now) : 0;
+            if (arrival > 0) {
+                if (poolCount + count > poolCapacity) {
+                    poolCapacity = MAX(poolCapacity * 2, poolCount + count);
+                    pool = realloc(pool, poolCapacity * sizeof(uint16_t));
+                }
+                memcpy(pool + poolCount, nacks, count * sizeof(uint16_t));
+                CQNackSimulationHeapPush(&heap, (CQNackSimulationEvent){arrival, YES, (uint32_t)poolCount, (uint32_t)count});
+                poolCount += count;
+            }
+            nextCollect += kCollectIntervalUs;
+        }
+        while (heap.count > 0 && heap.events[0].timeUs <= now) {
+            CQNackSimulationEvent event = CQNackSimulationHeapPop(&heap);
+            if (!event.isNack) {
+                CQNackTrackerOnPacket(tracker, (uint16_t)event.index, event.timeUs, NO);
+                if (firstArrival[event.index] == 0) firstArrival[event.index] = event.timeUs;
+                continue;
+            }
+            for (uint32_t i = 0; i < event.count; i++) {
+                uint32_t index = pool[event.index + i];
+                if (index >= packetCount || retransmissions[index] >= config->maxRetransmissions) continue;
+                if (retransmissions[index] > 0 && event.timeUs - lastRetransmitUs[index] < kMinRetransmissionIntervalUs) continue;
+                retransmissions[index]++;
+                lastRetransmitUs[index] = event.timeUs;
+                result.retransmittedCount++;
+                uint64_t arrival = CQImpairedChannelSend(forward, event.timeUs);
+                if (arrival > 0) CQNackSimulationHeapPush(&heap, (CQNackSimulationEvent){arrival, NO, index, 0});
+            }
+        }
+        uint64_t next = nextCollect;
+        if (frameIndex < frameCount) next = MIN(next, nextFrame);
+        if (heap.count > 0) next = MIN(next, heap.events[0].timeUs);
+        now = MAX(next, now + 1);
+    }
+
+    // 帧的截止时间: 发送时间 + 单向时延 + 播放截止时长
+    uint64_t completeWithout = 0, completeWith = 0;
+    for (uint64_t f = 0; f < frameCount; f++) {
+        uint64_t deadline = f * frameIntervalUs + config->delayUs + config->trackerConfig.playoutDeadlineUs;
+        BOOL isCompleteWithout = YES, isCompleteWith = YES;
+        for (uint32_t k = 0; k < config->packetsPerFrame; k++) {
+            size_t index = (size_t)(f * config->packetsPerFrame + k);
+            if (originalArrival[index] == 0 || originalArrival[index] > deadline) isCompleteWithout = NO;
+            if (firstArrival[index] == 0 || firstArrival[index] > deadline) isCompleteWith = NO;
+        }
+        completeWithout += isCompleteWithout;
+        completeWith += isCompleteWith;
+    }
+    result.completeWithoutNack = (double)completeWithout / (double)frameCount;
+    result.completeWithNack = (double)completeWith / (double)frameCount;
+    result.abandonedCount = CQNackTrackerAbandonedCount(tracker);
+    result.rttEstimateUs = CQNackTrackerRtt(tracker);
+
+    free(heap.events);
+    free(pool);
+    free(lastRetransmitUs);
+    free(retransmissions);
+    free(firstArrival);
+    free(originalArrival);
+    CQNackTrackerDestroy(tracker);
+    CQImpairedChannelDestroy(backward);
+    CQImpairedChannelDestroy(forward);
+    return result;
+}
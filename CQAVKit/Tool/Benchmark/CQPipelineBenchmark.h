@@ -0,0 +1,64 @@
+//
+//  CQPipelineBenchmark.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 管线回放基准测试
+ @discussion 不经过采集和编解码，把录好的.h264/.aac文件按编码器回调的形式逐帧送入管线:
+ 读取(CQRawStreamReader) -> 分帧(拆NALU) -> RTP分包 -> RTP解包(重排) -> TS封装 -> 回放缓存
+ 记录每个环节每帧的耗时分位数、总吞吐、内存峰值和malloc变化，报告可以直接转成JSON，用于对比不同版本/设备
+ TS封装是异步的，tsMux只统计入队耗时，封装队列处理完所有帧的时间单独记为tsMuxDrainMs
+ 同步运行，不要在主线程调用
+ */
+@interface CQPipelineBenchmark : NSObject
+
+/**
+ 唯一初始化函数
+ @param videoPath H264文件(Annex-B)，为nil时只测音频
+ @param audioPath AAC文件(ADTS)，为nil时只测视频
+ @param frameRate 视频帧率，用于计算时间戳
+ */
+- (instancetype)initWithVideoPath:(nullable NSString *)videoPath audioPath:(nullable NSString *)audioPath frameRate:(NSInteger)frameRate;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly, nullable) NSString *videoPath;  ///< H264文件
+@property (nonatomic, copy, readonly, nullable) NSString *audioPath;  ///< AAC文件
+@property (nonatomic, assign, readonly) NSInteger frameRate;  ///< 视频帧率
+
+@property (nonatomic, assign) BOOL isRealTime;  ///< 是否按实际时间送帧(模拟直播)，默认NO尽可能快
+@property (nonatomic, copy, nullable) NSString *name;  ///< 报告中的名称，默认为文件名
+
+/**
+ 运行一次
+ @param error 文件打开失败时的错误信息
+ @return 报告
+ */
+- (nullable NSDictionary<NSString *, id> *)runWithError:(NSError * _Nullable *)error;
+
+/**
+ 运行参考码流集合
+ @discussion 在directory中生成合成参考码流(已存在时复用)，依次运行，
+ 另外Library下有测试页录制的TestVideoCoder4.h264/TestAudioCoder0.aac时也一起运行，
+ 所有报告写入directory/pipeline_benchmark.json
+ @param directory 码流和报告的目录
+ @param completionHandler 完成后在后台队列回调
+ */
++ (void)runReferenceSuiteInDirectory:(NSString *)directory completionHandler:(nullable void (^)(NSArray<NSDictionary *> *reports, NSString * _Nullable reportPath))completionHandler;
+
+/**
+ 报告转JSON(带缩进，key排序，方便diff)
+ */
++ (nullable NSData *)JSONDataWithReport:(id)report;
+
+@end
+
+NS_ASSUME_NONNULL_END
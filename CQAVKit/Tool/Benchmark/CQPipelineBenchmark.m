@@ -0,0 +1,329 @@
+//
+//  CQPipelineBenchmark.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 用CQRawStreamReader映射文件(索引在计时前建好)，音视频按时间戳交织，模拟编码器的回调顺序
+ 2 每一帧依次经过各个环节，每个环节单独计时，记入对应的CQLatencyRecorder
+ 3 实时模式下按帧的时间戳等待，否则尽可能快
+ 4 每隔一段采样一次内存占用，结束时和开始时的malloc统计做差
+ */
+
+#import "CQPipelineBenchmark.h"
+#import <mach/mach_time.h>
+#import "CQBenchmarkUtil.h"
+#import "CQBenchmarkStreamGenerator.h"
+#import "CQRawStreamReader.h"
+#import "CQNaluUtil.h"
+#import "CQRTPPacketizer.h"
+#import "CQRTPDepacketizer.h"
+#import "CQTSMuxer.h"
+#import "CQReplayBuffer.h"
+
+static const NSUInteger kMemorySampleInterval = 32;  ///< 每隔多少帧采样一次内存
+
+@interface CQPipelineBenchmark ()<CQTSMuxerDelegate, CQRTPDepacketizerDelegate>
+@property (nonatomic, strong) NSDictionary<NSString *, CQLatencyRecorder *> *recorders;  ///< 各环节的耗时
+@property (nonatomic, assign) uint64_t tsOutputBytes;  ///< TS输出字节数(封装队列)
+@property (nonatomic, assign) NSUInteger depacketizedFrameCount;  ///< RTP解包输出的帧数
+@end
+
+@implementation CQPipelineBenchmark
+
+#pragma mark - Init
+- (instancetype)initWithVideoPath:(NSString *)videoPath audioPath:(NSString *)audioPath frameRate:(NSInteger)frameRate {
+    if (self = [super init]) {
+        _videoPath = [videoPath copy];
+        _audioPath = [audioPath copy];
+        _frameRate = frameRate;
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (NSDictionary<NSString *, id> *)runWithError:(NSError **)error {
+    CQRawStreamReader *videoReader = nil;
+    CQRawStreamReader *audioReader = nil;
+    if (self.videoPath) {
+        videoReader = [[CQRawStreamReader alloc] initWithPath:self.videoPath frameRate:self.frameRate error:error];
+        if (!videoReader) return nil;
+    }
+    if (self.audioPath) {
+        audioReader = [[CQRawStreamReader alloc] initWithPath:self.audioPath frameRate:self.frameRate error:error];
+        if (!audioReader) return nil;
+    }
+
+    CQVideoCoderConfig *videoConfig = nil;
+    CQAudioCoderConfig *audioConfig = nil;
+    if (videoReader) {
+        videoConfig = [CQVideoCoderConfig defaultConifg];
+        videoConfig.fps = self.frameRate;
+    }
+    if (audioReader) {
+        audioConfig = [CQAudioCoderConfig defaultConifg];
+        audioConfig.sampleRate = audioReader.sampleRate;
+        audioConfig.channelCount = audioReader.channelCount;
+    }
+
+    NSMutableDictionary *recorders = [NSMutableDictionary dictionary];
+    for (NSString *name in @[@"read", @"frame", @"rtpPacketize", @"rtpDepacketize", @"tsMux", @"replayBuffer", @"total"]) {
+        recorders[name] = [[CQLatencyRecorder alloc] initWithName:name];
+    }
+    self.recorders = recorders;
+    self.tsOutputBytes = 0;
+    self.depacketizedFrameCount = 0;
+
+    CQRTPPacketizer *videoPacketizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:0x1234];
+    CQRTPPacketizer *audioPacketizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatAAC payloadType:97 clockRate:(uint32_t)audioConfig.sampleRate ssrc:0x5678];
+    CQRTPDepacketizer *videoDepacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    CQRTPDepacketizer *audioDepacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatAAC];
+    videoDepacketizer.delegate = self;
+    audioDepacketizer.delegate = self;
+    CQTSMuxer *tsMuxer = [[CQTSMuxer alloc] initWithVideoConfig:videoConfig audioConfig:audioConfig];
+    tsMuxer.delegate = self;
+    CQReplayBuffer *replayBuffer = [[CQReplayBuffer alloc] initWithMaxBytes:64 * 1024 * 1024 maxDuration:30 videoConfig:videoConfig audioConfig:audioConfig];
+
+    CQBenchmarkMallocStats startMallocStats = CQBenchmarkMallocStatistics();
+    uint64_t startFootprint = CQBenchmarkMemoryFootprint();
+    uint64_t peakFootprint = startFootprint;
+    uint64_t inputBytes = 0;
+    NSUInteger processedCount = 0;
+    NSUInteger videoIndex = 0, audioIndex = 0;
+    uint64_t startNanos = CQBenchmarkNowNanos();
+    uint64_t startMachTime = mach_absolute_time();
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+
+    while (videoIndex < videoReader.frameCount || audioIndex < audioReader.frameCount) {
+        // 按时间戳交织
+        BOOL isVideo = audioIndex >= audioReader.frameCount ||
+            (videoIndex < videoReader.frameCount && CMTimeCompare([videoReader timeAtIndex:videoIndex], [audioReader timeAtIndex:audioIndex]) <= 0);
+        CQRawStreamReader *reader = isVideo ? videoReader : audioReader;
+        NSUInteger index = isVideo ? videoIndex++ : audioIndex++;
+        CMTime pts = [reader timeAtIndex:index];
+        if (self.isRealTime) {
+            uint64_t offsetNanos = (uint64_t)(CMTimeGetSeconds(pts) * NSEC_PER_SEC);
+            mach_wait_until(startMachTime + offsetNanos * timebase.denom / timebase.numer);
+        }
+
+        uint64_t frameStart = CQBenchmarkNowNanos();
+        uint64_t stageStart = frameStart;
+        NSData *frameData = [reader frameDataAtIndex:index];
+        [recorders[@"read"] addSinceNanos:stageStart];
+        inputBytes += frameData.length;
+
+        if (isVideo) {
+            stageStart = CQBenchmarkNowNanos();
+            NSData *sps = nil, *pps = nil;
+            NSArray<NSData *> *nalus = [self nalusOfFrame:frameData sps:&sps pps:&pps];
+            [recorders[@"frame"] addSinceNanos:stageStart];
+            if (sps && pps) {
+                [tsMuxer setSps:sps pps:pps];
+                [replayBuffer setSps:sps pps:pps];
+            }
+            BOOL isKeyFrame = [videoReader isKeyFrameAtIndex:index];
+
+            stageStart = CQBenchmarkNowNanos();
+            NSArray<CQRTPPacket *> *packets = [videoPacketizer packetizeH264Nalus:nalus pts:pts];
+            [recorders[@"rtpPacketize"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            for (CQRTPPacket *packet in packets) {
+                [videoDepacketizer receivePacketData:packet.serializedData];
+            }
+            [recorders[@"rtpDepacketize"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            [tsMuxer muxVideoNalus:nalus pts:pts dts:pts isKeyFrame:isKeyFrame];
+            [recorders[@"tsMux"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            [replayBuffer appendVideoNalus:nalus pts:pts dts:pts isKeyFrame:isKeyFrame];
+            [recorders[@"replayBuffer"] addSinceNanos:stageStart];
+        } else {
+            stageStart = CQBenchmarkNowNanos();
+            NSArray<CQRTPPacket *> *packets = [audioPacketizer packetizeAACData:frameData pts:pts];
+            [recorders[@"rtpPacketize"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            for (CQRTPPacket *packet in packets) {
+                [audioDepacketizer receivePacketData:packet.serializedData];
+            }
+            [recorders[@"rtpDepacketize"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            [tsMuxer muxAudioData:frameData pts:pts];
+            [recorders[@"tsMux"] addSinceNanos:stageStart];
+
+            stageStart = CQBenchmarkNowNanos();
+            [replayBuffer appendAudioData:frameData pts:pts];
+            [recorders[@"replayBuffer"] addSinceNanos:stageStart];
+        }
+        [recorders[@"total"] addSinceNanos:frameStart];
+
+        if (++processedCount % kMemorySampleInterval == 0) {
+            peakFootprint = MAX(peakFootprint, CQBenchmarkMemoryFootprint());
+        }
+    }
+    uint64_t feedNanos = CQBenchmarkNowNanos() - startNanos;
+
+    // 等封装队列处理完
+    uint64_t drainStart = CQBenchmarkNowNanos();
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    [tsMuxer flushWithCompletionHandler:^{
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    uint64_t drainNanos = CQBenchmarkNowNanos() - drainStart;
+    [videoDepacketizer flush];
+    [audioDepacketizer flush];
+    peakFootprint = MAX(peakFootprint, CQBenchmarkMemoryFootprint());
+    CQBenchmarkMallocStats endMallocStats = CQBenchmarkMallocStatistics();
+
+    double wallSeconds = (feedNanos + drainNanos) / 1e9;
+    double mediaSeconds = MAX(videoReader ? CMTimeGetSeconds(videoReader.duration) : 0, audioReader ? CMTimeGetSeconds(audioReader.duration) : 0);
+    NSMutableDictionary *stages = [NSMutableDictionary dictionary];
+    [recorders enumerateKeysAndObjectsUsingBlock:^(NSString *name, CQLatencyRecorder *recorder, BOOL *stop) {
+        stages[name] = [recorder report];
+    }];
+    NSString *name = self.name ?: [[self.videoPath ?: self.audioPath lastPathComponent] stringByDeletingPathExtension];
+    return @{
+        @"name": name ?: @"",
+        @"realTime": @(self.isRealTime),
+        @"videoFrames": @(videoReader.frameCount),
+        @"audioFrames": @(audioReader.frameCount),
+        @"inputBytes": @(inputBytes),
+        @"mediaSeconds": @(mediaSeconds),
+        @"wallSeconds": @(wallSeconds),
+        @"speed": @(wallSeconds > 0 ? mediaSeconds / wallSeconds : 0),
+        @"throughputMBps": @(wallSeconds > 0 ? inputBytes / wallSeconds / (1024 * 1024) : 0),
+        @"framesPerSecond": @(wallSeconds > 0 ? processedCount / wallSeconds : 0),
+        @"tsMuxDrainMs": @(drainNanos / 1e6),
+        @"tsOutputBytes": @(self.tsOutputBytes),
+        @"depacketizedFrames": @(self.depacketizedFrameCount),
+        @"stages": stages,
+        @"memory": @{
+            @"startFootprintBytes": @(startFootprint),
+            @"peakFootprintBytes": @(peakFootprint),
+            @"peakFootprintDeltaBytes": @(peakFootprint - startFootprint),
+            @"peakResidentBytes": @(CQBenchmarkPeakResidentSize()),
+        },
+        @"malloc": @{
+            @"blocksInUseDelta": @((int64_t)endMallocStats.blocksInUse - (int64_t)startMallocStats.blocksInUse),
+            @"bytesInUseDelta": @((int64_t)endMallocStats.bytesInUse - (int64_t)startMallocStats.bytesInUse),
+        },
+    };
+}
+
++ (void)runReferenceSuiteInDirectory:(NSString *)directory completionHandler:(void (^)(NSArray<NSDictionary *> *, NSString *))completionHandler {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:nil];
+        NSMutableArray<CQPipelineBenchmark *> *benchmarks = [NSMutableArray array];
+
+        // 合成参考码流: 名称 时长 帧率 视频码率 音频采样率 音频码率
+        NSArray<NSArray *> *references = @[
+            @[@"synthetic_480p25", @60, @25, @(640 * 1000), @44100, @96000],
+            @[@"synthetic_720p30", @60, @30, @(2 * 1000 * 1000), @48000, @128000],
+            @[@"synthetic_1080p60", @60, @60, @(8 * 1000 * 1000), @48000, @128000],
+        ];
+        for (NSArray *reference in references) {
+            NSString *name = reference[0];
+            NSString *videoPath = [directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"h264"]];
+            NSString *audioPath = [directory stringByAppendingPathComponent:[name stringByAppendingPathExtension:@"aac"]];
+            NSError *error = nil;
+            if (![[NSFileManager defaultManager] fileExistsAtPath:videoPath] &&
+                ![CQBenchmarkStreamGenerator writeH264StreamToPath:videoPath duration:[reference[1] doubleValue] fps:[reference[2] integerValue] bitrate:[reference[3] integerValue] seed:1 error:&error]) {
+                NSLog(@"CQPipelineBenchmark generate %@ failed error=%@", videoPath, error);
+                continue;
+            }
+            if (![[NSFileManager defaultManager] fileExistsAtPath:audioPath] &&
+                ![CQBenchmarkStreamGenerator writeAACStreamToPath:audioPath duration:[reference[1] doubleValue] sampleRate:[reference[4] integerValue] channelCount:2 bitrate:[reference[5] integerValue] seed:2 error:&error]) {
+                NSLog(@"CQPipelineBenchmark generate %@ failed error=%@", audioPath, error);
+                continue;
+            }
+            CQPipelineBenchmark *benchmark = [[CQPipelineBenchmark alloc] initWithVideoPath:videoPath audioPath:audioPath frameRate:[reference[2] integerValue]];
+            benchmark.name = name;
+            [benchmarks addObject:benchmark];
+        }
+
+        // 测试页录制的真实码流
+        NSString *libraryPath = [NSHomeDirectory() stringByAppendingPathComponent:@"Library"];
+        NSString *recordedVideoPath = [libraryPath stringByAppendingPathComponent:@"TestVideoCoder4.h264"];
+        NSString *recordedAudioPath = [libraryPath stringByAppendingPathComponent:@"TestAudioCoder0.aac"];
+        BOOL hasRecordedVideo = [[NSFileManager defaultManager] fileExistsAtPath:recordedVideoPath];
+        BOOL hasRecordedAudio = [[NSFileManager defaultManager] fileExistsAtPath:recordedAudioPath];
+        if (hasRecordedVideo || hasRecordedAudio) {
+            CQPipelineBenchmark *benchmark = [[CQPipelineBenchmark alloc] initWithVideoPath:hasRecordedVideo ? recordedVideoPath : nil audioPath:hasRecordedAudio ? recordedAudioPath : nil frameRate:[CQVideoCoderConfig defaultConifg].fps];
+            benchmark.name = @"recorded";
+            [benchmarks addObject:benchmark];
+        }
+
+        NSMutableArray<NSDictionary *> *reports = [NSMutableArray array];
+        for (CQPipelineBenchmark *benchmark in benchmarks) {
+            NSError *error = nil;
+            NSDictionary *report = [benchmark runWithError:&error];
+            if (report) {
+                [reports addObject:report];
+            } else {
+                NSLog(@"CQPipelineBenchmark %@ failed error=%@", benchmark.name, error);
+            }
+        }
+        NSString *reportPath = [directory stringByAppendingPathComponent:@"pipeline_benchmark.json"];
+        NSData *jsonData = [self JSONDataWithReport:reports];
+        if (![jsonData writeToFile:reportPath atomically:YES]) reportPath = nil;
+        if (completionHandler) completionHandler(reports, reportPath);
+    });
+}
+
++ (NSData *)JSONDataWithReport:(id)report {
+    NSError *error = nil;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:&error];
+    if (!data) NSLog(@"CQPipelineBenchmark JSON failed error=%@", error);
+    return data;
+}
+
+#pragma mark - Private Func
+/// 拆出一帧的NALU(带起始码，和编码器回调的格式一致)，sps/pps单独取出
+- (NSArray<NSData *> *)nalusOfFrame:(NSData *)frameData sps:(NSData **)sps pps:(NSData **)pps {
+    NSMutableArray<NSData *> *nalus = [NSMutableArray array];
+    const uint8_t *bytes = frameData.bytes;
+    __block NSData *spsData = nil;
+    __block NSData *ppsData = nil;
+    CQNaluEnumerateAnnexB(bytes, frameData.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        size_t start = (size_t)(nalu - bytes) - 3;
+        if (start > 0 && bytes[start - 1] == 0x00) start--;
+        NSData *naluData = [frameData subdataWithRange:NSMakeRange(start, (size_t)(nalu - bytes) + naluSize - start)];
+        CQH264NaluType type = CQH264NaluTypeOf(nalu);
+        if (type == CQH264NaluTypeSPS) {
+            spsData = naluData;
+        } else if (type == CQH264NaluTypePPS) {
+            ppsData = naluData;
+        } else {
+            [nalus addObject:naluData];
+        }
+    }];
+    *sps = spsData;
+    *pps = ppsData;
+    return nalus;
+}
+
+#pragma mark - CQTSMuxerDelegate
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData {
+    // 封装队列回调，结束时flush完成后才读取
+    self.tsOutputBytes += tsData.length;
+}
+
+#pragma mark - CQRTPDepacketizerDelegate
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didOutputH264Nalus:(NSArray<NSData *> *)nalus timestamp:(uint32_t)timestamp {
+    self.depacketizedFrameCount++;
+}
+
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didOutputAACData:(NSData *)aacData timestamp:(uint32_t)timestamp {
+    self.depacketizedFrameCount++;
+}
+
+@end
@@ -0,0 +1,54 @@
+//
+//  CQLatencyHistogram.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 端到端延迟直方图
+ @discussion 直播过程中长时间统计，内存固定: 0~2秒每1毫秒一个桶，超过2秒计入最后一个桶(max单独记录)
+ 线程安全，可以在解码线程记录、在UI线程读取报告
+ 和CQLatencyRecorder(记录所有样本，用于基准测试)不同，这里只保留分布
+ */
+@interface CQLatencyHistogram : NSObject
+
+/**
+ 唯一初始化函数
+ @param name 名称(报告中的key)
+ */
+- (instancetype)initWithName:(NSString *)name;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *name;  ///< 名称
+@property (nonatomic, assign, readonly) uint64_t count;  ///< 样本数
+@property (nonatomic, assign, readonly) uint64_t negativeCount;  ///< 小于0的样本数(两端时钟没对齐)，按0统计
+
+/// 记录一个样本(微秒)，可以为负
+- (void)addMicros:(int64_t)micros;
+
+/**
+ 分位数
+ @param percentile 0~100
+ @return 毫秒(桶的上界)
+ */
+- (double)millisAtPercentile:(double)percentile;
+
+/**
+ 报告，时间单位为毫秒
+ @return count/negativeCount/meanMs/p50Ms/p90Ms/p99Ms/maxMs
+ */
+- (NSDictionary<NSString *, NSNumber *> *)report;
+
+/// 清空
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,109 @@
+//
+//  CQLatencyHistogram.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQLatencyHistogram.h"
+#import <os/lock.h>
+
+static const NSUInteger kBucketCount = 2001;  ///< 0~1999毫秒每毫秒一个桶，最后一个桶是>=2000毫秒
+
+@implementation CQLatencyHistogram
+{
+    os_unfair_lock _lock;
+    uint64_t _buckets[kBucketCount];
+    uint64_t _count;
+    uint64_t _negativeCount;
+    uint64_t _totalMicros;
+    uint64_t _maxMicros;
+}
+
+#pragma mark - Init
+- (instancetype)initWithName:(NSString *)name {
+    if (self = [super init]) {
+        _name = [name copy];
+        _lock = OS_UNFAIR_LOCK_INIT;
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (uint64_t)count {
+    os_unfair_lock_lock(&_lock);
+    uint64_t count = _count;
+    os_unfair_lock_unlock(&_lock);
+    return count;
+}
+
+- (uint64_t)negativeCount {
+    os_unfair_lock_lock(&_lock);
+    uint64_t negativeCount = _negativeCount;
+    os_unfair_lock_unlock(&_lock);
+    return negativeCount;
+}
+
+- (void)addMicros:(int64_t)micros {
+    BOOL isNegative = micros < 0;
+    uint64_t value = isNegative ? 0 : (uint64_t)micros;
+    NSUInteger bucket = (NSUInteger)MIN(value / 1000, (uint64_t)(kBucketCount - 1));
+    os_unfair_lock_lock(&_lock);
+    _buckets[bucket]++;
+    _count++;
+    if (isNegative) _negativeCount++;
+    _totalMicros += value;
+    _maxMicros = MAX(_maxMicros, value);
+    os_unfair_lock_unlock(&_lock);
+}
+
+- (double)millisAtPercentile:(double)percentile {
+    os_unfair_lock_lock(&_lock);
+    double millis = [self lockedMillisAtPercentile:percentile];
+    os_unfair_lock_unlock(&_lock);
+    return millis;
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)report {
+    os_unfair_lock_lock(&_lock);
+    NSDictionary *report = @{
+        @"count": @(_count),
+        @"negativeCount": @(_negativeCount),
+        @"meanMs": @(_count > 0 ? _totalMicros / 1000.0 / _count : 0),
+        @"p50Ms": @([self lockedMillisAtPercentile:50]),
+        @"p90Ms": @([self lockedMillisAtPercentile:90]),
+        @"p99Ms": @([self lockedMillisAtPercentile:99]),
+        @"maxMs": @(_maxMicros / 1000.0),
+    };
+    os_unfair_lock_unlock(&_lock);
+    return report;
+}
+
+- (void)reset {
+    os_unfair_lock_lock(&_lock);
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _negativeCount = 0;
+    _totalMicros = 0;
+    _maxMicros = 0;
+    os_unfair_lock_unlock(&_lock);
+}
+
+#pragma mark - Private Func
+/// 调用前需要加锁
+- (double)lockedMillisAtPercentile:(double)percentile {
+    if (_count == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(MIN(MAX(percentile, 0), 100) / 100.0 * _count);
+    rank = MAX(rank, (uint64_t)1);
+    uint64_t accumulated = 0;
+    for (NSUInteger i = 0; i < kBucketCount; i++) {
+        accumulated += _buckets[i];
+        if (accumulated >= rank) {
+            // 最后一个桶没有上界，用最大值
+            return i == kBucketCount - 1 ? _maxMicros / 1000.0 : MIN((double)(i + 1), _maxMicros / 1000.0);
+        }
+    }
+    return _maxMicros / 1000.0;
+}
+
+@end
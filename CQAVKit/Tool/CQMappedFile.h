@@ -0,0 +1,51 @@
+//
+//  CQMappedFile.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 只读内存映射文件
+ @discussion mmap映射整个文件，最后一个引用释放时解除映射
+ dataWithOffset:length:返回的NSData直接引用映射内存并持有映射对象，可以放心交给异步队列
+ */
+@interface CQMappedFile : NSObject
+
+/**
+ 唯一初始化函数
+ @param path 文件路径
+ @param error 错误信息，空文件为EINVAL
+ */
+- (nullable instancetype)initWithPath:(NSString *)path error:(NSError * _Nullable *)error;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *path;  ///< 文件路径
+@property (nonatomic, assign, readonly) const uint8_t *bytes;  ///< 映射的首地址
+@property (nonatomic, assign, readonly) uint64_t size;  ///< 文件大小
+@property (nonatomic, assign, readonly) struct timespec modifyTime;  ///< 打开时文件的修改时间
+
+/**
+ 引用映射内存中的一段数据，不拷贝
+ @return 越界返回nil
+ */
+- (nullable NSData *)dataWithOffset:(uint64_t)offset length:(NSUInteger)length;
+
+/// 之后基本是顺序读取，让系统积极预读
+- (void)adviseSequential;
+
+/**
+ 通知系统回收一段已经读过的页面，再次访问时会从文件重新读入
+ @discussion 只回收完整的页
+ */
+- (void)releasePagesFromOffset:(uint64_t)offset toOffset:(uint64_t)endOffset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,76 @@
+//
+//  CQMappedFile.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQMappedFile.h"
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+@implementation CQMappedFile
+
+#pragma mark - Init
+- (instancetype)initWithPath:(NSString *)path error:(NSError **)error {
+    if (self = [super init]) {
+        _path = [path copy];
+        int fd = open(path.fileSystemRepresentation, O_RDONLY);
+        if (fd < 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            return nil;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            close(fd);
+            return nil;
+        }
+        if (fileStat.st_size <= 0) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EINVAL userInfo:nil];
+            close(fd);
+            return nil;
+        }
+        _size = (uint64_t)fileStat.st_size;
+        _modifyTime = fileStat.st_mtimespec;
+        void *bytes = mmap(NULL, (size_t)_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // 映射建立后fd可以关闭
+        close(fd);
+        if (bytes == MAP_FAILED) {
+            if (error) *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            return nil;
+        }
+        _bytes = bytes;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_bytes) munmap((void *)_bytes, (size_t)_size);
+}
+
+#pragma mark - Public Func
+- (NSData *)dataWithOffset:(uint64_t)offset length:(NSUInteger)length {
+    if (offset > _size || length > _size - offset) return nil;
+    // NSData持有映射对象，数据在外面用完之前映射不会解除
+    CQMappedFile *mappedFile = self;
+    return [[NSData alloc] initWithBytesNoCopy:(void *)(_bytes + offset) length:length deallocator:^(void *bytes, NSUInteger length) {
+        (void)mappedFile;
+    }];
+}
+
+- (void)adviseSequential {
+    madvise((void *)_bytes, (size_t)_size, MADV_SEQUENTIAL);
+}
+
+- (void)releasePagesFromOffset:(uint64_t)offset toOffset:(uint64_t)endOffset {
+    uint64_t pageSize = (uint64_t)getpagesize();
+    uint64_t start = (offset + pageSize - 1) / pageSize * pageSize;
+    uint64_t end = MIN(endOffset, _size) / pageSize * pageSize;
+    if (end <= start) return;
+    madvise((void *)(_bytes + start), (size_t)(end - start), MADV_DONTNEED);
+}
+
+@end
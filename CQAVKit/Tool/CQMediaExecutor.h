@@ -0,0 +1,111 @@
+//
+//  CQMediaExecutor.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// 优先级通道，数值越小优先级越高
+typedef NS_ENUM(NSUInteger, CQMediaLane) {
+    CQMediaLaneAudio = 0,  ///< 实时音频，卡顿最明显，优先级最高
+    CQMediaLaneVideo = 1,  ///< 实时视频
+    CQMediaLaneBackground = 2,  ///< 后台任务(写文件、保存、建索引)
+};
+
+@class CQMediaExecutor;
+
+/**
+ 串行执行单元
+ @discussion 同一个strand上的任务按提交顺序串行执行，不同strand之间并行，
+ 替代每个对象自己创建的串行队列，一个strand不占用线程，没有任务时没有开销
+ */
+@interface CQMediaStrand : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly) CQMediaExecutor *executor;  ///< 所属执行器
+@property (nonatomic, assign, readonly) CQMediaLane lane;  ///< 优先级通道
+@property (nonatomic, copy, readonly) NSString *label;  ///< 名称，调试用
+
+/// 当前线程是否正在执行该strand的任务
+@property (nonatomic, assign, readonly) BOOL isCurrent;
+
+/// 异步执行
+- (void)async:(dispatch_block_t)block;
+
+/**
+ 批量异步执行
+ @discussion 一次加锁、最多一次唤醒，按数组顺序执行，一帧产生多个回调时使用
+ */
+- (void)asyncBatch:(NSArray<dispatch_block_t> *)blocks;
+
+/**
+ 已经在该strand上时直接执行，否则异步执行
+ @discussion 编码/解码结果在同一个strand上回调时使用，省掉一次排队
+ */
+- (void)performOrAsync:(dispatch_block_t)block;
+
+/**
+ 延迟异步执行
+ @discussion 到期后和async一样排到strand末尾，不能取消，需要取消时在block里检查状态
+ @param delay 延迟(秒)
+ */
+- (void)asyncAfter:(NSTimeInterval)delay block:(dispatch_block_t)block;
+
+/**
+ 同步执行，返回时block已经执行完
+ @discussion 已经在该strand上时直接执行，用于读取只在strand上修改的状态(统计快照)；
+ 不要在另一个strand的任务里同步等待，所有工作线程都在等待时会死锁
+ */
+- (void)sync:(dispatch_block_t)block;
+
+@end
+
+/**
+ 共享的媒体任务执行器
+ @discussion 每个通道有自己的工作槽位，工作线程取自GCD全局线程池并强制使用通道的QoS，只执行本通道的strand，
+ 音频不会排在后台任务的线程上，通道间的优先级由系统按QoS调度
+ 工作线程各自有strand队列(work-stealing): 先取自己的，再取通道的注入队列(其它线程提交的)，都为空时从同通道其它工作线程的队列尾部偷，
+ 每次取到strand后执行它当前积压的全部任务，还有新任务就放回自己的队列尾部，队列里的strand轮流执行
+ */
+@interface CQMediaExecutor : NSObject
+
+/// 共享执行器，每个通道的工作槽位数为CPU核数
++ (instancetype)sharedExecutor;
+
+/**
+ 唯一初始化函数
+ @param maxConcurrency 每个通道同时执行的工作线程数上限，0为CPU核数
+ */
+- (instancetype)initWithMaxConcurrency:(NSUInteger)maxConcurrency;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) NSUInteger maxConcurrency;  ///< 每个通道的工作线程数上限
+
+/**
+ 创建strand
+ @param lane 优先级通道
+ @param label 名称
+ */
+- (CQMediaStrand *)strandWithLane:(CQMediaLane)lane label:(NSString *)label;
+
+// 统计，用于对比排队和线程切换的次数
+@property (nonatomic, assign, readonly) uint64_t submittedCount;  ///< 提交的任务数
+@property (nonatomic, assign, readonly) uint64_t wakeupCount;  ///< 唤醒工作线程的次数(提交到GCD的次数)
+@property (nonatomic, assign, readonly) uint64_t turnCount;  ///< strand被取出执行的次数
+@property (nonatomic, assign, readonly) uint64_t stealCount;  ///< 从其它工作线程队列偷到strand的次数
+
+/// 通道的工作线程使用的QoS
++ (qos_class_t)qosClassForLane:(CQMediaLane)lane;
+
+@end
+
+NS_ASSUME_NONNULL_END
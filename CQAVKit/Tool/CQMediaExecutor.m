@@ -0,0 +1,372 @@
+//
+//  CQMediaExecutor.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 strand内部是待执行任务数组+scheduled标记，提交任务时只有从空闲变为待执行才交给执行器，重复提交不会重复唤醒
+ 2 每个通道: 注入队列(非本通道工作线程提交的strand) + maxConcurrency个工作槽位，每个槽位一个strand队列，
+   活跃工作线程数小于上限时才向GCD全局队列提交一个工作函数(强制通道的QoS)，否则由已有的工作线程取走
+ 3 本通道的工作线程提交的strand(例如编码strand的任务唤起回调strand)放进自己的队列尾部，不加通道锁；
+   在任务执行中提交时当前线程还要执行完本轮任务，有空闲槽位就唤醒一个来偷；一轮结束放回的自己马上会取，积压超过一个才唤醒
+ 4 工作线程循环: 自己队列的头部 -> 注入队列 -> 从其它槽位的队列尾部偷，一次执行完strand积压的任务，
+   还有新任务就放回自己的队列尾部；都为空时在通道锁里再确认一次注入队列再退出，和提交方的唤醒判断互斥，不会丢任务
+ 5 一个strand同一时刻只在一个队列位置/工作线程上，所以任务串行执行，不需要额外的锁
+ */
+
+#import "CQMediaExecutor.h"
+#import <os/lock.h>
+#import <stdatomic.h>
+
+#define kLaneCount (CQMediaLaneBackground + 1)  ///< 通道数
+
+/// 正在执行任务的strand
+static __thread void *tCurrentStrand = NULL;
+/// 当前线程所在的工作槽位
+static __thread void *tCurrentWorker = NULL;
+
+@class CQMediaWorker;
+
+@interface CQMediaExecutor ()
+/// 交给执行器，allowsLocal为YES时本通道的工作线程提交的放进自己的队列
+- (void)scheduleStrand:(CQMediaStrand *)strand allowsLocal:(BOOL)allowsLocal;
+- (void)didSubmitTaskCount:(NSUInteger)count;
+@end
+
+@interface CQMediaStrand ()
+- (instancetype)initWithExecutor:(CQMediaExecutor *)executor lane:(CQMediaLane)lane label:(NSString *)label;
+/// 执行积压的任务，返回执行期间是否又有新任务
+- (BOOL)runPendingTasks;
+@end
+
+/// 工作槽位: 自己的strand队列，头部自己取，尾部给其它工作线程偷
+@interface CQMediaWorker : NSObject
+{
+@public
+    os_unfair_lock _lock;
+    NSMutableArray<CQMediaStrand *> *_strands;  ///< 加_lock访问
+    CQMediaLane _lane;
+    BOOL _isActive;  ///< 加通道锁访问
+}
+@property (nonatomic, weak) CQMediaExecutor *executor;
+@end
+
+@implementation CQMediaWorker
+@end
+
+/// 通道: 注入队列和工作槽位
+@interface CQMediaLaneState : NSObject
+{
+@public
+    os_unfair_lock _lock;
+    NSMutableArray<CQMediaStrand *> *_injectedStrands;  ///< 加_lock访问
+    NSArray<CQMediaWorker *> *_workers;
+    NSUInteger _activeWorkerCount;  ///< 加_lock访问
+    _Atomic(NSUInteger) _nextVictim;  ///< 偷的起点，轮流选
+}
+@end
+
+@implementation CQMediaLaneState
+@end
+
+@implementation CQMediaStrand
+{
+    os_unfair_lock _lock;
+    NSMutableArray<dispatch_block_t> *_pendingTasks;  ///< 待执行，加锁访问
+    NSMutableArray<dispatch_block_t> *_runningTasks;  ///< 执行中，只在工作线程访问
+    BOOL _isScheduled;  ///< 在队列中或正在执行
+}
+
+#pragma mark - Init
+- (instancetype)initWithExecutor:(CQMediaExecutor *)executor lane:(CQMediaLane)lane label:(NSString *)label {
+    if (self = [super init]) {
+        _executor = executor;
+        _lane = MIN(lane, kLaneCount - 1);
+        _label = [label copy];
+        _lock = OS_UNFAIR_LOCK_INIT;
+        _pendingTasks = [NSMutableArray array];
+        _runningTasks = [NSMutableArray array];
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (BOOL)isCurrent {
+    return tCurrentStrand == (__bridge void *)self;
+}
+
+- (void)async:(dispatch_block_t)block {
+    [self enqueueTasks:@[block] allowsLocal:YES];
+}
+
+- (void)asyncBatch:(NSArray<dispatch_block_t> *)blocks {
+    [self enqueueTasks:blocks allowsLocal:YES];
+}
+
+- (void)performOrAsync:(dispatch_block_t)block {
+    if (self.isCurrent) {
+        block();
+    } else {
+        [self async:block];
+    }
+}
+
+- (void)asyncAfter:(NSTimeInterval)delay block:(dispatch_block_t)block {
+    // 到期后才进入strand，等待期间不占用strand和工作线程
+    dispatch_block_t copiedBlock = [block copy];
+    dispatch_queue_t queue = dispatch_get_global_queue([CQMediaExecutor qosClassForLane:self.lane], 0);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX(delay, 0) * NSEC_PER_SEC)), queue, ^{
+        [self async:copiedBlock];
+    });
+}
+
+- (void)sync:(dispatch_block_t)block {
+    if (self.isCurrent) {
+        block();
+        return;
+    }
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    // 放进通道的注入队列，调用方是工作线程时也不会排在自己的队列里等自己
+    [self enqueueTasks:@[^{
+        block();
+        dispatch_semaphore_signal(semaphore);
+    }] allowsLocal:NO];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+}
+
+#pragma mark - Private Func
+- (void)enqueueTasks:(NSArray<dispatch_block_t> *)blocks allowsLocal:(BOOL)allowsLocal {
+    if (blocks.count == 0) return;
+    os_unfair_lock_lock(&_lock);
+    for (dispatch_block_t block in blocks) {
+        [_pendingTasks addObject:[block copy]];
+    }
+    BOOL needsSchedule = !_isScheduled;
+    _isScheduled = YES;
+    os_unfair_lock_unlock(&_lock);
+    [_executor didSubmitTaskCount:blocks.count];
+    if (needsSchedule) [_executor scheduleStrand:self allowsLocal:allowsLocal];
+}
+
+- (BOOL)runPendingTasks {
+    os_unfair_lock_lock(&_lock);
+    NSMutableArray<dispatch_block_t> *tasks = _pendingTasks;
+    _pendingTasks = _runningTasks;
+    _runningTasks = tasks;
+    os_unfair_lock_unlock(&_lock);
+
+    void *previousStrand = tCurrentStrand;
+    tCurrentStrand = (__bridge void *)self;
+    for (dispatch_block_t block in tasks) {
+        block();
+    }
+    tCurrentStrand = previousStrand;
+    [tasks removeAllObjects];
+
+    os_unfair_lock_lock(&_lock);
+    BOOL hasMoreTasks = _pendingTasks.count > 0;
+    if (!hasMoreTasks) _isScheduled = NO;
+    os_unfair_lock_unlock(&_lock);
+    return hasMoreTasks;
+}
+
+@end
+
+@implementation CQMediaExecutor
+{
+    CQMediaLaneState *_lanes[kLaneCount];
+    _Atomic(uint64_t) _submittedCount;
+    _Atomic(uint64_t) _wakeupCount;
+    _Atomic(uint64_t) _turnCount;
+    _Atomic(uint64_t) _stealCount;
+}
+
+#pragma mark - Init
++ (instancetype)sharedExecutor {
+    static CQMediaExecutor *executor;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        executor = [[CQMediaExecutor alloc] initWithMaxConcurrency:0];
+    });
+    return executor;
+}
+
+- (instancetype)initWithMaxConcurrency:(NSUInteger)maxConcurrency {
+    if (self = [super init]) {
+        _maxConcurrency = maxConcurrency > 0 ? maxConcurrency : [NSProcessInfo processInfo].activeProcessorCount;
+        for (NSUInteger i = 0; i < kLaneCount; i++) {
+            CQMediaLaneState *lane = [[CQMediaLaneState alloc] init];
+            lane->_lock = OS_UNFAIR_LOCK_INIT;
+            lane->_injectedStrands = [NSMutableArray array];
+            NSMutableArray<CQMediaWorker *> *workers = [NSMutableArray arrayWithCapacity:_maxConcurrency];
+            for (NSUInteger j = 0; j < _maxConcurrency; j++) {
+                CQMediaWorker *worker = [[CQMediaWorker alloc] init];
+                worker->_lock = OS_UNFAIR_LOCK_INIT;
+                worker->_strands = [NSMutableArray array];
+                worker->_lane = i;
+                worker.executor = self;
+                [workers addObject:worker];
+            }
+            lane->_workers = workers;
+            atomic_init(&lane->_nextVictim, 0);
+            _lanes[i] = lane;
+        }
+        atomic_init(&_submittedCount, 0);
+        atomic_init(&_wakeupCount, 0);
+        atomic_init(&_turnCount, 0);
+        atomic_init(&_stealCount, 0);
+    }
+    return self;
+}
+
+#pragma mark - Public Func
+- (CQMediaStrand *)strandWithLane:(CQMediaLane)lane label:(NSString *)label {
+    return [[CQMediaStrand alloc] initWithExecutor:self lane:lane label:label];
+}
+
+- (uint64_t)submittedCount {
+    return atomic_load_explicit(&_submittedCount, memory_order_relaxed);
+}
+
+- (uint64_t)wakeupCount {
+    return atomic_load_explicit(&_wakeupCount, memory_order_relaxed);
+}
+
+- (uint64_t)turnCount {
+    return atomic_load_explicit(&_turnCount, memory_order_relaxed);
+}
+
+- (uint64_t)stealCount {
+    return atomic_load_explicit(&_stealCount, memory_order_relaxed);
+}
+
++ (qos_class_t)qosClassForLane:(CQMediaLane)lane {
+    switch (lane) {
+        case CQMediaLaneAudio:
+            return QOS_CLASS_USER_INTERACTIVE;
+        case CQMediaLaneVideo:
+            return QOS_CLASS_USER_INITIATED;
+        default:
+            return QOS_CLASS_UTILITY;
+    }
+}
+
+#pragma mark - Private Func
+- (void)didSubmitTaskCount:(NSUInteger)count {
+    atomic_fetch_add_explicit(&_submittedCount, count, memory_order_relaxed);
+}
+
+- (void)scheduleStrand:(CQMediaStrand *)strand allowsLocal:(BOOL)allowsLocal {
+    CQMediaLaneState *lane = _lanes[strand.lane];
+    CQMediaWorker *worker = (__bridge CQMediaWorker *)tCurrentWorker;
+    if (allowsLocal && worker && worker.executor == self && worker->_lane == strand.lane) {
+        os_unfair_lock_lock(&worker->_lock);
+        [worker->_strands addObject:strand];
+        NSUInteger backlog = worker->_strands.count;
+        os_unfair_lock_unlock(&worker->_lock);
+        // 在任务里提交(例如编码strand唤起回调strand)时本线程还在忙，不能等它执行完本轮才处理
+        if (tCurrentStrand != NULL || backlog > 1) [self wakeWorkerInLane:lane];
+        return;
+    }
+    os_unfair_lock_lock(&lane->_lock);
+    [lane->_injectedStrands addObject:strand];
+    os_unfair_lock_unlock(&lane->_lock);
+    [self wakeWorkerInLane:lane];
+}
+
+/// 有空闲槽位时唤醒一个工作线程
+- (void)wakeWorkerInLane:(CQMediaLaneState *)lane {
+    CQMediaWorker *idleWorker = nil;
+    os_unfair_lock_lock(&lane->_lock);
+    if (lane->_activeWorkerCount < _maxConcurrency) {
+        for (CQMediaWorker *worker in lane->_workers) {
+            if (!worker->_isActive) {
+                idleWorker = worker;
+                break;
+            }
+        }
+        if (idleWorker) {
+            idleWorker->_isActive = YES;
+            lane->_activeWorkerCount++;
+        }
+    }
+    os_unfair_lock_unlock(&lane->_lock);
+    if (!idleWorker) return;
+
+    atomic_fetch_add_explicit(&_wakeupCount, 1, memory_order_relaxed);
+    qos_class_t qosClass = [CQMediaExecutor qosClassForLane:idleWorker->_lane];
+    // 强制通道的QoS，不继承提交线程的QoS；block持有执行器，执行器可以在工作线程退出前释放
+    dispatch_block_t block = dispatch_block_create_with_qos_class(DISPATCH_BLOCK_ENFORCE_QOS_CLASS, qosClass, 0, ^{
+        [self runWorker:idleWorker];
+    });
+    dispatch_async(dispatch_get_global_queue(qosClass, 0), block);
+}
+
+/// 工作线程循环，取不到strand时退出
+- (void)runWorker:(CQMediaWorker *)worker {
+    CQMediaLaneState *lane = _lanes[worker->_lane];
+    void *previousWorker = tCurrentWorker;
+    tCurrentWorker = (__bridge void *)worker;
+    while (YES) {
+        CQMediaStrand *strand = [self popStrandOfWorker:worker];
+        if (!strand) strand = [self popInjectedStrandInLane:lane retiringWorker:nil];
+        if (!strand) strand = [self stealStrandForWorker:worker inLane:lane];
+        // 退出前在通道锁里再确认一次注入队列
+        if (!strand) strand = [self popInjectedStrandInLane:lane retiringWorker:worker];
+        if (!strand) break;
+
+        atomic_fetch_add_explicit(&_turnCount, 1, memory_order_relaxed);
+        @autoreleasepool {
+            if ([strand runPendingTasks]) {
+                [self scheduleStrand:strand allowsLocal:YES];
+            }
+        }
+    }
+    tCurrentWorker = previousWorker;
+}
+
+- (CQMediaStrand *)popStrandOfWorker:(CQMediaWorker *)worker {
+    os_unfair_lock_lock(&worker->_lock);
+    CQMediaStrand *strand = worker->_strands.firstObject;
+    if (strand) [worker->_strands removeObjectAtIndex:0];
+    os_unfair_lock_unlock(&worker->_lock);
+    return strand;
+}
+
+/// 取注入队列的头部，retiringWorker不为nil时取不到就让该槽位退出
+- (CQMediaStrand *)popInjectedStrandInLane:(CQMediaLaneState *)lane retiringWorker:(CQMediaWorker *)retiringWorker {
+    os_unfair_lock_lock(&lane->_lock);
+    CQMediaStrand *strand = lane->_injectedStrands.firstObject;
+    if (strand) {
+        [lane->_injectedStrands removeObjectAtIndex:0];
+    } else if (retiringWorker) {
+        retiringWorker->_isActive = NO;
+        lane->_activeWorkerCount--;
+    }
+    os_unfair_lock_unlock(&lane->_lock);
+    return strand;
+}
+
+/// 从同通道其它槽位的队列尾部偷一个，起点轮流选，避免都去偷同一个
+- (CQMediaStrand *)stealStrandForWorker:(CQMediaWorker *)worker inLane:(CQMediaLaneState *)lane {
+    NSUInteger count = lane->_workers.count;
+    NSUInteger start = atomic_fetch_add_explicit(&lane->_nextVictim, 1, memory_order_relaxed);
+    for (NSUInteger i = 0; i < count; i++) {
+        CQMediaWorker *victim = lane->_workers[(start + i) % count];
+        if (victim == worker) continue;
+        os_unfair_lock_lock(&victim->_lock);
+        CQMediaStrand *strand = victim->_strands.lastObject;
+        if (strand) [victim->_strands removeLastObject];
+        os_unfair_lock_unlock(&victim->_lock);
+        if (strand) {
+            atomic_fetch_add_explicit(&_stealCount, 1, memory_order_relaxed);
+            return strand;
+        }
+    }
+    return nil;
+}
+
+@end
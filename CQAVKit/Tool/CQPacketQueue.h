@@ -0,0 +1,105 @@
+//
+//  CQPacketQueue.h
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ 阶段之间传递数据包的无锁队列
+ @discussion 替代每个包一次dispatch_async(每次都要分配block、可能唤醒线程)，生产者只做原子操作，
+ 消费者可以一次批量取出，也可以先自旋再挂起等待(spinCount)，适合延迟敏感的阶段
+ 三种队列:
+ CQSPSCQueue 单生产者单消费者环形队列，例如采集->编码、解码->渲染
+ CQMPSCQueue 多生产者单消费者有界队列，例如多路编码输出->写文件/发送
+ CQMailbox   只保留最新值，例如渲染只需要最新一帧，旧帧直接丢弃
+ */
+
+/// 单生产者单消费者有界环形队列，push只能在同一个线程(或同一个串行队列)调用，pop同理
+@interface CQSPSCQueue<ObjectType> : NSObject
+
+/**
+ 唯一初始化函数
+ @param capacity 容量，向上取整为2的幂
+ @return 分配环形缓冲失败返回nil
+ */
+- (nullable instancetype)initWithCapacity:(NSUInteger)capacity;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) NSUInteger capacity;  ///< 容量
+@property (nonatomic, assign, readonly) NSUInteger count;  ///< 当前个数(近似值)
+@property (nonatomic, assign) NSUInteger spinCount;  ///< 等待时先自旋检查的次数，默认0(直接挂起)
+
+/// 放入，队列满返回NO(不会阻塞)
+- (BOOL)push:(ObjectType)object;
+/// 取出，队列空返回nil
+- (nullable ObjectType)pop;
+/**
+ 批量取出
+ @param maxCount 最多取几个
+ @param block 按放入顺序回调
+ @return 取出的个数
+ */
+- (NSUInteger)popBatchWithMaxCount:(NSUInteger)maxCount usingBlock:(void (NS_NOESCAPE ^)(ObjectType object))block;
+/**
+ 等待队列非空(只能由消费者调用)
+ @param timeout 超时(秒)，小于0为一直等待
+ @return 队列是否非空
+ */
+- (BOOL)waitForObjectsWithTimeout:(NSTimeInterval)timeout;
+
+@end
+
+/// 多生产者单消费者有界队列，任意线程push，pop只能在同一个线程(或同一个串行队列)调用
+@interface CQMPSCQueue<ObjectType> : NSObject
+
+/**
+ 唯一初始化函数
+ @param capacity 容量，向上取整为2的幂
+ @return 分配环形缓冲失败返回nil
+ */
+- (nullable instancetype)initWithCapacity:(NSUInteger)capacity;
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithCoder:(NSCoder *)aDecoder NS_UNAVAILABLE;
++ (instancetype)new NS_UNAVAILABLE;
+
+@property (nonatomic, assign, readonly) NSUInteger capacity;  ///< 容量
+@property (nonatomic, assign, readonly) NSUInteger count;  ///< 当前个数(近似值)
+@property (nonatomic, assign) NSUInteger spinCount;  ///< 等待时先自旋检查的次数，默认0(直接挂起)
+
+/// 放入，队列满返回NO(不会阻塞)
+- (BOOL)push:(ObjectType)object;
+/// 取出，队列空返回nil
+- (nullable ObjectType)pop;
+/// 批量取出，同一个生产者放入的数据保持顺序
+- (NSUInteger)popBatchWithMaxCount:(NSUInteger)maxCount usingBlock:(void (NS_NOESCAPE ^)(ObjectType object))block;
+/// 等待队列非空(只能由消费者调用)，timeout小于0为一直等待
+- (BOOL)waitForObjectsWithTimeout:(NSTimeInterval)timeout;
+
+@end
+
+/// 只保留最新值的信箱，任意线程post，take只能由一个消费者调用
+@interface CQMailbox<ObjectType> : NSObject
+
+@property (nonatomic, assign, readonly) uint64_t overwrittenCount;  ///< 没被取走就被覆盖的个数
+@property (nonatomic, assign) NSUInteger spinCount;  ///< 等待时先自旋检查的次数，默认0(直接挂起)
+
+/**
+ 放入新值，覆盖还没被取走的旧值
+ @return YES表示覆盖了旧值，NO表示信箱原来是空的(消费者可能需要被调度)
+ */
+- (BOOL)post:(ObjectType)object;
+/// 取走最新值，没有返回nil
+- (nullable ObjectType)take;
+/// 等待有值(只能由消费者调用)，timeout小于0为一直等待
+- (BOOL)waitForObjectWithTimeout:(NSTimeInterval)timeout;
+
+@end
+
+NS_ASSUME_NONNULL_END
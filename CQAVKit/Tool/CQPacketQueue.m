@@ -0,0 +1,344 @@
+//
+//  CQPacketQueue.m
+//  CQAVKit
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+/**
+ 思路
+ 1 对象放入时CFBridgingRetain成裸指针存进槽位，取出时转移所有权，队列本身不分配内存
+ 2 SPSC: 生产者只写tail、消费者只写head，两者放在不同的缓存行，各自缓存对方的位置，只有看起来满/空时才重新读取对方的原子变量
+ 3 MPSC: 每个槽位带序号(Vyukov有界队列)，生产者CAS抢占位置后写数据再发布序号，消费者按序号判断槽位是否可读
+ 4 等待: 消费者先自旋spinCount次，再标记parked并重新检查一次后挂起在信号量上，生产者放入后看到parked才signal，
+   没有消费者等待时生产者不做系统调用
+ */
+
+#import "CQPacketQueue.h"
+#import <stdatomic.h>
+#import <stdlib.h>
+
+/// Apple A系列/M系列芯片的缓存行(L2)是128字节，按128对齐避免生产者和消费者的伪共享
+#define kCacheLineSize 128
+
+static size_t CQQueueRoundUpPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+static inline void CQQueueCPURelax(void) {
+#if defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#elif defined(__x86_64__)
+    __asm__ __volatile__("pause");
+#endif
+}
+
+/// 生产者放入后调用，有消费者挂起时唤醒
+static inline void CQQueueWakeConsumer(atomic_bool *parked, dispatch_semaphore_t semaphore) {
+    // 和消费者的parked标记/重新检查配对，保证不会出现都没看到对方的情况
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(parked, memory_order_relaxed) && atomic_exchange(parked, false)) {
+        dispatch_semaphore_signal(semaphore);
+    }
+}
+
+/// 消费者等待isReady为真，先自旋再挂起
+static BOOL CQQueueWait(atomic_bool *parked, dispatch_semaphore_t semaphore, NSUInteger spinCount, NSTimeInterval timeout, BOOL (NS_NOESCAPE ^isReady)(void)) {
+    for (NSUInteger i = 0; i < spinCount; i++) {
+        if (isReady()) return YES;
+        CQQueueCPURelax();
+    }
+    dispatch_time_t deadline = timeout < 0 ? DISPATCH_TIME_FOREVER : dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+    while (YES) {
+        atomic_store(parked, true);
+        if (isReady()) {
+            // 生产者可能已经signal，信号量会多一次计数，下次等待时多醒一次，重新检查即可
+            atomic_store(parked, false);
+            return YES;
+        }
+        if (dispatch_semaphore_wait(semaphore, deadline) != 0) {
+            atomic_store(parked, false);
+            return isReady();
+        }
+        if (isReady()) return YES;
+    }
+}
+
+#pragma mark - CQSPSCQueue
+typedef struct {
+    _Alignas(kCacheLineSize) atomic_size_t head;  ///< 消费者写
+    size_t cachedTail;  ///< 消费者缓存的tail
+    _Alignas(kCacheLineSize) atomic_size_t tail;  ///< 生产者写
+    size_t cachedHead;  ///< 生产者缓存的head
+    _Alignas(kCacheLineSize) atomic_bool parked;  ///< 消费者是否挂起
+    size_t mask;
+    void *slots[];
+} CQSPSCRing;
+
+@implementation CQSPSCQueue
+{
+    CQSPSCRing *_ring;
+    dispatch_semaphore_t _semaphore;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _capacity = CQQueueRoundUpPowerOfTwo(MAX(capacity, 2));
+        void *memory = NULL;
+        int result = posix_memalign(&memory, kCacheLineSize, sizeof(CQSPSCRing) + _capacity * sizeof(void *));
+        if (result != 0) {
+            NSLog(@"CQSPSCQueue-posix_memalign failed. result = %d", result);
+            return nil;
+        }
+        _ring = memory;
+        atomic_init(&_ring->head, 0);
+        atomic_init(&_ring->tail, 0);
+        atomic_init(&_ring->parked, false);
+        _ring->cachedTail = 0;
+        _ring->cachedHead = 0;
+        _ring->mask = _capacity - 1;
+        _semaphore = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // 初始化失败时没有环形缓冲
+    if (!_ring) return;
+    while ([self pop]);
+    free(_ring);
+}
+
+- (NSUInteger)count {
+    return atomic_load_explicit(&_ring->tail, memory_order_acquire) - atomic_load_explicit(&_ring->head, memory_order_acquire);
+}
+
+- (BOOL)push:(id)object {
+    CQSPSCRing *ring = _ring;
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - ring->cachedHead > ring->mask) {
+        ring->cachedHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->cachedHead > ring->mask) return NO;
+    }
+    ring->slots[tail & ring->mask] = (__bridge_retained void *)object;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    CQQueueWakeConsumer(&ring->parked, _semaphore);
+    return YES;
+}
+
+/// 消费者可读的个数
+static inline size_t CQSPSCAvailable(CQSPSCRing *ring, size_t head) {
+    if (head == ring->cachedTail) {
+        ring->cachedTail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    }
+    return ring->cachedTail - head;
+}
+
+- (id)pop {
+    CQSPSCRing *ring = _ring;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (CQSPSCAvailable(ring, head) == 0) return nil;
+    void *slot = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return (__bridge_transfer id)slot;
+}
+
+- (NSUInteger)popBatchWithMaxCount:(NSUInteger)maxCount usingBlock:(void (NS_NOESCAPE ^)(id))block {
+    CQSPSCRing *ring = _ring;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t count = MIN(CQSPSCAvailable(ring, head), maxCount);
+    for (size_t i = 0; i < count; i++) {
+        block((__bridge_transfer id)ring->slots[(head + i) & ring->mask]);
+    }
+    // 整批处理完才归还槽位，只有一次release写
+    if (count > 0) atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+- (BOOL)waitForObjectsWithTimeout:(NSTimeInterval)timeout {
+    CQSPSCRing *ring = _ring;
+    return CQQueueWait(&ring->parked, _semaphore, self.spinCount, timeout, ^BOOL{
+        return atomic_load_explicit(&ring->tail, memory_order_acquire) != atomic_load_explicit(&ring->head, memory_order_relaxed);
+    });
+}
+
+@end
+
+#pragma mark - CQMPSCQueue
+typedef struct {
+    atomic_size_t sequence;  ///< 等于位置时可写，等于位置+1时可读
+    void *object;
+} CQMPSCCell;
+
+typedef struct {
+    _Alignas(kCacheLineSize) atomic_size_t enqueuePosition;  ///< 生产者竞争
+    _Alignas(kCacheLineSize) atomic_size_t dequeuePosition;  ///< 只有消费者写
+    _Alignas(kCacheLineSize) atomic_bool parked;  ///< 消费者是否挂起
+    size_t mask;
+    CQMPSCCell cells[];
+} CQMPSCRing;
+
+@implementation CQMPSCQueue
+{
+    CQMPSCRing *_ring;
+    dispatch_semaphore_t _semaphore;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _capacity = CQQueueRoundUpPowerOfTwo(MAX(capacity, 2));
+        void *memory = NULL;
+        int result = posix_memalign(&memory, kCacheLineSize, sizeof(CQMPSCRing) + _capacity * sizeof(CQMPSCCell));
+        if (result != 0) {
+            NSLog(@"CQMPSCQueue-posix_memalign failed. result = %d", result);
+            return nil;
+        }
+        _ring = memory;
+        atomic_init(&_ring->enqueuePosition, 0);
+        atomic_init(&_ring->dequeuePosition, 0);
+        atomic_init(&_ring->parked, false);
+        _ring->mask = _capacity - 1;
+        for (size_t i = 0; i < _capacity; i++) {
+            atomic_init(&_ring->cells[i].sequence, i);
+            _ring->cells[i].object = NULL;
+        }
+        _semaphore = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    // 初始化失败时没有环形缓冲
+    if (!_ring) return;
+    while ([self pop]);
+    free(_ring);
+}
+
+- (NSUInteger)count {
+    size_t enqueuePosition = atomic_load_explicit(&_ring->enqueuePosition, memory_order_acquire);
+    size_t dequeuePosition = atomic_load_explicit(&_ring->dequeuePosition, memory_order_acquire);
+    return enqueuePosition > dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+}
+
+- (BOOL)push:(id)object {
+    CQMPSCRing *ring = _ring;
+    size_t position = atomic_load_explicit(&ring->enqueuePosition, memory_order_relaxed);
+    CQMPSCCell *cell;
+    while (YES) {
+        cell = &ring->cells[position & ring->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+        if (diff == 0) {
+            // 失败时position被更新为最新值
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // 这个槽位上一轮的数据还没被取走，队列满
+            return NO;
+        } else {
+            position = atomic_load_explicit(&ring->enqueuePosition, memory_order_relaxed);
+        }
+    }
+    cell->object = (__bridge_retained void *)object;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    CQQueueWakeConsumer(&ring->parked, _semaphore);
+    return YES;
+}
+
+/// 取出一个槽位的数据，不可读返回NULL
+static inline void *CQMPSCTake(CQMPSCRing *ring, size_t position) {
+    CQMPSCCell *cell = &ring->cells[position & ring->mask];
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + 1) return NULL;
+    void *object = cell->object;
+    cell->object = NULL;
+    // 归还槽位给下一轮的生产者
+    atomic_store_explicit(&cell->sequence, position + ring->mask + 1, memory_order_release);
+    return object;
+}
+
+- (id)pop {
+    CQMPSCRing *ring = _ring;
+    size_t position = atomic_load_explicit(&ring->dequeuePosition, memory_order_relaxed);
+    void *object = CQMPSCTake(ring, position);
+    if (!object) return nil;
+    atomic_store_explicit(&ring->dequeuePosition, position + 1, memory_order_release);
+    return (__bridge_transfer id)object;
+}
+
+- (NSUInteger)popBatchWithMaxCount:(NSUInteger)maxCount usingBlock:(void (NS_NOESCAPE ^)(id))block {
+    CQMPSCRing *ring = _ring;
+    size_t position = atomic_load_explicit(&ring->dequeuePosition, memory_order_relaxed);
+    NSUInteger count = 0;
+    // 遇到还没发布的槽位就停止，保证顺序
+    while (count < maxCount) {
+        void *object = CQMPSCTake(ring, position + count);
+        if (!object) break;
+        count++;
+        block((__bridge_transfer id)object);
+    }
+    if (count > 0) atomic_store_explicit(&ring->dequeuePosition, position + count, memory_order_release);
+    return count;
+}
+
+- (BOOL)waitForObjectsWithTimeout:(NSTimeInterval)timeout {
+    CQMPSCRing *ring = _ring;
+    return CQQueueWait(&ring->parked, _semaphore, self.spinCount, timeout, ^BOOL{
+        size_t position = atomic_load_explicit(&ring->dequeuePosition, memory_order_relaxed);
+        return atomic_load_explicit(&ring->cells[position & ring->mask].sequence, memory_order_acquire) == position + 1;
+    });
+}
+
+@end
+
+#pragma mark - CQMailbox
+@implementation CQMailbox
+{
+    _Atomic(void *) _slot;
+    _Atomic(uint64_t) _overwrittenCount;
+    atomic_bool _parked;
+    dispatch_semaphore_t _semaphore;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        atomic_init(&_slot, NULL);
+        atomic_init(&_overwrittenCount, 0);
+        atomic_init(&_parked, false);
+        _semaphore = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    void *object = atomic_exchange(&_slot, NULL);
+    if (object) CFRelease(object);
+}
+
+- (uint64_t)overwrittenCount {
+    return atomic_load_explicit(&_overwrittenCount, memory_order_relaxed);
+}
+
+- (BOOL)post:(id)object {
+    void *previous = atomic_exchange_explicit(&_slot, (__bridge_retained void *)object, memory_order_acq_rel);
+    if (previous) {
+        atomic_fetch_add_explicit(&_overwrittenCount, 1, memory_order_relaxed);
+        CFRelease(previous);
+        return YES;
+    }
+    CQQueueWakeConsumer(&_parked, _semaphore);
+    return NO;
+}
+
+- (id)take {
+    void *object = atomic_exchange_explicit(&_slot, NULL, memory_order_acq_rel);
+    return (__bridge_transfer id)object;
+}
+
+- (BOOL)waitForObjectWithTimeout:(NSTimeInterval)timeout {
+    return CQQueueWait(&_parked, _semaphore, self.spinCount, timeout, ^BOOL{
+        return atomic_load_explicit(&self->_slot, memory_order_acquire) != NULL;
+    });
+}
+
+@end
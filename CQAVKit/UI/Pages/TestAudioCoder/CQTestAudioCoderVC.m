@@ -8,11 +8,13 @@
 #import "CQTestAudioCoderVC.h"
 #import "CQAudioEncoder.h"
 #import "CQCaptureManager.h"
+#import "CQStreamFileWriter.h"
+#import "CQADTSUtil.h"
 
 @interface CQTestAudioCoderVC ()<CQCaptureManagerDelegate, CQAudioEncoderDelegate>
 @property (nonatomic, strong) CQCaptureManager *captureManager;  ///< 捕捉管理
 @property (nonatomic, strong) CQAudioEncoder *audioEncoder;  ///< 编码器
-@property (nonatomic, strong) NSFileHandle *fileHandle; ///< 文件处理
+@property (nonatomic, strong) CQStreamFileWriter *fileWriter; ///< 异步写文件
 @end
 
 @implementation CQTestAudioCoderVC
@@ -73,40 +75,38 @@
 
 #pragma mark - CQAudioEncoderDelegate
 - (void)audioEncoder:(CQAudioEncoder *)audioEncoder didEncodeSuccessWithAACData:(NSData *)aacData {
-    // 写入AAC
-    if (!self.fileHandle) [self createFileHandler];
-    [self.fileHandle seekToEndOfFile];
-    [self.fileHandle writeData:aacData];
+    // 只有第一帧带ADTS头，写文件用下面带时间戳的裸数据回调
+}
+
+- (void)audioEncoder:(CQAudioEncoder *)audioEncoder didEncodeRawAACData:(NSData *)rawAACData pts:(CMTime)pts {
+    // 写入AAC，每一帧都带ADTS头，文件才能被播放器和CQRawStreamReader逐帧读取
+    if (!self.fileWriter) [self createFileWriter];
+    NSMutableData *aacData = [NSMutableData dataWithLength:CQADTSHeaderSize];
+    CQADTSWriteHeader(aacData.mutableBytes, audioEncoder.config.sampleRate, audioEncoder.config.channelCount, rawAACData.length);
+    [aacData appendData:rawAACData];
+    [self.fileWriter appendData:aacData];
     
     // 解码
 }
 
-#pragma mark - FileHandler
-- (void)createFileHandler {
+#pragma mark - FileWriter
+- (void)createFileWriter {
     // 沙盒路径
     NSString *filePath = [NSHomeDirectory()stringByAppendingPathComponent:@"/Library/TestAudioCoder0.aac"];
-    NSFileManager *manager = [NSFileManager defaultManager];
-    BOOL createFile = NO;
-    if ([manager fileExistsAtPath:filePath]) {
-        if ([manager removeItemAtPath:filePath error:nil]) {
-            createFile = [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
-        }
-    } else {
-        createFile = [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
-    }
-    if (!createFile) {
-        NSLog(@"create file failed");
+    // 写文件在单独的队列批量进行，编码回调里只是把数据放入队列
+    NSError *error;
+    self.fileWriter = [[CQStreamFileWriter alloc] initWithPath:filePath error:&error];
+    if (!self.fileWriter) {
+        NSLog(@"create file failed %@", error);
     } else {
         NSLog(@"create file success");
     }
     NSLog(@"filePaht = %@",filePath);
-    // 写入数据 NSFIleHandle 类似于C语言文件指针，创建写入的handle
-    self.fileHandle = [NSFileHandle fileHandleForWritingAtPath:filePath];
 }
 
-- (void)destroyFileHandler {
-    [self.fileHandle closeFile];
-    self.fileHandle = nil;
+- (void)destroyFileWriter {
+    [self.fileWriter closeWithCompletionHandler:nil];
+    self.fileWriter = nil;
 }
 
 @end
@@ -7,6 +7,9 @@
 
 #import "CQTestViewController.h"
 #import <AVFoundation/AVFoundation.h>
+#import "CQPipelineBenchmark.h"
+#import "CQMicroBenchmark.h"
+#import "CQDenoiseBenchmark.h"
 
 @interface CQTestViewController ()
 
@@ -16,9 +19,72 @@
 
 - (void)viewDidLoad {
     [super viewDidLoad];
-    
+    [self configUI];
 }
 
+#pragma mark - UI
+- (void)configUI {
+    UIButton *pipelineBenchmarkBtn = [UIButton buttonWithType:UIButtonTypeCustom];
+    pipelineBenchmarkBtn.frame = CGRectMake(20, 100, 200, 30);
+    [pipelineBenchmarkBtn setTitleColor:UIColor.blackColor forState:UIControlStateNormal];
+    [pipelineBenchmarkBtn setTitle:@"管线基准测试" forState:UIControlStateNormal];
+    [pipelineBenchmarkBtn setTitle:@"测试中..." forState:UIControlStateDisabled];
+    [pipelineBenchmarkBtn addTarget:self action:@selector(pipelineBenchmarkAction:) forControlEvents:UIControlEventTouchUpInside];
+    [self.view addSubview:pipelineBenchmarkBtn];
 
+    UIButton *kernelBenchmarkBtn = [UIButton buttonWithType:UIButtonTypeCustom];
+    kernelBenchmarkBtn.frame = CGRectMake(20, 150, 200, 30);
+    [kernelBenchmarkBtn setTitleColor:UIColor.blackColor forState:UIControlStateNormal];
+    [kernelBenchmarkBtn setTitle:@"内核基准测试" forState:UIControlStateNormal];
+    [kernelBenchmarkBtn setTitle:@"测试中..." forState:UIControlStateDisabled];
+    [kernelBenchmarkBtn addTarget:self action:@selector(kernelBenchmarkAction:) forControlEvents:UIControlEventTouchUpInside];
+    [self.view addSubview:kernelBenchmarkBtn];
+
+    UIButton *denoiseBenchmarkBtn = [UIButton buttonWithType:UIButtonTypeCustom];
+    denoiseBenchmarkBtn.frame = CGRectMake(20, 200, 200, 30);
+    [denoiseBenchmarkBtn setTitleColor:UIColor.blackColor forState:UIControlStateNormal];
+    [denoiseBenchmarkBtn setTitle:@"降噪基准测试" forState:UIControlStateNormal];
+    [denoiseBenchmarkBtn setTitle:@"测试中..." forState:UIControlStateDisabled];
+    [denoiseBenchmarkBtn addTarget:self action:@selector(denoiseBenchmarkAction:) forControlEvents:UIControlEventTouchUpInside];
+    [self.view addSubview:denoiseBenchmarkBtn];
+}
+
+#pragma mark - Event
+- (void)pipelineBenchmarkAction:(UIButton *)sender {
+    sender.enabled = NO;
+    // 报告写入沙盒Library/Benchmark，可以通过文件浏览器导出
+    NSString *directory = [NSHomeDirectory() stringByAppendingPathComponent:@"/Library/Benchmark"];
+    [CQPipelineBenchmark runReferenceSuiteInDirectory:directory completionHandler:^(NSArray<NSDictionary *> *reports, NSString *reportPath) {
+        NSData *jsonData = [CQPipelineBenchmark JSONDataWithReport:reports];
+        NSLog(@"pipeline benchmark path=%@\n%@", reportPath, [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding]);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            sender.enabled = YES;
+        });
+    }];
+}
+
+- (void)kernelBenchmarkAction:(UIButton *)sender {
+    sender.enabled = NO;
+    NSString *directory = [NSHomeDirectory() stringByAppendingPathComponent:@"/Library/Benchmark"];
+    [CQMicroBenchmark runMediaKernelBenchmarksInDirectory:directory completionHandler:^(NSDictionary<NSString *, id> *report, NSString *reportPath) {
+        NSData *jsonData = [CQPipelineBenchmark JSONDataWithReport:report];
+        NSLog(@"kernel benchmark path=%@\n%@", reportPath, [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding]);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            sender.enabled = YES;
+        });
+    }];
+}
+
+- (void)denoiseBenchmarkAction:(UIButton *)sender {
+    sender.enabled = NO;
+    NSString *directory = [NSHomeDirectory() stringByAppendingPathComponent:@"/Library/Benchmark"];
+    [CQDenoiseBenchmark runSuiteInDirectory:directory completionHandler:^(NSArray<NSDictionary *> *reports, NSString *reportPath) {
+        NSData *jsonData = [CQPipelineBenchmark JSONDataWithReport:reports];
+        NSLog(@"denoise benchmark path=%@\n%@", reportPath, [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding]);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            sender.enabled = YES;
+        });
+    }];
+}
 
 @end
@@ -11,6 +11,8 @@
 #import "CQVideoEncoder.h"
 #import "CQVideoDecoder.h"
 #import "CQPlayEAGLLayer.h"
+#import "CQStreamFileWriter.h"
+#import "CQPacketQueue.h"
 
 @interface CQTestVideoCoderVC ()<CQCaptureManagerDelegate, CQVideoEncoderDelegate, CQVideoDecoderDelegate>
 @property (nonatomic, strong) CQCaptureManager *captureManager;  ///< 捕捉管理
@@ -18,7 +20,8 @@
 @property (nonatomic, strong) CQVideoEncoder *videoEncoder;  ///< 编码器
 @property (nonatomic, strong) CQVideoDecoder *videoDecoder;  ///< 解码器
 @property (nonatomic, strong) CQPlayEAGLLayer *playEAGLLayer; ///< OpenGL绘制PixelBuffer
-@property (nonatomic, strong) NSFileHandle *fileHandle; ///< 文件处理
+@property (nonatomic, strong) CQStreamFileWriter *fileWriter; ///< 异步写文件
+@property (nonatomic, strong) CQMailbox *renderMailbox; ///< 解码->渲染，只保留最新一帧
 @end
 
 @implementation CQTestVideoCoderVC
@@ -29,8 +32,10 @@
     self.captureManager.delegate = self;
     self.videoEncoder = [[CQVideoEncoder alloc] initWithConfig:[CQVideoCoderConfig defaultConifg]];
     self.videoEncoder.delegate = self;
+    self.videoEncoder.insertsTimestampSEI = YES;
     self.videoDecoder = [[CQVideoDecoder alloc] initWithConfig:[CQVideoCoderConfig defaultConifg]];
     self.videoDecoder.delegate = self;
+    self.renderMailbox = [[CQMailbox alloc] init];
     
     [self configUI];
     [self configCaptureSession];
@@ -85,20 +90,10 @@
 
 #pragma mark - CQVideoEncoderDelegate
 - (void)videoEncoder:(CQVideoEncoder *)videoEncoder didEncodeWithSps:(NSData *)sps pps:(NSData *)pps {
-    // 写入文件
-    if (!self.fileHandle) [self createFileHandler];
-    
-    const char bytes[] = "\x00\x00\x00\x01";
-    size_t length = sizeof(bytes) - 1;
-    NSData *byteHeader = [NSData dataWithBytes:bytes length:length];
-    
-//    [self.fileHandle writeData:byteHeader];
-    [self.fileHandle seekToEndOfFile];
-    [self.fileHandle writeData:sps];
-    
-//    [self.fileHandle writeData:byteHeader];
-    [self.fileHandle seekToEndOfFile];
-    [self.fileHandle writeData:pps];
+    // 写入文件(sps/pps已带起始码)
+    if (!self.fileWriter) [self createFileWriter];
+    [self.fileWriter appendData:sps];
+    [self.fileWriter appendData:pps];
     
     // 直接给解码器解码
     [self.videoDecoder videoDecodeWithH264Data:sps];
@@ -106,16 +101,9 @@
 }
 
 - (void)videoEncoder:(CQVideoEncoder *)videoEncoder didEncodeSuccessWithH264Data:(NSData *)h264Data {
-    // 写入文件
-    if (!self.fileHandle) [self createFileHandler];
-    
-    const char bytes[] = "\x00\x00\x00\x01";
-    size_t length = sizeof(bytes) - 1;
-    NSData *byteHeader = [NSData dataWithBytes:bytes length:length];
-    
-//    [self.fileHandle writeData:byteHeader];
-    [self.fileHandle seekToEndOfFile];
-    [self.fileHandle writeData:h264Data];
+    // 写入文件(已带起始码)
+    if (!self.fileWriter) [self createFileWriter];
+    [self.fileWriter appendData:h264Data];
     
     // 直接给解码器解码
     [self.videoDecoder videoDecodeWithH264Data:h264Data];
@@ -123,36 +111,37 @@
 
 #pragma mark - CQVideoDecoderDelegate
 - (void)videoDecoder:(CQVideoDecoder *)videoDecoder didDecodeSuccessWithPixelBuffer:(CVPixelBufferRef)pixelBuffer {
-    // 使用CAEAGLLayer绘制出来
-    self.playEAGLLayer.pixelBuffer = pixelBuffer;
+    // 使用CAEAGLLayer在主线程绘制，渲染跟不上时只绘制最新一帧
+    // 信箱原来是空的才调度一次渲染，否则已经有一次渲染在等待，它会取到这一帧
+    if (![self.renderMailbox post:(__bridge id)pixelBuffer]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            id latestPixelBuffer = [self.renderMailbox take];
+            if (latestPixelBuffer) {
+                self.playEAGLLayer.pixelBuffer = (__bridge CVPixelBufferRef)latestPixelBuffer;
+                [self.videoDecoder reportPresentedPixelBuffer:(__bridge CVPixelBufferRef)latestPixelBuffer];
+            }
+        });
+    }
 }
 
-#pragma mark - FileHandler
-- (void)createFileHandler {
+#pragma mark - FileWriter
+- (void)createFileWriter {
     // 沙盒路径
     NSString *filePath = [NSHomeDirectory()stringByAppendingPathComponent:@"/Library/TestVideoCoder4.h264"];
-    NSFileManager *manager = [NSFileManager defaultManager];
-    BOOL createFile = NO;
-    if ([manager fileExistsAtPath:filePath]) {
-        if ([manager removeItemAtPath:filePath error:nil]) {
-            createFile = [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
-        }
-    } else {
-        createFile = [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
-    }
-    if (!createFile) {
-        NSLog(@"create file failed");
+    // 写文件在单独的队列批量进行，编码回调里只是把数据放入队列
+    NSError *error;
+    self.fileWriter = [[CQStreamFileWriter alloc] initWithPath:filePath error:&error];
+    if (!self.fileWriter) {
+        NSLog(@"create file failed %@", error);
     } else {
         NSLog(@"create file success");
     }
     NSLog(@"filePaht = %@",filePath);
-    // 写入数据 NSFIleHandle 类似于C语言文件指针，创建写入的handle
-    self.fileHandle = [NSFileHandle fileHandleForWritingAtPath:filePath];
 }
 
-- (void)destroyFileHandler {
-    [self.fileHandle closeFile];
-    self.fileHandle = nil;
+- (void)destroyFileWriter {
+    [self.fileWriter closeWithCompletionHandler:nil];
+    self.fileWriter = nil;
 }
 
 @end
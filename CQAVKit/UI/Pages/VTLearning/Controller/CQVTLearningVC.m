@@ -8,6 +8,7 @@
 #import "CQVTLearningVC.h"
 #import <AVFoundation/AVFoundation.h>
 #import <VideoToolbox/VideoToolbox.h>
+#import "CQStreamFileWriter.h"
 
 @interface CQVTLearningVC ()<AVCaptureVideoDataOutputSampleBufferDelegate>
 @property (nonatomic, strong) UILabel *cLabel;
@@ -18,7 +19,7 @@
 
 @property (nonatomic, strong) dispatch_queue_t captureQueue; ///< 捕捉队列
 @property (nonatomic, strong) dispatch_queue_t encodeQueue; ///< 编码队列
-@property (nonatomic, strong) NSFileHandle *fileHandle; ///< 文件处理
+@property (nonatomic, strong) CQStreamFileWriter *fileWriter; ///< 异步写文件
 @property (nonatomic, assign) VTCompressionSessionRef compressionSessionRef;
 @property (nonatomic, assign) CMFormatDescriptionRef formatDescriptionRef;
 @property (nonatomic, assign) int frameID;
@@ -96,18 +97,15 @@
     
     // 沙盒路径
     NSString *filePath = [NSHomeDirectory()stringByAppendingPathComponent:@"/Documents/video.h264"];
-    // 移除
-    [[NSFileManager defaultManager] removeItemAtPath:filePath error:nil];
-    // 新建
-    BOOL createFile = [[NSFileManager defaultManager] createFileAtPath:filePath contents:nil attributes:nil];
-    if (!createFile) {
-        NSLog(@"create file failed");
+    // 新建(已存在会清空)，写文件在单独的队列批量进行，编码回调里只是把数据放入队列
+    NSError *error;
+    self.fileWriter = [[CQStreamFileWriter alloc] initWithPath:filePath error:&error];
+    if (!self.fileWriter) {
+        NSLog(@"create file failed %@", error);
     } else {
         NSLog(@"create file success");
     }
     NSLog(@"filePaht = %@",filePath);
-    // 写入数据 NSFIleHandle 类似于C语言文件指针，创建写入的handle
-    self.fileHandle = [NSFileHandle fileHandleForWritingAtPath:filePath];
     
     // 到此 采集的准备工作完成
     
@@ -118,9 +116,10 @@
 - (void)stopCapture {
     [self.captureSession stopRunning];
     [self.previewLayer removeFromSuperlayer];
-    [self.fileHandle closeFile];
-    self.fileHandle = nil;
     [self endVideoToolBox];
+    // 编码会话结束后不会再有数据，写完剩余数据后关闭
+    [self.fileWriter closeWithCompletionHandler:nil];
+    self.fileWriter = nil;
 }
 
 #pragma mark - AVCaptureVideoDataOutputSampleBufferDelegate
@@ -369,31 +368,34 @@ void didCompressH264(void *outputCallbackRefCon, void *sourceFrameRefCon, OSStat
 // 数据写入sps pps
 - (void)gotSpsPps:(NSData*)sps pps:(NSData*)pps {
     NSLog(@"SpsPps is writing!");
-    if (!self.fileHandle) return;
-    // 写入之前(起始位)
-    const char bytes[] = "\x00\x00\x00\x01";
-    // 因为字符串要/0结束 终止符
-    size_t length = sizeof(bytes) - 1;
-    NSData *byteHeader = [NSData dataWithBytes:bytes length:length];
-    [self.fileHandle writeData:byteHeader];
-    [self.fileHandle writeData:sps];
-    [self.fileHandle writeData:byteHeader];
-    [self.fileHandle writeData:pps];
+    if (!self.fileWriter) return;
+    // 写入之前(起始位)，起始码和数据分别入队，写文件时用writev一起写入，不需要拼接
+    NSData *byteHeader = [self startCodeData];
+    [self.fileWriter appendData:byteHeader];
+    [self.fileWriter appendData:sps];
+    [self.fileWriter appendData:byteHeader];
+    [self.fileWriter appendData:pps];
 }
 
 - (void)gotEncodedData:(NSData*)data isKeyFrame:(BOOL)isKeyFrame {
     NSLog(@"encoderData is writing!");
-    if (!self.fileHandle) return;
-    // 创建起始位
-    const char bytes[] = "\x00\x00\x00\x01";
-    // 计算长度
-    size_t length = sizeof(bytes) - 1;
-    // bytes转为NSData
-    NSData *byteHeader = [NSData dataWithBytes:bytes length:length];
+    if (!self.fileWriter) return;
     // 写入NALU数据之前，先写入起始位
-    [self.fileHandle writeData:byteHeader];
+    [self.fileWriter appendData:[self startCodeData]];
     // 写入NALU
-    [self.fileHandle writeData:data];
+    [self.fileWriter appendData:data];
+}
+
+/// 起始码，所有NALU共用一个
+- (NSData *)startCodeData {
+    static NSData *startCodeData;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        // 因为字符串要/0结束 终止符
+        const char bytes[] = "\x00\x00\x00\x01";
+        startCodeData = [NSData dataWithBytes:bytes length:sizeof(bytes) - 1];
+    });
+    return startCodeData;
 }
 
 
@@ -0,0 +1,127 @@
+//
+//  CQBandwidthEstimatorTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQBandwidthEstimator.h"
+
+#define kSimPacketSize 1200
+#define kSimMaxPendingCount 8192
+
+/// 模拟的瓶颈链路: 固定20ms传播时延 + 按容量排队
+typedef struct {
+    uint64_t nowUs;  ///< 当前时间
+    uint64_t lastArrivalUs;  ///< 上一个包的到达时间(队列尾)
+    double sendCredit;  ///< 平滑发送的额度(bit)
+    uint32_t lossInterval;  ///< 每多少个包丢一个，0为不丢
+    uint64_t sentCount;  ///< 已发送的包数
+    CQPacketFeedback pending[kSimMaxPendingCount];  ///< 还没有反馈的包
+    size_t pendingCount;
+    int overuseCount;  ///< 反馈后为过载状态的次数
+} CQSimulatedLink;
+
+/**
+ 按估计器的目标码率发送durationUs，每100ms把已经到达的包反馈给估计器
+ @param capacity 瓶颈容量(bps)
+ */
+static void CQSimulatedLinkRun(CQSimulatedLink *link, CQBandwidthEstimator *estimator, double capacity, uint64_t durationUs) {
+    link->overuseCount = 0;
+    uint64_t endUs = link->nowUs + durationUs;
+    uint64_t nextFeedbackUs = link->nowUs + 100000;
+    while (link->nowUs < endUs) {
+        link->nowUs += 1000;
+        link->sendCredit += (double)CQBandwidthEstimatorTargetBitrate(estimator) / 1000.0;
+        while (link->sendCredit >= kSimPacketSize * 8 && link->pendingCount < kSimMaxPendingCount) {
+            link->sendCredit -= kSimPacketSize * 8;
+            link->sentCount++;
+            uint64_t arrivalUs = link->nowUs + 20000;
+            if (link->lossInterval > 0 && link->sentCount % link->lossInterval == 0) {
+                arrivalUs = 0;
+            } else {
+                // 队列里还有包时排在后面，时延随着排队线性上升
+                uint64_t queuedArrivalUs = link->lastArrivalUs + (uint64_t)(kSimPacketSize * 8 * 1000000.0 / capacity);
+                arrivalUs = MAX(arrivalUs, queuedArrivalUs);
+                link->lastArrivalUs = arrivalUs;
+            }
+            link->pending[link->pendingCount++] = (CQPacketFeedback){link->nowUs, arrivalUs, kSimPacketSize};
+        }
+        if (link->nowUs < nextFeedbackUs) continue;
+        nextFeedbackUs += 100000;
+        // 按发送顺序反馈已经到达的包，丢失的包跟着前面的包一起反馈
+        size_t count = 0;
+        while (count < link->pendingCount && link->pending[count].arrivalTimeUs <= link->nowUs) {
+            count++;
+        }
+        if (count == 0) continue;
+        CQBandwidthEstimatorOnFeedback(estimator, link->pending, count, link->nowUs);
+        memmove(link->pending, link->pending + count, (link->pendingCount - count) * sizeof(CQPacketFeedback));
+        link->pendingCount -= count;
+        if (CQBandwidthEstimatorUsage(estimator) == CQBandwidthUsageOverusing) link->overuseCount++;
+    }
+}
+
+@interface CQBandwidthEstimatorTests : XCTestCase
+
+@end
+
+@implementation CQBandwidthEstimatorTests
+
+#pragma mark - Delay
+- (void)testDelayRampIsDetectedAndRecovers {
+    CQBandwidthEstimator *estimator = CQBandwidthEstimatorCreate(1000000, 100000, 2500000);
+    CQSimulatedLink *link = calloc(1, sizeof(CQSimulatedLink));
+    link->nowUs = 1000000;
+
+    // 容量充足: 排队时延不变，不会过载，码率持续上升
+    CQSimulatedLinkRun(link, estimator, 3000000, 5000000);
+    XCTAssertEqual(link->overuseCount, 0);
+    XCTAssertGreaterThan(CQBandwidthEstimatorTargetBitrate(estimator), 1200000u);
+
+    // 容量降到500k: 队列变长，检测到过载，目标码率降到容量附近
+    CQSimulatedLinkRun(link, estimator, 500000, 5000000);
+    XCTAssertGreaterThan(link->overuseCount, 0);
+    XCTAssertLessThanOrEqual(CQBandwidthEstimatorTargetBitrate(estimator), 500000u);
+    XCTAssertGreaterThan(CQBandwidthEstimatorTargetBitrate(estimator), 350000u);
+    XCTAssertEqualWithAccuracy((double)CQBandwidthEstimatorAckedBitrate(estimator), 500000, 50000);
+
+    // 容量恢复: 队列排空后不再过载，码率重新爬升
+    CQSimulatedLinkRun(link, estimator, 3000000, 15000000);
+    XCTAssertEqual(link->overuseCount, 0);
+    XCTAssertEqual(CQBandwidthEstimatorUsage(estimator), CQBandwidthUsageNormal);
+    XCTAssertGreaterThan(CQBandwidthEstimatorTargetBitrate(estimator), 1000000u);
+
+    free(link);
+    CQBandwidthEstimatorDestroy(estimator);
+}
+
+#pragma mark - Loss
+- (void)testLossAboveTenPercentLowersTarget {
+    CQBandwidthEstimator *estimator = CQBandwidthEstimatorCreate(1000000, 100000, 2500000);
+    CQSimulatedLink *link = calloc(1, sizeof(CQSimulatedLink));
+    link->nowUs = 1000000;
+    CQSimulatedLinkRun(link, estimator, 3000000, 2000000);
+    uint64_t targetBeforeLoss = CQBandwidthEstimatorTargetBitrate(estimator);
+
+    // 容量充足但每5个包丢一个(20%)，只能由丢包降码率
+    link->lossInterval = 5;
+    CQSimulatedLinkRun(link, estimator, 3000000, 2000000);
+    XCTAssertEqual(link->overuseCount, 0);
+    XCTAssertEqualWithAccuracy(CQBandwidthEstimatorLossRate(estimator), 0.2, 0.03);
+    XCTAssertLessThan(CQBandwidthEstimatorTargetBitrate(estimator), targetBeforeLoss * 7 / 10);
+    XCTAssertGreaterThanOrEqual(CQBandwidthEstimatorTargetBitrate(estimator), 100000u);
+
+    // 2%以下的丢包不限制增长
+    link->lossInterval = 100;
+    uint64_t targetAfterLoss = CQBandwidthEstimatorTargetBitrate(estimator);
+    CQSimulatedLinkRun(link, estimator, 3000000, 5000000);
+    XCTAssertLessThan(CQBandwidthEstimatorLossRate(estimator), 0.02);
+    XCTAssertGreaterThan(CQBandwidthEstimatorTargetBitrate(estimator), targetAfterLoss);
+
+    free(link);
+    CQBandwidthEstimatorDestroy(estimator);
+}
+
+@end
@@ -0,0 +1,174 @@
+//
+//  CQFECCodecTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQFECCodec.h"
+#import "CQTestSupport.h"
+
+#define kTestMaxSymbolCount (CQFECMaxMediaCount + CQFECMaxRepairCount)
+
+/// 一个测试块: 媒体符号 + 修复符号
+typedef struct {
+    size_t mediaCount;
+    size_t repairCount;
+    size_t symbolLength;
+    uint8_t *original;  ///< 原始媒体符号，连续存放
+    uint8_t *repairData;  ///< 修复符号，连续存放
+} CQTestFECBlock;
+
+static CQTestFECBlock CQTestFECBlockCreate(CQFECScheme scheme, size_t mediaCount, size_t repairCount, size_t symbolLength, uint32_t seed) {
+    CQTestFECBlock block = {mediaCount, repairCount, symbolLength, malloc(mediaCount * symbolLength), malloc(repairCount * symbolLength)};
+    for (size_t i = 0; i < mediaCount * symbolLength; i++) {
+        block.original[i] = (uint8_t)CQTestRandom(&seed);
+    }
+    const uint8_t *media[CQFECMaxMediaCount];
+    for (size_t i = 0; i < mediaCount; i++) {
+        media[i] = block.original + i * symbolLength;
+    }
+    for (size_t r = 0; r < repairCount; r++) {
+        CQFECEncodeRepair(scheme, media, mediaCount, symbolLength, r, block.repairData + r * symbolLength);
+    }
+    return block;
+}
+
+static void CQTestFECBlockDestroy(CQTestFECBlock *block) {
+    free(block->original);
+    free(block->repairData);
+}
+
+/**
+ 按丢失标记解码
+ @param isLost 前mediaCount个为媒体符号，后repairCount个为修复符号
+ @param isRecovered 输出，恢复出的媒体符号和原始数据一致
+ */
+static BOOL CQTestFECBlockDecode(CQFECScheme scheme, const CQTestFECBlock *block, const BOOL *isLost, BOOL *isRecovered) {
+    uint8_t *received = malloc(block->mediaCount * block->symbolLength);
+    uint8_t *media[CQFECMaxMediaCount];
+    BOOL isReceived[CQFECMaxMediaCount];
+    for (size_t i = 0; i < block->mediaCount; i++) {
+        media[i] = received + i * block->symbolLength;
+        isReceived[i] = !isLost[i];
+        // 丢失的位置填入垃圾数据，解码必须完全覆盖
+        memset(media[i], isReceived[i] ? 0 : 0xA5, block->symbolLength);
+        if (isReceived[i]) memcpy(media[i], block->original + i * block->symbolLength, block->symbolLength);
+    }
+    const uint8_t *repairs[CQFECMaxRepairCount];
+    size_t repairIndices[CQFECMaxRepairCount];
+    size_t repairCount = 0;
+    for (size_t r = 0; r < block->repairCount; r++) {
+        if (isLost[block->mediaCount + r]) continue;
+        repairs[repairCount] = block->repairData + r * block->symbolLength;
+        repairIndices[repairCount] = r;
+        repairCount++;
+    }
+    BOOL isDecoded = CQFECDecodeBlock(scheme, media, isReceived, block->mediaCount, block->symbolLength, repairs, repairIndices, repairCount);
+    *isRecovered = isDecoded && memcmp(received, block->original, block->mediaCount * block->symbolLength) == 0;
+    free(received);
+    return isDecoded;
+}
+
+@interface CQFECCodecTests : XCTestCase
+
+@end
+
+@implementation CQFECCodecTests
+
+#pragma mark - GF(2^8)
+- (void)testGaloisField {
+    // x^8 = x^4 + x^3 + x^2 + 1 (0x11D)
+    XCTAssertEqual(CQGFMultiply(0x80, 0x02), 0x1D);
+    XCTAssertEqual(CQGFMultiply(0x00, 0x37), 0x00);
+    for (unsigned a = 1; a < 256; a++) {
+        XCTAssertEqual(CQGFMultiply((uint8_t)a, CQGFInverse((uint8_t)a)), 1, @"a %u", a);
+        XCTAssertEqual(CQGFMultiply((uint8_t)a, 1), a);
+        XCTAssertEqual(CQGFMultiply((uint8_t)a, 0x53), CQGFMultiply(0x53, (uint8_t)a));
+    }
+}
+
+- (void)testMultiplyAddMatchesScalar {
+    // 覆盖所有系数，长度包含16字节对齐和非对齐的尾部
+    uint32_t seed = 7;
+    uint8_t src[67], expected[67], actual[67];
+    for (size_t i = 0; i < sizeof(src); i++) src[i] = (uint8_t)CQTestRandom(&seed);
+    for (unsigned coefficient = 0; coefficient < 256; coefficient++) {
+        for (size_t length = 0; length <= sizeof(src); length += 11) {
+            for (size_t i = 0; i < sizeof(src); i++) expected[i] = actual[i] = (uint8_t)i;
+            CQGFMultiplyAddScalar(expected, src, (uint8_t)coefficient, length);
+            CQGFMultiplyAdd(actual, src, (uint8_t)coefficient, length);
+            XCTAssertEqual(memcmp(expected, actual, sizeof(src)), 0, @"coefficient %u length %zu", coefficient, length);
+        }
+        // 和逐字节乘法一致
+        for (size_t i = 0; i < sizeof(src); i++) expected[i] = 0;
+        CQGFMultiplyAddScalar(expected, src, (uint8_t)coefficient, sizeof(src));
+        XCTAssertEqual(expected[13], CQGFMultiply((uint8_t)coefficient, src[13]));
+    }
+}
+
+#pragma mark - XOR
+- (void)testXORRecoversOneLoss {
+    CQTestFECBlock block = CQTestFECBlockCreate(CQFECSchemeXOR, 8, 1, 101, 1);
+    BOOL isLost[9] = {NO};
+    BOOL isRecovered = NO;
+    for (size_t lost = 0; lost < 9; lost++) {
+        memset(isLost, 0, sizeof(isLost));
+        isLost[lost] = YES;
+        XCTAssertTrue(CQTestFECBlockDecode(CQFECSchemeXOR, &block, isLost, &isRecovered));
+        XCTAssertTrue(isRecovered, @"lost %zu", lost);
+    }
+    // 丢两个媒体符号无法恢复
+    memset(isLost, 0, sizeof(isLost));
+    isLost[2] = isLost[5] = YES;
+    XCTAssertFalse(CQTestFECBlockDecode(CQFECSchemeXOR, &block, isLost, &isRecovered));
+    CQTestFECBlockDestroy(&block);
+}
+
+#pragma mark - Reed-Solomon
+- (void)testReedSolomonRecoversAnyMLosses {
+    // 10个媒体符号 + 4个修复符号，枚举14个符号里丢失不超过4个的所有组合(1471种)
+    const size_t mediaCount = 10, repairCount = 4, total = mediaCount + repairCount;
+    CQTestFECBlock block = CQTestFECBlockCreate(CQFECSchemeReedSolomon, mediaCount, repairCount, 173, 2);
+    size_t combinationCount = 0;
+    for (uint32_t mask = 0; mask < (1u << total); mask++) {
+        if (__builtin_popcount(mask) > (int)repairCount) continue;
+        BOOL isLost[14];
+        for (size_t i = 0; i < total; i++) isLost[i] = (mask >> i) & 1;
+        BOOL isRecovered = NO;
+        XCTAssertTrue(CQTestFECBlockDecode(CQFECSchemeReedSolomon, &block, isLost, &isRecovered), @"mask %x", mask);
+        XCTAssertTrue(isRecovered, @"mask %x", mask);
+        combinationCount++;
+    }
+    XCTAssertEqual(combinationCount, 1471u);
+
+    // 丢失m + 1个媒体符号时失败
+    BOOL isLost[14] = {YES, NO, YES, NO, YES, NO, YES, NO, YES, NO, NO, NO, NO, NO};
+    BOOL isRecovered = NO;
+    XCTAssertFalse(CQTestFECBlockDecode(CQFECSchemeReedSolomon, &block, isLost, &isRecovered));
+    CQTestFECBlockDestroy(&block);
+}
+
+- (void)testReedSolomonLargestBlock {
+    // 最大块: 128个媒体符号，随机丢失的位置，丢失数等于修复符号数
+    const size_t mediaCount = CQFECMaxMediaCount, repairCount = 32, total = mediaCount + repairCount;
+    CQTestFECBlock block = CQTestFECBlockCreate(CQFECSchemeReedSolomon, mediaCount, repairCount, 64, 3);
+    uint32_t seed = 11;
+    for (int round = 0; round < 20; round++) {
+        BOOL isLost[kTestMaxSymbolCount] = {NO};
+        size_t lostCount = 0;
+        while (lostCount < repairCount) {
+            size_t index = CQTestRandom(&seed) % total;
+            if (isLost[index]) continue;
+            isLost[index] = YES;
+            lostCount++;
+        }
+        BOOL isRecovered = NO;
+        XCTAssertTrue(CQTestFECBlockDecode(CQFECSchemeReedSolomon, &block, isLost, &isRecovered), @"round %d", round);
+        XCTAssertTrue(isRecovered, @"round %d", round);
+    }
+    CQTestFECBlockDestroy(&block);
+}
+
+@end
@@ -0,0 +1,293 @@
+//
+//  CQFrameClassifierTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQFrameClassifier.h"
+#import "CQTestSupport.h"
+
+#define kTestMaxNaluSize 64
+#define kTestMaxFrameSize 512
+
+/// 一帧数据，Annex-B和AVCC两种格式同时生成
+typedef struct {
+    uint8_t annexB[kTestMaxFrameSize];
+    size_t annexBSize;
+    uint8_t avcc[kTestMaxFrameSize];
+    size_t avccSize;
+} CQTestFrame;
+
+/// 追加一个NALU，奇数个NALU用3字节起始码
+static void CQTestFrameAppend(CQTestFrame *frame, const uint8_t *nalu, size_t size) {
+    static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+    size_t startCodeSize = frame->annexBSize % 2 ? 3 : 4;
+    memcpy(frame->annexB + frame->annexBSize, startCode + 4 - startCodeSize, startCodeSize);
+    memcpy(frame->annexB + frame->annexBSize + startCodeSize, nalu, size);
+    frame->annexBSize += startCodeSize + size;
+    const uint8_t length[] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size};
+    memcpy(frame->avcc + frame->avccSize, length, 4);
+    memcpy(frame->avcc + frame->avccSize + 4, nalu, size);
+    frame->avccSize += 4 + size;
+}
+
+/**
+ 生成H264片
+ @param nalHeader NALU头(nal_ref_idc和类型)
+ @param sliceType 片头的slice_type(0~9)
+ @return NALU长度
+ */
+static size_t CQTestH264Slice(uint8_t nalHeader, uint32_t firstMbInSlice, uint32_t sliceType, uint8_t *output) {
+    uint8_t rbsp[kTestMaxNaluSize] = {0};
+    CQBitWriter writer = CQBitWriterMake(rbsp, sizeof(rbsp));
+    CQBitWriterWriteUE(&writer, firstMbInSlice);
+    CQBitWriterWriteUE(&writer, sliceType);
+    CQBitWriterWriteUE(&writer, 0);  // pic_parameter_set_id
+    CQBitWriterWriteBits(&writer, 0, 4);  // frame_num
+    CQBitWriterWriteBits(&writer, 0, 24);  // 片头之后的负载，全0字节要加防竞争字节
+    return CQTestFinishNalu(&writer, &nalHeader, 1, output);
+}
+
+/**
+ 生成HEVC片
+ @param type NALU类型
+ @param temporalId 时域层
+ @param isFirstSlice first_slice_segment_in_pic_flag
+ @param sliceType 片头的slice_type(0为B，1为P，2为I)
+ */
+static size_t CQTestHEVCSlice(CQHEVCNaluType type, uint8_t temporalId, BOOL isFirstSlice, uint32_t sliceType, uint8_t *output) {
+    uint8_t rbsp[kTestMaxNaluSize] = {0};
+    CQBitWriter writer = CQBitWriterMake(rbsp, sizeof(rbsp));
+    CQBitWriterWriteBit(&writer, isFirstSlice);
+    if (CQHEVCNaluTypeIsIRAP(type)) CQBitWriterWriteBit(&writer, 0);  // no_output_of_prior_pics_flag
+    CQBitWriterWriteUE(&writer, 0);  // slice_pic_parameter_set_id
+    CQBitWriterWriteUE(&writer, sliceType);
+    const uint8_t header[] = {(uint8_t)(type << 1), (uint8_t)(temporalId + 1)};
+    CQBitWriterWriteBits(&writer, 0, 24);  // 片头之后的负载
+    return CQTestFinishNalu(&writer, header, sizeof(header), output);
+}
+
+static void CQTestFrameAppendH264Slice(CQTestFrame *frame, uint8_t nalHeader, uint32_t firstMbInSlice, uint32_t sliceType) {
+    uint8_t nalu[kTestMaxNaluSize];
+    CQTestFrameAppend(frame, nalu, CQTestH264Slice(nalHeader, firstMbInSlice, sliceType, nalu));
+}
+
+static void CQTestFrameAppendHEVCSlice(CQTestFrame *frame, CQHEVCNaluType type, uint8_t temporalId, BOOL isFirstSlice, uint32_t sliceType) {
+    uint8_t nalu[kTestMaxNaluSize];
+    CQTestFrameAppend(frame, nalu, CQTestHEVCSlice(type, temporalId, isFirstSlice, sliceType, nalu));
+}
+
+/// Annex-B和AVCC的分类结果一致
+static BOOL CQTestFrameInfoEqual(CQFrameInfo a, CQFrameInfo b) {
+    return a.frameClass == b.frameClass && a.nalRefIdc == b.nalRefIdc && a.sliceType == b.sliceType
+        && a.temporalLayer == b.temporalLayer && a.sliceCount == b.sliceCount;
+}
+
+@interface CQFrameClassifierTests : XCTestCase
+
+@end
+
+@implementation CQFrameClassifierTests
+
+#pragma mark - Slice Header
+- (void)testH264SliceHeaderParse {
+    uint8_t nalu[kTestMaxNaluSize];
+    uint32_t firstMb = 1;
+    CQH264SliceType sliceType = CQH264SliceTypeUnknown;
+    // slice_type 5~9表示整帧同一类型，取模后一样
+    size_t size = CQTestH264Slice(0x41, 0, 5, nalu);
+    XCTAssertTrue(CQH264SliceHeaderParse(nalu, size, &firstMb, &sliceType));
+    XCTAssertEqual(firstMb, 0u);
+    XCTAssertEqual(sliceType, CQH264SliceTypeP);
+    size = CQTestH264Slice(0x65, 300, 7, nalu);
+    XCTAssertTrue(CQH264SliceHeaderParse(nalu, size, &firstMb, &sliceType));
+    XCTAssertEqual(firstMb, 300u);
+    XCTAssertEqual(sliceType, CQH264SliceTypeI);
+    size = CQTestH264Slice(0x01, 1, 1, nalu);
+    XCTAssertTrue(CQH264SliceHeaderParse(nalu, size, NULL, &sliceType));
+    XCTAssertEqual(sliceType, CQH264SliceTypeB);
+
+    // first_mb_in_slice有22个前导0，片头里出现00 00 02，需要去掉防竞争字节
+    size = CQTestH264Slice(0x41, (1u << 22) - 1, 0, nalu);
+    XCTAssertEqual(nalu[3], 0x03);
+    XCTAssertTrue(CQH264SliceHeaderParse(nalu, size, &firstMb, &sliceType));
+    XCTAssertEqual(firstMb, (1u << 22) - 1);
+    XCTAssertEqual(sliceType, CQH264SliceTypeP);
+
+    // 片头不完整或slice_type超出范围
+    XCTAssertFalse(CQH264SliceHeaderParse(nalu, 1, NULL, NULL));
+    XCTAssertFalse(CQH264SliceHeaderParse(nalu, 3, NULL, NULL));
+    size = CQTestH264Slice(0x41, 0, 10, nalu);
+    XCTAssertFalse(CQH264SliceHeaderParse(nalu, size, NULL, &sliceType));
+}
+
+- (void)testHEVCSliceTypeParse {
+    uint8_t nalu[kTestMaxNaluSize];
+    size_t size = CQTestHEVCSlice(CQHEVCNaluTypeIDRNLP, 0, YES, 2, nalu);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, size), CQH264SliceTypeI);
+    size = CQTestHEVCSlice(CQHEVCNaluTypeTrailR, 0, YES, 1, nalu);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, size), CQH264SliceTypeP);
+    size = CQTestHEVCSlice(CQHEVCNaluTypeTrailN, 1, YES, 0, nalu);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, size), CQH264SliceTypeB);
+    // 不是第一个片时不知道PPS无法解析
+    size = CQTestHEVCSlice(CQHEVCNaluTypeTrailR, 0, NO, 1, nalu);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, size), CQH264SliceTypeUnknown);
+    size = CQTestHEVCSlice(CQHEVCNaluTypeTrailR, 0, YES, 3, nalu);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, size), CQH264SliceTypeUnknown);
+    XCTAssertEqual(CQHEVCSliceTypeParse(nalu, 2), CQH264SliceTypeUnknown);
+}
+
+#pragma mark - H264
+- (void)testClassifyH264Frames {
+    static const uint8_t aud[] = {0x09, 0xF0};
+    static const uint8_t sps[] = {0x67, 0x42, 0xC0, 0x1F, 0xDA, 0x01, 0x40};
+    static const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+    static const uint8_t sei[] = {0x06, 0x05, 0x01, 0xAA, 0x80};
+
+    // 关键帧: AUD + SPS + PPS + SEI + IDR
+    CQTestFrame idr = {0};
+    CQTestFrameAppend(&idr, aud, sizeof(aud));
+    CQTestFrameAppend(&idr, sps, sizeof(sps));
+    CQTestFrameAppend(&idr, pps, sizeof(pps));
+    CQTestFrameAppend(&idr, sei, sizeof(sei));
+    CQTestFrameAppendH264Slice(&idr, 0x65, 0, 7);
+    CQFrameInfo info = CQFrameClassifyAnnexB(CQVideoCodecH264, idr.annexB, idr.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassIDR);
+    XCTAssertEqual(info.nalRefIdc, 3);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeI);
+    XCTAssertEqual(info.temporalLayer, 0);
+    XCTAssertEqual(info.sliceCount, 1);
+    XCTAssertFalse(CQFrameInfoIsDroppable(info));
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecH264, idr.avcc, idr.avccSize)));
+
+    // 参考P帧
+    CQTestFrame reference = {0};
+    CQTestFrameAppendH264Slice(&reference, 0x41, 0, 5);
+    info = CQFrameClassifyAnnexB(CQVideoCodecH264, reference.annexB, reference.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassReference);
+    XCTAssertEqual(info.nalRefIdc, 2);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeP);
+    XCTAssertEqual(info.temporalLayer, 0);
+    XCTAssertFalse(CQFrameInfoIsDroppable(info));
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecH264, reference.avcc, reference.avccSize)));
+
+    // 非参考P帧(nal_ref_idc为0)
+    CQTestFrame nonReference = {0};
+    CQTestFrameAppend(&nonReference, aud, sizeof(aud));
+    CQTestFrameAppendH264Slice(&nonReference, 0x01, 0, 0);
+    info = CQFrameClassifyAnnexB(CQVideoCodecH264, nonReference.annexB, nonReference.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassNonReference);
+    XCTAssertEqual(info.nalRefIdc, 0);
+    XCTAssertEqual(info.temporalLayer, 1);
+    XCTAssertTrue(CQFrameInfoIsDroppable(info));
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecH264, nonReference.avcc, nonReference.avccSize)));
+
+    // 多片: 有一个片被参考整帧就是参考帧，slice_type取第一个片
+    CQTestFrame multiSlice = {0};
+    CQTestFrameAppendH264Slice(&multiSlice, 0x01, 0, 1);
+    CQTestFrameAppendH264Slice(&multiSlice, 0x21, 120, 0);
+    info = CQFrameClassifyAnnexB(CQVideoCodecH264, multiSlice.annexB, multiSlice.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassReference);
+    XCTAssertEqual(info.nalRefIdc, 1);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeB);
+    XCTAssertEqual(info.sliceCount, 2);
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecH264, multiSlice.avcc, multiSlice.avccSize)));
+    // AVCC最后一个NALU的长度超出数据时忽略它
+    info = CQFrameClassifyAVCC(CQVideoCodecH264, multiSlice.avcc, multiSlice.avccSize - 1);
+    XCTAssertEqual(info.frameClass, CQFrameClassNonReference);
+    XCTAssertEqual(info.sliceCount, 1);
+
+    // 只有参数集和SEI，没有图像
+    CQTestFrame parameterSets = {0};
+    CQTestFrameAppend(&parameterSets, sps, sizeof(sps));
+    CQTestFrameAppend(&parameterSets, pps, sizeof(pps));
+    CQTestFrameAppend(&parameterSets, sei, sizeof(sei));
+    info = CQFrameClassifyAnnexB(CQVideoCodecH264, parameterSets.annexB, parameterSets.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassUnknown);
+    XCTAssertEqual(info.sliceCount, 0);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeUnknown);
+    XCTAssertFalse(CQFrameInfoIsDroppable(info));
+}
+
+- (void)testHierarchicalPDropsEveryOtherFrame {
+    // 两层分层P: 偶数帧是参考帧(时域层0)，奇数帧是非参考帧(时域层1)
+    size_t droppableCount = 0;
+    for (uint32_t i = 0; i < 30; i++) {
+        CQTestFrame frame = {0};
+        if (i == 0) {
+            CQTestFrameAppendH264Slice(&frame, 0x65, 0, 7);
+        } else {
+            CQTestFrameAppendH264Slice(&frame, i % 2 ? 0x01 : 0x41, 0, 5);
+        }
+        CQFrameInfo info = CQFrameClassifyAnnexB(CQVideoCodecH264, frame.annexB, frame.annexBSize);
+        XCTAssertEqual(CQFrameInfoIsDroppable(info), (BOOL)(i % 2), @"frame %u", i);
+        XCTAssertEqual(info.temporalLayer, i % 2, @"frame %u", i);
+        if (CQFrameInfoIsDroppable(info)) droppableCount++;
+    }
+    // 丢掉时域层1正好帧率减半
+    XCTAssertEqual(droppableCount, 15u);
+}
+
+#pragma mark - HEVC
+- (void)testClassifyHEVCFrames {
+    static const uint8_t vps[] = {0x40, 0x01, 0x0C, 0x01};
+    static const uint8_t sps[] = {0x42, 0x01, 0x01, 0x01};
+    static const uint8_t pps[] = {0x44, 0x01, 0xC1, 0x72};
+
+    // 关键帧: VPS + SPS + PPS + IDR_N_LP
+    CQTestFrame idr = {0};
+    CQTestFrameAppend(&idr, vps, sizeof(vps));
+    CQTestFrameAppend(&idr, sps, sizeof(sps));
+    CQTestFrameAppend(&idr, pps, sizeof(pps));
+    CQTestFrameAppendHEVCSlice(&idr, CQHEVCNaluTypeIDRNLP, 0, YES, 2);
+    CQFrameInfo info = CQFrameClassifyAnnexB(CQVideoCodecHEVC, idr.annexB, idr.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassIDR);
+    XCTAssertEqual(info.nalRefIdc, 1);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeI);
+    XCTAssertEqual(info.sliceCount, 1);
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecHEVC, idr.avcc, idr.avccSize)));
+
+    // CRA也是关键帧
+    CQTestFrame cra = {0};
+    CQTestFrameAppendHEVCSlice(&cra, CQHEVCNaluTypeCRA, 0, YES, 2);
+    XCTAssertEqual(CQFrameClassifyAnnexB(CQVideoCodecHEVC, cra.annexB, cra.annexBSize).frameClass, CQFrameClassIDR);
+
+    // TRAIL_R在时域层0
+    CQTestFrame reference = {0};
+    CQTestFrameAppendHEVCSlice(&reference, CQHEVCNaluTypeTrailR, 0, YES, 1);
+    info = CQFrameClassifyAnnexB(CQVideoCodecHEVC, reference.annexB, reference.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassReference);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeP);
+    XCTAssertEqual(info.temporalLayer, 0);
+    XCTAssertTrue(CQTestFrameInfoEqual(info, CQFrameClassifyAVCC(CQVideoCodecHEVC, reference.avcc, reference.avccSize)));
+
+    // TRAIL_N在时域层1，可以丢弃
+    CQTestFrame nonReference = {0};
+    CQTestFrameAppendHEVCSlice(&nonReference, CQHEVCNaluTypeTrailN, 1, YES, 1);
+    info = CQFrameClassifyAnnexB(CQVideoCodecHEVC, nonReference.annexB, nonReference.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassNonReference);
+    XCTAssertEqual(info.nalRefIdc, 0);
+    XCTAssertEqual(info.temporalLayer, 1);
+    XCTAssertTrue(CQFrameInfoIsDroppable(info));
+
+    // 多片里有一个参考片整帧就是参考帧
+    CQTestFrame multiSlice = {0};
+    CQTestFrameAppendHEVCSlice(&multiSlice, CQHEVCNaluTypeTrailN, 0, YES, 1);
+    CQTestFrameAppendHEVCSlice(&multiSlice, CQHEVCNaluTypeTrailR, 0, NO, 1);
+    info = CQFrameClassifyAnnexB(CQVideoCodecHEVC, multiSlice.annexB, multiSlice.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassReference);
+    XCTAssertEqual(info.sliceType, CQH264SliceTypeP);
+    XCTAssertEqual(info.sliceCount, 2);
+
+    // 参数集不是图像
+    CQTestFrame parameterSets = {0};
+    CQTestFrameAppend(&parameterSets, vps, sizeof(vps));
+    CQTestFrameAppend(&parameterSets, sps, sizeof(sps));
+    info = CQFrameClassifyAnnexB(CQVideoCodecHEVC, parameterSets.annexB, parameterSets.annexBSize);
+    XCTAssertEqual(info.frameClass, CQFrameClassUnknown);
+    XCTAssertEqual(info.sliceCount, 0);
+}
+
+@end
@@ -0,0 +1,246 @@
+//
+//  CQFrameTransformTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQFrameTransform.h"
+#import "CQTestSupport.h"
+
+/// 分配YUV平面，整个缓冲都是填充字节
+static CQYUVPlanes CQTestTransformPlanesCreate(size_t width, size_t height, BOOL isNV12, BOOL isFullRange) {
+    CQYUVPlanes planes = CQTestPlanesCreate(width, height, isNV12, kTestPaddingByte);
+    planes.isFullRange = isFullRange;
+    return planes;
+}
+
+/// 变换后(x, y)在源上对应的像素位置，不缩放时的参照实现
+static void CQTestSourcePosition(CQFrameRotation rotation, BOOL mirrors, size_t width, size_t height, size_t x, size_t y, size_t *sourceX, size_t *sourceY) {
+    // 旋转后的宽，镜像按旋转后的宽翻转
+    size_t rotatedWidth = (rotation == CQFrameRotation90 || rotation == CQFrameRotation270) ? height : width;
+    if (mirrors) x = rotatedWidth - 1 - x;
+    switch (rotation) {
+        case CQFrameRotation0: *sourceX = x; *sourceY = y; break;
+        case CQFrameRotation90: *sourceX = y; *sourceY = height - 1 - x; break;
+        case CQFrameRotation180: *sourceX = width - 1 - x; *sourceY = height - 1 - y; break;
+        case CQFrameRotation270: *sourceX = width - 1 - y; *sourceY = x; break;
+    }
+}
+
+@interface CQFrameTransformTests : XCTestCase
+
+@end
+
+@implementation CQFrameTransformTests
+
+#pragma mark - Make
+- (void)testMakeAspectModes {
+    // 640x480横屏输出到360x640竖屏
+    CQFrameTransform fill = CQFrameTransformMake(640, 480, CQFrameRotation0, NO, 360, 640, CQFrameScaleModeAspectFill);
+    XCTAssertEqual(fill.cropWidth, 270u);
+    XCTAssertEqual(fill.cropHeight, 480u);
+    XCTAssertEqual(fill.cropX, 184u);
+    XCTAssertEqual(fill.cropY, 0u);
+    XCTAssertEqual(fill.contentWidth, 360u);
+    XCTAssertEqual(fill.contentHeight, 640u);
+    XCTAssertTrue(CQFrameTransformIsValid(&fill, 640, 480));
+
+    CQFrameTransform fit = CQFrameTransformMake(640, 480, CQFrameRotation0, NO, 360, 640, CQFrameScaleModeAspectFit);
+    XCTAssertEqual(fit.cropWidth, 640u);
+    XCTAssertEqual(fit.cropHeight, 480u);
+    XCTAssertEqual(fit.contentWidth, 360u);
+    XCTAssertEqual(fit.contentHeight, 270u);
+    XCTAssertEqual(fit.contentX, 0u);
+    XCTAssertEqual(fit.contentY, 184u);
+    XCTAssertTrue(CQFrameTransformIsValid(&fit, 640, 480));
+
+    // 旋转90度后是480x640，和目标宽高比相同，不裁剪也没有黑边
+    CQFrameTransform rotated = CQFrameTransformMake(640, 480, CQFrameRotation90, YES, 360, 480, CQFrameScaleModeAspectFill);
+    XCTAssertEqual(rotated.cropWidth, 640u);
+    XCTAssertEqual(rotated.cropHeight, 480u);
+    XCTAssertEqual(rotated.contentWidth, 360u);
+    XCTAssertEqual(rotated.contentHeight, 480u);
+
+    CQFrameTransform stretch = CQFrameTransformMake(641, 481, CQFrameRotation0, NO, 100, 100, CQFrameScaleModeStretch);
+    XCTAssertEqual(stretch.cropWidth, 640u);
+    XCTAssertEqual(stretch.cropHeight, 480u);
+    XCTAssertTrue(CQFrameTransformIsValid(&stretch, 641, 481));
+}
+
+- (void)testIsValid {
+    CQFrameTransform transform = CQFrameTransformMake(64, 48, CQFrameRotation0, NO, 32, 24, CQFrameScaleModeStretch);
+    XCTAssertTrue(CQFrameTransformIsValid(&transform, 64, 48));
+    CQFrameTransform invalid = transform;
+    invalid.cropX = 1;
+    XCTAssertFalse(CQFrameTransformIsValid(&invalid, 64, 48));
+    invalid = transform;
+    invalid.cropX = 2;
+    XCTAssertFalse(CQFrameTransformIsValid(&invalid, 64, 48));
+    invalid = transform;
+    invalid.contentX = 2;
+    XCTAssertFalse(CQFrameTransformIsValid(&invalid, 64, 48));
+    invalid = transform;
+    invalid.contentHeight = 0;
+    XCTAssertFalse(CQFrameTransformIsValid(&invalid, 64, 48));
+    invalid = transform;
+    invalid.rotation = 4;
+    XCTAssertFalse(CQFrameTransformIsValid(&invalid, 64, 48));
+}
+
+#pragma mark - Geometry
+- (void)testUnscaledRotationAndMirrorMovePixelsExactly {
+    // 不缩放时是纯粹的像素搬移，和参照实现逐像素比较；宽高不是8的倍数，覆盖转置和逐像素两条路径
+    const size_t width = 28, height = 20;
+    for (int layout = 0; layout < 2; layout++) {
+        BOOL isNV12 = layout == 0;
+        CQYUVPlanes source = CQTestTransformPlanesCreate(width, height, isNV12, YES);
+        uint32_t seed = 3;
+        CQTestPlanesFillRandom(&source, 0, 0, &seed);
+        for (int rotation = 0; rotation < 4; rotation++) {
+            for (int mirrors = 0; mirrors < 2; mirrors++) {
+                BOOL swapsAxes = rotation % 2;
+                size_t outputWidth = swapsAxes ? height : width, outputHeight = swapsAxes ? width : height;
+                CQFrameTransform transform = CQFrameTransformMake(width, height, (CQFrameRotation)rotation, mirrors, outputWidth, outputHeight, CQFrameScaleModeStretch);
+                CQYUVPlanes destination = CQTestTransformPlanesCreate(outputWidth, outputHeight, isNV12, YES);
+                CQYUVTransformRows(&source, &destination, &transform, 0, outputHeight);
+                BOOL isEqual = YES;
+                for (size_t y = 0; y < outputHeight; y++) {
+                    for (size_t x = 0; x < outputWidth; x++) {
+                        size_t sourceX, sourceY;
+                        CQTestSourcePosition((CQFrameRotation)rotation, mirrors, width, height, x, y, &sourceX, &sourceY);
+                        isEqual &= destination.y[y * destination.yBytesPerRow + x] == source.y[sourceY * source.yBytesPerRow + sourceX];
+                    }
+                }
+                for (size_t y = 0; y < outputHeight / 2; y++) {
+                    for (size_t x = 0; x < outputWidth / 2; x++) {
+                        size_t sourceX, sourceY;
+                        CQTestSourcePosition((CQFrameRotation)rotation, mirrors, width / 2, height / 2, x, y, &sourceX, &sourceY);
+                        if (isNV12) {
+                            isEqual &= destination.u[y * destination.uBytesPerRow + x * 2] == source.u[sourceY * source.uBytesPerRow + sourceX * 2];
+                            isEqual &= destination.u[y * destination.uBytesPerRow + x * 2 + 1] == source.u[sourceY * source.uBytesPerRow + sourceX * 2 + 1];
+                        } else {
+                            isEqual &= destination.u[y * destination.uBytesPerRow + x] == source.u[sourceY * source.uBytesPerRow + sourceX];
+                            isEqual &= destination.v[y * destination.vBytesPerRow + x] == source.v[sourceY * source.vBytesPerRow + sourceX];
+                        }
+                    }
+                }
+                XCTAssertTrue(isEqual, @"rotation %d mirrors %d NV12 %d", rotation, mirrors, isNV12);
+                // 填充没有被改写
+                XCTAssertEqual(destination.y[destination.yBytesPerRow - 1], kTestPaddingByte);
+                XCTAssertEqual(destination.u[destination.uBytesPerRow * (outputHeight / 2) - 1], kTestPaddingByte);
+                CQTestPlanesFree(&destination);
+            }
+        }
+        CQTestPlanesFree(&source);
+    }
+}
+
+- (void)testHalfScaleAveragesPairs {
+    // 水平渐变缩小一半: 目标第i个像素取源2i和2i + 1的中点
+    const size_t width = 32, height = 8;
+    CQYUVPlanes source = CQTestTransformPlanesCreate(width, height, YES, YES);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) source.y[y * source.yBytesPerRow + x] = (uint8_t)(x * 2);
+    }
+    memset(source.u, 100, source.uBytesPerRow * height / 2);
+    CQFrameTransform transform = CQFrameTransformMake(width, height, CQFrameRotation0, NO, width / 2, height / 2, CQFrameScaleModeStretch);
+    CQYUVPlanes destination = CQTestTransformPlanesCreate(width / 2, height / 2, YES, YES);
+    CQYUVTransformRows(&source, &destination, &transform, 0, height / 2);
+    for (size_t y = 0; y < height / 2; y++) {
+        for (size_t x = 0; x < width / 2; x++) {
+            XCTAssertEqual(destination.y[y * destination.yBytesPerRow + x], x * 4 + 1, @"(%zu, %zu)", x, y);
+        }
+    }
+    XCTAssertEqual(destination.u[0], 100);
+    XCTAssertEqual(destination.u[destination.uBytesPerRow * 2 - kTestPadding - 1], 100);
+    CQTestPlanesFree(&source);
+    CQTestPlanesFree(&destination);
+}
+
+- (void)testAspectFitFillsBlackBars {
+    // 16x16输出到32x16，左右各8列黑边
+    CQYUVPlanes source = CQTestTransformPlanesCreate(16, 16, NO, NO);
+    memset(source.y, 200, source.yBytesPerRow * 16);
+    memset(source.u, 60, source.uBytesPerRow * 8);
+    memset(source.v, 190, source.vBytesPerRow * 8);
+    CQFrameTransform transform = CQFrameTransformMake(16, 16, CQFrameRotation0, NO, 32, 16, CQFrameScaleModeAspectFit);
+    XCTAssertEqual(transform.contentX, 8u);
+    XCTAssertEqual(transform.contentWidth, 16u);
+    CQYUVPlanes destination = CQTestTransformPlanesCreate(32, 16, NO, NO);
+    CQYUVTransformRows(&source, &destination, &transform, 0, 16);
+    for (size_t y = 0; y < 16; y++) {
+        const uint8_t *row = destination.y + y * destination.yBytesPerRow;
+        // 视频范围的黑是16
+        XCTAssertTrue(row[0] == 16 && row[7] == 16 && row[8] == 200 && row[23] == 200 && row[24] == 16 && row[31] == 16, @"row %zu", y);
+    }
+    for (size_t y = 0; y < 8; y++) {
+        const uint8_t *u = destination.u + y * destination.uBytesPerRow, *v = destination.v + y * destination.vBytesPerRow;
+        XCTAssertTrue(u[0] == 128 && u[4] == 60 && u[12] == 128 && v[3] == 128 && v[11] == 190, @"row %zu", y);
+    }
+    CQTestPlanesFree(&source);
+    CQTestPlanesFree(&destination);
+
+    // 上下黑边，NV12全范围: 亮度0，UV交错的128
+    source = CQTestTransformPlanesCreate(32, 16, YES, YES);
+    memset(source.y, 200, source.yBytesPerRow * 16);
+    memset(source.u, 60, source.uBytesPerRow * 8);
+    transform = CQFrameTransformMake(32, 16, CQFrameRotation0, NO, 32, 32, CQFrameScaleModeAspectFit);
+    XCTAssertEqual(transform.contentY, 8u);
+    destination = CQTestTransformPlanesCreate(32, 32, YES, YES);
+    CQYUVTransformRows(&source, &destination, &transform, 0, 32);
+    XCTAssertEqual(destination.y[0], 0);
+    XCTAssertEqual(destination.y[8 * destination.yBytesPerRow], 200);
+    XCTAssertEqual(destination.y[24 * destination.yBytesPerRow + 31], 0);
+    XCTAssertEqual(destination.u[1], 128);
+    XCTAssertEqual(destination.u[4 * destination.uBytesPerRow + 1], 60);
+    CQTestPlanesFree(&source);
+    CQTestPlanesFree(&destination);
+}
+
+#pragma mark - NEON
+- (void)testNEONMatchesScalar {
+    // 缩放、裁剪、旋转、镜像、黑边的各种组合，NEON和标量逐字节相同
+    typedef struct {
+        size_t width, height, outputWidth, outputHeight;
+        CQFrameScaleMode mode;
+    } CQTestCase;
+    static const CQTestCase cases[] = {
+        {64, 48, 64, 48, CQFrameScaleModeStretch},
+        {64, 48, 40, 30, CQFrameScaleModeStretch},
+        {70, 38, 96, 80, CQFrameScaleModeAspectFit},
+        {72, 40, 36, 36, CQFrameScaleModeAspectFill},
+        {36, 24, 50, 34, CQFrameScaleModeStretch},
+    };
+    uint32_t seed = 5;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (int layout = 0; layout < 2; layout++) {
+            CQYUVPlanes source = CQTestTransformPlanesCreate(cases[c].width, cases[c].height, layout == 0, NO);
+            CQTestPlanesFillRandom(&source, 0, 0, &seed);
+            for (int rotation = 0; rotation < 4; rotation++) {
+                for (int mirrors = 0; mirrors < 2; mirrors++) {
+                    CQFrameTransform transform = CQFrameTransformMake(cases[c].width, cases[c].height, (CQFrameRotation)rotation, mirrors, cases[c].outputWidth, cases[c].outputHeight, cases[c].mode);
+                    XCTAssertTrue(CQFrameTransformIsValid(&transform, cases[c].width, cases[c].height));
+                    CQYUVPlanes scalar = CQTestTransformPlanesCreate(cases[c].outputWidth, cases[c].outputHeight, layout == 0, NO);
+                    CQYUVPlanes vector = CQTestTransformPlanesCreate(cases[c].outputWidth, cases[c].outputHeight, layout == 0, NO);
+                    CQYUVPlanes banded = CQTestTransformPlanesCreate(cases[c].outputWidth, cases[c].outputHeight, layout == 0, NO);
+                    CQYUVTransformRowsScalar(&source, &scalar, &transform, 0, cases[c].outputHeight);
+                    CQYUVTransformRows(&source, &vector, &transform, 0, cases[c].outputHeight);
+                    // 按16行分段变换，拼起来和整帧一样
+                    for (size_t row = 0; row < cases[c].outputHeight; row += 16) {
+                        CQYUVTransformRows(&source, &banded, &transform, row, row + 16);
+                    }
+                    XCTAssertTrue(CQTestPlanesEqual(&scalar, &vector), @"case %zu rotation %d mirrors %d NV12 %d", c, rotation, mirrors, layout == 0);
+                    XCTAssertTrue(CQTestPlanesEqual(&scalar, &banded), @"case %zu rotation %d mirrors %d NV12 %d", c, rotation, mirrors, layout == 0);
+                    CQTestPlanesFree(&scalar);
+                    CQTestPlanesFree(&vector);
+                    CQTestPlanesFree(&banded);
+                }
+            }
+            CQTestPlanesFree(&source);
+        }
+    }
+}
+
+@end
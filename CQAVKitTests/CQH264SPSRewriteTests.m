@@ -0,0 +1,165 @@
+//
+//  CQH264SPSRewriteTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQH264ParameterSets.h"
+#import "CQNaluUtil.h"
+#import "CQTestSupport.h"
+
+/**
+ 1280x720(80x45个宏块)、POC类型0的SPS参数
+ @param hasVUI 有VUI时带宽高比(Extended_SAR)、色彩描述、timing_info、NAL HRD和bitstream_restriction
+ */
+static CQTestSPSConfig CQTestRewriteSPSConfig(uint8_t profileIdc, uint32_t maxNumRefFrames, BOOL hasVUI, uint32_t maxNumReorderFrames, uint32_t maxDecFrameBuffering) {
+    CQTestSPSConfig config = CQTestSPSConfigMake(profileIdc);
+    config.constraintFlags = 0;
+    config.levelIdc = 40;
+    config.picOrderCntType = 0;
+    config.log2MaxPicOrderCntLsb = 6;
+    config.maxNumRefFrames = maxNumRefFrames;
+    config.widthInMbs = 80;
+    config.heightInMbs = 45;
+    config.cropBottom = 0;
+    config.hasVUI = hasVUI;
+    config.maxNumReorderFrames = maxNumReorderFrames;
+    config.maxDecFrameBuffering = maxDecFrameBuffering;
+    return config;
+}
+
+/// 起始码之后没有00 00 00~02(防竞争字节完整)
+static BOOL CQTestHasNoStartCodeEmulation(const uint8_t *nalu, size_t size) {
+    for (size_t i = 0; i + 2 < size; i++) {
+        if (nalu[i] == 0 && nalu[i + 1] == 0 && nalu[i + 2] <= 0x02) return NO;
+    }
+    return YES;
+}
+
+/// 两个SPS除VUI外的字段一致
+static BOOL CQTestSPSFieldsEqual(const CQH264SPSInfo *a, const CQH264SPSInfo *b) {
+    return a->profileIdc == b->profileIdc && a->constraintFlags == b->constraintFlags && a->levelIdc == b->levelIdc
+        && a->spsId == b->spsId && a->chromaFormatIdc == b->chromaFormatIdc && a->log2MaxFrameNum == b->log2MaxFrameNum
+        && a->picOrderCntType == b->picOrderCntType && a->maxNumRefFrames == b->maxNumRefFrames
+        && a->frameMbsOnlyFlag == b->frameMbsOnlyFlag && a->width == b->width && a->height == b->height;
+}
+
+@interface CQH264SPSRewriteTests : XCTestCase
+
+@end
+
+@implementation CQH264SPSRewriteTests
+
+#pragma mark - Rewrite
+- (void)testAddsVUIWhenMissing {
+    CQTestSPSConfig config = CQTestRewriteSPSConfig(66, 1, NO, 0, 0);
+    uint8_t sps[kTestMaxSPSSize];
+    size_t size = CQTestH264SPS(config, sps);
+    CQH264SPSInfo original;
+    XCTAssertTrue(CQH264SPSParse(sps, size, &original));
+    XCTAssertFalse(original.vuiParametersPresentFlag);
+    XCTAssertEqual(original.width, 1280u);
+    XCTAssertEqual(original.height, 720u);
+
+    // num_units_in_tick = 1写出31个0，必须加防竞争字节
+    CQH264VUIOverride vui = CQH264VUIOverrideMake(30);
+    uint8_t rewritten[kTestMaxSPSSize + 64];
+    size_t rewrittenSize = CQH264SPSRewriteVUI(sps, size, &vui, rewritten, sizeof(rewritten));
+    XCTAssertGreaterThan(rewrittenSize, size);
+    XCTAssertEqual(rewritten[0], 0x67);
+    XCTAssertTrue(CQTestHasNoStartCodeEmulation(rewritten, rewrittenSize));
+
+    CQH264SPSInfo info;
+    XCTAssertTrue(CQH264SPSParse(rewritten, rewrittenSize, &info));
+    XCTAssertTrue(CQTestSPSFieldsEqual(&info, &original));
+    XCTAssertTrue(info.vuiParametersPresentFlag);
+    XCTAssertTrue(info.timingInfoPresentFlag);
+    XCTAssertEqual(info.numUnitsInTick, 1u);
+    XCTAssertEqual(info.timeScale, 60u);
+    XCTAssertFalse(info.fixedFrameRateFlag);
+    XCTAssertTrue(info.bitstreamRestrictionFlag);
+    XCTAssertEqual(info.maxNumReorderFrames, 0u);
+    XCTAssertEqual(info.maxDecFrameBuffering, 1u);
+
+    // 改写结果再改写一次不变
+    uint8_t again[kTestMaxSPSSize + 64];
+    XCTAssertEqual(CQH264SPSRewriteVUI(rewritten, rewrittenSize, &vui, again, sizeof(again)), rewrittenSize);
+    XCTAssertEqual(memcmp(again, rewritten, rewrittenSize), 0);
+}
+
+- (void)testKeepsExistingVUIFields {
+    // 原来的VUI: 重排序2帧，解码缓冲4帧，有HRD
+    CQTestSPSConfig config = CQTestRewriteSPSConfig(100, 3, YES, 2, 4);
+    uint8_t sps[kTestMaxSPSSize];
+    size_t size = CQTestH264SPS(config, sps);
+    CQH264SPSInfo original;
+    XCTAssertTrue(CQH264SPSParse(sps, size, &original));
+    XCTAssertTrue(original.vuiParametersPresentFlag);
+    XCTAssertEqual(original.numUnitsInTick, 1001u);
+    XCTAssertEqual(original.maxNumReorderFrames, 2u);
+    XCTAssertEqual(original.maxDecFrameBuffering, 4u);
+
+    // numUnitsInTick为0时保留原来的timing_info，只改bitstream_restriction
+    CQH264VUIOverride vui = {0, 0, NO, 0};
+    uint8_t rewritten[kTestMaxSPSSize + 64];
+    size_t rewrittenSize = CQH264SPSRewriteVUI(sps, size, &vui, rewritten, sizeof(rewritten));
+    XCTAssertGreaterThan(rewrittenSize, 0u);
+    XCTAssertTrue(CQTestHasNoStartCodeEmulation(rewritten, rewrittenSize));
+    CQH264SPSInfo info;
+    XCTAssertTrue(CQH264SPSParse(rewritten, rewrittenSize, &info));
+    XCTAssertTrue(CQTestSPSFieldsEqual(&info, &original));
+    // 宽高比、色彩、HRD按位拷贝，错一位后面的字段都会读错
+    XCTAssertTrue(info.vuiParametersPresentFlag);
+    XCTAssertEqual(info.numUnitsInTick, 1001u);
+    XCTAssertEqual(info.timeScale, 60000u);
+    XCTAssertTrue(info.fixedFrameRateFlag);
+    XCTAssertEqual(info.maxNumReorderFrames, 0u);
+    XCTAssertEqual(info.maxDecFrameBuffering, 3u);
+    // 只有两个ue(v)变短
+    XCTAssertLessThanOrEqual(rewrittenSize, size);
+
+    // 改写timing_info
+    vui = CQH264VUIOverrideMake(25);
+    rewrittenSize = CQH264SPSRewriteVUI(sps, size, &vui, rewritten, sizeof(rewritten));
+    XCTAssertTrue(CQH264SPSParse(rewritten, rewrittenSize, &info));
+    XCTAssertEqual(info.numUnitsInTick, 1u);
+    XCTAssertEqual(info.timeScale, 50u);
+    XCTAssertFalse(info.fixedFrameRateFlag);
+    XCTAssertEqual(info.maxNumReorderFrames, 0u);
+    XCTAssertEqual(info.maxDecFrameBuffering, 3u);
+}
+
+- (void)testMaxDecFrameBufferingCoversReorder {
+    // max_dec_frame_buffering不能小于max_num_reorder_frames
+    CQTestSPSConfig config = CQTestRewriteSPSConfig(66, 1, NO, 0, 0);
+    uint8_t sps[kTestMaxSPSSize];
+    size_t size = CQTestH264SPS(config, sps);
+    CQH264VUIOverride vui = {1, 60, YES, 2};
+    uint8_t rewritten[kTestMaxSPSSize + 64];
+    size_t rewrittenSize = CQH264SPSRewriteVUI(sps, size, &vui, rewritten, sizeof(rewritten));
+    CQH264SPSInfo info;
+    XCTAssertTrue(CQH264SPSParse(rewritten, rewrittenSize, &info));
+    XCTAssertTrue(info.fixedFrameRateFlag);
+    XCTAssertEqual(info.maxNumReorderFrames, 2u);
+    XCTAssertEqual(info.maxDecFrameBuffering, 2u);
+}
+
+#pragma mark - Failure
+- (void)testRejectsInvalidInput {
+    CQTestSPSConfig config = CQTestRewriteSPSConfig(66, 1, NO, 0, 0);
+    uint8_t sps[kTestMaxSPSSize];
+    size_t size = CQTestH264SPS(config, sps);
+    CQH264VUIOverride vui = CQH264VUIOverrideMake(30);
+    uint8_t rewritten[kTestMaxSPSSize + 64];
+    // 容量不足
+    XCTAssertEqual(CQH264SPSRewriteVUI(sps, size, &vui, rewritten, size), 0u);
+    // SPS不完整
+    XCTAssertEqual(CQH264SPSRewriteVUI(sps, 5, &vui, rewritten, sizeof(rewritten)), 0u);
+    // 不是SPS
+    const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+    XCTAssertEqual(CQH264SPSRewriteVUI(pps, sizeof(pps), &vui, rewritten, sizeof(rewritten)), 0u);
+}
+
+@end
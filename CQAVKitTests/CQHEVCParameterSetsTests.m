@@ -0,0 +1,340 @@
+//
+//  CQHEVCParameterSetsTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQHEVCParameterSets.h"
+#import "CQNaluUtil.h"
+#import "CQTestSupport.h"
+
+#define kTestMaxHEVCSPSSize 256
+
+/// 生成HEVC SPS的参数
+typedef struct {
+    uint8_t maxSubLayersMinus1;
+    BOOL temporalIdNestingFlag;
+    uint8_t profileSpace;
+    uint8_t tierFlag;
+    uint8_t profileIdc;
+    uint32_t compatibilityFlags;
+    uint64_t constraintFlags;  ///< 低48位
+    uint8_t levelIdc;
+    uint8_t subLayerProfilePresentMask;  ///< 第i位为子层i的sub_layer_profile_present_flag
+    uint8_t subLayerLevelPresentMask;
+    uint32_t chromaFormatIdc;
+    uint32_t width;  ///< pic_width_in_luma_samples
+    uint32_t height;
+    uint32_t conformanceWindow[4];  ///< 左右上下，全0时不写裁剪窗口
+    uint32_t bitDepthLumaMinus8;
+    uint32_t bitDepthChromaMinus8;
+} CQTestHEVCSPSConfig;
+
+/// Main、level 4.1、1920x1088裁剪成1080，只有一个时域层
+static CQTestHEVCSPSConfig CQTestHEVCSPSConfigMake(void) {
+    CQTestHEVCSPSConfig config = {0};
+    config.temporalIdNestingFlag = YES;
+    config.profileIdc = 1;
+    config.compatibilityFlags = 0x60000000;
+    config.constraintFlags = 0x900000000000;  // progressive_source_flag, frame_only_constraint_flag
+    config.levelIdc = 123;
+    config.chromaFormatIdc = 1;
+    config.width = 1920;
+    config.height = 1088;
+    config.conformanceWindow[3] = 4;
+    return config;
+}
+
+/// 按config生成SPS，写到位深为止，子层的profile/level用0xA5填充，错位时会读出别的值
+static size_t CQTestHEVCSPS(CQTestHEVCSPSConfig config, uint8_t *output) {
+    uint8_t rbsp[kTestMaxHEVCSPSSize] = {0};
+    CQBitWriter writer = CQBitWriterMake(rbsp, sizeof(rbsp));
+    CQBitWriterWriteBits(&writer, 0, 4);  // sps_video_parameter_set_id
+    CQBitWriterWriteBits(&writer, config.maxSubLayersMinus1, 3);
+    CQBitWriterWriteBit(&writer, config.temporalIdNestingFlag);
+    CQBitWriterWriteBits(&writer, config.profileSpace, 2);
+    CQBitWriterWriteBit(&writer, config.tierFlag);
+    CQBitWriterWriteBits(&writer, config.profileIdc, 5);
+    CQBitWriterWriteBits(&writer, config.compatibilityFlags, 32);
+    CQBitWriterWriteBits(&writer, (uint32_t)(config.constraintFlags >> 32), 16);
+    CQBitWriterWriteBits(&writer, (uint32_t)config.constraintFlags, 32);
+    CQBitWriterWriteBits(&writer, config.levelIdc, 8);
+    for (int i = 0; i < config.maxSubLayersMinus1; i++) {
+        CQBitWriterWriteBit(&writer, (config.subLayerProfilePresentMask >> i) & 1);
+        CQBitWriterWriteBit(&writer, (config.subLayerLevelPresentMask >> i) & 1);
+    }
+    if (config.maxSubLayersMinus1 > 0) {
+        CQBitWriterWriteBits(&writer, 0, 2 * (8 - config.maxSubLayersMinus1));  // reserved_zero_2bits
+    }
+    for (int i = 0; i < config.maxSubLayersMinus1; i++) {
+        if ((config.subLayerProfilePresentMask >> i) & 1) {
+            for (int j = 0; j < 11; j++) CQBitWriterWriteBits(&writer, 0xA5, 8);
+        }
+        if ((config.subLayerLevelPresentMask >> i) & 1) CQBitWriterWriteBits(&writer, 0xA5, 8);
+    }
+    CQBitWriterWriteUE(&writer, 0);  // sps_seq_parameter_set_id
+    CQBitWriterWriteUE(&writer, config.chromaFormatIdc);
+    if (config.chromaFormatIdc == 3) CQBitWriterWriteBit(&writer, 0);  // separate_colour_plane_flag
+    CQBitWriterWriteUE(&writer, config.width);
+    CQBitWriterWriteUE(&writer, config.height);
+    const uint32_t *window = config.conformanceWindow;
+    BOOL hasWindow = window[0] || window[1] || window[2] || window[3];
+    CQBitWriterWriteBit(&writer, hasWindow);
+    if (hasWindow) {
+        for (int i = 0; i < 4; i++) CQBitWriterWriteUE(&writer, window[i]);
+    }
+    CQBitWriterWriteUE(&writer, config.bitDepthLumaMinus8);
+    CQBitWriterWriteUE(&writer, config.bitDepthChromaMinus8);
+    const uint8_t header[] = {CQHEVCNaluTypeSPS << 1, 0x01};
+    return CQTestFinishNalu(&writer, header, sizeof(header), output);
+}
+
+/// 解析结果和生成参数一致，宽高是裁剪后的
+static BOOL CQTestSPSInfoMatches(const CQHEVCSPSInfo *info, CQTestHEVCSPSConfig config, uint32_t width, uint32_t height) {
+    return info->maxSubLayersMinus1 == config.maxSubLayersMinus1 && info->temporalIdNestingFlag == config.temporalIdNestingFlag
+        && info->generalProfileSpace == config.profileSpace && info->generalTierFlag == config.tierFlag
+        && info->generalProfileIdc == config.profileIdc && info->generalProfileCompatibilityFlags == config.compatibilityFlags
+        && info->generalConstraintIndicatorFlags == config.constraintFlags && info->generalLevelIdc == config.levelIdc
+        && info->chromaFormatIdc == config.chromaFormatIdc && info->bitDepthLumaMinus8 == config.bitDepthLumaMinus8
+        && info->bitDepthChromaMinus8 == config.bitDepthChromaMinus8 && info->width == width && info->height == height;
+}
+
+@interface CQHEVCParameterSetsTests : XCTestCase
+
+@end
+
+@implementation CQHEVCParameterSetsTests
+
+#pragma mark - NALU Header
+- (void)testNaluHeaderTypeAndTemporalId {
+    // 2字节NALU头: forbidden_zero_bit(1) + nal_unit_type(6) + nuh_layer_id(6) + nuh_temporal_id_plus1(3)
+    for (uint8_t type = 0; type < 64; type++) {
+        for (uint8_t temporalId = 0; temporalId < 7; temporalId++) {
+            for (uint8_t layerId = 0; layerId < 64; layerId += 21) {
+                const uint8_t header[] = {(uint8_t)((type << 1) | (layerId >> 5)), (uint8_t)((layerId << 3) | (temporalId + 1))};
+                XCTAssertEqual(CQHEVCNaluTypeOf(header), type);
+                XCTAssertEqual(CQHEVCTemporalIdOf(header), temporalId);
+            }
+        }
+    }
+    XCTAssertEqual(CQNaluHeaderSize(CQVideoCodecHEVC), 2u);
+}
+
+- (void)testIRAPAndSubLayerNonReference {
+    for (uint8_t type = 0; type < 64; type++) {
+        XCTAssertEqual(CQHEVCNaluTypeIsIRAP(type), type >= 16 && type <= 23, @"type %d", type);
+        // TRAIL_N、TSA_N、STSA_N、RADL_N、RASL_N和保留的RSV_VCL_N10/12/14
+        XCTAssertEqual(CQHEVCNaluTypeIsSubLayerNonReference(type), type <= 14 && type % 2 == 0, @"type %d", type);
+    }
+    XCTAssertTrue(CQHEVCNaluTypeIsIRAP(CQHEVCNaluTypeIDRNLP));
+    XCTAssertTrue(CQHEVCNaluTypeIsIRAP(CQHEVCNaluTypeCRA));
+    XCTAssertFalse(CQHEVCNaluTypeIsIRAP(CQHEVCNaluTypeTrailR));
+    XCTAssertTrue(CQHEVCNaluTypeIsSubLayerNonReference(CQHEVCNaluTypeTrailN));
+    XCTAssertFalse(CQHEVCNaluTypeIsSubLayerNonReference(CQHEVCNaluTypeTrailR));
+}
+
+- (void)testNaluKind {
+    for (uint8_t type = 0; type < 64; type++) {
+        const uint8_t header[] = {(uint8_t)(type << 1), 0x01};
+        CQNaluKind expected = CQNaluKindOther;
+        if (type <= 15) expected = CQNaluKindSlice;
+        else if (type <= 21) expected = CQNaluKindKeyFrame;  // 22、23是保留的IRAP，不当作图像
+        else if (type >= 32 && type <= 34) expected = CQNaluKindParameterSet;
+        else if (type == 35) expected = CQNaluKindAUD;
+        else if (type == 39 || type == 40) expected = CQNaluKindSEI;
+        XCTAssertEqual(CQNaluKindOf(CQVideoCodecHEVC, header), expected, @"type %d", type);
+    }
+}
+
+#pragma mark - SPS
+- (void)testSPSPrefixFields {
+    CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+    uint8_t sps[kTestMaxHEVCSPSSize * 2];
+    size_t size = CQTestHEVCSPS(config, sps);
+    CQHEVCSPSInfo info;
+    XCTAssertTrue(CQHEVCSPSParse(sps, size, &info));
+    // 下边裁剪4个色度行，4:2:0是8个亮度行
+    XCTAssertTrue(CQTestSPSInfoMatches(&info, config, 1920, 1080));
+
+    // Main10、High tier、profile_space 1
+    config.profileSpace = 1;
+    config.tierFlag = 1;
+    config.profileIdc = 2;
+    config.compatibilityFlags = 0x20000000;
+    config.levelIdc = 153;
+    config.bitDepthLumaMinus8 = 2;
+    config.bitDepthChromaMinus8 = 2;
+    size = CQTestHEVCSPS(config, sps);
+    XCTAssertTrue(CQHEVCSPSParse(sps, size, &info));
+    XCTAssertTrue(CQTestSPSInfoMatches(&info, config, 1920, 1080));
+}
+
+- (void)testSPSSubLayers {
+    // 子层数1~7，profile/level存在标志的各种组合，后面的字段位置都要对
+    for (uint8_t maxSubLayersMinus1 = 0; maxSubLayersMinus1 < 7; maxSubLayersMinus1++) {
+        for (int pattern = 0; pattern < 4; pattern++) {
+            CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+            config.maxSubLayersMinus1 = maxSubLayersMinus1;
+            config.temporalIdNestingFlag = pattern % 2;
+            config.subLayerProfilePresentMask = (uint8_t[]){0x00, 0x7F, 0x55, 0x2A}[pattern];
+            config.subLayerLevelPresentMask = (uint8_t[]){0x00, 0x7F, 0x33, 0x4C}[pattern];
+            uint8_t sps[kTestMaxHEVCSPSSize * 2];
+            size_t size = CQTestHEVCSPS(config, sps);
+            CQHEVCSPSInfo info;
+            XCTAssertTrue(CQHEVCSPSParse(sps, size, &info), @"subLayers %d pattern %d", maxSubLayersMinus1 + 1, pattern);
+            XCTAssertTrue(CQTestSPSInfoMatches(&info, config, 1920, 1080), @"subLayers %d pattern %d", maxSubLayersMinus1 + 1, pattern);
+        }
+    }
+}
+
+- (void)testSPSConformanceWindowUnits {
+    // 裁剪窗口以色度采样为单位: 4:2:0水平垂直都是2，4:2:2只有水平是2，4:4:4和单色是1
+    static const uint32_t kSubWidth[] = {1, 2, 2, 1};
+    static const uint32_t kSubHeight[] = {1, 2, 1, 1};
+    for (uint32_t chromaFormatIdc = 0; chromaFormatIdc < 4; chromaFormatIdc++) {
+        CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+        config.chromaFormatIdc = chromaFormatIdc;
+        config.width = 1280;
+        config.height = 736;
+        config.conformanceWindow[0] = 1;
+        config.conformanceWindow[1] = 3;
+        config.conformanceWindow[2] = 2;
+        config.conformanceWindow[3] = 6;
+        uint8_t sps[kTestMaxHEVCSPSSize * 2];
+        size_t size = CQTestHEVCSPS(config, sps);
+        CQHEVCSPSInfo info;
+        XCTAssertTrue(CQHEVCSPSParse(sps, size, &info), @"chroma %u", chromaFormatIdc);
+        XCTAssertEqual(info.chromaFormatIdc, chromaFormatIdc);
+        XCTAssertEqual(info.width, 1280 - 4 * kSubWidth[chromaFormatIdc], @"chroma %u", chromaFormatIdc);
+        XCTAssertEqual(info.height, 736 - 8 * kSubHeight[chromaFormatIdc], @"chroma %u", chromaFormatIdc);
+    }
+}
+
+- (void)testSPSWithEmulationPrevention {
+    // 兼容标志和约束标志全0，RBSP里有连续的0，NALU里必须有防竞争字节
+    CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+    config.compatibilityFlags = 0;
+    config.constraintFlags = 0;
+    uint8_t sps[kTestMaxHEVCSPSSize * 2];
+    size_t size = CQTestHEVCSPS(config, sps);
+    BOOL hasEmulationPrevention = NO;
+    for (size_t i = 2; i + 2 < size; i++) {
+        hasEmulationPrevention |= sps[i] == 0 && sps[i + 1] == 0 && sps[i + 2] == 0x03;
+    }
+    XCTAssertTrue(hasEmulationPrevention);
+    CQHEVCSPSInfo info;
+    XCTAssertTrue(CQHEVCSPSParse(sps, size, &info));
+    XCTAssertTrue(CQTestSPSInfoMatches(&info, config, 1920, 1080));
+}
+
+- (void)testSPSRejectsInvalidInput {
+    CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+    uint8_t sps[kTestMaxHEVCSPSSize * 2];
+    size_t size = CQTestHEVCSPS(config, sps);
+    CQHEVCSPSInfo info;
+    // 不是SPS
+    sps[0] = CQHEVCNaluTypePPS << 1;
+    XCTAssertFalse(CQHEVCSPSParse(sps, size, &info));
+    sps[0] = CQHEVCNaluTypeSPS << 1;
+    XCTAssertTrue(CQHEVCSPSParse(sps, size, &info));
+    // 太短、截断在宽高之前
+    XCTAssertFalse(CQHEVCSPSParse(sps, 3, &info));
+    XCTAssertFalse(CQHEVCSPSParse(sps, 16, &info));
+
+    // 位深超过16
+    config.bitDepthLumaMinus8 = 9;
+    size = CQTestHEVCSPS(config, sps);
+    XCTAssertFalse(CQHEVCSPSParse(sps, size, &info));
+    // 裁剪后宽为0
+    config = CQTestHEVCSPSConfigMake();
+    config.width = 16;
+    config.conformanceWindow[1] = 8;
+    size = CQTestHEVCSPS(config, sps);
+    XCTAssertFalse(CQHEVCSPSParse(sps, size, &info));
+    // chroma_format_idc超出范围
+    config = CQTestHEVCSPSConfigMake();
+    config.chromaFormatIdc = 4;
+    size = CQTestHEVCSPS(config, sps);
+    XCTAssertFalse(CQHEVCSPSParse(sps, size, &info));
+}
+
+#pragma mark - Decoder Configuration Record
+- (void)testDecoderConfigurationRecordRoundTrip {
+    static const uint8_t vps[] = {0x40, 0x01, 0x0C, 0x01, 0xFF, 0xFF, 0x01, 0x60};
+    static const uint8_t pps[] = {0x44, 0x01, 0xC1, 0x72, 0xB4, 0x62, 0x40};
+    CQTestHEVCSPSConfig config = CQTestHEVCSPSConfigMake();
+    config.maxSubLayersMinus1 = 2;
+    config.subLayerProfilePresentMask = 0x01;
+    config.subLayerLevelPresentMask = 0x03;
+    config.bitDepthLumaMinus8 = 2;
+    config.bitDepthChromaMinus8 = 2;
+    uint8_t sps[kTestMaxHEVCSPSSize * 2];
+    size_t spsSize = CQTestHEVCSPS(config, sps);
+
+    size_t recordSize = CQHEVCDecoderConfigurationRecordSize(sizeof(vps), spsSize, sizeof(pps));
+    XCTAssertEqual(recordSize, 23 + 15 + sizeof(vps) + spsSize + sizeof(pps));
+    uint8_t *record = malloc(recordSize);
+    XCTAssertEqual(CQHEVCWriteDecoderConfigurationRecord(vps, sizeof(vps), sps, spsSize, pps, sizeof(pps), record), recordSize);
+    // 头部字段来自SPS
+    XCTAssertEqual(record[0], 1);
+    XCTAssertEqual(record[1], 0x01);  // profile_space 0、tier 0、Main
+    XCTAssertTrue(record[2] == 0x60 && record[3] == 0 && record[4] == 0 && record[5] == 0);
+    XCTAssertTrue(record[6] == 0x90 && record[7] == 0 && record[11] == 0);
+    XCTAssertEqual(record[12], 123);
+    XCTAssertEqual(record[16], 0xFC | 1);
+    XCTAssertEqual(record[17], 0xF8 | 2);
+    XCTAssertEqual(record[18], 0xF8 | 2);
+    // 3个时域层、temporalIdNested、4字节长度头
+    XCTAssertEqual(record[21], (3 << 3) | (1 << 2) | 3);
+    XCTAssertEqual(record[22], 3);
+
+    // 取出的参数集和写入的逐字节相同，顺序为VPS、SPS、PPS
+    const uint8_t *expectedNalus[] = {vps, sps, pps};
+    const size_t expectedSizes[] = {sizeof(vps), spsSize, sizeof(pps)};
+    const uint8_t *const *nalus = expectedNalus;
+    const size_t *sizes = expectedSizes;
+    __block size_t naluCount = 0;
+    __block BOOL isEqual = YES;
+    __block CQHEVCSPSInfo info = {0};
+    size_t lengthSize = CQHEVCEnumerateDecoderConfigurationRecord(record, recordSize, ^(const uint8_t *nalu, size_t naluSize) {
+        isEqual &= naluCount < 3 && naluSize == sizes[naluCount] && memcmp(nalu, nalus[naluCount], naluSize) == 0;
+        if (CQHEVCNaluTypeOf(nalu) == CQHEVCNaluTypeSPS) CQHEVCSPSParse(nalu, naluSize, &info);
+        naluCount++;
+    });
+    XCTAssertEqual(lengthSize, 4u);
+    XCTAssertEqual(naluCount, 3u);
+    XCTAssertTrue(isEqual);
+    XCTAssertTrue(CQTestSPSInfoMatches(&info, config, 1920, 1080));
+    free(record);
+}
+
+- (void)testDecoderConfigurationRecordRejectsInvalidInput {
+    static const uint8_t vps[] = {0x40, 0x01, 0x0C};
+    static const uint8_t pps[] = {0x44, 0x01, 0xC1};
+    uint8_t sps[kTestMaxHEVCSPSSize * 2];
+    size_t spsSize = CQTestHEVCSPS(CQTestHEVCSPSConfigMake(), sps);
+    uint8_t record[kTestMaxHEVCSPSSize * 2 + 64];
+    // SPS解析失败时不生成
+    XCTAssertEqual(CQHEVCWriteDecoderConfigurationRecord(vps, sizeof(vps), pps, sizeof(pps), pps, sizeof(pps), record), 0u);
+
+    size_t recordSize = CQHEVCWriteDecoderConfigurationRecord(vps, sizeof(vps), sps, spsSize, pps, sizeof(pps), record);
+    XCTAssertGreaterThan(recordSize, 0u);
+    __block size_t naluCount = 0;
+    // 截断在最后一个NALU中间、截断在头部、版本不对
+    XCTAssertEqual(CQHEVCEnumerateDecoderConfigurationRecord(record, recordSize - 1, ^(const uint8_t *nalu, size_t naluSize) {
+        naluCount++;
+    }), 0u);
+    XCTAssertEqual(naluCount, 2u);
+    XCTAssertEqual(CQHEVCEnumerateDecoderConfigurationRecord(record, 22, ^(const uint8_t *nalu, size_t naluSize) {
+        naluCount++;
+    }), 0u);
+    record[0] = 2;
+    XCTAssertEqual(CQHEVCEnumerateDecoderConfigurationRecord(record, recordSize, ^(const uint8_t *nalu, size_t naluSize) {
+        naluCount++;
+    }), 0u);
+    XCTAssertEqual(naluCount, 2u);
+}
+
+@end
@@ -0,0 +1,366 @@
+//
+//  CQHLSSegmenterTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQHLSSegmenter.h"
+#import "CQTSMuxer.h"
+
+static const NSInteger kTestFps = 10;
+static const uint16_t kTestVideoPid = 0x0100;
+
+/// 播放列表里的一个部分切片
+@interface CQTestPart : NSObject
+@property (nonatomic, copy) NSString *uri;
+@property (nonatomic, assign) double duration;
+@property (nonatomic, assign) uint64_t length;
+@property (nonatomic, assign) uint64_t offset;
+@property (nonatomic, assign) BOOL isIndependent;
+@end
+
+@implementation CQTestPart
+@end
+
+@interface CQHLSSegmenterTests : XCTestCase<CQHLSSegmenterDelegate>
+@property (nonatomic, copy) NSString *directory;
+// 以下在写文件队列的回调里追加，等finish的回调之后再读
+@property (nonatomic, strong) NSMutableArray<NSString *> *playlistSnapshots;  ///< 每次更新后读到的播放列表
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *playlistFileNumbers;  ///< 每次更新后播放列表的inode
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *segmentDurations;  ///< didFinishSegment回调的时长
+@end
+
+@implementation CQHLSSegmenterTests
+
+- (void)setUp {
+    self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"CQHLSSegmenterTests"];
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    self.playlistSnapshots = [NSMutableArray array];
+    self.playlistFileNumbers = [NSMutableArray array];
+    self.segmentDurations = [NSMutableArray array];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+}
+
+#pragma mark - CQHLSSegmenterDelegate
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didFinishSegmentAtPath:(NSString *)segmentPath duration:(NSTimeInterval)duration {
+    [self.segmentDurations addObject:@(duration)];
+}
+
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didUpdatePlaylistAtPath:(NSString *)playlistPath {
+    NSString *playlist = [NSString stringWithContentsOfFile:playlistPath encoding:NSUTF8StringEncoding error:nil];
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:playlistPath error:nil];
+    [self.playlistSnapshots addObject:playlist ?: @""];
+    [self.playlistFileNumbers addObject:attributes[NSFileSystemFileNumber] ?: @0];
+}
+
+- (void)hlsSegmenter:(CQHLSSegmenter *)segmenter didFailWithError:(NSError *)error {
+    XCTFail(@"%@", error);
+}
+
+#pragma mark - Private Func
+- (CQHLSSegmenter *)segmenterWithTargetDuration:(NSTimeInterval)targetDuration playlistWindow:(NSUInteger)playlistWindow partTargetDuration:(NSTimeInterval)partTargetDuration {
+    CQVideoCoderConfig *config = [CQVideoCoderConfig defaultConifg];
+    config.fps = kTestFps;
+    config.bitrate = 200 * 1000;
+    CQHLSSegmenter *segmenter = [[CQHLSSegmenter alloc] initWithDirectory:self.directory videoConfig:config audioConfig:nil];
+    segmenter.delegate = self;
+    segmenter.targetDuration = targetDuration;
+    segmenter.playlistWindow = playlistWindow;
+    segmenter.partTargetDuration = partTargetDuration;
+    [segmenter setSps:[self naluWithType:0x67 length:12] pps:[self naluWithType:0x68 length:4]];
+    return segmenter;
+}
+
+/// 带4字节起始码的NALU，负载不含00
+- (NSData *)naluWithType:(uint8_t)type length:(NSUInteger)length {
+    NSMutableData *nalu = [NSMutableData dataWithLength:4 + length];
+    uint8_t *bytes = nalu.mutableBytes;
+    bytes[3] = 0x01;
+    bytes[4] = type;
+    for (NSUInteger i = 1; i < length; i++) {
+        bytes[4 + i] = (uint8_t)(1 + (i * 7) % 250);
+    }
+    return nalu;
+}
+
+/// 按kTestFps输入frameCount帧，keyFrames中的帧为IDR，然后结束并等待文件写完
+- (void)feedSegmenter:(CQHLSSegmenter *)segmenter frameCount:(NSUInteger)frameCount keyFrames:(NSIndexSet *)keyFrames {
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        BOOL isKeyFrame = [keyFrames containsIndex:i];
+        NSData *nalu = [self naluWithType:isKeyFrame ? 0x65 : 0x41 length:isKeyFrame ? 900 : 300];
+        CMTime time = CMTimeMake((int64_t)i, (int32_t)kTestFps);
+        [segmenter appendVideoNalus:@[nalu] pts:time dts:time isKeyFrame:isKeyFrame];
+    }
+    XCTestExpectation *expectation = [self expectationWithDescription:@"finish"];
+    [segmenter finishWithCompletionHandler:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+}
+
+- (NSString *)finalPlaylistOfSegmenter:(CQHLSSegmenter *)segmenter {
+    return [NSString stringWithContentsOfFile:segmenter.playlistPath encoding:NSUTF8StringEncoding error:nil];
+}
+
+- (NSArray<NSString *> *)linesOfPlaylist:(NSString *)playlist {
+    return [playlist componentsSeparatedByString:@"\n"];
+}
+
+/// 标签后面的值，没有该标签返回nil
+- (nullable NSString *)valueOfTag:(NSString *)tag inPlaylist:(NSString *)playlist {
+    NSString *prefix = [tag stringByAppendingString:@":"];
+    for (NSString *line in [self linesOfPlaylist:playlist]) {
+        if ([line hasPrefix:prefix]) return [line substringFromIndex:prefix.length];
+    }
+    return nil;
+}
+
+/// 列出的切片文件名
+- (NSArray<NSString *> *)segmentNamesInPlaylist:(NSString *)playlist {
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    for (NSString *line in [self linesOfPlaylist:playlist]) {
+        if (line.length > 0 && ![line hasPrefix:@"#"]) [names addObject:line];
+    }
+    return names;
+}
+
+/// EXTINF的时长
+- (NSArray<NSNumber *> *)segmentDurationsInPlaylist:(NSString *)playlist {
+    NSMutableArray<NSNumber *> *durations = [NSMutableArray array];
+    for (NSString *line in [self linesOfPlaylist:playlist]) {
+        if ([line hasPrefix:@"#EXTINF:"]) [durations addObject:@([line substringFromIndex:8].doubleValue)];
+    }
+    return durations;
+}
+
+- (NSArray<CQTestPart *> *)partsInPlaylist:(NSString *)playlist {
+    NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^#EXT-X-PART:DURATION=([0-9.]+),URI=\"([^\"]+)\",BYTERANGE=\"([0-9]+)@([0-9]+)\"(,INDEPENDENT=YES)?$" options:0 error:nil];
+    NSMutableArray<CQTestPart *> *parts = [NSMutableArray array];
+    for (NSString *line in [self linesOfPlaylist:playlist]) {
+        if (![line hasPrefix:@"#EXT-X-PART:"]) continue;
+        NSTextCheckingResult *match = [regex firstMatchInString:line options:0 range:NSMakeRange(0, line.length)];
+        XCTAssertNotNil(match, @"%@", line);
+        if (!match) continue;
+        CQTestPart *part = [[CQTestPart alloc] init];
+        part.duration = [line substringWithRange:[match rangeAtIndex:1]].doubleValue;
+        part.uri = [line substringWithRange:[match rangeAtIndex:2]];
+        part.length = (uint64_t)[line substringWithRange:[match rangeAtIndex:3]].longLongValue;
+        part.offset = (uint64_t)[line substringWithRange:[match rangeAtIndex:4]].longLongValue;
+        part.isIndependent = [match rangeAtIndex:5].location != NSNotFound;
+        [parts addObject:part];
+    }
+    return parts;
+}
+
+- (NSData *)segmentDataNamed:(NSString *)name {
+    return [NSData dataWithContentsOfFile:[self.directory stringByAppendingPathComponent:name]];
+}
+
+/// 切片中视频PES的个数(每帧一个)
+- (NSUInteger)videoFrameCountInTSData:(NSData *)tsData {
+    const uint8_t *bytes = tsData.bytes;
+    NSUInteger count = 0;
+    for (NSUInteger offset = 0; offset + CQTSPacketSize <= tsData.length; offset += CQTSPacketSize) {
+        uint16_t pid = ((bytes[offset + 1] & 0x1F) << 8) | bytes[offset + 2];
+        if (pid == kTestVideoPid && (bytes[offset + 1] & 0x40)) count++;
+    }
+    return count;
+}
+
+/// 第一个视频PES的TS包带random_access_indicator(以IDR开始)
+- (BOOL)firstVideoFrameIsRandomAccessInTSData:(NSData *)tsData {
+    const uint8_t *bytes = tsData.bytes;
+    for (NSUInteger offset = 0; offset + CQTSPacketSize <= tsData.length; offset += CQTSPacketSize) {
+        const uint8_t *packet = bytes + offset;
+        uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        if (pid != kTestVideoPid || !(packet[1] & 0x40)) continue;
+        return (packet[3] & 0x20) && packet[4] > 0 && (packet[5] & 0x40);
+    }
+    return NO;
+}
+
+#pragma mark - Segment
+- (void)testCutsOnlyAtFirstIDRAfterTargetDuration {
+    // 目标2秒，IDR不规则: 1.5秒的IDR不够时长不切，2.5秒的切；3.2秒不够，5.0秒切；之后7.0、9.0
+    CQHLSSegmenter *segmenter = [self segmenterWithTargetDuration:2 playlistWindow:0 partTargetDuration:0];
+    NSMutableIndexSet *keyFrames = [NSMutableIndexSet indexSet];
+    for (NSNumber *index in @[@0, @15, @25, @32, @50, @55, @70, @90]) {
+        [keyFrames addIndex:index.unsignedIntegerValue];
+    }
+    [self feedSegmenter:segmenter frameCount:100 keyFrames:keyFrames];
+
+    NSString *playlist = [self finalPlaylistOfSegmenter:segmenter];
+    NSArray<NSString *> *expectedNames = @[@"segment0.ts", @"segment1.ts", @"segment2.ts", @"segment3.ts", @"segment4.ts"];
+    XCTAssertEqualObjects([self segmentNamesInPlaylist:playlist], expectedNames);
+    // 最后一个切片按一帧估算最后一帧的时长
+    NSArray<NSNumber *> *expectedDurations = @[@2.5, @2.5, @2.0, @2.0, @1.0];
+    NSArray<NSNumber *> *durations = [self segmentDurationsInPlaylist:playlist];
+    XCTAssertEqual(durations.count, expectedDurations.count);
+    XCTAssertEqual(self.segmentDurations.count, expectedDurations.count);
+    for (NSUInteger i = 0; i < MIN(durations.count, self.segmentDurations.count); i++) {
+        XCTAssertEqualWithAccuracy(durations[i].doubleValue, expectedDurations[i].doubleValue, 0.001);
+        XCTAssertEqualWithAccuracy(self.segmentDurations[i].doubleValue, expectedDurations[i].doubleValue, 0.001);
+    }
+    // TARGETDURATION取实际最长切片的上取整
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-TARGETDURATION" inPlaylist:playlist], @"3");
+
+    // 每个切片以PAT开始、第一帧是IDR，帧数和切点一致
+    const NSUInteger expectedFrameCounts[] = {25, 25, 20, 20, 10};
+    for (NSUInteger i = 0; i < expectedNames.count; i++) {
+        NSData *tsData = [self segmentDataNamed:expectedNames[i]];
+        XCTAssertGreaterThan(tsData.length, 0u);
+        XCTAssertEqual(tsData.length % CQTSPacketSize, 0u);
+        const uint8_t *bytes = tsData.bytes;
+        XCTAssertTrue(bytes[0] == 0x47 && (bytes[1] & 0x1F) == 0 && bytes[2] == 0, @"%@", expectedNames[i]);
+        XCTAssertTrue([self firstVideoFrameIsRandomAccessInTSData:tsData], @"%@", expectedNames[i]);
+        XCTAssertEqual([self videoFrameCountInTSData:tsData], expectedFrameCounts[i], @"%@", expectedNames[i]);
+    }
+}
+
+#pragma mark - Playlist
+- (void)testRollingWindowDeletesExpiredSegments {
+    // 1秒一个切片共10个，窗口3个，移出窗口的再保留2个
+    CQHLSSegmenter *segmenter = [self segmenterWithTargetDuration:1 playlistWindow:3 partTargetDuration:0];
+    NSMutableIndexSet *keyFrames = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 100; i += 10) [keyFrames addIndex:i];
+    [self feedSegmenter:segmenter frameCount:100 keyFrames:keyFrames];
+
+    NSString *playlist = [self finalPlaylistOfSegmenter:segmenter];
+    XCTAssertNil([self valueOfTag:@"#EXT-X-PLAYLIST-TYPE" inPlaylist:playlist]);
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-MEDIA-SEQUENCE" inPlaylist:playlist], @"7");
+    NSArray<NSString *> *expectedNames = @[@"segment7.ts", @"segment8.ts", @"segment9.ts"];
+    XCTAssertEqualObjects([self segmentNamesInPlaylist:playlist], expectedNames);
+    XCTAssertTrue([playlist hasSuffix:@"#EXT-X-ENDLIST\n"]);
+
+    // 窗口滑动过程中MEDIA-SEQUENCE只增不减，列出的切片不超过窗口
+    NSInteger lastSequence = -1;
+    for (NSString *snapshot in self.playlistSnapshots) {
+        NSInteger sequence = [self valueOfTag:@"#EXT-X-MEDIA-SEQUENCE" inPlaylist:snapshot].integerValue;
+        XCTAssertGreaterThanOrEqual(sequence, lastSequence);
+        XCTAssertLessThanOrEqual([self segmentNamesInPlaylist:snapshot].count, 3u);
+        lastSequence = sequence;
+    }
+
+    // 磁盘上只剩窗口内和刚移出的2个切片，提前创建的下一个切片已删除
+    NSArray<NSString *> *files = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directory error:nil] sortedArrayUsingSelector:@selector(compare:)];
+    NSArray<NSString *> *expectedFiles = @[@"index.m3u8", @"segment5.ts", @"segment6.ts", @"segment7.ts", @"segment8.ts", @"segment9.ts"];
+    XCTAssertEqualObjects(files, expectedFiles);
+}
+
+- (void)testEventPlaylistKeepsAllSegments {
+    CQHLSSegmenter *segmenter = [self segmenterWithTargetDuration:1 playlistWindow:0 partTargetDuration:0];
+    NSMutableIndexSet *keyFrames = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 80; i += 10) [keyFrames addIndex:i];
+    [self feedSegmenter:segmenter frameCount:80 keyFrames:keyFrames];
+
+    NSString *playlist = [self finalPlaylistOfSegmenter:segmenter];
+    XCTAssertTrue([playlist hasPrefix:@"#EXTM3U\n#EXT-X-VERSION:3\n"]);
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-PLAYLIST-TYPE" inPlaylist:playlist], @"EVENT");
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-MEDIA-SEQUENCE" inPlaylist:playlist], @"0");
+    XCTAssertTrue([[self linesOfPlaylist:playlist] containsObject:@"#EXT-X-INDEPENDENT-SEGMENTS"]);
+    XCTAssertEqual([self segmentNamesInPlaylist:playlist].count, 8u);
+    XCTAssertTrue([playlist hasSuffix:@"#EXT-X-ENDLIST\n"]);
+    // EVENT列表的每次更新都只追加，之前列出的切片一直在
+    NSUInteger lastCount = 0;
+    for (NSString *snapshot in self.playlistSnapshots) {
+        NSArray<NSString *> *names = [self segmentNamesInPlaylist:snapshot];
+        XCTAssertGreaterThanOrEqual(names.count, lastCount);
+        if (names.count > 0) XCTAssertEqualObjects(names.firstObject, @"segment0.ts");
+        lastCount = names.count;
+    }
+    for (NSUInteger i = 0; i < 8; i++) {
+        NSString *name = [NSString stringWithFormat:@"segment%lu.ts", (unsigned long)i];
+        XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:[self.directory stringByAppendingPathComponent:name]], @"%@", name);
+    }
+}
+
+- (void)testPlaylistIsReplacedAtomically {
+    CQHLSSegmenter *segmenter = [self segmenterWithTargetDuration:1 playlistWindow:3 partTargetDuration:0.3];
+    NSMutableIndexSet *keyFrames = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 50; i += 10) [keyFrames addIndex:i];
+    [self feedSegmenter:segmenter frameCount:50 keyFrames:keyFrames];
+
+    // 每次读到的都是完整的列表，而且是新文件替换(inode变化)，不是原地改写
+    XCTAssertGreaterThan(self.playlistSnapshots.count, 5u);
+    for (NSUInteger i = 0; i < self.playlistSnapshots.count; i++) {
+        NSString *snapshot = self.playlistSnapshots[i];
+        XCTAssertTrue([snapshot hasPrefix:@"#EXTM3U\n"], @"update %lu", (unsigned long)i);
+        XCTAssertTrue([snapshot hasSuffix:@"\n"], @"update %lu", (unsigned long)i);
+        XCTAssertNotNil([self valueOfTag:@"#EXT-X-TARGETDURATION" inPlaylist:snapshot], @"update %lu", (unsigned long)i);
+        if (i > 0) {
+            XCTAssertNotEqualObjects(self.playlistFileNumbers[i], self.playlistFileNumbers[i - 1], @"update %lu", (unsigned long)i);
+        }
+    }
+    // 没有留下临时文件
+    for (NSString *file in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:self.directory error:nil]) {
+        XCTAssertTrue([file isEqualToString:@"index.m3u8"] || [file hasSuffix:@".ts"], @"%@", file);
+    }
+}
+
+#pragma mark - LL-HLS
+- (void)testLowLatencyPartsReferenceByteRanges {
+    // 1秒切片、0.3秒部分切片: 每3帧切一个部分切片，每个切片是0.3/0.3/0.3/0.1
+    CQHLSSegmenter *segmenter = [self segmenterWithTargetDuration:1 playlistWindow:0 partTargetDuration:0.3];
+    NSMutableIndexSet *keyFrames = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < 30; i += 10) [keyFrames addIndex:i];
+    [self feedSegmenter:segmenter frameCount:30 keyFrames:keyFrames];
+
+    // 结束前最后一次更新: 切片0、1已完成，切片2写到2.9秒
+    NSString *live = nil;
+    for (NSString *snapshot in self.playlistSnapshots) {
+        if (![snapshot containsString:@"#EXT-X-ENDLIST"]) live = snapshot;
+    }
+    XCTAssertNotNil(live);
+    if (!live) return;
+    XCTAssertTrue([live hasPrefix:@"#EXTM3U\n#EXT-X-VERSION:6\n"]);
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-PART-INF" inPlaylist:live], @"PART-TARGET=0.300");
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-SERVER-CONTROL" inPlaylist:live], @"PART-HOLD-BACK=0.900");
+    XCTAssertEqualObjects([self segmentNamesInPlaylist:live], (@[@"segment0.ts", @"segment1.ts"]));
+
+    NSArray<CQTestPart *> *parts = [self partsInPlaylist:live];
+    XCTAssertEqual(parts.count, 4u + 4u + 3u);
+    NSMutableDictionary<NSString *, NSNumber *> *nextOffsets = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < parts.count; i++) {
+        CQTestPart *part = parts[i];
+        NSUInteger indexInSegment = i % 4;
+        XCTAssertEqualWithAccuracy(part.duration, indexInSegment == 3 ? 0.1 : 0.3, 0.001, @"part %lu", (unsigned long)i);
+        // 只有切片的第一个部分切片以IDR开始
+        XCTAssertEqual(part.isIndependent, indexInSegment == 0, @"part %lu", (unsigned long)i);
+        // 同一切片内的部分切片首尾相接，都在TS包边界上
+        XCTAssertEqual(part.offset, nextOffsets[part.uri].unsignedLongLongValue, @"part %lu", (unsigned long)i);
+        XCTAssertEqual(part.offset % CQTSPacketSize, 0u);
+        XCTAssertEqual(part.length % CQTSPacketSize, 0u);
+        XCTAssertGreaterThan(part.length, 0u);
+        nextOffsets[part.uri] = @(part.offset + part.length);
+
+        // 每个部分切片从一帧的开始: 独立的以PAT开始，其它以视频PES开始
+        NSData *tsData = [self segmentDataNamed:part.uri];
+        XCTAssertLessThanOrEqual(part.offset + part.length, tsData.length);
+        if (part.offset + part.length > tsData.length) continue;
+        const uint8_t *packet = (const uint8_t *)tsData.bytes + part.offset;
+        uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        XCTAssertEqual(packet[0], 0x47);
+        XCTAssertTrue(packet[1] & 0x40, @"part %lu", (unsigned long)i);
+        XCTAssertEqual(pid, part.isIndependent ? 0 : kTestVideoPid, @"part %lu", (unsigned long)i);
+    }
+    // 已完成切片的部分切片覆盖整个文件
+    for (NSString *name in @[@"segment0.ts", @"segment1.ts"]) {
+        XCTAssertEqual(nextOffsets[name].unsignedLongLongValue, (uint64_t)[self segmentDataNamed:name].length, @"%@", name);
+    }
+    // 预加载提示指向当前切片下一个部分切片的开始
+    NSString *hint = [NSString stringWithFormat:@"TYPE=PART,URI=\"segment2.ts\",BYTERANGE-START=%llu", nextOffsets[@"segment2.ts"].unsignedLongLongValue];
+    XCTAssertEqualObjects([self valueOfTag:@"#EXT-X-PRELOAD-HINT" inPlaylist:live], hint);
+
+    // 结束后的列表不再列出部分切片
+    NSString *playlist = [self finalPlaylistOfSegmenter:segmenter];
+    XCTAssertEqual([self partsInPlaylist:playlist].count, 0u);
+    XCTAssertNil([self valueOfTag:@"#EXT-X-PRELOAD-HINT" inPlaylist:playlist]);
+    XCTAssertTrue([playlist hasSuffix:@"#EXT-X-ENDLIST\n"]);
+}
+
+@end
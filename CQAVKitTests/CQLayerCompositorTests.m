@@ -0,0 +1,402 @@
+//
+//  CQLayerCompositorTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQLayerCompositor.h"
+#import "CQTestSupport.h"
+
+/// 四舍五入的混合结果
+static uint8_t CQTestBlend(uint32_t source, uint32_t destination, uint32_t alpha) {
+    return (uint8_t)((2 * (source * alpha + destination * (255 - alpha)) + 255) / 510);
+}
+
+/// 分配NV12，亮度和色度分别用y、u、v填充，行末尾是填充字节
+static CQYUVPlanes CQTestNV12Create(size_t width, size_t height, uint8_t y, uint8_t u, uint8_t v) {
+    CQYUVPlanes planes = CQTestPlanesCreate(width, height, YES, y);
+    for (size_t j = 0; j < height / 2; j++) {
+        for (size_t i = 0; i < width; i += 2) {
+            planes.u[j * planes.uBytesPerRow + i] = u;
+            planes.u[j * planes.uBytesPerRow + i + 1] = v;
+        }
+    }
+    return planes;
+}
+
+static inline uint8_t CQTestLuma(const CQYUVPlanes *planes, size_t x, size_t y) {
+    return planes->y[y * planes->yBytesPerRow + x];
+}
+
+/// 像素(x, y)的U(index为0)或V(index为1)
+static inline uint8_t CQTestChroma(const CQYUVPlanes *planes, size_t x, size_t y, int index) {
+    return planes->u[y / 2 * planes->uBytesPerRow + x / 2 * 2 + index];
+}
+
+/// 两帧的有效区域相同
+static BOOL CQTestNV12Equal(const CQYUVPlanes *a, const CQYUVPlanes *b) {
+    for (size_t j = 0; j < a->height; j++) {
+        if (memcmp(a->y + j * a->yBytesPerRow, b->y + j * b->yBytesPerRow, a->width) != 0) return NO;
+    }
+    for (size_t j = 0; j < a->height / 2; j++) {
+        if (memcmp(a->u + j * a->uBytesPerRow, b->u + j * b->uBytesPerRow, a->width) != 0) return NO;
+    }
+    return YES;
+}
+
+/// 添加一个内容为纯色的不透明图层
+static BOOL CQTestAddSolidLayer(CQLayerCompositor *compositor, uint32_t layerID, int32_t x, int32_t y, size_t width, size_t height, int32_t zOrder, uint8_t luma) {
+    CQLayerGeometry geometry = {x, y, width, height, zOrder, 255};
+    if (!CQLayerCompositorSetLayer(compositor, layerID, geometry)) return NO;
+    CQYUVPlanes source = CQTestNV12Create(width, height, luma, 128, 128);
+    BOOL isUpdated = CQLayerCompositorUpdateYUV(compositor, layerID, &source);
+    CQTestPlanesFree(&source);
+    return isUpdated;
+}
+
+@interface CQLayerCompositorTests : XCTestCase
+
+@end
+
+@implementation CQLayerCompositorTests
+
+#pragma mark - 混合
+- (void)testBlendRowRounding {
+    // 所有source、destination、alpha的组合都是四舍五入的结果
+    uint8_t source[256], destination[256], alpha[256];
+    for (int i = 0; i < 256; i++) {
+        source[i] = (uint8_t)i;
+    }
+    int mismatchCount = 0;
+    for (int a = 0; a < 256; a++) {
+        memset(alpha, a, sizeof(alpha));
+        for (int d = 0; d < 256; d++) {
+            memset(destination, d, sizeof(destination));
+            CQAlphaBlendRowScalar(destination, source, alpha, 255, sizeof(destination));
+            for (int s = 0; s < 256; s++) {
+                mismatchCount += destination[s] != CQTestBlend((uint32_t)s, (uint32_t)d, (uint32_t)a);
+            }
+        }
+    }
+    XCTAssertEqual(mismatchCount, 0);
+
+    // 不透明直接拷贝，透明度为0不改变
+    memset(destination, 7, sizeof(destination));
+    CQAlphaBlendRow(destination, source, NULL, 0, sizeof(destination));
+    XCTAssertEqual(destination[200], 7);
+    CQAlphaBlendRow(destination, source, NULL, 255, sizeof(destination));
+    XCTAssertEqual(memcmp(destination, source, sizeof(destination)), 0);
+
+    // 透明度和整体不透明度相乘: 255 x 128 / 255 = 128
+    memset(destination, 100, sizeof(destination));
+    memset(alpha, 255, sizeof(alpha));
+    CQAlphaBlendRow(destination, source, alpha, 128, sizeof(destination));
+    XCTAssertEqual(destination[200], CQTestBlend(200, 100, 128));
+    XCTAssertEqual(destination[200], 150);
+}
+
+- (void)testBlendRowNEONMatchesScalar {
+    // 长度覆盖16的整数倍和余数，有无透明度，各种整体不透明度
+    static const size_t lengths[] = {1, 2, 15, 16, 17, 31, 64, 100};
+    static const uint8_t opacities[] = {0, 1, 127, 128, 254, 255};
+    uint32_t seed = 1;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t length = lengths[l];
+        uint8_t source[100], alpha[100], scalar[100], vector[100];
+        for (size_t i = 0; i < length; i++) {
+            source[i] = (uint8_t)CQTestRandom(&seed);
+            alpha[i] = i % 5 == 0 ? 0 : i % 5 == 1 ? 255 : (uint8_t)CQTestRandom(&seed);
+            scalar[i] = (uint8_t)CQTestRandom(&seed);
+        }
+        for (size_t o = 0; o < sizeof(opacities) / sizeof(opacities[0]); o++) {
+            for (int hasAlpha = 0; hasAlpha < 2; hasAlpha++) {
+                uint8_t original[100];
+                memcpy(original, scalar, length);
+                memcpy(vector, scalar, length);
+                CQAlphaBlendRowScalar(scalar, source, hasAlpha ? alpha : NULL, opacities[o], length);
+                CQAlphaBlendRow(vector, source, hasAlpha ? alpha : NULL, opacities[o], length);
+                XCTAssertEqual(memcmp(scalar, vector, length), 0, @"length %zu opacity %d alpha %d", length, opacities[o], hasAlpha);
+                memcpy(scalar, original, length);
+            }
+        }
+    }
+}
+
+#pragma mark - 图层
+- (void)testBackgroundAndOpaqueLayer {
+    // 128x128的画布是2x2块，第一帧全部重新合成成黑色
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(128, 128, NO);
+    CQYUVPlanes output = CQTestNV12Create(128, 128, 0, 0, 0);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 4);
+    XCTAssertEqual(CQTestLuma(&output, 0, 0), 16);
+    XCTAssertEqual(CQTestLuma(&output, 127, 127), 16);
+    XCTAssertEqual(CQTestChroma(&output, 127, 127, 1), 128);
+    XCTAssertTrue(CQTestPaddingIntact(&output));
+
+    // 没有变化时不重新合成，但画布仍然整帧拷贝到输出
+    CQYUVPlanes stale = CQTestNV12Create(128, 128, 99, 99, 99);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &stale, 1), 0);
+    XCTAssertTrue(CQTestNV12Equal(&stale, &output));
+
+    // 不透明图层只在第一块里，原样缩放后覆盖背景
+    CQLayerGeometry geometry = {10, 20, 32, 32, 0, 255};
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    CQYUVPlanes source = CQTestNV12Create(32, 32, 200, 60, 180);
+    XCTAssertTrue(CQLayerCompositorUpdateYUV(compositor, 1, &source));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 1);
+    XCTAssertEqual(CQTestLuma(&output, 10, 20), 200);
+    XCTAssertEqual(CQTestLuma(&output, 41, 51), 200);
+    XCTAssertEqual(CQTestLuma(&output, 9, 20), 16);
+    XCTAssertEqual(CQTestLuma(&output, 42, 51), 16);
+    XCTAssertEqual(CQTestLuma(&output, 41, 52), 16);
+    XCTAssertEqual(CQTestChroma(&output, 10, 20, 0), 60);
+    XCTAssertEqual(CQTestChroma(&output, 10, 20, 1), 180);
+    XCTAssertEqual(CQTestChroma(&output, 8, 20, 0), 128);
+
+    // 整体半透明: 和黑色背景混合
+    geometry.opacity = 128;
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 1);
+    XCTAssertEqual(CQTestLuma(&output, 20, 30), CQTestBlend(200, 16, 128));
+    XCTAssertEqual(CQTestChroma(&output, 20, 30, 0), CQTestBlend(60, 128, 128));
+    XCTAssertEqual(CQTestChroma(&output, 20, 30, 1), CQTestBlend(180, 128, 128));
+
+    // 透明度为0时图层隐藏
+    geometry.opacity = 0;
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 20, 30), 16);
+    XCTAssertTrue(CQTestPaddingIntact(&output));
+
+    CQTestPlanesFree(&source);
+    CQTestPlanesFree(&stale);
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+- (void)testFullRangeBackground {
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(64, 32, YES);
+    CQYUVPlanes output = CQTestNV12Create(64, 32, 99, 99, 99);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 0), 1);
+    XCTAssertEqual(CQTestLuma(&output, 63, 31), 0);
+    XCTAssertEqual(CQTestChroma(&output, 63, 31, 0), 128);
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+- (void)testZOrder {
+    // 重叠的两个不透明图层，zOrder大的在上面
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(64, 64, NO);
+    CQYUVPlanes output = CQTestNV12Create(64, 64, 0, 0, 0);
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 1, 0, 0, 32, 32, 5, 50));
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 2, 16, 16, 32, 32, 0, 150));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 20, 20), 50);
+    XCTAssertEqual(CQTestLuma(&output, 40, 40), 150);
+
+    // 交换叠放顺序
+    CQLayerGeometry geometry = {16, 16, 32, 32, 10, 255};
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 2, geometry));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 20, 20), 150);
+    XCTAssertEqual(CQTestLuma(&output, 10, 10), 50);
+
+    // zOrder相同时后添加的在上面
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 3, 8, 8, 16, 16, 10, 250));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 20, 20), 250);
+    XCTAssertEqual(CQTestLuma(&output, 30, 30), 150);
+
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+- (void)testLayerClippedAtCanvasEdges {
+    // 左上超出画布的图层: 画布(0, 0)对应图层(8, 6)
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(64, 64, NO);
+    CQYUVPlanes output = CQTestNV12Create(64, 64, 0, 0, 0);
+    CQLayerGeometry geometry = {-8, -6, 32, 32, 0, 255};
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    CQYUVPlanes source = CQTestNV12Create(32, 32, 0, 128, 128);
+    for (size_t j = 0; j < 32; j++) {
+        for (size_t i = 0; i < 32; i++) {
+            source.y[j * source.yBytesPerRow + i] = (uint8_t)(j * 32 + i);
+        }
+    }
+    XCTAssertTrue(CQLayerCompositorUpdateYUV(compositor, 1, &source));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 0, 0), 6 * 32 + 8);
+    XCTAssertEqual(CQTestLuma(&output, 23, 25), (uint8_t)(31 * 32 + 31));
+    XCTAssertEqual(CQTestLuma(&output, 24, 0), 16);
+    XCTAssertEqual(CQTestLuma(&output, 0, 26), 16);
+
+    // 右下超出画布的图层
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 2, 48, 50, 32, 32, 0, 77));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 63, 63), 77);
+    XCTAssertEqual(CQTestLuma(&output, 47, 63), 16);
+    XCTAssertTrue(CQTestPaddingIntact(&output));
+
+    // 完全在画布外的图层不影响合成
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 3, 64, 0, 16, 16, 0, 200));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 0);
+
+    CQTestPlanesFree(&source);
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+- (void)testRGBALayer {
+    // 小于720的画布用BT.601视频范围，白色亮度235；左边透明，中间半透明，右边不透明
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(64, 64, NO);
+    CQYUVPlanes output = CQTestNV12Create(64, 64, 0, 0, 0);
+    CQLayerGeometry geometry = {0, 0, 12, 4, 0, 255};
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    uint8_t straight[4 * 12 * 4], premultiplied[4 * 12 * 4];
+    for (size_t i = 0; i < 4 * 12; i++) {
+        uint8_t a = i % 12 < 4 ? 0 : i % 12 < 8 ? 128 : 255;
+        memset(straight + i * 4, 255, 3);
+        straight[i * 4 + 3] = a;
+        memset(premultiplied + i * 4, a, 4);
+    }
+    XCTAssertTrue(CQLayerCompositorUpdateRGBA(compositor, 1, straight, 12 * 4, 12, 4, CQRGBOrderRGBA, NO));
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertEqual(CQTestLuma(&output, 0, 0), 16);
+    XCTAssertEqual(CQTestLuma(&output, 5, 1), CQTestBlend(235, 16, 128));
+    XCTAssertEqual(CQTestLuma(&output, 11, 3), 235);
+    XCTAssertEqual(CQTestChroma(&output, 5, 1, 0), 128);
+    XCTAssertEqual(CQTestLuma(&output, 12, 0), 16);
+
+    // 预乘的位图去掉预乘后结果相同
+    CQYUVPlanes straightOutput = CQTestNV12Create(64, 64, 0, 0, 0);
+    memcpy(straightOutput.y, output.y, output.yBytesPerRow * 64);
+    memcpy(straightOutput.u, output.u, output.uBytesPerRow * 32);
+    XCTAssertTrue(CQLayerCompositorUpdateRGBA(compositor, 1, premultiplied, 12 * 4, 12, 4, CQRGBOrderBGRA, YES));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 1);
+    XCTAssertTrue(CQTestNV12Equal(&straightOutput, &output));
+
+    // 宽高和图层不同
+    XCTAssertFalse(CQLayerCompositorUpdateRGBA(compositor, 1, straight, 12 * 4, 12, 2, CQRGBOrderRGBA, NO));
+    XCTAssertFalse(CQLayerCompositorUpdateRGBA(compositor, 2, straight, 12 * 4, 12, 4, CQRGBOrderRGBA, NO));
+
+    CQTestPlanesFree(&straightOutput);
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+#pragma mark - 变化的块
+- (void)testDirtyTiles {
+    // 128x128的画布，图层从左上块移动到右下块，新旧两个块重新合成，旧位置恢复黑色
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(128, 128, NO);
+    CQYUVPlanes output = CQTestNV12Create(128, 128, 0, 0, 0);
+    CQLayerCompositorCompose(compositor, &output, 1);
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 1, 8, 8, 16, 16, 0, 200));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 1);
+    CQLayerGeometry geometry = {72, 72, 16, 16, 0, 255};
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 2);
+    XCTAssertEqual(CQTestLuma(&output, 10, 10), 16);
+    XCTAssertEqual(CQTestLuma(&output, 80, 80), 200);
+
+    // 位置不变时不标记
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 0);
+
+    // 跨过块边界的图层标记它覆盖的所有块
+    XCTAssertTrue(CQTestAddSolidLayer(compositor, 2, 60, 0, 8, 8, 0, 100));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 2);
+
+    // 宽高变化后内容清掉，重新更新之前不显示
+    geometry.width = 32;
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 1, geometry));
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 1);
+    XCTAssertEqual(CQTestLuma(&output, 80, 80), 16);
+
+    // 删除图层
+    CQLayerCompositorRemoveLayer(compositor, 2);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 2);
+    XCTAssertEqual(CQTestLuma(&output, 62, 2), 16);
+
+    CQLayerCompositorInvalidate(compositor);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 4);
+
+    CQTestPlanesFree(&output);
+    CQLayerCompositorDestroy(compositor);
+}
+
+- (void)testBandsMatchSingleThread {
+    // 同样的图层，分段合成和单线程结果相同
+    CQYUVPlanes single = CQTestNV12Create(256, 200, 0, 0, 0);
+    for (size_t bandCount = 1; bandCount <= 5; bandCount++) {
+        CQLayerCompositor *compositor = CQLayerCompositorCreate(256, 200, NO);
+        CQYUVPlanes output = CQTestNV12Create(256, 200, 0, 0, 0);
+        uint32_t seed = 3;
+        for (uint32_t layerID = 0; layerID < 4; layerID++) {
+            CQLayerGeometry geometry = {(int32_t)layerID * 50 - 20, (int32_t)layerID * 40 - 10, 96, 80, (int32_t)(layerID % 2), (uint8_t)(layerID == 2 ? 255 : 100 + layerID * 40)};
+            XCTAssertTrue(CQLayerCompositorSetLayer(compositor, layerID, geometry));
+            CQYUVPlanes source = CQTestNV12Create(96, 80, 0, 0, 0);
+            for (size_t i = 0; i < source.yBytesPerRow * 80; i++) {
+                source.y[i] = (uint8_t)CQTestRandom(&seed);
+            }
+            for (size_t i = 0; i < source.uBytesPerRow * 40; i++) {
+                source.u[i] = (uint8_t)CQTestRandom(&seed);
+            }
+            XCTAssertTrue(CQLayerCompositorUpdateYUV(compositor, layerID, &source));
+            CQTestPlanesFree(&source);
+        }
+        XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, bandCount), 16);
+        if (bandCount == 1) {
+            memcpy(single.y, output.y, output.yBytesPerRow * 200);
+            memcpy(single.u, output.u, output.uBytesPerRow * 100);
+        } else {
+            XCTAssertTrue(CQTestNV12Equal(&single, &output), @"bandCount %zu", bandCount);
+        }
+        XCTAssertTrue(CQTestPaddingIntact(&output));
+        CQTestPlanesFree(&output);
+        CQLayerCompositorDestroy(compositor);
+    }
+    CQTestPlanesFree(&single);
+}
+
+#pragma mark - 参数
+- (void)testInvalidArguments {
+    CQLayerCompositor *compositor = CQLayerCompositorCreate(64, 64, NO);
+    // 位置和宽高必须是偶数
+    CQLayerGeometry odd = {1, 0, 16, 16, 0, 255};
+    XCTAssertFalse(CQLayerCompositorSetLayer(compositor, 1, odd));
+    CQLayerGeometry oddSize = {0, 0, 15, 16, 0, 255};
+    XCTAssertFalse(CQLayerCompositorSetLayer(compositor, 1, oddSize));
+    CQLayerGeometry empty = {0, 0, 0, 16, 0, 255};
+    XCTAssertFalse(CQLayerCompositorSetLayer(compositor, 1, empty));
+
+    // 最多8个图层，修改已有的图层不受限制
+    CQLayerGeometry geometry = {0, 0, 16, 16, 0, 255};
+    for (uint32_t layerID = 0; layerID < 8; layerID++) {
+        XCTAssertTrue(CQLayerCompositorSetLayer(compositor, layerID, geometry));
+    }
+    XCTAssertFalse(CQLayerCompositorSetLayer(compositor, 8, geometry));
+    geometry.x = 16;
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 7, geometry));
+    CQLayerCompositorRemoveLayer(compositor, 0);
+    XCTAssertTrue(CQLayerCompositorSetLayer(compositor, 8, geometry));
+
+    // YUV源必须是NV12，图层必须存在
+    CQYUVPlanes source = CQTestNV12Create(16, 16, 0, 128, 128);
+    XCTAssertFalse(CQLayerCompositorUpdateYUV(compositor, 100, &source));
+    CQYUVPlanes i420 = source;
+    i420.v = source.u;
+    i420.vBytesPerRow = source.uBytesPerRow;
+    XCTAssertFalse(CQLayerCompositorUpdateYUV(compositor, 1, &i420));
+
+    // 输出必须是NV12并且和画布一样大
+    CQYUVPlanes output = CQTestNV12Create(64, 62, 0, 0, 0);
+    XCTAssertEqual(CQLayerCompositorCompose(compositor, &output, 1), 0);
+
+    CQTestPlanesFree(&output);
+    CQTestPlanesFree(&source);
+    CQLayerCompositorDestroy(compositor);
+}
+
+@end
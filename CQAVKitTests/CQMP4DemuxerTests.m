@@ -0,0 +1,138 @@
+//
+//  CQMP4DemuxerTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQMP4Demuxer.h"
+#import "CQBenchmarkStreamGenerator.h"
+
+/// 10.1秒30fps: 303帧，关键帧间隔60，每chunk 15帧，最后一个chunk只有3帧
+static const NSTimeInterval kDuration = 10.1;
+static const NSInteger kFps = 30;
+static const uint32_t kFrameCount = 303;
+static const uint32_t kSampleDelta = 3000;
+
+@interface CQMP4DemuxerTests : XCTestCase
+@property (nonatomic, copy) NSString *path;
+@end
+
+@implementation CQMP4DemuxerTests
+
+- (void)setUp {
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"CQMP4DemuxerTests.mp4"];
+    NSError *error = nil;
+    XCTAssertTrue([CQBenchmarkStreamGenerator writeMP4StreamToPath:self.path duration:kDuration fps:kFps bitrate:1000 * 1000 chunkDuration:0.5 seed:3 error:&error], @"%@", error);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+}
+
+#pragma mark - Private Func
+/// 修改stsc第entry个条目的字段(0: first_chunk，1: samples_per_chunk)
+- (void)patchStscEntry:(NSUInteger)entry field:(NSUInteger)field value:(uint32_t)value {
+    NSMutableData *data = [NSMutableData dataWithContentsOfFile:self.path];
+    // moov在mdat之后，从后往前找，不会匹配到随机负载
+    NSRange range = [data rangeOfData:[@"stsc" dataUsingEncoding:NSASCIIStringEncoding] options:NSDataSearchBackwards range:NSMakeRange(0, data.length)];
+    XCTAssertNotEqual(range.location, NSNotFound);
+    // 类型之后: version/flags(4) entry_count(4) 每个条目12字节
+    NSUInteger offset = NSMaxRange(range) + 8 + entry * 12 + field * 4;
+    uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    [data replaceBytesInRange:NSMakeRange(offset, 4) withBytes:bytes];
+    XCTAssertTrue([data writeToFile:self.path atomically:YES]);
+}
+
+#pragma mark - Read
+- (void)testReadsAllSamplesInOrder {
+    NSError *error = nil;
+    CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:self.path error:&error];
+    XCTAssertNotNil(demuxer, @"%@", error);
+    CQMP4Track *track = demuxer.videoTrack;
+    XCTAssertNotNil(track);
+    XCTAssertNil(demuxer.audioTrack);
+    XCTAssertEqual(track.type, CQMP4TrackTypeVideo);
+    XCTAssertEqual(track.codecType, (uint32_t)'avc1');
+    XCTAssertEqual(track.width, 1280);
+    XCTAssertEqual(track.height, 720);
+    XCTAssertEqual(track.naluLengthSize, 4u);
+    XCTAssertEqual(track.sampleCount, kFrameCount);
+    XCTAssertEqual(((const uint8_t *)track.sps.bytes)[4], 0x67);
+    XCTAssertEqual(((const uint8_t *)track.pps.bytes)[4], 0x68);
+
+    uint32_t count = 0;
+    uint64_t lastOffset = 0;
+    CQMP4Sample *sample = nil;
+    while ((sample = [demuxer nextSample])) {
+        XCTAssertEqual(sample.index, count);
+        XCTAssertEqual(sample.dts.value, (int64_t)count * kSampleDelta);
+        XCTAssertEqual(sample.pts.value, sample.dts.value);
+        XCTAssertEqual(sample.duration.value, (int64_t)kSampleDelta);
+        XCTAssertEqual(sample.isSync, count % 60 == 0);
+        XCTAssertGreaterThan(sample.fileOffset, lastOffset);
+        lastOffset = sample.fileOffset;
+
+        // 一个4字节长度头的NALU，关键帧是IDR
+        const uint8_t *bytes = sample.data.bytes;
+        uint32_t naluSize = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+        XCTAssertEqual(naluSize + 4, sample.data.length);
+        XCTAssertEqual(bytes[4] == 0x65, sample.isSync);
+        count++;
+    }
+    XCTAssertEqual(count, kFrameCount);
+    XCTAssertNil([demuxer nextSampleForTrack:track]);
+}
+
+- (void)testSeekLandsOnPreviousSyncSample {
+    CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:self.path error:nil];
+    XCTAssertTrue([demuxer seekToTime:CMTimeMake(5500, 1000)]);
+    CQMP4Sample *sample = [demuxer nextSample];
+    XCTAssertEqual(sample.index, 120u);
+    XCTAssertTrue(sample.isSync);
+    XCTAssertEqual(sample.dts.value, (int64_t)120 * kSampleDelta);
+
+    // 跳到最后一个不满的chunk里
+    XCTAssertTrue([demuxer seekToTime:CMTimeMake(10050, 1000)]);
+    sample = [demuxer nextSample];
+    XCTAssertEqual(sample.index, 300u);
+    uint32_t remaining = 1;
+    while ([demuxer nextSample]) remaining++;
+    XCTAssertEqual(remaining, kFrameCount - 300);
+}
+
+#pragma mark - Corrupt Tables
+- (void)testSeekFailsWhenStscDoesNotCoverSamples {
+    // 每个chunk只声明1帧，stsc+stco只覆盖前23帧
+    [self patchStscEntry:0 field:1 value:1];
+    CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:self.path error:nil];
+    XCTAssertNotNil(demuxer.videoTrack);
+    XCTAssertTrue([demuxer seekToTime:CMTimeMake(0, 1000)]);
+    XCTAssertFalse([demuxer seekToTime:CMTimeMake(5500, 1000)]);
+    XCTAssertNil([demuxer nextSample]);
+}
+
+- (void)testStscRunIsClampedToChunkCount {
+    // 最后一个条目的first_chunk远超过chunk数，前面的条目截断到最后一个chunk，不会读到stco之外
+    [self patchStscEntry:1 field:0 value:100000];
+    CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:self.path error:nil];
+    XCTAssertTrue([demuxer seekToTime:CMTimeMake(9000, 1000)]);
+    uint32_t count = 0;
+    CQMP4Sample *sample = nil;
+    while ((sample = [demuxer nextSample])) {
+        XCTAssertLessThanOrEqual(sample.fileOffset + sample.data.length, demuxer.fileSize);
+        count++;
+    }
+    XCTAssertGreaterThan(count, 0u);
+}
+
+- (void)testOpenFailsWhenStscReferencesMissingChunk {
+    [self patchStscEntry:0 field:0 value:1000];
+    NSError *error = nil;
+    CQMP4Demuxer *demuxer = [[CQMP4Demuxer alloc] initWithPath:self.path error:&error];
+    XCTAssertNil(demuxer);
+    XCTAssertEqualObjects(error.domain, CQMP4DemuxerErrorDomain);
+}
+
+@end
@@ -0,0 +1,211 @@
+//
+//  CQMediaExecutorTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import <stdatomic.h>
+#import "CQMediaExecutor.h"
+
+/**
+ CQMediaExecutor压力测试
+ 1. 多个线程同时向同一组strand提交，每个strand内按提交顺序执行、不会并发执行
+ 2. 每个通道的任务运行在该通道的QoS上(包括从低QoS线程提交的音频任务)
+ 3. 在工作线程上提交的积压任务能被同通道其它工作线程偷走
+ */
+@interface CQMediaExecutorTests : XCTestCase
+@property (nonatomic, strong) CQMediaExecutor *executor;
+@end
+
+@implementation CQMediaExecutorTests
+
+- (void)setUp {
+    self.executor = [[CQMediaExecutor alloc] initWithMaxConcurrency:4];
+}
+
+#pragma mark - Ordering
+- (void)testStrandOrderingWithConcurrentProducers {
+    static const NSUInteger kStrandCount = 16;
+    static const NSUInteger kProducerCount = 8;
+    static const NSUInteger kTasksPerProducer = 500;
+
+    NSMutableArray<CQMediaStrand *> *strands = [NSMutableArray array];
+    for (NSUInteger i = 0; i < kStrandCount; i++) {
+        CQMediaLane lane = (CQMediaLane)(i % 3);
+        [strands addObject:[self.executor strandWithLane:lane label:[NSString stringWithFormat:@"test.%lu", (unsigned long)i]]];
+    }
+
+    // 每个strand每个生产者的最后一个序号，只在strand上读写
+    __block uint32_t lastSeq[kStrandCount][kProducerCount];
+    memset(lastSeq, 0, sizeof(lastSeq));
+    __block _Atomic(uint32_t) outOfOrder = 0;
+    __block _Atomic(uint32_t) overlapped = 0;
+    __block _Atomic(uint32_t) notCurrent = 0;
+    __block _Atomic(uint32_t) executed = 0;
+    _Atomic(int) *running = calloc(kStrandCount, sizeof(_Atomic(int)));
+
+    dispatch_apply(kProducerCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t producer) {
+        for (uint32_t seq = 1; seq <= kTasksPerProducer; seq++) {
+            for (NSUInteger s = 0; s < kStrandCount; s++) {
+                CQMediaStrand *strand = strands[s];
+                [strand async:^{
+                    if (atomic_fetch_add(&running[s], 1) != 0) atomic_fetch_add(&overlapped, 1);
+                    if (!strand.isCurrent) atomic_fetch_add(&notCurrent, 1);
+                    if (lastSeq[s][producer] + 1 != seq) atomic_fetch_add(&outOfOrder, 1);
+                    lastSeq[s][producer] = seq;
+                    atomic_fetch_add(&executed, 1);
+                    atomic_fetch_sub(&running[s], 1);
+                }];
+            }
+        }
+    });
+    for (CQMediaStrand *strand in strands) {
+        [strand sync:^{}];
+    }
+
+    XCTAssertEqual(atomic_load(&executed), kStrandCount * kProducerCount * kTasksPerProducer);
+    XCTAssertEqual(atomic_load(&outOfOrder), 0u);
+    XCTAssertEqual(atomic_load(&overlapped), 0u);
+    XCTAssertEqual(atomic_load(&notCurrent), 0u);
+    free(running);
+}
+
+- (void)testAsyncBatchKeepsOrderWithAsync {
+    CQMediaStrand *strand = [self.executor strandWithLane:CQMediaLaneVideo label:@"test.batch"];
+    NSMutableArray<NSNumber *> *order = [NSMutableArray array];
+    NSUInteger expected = 0;
+    for (NSUInteger round = 0; round < 100; round++) {
+        NSUInteger base = expected;
+        [strand async:^{ [order addObject:@(base)]; }];
+        [strand asyncBatch:@[^{ [order addObject:@(base + 1)]; },
+                             ^{ [order addObject:@(base + 2)]; },
+                             ^{ [order addObject:@(base + 3)]; }]];
+        expected += 4;
+    }
+    [strand sync:^{}];
+
+    XCTAssertEqual(order.count, expected);
+    for (NSUInteger i = 0; i < order.count; i++) {
+        XCTAssertEqual(order[i].unsignedIntegerValue, i);
+    }
+}
+
+- (void)testSyncRunsInlineOnCurrentStrand {
+    CQMediaStrand *strand = [self.executor strandWithLane:CQMediaLaneAudio label:@"test.sync"];
+    __block BOOL inner = NO;
+    __block BOOL outer = NO;
+    [strand sync:^{
+        [strand sync:^{ inner = strand.isCurrent; }];
+        outer = YES;
+    }];
+    XCTAssertTrue(inner);
+    XCTAssertTrue(outer);
+    XCTAssertFalse(strand.isCurrent);
+}
+
+#pragma mark - QoS
+- (void)testLanesRunAtTheirOwnQoS {
+    CQMediaLane lanes[] = {CQMediaLaneAudio, CQMediaLaneVideo, CQMediaLaneBackground};
+    for (size_t i = 0; i < sizeof(lanes) / sizeof(lanes[0]); i++) {
+        CQMediaLane lane = lanes[i];
+        qos_class_t expectedQoS = [CQMediaExecutor qosClassForLane:lane];
+        CQMediaStrand *strand = [self.executor strandWithLane:lane label:@"test.qos"];
+        __block _Atomic(uint32_t) mismatched = 0;
+
+        // 从比通道更低和更高的QoS线程提交，都应该在通道自己的QoS上执行
+        dispatch_group_t group = dispatch_group_create();
+        qos_class_t producerQoS[] = {QOS_CLASS_UTILITY, QOS_CLASS_USER_INTERACTIVE};
+        for (size_t p = 0; p < 2; p++) {
+            dispatch_group_async(group, dispatch_get_global_queue(producerQoS[p], 0), ^{
+                for (NSUInteger n = 0; n < 200; n++) {
+                    [strand async:^{
+                        if (qos_class_self() != expectedQoS) atomic_fetch_add(&mismatched, 1);
+                    }];
+                }
+            });
+        }
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+        [strand sync:^{}];
+
+        XCTAssertEqual(atomic_load(&mismatched), 0u, @"lane %lu", (unsigned long)lane);
+    }
+}
+
+- (void)testWorkersDoNotRunOtherLanes {
+    CQMediaStrand *audio = [self.executor strandWithLane:CQMediaLaneAudio label:@"test.audio"];
+    CQMediaStrand *background = [self.executor strandWithLane:CQMediaLaneBackground label:@"test.background"];
+    qos_class_t audioQoS = [CQMediaExecutor qosClassForLane:CQMediaLaneAudio];
+    __block _Atomic(uint32_t) mismatched = 0;
+
+    // 音频任务里提交后台任务，后台任务不能在当前(音频)工作线程上接着执行
+    for (NSUInteger n = 0; n < 200; n++) {
+        [audio async:^{
+            [background async:^{
+                if (qos_class_self() == audioQoS) atomic_fetch_add(&mismatched, 1);
+            }];
+        }];
+    }
+    [audio sync:^{}];
+    [background sync:^{}];
+
+    XCTAssertEqual(atomic_load(&mismatched), 0u);
+}
+
+#pragma mark - Stealing
+- (void)testBacklogOnWorkerIsStolen {
+    if (NSProcessInfo.processInfo.activeProcessorCount < 2) return;
+
+    static const NSUInteger kStrandCount = 8;
+    NSMutableArray<CQMediaStrand *> *strands = [NSMutableArray array];
+    for (NSUInteger i = 0; i < kStrandCount; i++) {
+        [strands addObject:[self.executor strandWithLane:CQMediaLaneVideo label:@"test.steal"]];
+    }
+    CQMediaStrand *producer = [self.executor strandWithLane:CQMediaLaneVideo label:@"test.producer"];
+    __block _Atomic(uint32_t) executed = 0;
+
+    // 在工作线程上提交，strand进入该线程自己的队列；提交后忙等，积压只能被其它工作线程偷走执行
+    [producer async:^{
+        for (CQMediaStrand *strand in strands) {
+            [strand async:^{
+                usleep(2000);
+                atomic_fetch_add(&executed, 1);
+            }];
+        }
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+        while (atomic_load(&executed) < kStrandCount - 1 && CFAbsoluteTimeGetCurrent() < deadline) {}
+    }];
+    [producer sync:^{}];
+    for (CQMediaStrand *strand in strands) {
+        [strand sync:^{}];
+    }
+
+    XCTAssertEqual(atomic_load(&executed), kStrandCount);
+    XCTAssertGreaterThan(self.executor.stealCount, 0ull);
+}
+
+- (void)testSingleLocalSubmitRunsWhileWorkerIsBusy {
+    if (NSProcessInfo.processInfo.activeProcessorCount < 2) return;
+
+    CQMediaStrand *producer = [self.executor strandWithLane:CQMediaLaneVideo label:@"test.producer"];
+    CQMediaStrand *callback = [self.executor strandWithLane:CQMediaLaneVideo label:@"test.callback"];
+    __block _Atomic(bool) executed = false;
+    __block BOOL isExecutedWhileBusy = NO;
+
+    // 只积压一个strand，生产者的任务还没结束时也要被其它工作线程取走执行
+    [producer async:^{
+        [callback async:^{
+            atomic_store(&executed, true);
+        }];
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+        while (!atomic_load(&executed) && CFAbsoluteTimeGetCurrent() < deadline) {}
+        isExecutedWhileBusy = atomic_load(&executed);
+    }];
+    [producer sync:^{}];
+    [callback sync:^{}];
+
+    XCTAssertTrue(isExecutedWhileBusy);
+}
+
+@end
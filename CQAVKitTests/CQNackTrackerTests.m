@@ -0,0 +1,179 @@
+//
+//  CQNackTrackerTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQNackTracker.h"
+
+#define kTestMaxEvents 64
+
+/// 模拟接收过程中的请求记录
+typedef struct {
+    uint64_t nackTimeUs[kTestMaxEvents];  ///< 每次请求的时间
+    uint16_t nackSequence[kTestMaxEvents];  ///< 每次请求的序列号
+    size_t nackCount;
+    uint64_t keyFrameTimeUs[kTestMaxEvents];  ///< 每次请求关键帧的时间
+    size_t keyFrameCount;
+} CQTestNackLog;
+
+/// 收集一次请求并记录
+static void CQTestNackCollect(CQNackTracker *tracker, uint64_t nowUs, CQTestNackLog *log) {
+    uint16_t sequenceNumbers[64];
+    BOOL needsKeyFrame = NO;
+    size_t count = CQNackTrackerCollect(tracker, nowUs, sequenceNumbers, 64, &needsKeyFrame);
+    for (size_t i = 0; i < count && log->nackCount < kTestMaxEvents; i++) {
+        log->nackTimeUs[log->nackCount] = nowUs;
+        log->nackSequence[log->nackCount] = sequenceNumbers[i];
+        log->nackCount++;
+    }
+    if (needsKeyFrame && log->keyFrameCount < kTestMaxEvents) log->keyFrameTimeUs[log->keyFrameCount++] = nowUs;
+}
+
+@interface CQNackTrackerTests : XCTestCase
+
+@end
+
+@implementation CQNackTrackerTests
+
+#pragma mark - RTCP
+- (void)testNackWriteAndParse {
+    // 101、105、116在第一个FCI的BLP里，117距离超过16另起一个，65535和0跨越回绕
+    const uint16_t lost[] = {100, 101, 105, 116, 117, 200, 65535, 0};
+    const size_t lostCount = sizeof(lost) / sizeof(lost[0]);
+    uint8_t buffer[64];
+    size_t length = CQRTCPWriteNack(buffer, sizeof(buffer), 0x11111111, 0x22222222, lost, lostCount);
+    XCTAssertEqual(length, 12u + 4 * 4);
+    XCTAssertEqual(buffer[0], 0x81);
+    XCTAssertEqual(buffer[1], 205);
+    XCTAssertEqual((buffer[2] << 8) | buffer[3], (int)(length / 4 - 1));
+    XCTAssertEqual((buffer[14] << 8) | buffer[15], (1 << 0) | (1 << 4) | (1 << 15));
+
+    uint32_t mediaSSRC = 0;
+    uint16_t parsed[32];
+    XCTAssertEqual(CQRTCPParseNack(buffer, length, &mediaSSRC, parsed, 32), lostCount);
+    XCTAssertEqual(mediaSSRC, 0x22222222u);
+    XCTAssertEqual(memcmp(parsed, lost, sizeof(lost)), 0);
+
+    // 容量不足时只写能放下的FCI
+    length = CQRTCPWriteNack(buffer, 19, 1, 2, lost, lostCount);
+    XCTAssertEqual(length, 16u);
+    XCTAssertEqual(CQRTCPParseNack(buffer, length, &mediaSSRC, parsed, 32), 4u);
+    XCTAssertEqual(CQRTCPWriteNack(buffer, sizeof(buffer), 1, 2, lost, 0), 0u);
+
+    // NACK和PLI互不识别
+    XCTAssertFalse(CQRTCPIsPLI(buffer, length, &mediaSSRC));
+    XCTAssertEqual(CQRTCPWritePLI(buffer, 1, 0x33333333), (size_t)CQRTCPPLISize);
+    XCTAssertTrue(CQRTCPIsPLI(buffer, CQRTCPPLISize, &mediaSSRC));
+    XCTAssertEqual(mediaSSRC, 0x33333333u);
+    XCTAssertEqual(CQRTCPParseNack(buffer, CQRTCPPLISize, &mediaSSRC, parsed, 32), 0u);
+}
+
+#pragma mark - Loss Pattern
+- (void)testKnownLossPattern {
+    // 每1ms一个包，丢10、11、50；10的第一次重传40ms后到达，11和50的重传都丢了
+    CQNackTracker *tracker = CQNackTrackerCreate(CQNackTrackerDefaultConfig());
+    CQTestNackLog log = {0};
+    uint64_t retransmitArrivalUs = 0;
+    for (uint64_t ms = 0; ms <= 500; ms++) {
+        uint64_t nowUs = ms * 1000;
+        if (ms != 10 && ms != 11 && ms != 50) CQNackTrackerOnPacket(tracker, (uint16_t)ms, nowUs, NO);
+        if (retransmitArrivalUs != 0 && nowUs == retransmitArrivalUs) CQNackTrackerOnPacket(tracker, 10, nowUs, NO);
+        size_t previousNackCount = log.nackCount;
+        CQTestNackCollect(tracker, nowUs, &log);
+        for (size_t i = previousNackCount; i < log.nackCount; i++) {
+            if (log.nackSequence[i] == 10 && retransmitArrivalUs == 0) retransmitArrivalUs = nowUs + 40000;
+        }
+    }
+
+    // 12到达时发现缺口，等过10ms乱序时间后一起请求
+    XCTAssertGreaterThanOrEqual(log.nackCount, 3u);
+    XCTAssertEqual(log.nackSequence[0], 10);
+    XCTAssertEqual(log.nackSequence[1], 11);
+    XCTAssertEqual(log.nackTimeUs[0], 22000u);
+    XCTAssertEqual(log.nackTimeUs[1], 22000u);
+    XCTAssertEqual(log.nackSequence[2], 50);
+    XCTAssertEqual(log.nackTimeUs[2], 61000u);
+    // 重传包测出RTT: (100 x 7 + 40) / 8 = 92.5ms
+    XCTAssertEqual(CQNackTrackerRtt(tracker), 92500u);
+    // 再请求要在1.25个RTT之后，那时已经赶不上截止时间(发现后200ms)，之后不再请求
+    XCTAssertEqual(log.nackCount, 3u);
+
+    // 11在截止时间(212ms)过后放弃并请求关键帧，关键帧请求后50也一并放弃，不会再请求关键帧
+    XCTAssertEqual(log.keyFrameCount, 1u);
+    XCTAssertEqual(log.keyFrameTimeUs[0], 213000u);
+    XCTAssertEqual(CQNackTrackerAbandonedCount(tracker), 2u);
+    // 放弃的包在截止时间后2个RTT清除
+    XCTAssertEqual(CQNackTrackerMissingCount(tracker), 0u);
+    CQNackTrackerDestroy(tracker);
+}
+
+- (void)testReorderDelayAdaptsToObservedReordering {
+    CQNackTracker *tracker = CQNackTrackerCreate(CQNackTrackerDefaultConfig());
+    CQTestNackLog log = {0};
+    // 每20ms收集一次: 5在6ms发现缺口，19ms乱序到达，在请求前到达，不请求
+    for (uint64_t ms = 0; ms <= 100; ms++) {
+        uint64_t nowUs = ms * 1000;
+        if (ms != 5) CQNackTrackerOnPacket(tracker, (uint16_t)ms, nowUs, NO);
+        if (ms == 19) CQNackTrackerOnPacket(tracker, 5, nowUs, NO);
+        if (ms % 20 == 0) CQTestNackCollect(tracker, nowUs, &log);
+    }
+    XCTAssertEqual(log.nackCount, 0u);
+    XCTAssertEqual(CQNackTrackerMissingCount(tracker), 0u);
+
+    // 观察到13ms的乱序后，乱序等待从10ms变成13ms: 105在106ms发现，119ms才请求
+    for (uint64_t ms = 101; ms <= 300; ms++) {
+        uint64_t nowUs = ms * 1000;
+        if (ms != 105) CQNackTrackerOnPacket(tracker, (uint16_t)ms, nowUs, NO);
+        if (ms == 150) CQNackTrackerOnPacket(tracker, 105, nowUs, NO);
+        CQTestNackCollect(tracker, nowUs, &log);
+    }
+    XCTAssertEqual(log.nackCount, 1u);
+    XCTAssertEqual(log.nackSequence[0], 105);
+    XCTAssertEqual(log.nackTimeUs[0], 119000u);
+    XCTAssertEqual(CQNackTrackerAbandonedCount(tracker), 0u);
+    XCTAssertEqual(log.keyFrameCount, 0u);
+    CQNackTrackerDestroy(tracker);
+}
+
+- (void)testSequenceWrapAround {
+    CQNackTracker *tracker = CQNackTrackerCreate(CQNackTrackerDefaultConfig());
+    CQTestNackLog log = {0};
+    // 65530开始，丢65535和0
+    for (uint64_t i = 0; i < 20; i++) {
+        uint16_t sequence = (uint16_t)(65530 + i);
+        if (sequence != 65535 && sequence != 0) CQNackTrackerOnPacket(tracker, sequence, i * 1000, NO);
+    }
+    XCTAssertEqual(CQNackTrackerMissingCount(tracker), 2u);
+    CQTestNackCollect(tracker, 30000, &log);
+    XCTAssertEqual(log.nackCount, 2u);
+    XCTAssertEqual(log.nackSequence[0], 65535);
+    XCTAssertEqual(log.nackSequence[1], 0);
+    CQNackTrackerDestroy(tracker);
+}
+
+- (void)testBurstLossRequestsKeyFrameImmediately {
+    CQNackTracker *tracker = CQNackTrackerCreate(CQNackTrackerDefaultConfig());
+    CQTestNackLog log = {0};
+    CQNackTrackerOnPacket(tracker, 0, 0, NO);
+    // 缺口超过能跟踪的个数，不再请求重传
+    CQNackTrackerOnPacket(tracker, CQNackTrackerMaxMissing + 2, 1000, NO);
+    XCTAssertEqual(CQNackTrackerMissingCount(tracker), 0u);
+    XCTAssertEqual(CQNackTrackerAbandonedCount(tracker), (uint64_t)CQNackTrackerMaxMissing + 1);
+    CQTestNackCollect(tracker, 1000, &log);
+    XCTAssertEqual(log.nackCount, 0u);
+    XCTAssertEqual(log.keyFrameCount, 1u);
+
+    // 关键帧请求按最小间隔限频
+    CQNackTrackerOnPacket(tracker, CQNackTrackerMaxMissing * 3, 2000, NO);
+    CQTestNackCollect(tracker, 2000, &log);
+    XCTAssertEqual(log.keyFrameCount, 1u);
+    CQTestNackCollect(tracker, 501000, &log);
+    XCTAssertEqual(log.keyFrameCount, 2u);
+    XCTAssertEqual(log.keyFrameTimeUs[1], 501000u);
+    CQNackTrackerDestroy(tracker);
+}
+
+@end
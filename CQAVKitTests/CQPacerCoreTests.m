@@ -0,0 +1,202 @@
+//
+//  CQPacerCoreTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQPacketPacer.h"
+
+/// 丢弃回调统计
+typedef struct {
+    size_t count;
+    uint64_t bytes;
+    uint64_t lastFrameID;
+} CQTestDropStats;
+
+static void CQTestPacerDidDrop(void *opaque, const CQPacerPacket *packet) {
+    CQTestDropStats *stats = opaque;
+    stats->count++;
+    stats->bytes += packet->size;
+    stats->lastFrameID = packet->frameID;
+}
+
+static CQPacerPacket CQTestPacket(uint32_t size, CQPacerPriority priority, uint64_t frameID, uint64_t deadlineUs) {
+    return (CQPacerPacket){.size = size, .priority = priority, .frameID = frameID, .deadlineUs = deadlineUs};
+}
+
+/// 出队所有当前可以发送的包，返回个数
+static size_t CQTestPopAll(CQPacerCore *core, uint64_t nowUs, uint64_t *bytes) {
+    size_t count = 0;
+    CQPacerPacket packet;
+    while (CQPacerCorePop(core, nowUs, &packet)) {
+        count++;
+        if (bytes) *bytes += packet.size;
+    }
+    return count;
+}
+
+@interface CQPacerCoreTests : XCTestCase
+
+@end
+
+@implementation CQPacerCoreTests
+
+#pragma mark - Token Bucket
+- (void)testBurstIsBoundedByBucket {
+    // 8Mbps x 1 = 1字节/微秒，5ms的桶为5000字节
+    CQPacerCore *core = CQPacerCoreCreate(8000000, 1.0);
+    for (uint64_t i = 0; i < 20; i++) {
+        CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityVideo, i, 0), 0);
+    }
+    XCTAssertEqual(CQPacerCoreQueuedPackets(core), 20u);
+    XCTAssertEqual(CQPacerCoreQueuedBytes(core), 20000u);
+
+    // 一开始桶是满的，发完5个后令牌为0
+    XCTAssertEqual(CQTestPopAll(core, 0, NULL), 5u);
+    XCTAssertEqual(CQPacerCoreNextSendTime(core, 0), 1u);
+    // 1ms补1000字节，正好一个包
+    XCTAssertEqual(CQTestPopAll(core, 1000, NULL), 1u);
+
+    // 空闲很久令牌也不会超过桶容量
+    XCTAssertEqual(CQTestPopAll(core, 10000000, NULL), 5u);
+    XCTAssertEqual(CQPacerCoreQueuedPackets(core), 9u);
+
+    // 允许欠账一个包: 令牌大于0时可以发一个比令牌大的包
+    CQPacerCoreEnqueue(core, CQTestPacket(1400, CQPacerPriorityVideo, 100, 0), 10000000);
+    XCTAssertEqual(CQTestPopAll(core, 10000100, NULL), 1u);
+    CQPacerCoreDestroy(core);
+}
+
+- (void)testMinimumBucketFitsOneMTU {
+    // 100kbps的5ms只有62字节，桶容量至少1500，大包也能发出去
+    CQPacerCore *core = CQPacerCoreCreate(100000, 1.0);
+    CQPacerCoreEnqueue(core, CQTestPacket(1200, CQPacerPriorityVideo, 1, 0), 0);
+    CQPacerCoreEnqueue(core, CQTestPacket(1200, CQPacerPriorityVideo, 1, 0), 0);
+    XCTAssertEqual(CQTestPopAll(core, 0, NULL), 2u);
+    CQPacerCoreDestroy(core);
+}
+
+- (void)testLongTermRateFollowsTarget {
+    // 1Mbps x 2.5 = 312.5字节/毫秒，按NextSendTime驱动1秒
+    CQPacerCore *core = CQPacerCoreCreate(1000000, 2.5);
+    for (uint64_t i = 0; i < 1000; i++) {
+        CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityVideo, i / 10, 0), 0);
+    }
+    uint64_t nowUs = 0, sentBytes = 0;
+    while (YES) {
+        CQTestPopAll(core, nowUs, &sentBytes);
+        uint64_t nextUs = CQPacerCoreNextSendTime(core, nowUs);
+        XCTAssertGreaterThan(nextUs, nowUs);
+        if (nextUs > 1000000) break;
+        nowUs = nextUs;
+    }
+    // 1秒发送的字节数 = 速率 x 时间 + 初始的桶 + 最多欠账一个包
+    double expectedBytes = 312.5 * 1000 + 312.5 * 5;
+    XCTAssertEqualWithAccuracy((double)sentBytes, expectedBytes, 1000);
+
+    // 码率减半后，下一秒只发出一半
+    CQPacerCoreSetTargetBitrate(core, 500000);
+    uint64_t secondBytes = 0;
+    while (YES) {
+        CQTestPopAll(core, nowUs, &secondBytes);
+        uint64_t nextUs = CQPacerCoreNextSendTime(core, nowUs);
+        if (nextUs > 2000000) break;
+        nowUs = nextUs;
+    }
+    XCTAssertEqualWithAccuracy((double)secondBytes, 156.25 * 1000, 1500);
+    CQPacerCoreDestroy(core);
+}
+
+#pragma mark - Priority
+- (void)testPriorityOrder {
+    CQPacerCore *core = CQPacerCoreCreate(8000000, 1.0);
+    CQPacerCoreEnqueue(core, CQTestPacket(100, CQPacerPriorityVideo, 1, 0), 0);
+    CQPacerCoreEnqueue(core, CQTestPacket(100, CQPacerPriorityRetransmission, 2, 0), 0);
+    CQPacerCoreEnqueue(core, CQTestPacket(100, CQPacerPriorityKeyFrame, 3, 0), 0);
+    CQPacerCoreEnqueue(core, CQTestPacket(100, CQPacerPriorityAudio, 4, 0), 0);
+    CQPacerPacket packet;
+    uint64_t expectedFrameIDs[] = {4, 3, 2, 1};
+    for (size_t i = 0; i < 4; i++) {
+        XCTAssertTrue(CQPacerCorePop(core, 10, &packet));
+        XCTAssertEqual(packet.frameID, expectedFrameIDs[i]);
+        XCTAssertEqual(packet.enqueueTimeUs, 0u);
+    }
+    XCTAssertFalse(CQPacerCorePop(core, 10, &packet));
+    XCTAssertEqual(CQPacerCoreNextSendTime(core, 10), UINT64_MAX);
+    CQPacerCoreDestroy(core);
+}
+
+- (void)testAudioBypassesBudgetAndBlocksNothing {
+    CQPacerCore *core = CQPacerCoreCreate(8000000, 1.0);
+    // 关键帧用光令牌
+    for (uint64_t i = 0; i < 10; i++) {
+        CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityKeyFrame, 1, 0), 0);
+    }
+    XCTAssertEqual(CQTestPopAll(core, 0, NULL), 5u);
+
+    // 令牌不足时音频照样发送(并消耗令牌)，视频继续等待
+    CQPacerCoreEnqueue(core, CQTestPacket(200, CQPacerPriorityAudio, 2, 0), 0);
+    CQPacerCoreEnqueue(core, CQTestPacket(100, CQPacerPriorityVideo, 3, 0), 0);
+    XCTAssertEqual(CQPacerCoreNextSendTime(core, 0), 0u);
+    CQPacerPacket packet;
+    XCTAssertTrue(CQPacerCorePop(core, 0, &packet));
+    XCTAssertEqual(packet.priority, CQPacerPriorityAudio);
+    XCTAssertFalse(CQPacerCorePop(core, 0, &packet));
+    // 欠的200字节也要补回来
+    XCTAssertEqual(CQPacerCoreNextSendTime(core, 0), 201u);
+
+    // 关键帧剩下的包发完之前普通视频不会插队
+    uint64_t nowUs = 0;
+    for (size_t i = 0; i < 5; i++) {
+        nowUs = CQPacerCoreNextSendTime(core, nowUs);
+        XCTAssertTrue(CQPacerCorePop(core, nowUs, &packet));
+        XCTAssertEqual(packet.priority, CQPacerPriorityKeyFrame);
+    }
+    nowUs = CQPacerCoreNextSendTime(core, nowUs);
+    XCTAssertTrue(CQPacerCorePop(core, nowUs, &packet));
+    XCTAssertEqual(packet.frameID, 3u);
+    CQPacerCoreDestroy(core);
+}
+
+#pragma mark - Deadline
+- (void)testExpiredFramesAreDroppedWhole {
+    CQTestDropStats stats = {0};
+    CQPacerCore *core = CQPacerCoreCreate(8000000, 1.0);
+    CQPacerCoreSetDropCallback(core, CQTestPacerDidDrop, &stats);
+    // 帧1已经开始发送，帧2还没有，两帧的截止时间都是10ms
+    for (uint64_t i = 0; i < 8; i++) {
+        CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityVideo, 1, 10000), 0);
+    }
+    for (uint64_t i = 0; i < 4; i++) {
+        CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityVideo, 2, 10000), 0);
+    }
+    CQPacerCoreEnqueue(core, CQTestPacket(1000, CQPacerPriorityVideo, 3, 0), 0);
+    XCTAssertEqual(CQTestPopAll(core, 0, NULL), 5u);
+
+    // 过期后帧1剩下的3个包照常发送，之后整个帧2丢弃，帧3不过期
+    CQPacerPacket packet;
+    uint64_t nowUs = 20000;
+    uint64_t sentFrameIDs[8] = {0};
+    size_t sentCount = 0;
+    while (CQPacerCoreQueuedPackets(core) > 0 && sentCount < 8) {
+        nowUs = MAX(nowUs, CQPacerCoreNextSendTime(core, nowUs));
+        if (CQPacerCorePop(core, nowUs, &packet)) sentFrameIDs[sentCount++] = packet.frameID;
+    }
+    uint64_t expectedFrameIDs[] = {1, 1, 1, 3};
+    XCTAssertEqual(sentCount, 4u);
+    XCTAssertEqual(memcmp(sentFrameIDs, expectedFrameIDs, sizeof(expectedFrameIDs)), 0);
+    XCTAssertEqual(stats.count, 4u);
+    XCTAssertEqual(stats.bytes, 4000u);
+    XCTAssertEqual(stats.lastFrameID, 2u);
+    XCTAssertEqual(CQPacerCoreQueuedBytes(core), 0u);
+
+    // 销毁时剩下的包也交给丢弃回调
+    CQPacerCoreEnqueue(core, CQTestPacket(500, CQPacerPriorityAudio, 4, 0), nowUs);
+    CQPacerCoreDestroy(core);
+    XCTAssertEqual(stats.count, 5u);
+    XCTAssertEqual(stats.lastFrameID, 4u);
+}
+
+@end
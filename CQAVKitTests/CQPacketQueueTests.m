@@ -0,0 +1,329 @@
+//
+//  CQPacketQueueTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQPacketQueue.h"
+
+/**
+ CQPacketQueue测试(压力测试部分需要在Thread Sanitizer下也能通过)
+ 1. SPSC跨过环形缓冲末尾后仍然按顺序，满/空时返回NO/nil
+ 2. MPSC多个生产者同时放入，每个生产者的数据保持顺序，不丢不重
+ 3. 等待超时和被生产者唤醒(挂起/唤醒)
+ 4. 释放队列时还在队列里的对象被释放
+ */
+
+#define kProducerCount 4  ///< MPSC的生产者线程数
+static const uint32_t kItemsPerProducer = 20000;
+
+/// 生产者编号和序号编码成一个值
+static inline NSNumber *CQTestItem(NSUInteger producer, uint32_t sequence) {
+    return @(((uint64_t)producer << 32) | sequence);
+}
+
+@interface CQPacketQueueTests : XCTestCase
+
+@end
+
+@implementation CQPacketQueueTests
+
+#pragma mark - SPSC
+- (void)testSPSCFullAndEmpty {
+    // 容量向上取整为2的幂
+    XCTAssertEqual([[CQSPSCQueue alloc] initWithCapacity:3].capacity, 4u);
+    XCTAssertEqual([[CQSPSCQueue alloc] initWithCapacity:0].capacity, 2u);
+
+    CQSPSCQueue<NSNumber *> *queue = [[CQSPSCQueue alloc] initWithCapacity:4];
+    XCTAssertNil([queue pop]);
+    for (int i = 0; i < 4; i++) {
+        XCTAssertTrue([queue push:@(i)]);
+    }
+    XCTAssertFalse([queue push:@4]);
+    XCTAssertEqual(queue.count, 4u);
+    XCTAssertEqualObjects([queue pop], @0);
+    XCTAssertTrue([queue push:@4]);
+    for (int i = 1; i <= 4; i++) {
+        XCTAssertEqualObjects([queue pop], @(i));
+    }
+    XCTAssertNil([queue pop]);
+    XCTAssertEqual(queue.count, 0u);
+}
+
+- (void)testSPSCOrderingAcrossWraparound {
+    // 每轮放入3个取出3个，位置不断跨过容量4的末尾
+    CQSPSCQueue<NSNumber *> *queue = [[CQSPSCQueue alloc] initWithCapacity:4];
+    int next = 0, expected = 0;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 3; i++) {
+            XCTAssertTrue([queue push:@(next++)]);
+        }
+        for (int i = 0; i < 3; i++) {
+            XCTAssertEqualObjects([queue pop], @(expected++));
+        }
+    }
+    XCTAssertNil([queue pop]);
+}
+
+- (void)testSPSCStress {
+    // 一个生产者线程、测试线程作为消费者，容量很小，满和空反复出现
+    CQSPSCQueue<NSNumber *> *queue = [[CQSPSCQueue alloc] initWithCapacity:64];
+    queue.spinCount = 100;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (uint32_t i = 0; i < kItemsPerProducer; i++) {
+            while (![queue push:@(i)]) {
+                sched_yield();
+            }
+        }
+    });
+    // 批量和单个取出交替使用
+    __block uint32_t expected = 0, outOfOrder = 0;
+    while (expected < kItemsPerProducer) {
+        if (![queue waitForObjectsWithTimeout:5]) break;
+        [queue popBatchWithMaxCount:16 usingBlock:^(NSNumber *object) {
+            if (object.unsignedIntValue != expected) outOfOrder++;
+            expected++;
+        }];
+        NSNumber *object = [queue pop];
+        if (object) {
+            if (object.unsignedIntValue != expected) outOfOrder++;
+            expected++;
+        }
+    }
+    XCTAssertEqual(expected, kItemsPerProducer);
+    XCTAssertEqual(outOfOrder, 0u);
+    XCTAssertNil([queue pop]);
+}
+
+#pragma mark - MPSC
+- (void)testMPSCFullAndEmpty {
+    CQMPSCQueue<NSNumber *> *queue = [[CQMPSCQueue alloc] initWithCapacity:4];
+    XCTAssertNil([queue pop]);
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 4; i++) {
+            XCTAssertTrue([queue push:@(round * 4 + i)]);
+        }
+        XCTAssertFalse([queue push:@(-1)]);
+        XCTAssertEqual(queue.count, 4u);
+        for (int i = 0; i < 4; i++) {
+            XCTAssertEqualObjects([queue pop], @(round * 4 + i));
+        }
+        XCTAssertNil([queue pop]);
+    }
+}
+
+- (void)testMPSCPerProducerOrdering {
+    // 4个生产者线程同时放入，消费者按生产者检查序号连续递增(不丢不重)
+    CQMPSCQueue<NSNumber *> *queue = [[CQMPSCQueue alloc] initWithCapacity:256];
+    for (NSUInteger producer = 0; producer < kProducerCount; producer++) {
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            for (uint32_t sequence = 0; sequence < kItemsPerProducer; sequence++) {
+                while (![queue push:CQTestItem(producer, sequence)]) {
+                    sched_yield();
+                }
+            }
+        });
+    }
+    __block uint32_t nextSequence[kProducerCount];
+    memset(nextSequence, 0, sizeof(nextSequence));
+    __block NSUInteger received = 0, outOfOrder = 0;
+    while (received < kProducerCount * kItemsPerProducer) {
+        if (![queue waitForObjectsWithTimeout:5]) break;
+        [queue popBatchWithMaxCount:32 usingBlock:^(NSNumber *object) {
+            uint64_t value = object.unsignedLongLongValue;
+            NSUInteger producer = (NSUInteger)(value >> 32);
+            uint32_t sequence = (uint32_t)value;
+            if (producer >= kProducerCount || nextSequence[producer] != sequence) {
+                outOfOrder++;
+            } else {
+                nextSequence[producer]++;
+            }
+            received++;
+        }];
+    }
+    XCTAssertEqual(received, kProducerCount * kItemsPerProducer);
+    XCTAssertEqual(outOfOrder, 0u);
+    for (NSUInteger producer = 0; producer < kProducerCount; producer++) {
+        XCTAssertEqual(nextSequence[producer], kItemsPerProducer, @"producer %lu", (unsigned long)producer);
+    }
+    XCTAssertNil([queue pop]);
+}
+
+#pragma mark - Batch
+- (void)testPopBatchOrdering {
+    CQSPSCQueue<NSNumber *> *spsc = [[CQSPSCQueue alloc] initWithCapacity:16];
+    CQMPSCQueue<NSNumber *> *mpsc = [[CQMPSCQueue alloc] initWithCapacity:16];
+    for (int i = 0; i < 10; i++) {
+        XCTAssertTrue([spsc push:@(i)]);
+        XCTAssertTrue([mpsc push:@(i)]);
+    }
+    // 每次最多4个，按放入顺序回调，取完返回0且不回调
+    NSMutableArray<NSNumber *> *spscOrder = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *mpscOrder = [NSMutableArray array];
+    NSUInteger spscCounts[4], mpscCounts[4];
+    for (int i = 0; i < 4; i++) {
+        spscCounts[i] = [spsc popBatchWithMaxCount:4 usingBlock:^(NSNumber *object) { [spscOrder addObject:object]; }];
+        mpscCounts[i] = [mpsc popBatchWithMaxCount:4 usingBlock:^(NSNumber *object) { [mpscOrder addObject:object]; }];
+    }
+    NSUInteger expectedCounts[4] = {4, 4, 2, 0};
+    for (int i = 0; i < 4; i++) {
+        XCTAssertEqual(spscCounts[i], expectedCounts[i]);
+        XCTAssertEqual(mpscCounts[i], expectedCounts[i]);
+    }
+    XCTAssertEqual(spscOrder.count, 10u);
+    XCTAssertEqual(mpscOrder.count, 10u);
+    for (int i = 0; i < 10; i++) {
+        XCTAssertEqualObjects(spscOrder[i], @(i));
+        XCTAssertEqualObjects(mpscOrder[i], @(i));
+    }
+}
+
+#pragma mark - Mailbox
+- (void)testMailboxOverwrite {
+    CQMailbox<NSNumber *> *mailbox = [[CQMailbox alloc] init];
+    XCTAssertNil([mailbox take]);
+    // 第一次放入信箱是空的，之后每次覆盖旧值
+    XCTAssertFalse([mailbox post:@1]);
+    XCTAssertTrue([mailbox post:@2]);
+    XCTAssertTrue([mailbox post:@3]);
+    XCTAssertEqual(mailbox.overwrittenCount, 2u);
+    XCTAssertEqualObjects([mailbox take], @3);
+    XCTAssertNil([mailbox take]);
+    XCTAssertFalse([mailbox post:@4]);
+    XCTAssertEqual(mailbox.overwrittenCount, 2u);
+    XCTAssertEqualObjects([mailbox take], @4);
+}
+
+- (void)testMailboxStress {
+    // 生产者不停放入递增的值，消费者取到的值递增，取到的个数 + 覆盖的个数 = 放入的个数
+    CQMailbox<NSNumber *> *mailbox = [[CQMailbox alloc] init];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (uint32_t i = 1; i <= kItemsPerProducer; i++) {
+            [mailbox post:@(i)];
+        }
+    });
+    uint32_t last = 0, outOfOrder = 0, takenCount = 0;
+    while (last < kItemsPerProducer) {
+        if (![mailbox waitForObjectWithTimeout:5]) break;
+        NSNumber *object = [mailbox take];
+        if (!object) continue;
+        if (object.unsignedIntValue <= last) outOfOrder++;
+        last = object.unsignedIntValue;
+        takenCount++;
+    }
+    // 最后一次放入的计数可能还没更新，等生产者结束再比较
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    XCTAssertEqual(last, kItemsPerProducer);
+    XCTAssertEqual(outOfOrder, 0u);
+    XCTAssertEqual(takenCount + mailbox.overwrittenCount, (uint64_t)kItemsPerProducer);
+}
+
+#pragma mark - Wait
+- (void)testWaitTimesOut {
+    CQSPSCQueue<NSNumber *> *spsc = [[CQSPSCQueue alloc] initWithCapacity:4];
+    CQMPSCQueue<NSNumber *> *mpsc = [[CQMPSCQueue alloc] initWithCapacity:4];
+    CQMailbox<NSNumber *> *mailbox = [[CQMailbox alloc] init];
+    spsc.spinCount = 10;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    XCTAssertFalse([spsc waitForObjectsWithTimeout:0.05]);
+    XCTAssertFalse([mpsc waitForObjectsWithTimeout:0.05]);
+    XCTAssertFalse([mailbox waitForObjectWithTimeout:0.05]);
+    XCTAssertGreaterThanOrEqual(CFAbsoluteTimeGetCurrent() - start, 0.14);
+
+    // 已经有数据时不等待
+    [spsc push:@1];
+    [mpsc push:@1];
+    [mailbox post:@1];
+    XCTAssertTrue([spsc waitForObjectsWithTimeout:0]);
+    XCTAssertTrue([mpsc waitForObjectsWithTimeout:0]);
+    XCTAssertTrue([mailbox waitForObjectWithTimeout:0]);
+}
+
+- (void)testWaitIsWokenByProducer {
+    // 消费者先挂起，生产者稍后放入，等待在超时之前返回
+    CQSPSCQueue<NSNumber *> *spsc = [[CQSPSCQueue alloc] initWithCapacity:4];
+    CQMPSCQueue<NSNumber *> *mpsc = [[CQMPSCQueue alloc] initWithCapacity:4];
+    CQMailbox<NSNumber *> *mailbox = [[CQMailbox alloc] init];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.05 * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        [spsc push:@1];
+        [mpsc push:@2];
+        [mailbox post:@3];
+    });
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    XCTAssertTrue([spsc waitForObjectsWithTimeout:10]);
+    XCTAssertTrue([mpsc waitForObjectsWithTimeout:10]);
+    XCTAssertTrue([mailbox waitForObjectWithTimeout:10]);
+    XCTAssertLessThan(CFAbsoluteTimeGetCurrent() - start, 5.0);
+    XCTAssertEqualObjects([spsc pop], @1);
+    XCTAssertEqualObjects([mpsc pop], @2);
+    XCTAssertEqualObjects([mailbox take], @3);
+}
+
+- (void)testParkAndWakeRepeatedly {
+    // 一问一答: 每次消费者都要挂起再被唤醒，丢失一次唤醒就会超时
+    CQSPSCQueue<NSNumber *> *requests = [[CQSPSCQueue alloc] initWithCapacity:4];
+    CQMPSCQueue<NSNumber *> *responses = [[CQMPSCQueue alloc] initWithCapacity:4];
+    static const uint32_t kRoundCount = 2000;
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (uint32_t i = 0; i < kRoundCount; i++) {
+            if (![requests waitForObjectsWithTimeout:5]) return;
+            NSNumber *request = [requests pop];
+            [responses push:@(request.unsignedIntValue + 1)];
+        }
+    });
+    uint32_t completed = 0;
+    for (uint32_t i = 0; i < kRoundCount; i++) {
+        [requests push:@(i)];
+        if (![responses waitForObjectsWithTimeout:5]) break;
+        if ([responses pop].unsignedIntValue == i + 1) completed++;
+    }
+    XCTAssertEqual(completed, kRoundCount);
+}
+
+#pragma mark - Dealloc
+- (void)testQueuedObjectsReleasedOnDealloc {
+    __weak NSObject *weakSPSC = nil, *weakMPSC = nil, *weakMailbox = nil;
+    @autoreleasepool {
+        CQSPSCQueue *spsc = [[CQSPSCQueue alloc] initWithCapacity:4];
+        CQMPSCQueue *mpsc = [[CQMPSCQueue alloc] initWithCapacity:4];
+        CQMailbox *mailbox = [[CQMailbox alloc] init];
+        NSObject *object = [[NSObject alloc] init];
+        weakSPSC = object;
+        [spsc push:object];
+        object = [[NSObject alloc] init];
+        weakMPSC = object;
+        [mpsc push:object];
+        object = [[NSObject alloc] init];
+        weakMailbox = object;
+        [mailbox post:object];
+        object = nil;
+        // 队列还在时对象被队列持有
+        XCTAssertNotNil(weakSPSC);
+        XCTAssertNotNil(weakMPSC);
+        XCTAssertNotNil(weakMailbox);
+        spsc = nil;
+        mpsc = nil;
+        mailbox = nil;
+    }
+    XCTAssertNil(weakSPSC);
+    XCTAssertNil(weakMPSC);
+    XCTAssertNil(weakMailbox);
+}
+
+- (void)testOverwrittenObjectIsReleased {
+    CQMailbox *mailbox = [[CQMailbox alloc] init];
+    __weak NSObject *weakObject = nil;
+    @autoreleasepool {
+        NSObject *object = [[NSObject alloc] init];
+        weakObject = object;
+        [mailbox post:object];
+        [mailbox post:[[NSObject alloc] init]];
+    }
+    XCTAssertNil(weakObject);
+}
+
+@end
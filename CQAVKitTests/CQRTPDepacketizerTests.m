@@ -0,0 +1,214 @@
+//
+//  CQRTPDepacketizerTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQRTPPacketizer.h"
+#import "CQRTPDepacketizer.h"
+#import "CQNaluUtil.h"
+#import "CQBenchmarkStreamGenerator.h"
+
+@interface CQRTPDepacketizerTests : XCTestCase<CQRTPDepacketizerDelegate>
+@property (nonatomic, strong) NSMutableArray<NSArray<NSData *> *> *outputFrames;  ///< 解包输出的帧
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *outputTimestamps;
+@property (nonatomic, assign) NSUInteger lossReportCount;  ///< 丢包回调次数
+@property (nonatomic, strong, nullable) XCTestExpectation *lossExpectation;
+@end
+
+@implementation CQRTPDepacketizerTests
+
+- (void)setUp {
+    self.outputFrames = [NSMutableArray array];
+    self.outputTimestamps = [NSMutableArray array];
+    self.lossReportCount = 0;
+    self.lossExpectation = nil;
+}
+
+#pragma mark - Private Func
+/// 拆成NALU数组，每个NALU带4字节起始码
+- (NSArray<NSData *> *)nalusOfFrame:(NSData *)frame {
+    NSMutableArray<NSData *> *nalus = [NSMutableArray array];
+    const uint8_t *bytes = frame.bytes;
+    CQNaluEnumerateAnnexB(bytes, frame.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        size_t start = (size_t)(nalu - bytes) - 4;
+        [nalus addObject:[frame subdataWithRange:NSMakeRange(start, naluSize + 4)]];
+    }];
+    return nalus;
+}
+
+/// 生成frameCount帧(第一帧为IDR)，返回每帧的NALU，packets为按发送顺序的RTP包
+- (NSArray<NSArray<NSData *> *> *)framesWithCount:(NSUInteger)frameCount packets:(NSMutableArray<NSData *> *)packets {
+    CQRTPPacketizer *packetizer = [[CQRTPPacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264 payloadType:96 clockRate:90000 ssrc:1];
+    NSMutableArray<NSArray<NSData *> *> *frames = [NSMutableArray array];
+    for (NSUInteger i = 0; i < frameCount; i++) {
+        BOOL isKeyFrame = (i == 0);
+        NSData *frame = [CQBenchmarkStreamGenerator h264FrameWithSize:isKeyFrame ? 12000 : 3000 sliceCount:isKeyFrame ? 2 : 1 isKeyFrame:isKeyFrame seed:(uint32_t)(i + 1)];
+        NSArray<NSData *> *nalus = [self nalusOfFrame:frame];
+        [frames addObject:nalus];
+        for (CQRTPPacket *packet in [packetizer packetizeH264Nalus:nalus pts:CMTimeMake((int64_t)i, 30)]) {
+            [packets addObject:packet.serializedData];
+        }
+    }
+    return frames;
+}
+
+/// 手工构造一个带填充的Single NAL包
+- (NSData *)paddedPacketWithSequence:(uint16_t)sequence paddingLength:(uint8_t)paddingLength paddingByte:(uint8_t)paddingByte {
+    NSMutableData *packet = [NSMutableData dataWithLength:CQRTPHeaderSize];
+    uint8_t *header = packet.mutableBytes;
+    header[0] = 0x80 | 0x20;
+    header[1] = 0x80 | 96;
+    header[2] = (uint8_t)(sequence >> 8);
+    header[3] = (uint8_t)sequence;
+    static const uint8_t nalu[] = {0x41, 0x9A, 0x11, 0x22, 0x33};
+    [packet appendBytes:nalu length:sizeof(nalu)];
+    for (uint8_t i = 0; i < paddingLength; i++) {
+        uint8_t byte = (i + 1 == paddingLength) ? paddingByte : 0;
+        [packet appendBytes:&byte length:1];
+    }
+    return packet;
+}
+
+#pragma mark - Round Trip
+- (void)testRoundTripInOrder {
+    NSMutableArray<NSData *> *packets = [NSMutableArray array];
+    NSArray<NSArray<NSData *> *> *frames = [self framesWithCount:10 packets:packets];
+    CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    depacketizer.delegate = self;
+    for (NSData *packet in packets) {
+        [depacketizer receivePacketData:packet];
+    }
+
+    XCTAssertEqualObjects(self.outputFrames, frames);
+    // 初始时间戳是随机的，帧间隔为3000
+    uint32_t firstTimestamp = self.outputTimestamps.firstObject.unsignedIntValue;
+    for (NSUInteger i = 0; i < self.outputTimestamps.count; i++) {
+        XCTAssertEqual(self.outputTimestamps[i].unsignedIntValue - firstTimestamp, (uint32_t)(i * 3000));
+    }
+    XCTAssertEqual(depacketizer.lostCount, 0u);
+    XCTAssertEqual(depacketizer.reorderedCount, 0u);
+}
+
+- (void)testRoundTripWithReorderingAndDuplicates {
+    NSMutableArray<NSData *> *packets = [NSMutableArray array];
+    NSArray<NSArray<NSData *> *> *frames = [self framesWithCount:10 packets:packets];
+
+    // 第一个包确定起始序列号，之后每8个包为一组倒序发送，每5个包重复一次，所有乱序都在重排窗口内
+    NSMutableArray<NSData *> *received = [NSMutableArray arrayWithObject:packets[0]];
+    for (NSUInteger group = 1; group < packets.count; group += 8) {
+        NSUInteger end = MIN(group + 8, packets.count);
+        for (NSUInteger i = end; i > group; i--) {
+            [received addObject:packets[i - 1]];
+            if ((i - 1) % 5 == 0) [received addObject:packets[i - 1]];
+        }
+    }
+    // 已经处理过的包再来一次(迟到的重传)
+    [received addObject:packets[3]];
+
+    CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    depacketizer.delegate = self;
+    depacketizer.maxReorderDelay = 10;
+    for (NSData *packet in received) {
+        [depacketizer receivePacketData:packet];
+    }
+    [depacketizer flush];
+
+    XCTAssertEqualObjects(self.outputFrames, frames);
+    XCTAssertEqual(depacketizer.lostCount, 0u);
+    XCTAssertEqual(self.lossReportCount, 0u);
+    XCTAssertGreaterThan(depacketizer.reorderedCount, 0u);
+    XCTAssertEqual(depacketizer.duplicateCount, received.count - packets.count);
+}
+
+- (void)testLostFragmentDropsOnlyThatNalu {
+    NSMutableArray<NSData *> *packets = [NSMutableArray array];
+    NSArray<NSArray<NSData *> *> *frames = [self framesWithCount:3 packets:packets];
+    // IDR的第一个片是FU-A，丢掉它的第二个分片(第一个包是sps/pps的STAP-A)
+    [packets removeObjectAtIndex:2];
+
+    CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    depacketizer.delegate = self;
+    depacketizer.reorderWindow = 2;
+    for (NSData *packet in packets) {
+        [depacketizer receivePacketData:packet];
+    }
+    [depacketizer flush];
+
+    XCTAssertEqual(depacketizer.lostCount, 1u);
+    XCTAssertEqual(self.lossReportCount, 1u);
+    XCTAssertEqual(self.outputFrames.count, frames.count);
+    // sps、pps和第二个片完整，第一个片被丢弃
+    NSArray<NSData *> *keyFrame = frames[0];
+    XCTAssertEqualObjects(self.outputFrames[0], (@[keyFrame[0], keyFrame[1], keyFrame[3]]));
+    XCTAssertEqualObjects(self.outputFrames[1], frames[1]);
+    XCTAssertEqualObjects(self.outputFrames[2], frames[2]);
+}
+
+#pragma mark - Padding
+- (void)testPaddingIsBounded {
+    CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    depacketizer.delegate = self;
+    // 填充长度为0、超过头之后的长度时整包丢弃
+    [depacketizer receivePacketData:[self paddedPacketWithSequence:0 paddingLength:1 paddingByte:0]];
+    [depacketizer receivePacketData:[self paddedPacketWithSequence:1 paddingLength:4 paddingByte:200]];
+    XCTAssertEqual(self.outputFrames.count, 0u);
+
+    // 合法的填充去掉后输出原NALU
+    [depacketizer receivePacketData:[self paddedPacketWithSequence:2 paddingLength:4 paddingByte:4]];
+    XCTAssertEqual(self.outputFrames.count, 1u);
+    static const uint8_t expected[] = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9A, 0x11, 0x22, 0x33};
+    XCTAssertEqualObjects(self.outputFrames.firstObject.firstObject, [NSData dataWithBytes:expected length:sizeof(expected)]);
+}
+
+#pragma mark - Reorder Timer
+- (void)testReorderTimeoutFlushesQuietStream {
+    NSMutableArray<NSData *> *packets = [NSMutableArray array];
+    NSArray<NSArray<NSData *> *> *frames = [self framesWithCount:2 packets:packets];
+    // 丢掉第一帧的最后一个包(marker)后流停止，只有定时器能判定丢包并输出后面缓存的包
+    NSUInteger firstFramePacketCount = 0;
+    for (NSData *packet in packets) {
+        firstFramePacketCount++;
+        if (((const uint8_t *)packet.bytes)[1] & 0x80) break;
+    }
+    [packets removeObjectAtIndex:firstFramePacketCount - 1];
+
+    CQMediaStrand *strand = [[CQMediaExecutor sharedExecutor] strandWithLane:CQMediaLaneVideo label:@"test.rtp"];
+    CQRTPDepacketizer *depacketizer = [[CQRTPDepacketizer alloc] initWithPayloadFormat:CQRTPPayloadFormatH264];
+    depacketizer.delegate = self;
+    depacketizer.maxReorderDelay = 0.02;
+    depacketizer.strand = strand;
+    self.lossExpectation = [self expectationWithDescription:@"loss"];
+    [strand async:^{
+        for (NSData *packet in packets) {
+            [depacketizer receivePacketData:packet];
+        }
+    }];
+    [self waitForExpectationsWithTimeout:2 handler:nil];
+
+    __block NSUInteger frameCount = 0;
+    __block NSUInteger lostCount = 0;
+    [strand sync:^{
+        frameCount = self.outputFrames.count;
+        lostCount = depacketizer.lostCount;
+    }];
+    XCTAssertEqual(lostCount, 1u);
+    // 第一帧不完整的部分在时间戳变化时输出，第二帧完整
+    XCTAssertEqual(frameCount, 2u);
+    XCTAssertEqualObjects(self.outputFrames.lastObject, frames[1]);
+}
+
+#pragma mark - CQRTPDepacketizerDelegate
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didOutputH264Nalus:(NSArray<NSData *> *)nalus timestamp:(uint32_t)timestamp {
+    [self.outputFrames addObject:nalus];
+    [self.outputTimestamps addObject:@(timestamp)];
+}
+
+- (void)rtpDepacketizer:(CQRTPDepacketizer *)depacketizer didLosePacketsFromSequenceNumber:(uint16_t)firstSequenceNumber count:(NSUInteger)count {
+    self.lossReportCount++;
+    [self.lossExpectation fulfill];
+}
+
+@end
@@ -0,0 +1,312 @@
+//
+//  CQRawStreamReaderTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQRawStreamReader.h"
+#import "CQADTSUtil.h"
+
+/// 18帧10fps，每6帧一个IDR，GOP内奇数帧是非参考帧；第6帧的IDR不带sps/pps
+static const NSUInteger kTestFrameCount = 18;
+static const NSUInteger kTestGOPSize = 6;
+static const NSInteger kTestFrameRate = 10;
+static const NSUInteger kTestAACFrameCount = 10;
+
+/// 记录送入的数据，不真正解码
+@interface CQTestRecordingDecoder : CQVideoDecoder
+@property (nonatomic, strong) NSMutableArray<NSData *> *h264Inputs;  ///< videoDecodeWithH264Data:的输入(sps/pps)
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *decodedFrames;  ///< videoDecodeWithAVCCData:送入的帧序号
+@end
+
+@implementation CQTestRecordingDecoder
+
+- (instancetype)initWithConfig:(CQVideoCoderConfig *)config {
+    if (self = [super initWithConfig:config]) {
+        _h264Inputs = [NSMutableArray array];
+        _decodedFrames = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)videoDecodeWithH264Data:(NSData *)h264Data {
+    [self.h264Inputs addObject:h264Data];
+}
+
+- (void)videoDecodeWithAVCCData:(NSData *)avccData {
+    // 第一个NALU: 4字节长度 + NALU头 + first_mb_in_slice所在字节 + 帧序号
+    [self.decodedFrames addObject:@(((const uint8_t *)avccData.bytes)[6])];
+}
+
+@end
+
+@interface CQRawStreamReaderTests : XCTestCase
+@property (nonatomic, copy) NSString *directory;
+@property (nonatomic, copy) NSString *h264Path;
+@property (nonatomic, copy) NSString *aacPath;
+@property (nonatomic, strong) NSMutableArray<NSValue *> *frameRanges;  ///< 生成时记录的每帧在文件中的范围
+@property (nonatomic, strong) NSMutableArray<NSData *> *aacFrames;  ///< 生成时记录的每帧AAC裸数据
+@end
+
+@implementation CQRawStreamReaderTests
+
+- (void)setUp {
+    self.directory = [NSTemporaryDirectory() stringByAppendingPathComponent:@"CQRawStreamReaderTests"];
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+    [[NSFileManager defaultManager] createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:nil];
+    self.h264Path = [self.directory stringByAppendingPathComponent:@"test.h264"];
+    self.aacPath = [self.directory stringByAppendingPathComponent:@"test.aac"];
+    self.frameRanges = [NSMutableArray array];
+    self.aacFrames = [NSMutableArray array];
+    XCTAssertTrue([[self h264Stream] writeToFile:self.h264Path atomically:YES]);
+    XCTAssertTrue([[self aacStream] writeToFile:self.aacPath atomically:YES]);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.directory error:nil];
+}
+
+#pragma mark - Private Func
+/// 追加一个NALU，isLongStartCode为NO时用3字节起始码
+static void CQTestAppendNalu(NSMutableData *stream, BOOL isLongStartCode, const uint8_t *nalu, size_t size) {
+    static const uint8_t startCode[] = {0x00, 0x00, 0x00, 0x01};
+    [stream appendBytes:isLongStartCode ? startCode : startCode + 1 length:isLongStartCode ? 4 : 3];
+    [stream appendBytes:nalu length:size];
+}
+
+/// 追加一个片: first_mb_in_slice为0时第一位为1，负载第二个字节是帧序号，不含00 00
+static void CQTestAppendSlice(NSMutableData *stream, BOOL isLongStartCode, uint8_t header, BOOL isFirstSlice, NSUInteger frameIndex) {
+    uint8_t slice[40];
+    memset(slice, 0xAA, sizeof(slice));
+    slice[0] = header;
+    slice[1] = isFirstSlice ? 0x88 : 0x40;
+    slice[2] = (uint8_t)frameIndex;
+    CQTestAppendNalu(stream, isLongStartCode, slice, sizeof(slice));
+}
+
+/**
+ 生成Annex-B码流
+ 第0、12帧前有sps/pps，第2帧有两个片，第3帧前有SEI，第4帧前有AUD，第5帧起用3字节起始码
+ */
+- (NSData *)h264Stream {
+    static const uint8_t sps[] = {0x67, 0x42, 0xC0, 0x1F, 0xAA, 0x40, 0x50};
+    static const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+    static const uint8_t sei[] = {0x06, 0x05, 0x01, 0xAA, 0x80};
+    static const uint8_t aud[] = {0x09, 0xF0};
+    NSMutableData *stream = [NSMutableData data];
+    for (NSUInteger i = 0; i < kTestFrameCount; i++) {
+        NSUInteger start = stream.length;
+        BOOL isLongStartCode = i < 5 || i % 3 == 0;
+        BOOL isKeyFrame = i % kTestGOPSize == 0;
+        if (i == 0 || i == 12) {
+            CQTestAppendNalu(stream, YES, sps, sizeof(sps));
+            CQTestAppendNalu(stream, NO, pps, sizeof(pps));
+        }
+        if (i == 3) CQTestAppendNalu(stream, YES, sei, sizeof(sei));
+        if (i == 4) CQTestAppendNalu(stream, YES, aud, sizeof(aud));
+        // 参考帧nal_ref_idc为3(IDR)或2，非参考帧为0
+        uint8_t header = isKeyFrame ? 0x65 : (i % 2 ? 0x01 : 0x41);
+        CQTestAppendSlice(stream, isLongStartCode, header, YES, i);
+        if (i == 2) CQTestAppendSlice(stream, NO, header, NO, i);
+        [self.frameRanges addObject:[NSValue valueWithRange:NSMakeRange(start, stream.length - start)]];
+    }
+    return stream;
+}
+
+/// 生成ADTS码流，第4帧后有3字节垃圾数据，末尾有一个不完整的帧
+- (NSData *)aacStream {
+    NSMutableData *stream = [NSMutableData data];
+    for (NSUInteger i = 0; i < kTestAACFrameCount; i++) {
+        NSMutableData *raw = [NSMutableData dataWithLength:20 + i * 7];
+        memset(raw.mutableBytes, (int)(0x10 + i), raw.length);
+        uint8_t header[CQADTSHeaderSize];
+        CQADTSWriteHeader(header, 44100, 2, raw.length);
+        [stream appendBytes:header length:sizeof(header)];
+        [stream appendData:raw];
+        [self.aacFrames addObject:raw];
+        if (i == 4) {
+            static const uint8_t garbage[] = {0x12, 0x34, 0x56};
+            [stream appendBytes:garbage length:sizeof(garbage)];
+        }
+    }
+    uint8_t header[CQADTSHeaderSize];
+    CQADTSWriteHeader(header, 44100, 2, 100);
+    [stream appendBytes:header length:sizeof(header)];
+    [stream appendBytes:header length:sizeof(header)];
+    return stream;
+}
+
+- (CQRawStreamReader *)h264Reader {
+    NSError *error = nil;
+    CQRawStreamReader *reader = [[CQRawStreamReader alloc] initWithPath:self.h264Path frameRate:kTestFrameRate error:&error];
+    XCTAssertNotNil(reader, @"%@", error);
+    return reader;
+}
+
+- (void)setModificationDate:(NSDate *)date path:(NSString *)path {
+    NSError *error = nil;
+    XCTAssertTrue([[NSFileManager defaultManager] setAttributes:@{NSFileModificationDate: date} ofItemAtPath:path error:&error], @"%@", error);
+}
+
+/// 两个读取器的帧表相同
+- (void)assertReader:(CQRawStreamReader *)reader matchesReader:(CQRawStreamReader *)other {
+    XCTAssertEqual(reader.frameCount, other.frameCount);
+    XCTAssertEqual(reader.keyFrameCount, other.keyFrameCount);
+    for (NSUInteger i = 0; i < MIN(reader.frameCount, other.frameCount); i++) {
+        XCTAssertEqualObjects([reader frameDataAtIndex:i], [other frameDataAtIndex:i], @"frame %lu", (unsigned long)i);
+        XCTAssertEqual([reader isKeyFrameAtIndex:i], [other isKeyFrameAtIndex:i]);
+        XCTAssertEqual([reader isReferenceFrameAtIndex:i], [other isReferenceFrameAtIndex:i]);
+    }
+}
+
+#pragma mark - Index
+- (void)testH264IndexGroupsAccessUnits {
+    CQRawStreamReader *reader = [self h264Reader];
+    XCTAssertEqual(reader.type, CQRawStreamTypeH264);
+    XCTAssertFalse(reader.isIndexLoaded);
+    XCTAssertEqual(reader.frameCount, kTestFrameCount);
+    XCTAssertEqual(reader.keyFrameCount, 3u);
+    XCTAssertEqual(CMTimeCompare(reader.duration, CMTimeMake(kTestFrameCount, (int32_t)kTestFrameRate)), 0);
+
+    // sps/pps/SEI/AUD归入后面的帧，同一帧的第二个片不开始新的帧，3字节和4字节起始码都从起始码开始
+    NSData *stream = [NSData dataWithContentsOfFile:self.h264Path];
+    for (NSUInteger i = 0; i < kTestFrameCount; i++) {
+        NSData *expected = [stream subdataWithRange:self.frameRanges[i].rangeValue];
+        XCTAssertEqualObjects([reader frameDataAtIndex:i], expected, @"frame %lu", (unsigned long)i);
+        XCTAssertEqual([reader isKeyFrameAtIndex:i], i % kTestGOPSize == 0, @"frame %lu", (unsigned long)i);
+        XCTAssertEqual([reader isReferenceFrameAtIndex:i], i % 2 == 0, @"frame %lu", (unsigned long)i);
+        XCTAssertEqual(CMTimeCompare([reader timeAtIndex:i], CMTimeMake(i, (int32_t)kTestFrameRate)), 0);
+    }
+    XCTAssertNil([reader frameDataAtIndex:kTestFrameCount]);
+    XCTAssertFalse([reader isKeyFrameAtIndex:kTestFrameCount]);
+}
+
+- (void)testAACIndexSkipsGarbageAndTruncatedFrame {
+    NSError *error = nil;
+    CQRawStreamReader *reader = [[CQRawStreamReader alloc] initWithPath:self.aacPath frameRate:0 error:&error];
+    XCTAssertNotNil(reader, @"%@", error);
+    XCTAssertEqual(reader.type, CQRawStreamTypeAAC);
+    XCTAssertEqual(reader.frameCount, kTestAACFrameCount);
+    XCTAssertEqual(reader.keyFrameCount, kTestAACFrameCount);
+    XCTAssertEqual(reader.sampleRate, 44100);
+    XCTAssertEqual(reader.channelCount, 2);
+    XCTAssertEqual(CMTimeCompare(reader.frameDuration, CMTimeMake(1024, 44100)), 0);
+    // 数据不含ADTS头，每帧都是关键帧
+    for (NSUInteger i = 0; i < kTestAACFrameCount; i++) {
+        XCTAssertEqualObjects([reader frameDataAtIndex:i], self.aacFrames[i], @"frame %lu", (unsigned long)i);
+        XCTAssertTrue([reader isKeyFrameAtIndex:i]);
+        XCTAssertTrue([reader isReferenceFrameAtIndex:i]);
+    }
+}
+
+- (void)testEmptyStreamFails {
+    NSString *path = [self.directory stringByAppendingPathComponent:@"empty.h264"];
+    static const uint8_t sps[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xC0, 0x1F};
+    XCTAssertTrue([[NSData dataWithBytes:sps length:sizeof(sps)] writeToFile:path atomically:YES]);
+    // 只有sps没有图像，没有帧
+    NSError *error = nil;
+    XCTAssertNil([[CQRawStreamReader alloc] initWithPath:path frameRate:kTestFrameRate error:&error]);
+    XCTAssertEqualObjects(error.domain, CQRawStreamReaderErrorDomain);
+}
+
+#pragma mark - Sidecar
+- (void)testSidecarIndexIsReused {
+    NSString *indexPath = [self.h264Path stringByAppendingPathExtension:@"cqidx"];
+    CQRawStreamReader *scanned = [self h264Reader];
+    XCTAssertFalse(scanned.isIndexLoaded);
+    XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:indexPath]);
+
+    CQRawStreamReader *loaded = [self h264Reader];
+    XCTAssertTrue(loaded.isIndexLoaded);
+    [self assertReader:loaded matchesReader:scanned];
+
+    // 索引文件损坏(截断)时重新扫描
+    NSData *index = [NSData dataWithContentsOfFile:indexPath];
+    XCTAssertTrue([[index subdataWithRange:NSMakeRange(0, index.length - 4)] writeToFile:indexPath atomically:YES]);
+    CQRawStreamReader *rescanned = [self h264Reader];
+    XCTAssertFalse(rescanned.isIndexLoaded);
+    [self assertReader:rescanned matchesReader:scanned];
+    XCTAssertTrue([self h264Reader].isIndexLoaded);
+}
+
+- (void)testSidecarIndexInvalidatedByModificationTime {
+    // 整秒的修改时间，纳秒部分为0，只改时间不改大小
+    [self setModificationDate:[NSDate dateWithTimeIntervalSince1970:1700000000] path:self.h264Path];
+    XCTAssertFalse([self h264Reader].isIndexLoaded);
+    XCTAssertTrue([self h264Reader].isIndexLoaded);
+    [self setModificationDate:[NSDate dateWithTimeIntervalSince1970:1700000100] path:self.h264Path];
+    XCTAssertFalse([self h264Reader].isIndexLoaded);
+    XCTAssertTrue([self h264Reader].isIndexLoaded);
+}
+
+- (void)testSidecarIndexInvalidatedBySize {
+    NSDate *date = [NSDate dateWithTimeIntervalSince1970:1700000000];
+    [self setModificationDate:date path:self.h264Path];
+    XCTAssertEqual([self h264Reader].frameCount, kTestFrameCount);
+
+    // 追加一帧后把修改时间改回去，只有大小不同
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:self.h264Path];
+    [handle seekToEndOfFile];
+    NSMutableData *frame = [NSMutableData data];
+    CQTestAppendSlice(frame, YES, 0x41, YES, kTestFrameCount);
+    [handle writeData:frame];
+    [handle closeFile];
+    [self setModificationDate:date path:self.h264Path];
+
+    CQRawStreamReader *reader = [self h264Reader];
+    XCTAssertFalse(reader.isIndexLoaded);
+    XCTAssertEqual(reader.frameCount, kTestFrameCount + 1);
+    XCTAssertEqualObjects([reader frameDataAtIndex:kTestFrameCount], frame);
+}
+
+#pragma mark - Seek
+- (void)testKeyFrameBinarySearch {
+    CQRawStreamReader *reader = [self h264Reader];
+    for (NSUInteger i = 0; i < kTestFrameCount; i++) {
+        XCTAssertEqual([reader keyFrameIndexAtOrBeforeIndex:i], i / kTestGOPSize * kTestGOPSize, @"frame %lu", (unsigned long)i);
+    }
+    XCTAssertEqual([reader keyFrameIndexAtOrBeforeIndex:1000], 12u);
+    // 时间落在帧内按所在帧算，超出范围夹到首尾
+    XCTAssertEqual([reader frameIndexAtTime:CMTimeMake(95, 100)], 9u);
+    XCTAssertEqual([reader frameIndexAtTime:CMTimeMake(-1, 10)], 0u);
+    XCTAssertEqual([reader frameIndexAtTime:CMTimeMake(100, 1)], kTestFrameCount - 1);
+    XCTAssertEqual([reader frameIndexAtTime:kCMTimeInvalid], 0u);
+}
+
+- (void)testSeekFeedsFromPreviousKeyFrame {
+    CQTestRecordingDecoder *decoder = [[CQTestRecordingDecoder alloc] initWithConfig:[CQVideoCoderConfig defaultConifg]];
+    CQRawStreamReader *reader = [self h264Reader];
+    // 第9帧: 从第6帧的IDR开始，IDR没有sps/pps，先送第0帧的
+    XCTAssertEqual([reader seekToTime:CMTimeMake(9, (int32_t)kTestFrameRate) videoDecoder:decoder skipNonReferenceFrames:NO], 9u);
+    XCTAssertEqual(decoder.h264Inputs.count, 2u);
+    XCTAssertEqual(((const uint8_t *)decoder.h264Inputs[0].bytes)[4], 0x67);
+    XCTAssertEqual(((const uint8_t *)decoder.h264Inputs[1].bytes)[4], 0x68);
+    XCTAssertEqualObjects(decoder.decodedFrames, (@[@6, @7, @8, @9]));
+
+    // IDR自带sps/pps时不再往前找
+    decoder = [[CQTestRecordingDecoder alloc] initWithConfig:[CQVideoCoderConfig defaultConifg]];
+    XCTAssertEqual([reader seekToTime:CMTimeMake(14, (int32_t)kTestFrameRate) videoDecoder:decoder skipNonReferenceFrames:NO], 14u);
+    XCTAssertEqual(decoder.h264Inputs.count, 2u);
+    XCTAssertEqualObjects(decoder.decodedFrames, (@[@12, @13, @14]));
+}
+
+- (void)testSkipNonReferenceFrames {
+    CQRawStreamReader *reader = [self h264Reader];
+    // 跳转时跳过IDR和目标帧之间的非参考帧，目标帧本身是非参考帧也要送
+    CQTestRecordingDecoder *decoder = [[CQTestRecordingDecoder alloc] initWithConfig:[CQVideoCoderConfig defaultConifg]];
+    XCTAssertEqual([reader seekToTime:CMTimeMake(11, (int32_t)kTestFrameRate) videoDecoder:decoder skipNonReferenceFrames:YES], 11u);
+    XCTAssertEqualObjects(decoder.decodedFrames, (@[@6, @8, @10, @11]));
+
+    // 顺序播放跳过非参考帧，帧率减半
+    NSMutableArray<NSNumber *> *played = [NSMutableArray array];
+    for (NSUInteger i = 0; i < reader.frameCount; i = [reader nextFrameIndexAfterIndex:i skipNonReferenceFrames:YES]) {
+        [played addObject:@(i)];
+    }
+    XCTAssertEqualObjects(played, (@[@0, @2, @4, @6, @8, @10, @12, @14, @16]));
+    XCTAssertEqual([reader nextFrameIndexAfterIndex:16 skipNonReferenceFrames:YES], kTestFrameCount);
+    XCTAssertEqual([reader nextFrameIndexAfterIndex:0 skipNonReferenceFrames:NO], 1u);
+}
+
+@end
@@ -0,0 +1,224 @@
+//
+//  CQReferenceTrackerTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQReferenceTracker.h"
+#import "CQTestSupport.h"
+
+#define kTestMaxNaluSize 64
+
+/// 640x360、POC类型2的SPS参数
+static CQTestSPSConfig CQTestTrackerSPSConfig(uint8_t profileIdc, uint8_t log2MaxFrameNum, BOOL gapsInFrameNumAllowedFlag) {
+    CQTestSPSConfig config = CQTestSPSConfigMake(profileIdc);
+    config.log2MaxFrameNum = log2MaxFrameNum;
+    config.gapsInFrameNumAllowedFlag = gapsInFrameNumAllowedFlag;
+    return config;
+}
+
+/// 生成片，片头只写到frame_num
+static size_t CQTestH264Slice(uint8_t nalHeader, uint32_t frameNum, uint8_t log2MaxFrameNum, uint8_t *output) {
+    uint8_t rbsp[kTestMaxNaluSize] = {0};
+    CQBitWriter writer = CQBitWriterMake(rbsp, sizeof(rbsp));
+    CQBitWriterWriteUE(&writer, 0);  // first_mb_in_slice
+    CQBitWriterWriteUE(&writer, (nalHeader & 0x1F) == CQH264NaluTypeIDR ? 7 : 5);  // slice_type
+    CQBitWriterWriteUE(&writer, 0);  // pic_parameter_set_id
+    CQBitWriterWriteBits(&writer, frameNum, log2MaxFrameNum);
+    CQBitWriterWriteBits(&writer, 0, 16);
+    return CQTestFinishNalu(&writer, &nalHeader, 1, output);
+}
+
+static void CQTestTrackerSetSPS(CQReferenceTracker *tracker, CQTestSPSConfig config) {
+    uint8_t sps[kTestMaxSPSSize];
+    size_t size = CQTestH264SPS(config, sps);
+    CQReferenceTrackerOnParameterSet(tracker, sps, size);
+}
+
+/// 送入一帧，返回是否应该解码
+static BOOL CQTestTrackerOnFrame(CQReferenceTracker *tracker, CQFrameClass frameClass, uint32_t frameNum, BOOL skipsCorrupted) {
+    static const uint8_t kNalHeaders[] = {0x01, 0x01, 0x41, 0x65};
+    uint8_t nalHeader = kNalHeaders[frameClass];
+    uint8_t slice[kTestMaxNaluSize];
+    size_t size = CQTestH264Slice(nalHeader, frameNum, tracker->sps.log2MaxFrameNum, slice);
+    CQFrameInfo info = {frameClass, CQH264NalRefIdcOf(&nalHeader), frameClass == CQFrameClassIDR ? CQH264SliceTypeI : CQH264SliceTypeP,
+        frameClass == CQFrameClassNonReference ? 1 : 0, 1};
+    return CQReferenceTrackerOnFrame(tracker, info, slice, size, skipsCorrupted);
+}
+
+@interface CQReferenceTrackerTests : XCTestCase
+
+@end
+
+@implementation CQReferenceTrackerTests
+
+#pragma mark - Parameter Sets
+- (void)testSPSAndFrameNumParse {
+    for (uint8_t log2MaxFrameNum = 4; log2MaxFrameNum <= 16; log2MaxFrameNum++) {
+        CQTestSPSConfig config = CQTestTrackerSPSConfig(log2MaxFrameNum % 2 ? 100 : 66, log2MaxFrameNum, NO);
+        uint8_t sps[kTestMaxSPSSize];
+        size_t size = CQTestH264SPS(config, sps);
+        CQH264SPSInfo info;
+        XCTAssertTrue(CQH264SPSParse(sps, size, &info));
+        XCTAssertEqual(info.profileIdc, config.profileIdc);
+        XCTAssertEqual(info.levelIdc, 31);
+        XCTAssertEqual(info.log2MaxFrameNum, log2MaxFrameNum);
+        XCTAssertEqual(info.chromaFormatIdc, 1u);
+        XCTAssertEqual(info.picOrderCntType, 2u);
+        XCTAssertEqual(info.maxNumRefFrames, 1u);
+        XCTAssertEqual(info.width, 640u);
+        XCTAssertEqual(info.height, 360u);
+        XCTAssertFalse(info.vuiParametersPresentFlag);
+
+        // frame_num取最大值时每一位都是1
+        uint32_t maxFrameNum = (1u << log2MaxFrameNum) - 1;
+        uint8_t slice[kTestMaxNaluSize];
+        size = CQTestH264Slice(0x41, maxFrameNum, log2MaxFrameNum, slice);
+        uint32_t frameNum = 0;
+        XCTAssertTrue(CQH264SliceFrameNumParse(slice, size, &info, &frameNum));
+        XCTAssertEqual(frameNum, maxFrameNum);
+        XCTAssertFalse(CQH264SliceFrameNumParse(slice, 2, &info, &frameNum));
+    }
+    // 不是SPS
+    const uint8_t pps[] = {0x68, 0xCE, 0x3C, 0x80};
+    CQH264SPSInfo info;
+    XCTAssertFalse(CQH264SPSParse(pps, sizeof(pps), &info));
+}
+
+#pragma mark - Frame Num
+- (void)testStartsInvalidUntilFirstIDR {
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecH264);
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 4, NO));
+    // 从GOP中间开始接收，IDR之前的帧都跳过
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 5, YES));
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassNonReference, 6, YES));
+    XCTAssertTrue(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 0));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 1, YES));
+    XCTAssertFalse(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 1000000));
+    XCTAssertEqual(tracker.stats.skippedFrameCount, 2u);
+    // 第一个IDR不算恢复
+    XCTAssertEqual(tracker.stats.recoveryCount, 0u);
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 0u);
+}
+
+- (void)testLostReferenceFrameSkipsUntilIDR {
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecH264);
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 4, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 1, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 2, YES));
+    // 丢了frame_num为3的参考帧，之后的参考帧和非参考帧都跳过
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 4, YES));
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassNonReference, 5, YES));
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 5, YES));
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 1u);
+    XCTAssertEqual(tracker.stats.skippedFrameCount, 3u);
+
+    // 失效后立即请求关键帧，之后按最小间隔重复
+    XCTAssertTrue(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 1000000));
+    XCTAssertFalse(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 1499999));
+    XCTAssertTrue(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 1500000));
+    XCTAssertEqual(tracker.stats.keyFrameRequestCount, 2u);
+
+    // IDR恢复，之后frame_num从IDR重新开始
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, YES));
+    XCTAssertFalse(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 2000000));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 1, YES));
+    XCTAssertEqual(tracker.stats.recoveryCount, 1u);
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 1u);
+}
+
+- (void)testLostNonReferenceFramesAreNotGaps {
+    // 分层P: 非参考帧的frame_num等于前一个参考帧 + 1，和下一个参考帧相同
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecH264);
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(100, 4, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, YES));
+    uint32_t frameNum = 0;
+    for (int i = 1; i < 60; i++) {
+        if (i % 2) {
+            // 非参考帧一半收到一半丢失
+            if (i % 4 == 1) XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassNonReference, (frameNum + 1) % 16, YES));
+        } else {
+            // frame_num按16回绕
+            frameNum = (frameNum + 1) % 16;
+            XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, frameNum, YES), @"frame %d", i);
+        }
+    }
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 0u);
+    XCTAssertEqual(tracker.stats.skippedFrameCount, 0u);
+    XCTAssertFalse(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 0));
+}
+
+- (void)testDecodeAllCountsCorruptedFrames {
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecH264);
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 5, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 1, NO));
+    // 不跳过时照常解码，frame_num继续更新，后面的帧不会再算一次不连续
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 3, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 4, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassNonReference, 5, NO));
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 1u);
+    XCTAssertEqual(tracker.stats.corruptedFrameCount, 3u);
+    XCTAssertEqual(tracker.stats.skippedFrameCount, 0u);
+}
+
+- (void)testGapsAllowedAndSPSChange {
+    // gaps_in_frame_num_value_allowed_flag为1时不检查连续性
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecH264);
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 4, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassIDR, 0, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 5, YES));
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 0u);
+
+    // frame_num位数变化后不和之前的frame_num比较
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 4, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 6, YES));
+    CQTestTrackerSetSPS(&tracker, CQTestTrackerSPSConfig(66, 8, NO));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 200, YES));
+    XCTAssertTrue(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 201, YES));
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 0u);
+    XCTAssertFalse(CQTestTrackerOnFrame(&tracker, CQFrameClassReference, 203, YES));
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 1u);
+}
+
+#pragma mark - Loss Report
+- (void)testDataLossAndDecodeError {
+    // HEVC没有frame_num，只靠上报的丢失和解码错误
+    CQReferenceTracker tracker = CQReferenceTrackerMake(CQVideoCodecHEVC);
+    CQFrameInfo idr = {CQFrameClassIDR, 1, CQH264SliceTypeI, 0, 1};
+    CQFrameInfo reference = {CQFrameClassReference, 1, CQH264SliceTypeP, 0, 1};
+    CQFrameInfo nonReference = {CQFrameClassNonReference, 0, CQH264SliceTypeP, 1, 1};
+    const uint8_t slice[] = {0x02, 0x01, 0xD0};
+    XCTAssertTrue(CQReferenceTrackerOnFrame(&tracker, idr, slice, sizeof(slice), YES));
+    XCTAssertTrue(CQReferenceTrackerOnFrame(&tracker, reference, slice, sizeof(slice), YES));
+
+    // 非参考帧解码出错不影响后面的帧
+    CQReferenceTrackerOnDecodeError(&tracker, NO);
+    XCTAssertTrue(CQReferenceTrackerOnFrame(&tracker, reference, slice, sizeof(slice), YES));
+    XCTAssertFalse(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 0));
+
+    // 参考帧解码出错
+    CQReferenceTrackerOnDecodeError(&tracker, YES);
+    XCTAssertFalse(CQReferenceTrackerOnFrame(&tracker, nonReference, slice, sizeof(slice), YES));
+    XCTAssertTrue(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 0));
+    XCTAssertTrue(CQReferenceTrackerOnFrame(&tracker, idr, slice, sizeof(slice), YES));
+
+    // 数据丢失，恢复后可以立即再次请求关键帧
+    CQReferenceTrackerOnDataLoss(&tracker);
+    XCTAssertFalse(CQReferenceTrackerOnFrame(&tracker, reference, slice, sizeof(slice), YES));
+    XCTAssertTrue(CQReferenceTrackerShouldRequestKeyFrame(&tracker, 100));
+    XCTAssertTrue(CQReferenceTrackerOnFrame(&tracker, idr, slice, sizeof(slice), YES));
+
+    XCTAssertEqual(tracker.stats.decodeErrorCount, 2u);
+    XCTAssertEqual(tracker.stats.dataLossCount, 1u);
+    XCTAssertEqual(tracker.stats.skippedFrameCount, 2u);
+    XCTAssertEqual(tracker.stats.recoveryCount, 2u);
+    XCTAssertEqual(tracker.stats.keyFrameRequestCount, 2u);
+    XCTAssertEqual(tracker.stats.frameNumGapCount, 0u);
+}
+
+@end
@@ -0,0 +1,236 @@
+//
+//  CQReplayBufferTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQReplayBuffer.h"
+#import "CQNaluUtil.h"
+
+static const uint16_t kTestVideoPid = 0x0100;
+static const NSInteger kTestGOPLength = 30;  ///< 30fps，每秒一个IDR
+
+/// Annex-B的一帧: 帧序号写在NALU头后面的两个字节里(最高位为1，不会出现起始码)，其余填0xAA
+static NSData *CQTestFrame(NSInteger index, size_t size, BOOL isKeyFrame) {
+    NSMutableData *data = [NSMutableData dataWithLength:MAX(size, 7)];
+    uint8_t *bytes = data.mutableBytes;
+    memset(bytes, 0xAA, data.length);
+    bytes[0] = bytes[1] = bytes[2] = 0x00;
+    bytes[3] = 0x01;
+    bytes[4] = isKeyFrame ? 0x65 : 0x41;
+    bytes[5] = 0x80 | ((index >> 7) & 0x7F);
+    bytes[6] = 0x80 | (index & 0x7F);
+    return data;
+}
+
+static NSData *CQTestSPS(void) {
+    static const uint8_t sps[] = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xC0, 0x1E, 0xAA};
+    return [NSData dataWithBytes:sps length:sizeof(sps)];
+}
+
+static NSData *CQTestPPS(void) {
+    static const uint8_t pps[] = {0x00, 0x00, 0x00, 0x01, 0x68, 0xCE, 0x3C, 0x80};
+    return [NSData dataWithBytes:pps length:sizeof(pps)];
+}
+
+/// 取出TS里视频PID的ES(去掉TS头、适配域和PES头)
+static NSData *CQTestVideoES(NSData *ts) {
+    NSMutableData *es = [NSMutableData data];
+    const uint8_t *bytes = ts.bytes;
+    for (NSUInteger offset = 0; offset + 188 <= ts.length; offset += 188) {
+        const uint8_t *packet = bytes + offset;
+        uint16_t pid = (uint16_t)(((packet[1] & 0x1F) << 8) | packet[2]);
+        uint8_t adaptationControl = (packet[3] >> 4) & 0x03;
+        if (packet[0] != 0x47 || pid != kTestVideoPid || !(adaptationControl & 0x01)) continue;
+        size_t payloadOffset = 4 + ((adaptationControl & 0x02) ? 1 + packet[4] : 0);
+        // PES头: 起始码(3) stream_id(1) 长度(2) 标志(2) 头长度(1) + 头数据
+        if (packet[1] & 0x40) payloadOffset += 9 + packet[payloadOffset + 8];
+        if (payloadOffset < 188) [es appendBytes:packet + payloadOffset length:188 - payloadOffset];
+    }
+    return es;
+}
+
+@interface CQReplayBufferTests : XCTestCase
+@property (nonatomic, copy) NSString *path;
+@end
+
+@implementation CQReplayBufferTests
+
+- (void)setUp {
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"CQReplayBufferTests.ts"];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+}
+
+#pragma mark - Private Func
+- (CQReplayBuffer *)bufferWithMaxBytes:(NSUInteger)maxBytes maxDuration:(NSTimeInterval)maxDuration hasAudio:(BOOL)hasAudio {
+    CQVideoCoderConfig *videoConfig = [CQVideoCoderConfig defaultConifg];
+    videoConfig.fps = 30;
+    CQReplayBuffer *buffer = [[CQReplayBuffer alloc] initWithMaxBytes:maxBytes maxDuration:maxDuration videoConfig:videoConfig audioConfig:hasAudio ? [CQAudioCoderConfig defaultConifg] : nil];
+    [buffer setSps:CQTestSPS() pps:CQTestPPS()];
+    return buffer;
+}
+
+- (void)appendFrame:(NSInteger)index size:(size_t)size toBuffer:(CQReplayBuffer *)buffer {
+    CMTime pts = CMTimeMake(index, 30);
+    [buffer appendVideoNalus:@[CQTestFrame(index, size, index % kTestGOPLength == 0)] pts:pts dts:pts isKeyFrame:index % kTestGOPLength == 0];
+}
+
+/**
+ 保存成TS，检查第一帧视频
+ @return 第一帧是带sps/pps的IDR时返回它的帧序号，否则返回-1
+ */
+- (NSInteger)firstFrameIndexOfSavedBuffer:(CQReplayBuffer *)buffer {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"save"];
+    __block NSError *saveError = nil;
+    [buffer saveToPath:self.path format:CQReplayFileFormatTS completionHandler:^(NSError *error) {
+        saveError = error;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    XCTAssertNil(saveError);
+    NSData *es = CQTestVideoES([NSData dataWithContentsOfFile:self.path]);
+    __block BOOL hasSps = NO, hasPps = NO;
+    __block NSInteger index = -1;
+    CQNaluEnumerateAnnexB(es.bytes, es.length, ^(const uint8_t *nalu, size_t naluSize, BOOL *stop) {
+        CQH264NaluType type = CQH264NaluTypeOf(nalu);
+        if (type == CQH264NaluTypeSPS) hasSps = YES;
+        if (type == CQH264NaluTypePPS) hasPps = YES;
+        if (type != CQH264NaluTypeIDR && type != CQH264NaluTypeSlice) return;
+        if (type == CQH264NaluTypeIDR && hasSps && hasPps && naluSize >= 3) {
+            index = ((nalu[1] & 0x7F) << 7) | (nalu[2] & 0x7F);
+        }
+        *stop = YES;
+    });
+    return index;
+}
+
+#pragma mark - 字节上限
+- (void)testUsedBytesNeverExceedsMaxBytes {
+    // 视频和音频交错写入，帧大小随机，缓冲区只够四个GOP左右，反复绕回开头
+    static const NSUInteger kMaxBytes = 256 * 1024;
+    CQReplayBuffer *buffer = [self bufferWithMaxBytes:kMaxBytes maxDuration:100 hasAudio:YES];
+    uint32_t seed = 1;
+    NSInteger audioIndex = 0;
+    NSUInteger maxUsedBytes = 0, appendedCount = 0;
+    NSInteger lastIndex = 0;
+    for (NSInteger index = 0; index < 20 * kTestGOPLength; index++) {
+        seed = seed * 1664525 + 1013904223;
+        size_t size = index % kTestGOPLength == 0 ? 6000 : 500 + (seed >> 8) % 2000;
+        [self appendFrame:index size:size toBuffer:buffer];
+        maxUsedBytes = MAX(maxUsedBytes, buffer.usedBytes);
+        appendedCount++;
+        // AAC每帧1024个采样，补上这一帧视频之前的音频
+        while (CMTimeCompare(CMTimeMake(audioIndex * 1024, 44100), CMTimeMake(index, 30)) <= 0) {
+            [buffer appendAudioData:[NSMutableData dataWithLength:200 + (seed >> 20) % 200] pts:CMTimeMake(audioIndex * 1024, 44100)];
+            maxUsedBytes = MAX(maxUsedBytes, buffer.usedBytes);
+            appendedCount++;
+            audioIndex++;
+        }
+        lastIndex = index;
+
+        // 淘汰之后缓存总是从带sps/pps的IDR开始
+        if (index % 97 == 96) {
+            NSInteger firstIndex = [self firstFrameIndexOfSavedBuffer:buffer];
+            XCTAssertGreaterThanOrEqual(firstIndex, 0, @"index %ld", (long)index);
+            XCTAssertEqual(firstIndex % kTestGOPLength, 0);
+        }
+    }
+    XCTAssertLessThanOrEqual(maxUsedBytes, kMaxBytes);
+    XCTAssertGreaterThan(maxUsedBytes, kMaxBytes / 2);
+    XCTAssertLessThan(buffer.packetCount, appendedCount);
+    NSInteger firstIndex = [self firstFrameIndexOfSavedBuffer:buffer];
+    XCTAssertGreaterThan(firstIndex, 0);
+    XCTAssertLessThanOrEqual(firstIndex, lastIndex);
+}
+
+- (void)testOversizedFrameIsDropped {
+    CQReplayBuffer *buffer = [self bufferWithMaxBytes:10000 maxDuration:100 hasAudio:YES];
+    // 第一帧不是IDR，缓存为空时只接收IDR
+    [self appendFrame:1 size:500 toBuffer:buffer];
+    [buffer appendAudioData:[NSMutableData dataWithLength:100] pts:kCMTimeZero];
+    XCTAssertEqual(buffer.packetCount, 0u);
+    XCTAssertEqual(buffer.droppedCount, 2u);
+
+    // IDR拼上sps/pps
+    [self appendFrame:0 size:2000 toBuffer:buffer];
+    XCTAssertEqual(buffer.packetCount, 1u);
+    XCTAssertEqual(buffer.usedBytes, 2000 + CQTestSPS().length + CQTestPPS().length);
+    [self appendFrame:1 size:1000 toBuffer:buffer];
+    [self appendFrame:2 size:1000 toBuffer:buffer];
+    XCTAssertEqual(buffer.packetCount, 3u);
+
+    // 超过缓冲区的音频只丢自己
+    [buffer appendAudioData:[NSMutableData dataWithLength:20000] pts:CMTimeMake(1, 30)];
+    XCTAssertEqual(buffer.droppedCount, 3u);
+    XCTAssertEqual(buffer.packetCount, 3u);
+
+    // 超过缓冲区的视频帧: 这个GOP不完整了，清空后等下一个IDR
+    [self appendFrame:3 size:20000 toBuffer:buffer];
+    XCTAssertEqual(buffer.droppedCount, 4u);
+    XCTAssertEqual(buffer.packetCount, 0u);
+    XCTAssertEqual(buffer.usedBytes, 0u);
+    [self appendFrame:4 size:1000 toBuffer:buffer];
+    XCTAssertEqual(buffer.droppedCount, 5u);
+    XCTAssertEqual(buffer.packetCount, 0u);
+    [self appendFrame:kTestGOPLength size:1000 toBuffer:buffer];
+    XCTAssertEqual(buffer.droppedCount, 5u);
+    XCTAssertEqual(buffer.packetCount, 1u);
+    XCTAssertEqual([self firstFrameIndexOfSavedBuffer:buffer], kTestGOPLength);
+}
+
+#pragma mark - 时长
+- (void)testMaxDurationTrimsWholeGOPs {
+    // 10秒的视频，最多缓存2秒: 缓存的时长在1秒(减一个GOP)到2秒之间
+    CQReplayBuffer *buffer = [self bufferWithMaxBytes:4 * 1024 * 1024 maxDuration:2 hasAudio:NO];
+    for (NSInteger index = 0; index < 10 * kTestGOPLength; index++) {
+        [self appendFrame:index size:200 toBuffer:buffer];
+        if (index >= 2 * kTestGOPLength) {
+            XCTAssertLessThanOrEqual(buffer.bufferedDuration, 2.0);
+            XCTAssertGreaterThanOrEqual(buffer.bufferedDuration, 1.0 - 1e-6);
+        }
+    }
+    NSInteger firstIndex = [self firstFrameIndexOfSavedBuffer:buffer];
+    XCTAssertEqual(firstIndex % kTestGOPLength, 0);
+    XCTAssertGreaterThanOrEqual(firstIndex, 7 * kTestGOPLength);
+}
+
+- (void)testMaxDurationKeepsAtLeastOneGOP {
+    // GOP(1秒)比maxDuration(0.5秒)长: 只有一个GOP时不淘汰，下一个IDR到来时淘汰旧GOP
+    CQReplayBuffer *buffer = [self bufferWithMaxBytes:4 * 1024 * 1024 maxDuration:0.5 hasAudio:NO];
+    for (NSInteger index = 0; index < kTestGOPLength; index++) {
+        [self appendFrame:index size:200 toBuffer:buffer];
+    }
+    XCTAssertEqual(buffer.packetCount, (NSUInteger)kTestGOPLength);
+    XCTAssertGreaterThan(buffer.bufferedDuration, 0.5);
+    [self appendFrame:kTestGOPLength size:200 toBuffer:buffer];
+    XCTAssertEqual(buffer.packetCount, 1u);
+    XCTAssertEqual(buffer.bufferedDuration, 0.0);
+    XCTAssertEqual(buffer.droppedCount, 0u);
+}
+
+#pragma mark - 帧表
+- (void)testPacketTableFullEvictsGOPs {
+    // 只有视频、30fps、maxDuration为1秒时帧表有1 x 60 + 64 = 124项；
+    // 时间戳间隔1ms，500帧也不超过maxDuration，空间足够，只会因为帧表满淘汰
+    static const NSUInteger kPacketCapacity = 124;
+    CQReplayBuffer *buffer = [self bufferWithMaxBytes:4 * 1024 * 1024 maxDuration:1 hasAudio:NO];
+    for (NSInteger index = 0; index < 500; index++) {
+        CMTime pts = CMTimeMake(index, 1000);
+        BOOL isKeyFrame = index % 10 == 0;
+        [buffer appendVideoNalus:@[CQTestFrame(index, 100, isKeyFrame)] pts:pts dts:pts isKeyFrame:isKeyFrame];
+        XCTAssertLessThanOrEqual(buffer.packetCount, kPacketCapacity);
+    }
+    // 帧表满时淘汰最旧的一个GOP(10帧)
+    XCTAssertGreaterThan(buffer.packetCount, kPacketCapacity - 10);
+    XCTAssertEqual(buffer.droppedCount, 0u);
+    NSInteger firstIndex = [self firstFrameIndexOfSavedBuffer:buffer];
+    XCTAssertEqual(firstIndex % 10, 0);
+    XCTAssertEqual(firstIndex, 500 - (NSInteger)buffer.packetCount);
+}
+
+@end
@@ -0,0 +1,274 @@
+//
+//  CQStreamFanoutTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQStreamFanout.h"
+#import <sys/socket.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+#define kTestTagLength 1000
+#define kTestMaxTags 64
+#define kTestFillerByte 0xFF
+
+/// 客户端回调记录
+typedef struct {
+    size_t wantsWriteCount;
+    size_t drainedCount;
+    int drainedFd;
+    size_t closedCount;
+    int closedFd;
+} CQTestFanoutEvents;
+
+/// 对端收到的tag序列，每个tag的字节都是它的编号
+typedef struct {
+    uint8_t ids[kTestMaxTags];
+    size_t lengths[kTestMaxTags];
+    size_t count;
+} CQTestReceivedTags;
+
+static void CQTestFanoutDidEvent(void *context, int fd, void *clientContext, CQFanoutClientEvent event) {
+    CQTestFanoutEvents *events = context;
+    if (event == CQFanoutClientEventWantsWrite) events->wantsWriteCount++;
+    if (event == CQFanoutClientEventDrained) {
+        events->drainedCount++;
+        events->drainedFd = fd;
+    }
+    if (event == CQFanoutClientEventClosed) {
+        events->closedCount++;
+        events->closedFd = fd;
+    }
+}
+
+static void CQTestFanoutFree(void *context) {
+    free(context);
+}
+
+/// 创建一个内容全为id的tag
+static CQFanoutBuffer *CQTestFanoutTag(uint8_t id, size_t length) {
+    uint8_t *bytes = malloc(length);
+    memset(bytes, id, length);
+    return CQFanoutBufferCreate(bytes, length, bytes, CQTestFanoutFree);
+}
+
+static void CQTestPublish(CQStreamFanout *fanout, uint8_t id, CQFanoutTagKind kind, uint64_t nowUs) {
+    CQFanoutBuffer *buffer = CQTestFanoutTag(id, kTestTagLength);
+    CQStreamFanoutPublish(fanout, buffer, kind, nowUs);
+    CQFanoutBufferRelease(buffer);
+}
+
+/// 非阻塞的本地流socket，fds[0]给分发器写，fds[1]模拟对端读
+static void CQTestSocketPair(int fds[2]) {
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    int bufferSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    }
+}
+
+/// 写满内核缓冲，模拟不读数据的慢客户端
+static void CQTestFillSocket(int fd) {
+    uint8_t filler[512];
+    memset(filler, kTestFillerByte, sizeof(filler));
+    while (write(fd, filler, sizeof(filler)) > 0) {
+    }
+}
+
+/// 读出对端当前能读到的所有数据，跳过填充字节，按编号切分tag
+static void CQTestReadTags(int fd, CQTestReceivedTags *tags) {
+    uint8_t buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < length; i++) {
+            if (buffer[i] == kTestFillerByte) continue;
+            if (tags->count == 0 || tags->ids[tags->count - 1] != buffer[i]) {
+                if (tags->count == kTestMaxTags) return;
+                tags->ids[tags->count] = buffer[i];
+                tags->lengths[tags->count] = 0;
+                tags->count++;
+            }
+            tags->lengths[tags->count - 1]++;
+        }
+    }
+}
+
+/// 对端一边读一边通知可写，直到客户端队列写完
+static void CQTestDrainClient(CQStreamFanout *fanout, CQFanoutClient *client, int peerFd, uint64_t nowUs, CQTestReceivedTags *tags) {
+    for (int i = 0; i < 10000 && CQFanoutClientQueuedBytes(client) > 0; i++) {
+        CQTestReadTags(peerFd, tags);
+        CQStreamFanoutClientWritable(fanout, client, nowUs);
+    }
+    CQTestReadTags(peerFd, tags);
+}
+
+/// 收到的tag编号依次为ids，且每个tag都完整
+static BOOL CQTestTagsEqual(const CQTestReceivedTags *tags, const uint8_t *ids, size_t count) {
+    if (tags->count != count) return NO;
+    for (size_t i = 0; i < count; i++) {
+        if (tags->ids[i] != ids[i] || tags->lengths[i] != kTestTagLength) return NO;
+    }
+    return YES;
+}
+
+@interface CQStreamFanoutTests : XCTestCase
+
+@end
+
+@implementation CQStreamFanoutTests
+
+#pragma mark - Slow Consumer
+- (void)testSlowConsumerDropsNonReferenceThenSkipsToKeyFrame {
+    CQTestFanoutEvents events = {0};
+    CQStreamFanoutConfig config = CQStreamFanoutDefaultConfig();
+    config.maxQueuedBytes = 10 * kTestTagLength;
+    config.maxStallUs = 60000000;
+    CQStreamFanout *fanout = CQStreamFanoutCreate(config, CQTestFanoutDidEvent, &events);
+    CQFanoutBuffer *header = CQTestFanoutTag(1, kTestTagLength);
+    CQStreamFanoutSetHeader(fanout, &header, 1);
+    CQFanoutBufferRelease(header);
+
+    // 慢客户端的内核缓冲一开始就是满的，快客户端每发布一次都读完
+    int slowFds[2], fastFds[2];
+    CQTestSocketPair(slowFds);
+    CQTestSocketPair(fastFds);
+    CQTestFillSocket(slowFds[0]);
+    CQFanoutClient *slow = CQStreamFanoutAddClient(fanout, slowFds[0], NULL, 0);
+    CQFanoutClient *fast = CQStreamFanoutAddClient(fanout, fastFds[0], NULL, 0);
+    XCTAssertEqual(events.wantsWriteCount, 2u);
+    CQTestReceivedTags fastTags = {0};
+
+    // 关键帧10之后参考帧和非参考帧交替: 11 P, 12 D, 13 P, 14 D ...
+    CQTestPublish(fanout, 10, CQFanoutTagKindKeyFrame, 0);
+    CQTestDrainClient(fanout, fast, fastFds[1], 0, &fastTags);
+    size_t firstSkipIndex = 0;
+    for (uint8_t id = 11; id <= 28; id++) {
+        CQTestPublish(fanout, id, id % 2 ? CQFanoutTagKindFrame : CQFanoutTagKindDroppable, id * 1000);
+        CQTestDrainClient(fanout, fast, fastFds[1], id * 1000, &fastTags);
+        CQStreamFanoutStats stats = CQStreamFanoutGetStats(fanout);
+        XCTAssertLessThanOrEqual(CQFanoutClientQueuedBytes(slow), config.maxQueuedBytes);
+        if (stats.skippedGOPCount > 0 && firstSkipIndex == 0) {
+            firstSkipIndex = id;
+            // 跳GOP之前已经先丢过非参考帧
+            XCTAssertGreaterThan(stats.droppedNonReferenceCount, 0u);
+        }
+    }
+    // 积压超过一半(5个tag)后非参考帧12、14、16...都丢掉，参考帧到10个tag后从27开始等关键帧
+    CQStreamFanoutStats stats = CQStreamFanoutGetStats(fanout);
+    XCTAssertEqual(firstSkipIndex, 27u);
+    XCTAssertEqual(stats.skippedGOPCount, 1u);
+    XCTAssertEqual(stats.droppedNonReferenceCount, 8u);
+    XCTAssertEqual(stats.droppedTagCount, 10u);
+
+    // 关键帧30到来时丢掉排队的旧GOP，只保留头部
+    CQTestPublish(fanout, 30, CQFanoutTagKindKeyFrame, 30000);
+    CQTestDrainClient(fanout, fast, fastFds[1], 30000, &fastTags);
+    XCTAssertEqual(CQFanoutClientQueuedBytes(slow), 2u * kTestTagLength);
+    stats = CQStreamFanoutGetStats(fanout);
+    XCTAssertEqual(stats.skippedGOPCount, 1u);
+    XCTAssertEqual(stats.droppedTagCount, 10u + 9);
+
+    // 慢客户端恢复读取后从头部和关键帧继续，之后的帧直接写出
+    CQTestReceivedTags slowTags = {0};
+    CQTestDrainClient(fanout, slow, slowFds[1], 31000, &slowTags);
+    XCTAssertEqual(events.drainedFd, slowFds[0]);
+    CQTestPublish(fanout, 31, CQFanoutTagKindDroppable, 32000);
+    CQTestReadTags(slowFds[1], &slowTags);
+    CQTestDrainClient(fanout, fast, fastFds[1], 32000, &fastTags);
+    const uint8_t expectedSlow[] = {1, 30, 31};
+    XCTAssertTrue(CQTestTagsEqual(&slowTags, expectedSlow, sizeof(expectedSlow)));
+
+    // 快客户端不受影响，收到所有tag
+    XCTAssertEqual(fastTags.count, 2u + 18 + 2);
+    XCTAssertEqual(fastTags.ids[0], 1);
+    XCTAssertEqual(fastTags.ids[fastTags.count - 1], 31);
+    XCTAssertEqual(CQStreamFanoutGetStats(fanout).clientCount, 2u);
+    XCTAssertEqual(events.closedCount, 0u);
+
+    CQStreamFanoutDestroy(fanout);
+    for (int i = 0; i < 2; i++) {
+        close(slowFds[i]);
+        close(fastFds[i]);
+    }
+}
+
+#pragma mark - GOP Cache
+- (void)testNewClientStartsFromGOPCache {
+    CQTestFanoutEvents events = {0};
+    CQStreamFanoutConfig config = CQStreamFanoutDefaultConfig();
+    config.maxGOPCacheBytes = 3 * kTestTagLength;
+    CQStreamFanout *fanout = CQStreamFanoutCreate(config, CQTestFanoutDidEvent, &events);
+    CQFanoutBuffer *header = CQTestFanoutTag(1, kTestTagLength);
+    CQStreamFanoutSetHeader(fanout, &header, 1);
+    CQFanoutBufferRelease(header);
+
+    // 中途加入的客户端先收到头部和当前GOP
+    CQTestPublish(fanout, 10, CQFanoutTagKindKeyFrame, 0);
+    CQTestPublish(fanout, 11, CQFanoutTagKindFrame, 1000);
+    int fds[2];
+    CQTestSocketPair(fds);
+    CQFanoutClient *client = CQStreamFanoutAddClient(fanout, fds[0], NULL, 2000);
+    CQTestReceivedTags tags = {0};
+    CQTestDrainClient(fanout, client, fds[1], 2000, &tags);
+    CQTestPublish(fanout, 12, CQFanoutTagKindDroppable, 3000);
+    CQTestReadTags(fds[1], &tags);
+    const uint8_t expected[] = {1, 10, 11, 12};
+    XCTAssertTrue(CQTestTagsEqual(&tags, expected, sizeof(expected)));
+
+    // GOP超过缓存上限后缓存失效，新客户端只收到头部，等下一个关键帧
+    CQTestPublish(fanout, 13, CQFanoutTagKindFrame, 4000);
+    int lateFds[2];
+    CQTestSocketPair(lateFds);
+    CQFanoutClient *late = CQStreamFanoutAddClient(fanout, lateFds[0], NULL, 5000);
+    CQTestReceivedTags lateTags = {0};
+    CQTestDrainClient(fanout, late, lateFds[1], 5000, &lateTags);
+    CQTestPublish(fanout, 14, CQFanoutTagKindFrame, 6000);
+    CQTestPublish(fanout, 20, CQFanoutTagKindKeyFrame, 7000);
+    CQTestReadTags(lateFds[1], &lateTags);
+    const uint8_t expectedLate[] = {1, 20};
+    XCTAssertTrue(CQTestTagsEqual(&lateTags, expectedLate, sizeof(expectedLate)));
+
+    CQStreamFanoutDestroy(fanout);
+    for (int i = 0; i < 2; i++) {
+        close(fds[i]);
+        close(lateFds[i]);
+    }
+}
+
+#pragma mark - Stall
+- (void)testStalledClientIsDisconnected {
+    CQTestFanoutEvents events = {0};
+    CQStreamFanoutConfig config = CQStreamFanoutDefaultConfig();
+    config.maxStallUs = 1000000;
+    CQStreamFanout *fanout = CQStreamFanoutCreate(config, CQTestFanoutDidEvent, &events);
+    CQFanoutBuffer *header = CQTestFanoutTag(1, kTestTagLength);
+    CQStreamFanoutSetHeader(fanout, &header, 1);
+    CQFanoutBufferRelease(header);
+
+    int fds[2];
+    CQTestSocketPair(fds);
+    CQTestFillSocket(fds[0]);
+    CQStreamFanoutAddClient(fanout, fds[0], NULL, 0);
+    CQTestPublish(fanout, 10, CQFanoutTagKindKeyFrame, 0);
+
+    // 一个字节都写不出去，超过maxStallUs后下一次发布时断开
+    CQTestPublish(fanout, 11, CQFanoutTagKindFrame, 1000000);
+    XCTAssertEqual(events.closedCount, 0u);
+    CQTestPublish(fanout, 12, CQFanoutTagKindFrame, 1000001);
+    XCTAssertEqual(events.closedCount, 1u);
+    XCTAssertEqual(events.closedFd, fds[0]);
+    CQStreamFanoutStats stats = CQStreamFanoutGetStats(fanout);
+    XCTAssertEqual(stats.clientCount, 0u);
+    XCTAssertEqual(stats.disconnectedCount, 1u);
+
+    CQStreamFanoutDestroy(fanout);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+@end
@@ -0,0 +1,207 @@
+//
+//  CQStreamFileWriterTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQStreamFileWriter.h"
+
+/// size字节的数据，内容为value
+static NSData *CQTestChunk(size_t size, uint8_t value) {
+    NSMutableData *data = [NSMutableData dataWithLength:size];
+    memset(data.mutableBytes, value, size);
+    return data;
+}
+
+@interface CQStreamFileWriterTests : XCTestCase <CQStreamFileWriterDelegate>
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *backpressureChanges;  ///< 写文件队列上追加，加锁访问
+@property (nonatomic, strong) dispatch_semaphore_t enteredSemaphore;  ///< 第一次进入积压的回调已经在写文件队列上执行
+@property (nonatomic, strong, nullable) dispatch_semaphore_t gateSemaphore;  ///< 不为nil时下一次进入积压的回调阻塞写文件队列，直到发出信号
+@end
+
+@implementation CQStreamFileWriterTests
+
+- (void)setUp {
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"CQStreamFileWriterTests.bin"];
+    self.backpressureChanges = [NSMutableArray array];
+    self.enteredSemaphore = dispatch_semaphore_create(0);
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:nil];
+}
+
+#pragma mark - CQStreamFileWriterDelegate
+- (void)streamFileWriter:(CQStreamFileWriter *)writer didChangeBackpressure:(BOOL)isBackpressured {
+    @synchronized (self.backpressureChanges) {
+        [self.backpressureChanges addObject:@(isBackpressured)];
+    }
+    // 只阻塞一次
+    dispatch_semaphore_t gateSemaphore = isBackpressured ? self.gateSemaphore : nil;
+    if (gateSemaphore) {
+        self.gateSemaphore = nil;
+        dispatch_semaphore_signal(self.enteredSemaphore);
+        dispatch_semaphore_wait(gateSemaphore, DISPATCH_TIME_FOREVER);
+    }
+}
+
+#pragma mark - Private Func
+- (CQStreamFileWriter *)writer {
+    NSError *error = nil;
+    CQStreamFileWriter *writer = [[CQStreamFileWriter alloc] initWithPath:self.path error:&error];
+    XCTAssertNotNil(writer, @"%@", error);
+    writer.delegate = self;
+    return writer;
+}
+
+/// 等写文件队列写完bytes字节
+- (void)waitForWriter:(CQStreamFileWriter *)writer writtenBytes:(uint64_t)bytes {
+    CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+    while (writer.writtenBytes < bytes && CFAbsoluteTimeGetCurrent() < deadline) {
+        usleep(1000);
+    }
+    XCTAssertEqual(writer.writtenBytes, bytes);
+}
+
+- (void)closeWriter:(CQStreamFileWriter *)writer {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"close"];
+    [writer closeWithCompletionHandler:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:2 handler:nil];
+}
+
+/**
+ 阻塞写文件队列: 追加一块超过3/4上限的数据触发积压回调，回调里等返回的信号量
+ @discussion 这块数据可能在回调之前已经写完，积压也可能已经解除(解除的回调排在后面)
+ */
+- (dispatch_semaphore_t)blockWriter:(CQStreamFileWriter *)writer withChunk:(NSData *)chunk {
+    dispatch_semaphore_t gateSemaphore = dispatch_semaphore_create(0);
+    self.gateSemaphore = gateSemaphore;
+    XCTAssertTrue([writer appendData:chunk]);
+    XCTAssertEqual(dispatch_semaphore_wait(self.enteredSemaphore, dispatch_time(DISPATCH_TIME_NOW, 2 * NSEC_PER_SEC)), 0);
+    return gateSemaphore;
+}
+
+#pragma mark - Sync
+- (void)testSyncPolicyNoneSyncsOnlyOnClose {
+    CQStreamFileWriter *writer = [self writer];
+    XCTAssertTrue([writer appendData:CQTestChunk(100, 1)]);
+    [self waitForWriter:writer writtenBytes:100];
+    XCTAssertEqual(writer.syncCount, 0ull);
+    [self closeWriter:writer];
+    XCTAssertEqual(writer.syncCount, 1ull);
+}
+
+- (void)testSyncPolicyEveryBatch {
+    CQStreamFileWriter *writer = [self writer];
+    writer.syncPolicy = CQStreamFileSyncPolicyEveryBatch;
+    // 每次等写完再追加，每批同步一次
+    for (NSUInteger i = 1; i <= 3; i++) {
+        XCTAssertTrue([writer appendData:CQTestChunk(100, (uint8_t)i)]);
+        [self waitForWriter:writer writtenBytes:100 * i];
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+        while (writer.syncCount < i && CFAbsoluteTimeGetCurrent() < deadline) {
+            usleep(1000);
+        }
+        XCTAssertEqual(writer.syncCount, (uint64_t)i);
+    }
+    [self closeWriter:writer];
+    XCTAssertEqual(writer.syncCount, 4ull);
+}
+
+- (void)testSyncPolicyIntervalSyncsLastBatchByTimer {
+    CQStreamFileWriter *writer = [self writer];
+    writer.syncPolicy = CQStreamFileSyncPolicyInterval;
+    writer.syncInterval = 0.3;
+    // 距上次同步不到间隔，先不同步，由定时器在间隔后同步，之后没有新数据不再同步
+    XCTAssertTrue([writer appendData:CQTestChunk(100, 1)]);
+    [self waitForWriter:writer writtenBytes:100];
+    XCTAssertEqual(writer.syncCount, 0ull);
+    usleep(800 * 1000);
+    XCTAssertEqual(writer.syncCount, 1ull);
+
+    // 已经超过间隔，写完马上同步
+    XCTAssertTrue([writer appendData:CQTestChunk(100, 2)]);
+    [self waitForWriter:writer writtenBytes:200];
+    CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+    while (writer.syncCount < 2 && CFAbsoluteTimeGetCurrent() < deadline) {
+        usleep(1000);
+    }
+    XCTAssertEqual(writer.syncCount, 2ull);
+    [self closeWriter:writer];
+}
+
+#pragma mark - Backpressure
+- (void)testBackpressureTransitionsAndDrop {
+    CQStreamFileWriter *writer = [self writer];
+    writer.maxQueuedBytes = 4000;
+    NSMutableData *expected = [NSMutableData data];
+
+    // 超过3/4(3000)进入积压，写文件队列阻塞期间继续追加直到超过上限被丢弃
+    NSData *first = CQTestChunk(3100, 1);
+    dispatch_semaphore_t gateSemaphore = [self blockWriter:writer withChunk:first];
+    [expected appendData:first];
+    BOOL hasDropped = NO;
+    for (uint8_t i = 2; i < 10 && !hasDropped; i++) {
+        NSData *chunk = CQTestChunk(1000, i);
+        if ([writer appendData:chunk]) {
+            [expected appendData:chunk];
+        } else {
+            hasDropped = YES;
+        }
+    }
+    XCTAssertTrue(hasDropped);
+    XCTAssertTrue(writer.isBackpressured);
+    XCTAssertEqual(writer.droppedCount, 1u);
+    XCTAssertLessThanOrEqual(writer.queuedBytes, 4000u);
+
+    // 放开后写完，积压降到1/4以下解除；第一块在阻塞前写完时会多一次进入/解除，状态总是交替变化
+    dispatch_semaphore_signal(gateSemaphore);
+    [self closeWriter:writer];
+    XCTAssertFalse(writer.isBackpressured);
+    XCTAssertEqual(writer.queuedBytes, 0u);
+    @synchronized (self.backpressureChanges) {
+        NSUInteger count = self.backpressureChanges.count;
+        XCTAssertTrue(count == 2 || count == 4, @"%@", self.backpressureChanges);
+        for (NSUInteger i = 0; i < count; i++) {
+            XCTAssertEqual(self.backpressureChanges[i].boolValue, i % 2 == 0);
+        }
+    }
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:self.path], expected);
+
+    // 关闭后丢弃
+    XCTAssertFalse([writer appendData:CQTestChunk(10, 0)]);
+    XCTAssertEqual(writer.droppedCount, 2u);
+}
+
+#pragma mark - Writev
+- (void)testQueuedDataIsCoalescedIntoWritev {
+    static const NSUInteger kChunkCount = 500;
+    CQStreamFileWriter *writer = [self writer];
+    writer.maxQueuedBytes = 8000;
+    NSMutableData *expected = [NSMutableData data];
+
+    // 写文件队列阻塞期间追加的小块，放开后按256个一组合并写入
+    NSData *first = CQTestChunk(6100, 0xFF);
+    dispatch_semaphore_t gateSemaphore = [self blockWriter:writer withChunk:first];
+    [expected appendData:first];
+    for (NSUInteger i = 0; i < kChunkCount; i++) {
+        NSData *chunk = CQTestChunk(2, (uint8_t)i);
+        XCTAssertTrue([writer appendData:chunk]);
+        [expected appendData:chunk];
+    }
+    dispatch_semaphore_signal(gateSemaphore);
+    [self closeWriter:writer];
+
+    // 第一块可能在阻塞前单独写入，其余501或500块都是两组
+    XCTAssertGreaterThanOrEqual(writer.writevCount, 2ull);
+    XCTAssertLessThanOrEqual(writer.writevCount, 3ull);
+    XCTAssertEqual(writer.writtenBytes, (uint64_t)expected.length);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:self.path], expected);
+}
+
+@end
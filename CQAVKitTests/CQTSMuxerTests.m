@@ -0,0 +1,286 @@
+//
+//  CQTSMuxerTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQTSMuxer.h"
+#import "CQADTSUtil.h"
+
+static const uint16_t kTestPMTPid = 0x1000;
+static const uint16_t kTestVideoPid = 0x0100;
+static const uint16_t kTestAudioPid = 0x0101;
+static const int64_t kTestTimestampOffset = 63000;
+
+/// 解出来的一个PES
+@interface CQTestPES : NSObject
+@property (nonatomic, assign) uint16_t pid;
+@property (nonatomic, assign) int64_t pts;
+@property (nonatomic, assign) int64_t dts;  ///< 没有dts时等于pts
+@property (nonatomic, assign) NSUInteger pesLength;  ///< PES头里的长度字段
+@property (nonatomic, assign) BOOL hasPCR;  ///< 第一个TS包带PCR
+@property (nonatomic, assign) int64_t pcr;
+@property (nonatomic, assign) BOOL isRandomAccess;  ///< 第一个TS包的random_access_indicator
+@property (nonatomic, strong) NSMutableData *data;  ///< 完整的PES(头 + ES)
+@property (nonatomic, strong) NSData *es;
+@end
+
+@implementation CQTestPES
+@end
+
+@interface CQTSMuxerTests : XCTestCase<CQTSMuxerDelegate>
+@property (nonatomic, strong) NSMutableData *tsData;  ///< 输出的TS流
+@property (nonatomic, assign) NSUInteger outputCount;  ///< 输出回调次数
+@end
+
+@implementation CQTSMuxerTests
+
+- (void)setUp {
+    self.tsData = [NSMutableData data];
+    self.outputCount = 0;
+}
+
+#pragma mark - Private Func
+/// MPEG-2 CRC32，整个section(含CRC)计算结果为0
+static uint32_t CQTestCRC32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static int64_t CQTestReadTimestamp(const uint8_t *p) {
+    return ((int64_t)(p[0] >> 1) & 0x07) << 30 | (int64_t)p[1] << 22 | ((int64_t)p[2] >> 1) << 15 | (int64_t)p[3] << 7 | (p[4] >> 1);
+}
+
+- (NSData *)naluWithType:(uint8_t)type length:(NSUInteger)length seed:(uint8_t)seed {
+    NSMutableData *nalu = [NSMutableData dataWithLength:4 + length];
+    uint8_t *bytes = nalu.mutableBytes;
+    bytes[3] = 0x01;
+    bytes[4] = type;
+    // 负载不含00，避免出现起始码
+    for (NSUInteger i = 1; i < length; i++) {
+        bytes[4 + i] = (uint8_t)(1 + (i * 7 + seed) % 250);
+    }
+    return nalu;
+}
+
+- (void)finishMuxer:(CQTSMuxer *)muxer {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"flush"];
+    [muxer flushWithCompletionHandler:^{
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+}
+
+/**
+ 解析TS流: 检查同步字节、每个PID的连续计数器和PSI的CRC，按payload_unit_start拼出PES
+ @param psiSections 输出PAT/PMT的section(不含pointer_field)
+ */
+- (NSArray<CQTestPES *> *)demuxTSData:(NSData *)tsData psiSections:(NSMutableArray<NSData *> *)psiSections {
+    XCTAssertEqual(tsData.length % CQTSPacketSize, 0u);
+    NSMutableArray<CQTestPES *> *pesList = [NSMutableArray array];
+    NSMutableDictionary<NSNumber *, CQTestPES *> *currentPES = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSNumber *, NSNumber *> *continuityCounters = [NSMutableDictionary dictionary];
+    const uint8_t *bytes = tsData.bytes;
+    for (NSUInteger offset = 0; offset + CQTSPacketSize <= tsData.length; offset += CQTSPacketSize) {
+        const uint8_t *packet = bytes + offset;
+        XCTAssertEqual(packet[0], 0x47);
+        uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        BOOL isUnitStart = (packet[1] & 0x40) != 0;
+        uint8_t cc = packet[3] & 0x0F;
+        NSNumber *lastCC = continuityCounters[@(pid)];
+        if (lastCC) XCTAssertEqual(cc, (lastCC.unsignedCharValue + 1) & 0x0F, @"pid %u", pid);
+        continuityCounters[@(pid)] = @(cc);
+
+        const uint8_t *payload = packet + 4;
+        BOOL hasPCR = NO, isRandomAccess = NO;
+        int64_t pcr = 0;
+        if (packet[3] & 0x20) {
+            uint8_t adaptationLength = packet[4];
+            if (adaptationLength > 0) {
+                hasPCR = (packet[5] & 0x10) != 0;
+                isRandomAccess = (packet[5] & 0x40) != 0;
+                if (hasPCR) {
+                    const uint8_t *q = packet + 6;
+                    pcr = (int64_t)q[0] << 25 | (int64_t)q[1] << 17 | (int64_t)q[2] << 9 | (int64_t)q[3] << 1 | (q[4] >> 7);
+                }
+            }
+            payload += 1 + adaptationLength;
+        }
+        size_t payloadLength = packet + CQTSPacketSize - payload;
+
+        if (pid == 0 || pid == kTestPMTPid) {
+            XCTAssertTrue(isUnitStart);
+            const uint8_t *section = payload + 1 + payload[0];
+            size_t sectionLength = 3 + (((section[1] & 0x0F) << 8) | section[2]);
+            XCTAssertEqual(CQTestCRC32(section, sectionLength), 0u);
+            [psiSections addObject:[NSData dataWithBytes:section length:sectionLength]];
+            continue;
+        }
+        if (isUnitStart) {
+            CQTestPES *pes = [[CQTestPES alloc] init];
+            pes.pid = pid;
+            pes.hasPCR = hasPCR;
+            pes.pcr = pcr;
+            pes.isRandomAccess = isRandomAccess;
+            pes.data = [NSMutableData data];
+            currentPES[@(pid)] = pes;
+            [pesList addObject:pes];
+        }
+        XCTAssertNotNil(currentPES[@(pid)]);
+        [currentPES[@(pid)].data appendBytes:payload length:payloadLength];
+    }
+
+    for (CQTestPES *pes in pesList) {
+        const uint8_t *p = pes.data.bytes;
+        XCTAssertTrue(p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01);
+        pes.pesLength = (p[4] << 8) | p[5];
+        uint8_t flags = p[7];
+        pes.pts = CQTestReadTimestamp(p + 9);
+        pes.dts = (flags & 0x40) ? CQTestReadTimestamp(p + 14) : pes.pts;
+        size_t headerLength = 9 + p[8];
+        if (pes.pesLength > 0) XCTAssertEqual(pes.pesLength + 6, pes.data.length);
+        pes.es = [pes.data subdataWithRange:NSMakeRange(headerLength, pes.data.length - headerLength)];
+    }
+    return pesList;
+}
+
+#pragma mark - Tests
+- (void)testPSIAndStreamStructure {
+    CQVideoCoderConfig *videoConfig = [CQVideoCoderConfig defaultConifg];
+    CQAudioCoderConfig *audioConfig = [CQAudioCoderConfig defaultConifg];
+    CQTSMuxer *muxer = [[CQTSMuxer alloc] initWithVideoConfig:videoConfig audioConfig:audioConfig];
+    muxer.delegate = self;
+    muxer.outputBatchSize = 1000;
+    XCTAssertEqual(muxer.outputBatchSize, CQTSPacketSize * 6);
+
+    NSData *sps = [self naluWithType:0x67 length:12 seed:1];
+    NSData *pps = [self naluWithType:0x68 length:4 seed:2];
+    [muxer setSps:sps pps:pps];
+    // 按时间顺序交替输入，每帧视频前先输入时间不晚于它的音频
+    NSMutableArray<NSData *> *slices = [NSMutableArray array];
+    NSUInteger audioIndex = 0;
+    for (NSUInteger i = 0; i <= 60; i++) {
+        while (audioIndex < 86 && (i == 60 || audioIndex * 1024 * 30 <= i * 44100)) {
+            uint8_t raw[200];
+            memset(raw, 0x21 + (int)audioIndex % 16, sizeof(raw));
+            [muxer muxAudioData:[NSData dataWithBytes:raw length:sizeof(raw)] pts:CMTimeMake((int64_t)audioIndex * 1024, 44100)];
+            audioIndex++;
+        }
+        if (i == 60) break;
+        BOOL isKeyFrame = i % 30 == 0;
+        NSData *slice = [self naluWithType:isKeyFrame ? 0x65 : 0x41 length:isKeyFrame ? 5000 : 800 + i seed:(uint8_t)i];
+        [slices addObject:slice];
+        // 每一帧都有B帧延迟: pts比dts晚一帧
+        [muxer muxVideoNalus:@[slice] pts:CMTimeMake((int64_t)i + 1, 30) dts:CMTimeMake((int64_t)i, 30) isKeyFrame:isKeyFrame];
+    }
+    [self finishMuxer:muxer];
+    XCTAssertGreaterThan(self.outputCount, 1u);
+
+    NSMutableArray<NSData *> *psiSections = [NSMutableArray array];
+    NSArray<CQTestPES *> *pesList = [self demuxTSData:self.tsData psiSections:psiSections];
+
+    // 开头和每个关键帧前各一组PAT/PMT
+    XCTAssertEqual(psiSections.count, 2u * 2);
+    const uint8_t *pmt = psiSections[1].bytes;
+    XCTAssertEqual(pmt[0], 0x02);
+    XCTAssertEqual(((pmt[8] & 0x1F) << 8) | pmt[9], kTestVideoPid);  // PCR_PID
+    XCTAssertEqual(pmt[12], 0x1B);
+    XCTAssertEqual(((pmt[13] & 0x1F) << 8) | pmt[14], kTestVideoPid);
+    XCTAssertEqual(pmt[17], 0x0F);
+    XCTAssertEqual(((pmt[18] & 0x1F) << 8) | pmt[19], kTestAudioPid);
+
+    NSMutableArray<CQTestPES *> *videoPES = [NSMutableArray array];
+    NSMutableArray<CQTestPES *> *audioPES = [NSMutableArray array];
+    int64_t lastDts = 0;
+    for (CQTestPES *pes in pesList) {
+        // 按dts交织
+        XCTAssertGreaterThanOrEqual(pes.dts, lastDts);
+        lastDts = pes.dts;
+        [(pes.pid == kTestVideoPid ? videoPES : audioPES) addObject:pes];
+    }
+    XCTAssertEqual(videoPES.count, 60u);
+    XCTAssertEqual(audioPES.count, 86u);
+
+    static const uint8_t h264AUD[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+    for (NSUInteger i = 0; i < videoPES.count; i++) {
+        CQTestPES *pes = videoPES[i];
+        BOOL isKeyFrame = i % 30 == 0;
+        XCTAssertEqual(pes.dts, kTestTimestampOffset + (int64_t)i * 3000);
+        XCTAssertEqual(pes.pts, kTestTimestampOffset + (int64_t)(i + 1) * 3000);
+        // PCR不延后
+        XCTAssertTrue(pes.hasPCR);
+        XCTAssertEqual(pes.pcr, (int64_t)i * 3000);
+        XCTAssertEqual(pes.isRandomAccess, isKeyFrame);
+        // AUD + (关键帧)sps/pps + 片
+        NSMutableData *expected = [NSMutableData dataWithBytes:h264AUD length:sizeof(h264AUD)];
+        if (isKeyFrame) {
+            [expected appendData:sps];
+            [expected appendData:pps];
+        }
+        [expected appendData:slices[i]];
+        XCTAssertEqualObjects(pes.es, expected, @"frame %lu", (unsigned long)i);
+    }
+    for (NSUInteger i = 0; i < audioPES.count; i++) {
+        CQTestPES *pes = audioPES[i];
+        XCTAssertFalse(pes.hasPCR);
+        XCTAssertEqual(pes.pts, pes.dts);
+        XCTAssertEqualWithAccuracy((double)pes.pts, kTestTimestampOffset + i * 1024 * 90000.0 / 44100, 1);
+        // 每一帧补上ADTS头
+        const uint8_t *es = pes.es.bytes;
+        XCTAssertEqual(CQADTSHeaderLength(es, pes.es.length), CQADTSHeaderSize);
+        XCTAssertEqual(CQADTSFrameLength(es), pes.es.length);
+        XCTAssertEqual(pes.es.length, CQADTSHeaderSize + 200);
+        XCTAssertEqual(es[CQADTSHeaderSize], 0x21 + (int)i % 16);
+    }
+}
+
+- (void)testLargeFrameAndAudioOnlyPSI {
+    // 超过65535的视频PES长度写0
+    CQTSMuxer *muxer = [[CQTSMuxer alloc] initWithVideoConfig:[CQVideoCoderConfig defaultConifg] audioConfig:nil];
+    muxer.delegate = self;
+    NSData *slice = [self naluWithType:0x65 length:100000 seed:3];
+    [muxer muxVideoNalus:@[slice] pts:kCMTimeZero dts:kCMTimeInvalid isKeyFrame:YES];
+    [self finishMuxer:muxer];
+    NSMutableArray<NSData *> *psiSections = [NSMutableArray array];
+    NSArray<CQTestPES *> *pesList = [self demuxTSData:self.tsData psiSections:psiSections];
+    XCTAssertEqual(pesList.count, 1u);
+    XCTAssertEqual(pesList.firstObject.pesLength, 0u);
+    XCTAssertEqual(pesList.firstObject.es.length, 6 + slice.length);
+
+    // 纯音频: PCR在音频上，PAT/PMT每0.1秒一次
+    self.tsData = [NSMutableData data];
+    muxer = [[CQTSMuxer alloc] initWithVideoConfig:nil audioConfig:[CQAudioCoderConfig defaultConifg]];
+    muxer.delegate = self;
+    for (NSUInteger i = 0; i < 44; i++) {
+        uint8_t raw[100];
+        memset(raw, 0x21, sizeof(raw));
+        [muxer muxAudioData:[NSData dataWithBytes:raw length:sizeof(raw)] pts:CMTimeMake((int64_t)i * 1024, 44100)];
+    }
+    [self finishMuxer:muxer];
+    [psiSections removeAllObjects];
+    pesList = [self demuxTSData:self.tsData psiSections:psiSections];
+    XCTAssertEqual(pesList.count, 44u);
+    for (CQTestPES *pes in pesList) {
+        XCTAssertTrue(pes.hasPCR);
+    }
+    // 间隔不小于0.1秒，一帧约0.023秒，每5帧一次
+    XCTAssertEqual(psiSections.count / 2, 9u);
+    const uint8_t *pmt = psiSections[1].bytes;
+    XCTAssertEqual(((pmt[8] & 0x1F) << 8) | pmt[9], kTestAudioPid);
+}
+
+#pragma mark - CQTSMuxerDelegate
+- (void)tsMuxer:(CQTSMuxer *)tsMuxer didOutputTSData:(NSData *)tsData {
+    [self.tsData appendData:tsData];
+    self.outputCount++;
+}
+
+@end
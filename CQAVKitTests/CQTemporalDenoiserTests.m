@@ -0,0 +1,201 @@
+//
+//  CQTemporalDenoiserTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQTemporalDenoiser.h"
+#import "CQTestSupport.h"
+
+/// 参考帧权重为w时的输出，四舍五入
+static uint8_t CQTestBlend(uint32_t reference, uint32_t current, uint32_t w) {
+    return (uint8_t)((2 * (reference * w + current * (255 - w)) + 255) / 510);
+}
+
+/// 差值的和(前 + 2 * 当前 + 后)对应的参考帧权重
+static uint32_t CQTestWeight(CQDenoiseLevel level, int32_t sum) {
+    uint32_t penalty = MIN((((uint32_t)abs(sum) + 2) >> 2) * level.slope, 255);
+    return level.maxWeight > penalty ? level.maxWeight - penalty : 0;
+}
+
+/// 亮度和真实值的平均绝对误差
+static double CQTestLumaError(const CQYUVPlanes *planes, uint8_t truth) {
+    size_t total = 0;
+    for (size_t j = 0; j < planes->height; j++) {
+        for (size_t i = 0; i < planes->width; i++) {
+            total += (size_t)abs((int)planes->y[j * planes->yBytesPerRow + i] - truth);
+        }
+    }
+    return (double)total / (planes->width * planes->height);
+}
+
+@interface CQTemporalDenoiserTests : XCTestCase
+
+@end
+
+@implementation CQTemporalDenoiserTests
+
+#pragma mark - 参数
+- (void)testParameters {
+    // 强度越高，静止时参考帧权重越大
+    CQDenoiseParameters low = CQDenoiseParametersMake(CQDenoiseStrengthLow);
+    CQDenoiseParameters medium = CQDenoiseParametersMake(CQDenoiseStrengthMedium);
+    CQDenoiseParameters high = CQDenoiseParametersMake(CQDenoiseStrengthHigh);
+    XCTAssertEqual(low.luma.maxWeight, 128);
+    XCTAssertEqual(medium.luma.maxWeight, 170);
+    XCTAssertEqual(high.luma.maxWeight, 204);
+    XCTAssertLessThan(low.luma.slope, high.luma.slope);
+    XCTAssertEqual(medium.chroma.maxWeight, medium.luma.maxWeight);
+}
+
+#pragma mark - 滤波
+- (void)testFirstFrameIsUnchanged {
+    // 第一帧参考帧就是当前帧，结果等于当前帧
+    uint32_t seed = 1;
+    CQYUVPlanes current = CQTestPlanesCreate(33, 9, YES, 0);
+    CQYUVPlanes output = CQTestPlanesCreate(33, 9, YES, kTestPaddingByte);
+    CQTestPlanesFillRandom(&current, 0, 0, &seed);
+    CQTemporalDenoise(&current, &current, &output, CQDenoiseParametersMake(CQDenoiseStrengthHigh), 1);
+    XCTAssertTrue(CQTestPlanesEqual(&current, &output));
+    CQTestPlanesFree(&output);
+    CQTestPlanesFree(&current);
+}
+
+- (void)testStaticAndMovingPixels {
+    CQDenoiseParameters parameters = CQDenoiseParametersMake(CQDenoiseStrengthMedium);
+    CQYUVPlanes reference = CQTestPlanesCreate(32, 4, NO, 100);
+    CQYUVPlanes current = CQTestPlanesCreate(32, 4, NO, 106);
+    CQYUVPlanes output = CQTestPlanesCreate(32, 4, NO, 0);
+
+    // 整片的小差值按静止处理: motion = 6，w = 170 - 6 x 4
+    CQTemporalDenoise(&current, &reference, &output, parameters, 1);
+    XCTAssertEqual(output.y[0], CQTestBlend(100, 106, CQTestWeight(parameters.luma, 24)));
+    XCTAssertEqual(output.y[0], 103);
+    XCTAssertEqual(output.y[3 * output.yBytesPerRow + 31], 103);
+    XCTAssertEqual(output.v[output.vBytesPerRow + 15], CQTestBlend(100, 106, CQTestWeight(parameters.chroma, 24)));
+
+    // 大差值(运动)完全取当前帧，不拖影
+    memset(current.y + current.yBytesPerRow, 250, 32);
+    CQTemporalDenoise(&current, &reference, &output, parameters, 1);
+    XCTAssertEqual(output.y[output.yBytesPerRow + 16], 250);
+    XCTAssertEqual(output.y[output.yBytesPerRow], 250);
+
+    // 孤立的一个噪点: 自己的差值被邻居平滑，邻居只受一半影响
+    memset(current.y, 100, 32);
+    current.y[10] = 120;
+    CQTemporalDenoise(&current, &reference, &output, parameters, 1);
+    XCTAssertEqual(output.y[10], CQTestBlend(100, 120, CQTestWeight(parameters.luma, 40)));
+    XCTAssertEqual(output.y[9], CQTestBlend(100, 100, CQTestWeight(parameters.luma, 20)));
+    XCTAssertEqual(output.y[9], 100);
+    XCTAssertTrue(CQTestPaddingIntact(&output));
+
+    CQTestPlanesFree(&output);
+    CQTestPlanesFree(&current);
+    CQTestPlanesFree(&reference);
+}
+
+- (void)testNV12ChromaNeighbors {
+    // NV12的U和V交错，邻居距离为2: 只有U变化时V不受影响，U的motion不被V的0差值平滑
+    CQDenoiseParameters parameters = CQDenoiseParametersMake(CQDenoiseStrengthLow);
+    CQYUVPlanes reference = CQTestPlanesCreate(32, 2, YES, 128);
+    CQYUVPlanes current = CQTestPlanesCreate(32, 2, YES, 128);
+    CQYUVPlanes output = CQTestPlanesCreate(32, 2, YES, 0);
+    for (size_t i = 0; i < 32; i += 2) {
+        current.u[i] = 136;
+    }
+    CQTemporalDenoise(&current, &reference, &output, parameters, 1);
+    for (size_t i = 0; i < 32; i += 2) {
+        XCTAssertEqual(output.u[i], CQTestBlend(128, 136, CQTestWeight(parameters.chroma, 32)), @"U %zu", i);
+        XCTAssertEqual(output.u[i + 1], 128, @"V %zu", i);
+    }
+    XCTAssertEqual(output.y[5], 128);
+    CQTestPlanesFree(&output);
+    CQTestPlanesFree(&current);
+    CQTestPlanesFree(&reference);
+}
+
+- (void)testStaticNoiseIsReduced {
+    // 静止的灰色画面加均匀噪声(±6)，递归滤波几帧后误差明显小于输入
+    uint32_t seed = 7;
+    CQDenoiseParameters parameters = CQDenoiseParametersMake(CQDenoiseStrengthHigh);
+    CQYUVPlanes current = CQTestPlanesCreate(64, 32, YES, 0);
+    CQYUVPlanes outputs[2] = {CQTestPlanesCreate(64, 32, YES, 0), CQTestPlanesCreate(64, 32, YES, 0)};
+    double inputError = 0, outputError = 0;
+    for (int frame = 0; frame < 10; frame++) {
+        CQTestPlanesFillRandom(&current, 100, 6, &seed);
+        const CQYUVPlanes *reference = frame == 0 ? &current : &outputs[(frame + 1) % 2];
+        CQTemporalDenoise(&current, reference, &outputs[frame % 2], parameters, 1);
+        inputError = CQTestLumaError(&current, 100);
+        outputError = CQTestLumaError(&outputs[frame % 2], 100);
+    }
+    XCTAssertGreaterThan(inputError, 2.5);
+    XCTAssertLessThan(outputError, inputError * 0.6);
+    CQTestPlanesFree(&outputs[0]);
+    CQTestPlanesFree(&outputs[1]);
+    CQTestPlanesFree(&current);
+}
+
+#pragma mark - NEON
+- (void)testNEONMatchesScalar {
+    // 宽度覆盖16的整数倍、不足16、奇数和NV12色度行尾的邻居，差值有噪声也有运动，三种强度，NV12和I420
+    static const size_t widths[] = {1, 2, 15, 16, 17, 18, 33, 34, 64, 97};
+    static const size_t heights[] = {1, 2, 5};
+    uint32_t seed = 1;
+    for (int strength = CQDenoiseStrengthLow; strength <= CQDenoiseStrengthHigh; strength++) {
+        CQDenoiseParameters parameters = CQDenoiseParametersMake((CQDenoiseStrength)strength);
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+                for (int isNV12 = 0; isNV12 < 2; isNV12++) {
+                    size_t width = widths[w], height = heights[h];
+                    CQYUVPlanes current = CQTestPlanesCreate(width, height, isNV12, 0);
+                    CQYUVPlanes reference = CQTestPlanesCreate(width, height, isNV12, 0);
+                    CQYUVPlanes scalar = CQTestPlanesCreate(width, height, isNV12, 0);
+                    CQYUVPlanes vector = CQTestPlanesCreate(width, height, isNV12, 0);
+                    CQTestPlanesFillRandom(&current, 0, 0, &seed);
+                    CQTestPlanesFillRandom(&reference, 0, 0, &seed);
+                    // 一半的行参考帧接近当前帧(静止)，另一半随机(运动)
+                    for (size_t j = 0; j < height; j += 2) {
+                        for (size_t i = 0; i < width; i++) {
+                            int value = current.y[j * current.yBytesPerRow + i] + (int)(CQTestRandom(&seed) % 9) - 4;
+                            reference.y[j * reference.yBytesPerRow + i] = (uint8_t)MAX(MIN(value, 255), 0);
+                        }
+                    }
+                    CQTemporalDenoiseRowsScalar(&current, &reference, &scalar, parameters, 0, height);
+                    CQTemporalDenoiseRows(&current, &reference, &vector, parameters, 0, height);
+                    XCTAssertTrue(CQTestPlanesEqual(&scalar, &vector), @"strength %d %zux%zu NV12 %d", strength, width, height, isNV12);
+                    XCTAssertTrue(CQTestPaddingIntact(&vector));
+                    CQTestPlanesFree(&vector);
+                    CQTestPlanesFree(&scalar);
+                    CQTestPlanesFree(&reference);
+                    CQTestPlanesFree(&current);
+                }
+            }
+        }
+    }
+}
+
+#pragma mark - Bands
+- (void)testBandsMatchSingleThread {
+    // 分段降噪和整帧一次降噪结果相同，高度为奇数
+    uint32_t seed = 9;
+    CQDenoiseParameters parameters = CQDenoiseParametersMake(CQDenoiseStrengthMedium);
+    CQYUVPlanes current = CQTestPlanesCreate(40, 21, NO, 0);
+    CQYUVPlanes reference = CQTestPlanesCreate(40, 21, NO, 0);
+    CQYUVPlanes single = CQTestPlanesCreate(40, 21, NO, 0);
+    CQTestPlanesFillRandom(&current, 128, 20, &seed);
+    CQTestPlanesFillRandom(&reference, 128, 20, &seed);
+    CQTemporalDenoiseRowsScalar(&current, &reference, &single, parameters, 0, 21);
+    for (size_t bandCount = 0; bandCount <= 16; bandCount += 3) {
+        CQYUVPlanes banded = CQTestPlanesCreate(40, 21, NO, 0);
+        CQTemporalDenoise(&current, &reference, &banded, parameters, bandCount);
+        XCTAssertTrue(CQTestPlanesEqual(&single, &banded), @"bandCount %zu", bandCount);
+        CQTestPlanesFree(&banded);
+    }
+    CQTestPlanesFree(&single);
+    CQTestPlanesFree(&reference);
+    CQTestPlanesFree(&current);
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  CQTestSupport.h
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <Foundation/Foundation.h>
+#import "CQFrameTransform.h"
+#import "CQBitWriter.h"
+
+/**
+ 测试公用的数据构造
+ @discussion 伪随机数、带行填充的YUV平面、H264 SPS和NALU，各测试文件共用，结果可复现
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+#define kTestPadding 6  ///< 每行末尾的填充，被测代码不能写到这里
+#define kTestPaddingByte 0xCD
+
+/// 线性同余伪随机数，取高24位
+FOUNDATION_EXPORT uint32_t CQTestRandom(uint32_t *state);
+
+#pragma mark - YUV
+/**
+ 分配YUV平面，有效区域填value，行末尾是填充字节
+ @discussion 色度宽高向上取整，奇数宽高也可以；value传kTestPaddingByte时整个缓冲都是填充字节
+ */
+FOUNDATION_EXPORT CQYUVPlanes CQTestPlanesCreate(size_t width, size_t height, BOOL isNV12, uint8_t value);
+
+FOUNDATION_EXPORT void CQTestPlanesFree(CQYUVPlanes *planes);
+
+/// 有效区域填随机数，center附近±range(center为0时0~255)
+FOUNDATION_EXPORT void CQTestPlanesFillRandom(const CQYUVPlanes *planes, uint8_t center, uint8_t range, uint32_t *seed);
+
+/// 整个缓冲完全相同(包括填充)
+FOUNDATION_EXPORT BOOL CQTestPlanesEqual(const CQYUVPlanes *a, const CQYUVPlanes *b);
+
+/// 行末尾的填充没有被改写
+FOUNDATION_EXPORT BOOL CQTestPaddingIntact(const CQYUVPlanes *planes);
+
+#pragma mark - NALU
+#define kTestMaxSPSSize 128
+
+/// 生成H264 SPS的参数，CQTestSPSConfigMake的默认值之外按需修改
+typedef struct {
+    uint8_t profileIdc;  ///< 66或100，100时写chroma_format_idc等
+    uint8_t constraintFlags;
+    uint8_t levelIdc;
+    uint8_t log2MaxFrameNum;
+    uint32_t picOrderCntType;  ///< 0或2
+    uint8_t log2MaxPicOrderCntLsb;  ///< picOrderCntType为0时有效
+    uint32_t maxNumRefFrames;
+    BOOL gapsInFrameNumAllowedFlag;
+    uint32_t widthInMbs;
+    uint32_t heightInMbs;
+    uint32_t cropBottom;  ///< frame_crop_bottom_offset，4:2:0按2行为单位，0时不裁剪
+    BOOL hasVUI;  ///< 有VUI时带宽高比(Extended_SAR)、色彩描述、timing_info、NAL HRD和bitstream_restriction
+    uint32_t maxNumReorderFrames;
+    uint32_t maxDecFrameBuffering;
+} CQTestSPSConfig;
+
+/// 640x360(40x23个宏块，裁剪掉下面8行)、POC类型2、1个参考帧，没有VUI
+FOUNDATION_EXPORT CQTestSPSConfig CQTestSPSConfigMake(uint8_t profileIdc);
+
+/// 按config生成SPS NALU(不带起始码)，output至少kTestMaxSPSSize
+FOUNDATION_EXPORT size_t CQTestH264SPS(CQTestSPSConfig config, uint8_t *output);
+
+/// 写完RBSP的停止位，加防竞争字节后接在NALU头后面，返回NALU长度
+FOUNDATION_EXPORT size_t CQTestFinishNalu(CQBitWriter *writer, const uint8_t *header, size_t headerSize, uint8_t *output);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,177 @@
+//
+//  CQTestSupport.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import "CQTestSupport.h"
+#import "CQNaluUtil.h"
+
+uint32_t CQTestRandom(uint32_t *state) {
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 8;
+}
+
+#pragma mark - YUV
+CQYUVPlanes CQTestPlanesCreate(size_t width, size_t height, BOOL isNV12, uint8_t value) {
+    size_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    CQYUVPlanes planes = {0};
+    planes.width = width;
+    planes.height = height;
+    planes.yBytesPerRow = width + kTestPadding;
+    planes.uBytesPerRow = (isNV12 ? chromaWidth * 2 : chromaWidth) + kTestPadding;
+    planes.y = malloc(planes.yBytesPerRow * height);
+    planes.u = malloc(planes.uBytesPerRow * chromaHeight);
+    memset(planes.y, kTestPaddingByte, planes.yBytesPerRow * height);
+    memset(planes.u, kTestPaddingByte, planes.uBytesPerRow * chromaHeight);
+    for (size_t j = 0; j < height; j++) {
+        memset(planes.y + j * planes.yBytesPerRow, value, width);
+    }
+    for (size_t j = 0; j < chromaHeight; j++) {
+        memset(planes.u + j * planes.uBytesPerRow, value, planes.uBytesPerRow - kTestPadding);
+    }
+    if (!isNV12) {
+        planes.vBytesPerRow = planes.uBytesPerRow;
+        planes.v = malloc(planes.vBytesPerRow * chromaHeight);
+        memcpy(planes.v, planes.u, planes.vBytesPerRow * chromaHeight);
+    }
+    return planes;
+}
+
+void CQTestPlanesFree(CQYUVPlanes *planes) {
+    free(planes->y);
+    free(planes->u);
+    free(planes->v);
+}
+
+void CQTestPlanesFillRandom(const CQYUVPlanes *planes, uint8_t center, uint8_t range, uint32_t *seed) {
+    uint8_t *planeData[3] = {planes->y, planes->u, planes->v};
+    size_t bytesPerRow[3] = {planes->yBytesPerRow, planes->uBytesPerRow, planes->vBytesPerRow};
+    size_t rowCount[3] = {planes->height, (planes->height + 1) / 2, (planes->height + 1) / 2};
+    for (int p = 0; p < 3 && planeData[p]; p++) {
+        for (size_t j = 0; j < rowCount[p]; j++) {
+            for (size_t i = 0; i < bytesPerRow[p] - kTestPadding; i++) {
+                uint32_t random = CQTestRandom(seed);
+                planeData[p][j * bytesPerRow[p] + i] = center == 0 ? (uint8_t)random : (uint8_t)(center - range + (int)(random % (2 * range + 1)));
+            }
+        }
+    }
+}
+
+BOOL CQTestPlanesEqual(const CQYUVPlanes *a, const CQYUVPlanes *b) {
+    size_t chromaHeight = (a->height + 1) / 2;
+    return memcmp(a->y, b->y, a->yBytesPerRow * a->height) == 0 && memcmp(a->u, b->u, a->uBytesPerRow * chromaHeight) == 0
+        && (!a->v || memcmp(a->v, b->v, a->vBytesPerRow * chromaHeight) == 0);
+}
+
+BOOL CQTestPaddingIntact(const CQYUVPlanes *planes) {
+    for (size_t j = 0; j < planes->height; j++) {
+        for (size_t i = planes->yBytesPerRow - kTestPadding; i < planes->yBytesPerRow; i++) {
+            if (planes->y[j * planes->yBytesPerRow + i] != kTestPaddingByte) return NO;
+        }
+    }
+    for (size_t j = 0; j < (planes->height + 1) / 2; j++) {
+        for (size_t i = planes->uBytesPerRow - kTestPadding; i < planes->uBytesPerRow; i++) {
+            if (planes->u[j * planes->uBytesPerRow + i] != kTestPaddingByte) return NO;
+            if (planes->v && planes->v[j * planes->vBytesPerRow + i] != kTestPaddingByte) return NO;
+        }
+    }
+    return YES;
+}
+
+#pragma mark - NALU
+/// 写hrd_parameters()，1个CPB
+static void CQTestWriteHRD(CQBitWriter *writer) {
+    CQBitWriterWriteUE(writer, 0);  // cpb_cnt_minus1
+    CQBitWriterWriteBits(writer, 0x4, 4);  // bit_rate_scale
+    CQBitWriterWriteBits(writer, 0x6, 4);  // cpb_size_scale
+    CQBitWriterWriteUE(writer, 1999);  // bit_rate_value_minus1
+    CQBitWriterWriteUE(writer, 3999);  // cpb_size_value_minus1
+    CQBitWriterWriteBit(writer, 0);  // cbr_flag
+    CQBitWriterWriteBits(writer, 0x5EF7B, 20);  // 四个长度字段
+}
+
+CQTestSPSConfig CQTestSPSConfigMake(uint8_t profileIdc) {
+    CQTestSPSConfig config = {0};
+    config.profileIdc = profileIdc;
+    config.constraintFlags = 0xC0;  // constraint_set0_flag, constraint_set1_flag
+    config.levelIdc = 31;
+    config.log2MaxFrameNum = 4;
+    config.picOrderCntType = 2;
+    config.maxNumRefFrames = 1;
+    config.widthInMbs = 40;
+    config.heightInMbs = 23;
+    config.cropBottom = 4;
+    return config;
+}
+
+size_t CQTestH264SPS(CQTestSPSConfig config, uint8_t *output) {
+    uint8_t rbsp[kTestMaxSPSSize] = {0};
+    CQBitWriter writer = CQBitWriterMake(rbsp, sizeof(rbsp));
+    CQBitWriterWriteBits(&writer, config.profileIdc, 8);
+    CQBitWriterWriteBits(&writer, config.constraintFlags, 8);
+    CQBitWriterWriteBits(&writer, config.levelIdc, 8);
+    CQBitWriterWriteUE(&writer, 0);  // seq_parameter_set_id
+    if (config.profileIdc == 100) {
+        CQBitWriterWriteUE(&writer, 1);  // chroma_format_idc
+        CQBitWriterWriteUE(&writer, 0);  // bit_depth_luma_minus8
+        CQBitWriterWriteUE(&writer, 0);  // bit_depth_chroma_minus8
+        CQBitWriterWriteBits(&writer, 0, 2);  // qpprime_y_zero_transform_bypass_flag, seq_scaling_matrix_present_flag
+    }
+    CQBitWriterWriteUE(&writer, config.log2MaxFrameNum - 4);
+    CQBitWriterWriteUE(&writer, config.picOrderCntType);
+    if (config.picOrderCntType == 0) {
+        CQBitWriterWriteUE(&writer, config.log2MaxPicOrderCntLsb - 4);
+    }
+    CQBitWriterWriteUE(&writer, config.maxNumRefFrames);
+    CQBitWriterWriteBit(&writer, config.gapsInFrameNumAllowedFlag);
+    CQBitWriterWriteUE(&writer, config.widthInMbs - 1);  // pic_width_in_mbs_minus1
+    CQBitWriterWriteUE(&writer, config.heightInMbs - 1);  // pic_height_in_map_units_minus1
+    CQBitWriterWriteBits(&writer, 0x3, 2);  // frame_mbs_only_flag, direct_8x8_inference_flag
+    CQBitWriterWriteBit(&writer, config.cropBottom > 0);  // frame_cropping_flag
+    if (config.cropBottom > 0) {
+        CQBitWriterWriteUE(&writer, 0);
+        CQBitWriterWriteUE(&writer, 0);
+        CQBitWriterWriteUE(&writer, 0);
+        CQBitWriterWriteUE(&writer, config.cropBottom);
+    }
+    CQBitWriterWriteBit(&writer, config.hasVUI);
+    if (config.hasVUI) {
+        CQBitWriterWriteBit(&writer, 1);  // aspect_ratio_info_present_flag
+        CQBitWriterWriteBits(&writer, 255, 8);  // Extended_SAR
+        CQBitWriterWriteBits(&writer, 4, 16);
+        CQBitWriterWriteBits(&writer, 3, 16);
+        CQBitWriterWriteBit(&writer, 0);  // overscan_info_present_flag
+        CQBitWriterWriteBit(&writer, 1);  // video_signal_type_present_flag
+        CQBitWriterWriteBits(&writer, 0xB, 4);  // video_format = 5, video_full_range_flag = 1
+        CQBitWriterWriteBit(&writer, 1);  // colour_description_present_flag
+        CQBitWriterWriteBits(&writer, 0x010101, 24);  // BT.709
+        CQBitWriterWriteBit(&writer, 0);  // chroma_loc_info_present_flag
+        CQBitWriterWriteBit(&writer, 1);  // timing_info_present_flag
+        CQBitWriterWriteBits(&writer, 1001, 32);
+        CQBitWriterWriteBits(&writer, 60000, 32);
+        CQBitWriterWriteBit(&writer, 1);  // fixed_frame_rate_flag
+        CQBitWriterWriteBit(&writer, 1);  // nal_hrd_parameters_present_flag
+        CQTestWriteHRD(&writer);
+        CQBitWriterWriteBit(&writer, 0);  // vcl_hrd_parameters_present_flag
+        CQBitWriterWriteBit(&writer, 1);  // low_delay_hrd_flag
+        CQBitWriterWriteBit(&writer, 1);  // pic_struct_present_flag
+        CQBitWriterWriteBit(&writer, 1);  // bitstream_restriction_flag
+        CQBitWriterWriteBit(&writer, 1);  // motion_vectors_over_pic_boundaries_flag
+        CQBitWriterWriteUE(&writer, 0);  // max_bytes_per_pic_denom
+        CQBitWriterWriteUE(&writer, 0);  // max_bits_per_mb_denom
+        CQBitWriterWriteUE(&writer, 13);  // log2_max_mv_length_horizontal
+        CQBitWriterWriteUE(&writer, 11);  // log2_max_mv_length_vertical
+        CQBitWriterWriteUE(&writer, config.maxNumReorderFrames);
+        CQBitWriterWriteUE(&writer, config.maxDecFrameBuffering);
+    }
+    const uint8_t header = 0x67;
+    return CQTestFinishNalu(&writer, &header, 1, output);
+}
+
+size_t CQTestFinishNalu(CQBitWriter *writer, const uint8_t *header, size_t headerSize, uint8_t *output) {
+    CQBitWriterWriteTrailingBits(writer);
+    memcpy(output, header, headerSize);
+    return headerSize + CQNaluAddEmulationPrevention(writer->data, CQBitWriterByteSize(writer), output + headerSize);
+}
@@ -0,0 +1,150 @@
+//
+//  CQTimestampSEITests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQTimestampSEI.h"
+#import "CQNaluUtil.h"
+
+static const uint8_t kTestTimestampSEIUUID[16] = {
+    0x43, 0x51, 0x41, 0x56, 0x4B, 0x69, 0x74, 0x2D, 0x9A, 0x1E, 0x4F, 0x27, 0xB8, 0x63, 0x0D, 0xC5,
+};
+
+@interface CQTimestampSEITests : XCTestCase
+
+@end
+
+@implementation CQTimestampSEITests
+
+#pragma mark - Private Func
+/// 去掉4字节起始码后解析
+- (BOOL)parseSEI:(NSData *)sei codec:(CQVideoCodec)codec timestamp:(CQCaptureTimestamp *)timestamp {
+    size_t naluSize = 0;
+    const uint8_t *nalu = CQNaluSkipStartCode(sei.bytes, sei.length, &naluSize);
+    XCTAssertTrue(nalu != NULL);
+    if (!nalu) return NO;
+    return CQTimestampSEIParse(codec, nalu, naluSize, timestamp);
+}
+
+/// 检查起始码之后没有00 00 00~02，00 00后面只能是03
+- (void)assertNoStartCodeEmulationInSEI:(NSData *)sei {
+    const uint8_t *bytes = sei.bytes;
+    for (size_t i = 4; i + 2 < sei.length; i++) {
+        if (bytes[i] == 0 && bytes[i + 1] == 0) {
+            XCTAssertEqual(bytes[i + 2], 0x03, @"offset %zu", i);
+        }
+    }
+}
+
+#pragma mark - Round Trip
+- (void)testRoundTripH264 {
+    CQCaptureTimestamp timestamp = {.captureTimeUs = 0x0102030405060708, .frameID = 0x1112131415161718};
+    NSData *sei = CQTimestampSEICreate(CQVideoCodecH264, timestamp);
+    const uint8_t *bytes = sei.bytes;
+    XCTAssertEqual(bytes[0], 0x00);
+    XCTAssertEqual(bytes[3], 0x01);
+    XCTAssertEqual(bytes[4], CQH264NaluTypeSEI);
+    // 起始码 + NALU头 + payloadType + payloadSize + 32字节负载 + 0x80，没有需要转义的字节
+    XCTAssertEqual(sei.length, 4u + 1 + 1 + 1 + 32 + 1);
+
+    CQCaptureTimestamp parsed = {0};
+    XCTAssertTrue([self parseSEI:sei codec:CQVideoCodecH264 timestamp:&parsed]);
+    XCTAssertEqual(parsed.captureTimeUs, timestamp.captureTimeUs);
+    XCTAssertEqual(parsed.frameID, timestamp.frameID);
+}
+
+- (void)testRoundTripHEVC {
+    CQCaptureTimestamp timestamp = {.captureTimeUs = CQWallClockMicros(), .frameID = 7};
+    NSData *sei = CQTimestampSEICreate(CQVideoCodecHEVC, timestamp);
+    const uint8_t *bytes = sei.bytes;
+    XCTAssertEqual((bytes[4] >> 1) & 0x3F, CQHEVCNaluTypePrefixSEI);
+    XCTAssertEqual(bytes[5], 0x01);
+
+    CQCaptureTimestamp parsed = {0};
+    XCTAssertTrue([self parseSEI:sei codec:CQVideoCodecHEVC timestamp:&parsed]);
+    XCTAssertEqual(parsed.captureTimeUs, timestamp.captureTimeUs);
+    XCTAssertEqual(parsed.frameID, timestamp.frameID);
+
+    // 按H264解析时NALU类型不对
+    XCTAssertFalse([self parseSEI:sei codec:CQVideoCodecH264 timestamp:&parsed]);
+}
+
+#pragma mark - Emulation Prevention
+- (void)testEmulationPreventionVector {
+    static const uint8_t rbsp[] = {0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x03};
+    static const uint8_t expected[] = {0x06, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x03};
+    uint8_t ebsp[sizeof(rbsp) + sizeof(rbsp) / 2 + 1];
+    size_t ebspSize = CQNaluAddEmulationPrevention(rbsp, sizeof(rbsp), ebsp);
+    XCTAssertEqualObjects([NSData dataWithBytes:ebsp length:ebspSize], [NSData dataWithBytes:expected length:sizeof(expected)]);
+
+    // 原地去掉后还原
+    size_t rbspSize = CQNaluRemoveEmulationPrevention(ebsp, ebspSize, ebsp);
+    XCTAssertEqualObjects([NSData dataWithBytes:ebsp length:rbspSize], [NSData dataWithBytes:rbsp length:sizeof(rbsp)]);
+}
+
+- (void)testTimestampWithZeroRunsIsEscaped {
+    // 采集时刻全0、帧序号里有连续的0和01/03，写入时都要插入防竞争字节
+    CQCaptureTimestamp timestamp = {.captureTimeUs = 0, .frameID = 0x0000000100000003};
+    for (NSNumber *codec in @[@(CQVideoCodecH264), @(CQVideoCodecHEVC)]) {
+        NSData *sei = CQTimestampSEICreate((CQVideoCodec)codec.integerValue, timestamp);
+        size_t rbspSize = CQNaluHeaderSize((CQVideoCodec)codec.integerValue) + 1 + 1 + 32 + 1;
+        XCTAssertGreaterThan(sei.length, 4 + rbspSize);
+        [self assertNoStartCodeEmulationInSEI:sei];
+
+        CQCaptureTimestamp parsed = {.captureTimeUs = 1, .frameID = 1};
+        XCTAssertTrue([self parseSEI:sei codec:(CQVideoCodec)codec.integerValue timestamp:&parsed]);
+        XCTAssertEqual(parsed.captureTimeUs, timestamp.captureTimeUs);
+        XCTAssertEqual(parsed.frameID, timestamp.frameID);
+    }
+}
+
+#pragma mark - Parse
+- (void)testParseSkipsOtherMessages {
+    // 第一条是300字节的其它SEI(payloadSize用0xFF累加编码，全0负载转义后超过栈上缓冲)，第二条是采集时间戳
+    NSMutableData *rbsp = [NSMutableData data];
+    const uint8_t header[] = {CQH264NaluTypeSEI, 4, 0xFF, 300 - 255};
+    [rbsp appendBytes:header length:sizeof(header)];
+    [rbsp increaseLengthBy:300];
+    const uint8_t messageHeader[] = {5, 32};
+    [rbsp appendBytes:messageHeader length:sizeof(messageHeader)];
+    [rbsp appendBytes:kTestTimestampSEIUUID length:sizeof(kTestTimestampSEIUUID)];
+    const uint8_t payload[16] = {0, 0, 0, 0, 0, 0, 0, 9, 0, 0, 0, 0, 0, 0, 0, 7};
+    [rbsp appendBytes:payload length:sizeof(payload)];
+    const uint8_t trailing = 0x80;
+    [rbsp appendBytes:&trailing length:1];
+
+    NSMutableData *ebsp = [NSMutableData dataWithLength:rbsp.length + rbsp.length / 2 + 1];
+    ebsp.length = CQNaluAddEmulationPrevention(rbsp.bytes, rbsp.length, ebsp.mutableBytes);
+    CQCaptureTimestamp parsed = {0};
+    XCTAssertTrue(CQTimestampSEIParse(CQVideoCodecH264, ebsp.bytes, ebsp.length, &parsed));
+    XCTAssertEqual(parsed.captureTimeUs, 9u);
+    XCTAssertEqual(parsed.frameID, 7u);
+
+    // UUID不同的user_data_unregistered不是采集时间戳
+    uint8_t *bytes = rbsp.mutableBytes;
+    bytes[sizeof(header) + 300 + sizeof(messageHeader)] ^= 0xFF;
+    ebsp.length = rbsp.length + rbsp.length / 2 + 1;
+    ebsp.length = CQNaluAddEmulationPrevention(rbsp.bytes, rbsp.length, ebsp.mutableBytes);
+    XCTAssertFalse(CQTimestampSEIParse(CQVideoCodecH264, ebsp.bytes, ebsp.length, &parsed));
+}
+
+- (void)testParseRejectsTruncatedAndNonSEI {
+    CQCaptureTimestamp timestamp = {.captureTimeUs = 123456789, .frameID = 3};
+    NSData *sei = CQTimestampSEICreate(CQVideoCodecH264, timestamp);
+    const uint8_t *nalu = (const uint8_t *)sei.bytes + 4;
+    size_t naluSize = sei.length - 4;
+    CQCaptureTimestamp parsed = {0};
+    // 负载被截断时payloadSize超出剩余长度
+    for (size_t size = 0; size < naluSize - 1; size++) {
+        XCTAssertFalse(CQTimestampSEIParse(CQVideoCodecH264, nalu, size, &parsed), @"size %zu", size);
+    }
+    // 不是SEI
+    NSMutableData *slice = [NSMutableData dataWithBytes:nalu length:naluSize];
+    ((uint8_t *)slice.mutableBytes)[0] = CQH264NaluTypeIDR;
+    XCTAssertFalse(CQTimestampSEIParse(CQVideoCodecH264, slice.bytes, slice.length, &parsed));
+}
+
+@end
@@ -0,0 +1,208 @@
+//
+//  CQYUVConverterTests.m
+//  CQAVKitTests
+//
+//  Created by 刘超群 on 2026/10/19.
+//
+
+#import <XCTest/XCTest.h>
+#import "CQYUVConverter.h"
+#import "CQTestSupport.h"
+
+/// 一帧的缓冲，NEON和标量各一份目标
+typedef struct {
+    uint8_t *rgb;
+    uint8_t *y;
+    uint8_t *u;
+    uint8_t *v;
+    size_t ySize;
+    size_t uSize;
+    CQRGBToYUVFrame frame;
+} CQTestYUVBuffers;
+
+/// 分配并填充随机RGB，目标用填充字节初始化
+static CQTestYUVBuffers CQTestYUVBuffersCreate(size_t width, size_t height, BOOL isNV12, CQRGBOrder order, CQRGBToYUVCoefficients coefficients, uint32_t seed) {
+    CQTestYUVBuffers buffers = {0};
+    size_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    CQRGBToYUVFrame *frame = &buffers.frame;
+    frame->rgbBytesPerRow = width * 4 + kTestPadding;
+    frame->yBytesPerRow = width + kTestPadding;
+    frame->uBytesPerRow = (isNV12 ? chromaWidth * 2 : chromaWidth) + kTestPadding;
+    frame->vBytesPerRow = isNV12 ? 0 : chromaWidth + kTestPadding;
+    buffers.ySize = frame->yBytesPerRow * height;
+    buffers.uSize = frame->uBytesPerRow * chromaHeight;
+    buffers.rgb = malloc(frame->rgbBytesPerRow * height);
+    buffers.y = malloc(buffers.ySize);
+    buffers.u = malloc(buffers.uSize);
+    buffers.v = isNV12 ? NULL : malloc(buffers.uSize);
+    for (size_t i = 0; i < frame->rgbBytesPerRow * height; i++) {
+        buffers.rgb[i] = (uint8_t)CQTestRandom(&seed);
+    }
+    memset(buffers.y, kTestPaddingByte, buffers.ySize);
+    memset(buffers.u, kTestPaddingByte, buffers.uSize);
+    if (buffers.v) memset(buffers.v, kTestPaddingByte, buffers.uSize);
+    frame->rgb = buffers.rgb;
+    frame->order = order;
+    frame->y = buffers.y;
+    frame->u = buffers.u;
+    frame->v = buffers.v;
+    frame->width = width;
+    frame->height = height;
+    frame->coefficients = coefficients;
+    return buffers;
+}
+
+/// 同样的源，目标另外分配一份
+static CQTestYUVBuffers CQTestYUVBuffersCopyTarget(const CQTestYUVBuffers *buffers) {
+    CQTestYUVBuffers copy = *buffers;
+    copy.y = malloc(buffers->ySize);
+    copy.u = malloc(buffers->uSize);
+    copy.v = buffers->v ? malloc(buffers->uSize) : NULL;
+    memset(copy.y, kTestPaddingByte, buffers->ySize);
+    memset(copy.u, kTestPaddingByte, buffers->uSize);
+    if (copy.v) memset(copy.v, kTestPaddingByte, buffers->uSize);
+    copy.frame.y = copy.y;
+    copy.frame.u = copy.u;
+    copy.frame.v = copy.v;
+    return copy;
+}
+
+static void CQTestYUVBuffersFreeTarget(CQTestYUVBuffers *buffers) {
+    free(buffers->y);
+    free(buffers->u);
+    free(buffers->v);
+}
+
+/// 目标完全相同(包括没有写到填充部分)
+static BOOL CQTestYUVBuffersEqual(const CQTestYUVBuffers *a, const CQTestYUVBuffers *b) {
+    return memcmp(a->y, b->y, a->ySize) == 0 && memcmp(a->u, b->u, a->uSize) == 0 && (!a->v || memcmp(a->v, b->v, a->uSize) == 0);
+}
+
+/// 一个平面行末尾的填充没有被改写
+static BOOL CQTestPlanePaddingIntact(const uint8_t *plane, size_t bytesPerRow, size_t rowCount) {
+    for (size_t row = 0; row < rowCount; row++) {
+        for (size_t i = bytesPerRow - kTestPadding; i < bytesPerRow; i++) {
+            if (plane[row * bytesPerRow + i] != kTestPaddingByte) return NO;
+        }
+    }
+    return YES;
+}
+
+/// 转换一个纯色像素，返回Y、U、V
+static void CQTestConvertColor(CQRGBToYUVCoefficients coefficients, uint8_t r, uint8_t g, uint8_t b, uint8_t yuv[3]) {
+    uint8_t rgba[2 * 2 * 4];
+    for (int i = 0; i < 4; i++) {
+        rgba[i * 4] = r;
+        rgba[i * 4 + 1] = g;
+        rgba[i * 4 + 2] = b;
+        rgba[i * 4 + 3] = 255;
+    }
+    uint8_t y[4], u[1], v[1];
+    CQRGBToYUVFrame frame = {rgba, 8, CQRGBOrderRGBA, y, 2, u, 1, v, 1, 2, 2, coefficients};
+    CQRGBToYUVConvertRows(&frame, 0, 2);
+    yuv[0] = y[0];
+    yuv[1] = u[0];
+    yuv[2] = v[0];
+}
+
+@interface CQYUVConverterTests : XCTestCase
+
+@end
+
+@implementation CQYUVConverterTests
+
+#pragma mark - Coefficients
+- (void)testKnownColors {
+    uint8_t yuv[3];
+    // 视频范围: 黑16，白235，灰色没有色度
+    CQRGBToYUVCoefficients video601 = CQRGBToYUVCoefficientsMake(CQYUVMatrixBT601, NO);
+    CQTestConvertColor(video601, 0, 0, 0, yuv);
+    XCTAssertEqual(yuv[0], 16);
+    XCTAssertEqual(yuv[1], 128);
+    XCTAssertEqual(yuv[2], 128);
+    CQTestConvertColor(video601, 255, 255, 255, yuv);
+    XCTAssertEqual(yuv[0], 235);
+    XCTAssertEqual(yuv[1], 128);
+    XCTAssertEqual(yuv[2], 128);
+    // 纯红: Y = 16 + 219 x 0.299 = 81.5，V = 128 + 112 = 240
+    CQTestConvertColor(video601, 255, 0, 0, yuv);
+    XCTAssertEqualWithAccuracy(yuv[0], 82, 1);
+    XCTAssertEqualWithAccuracy(yuv[1], 90, 1);
+    XCTAssertEqualWithAccuracy(yuv[2], 240, 1);
+
+    // 全范围BT.709: 白255，纯蓝U = 128 + 127.5
+    CQRGBToYUVCoefficients full709 = CQRGBToYUVCoefficientsMake(CQYUVMatrixBT709, YES);
+    CQTestConvertColor(full709, 255, 255, 255, yuv);
+    XCTAssertEqual(yuv[0], 255);
+    XCTAssertEqual(yuv[1], 128);
+    XCTAssertEqual(yuv[2], 128);
+    CQTestConvertColor(full709, 0, 0, 255, yuv);
+    XCTAssertEqualWithAccuracy(yuv[0], 18, 1);
+    XCTAssertEqual(yuv[1], 255);
+    XCTAssertEqualWithAccuracy(yuv[2], 116, 1);
+}
+
+#pragma mark - NEON
+- (void)testNEONMatchesScalar {
+    // 宽度覆盖16的整数倍、不足16和奇数，高度包含奇数，四种系数、两种字节顺序、NV12和I420
+    static const size_t widths[] = {1, 2, 15, 16, 17, 33, 64, 97};
+    static const size_t heights[] = {1, 2, 5, 16};
+    uint32_t seed = 1;
+    for (int coefficientIndex = 0; coefficientIndex < 4; coefficientIndex++) {
+        CQRGBToYUVCoefficients coefficients = CQRGBToYUVCoefficientsMake((CQYUVMatrix)(coefficientIndex / 2), coefficientIndex % 2);
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+                for (int layout = 0; layout < 4; layout++) {
+                    BOOL isNV12 = layout / 2;
+                    CQRGBOrder order = (CQRGBOrder)(layout % 2);
+                    CQTestYUVBuffers scalar = CQTestYUVBuffersCreate(widths[w], heights[h], isNV12, order, coefficients, seed++);
+                    CQTestYUVBuffers vector = CQTestYUVBuffersCopyTarget(&scalar);
+                    CQRGBToYUVConvertRowsScalar(&scalar.frame, 0, heights[h]);
+                    CQRGBToYUVConvertRows(&vector.frame, 0, heights[h]);
+                    XCTAssertTrue(CQTestYUVBuffersEqual(&scalar, &vector), @"coefficients %d %zux%zu layout %d", coefficientIndex, widths[w], heights[h], layout);
+                    XCTAssertTrue(CQTestPlanePaddingIntact(vector.y, vector.frame.yBytesPerRow, heights[h]));
+                    XCTAssertTrue(CQTestPlanePaddingIntact(vector.u, vector.frame.uBytesPerRow, (heights[h] + 1) / 2));
+                    CQTestYUVBuffersFreeTarget(&vector);
+                    CQTestYUVBuffersFreeTarget(&scalar);
+                    free(scalar.rgb);
+                }
+            }
+        }
+    }
+}
+
+- (void)testExtremeValuesMatchScalar {
+    // 全0、全255和交替的极值，检查饱和和取整
+    CQRGBToYUVCoefficients coefficients = CQRGBToYUVCoefficientsMake(CQYUVMatrixBT709, YES);
+    CQTestYUVBuffers scalar = CQTestYUVBuffersCreate(48, 4, YES, CQRGBOrderBGRA, coefficients, 0);
+    for (size_t i = 0; i < scalar.frame.rgbBytesPerRow * 4; i++) {
+        scalar.rgb[i] = (i / 4 + i / scalar.frame.rgbBytesPerRow) % 3 == 0 ? 0 : 255;
+        if (i / 64 == 1) scalar.rgb[i] = 255;
+        if (i / 64 == 2) scalar.rgb[i] = 0;
+    }
+    CQTestYUVBuffers vector = CQTestYUVBuffersCopyTarget(&scalar);
+    CQRGBToYUVConvertRowsScalar(&scalar.frame, 0, 4);
+    CQRGBToYUVConvertRows(&vector.frame, 0, 4);
+    XCTAssertTrue(CQTestYUVBuffersEqual(&scalar, &vector));
+    CQTestYUVBuffersFreeTarget(&vector);
+    CQTestYUVBuffersFreeTarget(&scalar);
+    free(scalar.rgb);
+}
+
+#pragma mark - Bands
+- (void)testBandsMatchSingleThread {
+    // 分段转换和整帧一次转换结果相同，段数超过行对数时按行对数处理
+    CQRGBToYUVCoefficients coefficients = CQRGBToYUVCoefficientsMake(CQYUVMatrixBT601, NO);
+    CQTestYUVBuffers single = CQTestYUVBuffersCreate(40, 21, NO, CQRGBOrderRGBA, coefficients, 9);
+    CQRGBToYUVConvert(&single.frame, 1);
+    for (size_t bandCount = 0; bandCount <= 16; bandCount += 3) {
+        CQTestYUVBuffers banded = CQTestYUVBuffersCopyTarget(&single);
+        CQRGBToYUVConvert(&banded.frame, bandCount);
+        XCTAssertTrue(CQTestYUVBuffersEqual(&single, &banded), @"bandCount %zu", bandCount);
+        CQTestYUVBuffersFreeTarget(&banded);
+    }
+    CQTestYUVBuffersFreeTarget(&single);
+    free(single.rgb);
+}
+
+@end